@@ -6,8 +6,19 @@ layout(std140) uniform ub_Scene
 	highp mat4 iu_viewProjectionMatrix;
 };
 
+// see sponza/shaders/geometry.vs
+layout(std140) uniform ub_Instance
+{
+	highp mat4 iu_XForm;
+	highp mat4 iu_InvXForm;
+	highp vec4 iu_PositionOffset;
+	highp vec4 iu_PositionScale;
+	highp vec4 iu_TexCoordOffsetScale;
+};
+
 void main()
 {
-	vec3 posW = l_Position_L;
-	gl_Position = iu_viewProjectionMatrix * vec4(posW, 1.0f);
+	vec3 posL = iu_PositionOffset.xyz + l_Position_L * iu_PositionScale.xyz;
+	vec4 posW = iu_XForm * vec4(posL, 1.0f);
+	gl_Position = iu_viewProjectionMatrix * posW;
 }
\ No newline at end of file
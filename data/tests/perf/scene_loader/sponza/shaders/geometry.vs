@@ -1,8 +1,8 @@
 #version 300 es
 layout (location = 0) in highp vec3 l_Position_L;
-layout (location = 1) in mediump vec3 l_Normal_L;
+layout (location = 1) in mediump vec3 l_Normal_L;			// xy only when octahedral
 layout (location = 2) in mediump vec3 l_Tangent_L;
-layout (location = 3) in mediump vec2 l_TexCoord;
+layout (location = 3) in highp vec2 l_TexCoord;
 
 layout(std140) uniform ub_Scene
 {
@@ -12,19 +12,47 @@ layout(std140) uniform ub_Scene
 	mediump vec3 iu_sh[9];
 };
 
+// the world matrix of the node and the quantization of the mesh, the identity for the f32 ones
+layout(std140) uniform ub_Instance
+{
+	highp mat4 iu_XForm;
+	highp mat4 iu_InvXForm;									// n * mat3(iu_InvXForm) is the inverse transpose for the normals
+	highp vec4 iu_PositionOffset;							// w is 1 when the normals and tangents are octahedral
+	highp vec4 iu_PositionScale;
+	highp vec4 iu_TexCoordOffsetScale;
+};
+
 out mediump mat3 v_TBN;
 out mediump vec2 v_TexCoord;
 out mediump vec3 v_ViewDir_W;
 out highp vec4 v_PosLS;
 
+mediump vec3 DecodeOctahedral(mediump vec2 i_e)
+{
+	// the lower hemisphere is folded over the diagonals
+	mediump vec3 v = vec3(i_e, 1.0f - abs(i_e.x) - abs(i_e.y));
+	mediump float t = max(-v.z, 0.0f);
+	v.x += v.x >= 0.0f ? -t : t;
+	v.y += v.y >= 0.0f ? -t : t;
+	return normalize(v);
+}
+
 void main()
 {
-	v_TexCoord = l_TexCoord;
-	mediump vec3 normalW = l_Normal_L;
-	mediump vec3 tangentW = l_Tangent_L;
+	v_TexCoord = iu_TexCoordOffsetScale.xy + l_TexCoord * iu_TexCoordOffsetScale.zw;
+	mediump vec3 normalL = l_Normal_L;
+	mediump vec3 tangentL = l_Tangent_L;
+	if (iu_PositionOffset.w > 0.5f)
+	{
+		normalL = DecodeOctahedral(l_Normal_L.xy);
+		tangentL = DecodeOctahedral(l_Tangent_L.xy);
+	}
+	mediump vec3 normalW = normalize(normalL * mat3(iu_InvXForm));
+	mediump vec3 tangentW = normalize(mat3(iu_XForm) * tangentL);
 	mediump vec3 bitangentW = cross(normalW, tangentW);
 	v_TBN = mat3(tangentW, bitangentW, normalW);
-	vec3 posW = l_Position_L;
+	vec3 posL = iu_PositionOffset.xyz + l_Position_L * iu_PositionScale.xyz;
+	vec3 posW = (iu_XForm * vec4(posL, 1.0f)).xyz;
 	v_ViewDir_W = normalize(iu_cameraPos - posW);
 	v_PosLS = iu_shadowViewProjectionMatrix * vec4(posW, 1.0f);
 	gl_Position = iu_viewProjectionMatrix * vec4(posW, 1.0f);
@@ -0,0 +1,11 @@
+#version 300 es
+layout (location = 0) in highp vec2 l_Position;
+layout (location = 1) in mediump vec2 l_TexCoord;
+
+out mediump vec2 v_TexCoord;
+
+void main()
+{
+	v_TexCoord = l_TexCoord;
+	gl_Position = vec4(l_Position, 0.0f, 1.0f);
+}
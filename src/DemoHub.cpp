@@ -20,7 +20,7 @@
 
 // performance demo
 #include "Graphics/Performance/Empty.h"
-//#include "Graphics/Performance/TextureStreaming.h"
+#include "Graphics/Performance/TextureStreaming.h"
 #include "Graphics/Performance/Triangle.h"
 //#include "Graphics/Performance/ImGuiCustomWidgets.h"
 #include "Graphics/Performance/SceneLoader.h"
@@ -31,6 +31,7 @@
 #include "Graphics/Performance/SIMD.h"
 #include "Graphics/Performance/LuaScripting.h"
 #include "Graphics/Performance/Matrices.h"
+#include "Graphics/Performance/PlyLoading.h"
 
 // tech demo
 //#include "Graphics/RenderTech/FrameBuffer.h"
@@ -168,9 +169,11 @@ void DemoHub::Initialize()
 	_EmplacePerformanceSuite<perf::HDRBlending>();
 	_EmplacePerformanceSuite<perf::Textures>();
 	_EmplacePerformanceSuite<perf::CubeMapTextures>();
+	_EmplacePerformanceSuite<perf::TextureStreaming>();
 	_EmplacePerformanceSuite<perf::SIMD>();
 	_EmplacePerformanceSuite<perf::LuaScripting>();
 	_EmplacePerformanceSuite<perf::Matrices>();
+	_EmplacePerformanceSuite<perf::PlyLoading>();
 
 	_EmplaceRenderTechSuite<tech::PBRHelmet>();
 	_EmplaceRenderTechSuite<tech::HDRBloom>();
@@ -0,0 +1,305 @@
+#include "CbModelLoader.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "Graphics/meshoptimizer/meshoptimizer.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CBMODEL_SIMD_SSE
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define CBMODEL_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+namespace cbmodel
+{
+// ------------------------------------------------------------------
+
+const u32 SelectLod(const LodInfo* i_lods, const u32 i_lodsCount, const f32 i_distance,
+		const f32 i_projectionScale, const f32 i_maxPixelsError)
+{
+	// the errors grow with the lods
+	const f32 maxError = i_maxPixelsError * floral::max(i_distance, 0.0f) / i_projectionScale;
+	u32 lod = 0;
+	while (lod + 1 < i_lodsCount && i_lods[lod + 1].error <= maxError)
+	{
+		lod++;
+	}
+	return lod;
+}
+
+namespace details
+{
+// ------------------------------------------------------------------
+
+const bool IsModelFileV2(const voidptr i_fileData, const size i_fileSize)
+{
+	if (i_fileSize < sizeof(ModelFileHeader))
+	{
+		return false;
+	}
+
+	const ModelFileHeader* header = (const ModelFileHeader*)i_fileData;
+	if (memcmp(header->magicCharacters, "CBMD", 4) != 0)
+	{
+		return false;
+	}
+
+	FLORAL_ASSERT_MSG(header->version == k_ModelFileVersion, "Unknown cbmodel version");
+	if (header->version != k_ModelFileVersion
+		|| header->indicesOffset + header->indicesSize > i_fileSize
+		|| header->verticesOffset + header->verticesSize > i_fileSize)
+	{
+		return false;
+	}
+
+	if (header->lodsCount > k_MaxLodsCount
+		|| header->lodsOffset + (u64)header->lodsCount * sizeof(LodInfo) > i_fileSize)
+	{
+		return false;
+	}
+
+	const LodInfo* lods = (const LodInfo*)((const u8*)i_fileData + header->lodsOffset);
+	for (u32 i = 0; i < header->lodsCount; i++)
+	{
+		if ((u64)lods[i].firstIndex + lods[i].indicesCount > (u64)header->indicesCount)
+		{
+			return false;
+		}
+	}
+
+	// the clusters split lod 0
+	const u64 clusteredIndicesCount = header->lodsCount > 0 ? lods[0].indicesCount : (u64)header->indicesCount;
+	if (header->clustersOffset + (u64)header->clustersCount * sizeof(ClusterInfo) > i_fileSize)
+	{
+		return false;
+	}
+
+	const ClusterInfo* clusters = (const ClusterInfo*)((const u8*)i_fileData + header->clustersOffset);
+	for (u32 i = 0; i < header->clustersCount; i++)
+	{
+		if ((u64)clusters[i].firstIndex + clusters[i].indicesCount > clusteredIndicesCount)
+		{
+			return false;
+		}
+	}
+
+	if (header->compression == Compression::None)
+	{
+		return header->indicesSize == (u64)header->indicesCount * sizeof(s32)
+			&& header->verticesSize == (u64)header->verticesCount * header->vertexLayout.stride;
+	}
+	return header->compression == Compression::MeshOptimizer;
+}
+
+const size GetAttributeSize(const u32 i_attributeIdx)
+{
+	// position, normal, tangent are vec3f, texcoord is vec2f
+	return i_attributeIdx == 3 ? sizeof(floral::vec2f) : sizeof(floral::vec3f);
+}
+
+void CopyAttribute(const u8* i_src, const size i_srcStride, p8 o_dst, const size i_dstStride,
+		const size i_attributeSize, const s32 i_count)
+{
+	if (i_srcStride == i_attributeSize && i_dstStride == i_attributeSize)
+	{
+		memcpy(o_dst, i_src, i_attributeSize * i_count);
+		return;
+	}
+
+	for (s32 i = 0; i < i_count; i++)
+	{
+		memcpy(o_dst, i_src, i_attributeSize);
+		i_src += i_srcStride;
+		o_dst += i_dstStride;
+	}
+}
+
+const floral::aabb3f ComputeAABB(const floral::vec3f* i_positions, const size i_stride, const s32 i_count)
+{
+	floral::aabb3f aabb;
+	aabb.min_corner = floral::vec3f(9999.0f, 9999.0f, 9999.0f);
+	aabb.max_corner = floral::vec3f(-9999.0f, -9999.0f, -9999.0f);
+	if (i_count <= 0)
+	{
+		return aabb;
+	}
+
+	const u8* position = (const u8*)i_positions;
+	memcpy(&aabb.min_corner, position, sizeof(floral::vec3f));
+	aabb.max_corner = aabb.min_corner;
+	s32 i = 1;
+
+	// a 4 floats load of a vec3f reads 4 bytes past it: the last vertex is left to the scalar loop
+	const s32 simdCount = i_count - 1;
+#if defined(CBMODEL_SIMD_SSE)
+	if (simdCount >= 3)
+	{
+	__m128 minCorner0 = _mm_loadu_ps((const f32*)position);
+	__m128 maxCorner0 = minCorner0;
+	__m128 minCorner1 = minCorner0;
+	__m128 maxCorner1 = minCorner0;
+	for (; i + 1 < simdCount; i += 2)
+	{
+		const __m128 p0 = _mm_loadu_ps((const f32*)(position + i * i_stride));
+		const __m128 p1 = _mm_loadu_ps((const f32*)(position + (i + 1) * i_stride));
+		minCorner0 = _mm_min_ps(minCorner0, p0);
+		maxCorner0 = _mm_max_ps(maxCorner0, p0);
+		minCorner1 = _mm_min_ps(minCorner1, p1);
+		maxCorner1 = _mm_max_ps(maxCorner1, p1);
+	}
+	f32 minValues[4];
+	f32 maxValues[4];
+	_mm_storeu_ps(minValues, _mm_min_ps(minCorner0, minCorner1));
+	_mm_storeu_ps(maxValues, _mm_max_ps(maxCorner0, maxCorner1));
+	aabb.min_corner = floral::vec3f(minValues[0], minValues[1], minValues[2]);
+	aabb.max_corner = floral::vec3f(maxValues[0], maxValues[1], maxValues[2]);
+	}
+#elif defined(CBMODEL_SIMD_NEON)
+	if (simdCount >= 3)
+	{
+	float32x4_t minCorner0 = vld1q_f32((const f32*)position);
+	float32x4_t maxCorner0 = minCorner0;
+	float32x4_t minCorner1 = minCorner0;
+	float32x4_t maxCorner1 = minCorner0;
+	for (; i + 1 < simdCount; i += 2)
+	{
+		const float32x4_t p0 = vld1q_f32((const f32*)(position + i * i_stride));
+		const float32x4_t p1 = vld1q_f32((const f32*)(position + (i + 1) * i_stride));
+		minCorner0 = vminq_f32(minCorner0, p0);
+		maxCorner0 = vmaxq_f32(maxCorner0, p0);
+		minCorner1 = vminq_f32(minCorner1, p1);
+		maxCorner1 = vmaxq_f32(maxCorner1, p1);
+	}
+	f32 minValues[4];
+	f32 maxValues[4];
+	vst1q_f32(minValues, vminq_f32(minCorner0, minCorner1));
+	vst1q_f32(maxValues, vmaxq_f32(maxCorner0, maxCorner1));
+	aabb.min_corner = floral::vec3f(minValues[0], minValues[1], minValues[2]);
+	aabb.max_corner = floral::vec3f(maxValues[0], maxValues[1], maxValues[2]);
+	}
+#endif
+
+	for (; i < i_count; i++)
+	{
+		floral::vec3f v;
+		memcpy(&v, position + i * i_stride, sizeof(floral::vec3f));
+		if (v.x < aabb.min_corner.x) aabb.min_corner.x = v.x;
+		if (v.y < aabb.min_corner.y) aabb.min_corner.y = v.y;
+		if (v.z < aabb.min_corner.z) aabb.min_corner.z = v.z;
+		if (v.x > aabb.max_corner.x) aabb.max_corner.x = v.x;
+		if (v.y > aabb.max_corner.y) aabb.max_corner.y = v.y;
+		if (v.z > aabb.max_corner.z) aabb.max_corner.z = v.z;
+	}
+	return aabb;
+}
+
+void DecodeAttribute(const u8* i_src, const size i_srcStride, const VertexFormat i_format,
+		const Quantization& i_quantization, const u32 i_attributeIdx,
+		p8 o_dst, const size i_dstStride, const s32 i_count)
+{
+	FLORAL_ASSERT(i_format != VertexFormat::Float);
+	switch (i_attributeIdx)
+	{
+	case 0:
+	{
+		const floral::vec3f scale = i_quantization.positionScale * (1.0f / 65535.0f);
+		for (s32 i = 0; i < i_count; i++)
+		{
+			u16 q[3];
+			memcpy(q, i_src + i * i_srcStride, sizeof(q));
+			const floral::vec3f v(
+					i_quantization.positionOffset.x + (f32)q[0] * scale.x,
+					i_quantization.positionOffset.y + (f32)q[1] * scale.y,
+					i_quantization.positionOffset.z + (f32)q[2] * scale.z);
+			memcpy(o_dst + i * i_dstStride, &v, sizeof(floral::vec3f));
+		}
+		break;
+	}
+
+	case 1:
+	case 2:
+	{
+		for (s32 i = 0; i < i_count; i++)
+		{
+			f32 x = 0.0f, y = 0.0f;
+			if (i_format == VertexFormat::Quantized16)
+			{
+				s16 q[2];
+				memcpy(q, i_src + i * i_srcStride, sizeof(q));
+				x = floral::max((f32)q[0] / 32767.0f, -1.0f);
+				y = floral::max((f32)q[1] / 32767.0f, -1.0f);
+			}
+			else
+			{
+				const s8* q = (const s8*)(i_src + i * i_srcStride);
+				x = floral::max((f32)q[0] / 127.0f, -1.0f);
+				y = floral::max((f32)q[1] / 127.0f, -1.0f);
+			}
+			const floral::vec3f v = DecodeOctahedral(x, y);
+			memcpy(o_dst + i * i_dstStride, &v, sizeof(floral::vec3f));
+		}
+		break;
+	}
+
+	case 3:
+	{
+		const floral::vec2f scale = i_quantization.texcoordScale * (1.0f / 65535.0f);
+		for (s32 i = 0; i < i_count; i++)
+		{
+			u16 q[2];
+			memcpy(q, i_src + i * i_srcStride, sizeof(q));
+			const floral::vec2f v(
+					i_quantization.texcoordOffset.x + (f32)q[0] * scale.x,
+					i_quantization.texcoordOffset.y + (f32)q[1] * scale.y);
+			memcpy(o_dst + i * i_dstStride, &v, sizeof(floral::vec2f));
+		}
+		break;
+	}
+
+	default:
+		FLORAL_ASSERT(false);
+		break;
+	}
+}
+
+const floral::vec3f DecodeOctahedral(const f32 i_x, const f32 i_y)
+{
+	// the lower hemisphere is folded over the diagonals
+	floral::vec3f v(i_x, i_y, 1.0f - fabsf(i_x) - fabsf(i_y));
+	const f32 t = floral::max(-v.z, 0.0f);
+	v.x += v.x >= 0.0f ? -t : t;
+	v.y += v.y >= 0.0f ? -t : t;
+	return floral::normalize(v);
+}
+
+void ReadLods(const ModelFileHeader* i_header, const s32 i_indicesCount, u32* o_lodsCount, LodInfo* o_lods)
+{
+	if (i_header == nullptr || i_header->lodsCount == 0)
+	{
+		*o_lodsCount = 1;
+		o_lods[0].firstIndex = 0;
+		o_lods[0].indicesCount = (u32)i_indicesCount;
+		o_lods[0].error = 0.0f;
+		return;
+	}
+
+	*o_lodsCount = i_header->lodsCount;
+	memcpy(o_lods, (const u8*)i_header + i_header->lodsOffset, sizeof(LodInfo) * i_header->lodsCount);
+}
+
+const bool DecodeIndices(s32* o_indices, const s32 i_indicesCount, const u8* i_src, const size i_srcSize)
+{
+	return meshopt_decodeIndexBuffer(o_indices, (size_t)i_indicesCount, sizeof(s32), i_src, i_srcSize) == 0;
+}
+
+const bool DecodeVertices(p8 o_vertices, const s32 i_verticesCount, const size i_stride, const u8* i_src, const size i_srcSize)
+{
+	return meshopt_decodeVertexBuffer(o_vertices, (size_t)i_verticesCount, i_stride, i_src, i_srcSize) == 0;
+}
+
+// ------------------------------------------------------------------
+}
+}
@@ -9,6 +9,7 @@ namespace cbmodel
 
 #pragma pack(push)
 #pragma pack(1)
+// v1 files, every attribute in its own stream
 struct ModelHeader
 {
 	s32											indicesCount;
@@ -20,8 +21,108 @@ struct ModelHeader
 	size										tangentOffset;
 	size										texcoordOffset;
 };
+
+/*
+ * Interleaved vertices, attributes in the order of VertexAttribute: position, normal, tangent,
+ * texcoord. The layouts modelbaker emits are the ones of geo3d's vertices (PNTT, PNT, PN, P).
+ */
+struct VertexLayout
+{
+	u32											attributes;				// VertexAttribute mask
+	u32											stride;
+	u32											offsets[4];				// from the start of a vertex, 0 when absent
+};
+
+/*
+ * Quantized vertices, see geo3d::VertexPNTTQ16 / VertexPNTTQ8:
+ * - position: 3 x u16 normalized over the mesh's bounding box, positionOffset + q * positionScale
+ * - normal, tangent: octahedral, 2 x s16 or 2 x s8 normalized
+ * - texcoord: 2 x u16 normalized over the mesh's texcoord bounds, texcoordOffset + q * texcoordScale
+ */
+enum class VertexFormat : u32
+{
+	Float										= 0,
+	Quantized16,
+	Quantized8
+};
+
+struct Quantization
+{
+	floral::vec3f								positionOffset;
+	floral::vec3f								positionScale;
+	floral::vec2f								texcoordOffset;
+	floral::vec2f								texcoordScale;
+};
+
+// of the indices and vertices blocks
+enum class Compression : u32
+{
+	None										= 0,
+	MeshOptimizer												// meshopt_encodeIndexBuffer / meshopt_encodeVertexBuffer
+};
+
+/*
+ * The levels of detail share the vertices, each one is a range of the indices. Lod 0 is the mesh
+ * as authored, the next ones are simplified from it.
+ */
+struct LodInfo
+{
+	u32											firstIndex;
+	u32											indicesCount;
+	f32											error;					// max deviation from lod 0, in model units
+};
+
+/*
+ * Lod 0 may be split into clusters of up to 64 vertices and 124 triangles, each one a range of its
+ * indices, with the bounding sphere and the normal cone of its triangles for culling them as a whole.
+ */
+struct ClusterInfo
+{
+	u32											firstIndex;
+	u32											indicesCount;
+	floral::vec3f								center;
+	f32											radius;
+	floral::vec3f								coneAxis;
+	f32											coneCutoff;				// cos of the cone's half angle, 1 when it cannot be culled
+};
+
+/*
+ * v2 container:
+ * - ModelFileHeader
+ * - the material name, not null terminated
+ * - LodInfo x lodsCount, 4 bytes aligned
+ * - ClusterInfo x clustersCount
+ * - s32 x indicesCount, 16 bytes aligned
+ * - the interleaved vertices, 16 bytes aligned: a single copy when the layout is the one asked
+ * With a compression, the blocks are encoded and indicesSize / verticesSize are their sizes in the file.
+ * v1 files are a ModelHeader followed by the streams, they don't start with the magic.
+ */
+struct ModelFileHeader
+{
+	c8											magicCharacters[4];		// "CBMD"
+	u32											version;
+	s32											indicesCount;
+	s32											verticesCount;
+	VertexLayout								vertexLayout;
+	VertexFormat								vertexFormat;
+	Quantization								quantization;			// when vertexFormat is not Float
+	Compression									compression;
+	u32											lodsCount;
+	u32											clustersCount;
+	u32											materialNameLength;
+	u64											materialNameOffset;		// from the start of the file
+	u64											lodsOffset;
+	u64											clustersOffset;
+	u64											indicesOffset;
+	u64											indicesSize;			// in bytes
+	u64											verticesOffset;
+	u64											verticesSize;
+};
 #pragma pack(pop)
 
+static const u32								k_ModelFileVersion = 2;
+static const u32								k_MaxLodsCount = 4;
+
 template <class TVertex>
 struct Model
 {
@@ -33,6 +134,14 @@ struct Model
 	const_cstr									materialName;
 
 	floral::aabb3f								aabb;
+	VertexFormat								vertexFormat;			// of verticesData
+	Quantization								quantization;
+
+	u32											lodsCount;				// at least 1
+	LodInfo										lods[k_MaxLodsCount];
+
+	u32											clustersCount;			// of lod 0, 0 when not clustered
+	const ClusterInfo*							clusters;
 };
 
 enum class VertexAttribute : u32
@@ -49,12 +158,60 @@ inline VertexAttribute operator|(const VertexAttribute a, const VertexAttribute
 	return (VertexAttribute)(u32(a) | u32(b));
 }
 
+static const u32								k_VertexAttributesCount = 4;
+
+/*
+ * When the file is quantized and TVertex has its layout, the vertices are copied as they are (the shader
+ * decodes them with the model's quantization), else they are decoded to the f32 vertex of i_vtxAttrib.
+ */
 template <class TVertex, class TFileSystem, class TIOAllocator, class TDataAllocator>
 const Model<TVertex>							LoadModelData(TFileSystem* i_fs, const floral::relative_path& i_path, const VertexAttribute i_vtxAttrib, TIOAllocator* i_ioAllocator, TDataAllocator* i_dataAllocator);
 
 template <class TVertex, class TIOAllocator, class TDataAllocator>
 const Model<TVertex>							LoadModelData(const floral::path& i_path, const VertexAttribute i_vtxAttrib, TIOAllocator* i_ioAllocator, TDataAllocator* i_dataAllocator);
 
+/*
+ * The coarsest lod whose error, seen from i_distance, projects to less than i_maxPixelsError pixels.
+ * i_projectionScale is viewport height / (2 * tan(fovy / 2)).
+ */
+const u32										SelectLod(const LodInfo* i_lods, const u32 i_lodsCount, const f32 i_distance,
+													const f32 i_projectionScale, const f32 i_maxPixelsError);
+
+namespace details
+{
+// ------------------------------------------------------------------
+
+const bool										IsModelFileV2(const voidptr i_fileData, const size i_fileSize);
+
+// sizeof of each attribute of VertexAttribute's order
+const size										GetAttributeSize(const u32 i_attributeIdx);
+
+// strided copy of one attribute of i_count vertices
+void											CopyAttribute(const u8* i_src, const size i_srcStride, p8 o_dst, const size i_dstStride,
+													const size i_attributeSize, const s32 i_count);
+
+// min / max of i_count positions i_stride bytes apart, SSE2 / NEON when available
+const floral::aabb3f							ComputeAABB(const floral::vec3f* i_positions, const size i_stride, const s32 i_count);
+
+// strided decode of one quantized attribute of i_count vertices to its f32 form
+void											DecodeAttribute(const u8* i_src, const size i_srcStride, const VertexFormat i_format,
+													const Quantization& i_quantization, const u32 i_attributeIdx,
+													p8 o_dst, const size i_dstStride, const s32 i_count);
+
+const floral::vec3f								DecodeOctahedral(const f32 i_x, const f32 i_y);
+
+// the lod table of a v2 file; a single lod covering the indices for v1 files (i_header is nullptr)
+void											ReadLods(const ModelFileHeader* i_header, const s32 i_indicesCount,
+													u32* o_lodsCount, LodInfo* o_lods);
+
+// meshoptimizer decoding of the compressed blocks, false when the data is corrupted
+const bool										DecodeIndices(s32* o_indices, const s32 i_indicesCount, const u8* i_src, const size i_srcSize);
+const bool										DecodeVertices(p8 o_vertices, const s32 i_verticesCount, const size i_stride,
+													const u8* i_src, const size i_srcSize);
+
+// ------------------------------------------------------------------
+}
+
 // ------------------------------------------------------------------
 }
 
@@ -2,6 +2,8 @@
 #include <floral/io/nativeio.h>
 #include <floral/math/utils.h>
 
+#include <string.h>
+
 namespace cbmodel
 {
 // ------------------------------------------------------------------
@@ -10,112 +12,191 @@ namespace details
 {
 // ------------------------------------------------------------------
 
-template <class TVertex, class TDataAllocator>
-const Model<TVertex> LoadModelData(floral::file_stream& i_inpStream, const VertexAttribute i_vtxAttrib, TDataAllocator* i_dataAllocator)
+template <class TVertex, class TIOAllocator, class TDataAllocator>
+const Model<TVertex> LoadModelData(const p8 i_fileData, const size i_fileSize, const VertexAttribute i_vtxAttrib,
+		TIOAllocator* i_ioAllocator, TDataAllocator* i_dataAllocator)
 {
-	ModelHeader header;
-	i_inpStream.read(&header);
+	// the layout of TVertex, attributes in the order of VertexAttribute
+	size vtxStride = 0;
+	size dstOffsets[k_VertexAttributesCount];
+	for (u32 i = 0; i < k_VertexAttributesCount; i++)
+	{
+		dstOffsets[i] = vtxStride;
+		if ((u32)i_vtxAttrib & (1u << i))
+		{
+			vtxStride += GetAttributeSize(i);
+		}
+	}
 
+	s32 indicesCount = 0;
+	s32 verticesCount = 0;
+	const u8* materialNameData = nullptr;
 	s32 materialNameLen = 0;
-	i_inpStream.read(&materialNameLen);
+	const u8* indicesSrc = nullptr;
+	const u8* attributesSrc[k_VertexAttributesCount] = { nullptr, nullptr, nullptr, nullptr };
+	size srcStrides[k_VertexAttributesCount] = { 0, 0, 0, 0 };
+	const u8* verticesSrc = nullptr;			// set when the whole block can be copied
+	const ModelFileHeader* v2Header = nullptr;
+	Compression compression = Compression::None;
+	VertexFormat srcFormat = VertexFormat::Float;
+	Quantization quantization;
+	memset(&quantization, 0, sizeof(Quantization));
+
+	if (IsModelFileV2(i_fileData, i_fileSize))
+	{
+		v2Header = (const ModelFileHeader*)i_fileData;
+		indicesCount = v2Header->indicesCount;
+		verticesCount = v2Header->verticesCount;
+		materialNameData = i_fileData + v2Header->materialNameOffset;
+		materialNameLen = (s32)v2Header->materialNameLength;
+		indicesSrc = i_fileData + v2Header->indicesOffset;
+		compression = v2Header->compression;
+
+		const VertexLayout& layout = v2Header->vertexLayout;
+		srcFormat = v2Header->vertexFormat;
+		quantization = v2Header->quantization;
+		if (layout.attributes == (u32)i_vtxAttrib && layout.stride == sizeof(TVertex))
+		{
+			// f32 or quantized, as it is in the file
+			verticesSrc = i_fileData + v2Header->verticesOffset;
+			vtxStride = sizeof(TVertex);
+		}
+		else
+		{
+			for (u32 i = 0; i < k_VertexAttributesCount; i++)
+			{
+				if ((u32)i_vtxAttrib & (1u << i))
+				{
+					FLORAL_ASSERT_MSG(layout.attributes & (1u << i), "The model does not have the vertex attribute");
+				}
+			}
+		}
+	}
+	else
+	{
+		ModelHeader header;
+		memcpy(&header, i_fileData, sizeof(ModelHeader));
+		indicesCount = header.indicesCount;
+		verticesCount = header.verticesCount;
+		memcpy(&materialNameLen, i_fileData + sizeof(ModelHeader), sizeof(s32));
+		materialNameData = i_fileData + sizeof(ModelHeader) + sizeof(s32);
+		indicesSrc = i_fileData + header.indicesOffset;
+
+		const size streamOffsets[k_VertexAttributesCount] = {
+			header.positionOffset, header.normalOffset, header.tangentOffset, header.texcoordOffset };
+		for (u32 i = 0; i < k_VertexAttributesCount; i++)
+		{
+			attributesSrc[i] = i_fileData + streamOffsets[i];
+			srcStrides[i] = GetAttributeSize(i);
+		}
+	}
+
 	cstr materialName = (cstr)i_dataAllocator->allocate(materialNameLen + 1);
-	memset(materialName, 0, materialNameLen + 1);
-	i_inpStream.read_bytes((voidptr)materialName, materialNameLen);
+	memcpy(materialName, materialNameData, materialNameLen);
+	materialName[materialNameLen] = 0;
+
+	const VertexFormat dstFormat = verticesSrc ? srcFormat : VertexFormat::Float;
+	FLORAL_ASSERT(vtxStride == sizeof(TVertex));
 
 	Model<TVertex> modelData;
-	modelData.indicesCount = header.indicesCount;
-	modelData.verticesCount = header.verticesCount;
-	modelData.indicesData = nullptr;
-	modelData.verticesData = nullptr;
+	modelData.vertexFormat = dstFormat;
+	modelData.quantization = quantization;
+	modelData.indicesCount = indicesCount;
+	modelData.verticesCount = verticesCount;
 	modelData.materialName = materialName;
-
-	size vtxStride = 0;
-	if (floral::test_bit_mask(i_vtxAttrib, VertexAttribute::Position))
-	{
-		vtxStride += sizeof(floral::vec3f);
-	}
-	if (floral::test_bit_mask(i_vtxAttrib, VertexAttribute::Normal))
+	ReadLods(v2Header, indicesCount, &modelData.lodsCount, modelData.lods);
+	modelData.clustersCount = 0;
+	modelData.clusters = nullptr;
+	if (v2Header && v2Header->clustersCount > 0)
 	{
-		vtxStride += sizeof(floral::vec3f);
+		const size clustersSize = sizeof(ClusterInfo) * v2Header->clustersCount;
+		ClusterInfo* clusters = (ClusterInfo*)i_dataAllocator->allocate(clustersSize);
+		memcpy(clusters, i_fileData + v2Header->clustersOffset, clustersSize);
+		modelData.clustersCount = v2Header->clustersCount;
+		modelData.clusters = clusters;
 	}
-	if (floral::test_bit_mask(i_vtxAttrib, VertexAttribute::Tangent))
+
+	voidptr indicesData = i_dataAllocator->allocate(sizeof(s32) * indicesCount);
+	voidptr verticesData = i_dataAllocator->allocate(vtxStride * verticesCount);
+	if (compression == Compression::None)
 	{
-		vtxStride += sizeof(floral::vec3f);
+		memcpy(indicesData, indicesSrc, sizeof(s32) * indicesCount);
 	}
-	if (floral::test_bit_mask(i_vtxAttrib, VertexAttribute::TexCoord))
+	else
 	{
-		vtxStride += sizeof(floral::vec2f);
+		const bool decoded = DecodeIndices((s32*)indicesData, indicesCount, indicesSrc, (size)v2Header->indicesSize);
+		FLORAL_ASSERT_MSG(decoded, "Corrupted cbmodel indices");
 	}
 
-	FLORAL_ASSERT(vtxStride == sizeof(TVertex));
-
-	voidptr indicesData = i_dataAllocator->allocate(sizeof(s32) * header.indicesCount);
-	voidptr verticesData = i_dataAllocator->allocate(vtxStride * header.verticesCount);
-
-	// index
-	i_inpStream.seek_begin(header.indicesOffset);
-	i_inpStream.read_bytes(indicesData, header.indicesCount * sizeof(s32));
-
-	// vertex
-	floral::vec3f minCorner(9999.0f, 9999.0f, 9999.0f);
-	floral::vec3f maxCorner(-9999.0f, -9999.0f, -9999.0f);
-	aptr startOffset = 0;
-	if (floral::test_bit_mask(i_vtxAttrib, VertexAttribute::Position))
+	if (v2Header && !verticesSrc)
 	{
-		aptr offset = startOffset;
-		i_inpStream.seek_begin(header.positionOffset);
-		for (s32 i = 0; i < header.verticesCount; i++)
+		// the vertices are converted from the file's layout, decoded first if they are compressed
+		const u8* fileVertices = i_fileData + v2Header->verticesOffset;
+		if (compression != Compression::None)
 		{
-			voidptr dest = voidptr((aptr)verticesData + offset);
-			i_inpStream.read_bytes(dest, sizeof(floral::vec3f));
-			floral::vec3f* v = (floral::vec3f*)(dest);
-			if (v->x > maxCorner.x) maxCorner.x = v->x;
-			if (v->x < minCorner.x) minCorner.x = v->x;
-			if (v->y > maxCorner.y) maxCorner.y = v->y;
-			if (v->y < minCorner.y) minCorner.y = v->y;
-			if (v->z > maxCorner.z) maxCorner.z = v->z;
-			if (v->z < minCorner.z) minCorner.z = v->z;
-			offset += vtxStride;
+			// the scratch is io memory, it goes away with the file data
+			p8 decodedVertices = (p8)i_ioAllocator->allocate((size)v2Header->vertexLayout.stride * verticesCount);
+			const bool decoded = DecodeVertices(decodedVertices, verticesCount, v2Header->vertexLayout.stride,
+					fileVertices, (size)v2Header->verticesSize);
+			FLORAL_ASSERT_MSG(decoded, "Corrupted cbmodel vertices");
+			fileVertices = decodedVertices;
 		}
-		startOffset += sizeof(floral::vec3f);
-	}
-	modelData.aabb.max_corner = maxCorner;
-	modelData.aabb.min_corner = minCorner;
 
-	if (floral::test_bit_mask(i_vtxAttrib, VertexAttribute::Normal))
-	{
-		aptr offset = startOffset;
-		i_inpStream.seek_begin(header.normalOffset);
-		for (s32 i = 0; i < header.verticesCount; i++)
+		for (u32 i = 0; i < k_VertexAttributesCount; i++)
 		{
-			i_inpStream.read_bytes(voidptr((aptr)verticesData + offset), sizeof(floral::vec3f));
-			offset += vtxStride;
+			attributesSrc[i] = fileVertices + v2Header->vertexLayout.offsets[i];
+			srcStrides[i] = v2Header->vertexLayout.stride;
 		}
-		startOffset += sizeof(floral::vec3f);
 	}
 
-	if (floral::test_bit_mask(i_vtxAttrib, VertexAttribute::Tangent))
+	if (verticesSrc)
 	{
-		aptr offset = startOffset;
-		i_inpStream.seek_begin(header.tangentOffset);
-		for (s32 i = 0; i < header.verticesCount; i++)
+		if (compression == Compression::None)
 		{
-			i_inpStream.read_bytes(voidptr((aptr)verticesData + offset), sizeof(floral::vec3f));
-			offset += vtxStride;
+			memcpy(verticesData, verticesSrc, vtxStride * verticesCount);
+		}
+		else
+		{
+			const bool decoded = DecodeVertices((p8)verticesData, verticesCount, vtxStride, verticesSrc, (size)v2Header->verticesSize);
+			FLORAL_ASSERT_MSG(decoded, "Corrupted cbmodel vertices");
 		}
-		startOffset += sizeof(floral::vec3f);
 	}
-
-	if (floral::test_bit_mask(i_vtxAttrib, VertexAttribute::TexCoord))
+	else
 	{
-		aptr offset = startOffset;
-		i_inpStream.seek_begin(header.texcoordOffset);
-		for (s32 i = 0; i < header.verticesCount; i++)
+		for (u32 i = 0; i < k_VertexAttributesCount; i++)
 		{
-			i_inpStream.read_bytes(voidptr((aptr)verticesData + offset), sizeof(floral::vec2f));
-			offset += vtxStride;
+			if (((u32)i_vtxAttrib & (1u << i)) == 0)
+			{
+				continue;
+			}
+
+			if (srcFormat == VertexFormat::Float)
+			{
+				CopyAttribute(attributesSrc[i], srcStrides[i], (p8)verticesData + dstOffsets[i], vtxStride,
+						GetAttributeSize(i), verticesCount);
+			}
+			else
+			{
+				DecodeAttribute(attributesSrc[i], srcStrides[i], srcFormat, quantization, i,
+						(p8)verticesData + dstOffsets[i], vtxStride, verticesCount);
+			}
 		}
-		startOffset += sizeof(floral::vec2f);
+	}
+
+	if (dstFormat != VertexFormat::Float)
+	{
+		// the quantization range is the bounding box
+		modelData.aabb.min_corner = quantization.positionOffset;
+		modelData.aabb.max_corner = quantization.positionOffset + quantization.positionScale;
+	}
+	else if (floral::test_bit_mask(i_vtxAttrib, VertexAttribute::Position))
+	{
+		modelData.aabb = ComputeAABB((const floral::vec3f*)verticesData, vtxStride, verticesCount);
+	}
+	else
+	{
+		modelData.aabb.min_corner = floral::vec3f(9999.0f, 9999.0f, 9999.0f);
+		modelData.aabb.max_corner = floral::vec3f(-9999.0f, -9999.0f, -9999.0f);
 	}
 
 	modelData.indicesData = (s32*)indicesData;
@@ -135,7 +216,7 @@ const Model<TVertex> LoadModelData(TFileSystem* i_fs, const floral::relative_pat
 	floral::read_all_file(inp, inpStream);
 	floral::close_file(inp);
 
-	return details::LoadModelData<TVertex, TDataAllocator>(inpStream, i_vtxAttrib, i_dataAllocator);
+	return details::LoadModelData<TVertex, TIOAllocator, TDataAllocator>(inpStream.buffer, inp.file_size, i_vtxAttrib, i_ioAllocator, i_dataAllocator);
 }
 
 template <class TVertex, class TIOAllocator, class TDataAllocator>
@@ -147,7 +228,7 @@ const Model<TVertex> LoadModelData(const floral::path& i_path, const VertexAttri
 	floral::read_all_file(inp, inpStream);
 	floral::close_file(inp);
 
-	return details::LoadModelData<TVertex, TDataAllocator>(inpStream, i_vtxAttrib, i_dataAllocator);
+	return details::LoadModelData<TVertex, TIOAllocator, TDataAllocator>(inpStream.buffer, inp.file_size, i_vtxAttrib, i_ioAllocator, i_dataAllocator);
 }
 
 // ------------------------------------------------------------------
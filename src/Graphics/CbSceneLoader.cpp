@@ -0,0 +1,127 @@
+#include "CbSceneLoader.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CBSCENE_SIMD_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define CBSCENE_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+namespace cbscene
+{
+// ------------------------------------------------------------------
+
+namespace details
+{
+// ------------------------------------------------------------------
+
+// translation * rotation * scale, the 4 columns; the last row is (0, 0, 0, 1)
+static inline void ComputeLocalMatrix(const NodeTransform& i_transform, f32 o_columns[16])
+{
+	const f32 x = i_transform.rotation.v.x;
+	const f32 y = i_transform.rotation.v.y;
+	const f32 z = i_transform.rotation.v.z;
+	const f32 w = i_transform.rotation.w;
+	const floral::vec3f& s = i_transform.scale;
+	const floral::vec3f& t = i_transform.position;
+
+	o_columns[0] = (1.0f - 2.0f * (y * y + z * z)) * s.x;
+	o_columns[1] = 2.0f * (x * y + w * z) * s.x;
+	o_columns[2] = 2.0f * (x * z - w * y) * s.x;
+	o_columns[3] = 0.0f;
+	o_columns[4] = 2.0f * (x * y - w * z) * s.y;
+	o_columns[5] = (1.0f - 2.0f * (x * x + z * z)) * s.y;
+	o_columns[6] = 2.0f * (y * z + w * x) * s.y;
+	o_columns[7] = 0.0f;
+	o_columns[8] = 2.0f * (x * z + w * y) * s.z;
+	o_columns[9] = 2.0f * (y * z - w * x) * s.z;
+	o_columns[10] = (1.0f - 2.0f * (x * x + y * y)) * s.z;
+	o_columns[11] = 0.0f;
+	o_columns[12] = t.x;
+	o_columns[13] = t.y;
+	o_columns[14] = t.z;
+	o_columns[15] = 1.0f;
+}
+
+// ------------------------------------------------------------------
+}
+
+void ComputeWorldMatrices(const NodeTransform* i_localTransforms, const s32* i_parentIndices,
+		const size i_nodesCount, floral::mat4x4f* o_worldMatrices)
+{
+	static_assert(sizeof(floral::mat4x4f) == 16 * sizeof(f32), "mat4x4f must be 4 packed columns");
+
+	for (size i = 0; i < i_nodesCount; i++)
+	{
+		f32* world = &o_worldMatrices[i][0][0];
+		const s32 parentIdx = i_parentIndices[i];
+		FLORAL_ASSERT(parentIdx < (s32)i);
+		if (parentIdx < 0)
+		{
+			details::ComputeLocalMatrix(i_localTransforms[i], world);
+			continue;
+		}
+
+		f32 local[16];
+		details::ComputeLocalMatrix(i_localTransforms[i], local);
+		const f32* parent = &o_worldMatrices[parentIdx][0][0];
+
+		// world = parent * local, a column of world is the columns of parent weighted by a column of local;
+		// the last row of local is known so its multiplications are skipped
+#if defined(CBSCENE_SIMD_SSE)
+		const __m128 p0 = _mm_loadu_ps(parent);
+		const __m128 p1 = _mm_loadu_ps(parent + 4);
+		const __m128 p2 = _mm_loadu_ps(parent + 8);
+		const __m128 p3 = _mm_loadu_ps(parent + 12);
+		for (s32 c = 0; c < 4; c++)
+		{
+			const f32* l = local + c * 4;
+			__m128 r = _mm_add_ps(_mm_add_ps(
+						_mm_mul_ps(p0, _mm_set1_ps(l[0])),
+						_mm_mul_ps(p1, _mm_set1_ps(l[1]))),
+					_mm_mul_ps(p2, _mm_set1_ps(l[2])));
+			if (c == 3)
+			{
+				r = _mm_add_ps(r, p3);
+			}
+			_mm_storeu_ps(world + c * 4, r);
+		}
+#elif defined(CBSCENE_SIMD_NEON)
+		const float32x4_t p0 = vld1q_f32(parent);
+		const float32x4_t p1 = vld1q_f32(parent + 4);
+		const float32x4_t p2 = vld1q_f32(parent + 8);
+		const float32x4_t p3 = vld1q_f32(parent + 12);
+		for (s32 c = 0; c < 4; c++)
+		{
+			const f32* l = local + c * 4;
+			float32x4_t r = vmulq_n_f32(p0, l[0]);
+			r = vmlaq_n_f32(r, p1, l[1]);
+			r = vmlaq_n_f32(r, p2, l[2]);
+			if (c == 3)
+			{
+				r = vaddq_f32(r, p3);
+			}
+			vst1q_f32(world + c * 4, r);
+		}
+#else
+		for (s32 c = 0; c < 4; c++)
+		{
+			const f32* l = local + c * 4;
+			for (s32 r = 0; r < 4; r++)
+			{
+				world[c * 4 + r] = parent[r] * l[0] + parent[4 + r] * l[1] + parent[8 + r] * l[2]
+					+ (c == 3 ? parent[12 + r] : 0.0f);
+			}
+		}
+#endif
+	}
+}
+
+void ComputeWorldMatrices(const Scene& i_scene, floral::mat4x4f* o_worldMatrices)
+{
+	ComputeWorldMatrices(i_scene.nodeTransforms, i_scene.parentIndices, i_scene.nodesCount, o_worldMatrices);
+}
+
+// ------------------------------------------------------------------
+}
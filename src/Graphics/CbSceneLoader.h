@@ -3,17 +3,28 @@
 #include <floral/stdaliases.h>
 #include <floral/cmds/path.h>
 #include <floral/gpds/vec.h>
+#include <floral/gpds/mat.h>
 #include <floral/gpds/quaternion.h>
 
 namespace cbscene
 {
 // ------------------------------------------------------------------
 
+/*
+ * - SceneHeader
+ * - the meshes: the length then the characters of the cbmodel file name
+ * - the nodes: the length then the characters of the name, the parent index, the mesh index and the NodeInfo
+ * The nodes are in depth first order, a parent is always before its children. Every mesh is only
+ * exported once, the nodes using it share its index.
+ */
 #pragma pack(push)
 #pragma pack(1)
 struct SceneHeader
 {
-	size										nodesCount;
+	c8											magicCharacters[4];		// "CBSC"
+	u32											version;
+	u32											nodesCount;
+	u32											meshesCount;
 };
 
 struct NodeInfo
@@ -24,6 +35,8 @@ struct NodeInfo
 };
 #pragma pack(pop)
 
+static const u32								k_SceneFileVersion = 2;
+
 struct NodeTransform
 {
 	floral::vec3f								position;
@@ -35,8 +48,13 @@ struct Scene
 {
 	size										nodesCount;
 	const_cstr*									nodeNames;
-	const_cstr*									nodeFileNames;
-	NodeTransform*								nodeTransforms;
+	const_cstr*									nodeFileNames;			// of the mesh of the node, nullptr when it has none
+	s32*										parentIndices;			// -1 for the roots, else less than the index of the node
+	s32*										meshIndices;			// -1 for the nodes without geometry
+	NodeTransform*								nodeTransforms;			// relative to the parent
+
+	size										meshesCount;
+	const_cstr*									meshFileNames;
 };
 
 template <class TIOAllocator, class TDataAllocator, class TFileSystem>
@@ -45,6 +63,14 @@ const Scene										LoadSceneData(TFileSystem* i_fs, const floral::relative_pat
 template <class TIOAllocator, class TDataAllocator>
 const Scene										LoadSceneData(const floral::path& i_path, TIOAllocator* i_ioAllocator, TDataAllocator* i_dataAllocator);
 
+/*
+ * The world matrix of every node in one pass over the nodes: as the parents come first, the world
+ * matrix of the parent is always ready. o_worldMatrices must hold i_nodesCount matrices.
+ */
+void											ComputeWorldMatrices(const NodeTransform* i_localTransforms, const s32* i_parentIndices,
+													const size i_nodesCount, floral::mat4x4f* o_worldMatrices);
+void											ComputeWorldMatrices(const Scene& i_scene, floral::mat4x4f* o_worldMatrices);
+
 // ------------------------------------------------------------------
 }
 
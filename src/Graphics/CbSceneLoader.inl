@@ -1,3 +1,6 @@
+#include <floral/assert/assert.h>
+#include <floral/io/nativeio.h>
+
 namespace cbscene
 {
 // ------------------------------------------------------------------
@@ -6,6 +9,17 @@ namespace details
 {
 // ------------------------------------------------------------------
 
+template <class TDataAllocator>
+const_cstr ReadString(floral::file_stream& i_inpStream, TDataAllocator* i_dataAllocator)
+{
+	s32 len = -1;
+	i_inpStream.read(&len);
+	cstr str = (cstr)i_dataAllocator->allocate(len + 1);
+	i_inpStream.read_bytes(str, len);
+	str[len] = 0;
+	return str;
+}
+
 template <class TIOAllocator, class TDataAllocator>
 const Scene LoadSceneData(floral::file_stream& i_inpStream, TIOAllocator* i_ioAllocator, TDataAllocator* i_dataAllocator)
 {
@@ -13,31 +27,41 @@ const Scene LoadSceneData(floral::file_stream& i_inpStream, TIOAllocator* i_ioAl
 
 	SceneHeader header;
 	i_inpStream.read(&header);
+	FLORAL_ASSERT_MSG(header.magicCharacters[0] == 'C' && header.magicCharacters[1] == 'B'
+			&& header.magicCharacters[2] == 'S' && header.magicCharacters[3] == 'C', "Not a cbscene file");
+	FLORAL_ASSERT_MSG(header.version == k_SceneFileVersion, "Unknown cbscene version");
+
+	newScene.meshesCount = header.meshesCount;
+	newScene.meshFileNames = i_dataAllocator->template allocate_array<const_cstr>(header.meshesCount);
+	for (u32 i = 0; i < header.meshesCount; i++)
+	{
+		newScene.meshFileNames[i] = ReadString(i_inpStream, i_dataAllocator);
+	}
 
 	newScene.nodesCount = header.nodesCount;
 	newScene.nodeNames = i_dataAllocator->template allocate_array<const_cstr>(header.nodesCount);
 	newScene.nodeFileNames = i_dataAllocator->template allocate_array<const_cstr>(header.nodesCount);
+	newScene.parentIndices = i_dataAllocator->template allocate_array<s32>(header.nodesCount);
+	newScene.meshIndices = i_dataAllocator->template allocate_array<s32>(header.nodesCount);
 	newScene.nodeTransforms = i_dataAllocator->template allocate_array<NodeTransform>(header.nodesCount);
 
-	for (size i = 0; i < header.nodesCount; i++)
+	for (u32 i = 0; i < header.nodesCount; i++)
 	{
-		s32 nodeNameLen = -1;
-		i_inpStream.read(&nodeNameLen);
-		cstr nodeName = (cstr)i_dataAllocator->allocate(nodeNameLen + 1);
-		i_inpStream.read_bytes(nodeName, nodeNameLen);
-		nodeName[nodeNameLen] = 0;
-
-		s32 nodeFileNameLen = -1;
-		i_inpStream.read(&nodeFileNameLen);
-		cstr nodeFileName = (cstr)i_dataAllocator->allocate(nodeFileNameLen + 1);
-		i_inpStream.read_bytes(nodeFileName, nodeFileNameLen);
-		nodeFileName[nodeFileNameLen] = 0;
+		newScene.nodeNames[i] = ReadString(i_inpStream, i_dataAllocator);
+
+		s32 parentIdx = -1;
+		s32 meshIdx = -1;
+		i_inpStream.read(&parentIdx);
+		i_inpStream.read(&meshIdx);
+		FLORAL_ASSERT_MSG(parentIdx < (s32)i, "The parent of a node must be before it");
+		FLORAL_ASSERT(meshIdx < (s32)header.meshesCount);
 
 		NodeInfo nodeInfo;
 		i_inpStream.read(&nodeInfo);
 
-		newScene.nodeNames[i] = nodeName;
-		newScene.nodeFileNames[i] = nodeFileName;
+		newScene.parentIndices[i] = parentIdx;
+		newScene.meshIndices[i] = meshIdx;
+		newScene.nodeFileNames[i] = meshIdx >= 0 ? newScene.meshFileNames[meshIdx] : nullptr;
 		newScene.nodeTransforms[i].position = nodeInfo.translation;
 		newScene.nodeTransforms[i].rotation = nodeInfo.rotation;
 		newScene.nodeTransforms[i].scale = nodeInfo.scale;
@@ -0,0 +1,159 @@
+#include "CbScenePackage.h"
+
+#include <string.h>
+
+#include "Graphics/FileMapping.h"
+
+namespace cbscene
+{
+// ------------------------------------------------------------------
+
+const bool OpenScenePackage(ScenePackage* o_package, const floral::path& i_path)
+{
+	size fileSize = 0;
+	// the meshes are accessed one by one, no need to read the whole file ahead
+	p8 fileData = (p8)file_mapping::MapFile(i_path.pm_PathStr, &fileSize, false);
+	if (fileData == nullptr)
+	{
+		return false;
+	}
+
+	o_package->data = fileData;
+	o_package->dataSize = fileSize;
+	o_package->mapped = true;
+	if (!details::ReadPackageTables(o_package))
+	{
+		CloseScenePackage(o_package);
+		return false;
+	}
+	return true;
+}
+
+void CloseScenePackage(ScenePackage* io_package)
+{
+	if (io_package->mapped && io_package->data)
+	{
+		file_mapping::UnmapFile(io_package->data, io_package->dataSize);
+	}
+
+	io_package->data = nullptr;
+	io_package->dataSize = 0;
+	io_package->header = nullptr;
+	io_package->nodes = nullptr;
+	io_package->meshes = nullptr;
+	io_package->materials = nullptr;
+	io_package->strings = nullptr;
+}
+
+const_cstr GetNodeName(const ScenePackage& i_package, const u32 i_nodeIdx)
+{
+	FLORAL_ASSERT(i_nodeIdx < i_package.header->nodesCount);
+	return i_package.strings + i_package.nodes[i_nodeIdx].nameOffset;
+}
+
+const NodeTransform GetNodeTransform(const ScenePackage& i_package, const u32 i_nodeIdx)
+{
+	FLORAL_ASSERT(i_nodeIdx < i_package.header->nodesCount);
+	const NodeInfo& nodeInfo = i_package.nodes[i_nodeIdx].transform;
+	NodeTransform transform;
+	transform.position = nodeInfo.translation;
+	transform.rotation = nodeInfo.rotation;
+	transform.scale = nodeInfo.scale;
+	return transform;
+}
+
+const_cstr GetMeshName(const ScenePackage& i_package, const u32 i_meshIdx)
+{
+	FLORAL_ASSERT(i_meshIdx < i_package.header->meshesCount);
+	return i_package.strings + i_package.meshes[i_meshIdx].nameOffset;
+}
+
+const_cstr GetMaterialName(const ScenePackage& i_package, const u32 i_materialIdx)
+{
+	FLORAL_ASSERT(i_materialIdx < i_package.header->materialsCount);
+	return i_package.strings + i_package.materials[i_materialIdx].nameOffset;
+}
+
+const cbmodel::ModelFileHeader* GetPackageMeshHeader(const ScenePackage& i_package, const u32 i_meshIdx)
+{
+	FLORAL_ASSERT(i_meshIdx < i_package.header->meshesCount);
+	const PackageMesh& mesh = i_package.meshes[i_meshIdx];
+	const p8 blob = i_package.data + mesh.offset;
+	FLORAL_ASSERT(cbmodel::details::IsModelFileV2(blob, mesh.size));
+	return (const cbmodel::ModelFileHeader*)blob;
+}
+
+namespace details
+{
+// ------------------------------------------------------------------
+
+const bool ReadPackageTables(ScenePackage* io_package)
+{
+	const p8 data = io_package->data;
+	const size dataSize = io_package->dataSize;
+	if (dataSize < sizeof(PackageFileHeader))
+	{
+		return false;
+	}
+
+	const PackageFileHeader* header = (const PackageFileHeader*)data;
+	if (memcmp(header->magicCharacters, "CBPK", 4) != 0)
+	{
+		return false;
+	}
+
+	FLORAL_ASSERT_MSG(header->version == k_PackageFileVersion, "Unknown scene package version");
+	if (header->version != k_PackageFileVersion
+		|| header->nodesOffset + (u64)header->nodesCount * sizeof(PackageNode) > dataSize
+		|| header->meshesOffset + (u64)header->meshesCount * sizeof(PackageMesh) > dataSize
+		|| header->materialsOffset + (u64)header->materialsCount * sizeof(PackageMaterial) > dataSize
+		|| header->stringTableOffset + header->stringTableSize > dataSize
+		|| header->stringTableSize == 0
+		|| data[header->stringTableOffset + header->stringTableSize - 1] != 0)
+	{
+		return false;
+	}
+
+	const PackageNode* nodes = (const PackageNode*)(data + header->nodesOffset);
+	for (u32 i = 0; i < header->nodesCount; i++)
+	{
+		if (nodes[i].nameOffset >= header->stringTableSize
+			|| nodes[i].parentIdx < -1 || nodes[i].parentIdx >= (s32)i
+			|| nodes[i].meshIdx < -1 || nodes[i].meshIdx >= (s32)header->meshesCount)
+		{
+			return false;
+		}
+	}
+
+	const PackageMesh* meshes = (const PackageMesh*)(data + header->meshesOffset);
+	for (u32 i = 0; i < header->meshesCount; i++)
+	{
+		if (meshes[i].nameOffset >= header->stringTableSize || meshes[i].materialIdx >= header->materialsCount
+			|| meshes[i].offset + meshes[i].size > dataSize)
+		{
+			return false;
+		}
+	}
+
+	const PackageMaterial* materials = (const PackageMaterial*)(data + header->materialsOffset);
+	for (u32 i = 0; i < header->materialsCount; i++)
+	{
+		if (materials[i].nameOffset >= header->stringTableSize)
+		{
+			return false;
+		}
+	}
+
+	io_package->header = header;
+	io_package->nodes = nodes;
+	io_package->meshes = meshes;
+	io_package->materials = materials;
+	io_package->strings = (const_cstr)(data + header->stringTableOffset);
+	return true;
+}
+
+// ------------------------------------------------------------------
+}
+
+// ------------------------------------------------------------------
+}
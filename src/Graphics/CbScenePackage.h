@@ -0,0 +1,132 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+#include <floral/cmds/path.h>
+
+#include "Graphics/CbModelLoader.h"
+#include "Graphics/CbSceneLoader.h"
+
+namespace cbscene
+{
+// ------------------------------------------------------------------
+
+/*
+ * A whole scene in one file, so loading it is one open and one mapping instead of a file per node:
+ * - PackageFileHeader
+ * - the tables: PackageNode x nodesCount, PackageMesh x meshesCount, PackageMaterial x materialsCount
+ * - the string table, null terminated strings the tables point to by offset
+ * - the meshes, each one a v2 cbmodel file, 16 bytes aligned
+ * The nodes are in depth first order like in the cbscene file, a parent is always before its children. Nodes
+ * sharing a mesh point to the same blob and the materials are only stored once.
+ */
+#pragma pack(push)
+#pragma pack(1)
+struct PackageFileHeader
+{
+	c8											magicCharacters[4];		// "CBPK"
+	u32											version;
+	u32											nodesCount;
+	u32											meshesCount;
+	u32											materialsCount;
+	u32											stringTableSize;
+	u64											nodesOffset;			// from the start of the file
+	u64											meshesOffset;
+	u64											materialsOffset;
+	u64											stringTableOffset;
+};
+
+struct PackageNode
+{
+	u32											nameOffset;				// in the string table
+	s32											parentIdx;				// -1 for the roots, else less than the index of the node
+	s32											meshIdx;				// -1 for the nodes without geometry
+	NodeInfo									transform;				// relative to the parent
+};
+
+struct PackageMesh
+{
+	u32											nameOffset;
+	u32											materialIdx;
+	u64											offset;					// of the cbmodel blob, from the start of the file
+	u64											size;
+};
+
+struct PackageMaterial
+{
+	u32											nameOffset;
+};
+#pragma pack(pop)
+
+static const u32								k_PackageFileVersion = 2;
+
+struct ScenePackage
+{
+	p8											data;
+	size										dataSize;
+	bool										mapped;					// else data is owned by the io allocator
+
+	const PackageFileHeader*					header;
+	const PackageNode*							nodes;
+	const PackageMesh*							meshes;
+	const PackageMaterial*						materials;
+	const_cstr									strings;
+};
+
+// maps the file, the pages of a mesh are only read once it is accessed
+const bool										OpenScenePackage(ScenePackage* o_package, const floral::path& i_path);
+
+// reads the file in one go, for the file systems that cannot be mapped
+template <class TFileSystem, class TIOAllocator>
+const bool										OpenScenePackage(ScenePackage* o_package, TFileSystem* i_fs, const floral::relative_path& i_path, TIOAllocator* i_ioAllocator);
+
+void											CloseScenePackage(ScenePackage* io_package);
+
+const_cstr										GetNodeName(const ScenePackage& i_package, const u32 i_nodeIdx);
+const NodeTransform								GetNodeTransform(const ScenePackage& i_package, const u32 i_nodeIdx);
+const_cstr										GetMeshName(const ScenePackage& i_package, const u32 i_meshIdx);
+const_cstr										GetMaterialName(const ScenePackage& i_package, const u32 i_materialIdx);
+
+// the header of the cbmodel blob of the mesh, to choose between GetPackageMesh and LoadPackageMesh
+const cbmodel::ModelFileHeader*					GetPackageMeshHeader(const ScenePackage& i_package, const u32 i_meshIdx);
+
+/*
+ * The hierarchy of the nodes as a cbscene::Scene, for ComputeWorldMatrices. The names point into the package,
+ * there are no mesh file names: meshIndices index the meshes of the package.
+ */
+template <class TDataAllocator>
+const Scene										GetPackageScene(const ScenePackage& i_package, TDataAllocator* i_dataAllocator);
+
+/*
+ * The mesh in place: the indices and vertices point into the package and live until it is closed, they
+ * must not be written to. The vertex layout of the blob must be i_vtxAttrib and it must not be compressed.
+ */
+template <class TVertex>
+const cbmodel::Model<TVertex>					GetPackageMesh(const ScenePackage& i_package, const u32 i_meshIdx, const cbmodel::VertexAttribute i_vtxAttrib);
+
+/*
+ * A copy of the mesh in i_dataAllocator, converted to i_vtxAttrib if the blob has another layout. A compressed
+ * blob that is also converted is decoded to a scratch in i_ioAllocator first.
+ */
+template <class TVertex, class TIOAllocator, class TDataAllocator>
+const cbmodel::Model<TVertex>					LoadPackageMesh(const ScenePackage& i_package, const u32 i_meshIdx, const cbmodel::VertexAttribute i_vtxAttrib,
+													TIOAllocator* i_ioAllocator, TDataAllocator* i_dataAllocator);
+
+// what LoadPackageMesh takes from each allocator, without the alignment of the allocations
+template <class TVertex>
+void											GetPackageMeshLoadSizes(const ScenePackage& i_package, const u32 i_meshIdx, const cbmodel::VertexAttribute i_vtxAttrib,
+													size* o_ioSize, size* o_dataSize);
+
+namespace details
+{
+// ------------------------------------------------------------------
+
+// checks the header and the bounds of the tables, sets up the pointers of io_package
+const bool										ReadPackageTables(ScenePackage* io_package);
+
+// ------------------------------------------------------------------
+}
+
+// ------------------------------------------------------------------
+}
+
+#include "CbScenePackage.inl"
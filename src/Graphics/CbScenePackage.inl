@@ -0,0 +1,119 @@
+#include <floral/assert/assert.h>
+#include <floral/io/nativeio.h>
+
+namespace cbscene
+{
+// ------------------------------------------------------------------
+
+template <class TFileSystem, class TIOAllocator>
+const bool OpenScenePackage(ScenePackage* o_package, TFileSystem* i_fs, const floral::relative_path& i_path, TIOAllocator* i_ioAllocator)
+{
+	floral::file_info inp = floral::open_file_read(i_fs, i_path);
+	if (inp.file_size <= 0)
+	{
+		return false;
+	}
+
+	floral::file_stream inpStream;
+	inpStream.buffer = (p8)i_ioAllocator->allocate(inp.file_size);
+	floral::read_all_file(inp, inpStream);
+	floral::close_file(inp);
+
+	o_package->data = inpStream.buffer;
+	o_package->dataSize = inp.file_size;
+	o_package->mapped = false;
+	return details::ReadPackageTables(o_package);
+}
+
+template <class TDataAllocator>
+const Scene GetPackageScene(const ScenePackage& i_package, TDataAllocator* i_dataAllocator)
+{
+	const u32 nodesCount = i_package.header->nodesCount;
+	Scene scene;
+	scene.nodesCount = nodesCount;
+	scene.nodeNames = i_dataAllocator->template allocate_array<const_cstr>(nodesCount);
+	scene.nodeFileNames = nullptr;
+	scene.parentIndices = i_dataAllocator->template allocate_array<s32>(nodesCount);
+	scene.meshIndices = i_dataAllocator->template allocate_array<s32>(nodesCount);
+	scene.nodeTransforms = i_dataAllocator->template allocate_array<NodeTransform>(nodesCount);
+	scene.meshesCount = i_package.header->meshesCount;
+	scene.meshFileNames = nullptr;
+
+	for (u32 i = 0; i < nodesCount; i++)
+	{
+		scene.nodeNames[i] = GetNodeName(i_package, i);
+		scene.parentIndices[i] = i_package.nodes[i].parentIdx;
+		scene.meshIndices[i] = i_package.nodes[i].meshIdx;
+		scene.nodeTransforms[i] = GetNodeTransform(i_package, i);
+	}
+	return scene;
+}
+
+template <class TVertex>
+const cbmodel::Model<TVertex> GetPackageMesh(const ScenePackage& i_package, const u32 i_meshIdx, const cbmodel::VertexAttribute i_vtxAttrib)
+{
+	FLORAL_ASSERT(i_meshIdx < i_package.header->meshesCount);
+	const PackageMesh& mesh = i_package.meshes[i_meshIdx];
+	const p8 blob = i_package.data + mesh.offset;
+	FLORAL_ASSERT(cbmodel::details::IsModelFileV2(blob, mesh.size));
+
+	const cbmodel::ModelFileHeader* header = (const cbmodel::ModelFileHeader*)blob;
+	FLORAL_ASSERT_MSG(header->vertexLayout.attributes == (u32)i_vtxAttrib && header->vertexLayout.stride == sizeof(TVertex),
+			"The vertex layout of the mesh is not the one asked, use LoadPackageMesh");
+	FLORAL_ASSERT_MSG(header->compression == cbmodel::Compression::None, "The mesh is compressed, use LoadPackageMesh");
+
+	cbmodel::Model<TVertex> model;
+	model.indicesCount = header->indicesCount;
+	model.verticesCount = header->verticesCount;
+	model.indicesData = (s32*)(blob + header->indicesOffset);
+	model.verticesData = (TVertex*)(blob + header->verticesOffset);
+	model.materialName = GetMaterialName(i_package, mesh.materialIdx);
+	cbmodel::details::ReadLods(header, model.indicesCount, &model.lodsCount, model.lods);
+	model.clustersCount = header->clustersCount;
+	model.clusters = (const cbmodel::ClusterInfo*)(blob + header->clustersOffset);
+	model.vertexFormat = header->vertexFormat;
+	model.quantization = header->quantization;
+	if (header->vertexFormat != cbmodel::VertexFormat::Float)
+	{
+		model.aabb.min_corner = header->quantization.positionOffset;
+		model.aabb.max_corner = header->quantization.positionOffset + header->quantization.positionScale;
+	}
+	else
+	{
+		model.aabb = cbmodel::details::ComputeAABB((const floral::vec3f*)model.verticesData, sizeof(TVertex), model.verticesCount);
+	}
+	return model;
+}
+
+template <class TVertex, class TIOAllocator, class TDataAllocator>
+const cbmodel::Model<TVertex> LoadPackageMesh(const ScenePackage& i_package, const u32 i_meshIdx, const cbmodel::VertexAttribute i_vtxAttrib,
+		TIOAllocator* i_ioAllocator, TDataAllocator* i_dataAllocator)
+{
+	FLORAL_ASSERT(i_meshIdx < i_package.header->meshesCount);
+	const PackageMesh& mesh = i_package.meshes[i_meshIdx];
+	return cbmodel::details::LoadModelData<TVertex, TIOAllocator, TDataAllocator>(i_package.data + mesh.offset, (size)mesh.size,
+			i_vtxAttrib, i_ioAllocator, i_dataAllocator);
+}
+
+template <class TVertex>
+void GetPackageMeshLoadSizes(const ScenePackage& i_package, const u32 i_meshIdx, const cbmodel::VertexAttribute i_vtxAttrib,
+		size* o_ioSize, size* o_dataSize)
+{
+	const cbmodel::ModelFileHeader* header = GetPackageMeshHeader(i_package, i_meshIdx);
+	const bool sameLayout = header->vertexLayout.attributes == (u32)i_vtxAttrib && header->vertexLayout.stride == sizeof(TVertex);
+
+	// only the vertices that are both compressed and converted go through a scratch
+	*o_ioSize = 0;
+	if (!sameLayout && header->compression != cbmodel::Compression::None)
+	{
+		*o_ioSize = (size)header->vertexLayout.stride * header->verticesCount;
+	}
+
+	*o_dataSize = (size)header->materialNameLength + 1
+		+ sizeof(cbmodel::ClusterInfo) * header->clustersCount
+		+ sizeof(s32) * header->indicesCount
+		+ sizeof(TVertex) * header->verticesCount;
+}
+
+// ------------------------------------------------------------------
+}
@@ -0,0 +1,106 @@
+#include "ClusterCulling.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace cluster_culling
+{
+// ------------------------------------------------------------------
+
+static inline const floral::vec4f NormalizePlane(const floral::vec4f& i_plane)
+{
+	const f32 length = sqrtf(i_plane.x * i_plane.x + i_plane.y * i_plane.y + i_plane.z * i_plane.z);
+	return floral::vec4f(i_plane.x / length, i_plane.y / length, i_plane.z / length, i_plane.w / length);
+}
+
+static inline const bool IsSphereOutside(const Frustum& i_frustum, const floral::vec3f& i_center, const f32 i_radius)
+{
+	for (u32 i = 0; i < 6; i++)
+	{
+		const floral::vec4f& plane = i_frustum.planes[i];
+		if (plane.x * i_center.x + plane.y * i_center.y + plane.z * i_center.z + plane.w < -i_radius)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// the bounding sphere version of meshoptimizer's cone test, it does not need the cone's apex
+static inline const bool IsClusterBackfacing(const cbmodel::ClusterInfo& i_cluster, const floral::vec3f& i_cameraPosition)
+{
+	const floral::vec3f d = i_cluster.center - i_cameraPosition;
+	const f32 distance = sqrtf(d.x * d.x + d.y * d.y + d.z * d.z);
+	const f32 cosAngle = d.x * i_cluster.coneAxis.x + d.y * i_cluster.coneAxis.y + d.z * i_cluster.coneAxis.z;
+	return cosAngle >= i_cluster.coneCutoff * distance + i_cluster.radius;
+}
+
+// ------------------------------------------------------------------
+
+const Frustum ExtractFrustum(const floral::mat4x4f& i_viewProjection)
+{
+	// clip = viewProjection * p, the planes are sums of its rows (Gribb & Hartmann)
+	floral::vec4f rows[4];
+	for (u32 r = 0; r < 4; r++)
+	{
+		rows[r] = floral::vec4f(i_viewProjection[0][r], i_viewProjection[1][r], i_viewProjection[2][r], i_viewProjection[3][r]);
+	}
+
+	Frustum frustum;
+	frustum.planes[0] = NormalizePlane(rows[3] + rows[0]);
+	frustum.planes[1] = NormalizePlane(rows[3] - rows[0]);
+	frustum.planes[2] = NormalizePlane(rows[3] + rows[1]);
+	frustum.planes[3] = NormalizePlane(rows[3] - rows[1]);
+	frustum.planes[4] = NormalizePlane(rows[3] + rows[2]);
+	frustum.planes[5] = NormalizePlane(rows[3] - rows[2]);
+	return frustum;
+}
+
+const u32 CullClusters(const cbmodel::ClusterInfo* i_clusters, const u32 i_clustersCount,
+		const Frustum& i_frustum, const floral::vec3f& i_cameraPosition, const bool i_backfaceCulling,
+		IndexRange* o_ranges, CullingStats* io_stats)
+{
+	u32 rangesCount = 0;
+	for (u32 i = 0; i < i_clustersCount; i++)
+	{
+		const cbmodel::ClusterInfo& cluster = i_clusters[i];
+		if (IsSphereOutside(i_frustum, cluster.center, cluster.radius))
+		{
+			io_stats->frustumCulledCount++;
+			continue;
+		}
+
+		if (i_backfaceCulling && IsClusterBackfacing(cluster, i_cameraPosition))
+		{
+			io_stats->backfaceCulledCount++;
+			continue;
+		}
+
+		if (rangesCount > 0 && o_ranges[rangesCount - 1].firstIndex + o_ranges[rangesCount - 1].indicesCount == cluster.firstIndex)
+		{
+			o_ranges[rangesCount - 1].indicesCount += cluster.indicesCount;
+		}
+		else
+		{
+			o_ranges[rangesCount].firstIndex = cluster.firstIndex;
+			o_ranges[rangesCount].indicesCount = cluster.indicesCount;
+			rangesCount++;
+		}
+	}
+	io_stats->clustersCount += i_clustersCount;
+	return rangesCount;
+}
+
+const u32 CompactIndices(const s32* i_indices, const IndexRange* i_ranges, const u32 i_rangesCount, s32* o_indices)
+{
+	u32 indicesCount = 0;
+	for (u32 i = 0; i < i_rangesCount; i++)
+	{
+		memcpy(o_indices + indicesCount, i_indices + i_ranges[i].firstIndex, sizeof(s32) * i_ranges[i].indicesCount);
+		indicesCount += i_ranges[i].indicesCount;
+	}
+	return indicesCount;
+}
+
+// ------------------------------------------------------------------
+}
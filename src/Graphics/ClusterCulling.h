@@ -0,0 +1,51 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+#include <floral/gpds/vec.h>
+#include <floral/gpds/mat.h>
+
+#include "Graphics/CbModelLoader.h"
+
+namespace cluster_culling
+{
+// ------------------------------------------------------------------
+
+// normalized, a point p is inside when dot(plane.xyz, p) + plane.w >= 0
+struct Frustum
+{
+	floral::vec4f								planes[6];				// left, right, bottom, top, near, far
+};
+
+struct IndexRange
+{
+	u32											firstIndex;
+	u32											indicesCount;
+};
+
+struct CullingStats
+{
+	u32											clustersCount;
+	u32											frustumCulledCount;
+	u32											backfaceCulledCount;
+};
+
+// the planes of the clip volume of i_viewProjection (OpenGL's, -w <= z <= w), in model space when it holds the world matrix
+const Frustum									ExtractFrustum(const floral::mat4x4f& i_viewProjection);
+
+/*
+ * The clusters seen from i_cameraPosition, as ranges of the model's indices. A cluster is culled when its
+ * bounding sphere is outside the frustum or, with i_backfaceCulling, when all its triangles face away from
+ * the camera (its normal cone). Consecutive visible clusters are merged in one range. The frustum and the
+ * camera are in the model's space.
+ * o_ranges must have room for i_clustersCount ranges, returns the ranges count. io_stats is accumulated.
+ */
+const u32										CullClusters(const cbmodel::ClusterInfo* i_clusters, const u32 i_clustersCount,
+													const Frustum& i_frustum, const floral::vec3f& i_cameraPosition, const bool i_backfaceCulling,
+													IndexRange* o_ranges, CullingStats* io_stats);
+
+// copies the ranges of i_indices back to back into o_indices, returns the indices count
+const u32										CompactIndices(const s32* i_indices, const IndexRange* i_ranges, const u32 i_rangesCount,
+													s32* o_indices);
+
+// ------------------------------------------------------------------
+}
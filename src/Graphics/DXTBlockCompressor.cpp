@@ -0,0 +1,462 @@
+#include "DXTBlockCompressor.h"
+
+#include <string.h>
+
+#include <floral/math/utils.h>
+
+#include "Graphics/stb_dxt.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DXT_SIMD_SSE
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define DXT_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+namespace dxt
+{
+// ------------------------------------------------------------------
+
+// spreads the 4 low bits to the even bits of a byte
+static const u8									k_Spread4[16] = {
+	0x00, 0x01, 0x04, 0x05, 0x10, 0x11, 0x14, 0x15,
+	0x40, 0x41, 0x44, 0x45, 0x50, 0x51, 0x54, 0x55
+};
+
+// ------------------------------------------------------------------
+
+const size GetDXTCompressedSize(const s32 i_width, const s32 i_height, const s32 i_numChannels)
+{
+	const size blocksCount = (size)((i_width + 3) / 4) * ((i_height + 3) / 4);
+	return blocksCount * (i_numChannels == 4 ? 16 : 8);
+}
+
+// 4x4 rgba block, missing channels are 0 (alpha 255) and pixels outside of the image are 0
+static inline void GatherBlock(const u8* i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+		const s32 i_x, const s32 i_y, u8* o_block)
+{
+	if (i_numChannels == 4 && i_x + 4 <= i_width && i_y + 4 <= i_height)
+	{
+		for (s32 row = 0; row < 4; row++)
+		{
+			const u8* src = &i_input[((i_y + row) * i_width + i_x) * 4];
+#if defined(DXT_SIMD_SSE)
+			_mm_store_si128((__m128i*)&o_block[row * 16], _mm_loadu_si128((const __m128i*)src));
+#elif defined(DXT_SIMD_NEON)
+			vst1q_u8(&o_block[row * 16], vld1q_u8(src));
+#else
+			memcpy(&o_block[row * 16], src, 16);
+#endif
+		}
+		return;
+	}
+
+	memset(o_block, 0, 64);
+	for (s32 py = 0; py < 4; py++)
+	{
+		for (s32 px = 0; px < 4; px++)
+		{
+			const s32 ix = i_x + px;
+			const s32 iy = i_y + py;
+			if (ix < i_width && iy < i_height)
+			{
+				const u8* sourcePixel = &i_input[(iy * i_width + ix) * i_numChannels];
+				u8* targetPixel = &o_block[(py * 4 + px) * 4];
+				targetPixel[3] = 255;
+				for (s32 i = 0; i < i_numChannels; i++)
+				{
+					targetPixel[i] = sourcePixel[i];
+				}
+			}
+		}
+	}
+}
+
+// ------------------------------------------------------------------
+
+// same rounding as stb_dxt
+static inline const s32 Mul8Bit(const s32 i_a, const s32 i_b)
+{
+	const s32 t = i_a * i_b + 128;
+	return (t + (t >> 8)) >> 8;
+}
+
+static inline const u16 As565(const s32 i_r, const s32 i_g, const s32 i_b)
+{
+	return (u16)((Mul8Bit(i_r, 31) << 11) + (Mul8Bit(i_g, 63) << 5) + Mul8Bit(i_b, 31));
+}
+
+static inline void From565(const u16 i_color, s32* o_rgb)
+{
+	const s32 r = (i_color >> 11) & 31;
+	const s32 g = (i_color >> 5) & 63;
+	const s32 b = i_color & 31;
+	o_rgb[0] = (r << 3) | (r >> 2);
+	o_rgb[1] = (g << 2) | (g >> 4);
+	o_rgb[2] = (b << 3) | (b >> 2);
+}
+
+static inline void GetMinMaxColors(const u8* i_block, u8* o_minColor, u8* o_maxColor)
+{
+#if defined(DXT_SIMD_SSE)
+	const __m128i p0 = _mm_load_si128((const __m128i*)&i_block[0]);
+	const __m128i p1 = _mm_load_si128((const __m128i*)&i_block[16]);
+	const __m128i p2 = _mm_load_si128((const __m128i*)&i_block[32]);
+	const __m128i p3 = _mm_load_si128((const __m128i*)&i_block[48]);
+	__m128i mn = _mm_min_epu8(_mm_min_epu8(p0, p1), _mm_min_epu8(p2, p3));
+	__m128i mx = _mm_max_epu8(_mm_max_epu8(p0, p1), _mm_max_epu8(p2, p3));
+	mn = _mm_min_epu8(mn, _mm_shuffle_epi32(mn, _MM_SHUFFLE(1, 0, 3, 2)));
+	mx = _mm_max_epu8(mx, _mm_shuffle_epi32(mx, _MM_SHUFFLE(1, 0, 3, 2)));
+	mn = _mm_min_epu8(mn, _mm_shuffle_epi32(mn, _MM_SHUFFLE(2, 3, 0, 1)));
+	mx = _mm_max_epu8(mx, _mm_shuffle_epi32(mx, _MM_SHUFFLE(2, 3, 0, 1)));
+	const s32 minRGBA = _mm_cvtsi128_si32(mn);
+	const s32 maxRGBA = _mm_cvtsi128_si32(mx);
+	memcpy(o_minColor, &minRGBA, 4);
+	memcpy(o_maxColor, &maxRGBA, 4);
+#elif defined(DXT_SIMD_NEON)
+	const uint8x16_t p0 = vld1q_u8(&i_block[0]);
+	const uint8x16_t p1 = vld1q_u8(&i_block[16]);
+	const uint8x16_t p2 = vld1q_u8(&i_block[32]);
+	const uint8x16_t p3 = vld1q_u8(&i_block[48]);
+	const uint8x16_t mn16 = vminq_u8(vminq_u8(p0, p1), vminq_u8(p2, p3));
+	const uint8x16_t mx16 = vmaxq_u8(vmaxq_u8(p0, p1), vmaxq_u8(p2, p3));
+	uint8x8_t mn = vmin_u8(vget_low_u8(mn16), vget_high_u8(mn16));
+	uint8x8_t mx = vmax_u8(vget_low_u8(mx16), vget_high_u8(mx16));
+	mn = vmin_u8(mn, vreinterpret_u8_u32(vrev64_u32(vreinterpret_u32_u8(mn))));
+	mx = vmax_u8(mx, vreinterpret_u8_u32(vrev64_u32(vreinterpret_u32_u8(mx))));
+	vst1_lane_u32((u32*)o_minColor, vreinterpret_u32_u8(mn), 0);
+	vst1_lane_u32((u32*)o_maxColor, vreinterpret_u32_u8(mx), 0);
+#else
+	for (s32 c = 0; c < 4; c++)
+	{
+		o_minColor[c] = 255;
+		o_maxColor[c] = 0;
+	}
+	for (s32 i = 0; i < 16; i++)
+	{
+		for (s32 c = 0; c < 4; c++)
+		{
+			o_minColor[c] = floral::min(o_minColor[c], i_block[i * 4 + c]);
+			o_maxColor[c] = floral::max(o_maxColor[c], i_block[i * 4 + c]);
+		}
+	}
+#endif
+}
+
+/*
+ * Projects the pixels on the line between the 2 end colors and picks the closest of the 4 palette
+ * entries (same selection as stb__MatchColorsBlock).
+ * i_colors[0] > i_colors[2] > i_colors[3] > i_colors[1] along the line
+ */
+static inline const u32 MatchColorsBlock(const u8* i_block, const s32 i_colors[4][3])
+{
+	const s32 dirR = i_colors[0][0] - i_colors[1][0];
+	const s32 dirG = i_colors[0][1] - i_colors[1][1];
+	const s32 dirB = i_colors[0][2] - i_colors[1][2];
+
+	s32 stops[4];
+	for (s32 i = 0; i < 4; i++)
+	{
+		stops[i] = i_colors[i][0] * dirR + i_colors[i][1] * dirG + i_colors[i][2] * dirB;
+	}
+
+	const s32 c0Point = (stops[1] + stops[3]) >> 1;
+	const s32 halfPoint = (stops[3] + stops[2]) >> 1;
+	const s32 c3Point = (stops[2] + stops[0]) >> 1;
+
+	// index bit 0 is (dot < halfPoint), bit 1 is (c0Point <= dot < c3Point)
+	u32 mask = 0;
+#if defined(DXT_SIMD_SSE)
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i dir = _mm_setr_epi16((s16)dirR, (s16)dirG, (s16)dirB, 0, (s16)dirR, (s16)dirG, (s16)dirB, 0);
+	const __m128i c0 = _mm_set1_epi32(c0Point);
+	const __m128i half = _mm_set1_epi32(halfPoint);
+	const __m128i c3 = _mm_set1_epi32(c3Point);
+	for (s32 row = 0; row < 4; row++)
+	{
+		const __m128i p = _mm_load_si128((const __m128i*)&i_block[row * 16]);
+		// [rg0, ba0, rg1, ba1] and [rg2, ba2, rg3, ba3]
+		const __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(p, zero), dir);
+		const __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(p, zero), dir);
+		const __m128i rg = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0)));
+		const __m128i ba = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1)));
+		const __m128i dot = _mm_add_epi32(rg, ba);
+
+		const s32 bit0 = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(dot, half)));
+		const s32 bit1 = _mm_movemask_ps(_mm_castsi128_ps(_mm_xor_si128(_mm_cmplt_epi32(dot, c3), _mm_cmplt_epi32(dot, c0))));
+		mask |= (u32)(k_Spread4[bit0] | (k_Spread4[bit1] << 1)) << (row * 8);
+	}
+#elif defined(DXT_SIMD_NEON)
+	static const u32 k_LaneBits[4] = { 1, 2, 4, 8 };
+	const int16x4_t dir = { (s16)dirR, (s16)dirG, (s16)dirB, 0 };
+	const int32x4_t c0 = vdupq_n_s32(c0Point);
+	const int32x4_t half = vdupq_n_s32(halfPoint);
+	const int32x4_t c3 = vdupq_n_s32(c3Point);
+	const uint32x4_t laneBits = vld1q_u32(k_LaneBits);
+	for (s32 row = 0; row < 4; row++)
+	{
+		const uint8x16_t p = vld1q_u8(&i_block[row * 16]);
+		const int16x8_t lo = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(p)));
+		const int16x8_t hi = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(p)));
+		const int32x4_t d0 = vmull_s16(vget_low_s16(lo), dir);
+		const int32x4_t d1 = vmull_s16(vget_high_s16(lo), dir);
+		const int32x4_t d2 = vmull_s16(vget_low_s16(hi), dir);
+		const int32x4_t d3 = vmull_s16(vget_high_s16(hi), dir);
+		const int32x2_t s01 = vpadd_s32(vadd_s32(vget_low_s32(d0), vget_high_s32(d0)), vadd_s32(vget_low_s32(d1), vget_high_s32(d1)));
+		const int32x2_t s23 = vpadd_s32(vadd_s32(vget_low_s32(d2), vget_high_s32(d2)), vadd_s32(vget_low_s32(d3), vget_high_s32(d3)));
+		const int32x4_t dot = vcombine_s32(s01, s23);
+
+		const uint32x4_t b0 = vandq_u32(vcltq_s32(dot, half), laneBits);
+		const uint32x4_t b1 = vandq_u32(veorq_u32(vcltq_s32(dot, c3), vcltq_s32(dot, c0)), laneBits);
+		const uint32x2_t r0 = vorr_u32(vget_low_u32(b0), vget_high_u32(b0));
+		const uint32x2_t r1 = vorr_u32(vget_low_u32(b1), vget_high_u32(b1));
+		const u32 bit0 = vget_lane_u32(r0, 0) | vget_lane_u32(r0, 1);
+		const u32 bit1 = vget_lane_u32(r1, 0) | vget_lane_u32(r1, 1);
+		mask |= (u32)(k_Spread4[bit0] | (k_Spread4[bit1] << 1)) << (row * 8);
+	}
+#else
+	for (s32 i = 0; i < 16; i++)
+	{
+		const u8* p = &i_block[i * 4];
+		const s32 dot = p[0] * dirR + p[1] * dirG + p[2] * dirB;
+		const u32 bit0 = dot < halfPoint ? 1 : 0;
+		const u32 bit1 = (dot >= c0Point && dot < c3Point) ? 1 : 0;
+		mask |= (bit0 | (bit1 << 1)) << (i * 2);
+	}
+#endif
+	return mask;
+}
+
+static void EncodeColorBlockFast(const u8* i_block, const u8* i_minColor, const u8* i_maxColor, p8 o_dest)
+{
+	// inset the bounding box by 1/16 of its size to move the end points away from outliers
+	s32 minColor[3], maxColor[3];
+	for (s32 c = 0; c < 3; c++)
+	{
+		const s32 inset = (i_maxColor[c] - i_minColor[c]) >> 4;
+		minColor[c] = i_minColor[c] + inset;
+		maxColor[c] = i_maxColor[c] - inset;
+	}
+
+	u16 color0 = As565(maxColor[0], maxColor[1], maxColor[2]);
+	u16 color1 = As565(minColor[0], minColor[1], minColor[2]);
+	u32 mask = 0;
+	if (color0 != color1)
+	{
+		// 4 colors mode needs color0 > color1
+		if (color0 < color1)
+		{
+			const u16 tmp = color0;
+			color0 = color1;
+			color1 = tmp;
+		}
+
+		s32 colors[4][3];
+		From565(color0, colors[0]);
+		From565(color1, colors[1]);
+		for (s32 c = 0; c < 3; c++)
+		{
+			colors[2][c] = (2 * colors[0][c] + colors[1][c]) / 3;
+			colors[3][c] = (colors[0][c] + 2 * colors[1][c]) / 3;
+		}
+		mask = MatchColorsBlock(i_block, colors);
+	}
+
+	o_dest[0] = (u8)(color0 & 0xff);
+	o_dest[1] = (u8)(color0 >> 8);
+	o_dest[2] = (u8)(color1 & 0xff);
+	o_dest[3] = (u8)(color1 >> 8);
+	o_dest[4] = (u8)(mask & 0xff);
+	o_dest[5] = (u8)((mask >> 8) & 0xff);
+	o_dest[6] = (u8)((mask >> 16) & 0xff);
+	o_dest[7] = (u8)(mask >> 24);
+}
+
+static void EncodeAlphaBlockFast(const u8* i_block, const u8 i_minAlpha, const u8 i_maxAlpha, p8 o_dest)
+{
+	// alpha0 > alpha1: 8 alphas mode, index 0 = alpha0, 1 = alpha1, 2..7 = interpolated from alpha0 to alpha1
+	o_dest[0] = i_maxAlpha;
+	o_dest[1] = i_minAlpha;
+
+	u64 bits = 0;
+	if (i_maxAlpha > i_minAlpha)
+	{
+		const s32 range = i_maxAlpha - i_minAlpha;
+		for (s32 i = 0; i < 16; i++)
+		{
+			// 0 .. 7 from alpha1 to alpha0
+			const s32 t = ((i_block[i * 4 + 3] - i_minAlpha) * 14 + range) / (2 * range);
+			const u64 index = (t == 7) ? 0 : ((t == 0) ? 1 : (8 - t));
+			bits |= index << (i * 3);
+		}
+	}
+
+	for (s32 i = 0; i < 6; i++)
+	{
+		o_dest[2 + i] = (u8)((bits >> (i * 8)) & 0xff);
+	}
+}
+
+void CompressDXTBlockRows(const u8* i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+		const DXTQuality i_quality, const s32 i_firstRow, const s32 i_lastRow, p8 o_output)
+{
+	const s32 blocksX = (i_width + 3) / 4;
+	const s32 bytesPerBlock = (i_numChannels == 4) ? 16 : 8;
+	const s32 hasAlpha = (i_numChannels == 4) ? 1 : 0;
+	const s32 stbMode = (i_quality == DXTQuality::High) ? STB_DXT_HIGHQUAL : STB_DXT_NORMAL;
+
+#if defined(_MSC_VER)
+	__declspec(align(16)) u8 block[64];
+#else
+	u8 block[64] __attribute__((aligned(16)));
+#endif
+
+	for (s32 by = i_firstRow; by < i_lastRow; by++)
+	{
+		p8 targetBlock = o_output + (size)by * blocksX * bytesPerBlock;
+		for (s32 bx = 0; bx < blocksX; bx++)
+		{
+			GatherBlock(i_input, i_width, i_height, i_numChannels, bx * 4, by * 4, block);
+
+			if (i_quality == DXTQuality::Fast)
+			{
+				u8 minColor[4], maxColor[4];
+				GetMinMaxColors(block, minColor, maxColor);
+				if (hasAlpha)
+				{
+					EncodeAlphaBlockFast(block, minColor[3], maxColor[3], targetBlock);
+					EncodeColorBlockFast(block, minColor, maxColor, targetBlock + 8);
+				}
+				else
+				{
+					EncodeColorBlockFast(block, minColor, maxColor, targetBlock);
+				}
+			}
+			else
+			{
+				stb_compress_dxt_block(targetBlock, block, hasAlpha, stbMode);
+			}
+
+			targetBlock += bytesPerBlock;
+		}
+	}
+}
+
+// ------------------------------------------------------------------
+
+static void DecodeColorBlock(const u8* i_block, const bool i_fourColorsOnly, u8 o_rgba[16][4])
+{
+	const u16 color0 = i_block[0] | (i_block[1] << 8);
+	const u16 color1 = i_block[2] | (i_block[3] << 8);
+	s32 colors[4][4];
+	From565(color0, colors[0]);
+	From565(color1, colors[1]);
+	colors[0][3] = 255;
+	colors[1][3] = 255;
+	if (color0 > color1 || i_fourColorsOnly)
+	{
+		for (s32 c = 0; c < 3; c++)
+		{
+			colors[2][c] = (2 * colors[0][c] + colors[1][c]) / 3;
+			colors[3][c] = (colors[0][c] + 2 * colors[1][c]) / 3;
+		}
+		colors[2][3] = 255;
+		colors[3][3] = 255;
+	}
+	else
+	{
+		for (s32 c = 0; c < 3; c++)
+		{
+			colors[2][c] = (colors[0][c] + colors[1][c]) / 2;
+			colors[3][c] = 0;
+		}
+		colors[2][3] = 255;
+		colors[3][3] = 0;
+	}
+
+	const u32 mask = i_block[4] | (i_block[5] << 8) | (i_block[6] << 16) | ((u32)i_block[7] << 24);
+	for (s32 i = 0; i < 16; i++)
+	{
+		const u32 index = (mask >> (i * 2)) & 3;
+		for (s32 c = 0; c < 4; c++)
+		{
+			o_rgba[i][c] = (u8)colors[index][c];
+		}
+	}
+}
+
+static void DecodeAlphaBlock(const u8* i_block, u8 o_rgba[16][4])
+{
+	s32 alphas[8];
+	alphas[0] = i_block[0];
+	alphas[1] = i_block[1];
+	if (alphas[0] > alphas[1])
+	{
+		for (s32 i = 2; i < 8; i++)
+		{
+			alphas[i] = ((8 - i) * alphas[0] + (i - 1) * alphas[1]) / 7;
+		}
+	}
+	else
+	{
+		for (s32 i = 2; i < 6; i++)
+		{
+			alphas[i] = ((6 - i) * alphas[0] + (i - 1) * alphas[1]) / 5;
+		}
+		alphas[6] = 0;
+		alphas[7] = 255;
+	}
+
+	u64 bits = 0;
+	for (s32 i = 0; i < 6; i++)
+	{
+		bits |= (u64)i_block[2 + i] << (i * 8);
+	}
+	for (s32 i = 0; i < 16; i++)
+	{
+		o_rgba[i][3] = (u8)alphas[(bits >> (i * 3)) & 7];
+	}
+}
+
+void DecompressDXTImage(const u8* i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels, p8 o_rgba)
+{
+	const s32 blocksX = (i_width + 3) / 4;
+	const s32 blocksY = (i_height + 3) / 4;
+	const bool hasAlpha = (i_numChannels == 4);
+	const u8* block = i_input;
+	for (s32 by = 0; by < blocksY; by++)
+	{
+		for (s32 bx = 0; bx < blocksX; bx++)
+		{
+			u8 rgba[16][4];
+			if (hasAlpha)
+			{
+				DecodeColorBlock(block + 8, true, rgba);
+				DecodeAlphaBlock(block, rgba);
+				block += 16;
+			}
+			else
+			{
+				DecodeColorBlock(block, false, rgba);
+				block += 8;
+			}
+
+			for (s32 py = 0; py < 4; py++)
+			{
+				for (s32 px = 0; px < 4; px++)
+				{
+					const s32 x = bx * 4 + px;
+					const s32 y = by * 4 + py;
+					if (x < i_width && y < i_height)
+					{
+						memcpy(&o_rgba[(y * i_width + x) * 4], rgba[py * 4 + px], 4);
+					}
+				}
+			}
+		}
+	}
+}
+
+// ------------------------------------------------------------------
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+
+namespace dxt
+{
+// ------------------------------------------------------------------
+
+/*
+ * DXT block encoder and decoder, no threading and no engine dependencies so texturebaker builds
+ * the same file.
+ * - Fast: bounding box endpoints + projection, SSE2 / NEON
+ * - Normal: stb_dxt (pca + 1 refinement)
+ * - High: stb_dxt STB_DXT_HIGHQUAL (pca + 2 refinements)
+ * 4 channels input is encoded as dxt5, everything else as dxt1
+ */
+enum class DXTQuality
+{
+	Fast = 0,
+	Normal,
+	High
+};
+
+const size										GetDXTCompressedSize(const s32 i_width, const s32 i_height, const s32 i_numChannels);
+
+/*
+ * Block rows [i_firstRow, i_lastRow) of the image, o_output is the first block of the whole image.
+ * stb_dxt builds its lookup tables on its first call, which is not thread safe: compress one block
+ * on a single thread before spreading the rows over several ones.
+ */
+void											CompressDXTBlockRows(const u8* i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+													const DXTQuality i_quality, const s32 i_firstRow, const s32 i_lastRow, p8 o_output);
+
+// o_rgba: i_width * i_height * 4 bytes
+void											DecompressDXTImage(const u8* i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels, p8 o_rgba);
+
+// ------------------------------------------------------------------
+}
@@ -0,0 +1,92 @@
+#include "DXTCompressor.h"
+
+#include <string.h>
+
+#include <atomic>
+
+#include <floral/assert/assert.h>
+#include <floral/math/utils.h>
+
+#include <refrain2.h>
+
+#include "Graphics/stb_dxt.h"
+
+namespace dxt
+{
+// ------------------------------------------------------------------
+
+static const s32								k_BlockRowsPerTask = 4;
+static const u32								k_MaxTasks = 256;
+
+// ------------------------------------------------------------------
+
+struct CompressTaskData
+{
+	const u8*									input;
+	s32											width;
+	s32											height;
+	s32											numChannels;
+	DXTQuality									quality;
+	s32											firstRow;
+	s32											lastRow;
+	p8											output;
+};
+
+static refrain2::Task CompressBlockRowsTask(voidptr i_data)
+{
+	CompressTaskData* data = (CompressTaskData*)i_data;
+	CompressDXTBlockRows(data->input, data->width, data->height, data->numChannels, data->quality,
+			data->firstRow, data->lastRow, data->output);
+	return refrain2::Task();
+}
+
+static const bool WarmUpSTBDXT()
+{
+	u8 block[64];
+	u8 compressedBlock[16];
+	memset(block, 0, sizeof(block));
+	stb_compress_dxt_block(compressedBlock, block, 1, STB_DXT_HIGHQUAL);
+	return true;
+}
+
+void CompressDXTImage(const u8* i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+		const DXTQuality i_quality, p8 o_output)
+{
+	// stb_dxt builds its lookup tables on the first call, which is not thread safe
+	static const bool s_stbInitialized = WarmUpSTBDXT();
+	FLORAL_ASSERT(s_stbInitialized);
+
+	const s32 rowsCount = (i_height + 3) / 4;
+	const s32 rowsPerTask = floral::max(k_BlockRowsPerTask, (rowsCount + (s32)k_MaxTasks - 1) / (s32)k_MaxTasks);
+	const u32 tasksCount = (rowsCount + rowsPerTask - 1) / rowsPerTask;
+	if (tasksCount <= 1)
+	{
+		CompressDXTBlockRows(i_input, i_width, i_height, i_numChannels, i_quality, 0, rowsCount, o_output);
+		return;
+	}
+
+	CompressTaskData taskData[k_MaxTasks];
+	std::atomic<u32> counter(tasksCount);
+	for (u32 i = 0; i < tasksCount; i++)
+	{
+		CompressTaskData& data = taskData[i];
+		data.input = i_input;
+		data.width = i_width;
+		data.height = i_height;
+		data.numChannels = i_numChannels;
+		data.quality = i_quality;
+		data.firstRow = i * rowsPerTask;
+		data.lastRow = floral::min(data.firstRow + rowsPerTask, rowsCount);
+		data.output = o_output;
+
+		refrain2::Task newTask;
+		newTask.pm_Instruction = &CompressBlockRowsTask;
+		newTask.pm_Data = &data;
+		newTask.pm_Counter = &counter;
+		refrain2::g_TaskManager->PushTask(newTask);
+	}
+	refrain2::BusyWaitForCounter(counter, 0);
+}
+
+// ------------------------------------------------------------------
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+
+#include "Graphics/DXTBlockCompressor.h"
+
+namespace dxt
+{
+// ------------------------------------------------------------------
+
+// every few block rows is a refrain2 task, blocks until all of them are done
+void											CompressDXTImage(const u8* i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+													const DXTQuality i_quality, p8 o_output);
+
+// ------------------------------------------------------------------
+}
@@ -0,0 +1,75 @@
+#include "FileMapping.h"
+
+#if defined(FLORAL_PLATFORM_WINDOWS)
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace file_mapping
+{
+// ----------------------------------------------------------------------------
+
+voidptr MapFile(const_cstr i_path, size* o_size, const bool i_willReadAll /* = true */)
+{
+#if defined(FLORAL_PLATFORM_WINDOWS)
+	const DWORD accessHint = i_willReadAll ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
+	HANDLE file = CreateFileA(i_path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, accessHint, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return nullptr;
+	}
+	LARGE_INTEGER fileSize;
+	GetFileSizeEx(file, &fileSize);
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (mapping == nullptr)
+	{
+		return nullptr;
+	}
+	// the view keeps the mapping alive
+	voidptr data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	*o_size = (size)fileSize.QuadPart;
+	return data;
+#else
+	const s32 fd = open(i_path, O_RDONLY);
+	if (fd < 0)
+	{
+		return nullptr;
+	}
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0)
+	{
+		close(fd);
+		return nullptr;
+	}
+	voidptr data = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		return nullptr;
+	}
+	if (i_willReadAll)
+	{
+		madvise(data, (size_t)fileStat.st_size, MADV_WILLNEED);
+	}
+	*o_size = (size)fileStat.st_size;
+	return data;
+#endif
+}
+
+void UnmapFile(voidptr i_data, const size i_size)
+{
+#if defined(FLORAL_PLATFORM_WINDOWS)
+	UnmapViewOfFile(i_data);
+#else
+	munmap(i_data, (size_t)i_size);
+#endif
+}
+
+// ----------------------------------------------------------------------------
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+
+namespace file_mapping
+{
+// ----------------------------------------------------------------------------
+
+// read only mapping of a whole file, nullptr on failure. i_willReadAll false when only a few parts of it are read
+voidptr											MapFile(const_cstr i_path, size* o_size, const bool i_willReadAll = true);
+void											UnmapFile(voidptr i_data, const size i_size);
+
+// ----------------------------------------------------------------------------
+}
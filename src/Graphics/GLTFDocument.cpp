@@ -0,0 +1,636 @@
+#include "GLTFDocument.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <floral/assert/assert.h>
+
+namespace gltf_loader
+{
+// ----------------------------------------------------------------------------
+
+static const u32								k_GLBMagic = 0x46546C67;	// "glTF"
+static const u32								k_GLBVersion = 2;
+static const u32								k_GLBChunkJSON = 0x4E4F534A;
+static const u32								k_GLBChunkBIN = 0x004E4942;
+
+static inline const u32 ReadU32(const u8* i_data)
+{
+	// glb is little endian, so are the hosts
+	u32 value;
+	memcpy(&value, i_data, sizeof(u32));
+	return value;
+}
+
+static const JsonValue							k_InvalidValue = { nullptr, nullptr };
+
+static inline const c8* SkipSpaces(const c8* i_cursor, const c8* i_end)
+{
+	while (i_cursor < i_end && (*i_cursor == ' ' || *i_cursor == '\n' || *i_cursor == '\r' || *i_cursor == '\t'))
+	{
+		i_cursor++;
+	}
+	return i_cursor;
+}
+
+// i_cursor is on the opening quote, returns past the closing one or nullptr
+static const c8* SkipString(const c8* i_cursor, const c8* i_end)
+{
+	const c8* p = i_cursor + 1;
+	while (p < i_end)
+	{
+		if (*p == '\\')
+		{
+			p += 2;
+			continue;
+		}
+		if (*p == '"')
+		{
+			return p + 1;
+		}
+		p++;
+	}
+	return nullptr;
+}
+
+// returns past the value which starts at i_cursor or nullptr
+static const c8* SkipValue(const c8* i_cursor, const c8* i_end)
+{
+	if (i_cursor >= i_end)
+	{
+		return nullptr;
+	}
+
+	if (*i_cursor == '"')
+	{
+		return SkipString(i_cursor, i_end);
+	}
+
+	if (*i_cursor == '{' || *i_cursor == '[')
+	{
+		// the brackets are not matched against each other, the document is expected to be valid json
+		s32 depth = 0;
+		const c8* p = i_cursor;
+		while (p < i_end)
+		{
+			const c8 c = *p;
+			if (c == '"')
+			{
+				p = SkipString(p, i_end);
+				if (p == nullptr)
+				{
+					return nullptr;
+				}
+				continue;
+			}
+
+			if (c == '{' || c == '[')
+			{
+				depth++;
+			}
+			else if (c == '}' || c == ']')
+			{
+				depth--;
+				if (depth == 0)
+				{
+					return p + 1;
+				}
+			}
+			p++;
+		}
+		return nullptr;
+	}
+
+	// number, true, false or null
+	const c8* p = i_cursor;
+	while (p < i_end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t')
+	{
+		p++;
+	}
+	return p > i_cursor ? p : nullptr;
+}
+
+static inline const ElementType GetElementType(const JsonValue& i_value)
+{
+	static const_cstr k_Names[] = { "SCALAR", "VEC2", "VEC3", "VEC4", "MAT2", "MAT3", "MAT4" };
+	for (u32 i = 0; i < 7; i++)
+	{
+		if (json::Equals(i_value, k_Names[i]))
+		{
+			return ElementType(i + 1);
+		}
+	}
+	return ElementType::Invalid;
+}
+
+static inline const u32 GetComponentSize(const ComponentType i_type)
+{
+	switch (i_type)
+	{
+	case ComponentType::Byte:
+	case ComponentType::UnsignedByte:
+		return 1;
+	case ComponentType::Short:
+	case ComponentType::UnsignedShort:
+		return 2;
+	case ComponentType::UnsignedInt:
+	case ComponentType::Float:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+static inline const u32 GetComponentsCount(const ElementType i_type)
+{
+	static const u32 k_Counts[] = { 0, 1, 2, 3, 4, 4, 9, 16 };
+	return k_Counts[(u32)i_type];
+}
+
+// ----------------------------------------------------------------------------
+
+const bool IsGLB(const u8* i_data, const size i_size)
+{
+	return i_size >= 12 && ReadU32(i_data) == k_GLBMagic;
+}
+
+const bool ParseGLB(const u8* i_data, const size i_size, const c8** o_json, size* o_jsonSize, const u8** o_bin, size* o_binSize)
+{
+	*o_bin = nullptr;
+	*o_binSize = 0;
+	if (!IsGLB(i_data, i_size) || ReadU32(i_data + 4) != k_GLBVersion)
+	{
+		return false;
+	}
+
+	const size length = ReadU32(i_data + 8);
+	if (length > i_size)
+	{
+		return false;
+	}
+
+	// the JSON chunk is always first, the BIN chunk, if any, is right after it
+	size offset = 12;
+	if (offset + 8 > length || ReadU32(i_data + offset + 4) != k_GLBChunkJSON)
+	{
+		return false;
+	}
+	const size jsonSize = ReadU32(i_data + offset);
+	if (offset + 8 + jsonSize > length)
+	{
+		return false;
+	}
+	*o_json = (const c8*)(i_data + offset + 8);
+	*o_jsonSize = jsonSize;
+	offset += 8 + ((jsonSize + 3) & ~(size)3);
+
+	if (offset + 8 <= length && ReadU32(i_data + offset + 4) == k_GLBChunkBIN)
+	{
+		const size binSize = ReadU32(i_data + offset);
+		if (offset + 8 + binSize > length)
+		{
+			return false;
+		}
+		*o_bin = i_data + offset + 8;
+		*o_binSize = binSize;
+	}
+	return true;
+}
+
+const bool ParseDocument(const c8* i_json, const size i_jsonSize, Document* o_document)
+{
+	memset(o_document, 0, sizeof(Document));
+	const c8* end = i_json + i_jsonSize;
+	const c8* begin = SkipSpaces(i_json, end);
+	// utf-8 BOM
+	if (end - begin >= 3 && (u8)begin[0] == 0xEF && (u8)begin[1] == 0xBB && (u8)begin[2] == 0xBF)
+	{
+		begin = SkipSpaces(begin + 3, end);
+	}
+
+	if (begin >= end || *begin != '{')
+	{
+		return false;
+	}
+
+	const c8* rootEnd = SkipValue(begin, end);
+	if (rootEnd == nullptr)
+	{
+		return false;
+	}
+
+	o_document->root.begin = begin;
+	o_document->root.end = rootEnd;
+	o_document->accessors = json::FindMember(o_document->root, "accessors");
+	o_document->bufferViews = json::FindMember(o_document->root, "bufferViews");
+	o_document->buffers = json::FindMember(o_document->root, "buffers");
+	return true;
+}
+
+void IndexDocument(Document* io_document, JsonValue* o_accessors, JsonValue* o_bufferViews)
+{
+	io_document->accessorsCount = json::GetArrayElements(io_document->accessors, o_accessors, GetAccessorsCount(*io_document));
+	io_document->accessorsTable = o_accessors;
+	io_document->bufferViewsCount = json::GetArrayElements(io_document->bufferViews, o_bufferViews, GetBufferViewsCount(*io_document));
+	io_document->bufferViewsTable = o_bufferViews;
+}
+
+const u32 GetAccessorsCount(const Document& i_document)
+{
+	return i_document.accessorsTable ? i_document.accessorsCount : json::GetArraySize(i_document.accessors);
+}
+
+const u32 GetBufferViewsCount(const Document& i_document)
+{
+	return i_document.bufferViewsTable ? i_document.bufferViewsCount : json::GetArraySize(i_document.bufferViews);
+}
+
+const bool GetBufferUri(const Document& i_document, const u32 i_bufferIdx, c8* o_uri, const size i_capacity)
+{
+	const JsonValue uri = json::FindMember(json::GetElement(i_document.buffers, i_bufferIdx), "uri");
+	if (!json::ToString(uri, o_uri, i_capacity))
+	{
+		return false;
+	}
+	return strncmp(o_uri, "data:", 5) != 0;
+}
+
+const bool GetAccessorView(const Document& i_document, const u32 i_accessorIdx, AccessorView* o_view)
+{
+	JsonValue accessor = k_InvalidValue;
+	if (i_document.accessorsTable)
+	{
+		if (i_accessorIdx < i_document.accessorsCount)
+		{
+			accessor = i_document.accessorsTable[i_accessorIdx];
+		}
+	}
+	else
+	{
+		accessor = json::GetElement(i_document.accessors, i_accessorIdx);
+	}
+
+	// no sparse accessors nor the ones without a buffer view, which are all zeros
+	const s64 bufferViewIdx = json::ToInt(json::FindMember(accessor, "bufferView"), -1);
+	if (bufferViewIdx < 0 || json::IsValid(json::FindMember(accessor, "sparse")))
+	{
+		return false;
+	}
+
+	JsonValue bufferView = k_InvalidValue;
+	if (i_document.bufferViewsTable)
+	{
+		if ((u64)bufferViewIdx < i_document.bufferViewsCount)
+		{
+			bufferView = i_document.bufferViewsTable[bufferViewIdx];
+		}
+	}
+	else
+	{
+		bufferView = json::GetElement(i_document.bufferViews, (u32)bufferViewIdx);
+	}
+
+	if (json::ToInt(json::FindMember(bufferView, "buffer"), -1) != 0)
+	{
+		return false;
+	}
+
+	const ComponentType componentType = (ComponentType)json::ToInt(json::FindMember(accessor, "componentType"), 0);
+	const ElementType elementType = GetElementType(json::FindMember(accessor, "type"));
+	const u32 elementSize = GetComponentSize(componentType) * GetComponentsCount(elementType);
+	if (elementSize == 0)
+	{
+		return false;
+	}
+
+	const s64 count = json::ToInt(json::FindMember(accessor, "count"), -1);
+	const s64 accessorOffset = json::ToInt(json::FindMember(accessor, "byteOffset"), 0);
+	const s64 viewOffset = json::ToInt(json::FindMember(bufferView, "byteOffset"), 0);
+	const s64 viewLength = json::ToInt(json::FindMember(bufferView, "byteLength"), -1);
+	const s64 stride = json::ToInt(json::FindMember(bufferView, "byteStride"), elementSize);
+	if (count < 0 || accessorOffset < 0 || viewOffset < 0 || viewLength < 0 || stride < (s64)elementSize
+		|| (u64)(viewOffset + viewLength) > (u64)i_document.binSize)
+	{
+		return false;
+	}
+
+	if (count > 0 && accessorOffset + (count - 1) * stride + elementSize > viewLength)
+	{
+		return false;
+	}
+
+	o_view->data = i_document.bin + viewOffset + accessorOffset;
+	o_view->count = (u32)count;
+	o_view->stride = (u32)stride;
+	o_view->elementSize = elementSize;
+	o_view->componentType = componentType;
+	o_view->elementType = elementType;
+	return true;
+}
+
+const bool IsPacked(const AccessorView& i_view)
+{
+	return i_view.stride == i_view.elementSize;
+}
+
+void CopyAccessor(const AccessorView& i_view, const size i_elementSize, voidptr o_data, const size i_stride)
+{
+	FLORAL_ASSERT(i_elementSize <= i_view.elementSize);
+	if (IsPacked(i_view) && i_elementSize == i_view.elementSize && i_stride == i_elementSize)
+	{
+		memcpy(o_data, i_view.data, (size)i_view.count * i_elementSize);
+		return;
+	}
+
+	p8 dst = (p8)o_data;
+	const u8* src = i_view.data;
+	for (u32 i = 0; i < i_view.count; i++)
+	{
+		memcpy(dst, src, i_elementSize);
+		dst += i_stride;
+		src += i_view.stride;
+	}
+}
+
+void CopyIndices(const AccessorView& i_view, s32* o_indices)
+{
+	FLORAL_ASSERT(i_view.elementType == ElementType::Scalar);
+	switch (i_view.componentType)
+	{
+	case ComponentType::UnsignedInt:
+		CopyAccessor(i_view, sizeof(u32), o_indices, sizeof(s32));
+		break;
+	case ComponentType::UnsignedShort:
+	{
+		const u8* src = i_view.data;
+		for (u32 i = 0; i < i_view.count; i++)
+		{
+			u16 index;
+			memcpy(&index, src, sizeof(u16));
+			o_indices[i] = (s32)index;
+			src += i_view.stride;
+		}
+		break;
+	}
+	case ComponentType::UnsignedByte:
+		for (u32 i = 0; i < i_view.count; i++)
+		{
+			o_indices[i] = (s32)i_view.data[i * i_view.stride];
+		}
+		break;
+	default:
+		FLORAL_ASSERT_MSG(false, "Invalid index component type");
+		break;
+	}
+}
+
+namespace json
+{
+// ----------------------------------------------------------------------------
+
+const JsonValue FindMember(const JsonValue& i_object, const_cstr i_key)
+{
+	if (!IsValid(i_object) || *i_object.begin != '{')
+	{
+		return k_InvalidValue;
+	}
+
+	const size keyLength = strlen(i_key);
+	const c8* end = i_object.end;
+	const c8* p = i_object.begin + 1;
+	while (true)
+	{
+		p = SkipSpaces(p, end);
+		if (p >= end || *p != '"')
+		{
+			return k_InvalidValue;
+		}
+
+		const c8* keyBegin = p + 1;
+		p = SkipString(p, end);
+		if (p == nullptr)
+		{
+			return k_InvalidValue;
+		}
+		const c8* keyEnd = p - 1;
+
+		p = SkipSpaces(p, end);
+		if (p >= end || *p != ':')
+		{
+			return k_InvalidValue;
+		}
+		p = SkipSpaces(p + 1, end);
+
+		JsonValue value;
+		value.begin = p;
+		value.end = SkipValue(p, end);
+		if (value.end == nullptr)
+		{
+			return k_InvalidValue;
+		}
+
+		if ((size)(keyEnd - keyBegin) == keyLength && memcmp(keyBegin, i_key, keyLength) == 0)
+		{
+			return value;
+		}
+
+		p = SkipSpaces(value.end, end);
+		if (p >= end || *p != ',')
+		{
+			return k_InvalidValue;
+		}
+		p++;
+	}
+}
+
+const JsonValue GetElement(const JsonValue& i_array, const u32 i_idx)
+{
+	if (!IsValid(i_array) || *i_array.begin != '[')
+	{
+		return k_InvalidValue;
+	}
+
+	const c8* end = i_array.end;
+	const c8* p = SkipSpaces(i_array.begin + 1, end);
+	for (u32 i = 0; p < end && *p != ']'; i++)
+	{
+		JsonValue value;
+		value.begin = p;
+		value.end = SkipValue(p, end);
+		if (value.end == nullptr)
+		{
+			return k_InvalidValue;
+		}
+
+		if (i == i_idx)
+		{
+			return value;
+		}
+
+		p = SkipSpaces(value.end, end);
+		if (p >= end || *p != ',')
+		{
+			return k_InvalidValue;
+		}
+		p = SkipSpaces(p + 1, end);
+	}
+	return k_InvalidValue;
+}
+
+const u32 GetArraySize(const JsonValue& i_array)
+{
+	return GetArrayElements(i_array, nullptr, 0xFFFFFFFF);
+}
+
+const u32 GetArrayElements(const JsonValue& i_array, JsonValue* o_elements, const u32 i_capacity)
+{
+	if (!IsValid(i_array) || *i_array.begin != '[')
+	{
+		return 0;
+	}
+
+	u32 count = 0;
+	const c8* end = i_array.end;
+	const c8* p = SkipSpaces(i_array.begin + 1, end);
+	while (p < end && *p != ']' && count < i_capacity)
+	{
+		const c8* valueEnd = SkipValue(p, end);
+		if (valueEnd == nullptr)
+		{
+			break;
+		}
+
+		if (o_elements)
+		{
+			o_elements[count].begin = p;
+			o_elements[count].end = valueEnd;
+		}
+		count++;
+
+		p = SkipSpaces(valueEnd, end);
+		if (p >= end || *p != ',')
+		{
+			break;
+		}
+		p = SkipSpaces(p + 1, end);
+	}
+	return count;
+}
+
+const s64 ToInt(const JsonValue& i_value, const s64 i_default)
+{
+	if (!IsValid(i_value))
+	{
+		return i_default;
+	}
+
+	const c8* p = i_value.begin;
+	const bool negative = (*p == '-');
+	if (negative)
+	{
+		p++;
+	}
+
+	s64 value = 0;
+	const c8* digits = p;
+	while (p < i_value.end && *p >= '0' && *p <= '9')
+	{
+		value = value * 10 + (*p - '0');
+		p++;
+	}
+
+	if (p == digits)
+	{
+		return i_default;
+	}
+
+	if (p < i_value.end)
+	{
+		// 1.0 or 1e2, rare enough to go through strtod
+		return (s64)ToDouble(i_value, (f64)i_default);
+	}
+	return negative ? -value : value;
+}
+
+const f64 ToDouble(const JsonValue& i_value, const f64 i_default)
+{
+	// the value is not null terminated
+	c8 number[64];
+	const size length = IsValid(i_value) ? (size)(i_value.end - i_value.begin) : 0;
+	if (length == 0 || length >= sizeof(number))
+	{
+		return i_default;
+	}
+
+	memcpy(number, i_value.begin, length);
+	number[length] = 0;
+	c8* numberEnd = nullptr;
+	const f64 value = strtod(number, &numberEnd);
+	return numberEnd == number + length ? value : i_default;
+}
+
+const bool Equals(const JsonValue& i_value, const_cstr i_str)
+{
+	if (!IsValid(i_value) || *i_value.begin != '"')
+	{
+		return false;
+	}
+
+	const size length = strlen(i_str);
+	return (size)(i_value.end - i_value.begin) == length + 2 && memcmp(i_value.begin + 1, i_str, length) == 0;
+}
+
+const bool ToString(const JsonValue& i_value, c8* o_str, const size i_capacity)
+{
+	if (!IsValid(i_value) || *i_value.begin != '"' || i_capacity == 0)
+	{
+		return false;
+	}
+
+	size length = 0;
+	const c8* p = i_value.begin + 1;
+	const c8* end = i_value.end - 1;
+	while (p < end)
+	{
+		c8 c = *p++;
+		if (c == '\\' && p < end)
+		{
+			const c8 escaped = *p++;
+			switch (escaped)
+			{
+			case 'b': c = '\b'; break;
+			case 'f': c = '\f'; break;
+			case 'n': c = '\n'; break;
+			case 'r': c = '\r'; break;
+			case 't': c = '\t'; break;
+			case 'u':
+			{
+				// ascii only, the file names and the names we compare are
+				u32 codePoint = 0;
+				for (u32 i = 0; i < 4 && p < end; i++, p++)
+				{
+					const c8 h = *p;
+					codePoint = codePoint * 16 + (u32)(h >= 'a' ? h - 'a' + 10 : (h >= 'A' ? h - 'A' + 10 : h - '0'));
+				}
+				c = codePoint < 0x80 ? (c8)codePoint : '?';
+				break;
+			}
+			default: c = escaped; break;
+			}
+		}
+
+		if (length + 1 >= i_capacity)
+		{
+			return false;
+		}
+		o_str[length++] = c;
+	}
+	o_str[length] = 0;
+	return true;
+}
+
+// ----------------------------------------------------------------------------
+}
+
+// ----------------------------------------------------------------------------
+}
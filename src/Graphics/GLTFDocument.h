@@ -0,0 +1,114 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+
+// shared with modelbaker, it must not depend on the engine
+namespace gltf_loader
+{
+// ----------------------------------------------------------------------------
+
+enum class ComponentType : u32
+{
+	Invalid										= 0,
+	Byte										= 5120,
+	UnsignedByte								= 5121,
+	Short										= 5122,
+	UnsignedShort								= 5123,
+	UnsignedInt									= 5125,
+	Float										= 5126
+};
+
+enum class ElementType : u32
+{
+	Invalid = 0,
+	Scalar,
+	Vec2,
+	Vec3,
+	Vec4,
+	Mat2,
+	Mat3,
+	Mat4
+};
+
+// a value in the json text, it is only parsed when asked for; begin is nullptr when the value is absent
+struct JsonValue
+{
+	const c8*									begin;
+	const c8*									end;
+};
+
+struct Document
+{
+	JsonValue									root;
+	JsonValue									accessors;
+	JsonValue									bufferViews;
+	JsonValue									buffers;
+
+	// the BIN chunk of the glb or the external buffer, set by the caller for a gltf
+	const u8*									bin;
+	size										binSize;
+
+	// optional, see IndexDocument()
+	const JsonValue*							accessorsTable;
+	u32											accessorsCount;
+	const JsonValue*							bufferViewsTable;
+	u32											bufferViewsCount;
+};
+
+// the elements of an accessor as they are in the buffer
+struct AccessorView
+{
+	const u8*									data;
+	u32											count;
+	u32											stride;
+	u32											elementSize;
+	ComponentType								componentType;
+	ElementType									elementType;
+};
+
+const bool										IsGLB(const u8* i_data, const size i_size);
+// the JSON and the BIN chunks of a glb, they point into i_data; there may be no BIN chunk
+const bool										ParseGLB(const u8* i_data, const size i_size, const c8** o_json, size* o_jsonSize,
+													const u8** o_bin, size* o_binSize);
+
+// only finds the top level arrays, nothing is allocated
+const bool										ParseDocument(const c8* i_json, const size i_jsonSize, Document* o_document);
+// o_accessors and o_bufferViews must hold GetAccessorsCount() and GetBufferViewsCount() values, the lookups are O(1) after
+void											IndexDocument(Document* io_document, JsonValue* o_accessors, JsonValue* o_bufferViews);
+const u32										GetAccessorsCount(const Document& i_document);
+const u32										GetBufferViewsCount(const Document& i_document);
+// false for a missing file name (a data uri or a glb buffer)
+const bool										GetBufferUri(const Document& i_document, const u32 i_bufferIdx, c8* o_uri, const size i_capacity);
+
+// false when the accessor is sparse, not in buffer 0 or out of document.bin
+const bool										GetAccessorView(const Document& i_document, const u32 i_accessorIdx, AccessorView* o_view);
+const bool										IsPacked(const AccessorView& i_view);
+// the first i_elementSize bytes of every element to o_data, every i_stride bytes; one copy when both sides are packed
+void											CopyAccessor(const AccessorView& i_view, const size i_elementSize, voidptr o_data, const size i_stride);
+// u8, u16 or u32 indices widened to s32
+void											CopyIndices(const AccessorView& i_view, s32* o_indices);
+
+namespace json
+{
+// ----------------------------------------------------------------------------
+
+inline const bool								IsValid(const JsonValue& i_value) { return i_value.begin != nullptr; }
+
+const JsonValue									FindMember(const JsonValue& i_object, const_cstr i_key);
+const JsonValue									GetElement(const JsonValue& i_array, const u32 i_idx);
+const u32										GetArraySize(const JsonValue& i_array);
+// returns the number of elements written
+const u32										GetArrayElements(const JsonValue& i_array, JsonValue* o_elements, const u32 i_capacity);
+
+const s64										ToInt(const JsonValue& i_value, const s64 i_default);
+const f64										ToDouble(const JsonValue& i_value, const f64 i_default);
+// without escape sequences, which the names we look up do not have
+const bool										Equals(const JsonValue& i_value, const_cstr i_str);
+// unescaped, false when o_str is too small
+const bool										ToString(const JsonValue& i_value, c8* o_str, const size i_capacity);
+
+// ----------------------------------------------------------------------------
+}
+
+// ----------------------------------------------------------------------------
+}
@@ -3,9 +3,8 @@
 #include <floral/stdaliases.h>
 #include <floral/cmds/path.h>
 #include <floral/comgeo/shapegen.h>
-#include <floral/io/nativeio.h>
 
-#include "cJSON.h"
+#include "GLTFDocument.h"
 
 namespace gltf_loader
 {
@@ -17,21 +16,44 @@ struct GLTFLoadResult
 	size										indicesCount;
 };
 
+/*
+ * A .gltf and its .bin or a .glb, memory mapped. The views point into the mappings, the ones whose
+ * attribute the mesh does not have are all zeros.
+ */
+struct MappedModel
+{
+	Document									document;
+	AccessorView								position;
+	AccessorView								normal;
+	AccessorView								tangent;
+	AccessorView								texCoord;
+	AccessorView								indices;
+
+	voidptr										mappedData;
+	size										mappedSize;
+	voidptr										mappedBinData;		// nullptr for a glb
+	size										mappedBinSize;
+};
+
 // These functions only accept gltf files which have only 1 node, this node only contains 1 mesh
 template <class TMemoryArena>
 GLTFLoadResult									CreateModel(const_cstr i_jsonScene, const_cstr i_currDir, voidptr o_vtxData, voidptr o_idxData, const size i_stride, const floral::geo_vertex_format_e i_readFlags, TMemoryArena* i_memoryArena);
 template <class TMemoryArena>
 GLTFLoadResult									CreateModel(const floral::path& i_path, voidptr o_vtxData, voidptr o_idxData, const size i_stride, const floral::geo_vertex_format_e i_readFlags, TMemoryArena* i_memoryArena);
 
+// .gltf or .glb, nothing is copied; false when the file cannot be mapped or is not a 1 node, 1 mesh scene
+template <class TMemoryArena>
+const bool										MapModel(const floral::path& i_path, MappedModel* o_model, TMemoryArena* i_memoryArena);
+void											UnmapModel(MappedModel* io_model);
+
 namespace internal
 {
 // ----------------------------------------------------------------------------
 
 template <class TMemoryArena>
-void											InitializeJSONParser(TMemoryArena* i_memoryArena);
+const bool										ReadMesh(const_cstr i_currDir, MappedModel* io_model, TMemoryArena* i_memoryArena);
 
-template <class TMemoryArena>
-const size										ReadBuffer(const s32 i_idx, cJSON* i_json, p8 o_buffer, const size i_elemSize, const size i_stride, floral::file_stream& i_inpStream, TMemoryArena* i_memoryArena);
+GLTFLoadResult									CopyModel(const MappedModel& i_model, voidptr o_vtxData, voidptr o_idxData, const size i_stride, const floral::geo_vertex_format_e i_readFlags);
 
 // ----------------------------------------------------------------------------
 }
@@ -1,4 +1,10 @@
 #include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <floral/assert/assert.h>
+
+#include "Graphics/FileMapping.h"
 
 namespace gltf_loader
 {
@@ -7,77 +13,91 @@ namespace gltf_loader
 template <class TMemoryArena>
 GLTFLoadResult CreateModel(const_cstr i_jsonScene, const_cstr i_currDir, voidptr o_vtxData, voidptr o_idxData, const size i_stride, const floral::geo_vertex_format_e i_readFlags, TMemoryArena* i_memoryArena)
 {
-	internal::InitializeJSONParser(i_memoryArena);
-	cJSON* json = cJSON_Parse(i_jsonScene);
-	FLORAL_ASSERT_MSG(json != nullptr, "Failed to parsed GLTF JSON");
-
-	const cJSON* nodesArray = cJSON_GetObjectItemCaseSensitive(json, "nodes");
-	FLORAL_ASSERT_MSG(cJSON_GetArraySize(nodesArray) == 1, "This function can only load 1 node scene");
-
-	const cJSON* meshArray = cJSON_GetObjectItemCaseSensitive(json, "meshes");
-	FLORAL_ASSERT_MSG(cJSON_GetArraySize(meshArray) == 1, "This function can only load 1 mesh scene");
-
-	const cJSON* mesh = cJSON_GetArrayItem(meshArray, 0);
-	const cJSON* primitives = cJSON_GetObjectItemCaseSensitive(mesh, "primitives");
-	const cJSON* primitive = cJSON_GetArrayItem(primitives, 0);
-	const cJSON* attributes = cJSON_GetObjectItemCaseSensitive(primitive, "attributes");
-
-	const cJSON* buffers = cJSON_GetObjectItemCaseSensitive(json, "buffers");
-	const cJSON* buffer = cJSON_GetArrayItem(buffers, 0);
-	const char* uri = cJSON_GetObjectItemCaseSensitive(buffer, "uri")->valuestring;
-
-	// now read it!
-	cstr fullBinPath = (cstr)i_memoryArena->allocate(1024);
-	sprintf(fullBinPath, "%s/%s", i_currDir, uri);
-	floral::file_info inp = floral::open_file(fullBinPath);
-	floral::file_stream inpStream;
-	inpStream.buffer = (p8)i_memoryArena->allocate(inp.file_size + 1);
-	floral::read_all_file(inp, inpStream);
-	floral::close_file(inp);
+	MappedModel model;
+	memset(&model, 0, sizeof(MappedModel));
+	const bool parseResult = ParseDocument(i_jsonScene, strlen(i_jsonScene), &model.document);
+	FLORAL_ASSERT_MSG(parseResult, "Failed to parsed GLTF JSON");
 
 	GLTFLoadResult loadResult;
+	loadResult.verticesCount = 0;
+	loadResult.indicesCount = 0;
+	if (parseResult && internal::ReadMesh(i_currDir, &model, i_memoryArena))
+	{
+		loadResult = internal::CopyModel(model, o_vtxData, o_idxData, i_stride, i_readFlags);
+	}
+	UnmapModel(&model);
+	return loadResult;
+}
 
-	aptr offset = 0;
-	const cJSON* buffPosition = cJSON_GetObjectItemCaseSensitive(attributes, "POSITION");
-	loadResult.verticesCount = internal::ReadBuffer(buffPosition->valueint, json, (p8)((aptr)o_vtxData + offset), sizeof(floral::vec3f), i_stride, inpStream, i_memoryArena);
-	offset += sizeof(floral::vec3f);
+template <class TMemoryArena>
+GLTFLoadResult CreateModel(const floral::path& i_path, voidptr o_vtxData, voidptr o_idxData, const size i_stride, const floral::geo_vertex_format_e i_readFlags, TMemoryArena* i_memoryArena)
+{
+	GLTFLoadResult loadResult;
+	loadResult.verticesCount = 0;
+	loadResult.indicesCount = 0;
 
-	if (TEST_BIT((s32)i_readFlags, (s32)floral::geo_vertex_format_e::normal))
+	MappedModel model;
+	const bool mapResult = MapModel(i_path, &model, i_memoryArena);
+	FLORAL_ASSERT_MSG(mapResult, "Failed to load the GLTF file");
+	if (mapResult)
 	{
-		const cJSON* buffNormal = cJSON_GetObjectItemCaseSensitive(attributes, "NORMAL");
-		internal::ReadBuffer(buffNormal->valueint, json, (p8)((aptr)o_vtxData + offset), sizeof(floral::vec3f), i_stride, inpStream, i_memoryArena);
-		offset += sizeof(floral::vec3f);
+		loadResult = internal::CopyModel(model, o_vtxData, o_idxData, i_stride, i_readFlags);
+		UnmapModel(&model);
 	}
+	return loadResult;
+}
 
-	if (TEST_BIT((s32)i_readFlags, (s32)floral::geo_vertex_format_e::tangent))
+template <class TMemoryArena>
+const bool MapModel(const floral::path& i_path, MappedModel* o_model, TMemoryArena* i_memoryArena)
+{
+	memset(o_model, 0, sizeof(MappedModel));
+	o_model->mappedData = file_mapping::MapFile(i_path.pm_PathStr, &o_model->mappedSize, true);
+	if (o_model->mappedData == nullptr)
 	{
-		const cJSON* buffTangent = cJSON_GetObjectItemCaseSensitive(attributes, "TANGENT");
-		internal::ReadBuffer(buffTangent->valueint, json, (p8)((aptr)o_vtxData + offset), sizeof(floral::vec3f), i_stride, inpStream, i_memoryArena);
-		offset += sizeof(floral::vec3f);
+		return false;
 	}
 
-	if (TEST_BIT((s32)i_readFlags, (s32)floral::geo_vertex_format_e::tex_coord))
+	const u8* data = (const u8*)o_model->mappedData;
+	const c8* json = (const c8*)data;
+	size jsonSize = o_model->mappedSize;
+	const u8* bin = nullptr;
+	size binSize = 0;
+	if (IsGLB(data, o_model->mappedSize) && !ParseGLB(data, o_model->mappedSize, &json, &jsonSize, &bin, &binSize))
 	{
-		const cJSON* buffTexCoord = cJSON_GetObjectItemCaseSensitive(attributes, "TEXCOORD_0");
-		internal::ReadBuffer(buffTexCoord->valueint, json, (p8)((aptr)o_vtxData + offset), sizeof(floral::vec2f), i_stride, inpStream, i_memoryArena);
-		offset += sizeof(floral::vec2f);
+		UnmapModel(o_model);
+		return false;
 	}
 
-	const cJSON* buffIndices = cJSON_GetObjectItemCaseSensitive(primitive, "indices");
-	loadResult.indicesCount = internal::ReadBuffer(buffIndices->valueint, json, (p8)(o_idxData), sizeof(s32), sizeof(s32), inpStream, i_memoryArena);
-	return loadResult;
+	if (!ParseDocument(json, jsonSize, &o_model->document))
+	{
+		UnmapModel(o_model);
+		return false;
+	}
+
+	o_model->document.bin = bin;
+	o_model->document.binSize = binSize;
+	if (!internal::ReadMesh(i_path.pm_CurrentDir, o_model, i_memoryArena))
+	{
+		UnmapModel(o_model);
+		return false;
+	}
+	return true;
 }
 
-template <class TMemoryArena>
-GLTFLoadResult CreateModel(const floral::path& i_path, voidptr o_vtxData, voidptr o_idxData, const size i_stride, const floral::geo_vertex_format_e i_readFlags, TMemoryArena* i_memoryArena)
+inline void UnmapModel(MappedModel* io_model)
 {
-	floral::file_info inp = floral::open_file(i_path);
-	floral::file_stream inpStream;
-	inpStream.buffer = (p8)i_memoryArena->allocate(inp.file_size + 1);
-	floral::read_all_file(inp, inpStream);
-	floral::close_file(inp);
-
-	return CreateModel((const_cstr)inpStream.buffer, i_path.pm_CurrentDir, o_vtxData, o_idxData, i_stride, i_readFlags, i_memoryArena);
+	if (io_model->mappedBinData)
+	{
+		file_mapping::UnmapFile(io_model->mappedBinData, io_model->mappedBinSize);
+	}
+	if (io_model->mappedData)
+	{
+		file_mapping::UnmapFile(io_model->mappedData, io_model->mappedSize);
+	}
+	io_model->mappedBinData = nullptr;
+	io_model->mappedBinSize = 0;
+	io_model->mappedData = nullptr;
+	io_model->mappedSize = 0;
 }
 
 // ----------------------------------------------------------------------------
@@ -87,75 +107,129 @@ namespace internal
 // ----------------------------------------------------------------------------
 
 template <class TMemoryArena>
-struct AllocatorRegistry
+const bool ReadMesh(const_cstr i_currDir, MappedModel* io_model, TMemoryArena* i_memoryArena)
 {
-	static TMemoryArena* allocator;
-	static void* Allocate(size_t sz)
+	Document& document = io_model->document;
+	if (json::GetArraySize(json::FindMember(document.root, "nodes")) != 1)
+	{
+		FLORAL_ASSERT_MSG(false, "This function can only load 1 node scene");
+		return false;
+	}
+
+	const JsonValue meshes = json::FindMember(document.root, "meshes");
+	if (json::GetArraySize(meshes) != 1)
 	{
-		return allocator->allocate(sz);
+		FLORAL_ASSERT_MSG(false, "This function can only load 1 mesh scene");
+		return false;
 	}
 
-	static void Free(void* ptr)
+	// the buffer of a gltf is mapped too
+	if (document.bin == nullptr)
 	{
-		if (ptr)
+		c8 uri[512];
+		if (!GetBufferUri(document, 0, uri, sizeof(uri)))
+		{
+			return false;
+		}
+
+		cstr fullBinPath = (cstr)i_memoryArena->allocate(1024);
+		snprintf(fullBinPath, 1024, "%s/%s", i_currDir, uri);
+		io_model->mappedBinData = file_mapping::MapFile(fullBinPath, &io_model->mappedBinSize, true);
+		if (io_model->mappedBinData == nullptr)
 		{
-			return allocator->free(ptr);
+			return false;
 		}
+		document.bin = (const u8*)io_model->mappedBinData;
+		document.binSize = io_model->mappedBinSize;
 	}
-};
 
-template <class TMemoryArena>
-TMemoryArena* AllocatorRegistry<TMemoryArena>::allocator = nullptr;
+	JsonValue* accessorsTable = (JsonValue*)i_memoryArena->allocate(sizeof(JsonValue) * (GetAccessorsCount(document) + 1));
+	JsonValue* bufferViewsTable = (JsonValue*)i_memoryArena->allocate(sizeof(JsonValue) * (GetBufferViewsCount(document) + 1));
+	IndexDocument(&document, accessorsTable, bufferViewsTable);
 
-template <class TMemoryArena>
-void InitializeJSONParser(TMemoryArena* i_memoryArena)
-{
-	AllocatorRegistry<TMemoryArena>::allocator = i_memoryArena;
-	cJSON_Hooks hooks;
-	hooks.malloc_fn = &AllocatorRegistry<TMemoryArena>::Allocate;
-	hooks.free_fn = &AllocatorRegistry<TMemoryArena>::Free;
-	cJSON_InitHooks(&hooks);
+	const JsonValue primitive = json::GetElement(json::FindMember(json::GetElement(meshes, 0), "primitives"), 0);
+	const JsonValue attributes = json::FindMember(primitive, "attributes");
+
+	static const_cstr k_AttributeNames[] = { "NORMAL", "TANGENT", "TEXCOORD_0" };
+	AccessorView* optionalViews[] = { &io_model->normal, &io_model->tangent, &io_model->texCoord };
+	for (u32 i = 0; i < 3; i++)
+	{
+		const s64 accessorIdx = json::ToInt(json::FindMember(attributes, k_AttributeNames[i]), -1);
+		if (accessorIdx >= 0 && !GetAccessorView(document, (u32)accessorIdx, optionalViews[i]))
+		{
+			return false;
+		}
+	}
+
+	const s64 positionIdx = json::ToInt(json::FindMember(attributes, "POSITION"), -1);
+	const s64 indicesIdx = json::ToInt(json::FindMember(primitive, "indices"), -1);
+	return positionIdx >= 0 && indicesIdx >= 0
+		&& GetAccessorView(document, (u32)positionIdx, &io_model->position)
+		&& GetAccessorView(document, (u32)indicesIdx, &io_model->indices);
 }
 
-template <class TMemoryArena>
-const size ReadBuffer(const s32 i_idx, cJSON* i_json, p8 o_buffer, const size i_elemSize, const size i_stride, floral::file_stream& i_inpStream, TMemoryArena* i_memoryArena)
+inline GLTFLoadResult CopyModel(const MappedModel& i_model, voidptr o_vtxData, voidptr o_idxData, const size i_stride, const floral::geo_vertex_format_e i_readFlags)
 {
-	const cJSON* accessors = cJSON_GetObjectItemCaseSensitive(i_json, "accessors");
-	const cJSON* accessor = cJSON_GetArrayItem(accessors, i_idx);
-	size buffIdx = cJSON_GetObjectItemCaseSensitive(accessor, "bufferView")->valueint;
-	size count = cJSON_GetObjectItemCaseSensitive(accessor, "count")->valueint;
-
-	size diskElemSize = 0;
-	if (strcmp(cJSON_GetObjectItemCaseSensitive(accessor, "type")->valuestring, "SCALAR") == 0)
+	// in the order of the interleaved vertex
+	const AccessorView* views[4] = { &i_model.position, nullptr, nullptr, nullptr };
+	size elementSizes[4] = { sizeof(floral::vec3f), 0, 0, 0 };
+	u32 attributesCount = 1;
+	if (TEST_BIT((s32)i_readFlags, (s32)floral::geo_vertex_format_e::normal))
 	{
-		diskElemSize = 4;
+		views[attributesCount] = &i_model.normal;
+		elementSizes[attributesCount] = sizeof(floral::vec3f);
+		attributesCount++;
 	}
-	else if (strcmp(cJSON_GetObjectItemCaseSensitive(accessor, "type")->valuestring, "VEC2") == 0)
+
+	if (TEST_BIT((s32)i_readFlags, (s32)floral::geo_vertex_format_e::tangent))
 	{
-		diskElemSize = 4 * 2;
+		// the handedness is dropped
+		views[attributesCount] = &i_model.tangent;
+		elementSizes[attributesCount] = sizeof(floral::vec3f);
+		attributesCount++;
 	}
-	else if (strcmp(cJSON_GetObjectItemCaseSensitive(accessor, "type")->valuestring, "VEC3") == 0)
+
+	if (TEST_BIT((s32)i_readFlags, (s32)floral::geo_vertex_format_e::tex_coord))
 	{
-		diskElemSize = 4 * 3;
+		views[attributesCount] = &i_model.texCoord;
+		elementSizes[attributesCount] = sizeof(floral::vec2f);
+		attributesCount++;
 	}
-	else if (strcmp(cJSON_GetObjectItemCaseSensitive(accessor, "type")->valuestring, "VEC4") == 0)
+
+	GLTFLoadResult loadResult;
+	loadResult.verticesCount = i_model.position.count;
+	loadResult.indicesCount = i_model.indices.count;
+
+	// the file has the vertices as we want them: one copy
+	bool interleaved = true;
+	size offset = 0;
+	for (u32 i = 0; i < attributesCount; i++)
 	{
-		diskElemSize = 4 * 4;
+		const AccessorView& view = *views[i];
+		interleaved = interleaved && view.componentType == ComponentType::Float && view.elementSize == elementSizes[i]
+			&& view.stride == i_stride && view.count == i_model.position.count && view.data == i_model.position.data + offset;
+		offset += elementSizes[i];
 	}
-	FLORAL_ASSERT(diskElemSize >= i_elemSize);
 
-	const cJSON* bufferViews = cJSON_GetObjectItemCaseSensitive(i_json, "bufferViews");
-	const cJSON* bufferView = cJSON_GetArrayItem(bufferViews, buffIdx);
-	const size offset = cJSON_GetObjectItemCaseSensitive(bufferView, "byteOffset")->valueint;
-
-	i_inpStream.seek_begin(offset);
-	aptr wpos = 0;
-	for (size i = 0; i < count; i++)
+	if (interleaved && offset == i_stride)
 	{
-		i_inpStream.read_bytes(voidptr((aptr)o_buffer + wpos), i_elemSize);
-		wpos += i_stride;
+		memcpy(o_vtxData, i_model.position.data, i_stride * i_model.position.count);
 	}
-	return count;
+	else
+	{
+		offset = 0;
+		for (u32 i = 0; i < attributesCount; i++)
+		{
+			const AccessorView& view = *views[i];
+			FLORAL_ASSERT_MSG(view.count == i_model.position.count && view.componentType == ComponentType::Float,
+					"Missing or non float vertex attribute");
+			CopyAccessor(view, elementSizes[i], (p8)o_vtxData + offset, i_stride);
+			offset += elementSizes[i];
+		}
+	}
+
+	CopyIndices(i_model.indices, (s32*)o_idxData);
+	return loadResult;
 }
 
 // ----------------------------------------------------------------------------
@@ -54,5 +54,21 @@ SurfaceGPU CreateSurfaceGPU(voidptr i_vtxData, const u32 i_vtxCount, const size
 	return surfaceGPU;
 }
 
+insigne::ib_handle_t CreateIndexBufferGPU(voidptr i_idxData, const u32 i_idxCount,
+		insigne::buffer_usage_e i_usage, const bool i_makeCopy /* = true */)
+{
+	insigne::ibdesc_t ibDesc;
+	ibDesc.region_size = find_nearest_pot(i_idxCount * sizeof(s32));
+	ibDesc.data = i_idxData;
+	ibDesc.count = i_idxCount;
+	ibDesc.usage = i_usage;
+
+	if (i_makeCopy)
+	{
+		return insigne::copy_create_ib(ibDesc);
+	}
+	return insigne::create_ib(ibDesc);
+}
+
 // ---------------------------------------------
 }
\ No newline at end of file
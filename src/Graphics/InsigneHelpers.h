@@ -17,5 +17,9 @@ SurfaceGPU										CreateSurfaceGPU(voidptr i_vtxData, const u32 i_vtxCount, co
 													voidptr i_idxData, const u32 i_idxCount,
 													insigne::buffer_usage_e i_usage, const bool i_makeCopy = true);
 
+// an index buffer for a vertex buffer created with CreateSurfaceGPU, e.g. a level of detail
+insigne::ib_handle_t							CreateIndexBufferGPU(voidptr i_idxData, const u32 i_idxCount,
+													insigne::buffer_usage_e i_usage, const bool i_makeCopy = true);
+
 // ---------------------------------------------
 }
@@ -0,0 +1,838 @@
+#include "LightProbeBaker.h"
+
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#include <atomic>
+#include <algorithm>
+#include <thread>
+
+#include <floral/assert/assert.h>
+
+#include <refrain2.h>
+
+namespace lightprobe
+{
+// ------------------------------------------------------------------
+
+static const u32								k_BinsCount = 16;
+static const u32								k_MaxLeafTriangles = 4;
+static const u32								k_TraversalStackSize = 64;
+// the traversal stack holds at most depth + 1 nodes, past k_MedianSplitDepth every split halves the
+// range so the tree stays under k_MaxBuildDepth even for 2^32 triangles
+static const u32								k_MaxBuildDepth = k_TraversalStackSize - 2;
+static const u32								k_MedianSplitDepth = k_MaxBuildDepth - 32;
+static const u32								k_MaxBakeThreads = 64;
+static const f32								k_Pi = 3.14159265358979f;
+
+const BakeOptions GetDefaultBakeOptions()
+{
+	BakeOptions options;
+	options.mode = BakeMode::VertexColorRadiance;
+	options.sqrtSamplesPerProbe = 64;
+	options.maxBounces = 3;
+	options.skyRadiance = floral::vec3f(0.0f);
+	options.rayOffset = 0.0005f;
+	options.seed = 1234;
+	options.probesPerTask = 4;
+	options.threadsCount = 1;
+	return options;
+}
+
+// ------------------------------------------------------------------
+
+static inline const floral::vec3f& GetPosition(const BakeScene& i_scene, const u32 i_vertex)
+{
+	return *(const floral::vec3f*)((const u8*)i_scene.positions + i_scene.positionStride * i_vertex);
+}
+
+static inline const floral::vec4f& GetColor(const BakeScene& i_scene, const u32 i_vertex)
+{
+	return *(const floral::vec4f*)((const u8*)i_scene.colors + i_scene.colorStride * i_vertex);
+}
+
+static inline const floral::vec3f& GetEmission(const BakeScene& i_scene, const u32 i_vertex)
+{
+	return *(const floral::vec3f*)((const u8*)i_scene.emissions + i_scene.emissionStride * i_vertex);
+}
+
+static inline void ExpandBounds(floral::vec3f& io_min, floral::vec3f& io_max, const floral::vec3f& i_p)
+{
+	io_min = floral::vec3f(floral::min(io_min.x, i_p.x), floral::min(io_min.y, i_p.y), floral::min(io_min.z, i_p.z));
+	io_max = floral::vec3f(floral::max(io_max.x, i_p.x), floral::max(io_max.y, i_p.y), floral::max(io_max.z, i_p.z));
+}
+
+static inline const f32 HalfArea(const floral::vec3f& i_min, const floral::vec3f& i_max)
+{
+	const floral::vec3f d = i_max - i_min;
+	return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+static inline const f32 GetAxis(const floral::vec3f& i_v, const u32 i_axis)
+{
+	return i_axis == 0 ? i_v.x : (i_axis == 1 ? i_v.y : i_v.z);
+}
+
+// ------------------------------------------------------------------
+
+struct BuildPrimitive
+{
+	floral::vec3f								minCorner;
+	floral::vec3f								maxCorner;
+	floral::vec3f								centroid;
+	u32											triangle;
+};
+
+struct BuildRange
+{
+	u32											node;
+	u32											begin;
+	u32											end;
+	u32											depth;
+};
+
+struct SAHBin
+{
+	floral::vec3f								minCorner;
+	floral::vec3f								maxCorner;
+	u32											count;
+};
+
+/*
+ * Binned SAH split of [i_begin, i_end), returns the partition point or i_begin if the
+ * range should become a leaf.
+ */
+static const u32 SplitRange(BuildPrimitive* io_prims, const u32 i_begin, const u32 i_end,
+		const floral::vec3f& i_nodeMin, const floral::vec3f& i_nodeMax)
+{
+	const u32 count = i_end - i_begin;
+	if (count <= k_MaxLeafTriangles)
+	{
+		return i_begin;
+	}
+
+	floral::vec3f cMin(FLT_MAX), cMax(-FLT_MAX);
+	for (u32 i = i_begin; i < i_end; i++)
+	{
+		ExpandBounds(cMin, cMax, io_prims[i].centroid);
+	}
+
+	f32 bestCost = FLT_MAX;
+	u32 bestAxis = 0;
+	u32 bestBin = 0;
+	for (u32 axis = 0; axis < 3; axis++)
+	{
+		const f32 axisMin = GetAxis(cMin, axis);
+		const f32 extent = GetAxis(cMax, axis) - axisMin;
+		if (extent <= 0.0f)
+		{
+			continue;
+		}
+
+		SAHBin bins[k_BinsCount];
+		for (u32 b = 0; b < k_BinsCount; b++)
+		{
+			bins[b].minCorner = floral::vec3f(FLT_MAX);
+			bins[b].maxCorner = floral::vec3f(-FLT_MAX);
+			bins[b].count = 0;
+		}
+
+		const f32 scale = k_BinsCount / extent;
+		for (u32 i = i_begin; i < i_end; i++)
+		{
+			const u32 b = floral::min((u32)((GetAxis(io_prims[i].centroid, axis) - axisMin) * scale), k_BinsCount - 1);
+			ExpandBounds(bins[b].minCorner, bins[b].maxCorner, io_prims[i].minCorner);
+			ExpandBounds(bins[b].minCorner, bins[b].maxCorner, io_prims[i].maxCorner);
+			bins[b].count++;
+		}
+
+		// sweep from the right to get the cost of every right side, then from the left
+		f32 rightAreas[k_BinsCount];
+		u32 rightCounts[k_BinsCount];
+		floral::vec3f rMin(FLT_MAX), rMax(-FLT_MAX);
+		u32 rCount = 0;
+		for (u32 b = k_BinsCount - 1; b > 0; b--)
+		{
+			if (bins[b].count > 0)
+			{
+				ExpandBounds(rMin, rMax, bins[b].minCorner);
+				ExpandBounds(rMin, rMax, bins[b].maxCorner);
+			}
+			rCount += bins[b].count;
+			rightAreas[b] = rCount > 0 ? HalfArea(rMin, rMax) : 0.0f;
+			rightCounts[b] = rCount;
+		}
+
+		floral::vec3f lMin(FLT_MAX), lMax(-FLT_MAX);
+		u32 lCount = 0;
+		for (u32 b = 0; b < k_BinsCount - 1; b++)
+		{
+			if (bins[b].count > 0)
+			{
+				ExpandBounds(lMin, lMax, bins[b].minCorner);
+				ExpandBounds(lMin, lMax, bins[b].maxCorner);
+			}
+			lCount += bins[b].count;
+			if (lCount == 0 || rightCounts[b + 1] == 0)
+			{
+				continue;
+			}
+			const f32 cost = HalfArea(lMin, lMax) * lCount + rightAreas[b + 1] * rightCounts[b + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = b;
+			}
+		}
+	}
+
+	if (bestCost == FLT_MAX)
+	{
+		// all centroids are the same, split in the middle so the leaves stay small
+		return i_begin + count / 2;
+	}
+
+	// keep small ranges as leaves when splitting does not pay off (traversal cost ~ 1 triangle test)
+	const f32 splitCost = 1.0f + bestCost / floral::max(HalfArea(i_nodeMin, i_nodeMax), 1e-20f);
+	if (splitCost >= (f32)count && count <= k_MaxLeafTriangles * 4)
+	{
+		return i_begin;
+	}
+
+	const f32 axisMin = GetAxis(cMin, bestAxis);
+	const f32 scale = k_BinsCount / (GetAxis(cMax, bestAxis) - axisMin);
+	u32 left = i_begin;
+	u32 right = i_end;
+	while (left < right)
+	{
+		const u32 b = floral::min((u32)((GetAxis(io_prims[left].centroid, bestAxis) - axisMin) * scale), k_BinsCount - 1);
+		if (b <= bestBin)
+		{
+			left++;
+		}
+		else
+		{
+			right--;
+			BuildPrimitive tmp = io_prims[left];
+			io_prims[left] = io_prims[right];
+			io_prims[right] = tmp;
+		}
+	}
+	return left;
+}
+
+/*
+ * Object median split along the longest centroid axis, used deep in the tree where the SAH split
+ * could keep peeling a few triangles per level and overflow the traversal stack.
+ */
+static const u32 MedianSplitRange(BuildPrimitive* io_prims, const u32 i_begin, const u32 i_end)
+{
+	const u32 count = i_end - i_begin;
+	if (count <= k_MaxLeafTriangles)
+	{
+		return i_begin;
+	}
+
+	floral::vec3f cMin(FLT_MAX), cMax(-FLT_MAX);
+	for (u32 i = i_begin; i < i_end; i++)
+	{
+		ExpandBounds(cMin, cMax, io_prims[i].centroid);
+	}
+	const floral::vec3f extent = cMax - cMin;
+	const u32 axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+	const u32 mid = i_begin + count / 2;
+	std::nth_element(io_prims + i_begin, io_prims + mid, io_prims + i_end,
+			[axis](const BuildPrimitive& i_a, const BuildPrimitive& i_b) {
+				return GetAxis(i_a.centroid, axis) < GetAxis(i_b.centroid, axis);
+			});
+	return mid;
+}
+
+const size GetBakeAccelDataSize(const u32 i_trianglesCount)
+{
+	if (i_trianglesCount == 0)
+	{
+		return 0;
+	}
+	// a binary tree with at least 1 triangle per leaf has at most 2n - 1 nodes
+	return sizeof(BVHNode) * (i_trianglesCount * 2 - 1) + sizeof(BVHTriangle) * i_trianglesCount + SIZE_KB(1);
+}
+
+const size GetBakeAccelScratchSize(const u32 i_trianglesCount)
+{
+	if (i_trianglesCount == 0)
+	{
+		return SIZE_KB(1);
+	}
+	const size maxNodes = i_trianglesCount * 2 - 1;
+	return sizeof(BuildPrimitive) * i_trianglesCount + (sizeof(BVHNode) + sizeof(BuildRange)) * maxNodes + SIZE_KB(4);
+}
+
+const BakeAccel BuildBakeAccel(const BakeScene& i_scene, stone::LinearArena* i_dataArena, stone::FreelistArena* i_scratchArena)
+{
+	BakeAccel accel;
+	memset(&accel, 0, sizeof(BakeAccel));
+
+	const u32 trianglesCount = i_scene.indicesCount / 3;
+	if (trianglesCount == 0)
+	{
+		return accel;
+	}
+
+	BuildPrimitive* prims = i_scratchArena->allocate_array<BuildPrimitive>(trianglesCount);
+	for (u32 i = 0; i < trianglesCount; i++)
+	{
+		const floral::vec3f& v0 = GetPosition(i_scene, i_scene.indices[i * 3]);
+		const floral::vec3f& v1 = GetPosition(i_scene, i_scene.indices[i * 3 + 1]);
+		const floral::vec3f& v2 = GetPosition(i_scene, i_scene.indices[i * 3 + 2]);
+		BuildPrimitive& prim = prims[i];
+		prim.minCorner = v0;
+		prim.maxCorner = v0;
+		ExpandBounds(prim.minCorner, prim.maxCorner, v1);
+		ExpandBounds(prim.minCorner, prim.maxCorner, v2);
+		prim.centroid = (prim.minCorner + prim.maxCorner) * 0.5f;
+		prim.triangle = i;
+	}
+
+	// a binary tree with at least 1 triangle per leaf has at most 2n - 1 nodes
+	const u32 maxNodes = trianglesCount * 2 - 1;
+	BVHNode* nodes = i_scratchArena->allocate_array<BVHNode>(maxNodes);
+	BuildRange* stack = i_scratchArena->allocate_array<BuildRange>(maxNodes);
+	u32 nodesCount = 1;
+	u32 stackSize = 0;
+	stack[stackSize++] = { 0, 0, trianglesCount, 0 };
+
+	while (stackSize > 0)
+	{
+		const BuildRange range = stack[--stackSize];
+		BVHNode& node = nodes[range.node];
+		node.minCorner = floral::vec3f(FLT_MAX);
+		node.maxCorner = floral::vec3f(-FLT_MAX);
+		for (u32 i = range.begin; i < range.end; i++)
+		{
+			ExpandBounds(node.minCorner, node.maxCorner, prims[i].minCorner);
+			ExpandBounds(node.minCorner, node.maxCorner, prims[i].maxCorner);
+		}
+
+		u32 mid = range.begin;
+		if (range.depth < k_MedianSplitDepth)
+		{
+			mid = SplitRange(prims, range.begin, range.end, node.minCorner, node.maxCorner);
+		}
+		else if (range.depth < k_MaxBuildDepth)
+		{
+			mid = MedianSplitRange(prims, range.begin, range.end);
+		}
+
+		if (mid == range.begin)
+		{
+			node.firstChildOrTriangle = range.begin;
+			node.trianglesCount = range.end - range.begin;
+			continue;
+		}
+
+		node.firstChildOrTriangle = nodesCount;
+		node.trianglesCount = 0;
+		stack[stackSize++] = { nodesCount, range.begin, mid, range.depth + 1 };
+		stack[stackSize++] = { nodesCount + 1, mid, range.end, range.depth + 1 };
+		nodesCount += 2;
+	}
+
+	accel.nodes = i_dataArena->allocate_array<BVHNode>(nodesCount);
+	memcpy(accel.nodes, nodes, sizeof(BVHNode) * nodesCount);
+	accel.nodesCount = nodesCount;
+
+	accel.triangles = i_dataArena->allocate_array<BVHTriangle>(trianglesCount);
+	accel.trianglesCount = trianglesCount;
+	for (u32 i = 0; i < trianglesCount; i++)
+	{
+		const u32 t = prims[i].triangle;
+		const floral::vec3f& v0 = GetPosition(i_scene, i_scene.indices[t * 3]);
+		BVHTriangle& tri = accel.triangles[i];
+		tri.v0 = v0;
+		tri.edge1 = GetPosition(i_scene, i_scene.indices[t * 3 + 1]) - v0;
+		tri.edge2 = GetPosition(i_scene, i_scene.indices[t * 3 + 2]) - v0;
+		tri.sourceTriangle = t;
+	}
+
+	i_scratchArena->free(stack);
+	i_scratchArena->free(nodes);
+	i_scratchArena->free(prims);
+	return accel;
+}
+
+// ------------------------------------------------------------------
+
+struct Ray
+{
+	floral::vec3f								origin;
+	floral::vec3f								direction;
+	floral::vec3f								invDirection;
+};
+
+struct Hit
+{
+	f32											t;
+	f32											u;
+	f32											v;
+	u32											triangle;			// index into BakeAccel::triangles
+};
+
+static inline const Ray MakeRay(const floral::vec3f& i_origin, const floral::vec3f& i_direction)
+{
+	Ray ray;
+	ray.origin = i_origin;
+	ray.direction = i_direction;
+	// inf for axis aligned rays is fine for the slab test
+	ray.invDirection = floral::vec3f(1.0f / i_direction.x, 1.0f / i_direction.y, 1.0f / i_direction.z);
+	return ray;
+}
+
+static inline const f32 IntersectAABB(const Ray& i_ray, const floral::vec3f& i_min, const floral::vec3f& i_max, const f32 i_tMax)
+{
+	const f32 tx0 = (i_min.x - i_ray.origin.x) * i_ray.invDirection.x;
+	const f32 tx1 = (i_max.x - i_ray.origin.x) * i_ray.invDirection.x;
+	const f32 ty0 = (i_min.y - i_ray.origin.y) * i_ray.invDirection.y;
+	const f32 ty1 = (i_max.y - i_ray.origin.y) * i_ray.invDirection.y;
+	const f32 tz0 = (i_min.z - i_ray.origin.z) * i_ray.invDirection.z;
+	const f32 tz1 = (i_max.z - i_ray.origin.z) * i_ray.invDirection.z;
+	const f32 tNear = floral::max(floral::max(floral::min(tx0, tx1), floral::min(ty0, ty1)), floral::max(floral::min(tz0, tz1), 0.0f));
+	const f32 tFar = floral::min(floral::min(floral::max(tx0, tx1), floral::max(ty0, ty1)), floral::min(floral::max(tz0, tz1), i_tMax));
+	return tNear <= tFar ? tNear : FLT_MAX;
+}
+
+// Moller-Trumbore, two sided
+static inline const bool IntersectTriangle(const Ray& i_ray, const BVHTriangle& i_tri, Hit& io_hit)
+{
+	const floral::vec3f p = floral::cross(i_ray.direction, i_tri.edge2);
+	const f32 det = floral::dot(i_tri.edge1, p);
+	if (fabsf(det) < 1e-12f)
+	{
+		return false;
+	}
+
+	const f32 invDet = 1.0f / det;
+	const floral::vec3f s = i_ray.origin - i_tri.v0;
+	const f32 u = floral::dot(s, p) * invDet;
+	if (u < 0.0f || u > 1.0f)
+	{
+		return false;
+	}
+
+	const floral::vec3f q = floral::cross(s, i_tri.edge1);
+	const f32 v = floral::dot(i_ray.direction, q) * invDet;
+	if (v < 0.0f || u + v > 1.0f)
+	{
+		return false;
+	}
+
+	const f32 t = floral::dot(i_tri.edge2, q) * invDet;
+	if (t <= 0.0f || t >= io_hit.t)
+	{
+		return false;
+	}
+
+	io_hit.t = t;
+	io_hit.u = u;
+	io_hit.v = v;
+	return true;
+}
+
+static const bool TraceClosest(const BakeAccel& i_accel, const Ray& i_ray, Hit& o_hit)
+{
+	o_hit.t = FLT_MAX;
+	o_hit.triangle = 0;
+	bool hasHit = false;
+
+	u32 stack[k_TraversalStackSize];
+	u32 stackSize = 0;
+	if (IntersectAABB(i_ray, i_accel.nodes[0].minCorner, i_accel.nodes[0].maxCorner, o_hit.t) == FLT_MAX)
+	{
+		return false;
+	}
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const BVHNode& node = i_accel.nodes[stack[--stackSize]];
+		if (node.trianglesCount > 0)
+		{
+			for (u32 i = 0; i < node.trianglesCount; i++)
+			{
+				const u32 t = node.firstChildOrTriangle + i;
+				if (IntersectTriangle(i_ray, i_accel.triangles[t], o_hit))
+				{
+					o_hit.triangle = t;
+					hasHit = true;
+				}
+			}
+			continue;
+		}
+
+		// visit the nearer child first
+		const u32 left = node.firstChildOrTriangle;
+		const u32 right = left + 1;
+		const f32 tLeft = IntersectAABB(i_ray, i_accel.nodes[left].minCorner, i_accel.nodes[left].maxCorner, o_hit.t);
+		const f32 tRight = IntersectAABB(i_ray, i_accel.nodes[right].minCorner, i_accel.nodes[right].maxCorner, o_hit.t);
+		FLORAL_ASSERT(stackSize + 2 <= k_TraversalStackSize);
+		if (tLeft < tRight)
+		{
+			if (tRight != FLT_MAX) stack[stackSize++] = right;
+			stack[stackSize++] = left;
+		}
+		else
+		{
+			if (tLeft != FLT_MAX) stack[stackSize++] = left;
+			if (tRight != FLT_MAX) stack[stackSize++] = right;
+		}
+	}
+
+	return hasHit;
+}
+
+// ------------------------------------------------------------------
+
+// same basis and sign convention as stone::tech::EvalSHBasis so both bakers are interchangeable
+static inline void EvalSHBasis(const floral::vec3f& i_dir, f32* o_basis)
+{
+	const f32 x = i_dir.x, y = i_dir.y, z = i_dir.z;
+	o_basis[0] = 0.282094792f;
+	o_basis[1] = -0.488602512f * y;
+	o_basis[2] = 0.488602512f * z;
+	o_basis[3] = -0.488602512f * x;
+	o_basis[4] = 1.092548431f * x * y;
+	o_basis[5] = -1.092548431f * y * z;
+	o_basis[6] = 0.315391565f * (3.0f * z * z - 1.0f);
+	o_basis[7] = -1.092548431f * x * z;
+	o_basis[8] = 0.546274215f * (x * x - y * y);
+}
+
+// pcg32, one stream per probe so the results do not depend on the task split
+struct Random
+{
+	u64											state;
+	u64											increment;
+};
+
+static inline const u32 NextRandom(Random& io_rng)
+{
+	const u64 oldState = io_rng.state;
+	io_rng.state = oldState * 6364136223846793005ULL + io_rng.increment;
+	const u32 xorShifted = (u32)(((oldState >> 18u) ^ oldState) >> 27u);
+	const u32 rot = (u32)(oldState >> 59u);
+	return (xorShifted >> rot) | (xorShifted << ((32 - rot) & 31));
+}
+
+static inline const f32 NextRandomFloat(Random& io_rng)
+{
+	return (NextRandom(io_rng) >> 8) * (1.0f / 16777216.0f);
+}
+
+static inline void SeedRandom(Random& o_rng, const u32 i_seed, const u32 i_stream)
+{
+	o_rng.state = 0;
+	o_rng.increment = ((u64)i_stream << 1u) | 1u;
+	NextRandom(o_rng);
+	o_rng.state += i_seed;
+	NextRandom(o_rng);
+}
+
+static inline const floral::vec3f UniformSphere(const f32 i_u, const f32 i_v)
+{
+	const f32 z = 1.0f - 2.0f * i_u;
+	const f32 r = sqrtf(floral::max(0.0f, 1.0f - z * z));
+	const f32 phi = 2.0f * k_Pi * i_v;
+	return floral::vec3f(r * cosf(phi), r * sinf(phi), z);
+}
+
+static inline const floral::vec3f CosineHemisphere(const floral::vec3f& i_normal, const f32 i_u, const f32 i_v)
+{
+	// Duff et al., "Building an Orthonormal Basis, Revisited"
+	const f32 sign = copysignf(1.0f, i_normal.z);
+	const f32 a = -1.0f / (sign + i_normal.z);
+	const f32 b = i_normal.x * i_normal.y * a;
+	const floral::vec3f t(1.0f + sign * i_normal.x * i_normal.x * a, sign * b, -sign * i_normal.x);
+	const floral::vec3f bt(b, sign + i_normal.y * i_normal.y * a, -i_normal.y);
+
+	const f32 r = sqrtf(i_u);
+	const f32 phi = 2.0f * k_Pi * i_v;
+	const f32 lx = r * cosf(phi);
+	const f32 ly = r * sinf(phi);
+	const f32 lz = sqrtf(floral::max(0.0f, 1.0f - i_u));
+	return t * lx + bt * ly + i_normal * lz;
+}
+
+struct SurfacePoint
+{
+	floral::vec3f								position;
+	floral::vec3f								normal;			// faces the incoming ray
+	floral::vec3f								color;
+	floral::vec3f								emission;
+};
+
+static void GetSurfacePoint(const BakeScene& i_scene, const BakeAccel& i_accel, const Ray& i_ray, const Hit& i_hit, SurfacePoint& o_sp)
+{
+	const BVHTriangle& tri = i_accel.triangles[i_hit.triangle];
+	const u32* idx = &i_scene.indices[tri.sourceTriangle * 3];
+	const f32 w = 1.0f - i_hit.u - i_hit.v;
+
+	o_sp.position = i_ray.origin + i_ray.direction * i_hit.t;
+	floral::vec3f n = floral::normalize(floral::cross(tri.edge1, tri.edge2));
+	o_sp.normal = floral::dot(n, i_ray.direction) > 0.0f ? -n : n;
+
+	const floral::vec4f& c0 = GetColor(i_scene, idx[0]);
+	const floral::vec4f& c1 = GetColor(i_scene, idx[1]);
+	const floral::vec4f& c2 = GetColor(i_scene, idx[2]);
+	o_sp.color = floral::vec3f(
+			c0.x * w + c1.x * i_hit.u + c2.x * i_hit.v,
+			c0.y * w + c1.y * i_hit.u + c2.y * i_hit.v,
+			c0.z * w + c1.z * i_hit.u + c2.z * i_hit.v);
+
+	if (i_scene.emissions)
+	{
+		o_sp.emission = GetEmission(i_scene, idx[0]) * w + GetEmission(i_scene, idx[1]) * i_hit.u + GetEmission(i_scene, idx[2]) * i_hit.v;
+	}
+	else
+	{
+		o_sp.emission = floral::vec3f(0.0f);
+	}
+}
+
+static const floral::vec3f TraceRadiance(const BakeScene& i_scene, const BakeAccel& i_accel, const BakeOptions& i_options,
+		const floral::vec3f& i_origin, const floral::vec3f& i_direction, Random& io_rng)
+{
+	Ray ray = MakeRay(i_origin, i_direction);
+	Hit hit;
+	SurfacePoint sp;
+
+	if (i_options.mode == BakeMode::VertexColorRadiance)
+	{
+		if (!TraceClosest(i_accel, ray, hit))
+		{
+			return i_options.skyRadiance;
+		}
+		GetSurfacePoint(i_scene, i_accel, ray, hit, sp);
+		return sp.color;
+	}
+
+	floral::vec3f radiance(0.0f);
+	floral::vec3f throughput(1.0f);
+	for (u32 bounce = 0; bounce <= i_options.maxBounces; bounce++)
+	{
+		if (!TraceClosest(i_accel, ray, hit))
+		{
+			radiance += floral::vec3f(throughput.x * i_options.skyRadiance.x,
+					throughput.y * i_options.skyRadiance.y, throughput.z * i_options.skyRadiance.z);
+			break;
+		}
+
+		GetSurfacePoint(i_scene, i_accel, ray, hit, sp);
+		radiance += floral::vec3f(throughput.x * sp.emission.x, throughput.y * sp.emission.y, throughput.z * sp.emission.z);
+		if (bounce == i_options.maxBounces)
+		{
+			break;
+		}
+
+		// lambertian with cosine sampling: brdf * cos / pdf == albedo
+		throughput = floral::vec3f(throughput.x * sp.color.x, throughput.y * sp.color.y, throughput.z * sp.color.z);
+		const f32 maxThroughput = floral::max(throughput.x, floral::max(throughput.y, throughput.z));
+		if (maxThroughput <= 0.0f)
+		{
+			break;
+		}
+
+		// russian roulette after the first bounce
+		if (bounce > 0 && maxThroughput < 1.0f)
+		{
+			if (NextRandomFloat(io_rng) >= maxThroughput)
+			{
+				break;
+			}
+			throughput *= 1.0f / maxThroughput;
+		}
+
+		const f32 u = NextRandomFloat(io_rng);
+		const f32 v = NextRandomFloat(io_rng);
+		const floral::vec3f dir = CosineHemisphere(sp.normal, u, v);
+		ray = MakeRay(sp.position + sp.normal * i_options.rayOffset, dir);
+	}
+
+	return radiance;
+}
+
+void BakeProbeRange(const BakeScene& i_scene, const BakeAccel& i_accel, const BakeOptions& i_options,
+		const floral::vec3f* i_probePositions, SH9* o_sh, const u32 i_begin, const u32 i_end)
+{
+	const u32 sqrtSamples = floral::max(i_options.sqrtSamplesPerProbe, 1u);
+	const f32 invSqrtSamples = 1.0f / sqrtSamples;
+	// uniform sphere sampling: pdf = 1 / (4 * pi)
+	const f32 weight = 4.0f * k_Pi / (sqrtSamples * sqrtSamples);
+
+	for (u32 p = i_begin; p < i_end; p++)
+	{
+		SH9& sh = o_sh[p];
+		for (u32 i = 0; i < 9; i++)
+		{
+			sh.coeffs[i] = floral::vec3f(0.0f);
+		}
+
+		if (i_accel.nodesCount == 0)
+		{
+			continue;
+		}
+
+		Random rng;
+		SeedRandom(rng, i_options.seed, p);
+
+		// stratified directions
+		for (u32 sy = 0; sy < sqrtSamples; sy++)
+		{
+			for (u32 sx = 0; sx < sqrtSamples; sx++)
+			{
+				const f32 u = (sy + NextRandomFloat(rng)) * invSqrtSamples;
+				const f32 v = (sx + NextRandomFloat(rng)) * invSqrtSamples;
+				const floral::vec3f dir = UniformSphere(u, v);
+				const floral::vec3f radiance = TraceRadiance(i_scene, i_accel, i_options, i_probePositions[p], dir, rng);
+
+				f32 basis[9];
+				EvalSHBasis(dir, basis);
+				for (u32 i = 0; i < 9; i++)
+				{
+					sh.coeffs[i] += radiance * basis[i];
+				}
+			}
+		}
+
+		for (u32 i = 0; i < 9; i++)
+		{
+			sh.coeffs[i] *= weight;
+		}
+	}
+}
+
+// ------------------------------------------------------------------
+
+struct BakeTaskData
+{
+	const BakeScene*							scene;
+	const BakeAccel*							accel;
+	const BakeOptions*							options;
+	const floral::vec3f*						probePositions;
+	SH9*										sh;
+	u32											begin;
+	u32											end;
+};
+
+static refrain2::Task BakeProbesTask(voidptr i_data)
+{
+	BakeTaskData* data = (BakeTaskData*)i_data;
+	BakeProbeRange(*data->scene, *data->accel, *data->options, data->probePositions, data->sh, data->begin, data->end);
+	return refrain2::Task();
+}
+
+struct ThreadedBakeJob
+{
+	const BakeScene*							scene;
+	const BakeAccel*							accel;
+	const BakeOptions*							options;
+	const floral::vec3f*						probePositions;
+	SH9*										sh;
+	u32											probesCount;
+	u32											probesPerTask;
+	std::atomic<u32>							nextProbe;
+};
+
+static void BakeProbesWorker(ThreadedBakeJob* io_job)
+{
+	while (true)
+	{
+		const u32 begin = io_job->nextProbe.fetch_add(io_job->probesPerTask);
+		if (begin >= io_job->probesCount)
+		{
+			break;
+		}
+		const u32 end = floral::min(begin + io_job->probesPerTask, io_job->probesCount);
+		BakeProbeRange(*io_job->scene, *io_job->accel, *io_job->options, io_job->probePositions, io_job->sh, begin, end);
+	}
+}
+
+const size GetBakeProbesScratchSize(const u32 i_probesCount, const BakeOptions& i_options)
+{
+	const u32 probesPerTask = floral::max(i_options.probesPerTask, 1u);
+	const u32 tasksCount = (i_probesCount + probesPerTask - 1) / probesPerTask;
+	return sizeof(BakeTaskData) * tasksCount + SIZE_KB(1);
+}
+
+void BakeProbes(const BakeScene& i_scene, const BakeAccel& i_accel, const BakeOptions& i_options,
+		const floral::vec3f* i_probePositions, SH9* o_sh, const u32 i_probesCount,
+		stone::FreelistArena* i_scratchArena)
+{
+	if (i_probesCount == 0)
+	{
+		return;
+	}
+
+	const u32 probesPerTask = floral::max(i_options.probesPerTask, 1u);
+	const u32 tasksCount = (i_probesCount + probesPerTask - 1) / probesPerTask;
+	// offline tools (probebaker) do not start the refrain2 workers, they ask for plain threads instead
+	if (tasksCount == 1 || refrain2::g_TaskManager == nullptr)
+	{
+		const u32 threadsCount = floral::min(floral::min(i_options.threadsCount, tasksCount), k_MaxBakeThreads);
+		if (threadsCount <= 1)
+		{
+			BakeProbeRange(i_scene, i_accel, i_options, i_probePositions, o_sh, 0, i_probesCount);
+			return;
+		}
+
+		ThreadedBakeJob job;
+		job.scene = &i_scene;
+		job.accel = &i_accel;
+		job.options = &i_options;
+		job.probePositions = i_probePositions;
+		job.sh = o_sh;
+		job.probesCount = i_probesCount;
+		job.probesPerTask = probesPerTask;
+		job.nextProbe = 0;
+
+		std::thread threads[k_MaxBakeThreads];
+		for (u32 i = 1; i < threadsCount; i++)
+		{
+			threads[i] = std::thread(&BakeProbesWorker, &job);
+		}
+		BakeProbesWorker(&job);
+		for (u32 i = 1; i < threadsCount; i++)
+		{
+			threads[i].join();
+		}
+		return;
+	}
+
+	BakeTaskData* taskData = i_scratchArena->allocate_array<BakeTaskData>(tasksCount);
+	std::atomic<u32> counter(tasksCount);
+	for (u32 i = 0; i < tasksCount; i++)
+	{
+		BakeTaskData& data = taskData[i];
+		data.scene = &i_scene;
+		data.accel = &i_accel;
+		data.options = &i_options;
+		data.probePositions = i_probePositions;
+		data.sh = o_sh;
+		data.begin = i * probesPerTask;
+		data.end = floral::min(data.begin + probesPerTask, i_probesCount);
+
+		refrain2::Task newTask;
+		newTask.pm_Instruction = &BakeProbesTask;
+		newTask.pm_Data = &data;
+		newTask.pm_Counter = &counter;
+		refrain2::g_TaskManager->PushTask(newTask);
+	}
+	refrain2::BusyWaitForCounter(counter, 0);
+
+	i_scratchArena->free(taskData);
+}
+
+// ------------------------------------------------------------------
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+#include <floral/gpds/vec.h>
+
+#include "Memory/MemorySystem.h"
+#include "Graphics/LightProbeVolume.h"
+
+namespace lightprobe
+{
+// ------------------------------------------------------------------
+
+/*
+ * CPU ground truth probe baker, does not touch insigne so it can run headless.
+ * The scene is a triangle soup with per vertex albedo (rgb of the vertex color) and an optional
+ * per vertex emission.
+ */
+struct BakeScene
+{
+	const floral::vec3f*						positions;
+	size										positionStride;
+	const floral::vec4f*						colors;
+	size										colorStride;
+	const floral::vec3f*						emissions;			// optional, may be nullptr
+	size										emissionStride;
+	u32											verticesCount;
+
+	const u32*									indices;
+	u32											indicesCount;
+};
+
+enum class BakeMode
+{
+	VertexColorRadiance = 0,					// the vertex color is the outgoing radiance, same as the GPU cubemap capture
+	PathTraced									// lambertian path tracing with emission and sky
+};
+
+struct BakeOptions
+{
+	BakeMode									mode;
+	u32											sqrtSamplesPerProbe;	// stratified directions per probe = sqrt * sqrt
+	u32											maxBounces;
+	floral::vec3f								skyRadiance;			// radiance of rays escaping the scene
+	f32											rayOffset;
+	u32											seed;
+	u32											probesPerTask;
+	u32											threadsCount;			// std::thread workers when refrain2 is not running
+};
+
+const BakeOptions								GetDefaultBakeOptions();
+
+// ------------------------------------------------------------------
+
+struct BVHNode
+{
+	floral::vec3f								minCorner;
+	u32											firstChildOrTriangle;	// inner: left child (right is +1), leaf: first triangle
+	floral::vec3f								maxCorner;
+	u32											trianglesCount;			// 0 for inner nodes
+};
+
+struct BVHTriangle
+{
+	floral::vec3f								v0;
+	floral::vec3f								edge1;
+	floral::vec3f								edge2;
+	u32											sourceTriangle;
+};
+
+struct BakeAccel
+{
+	BVHNode*									nodes;
+	u32											nodesCount;
+	BVHTriangle*								triangles;				// reordered to match the leaves
+	u32											trianglesCount;
+};
+
+// bytes BuildBakeAccel needs for i_trianglesCount triangles, in its data arena and in its scratch arena
+const size										GetBakeAccelDataSize(const u32 i_trianglesCount);
+const size										GetBakeAccelScratchSize(const u32 i_trianglesCount);
+
+// binned SAH BVH over the scene triangles, deep ranges fall back to median splits so traversal never needs more than 64 stack entries
+const BakeAccel									BuildBakeAccel(const BakeScene& i_scene, stone::LinearArena* i_dataArena, stone::FreelistArena* i_scratchArena);
+
+/*
+ * Bakes probes [i_begin, i_end) on the calling thread, results only depend on the probe index and
+ * the seed, so any split of the probes over threads gives the same output.
+ */
+void											BakeProbeRange(const BakeScene& i_scene, const BakeAccel& i_accel, const BakeOptions& i_options,
+													const floral::vec3f* i_probePositions, SH9* o_sh, const u32 i_begin, const u32 i_end);
+
+const size										GetBakeProbesScratchSize(const u32 i_probesCount, const BakeOptions& i_options);
+
+// spreads the probes over the refrain2 workers and waits for them, over i_options.threadsCount std::threads when they are not running
+void											BakeProbes(const BakeScene& i_scene, const BakeAccel& i_accel, const BakeOptions& i_options,
+													const floral::vec3f* i_probePositions, SH9* o_sh, const u32 i_probesCount,
+													stone::FreelistArena* i_scratchArena);
+
+// ------------------------------------------------------------------
+}
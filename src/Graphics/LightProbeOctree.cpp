@@ -0,0 +1,680 @@
+#include "LightProbeOctree.h"
+
+#include <string.h>
+#include <math.h>
+
+#include <atomic>
+#include <algorithm>
+#include <thread>
+
+#include <floral/assert/assert.h>
+
+#include <refrain2.h>
+
+namespace lightprobe
+{
+// ------------------------------------------------------------------
+
+static const u32								k_MaxTasksPerLevel = 64;
+static const u32								k_MaxBuildThreads = 64;
+
+struct PackedTriangle
+{
+	floral::vec3f								v0, v1, v2;
+	floral::vec3f								minCorner, maxCorner;
+};
+
+// a contiguous range of triangle references of a single splitting octant
+struct BinningItem
+{
+	const u32*									triangleIds;
+	u8*											childMasks;
+	u32											count;
+	floral::vec3f								nodeMinCorner;
+	floral::vec3f								nodeMaxCorner;
+
+	u32											childCounts[8];
+	u32											childCursors[8];
+};
+
+struct BinningTaskData
+{
+	const PackedTriangle*						triangles;
+	BinningItem*								items;
+	u32											itemsBegin;
+	u32											itemsEnd;
+	u32*										nextTriangleIds;
+};
+
+// ------------------------------------------------------------------
+
+static inline const bool AxisSeparates(const floral::vec3f& i_axis,
+		const floral::vec3f& i_v0, const floral::vec3f& i_v1, const floral::vec3f& i_v2, const floral::vec3f& i_halfSize)
+{
+	const f32 p0 = floral::dot(i_axis, i_v0);
+	const f32 p1 = floral::dot(i_axis, i_v1);
+	const f32 p2 = floral::dot(i_axis, i_v2);
+	const f32 r = i_halfSize.x * fabsf(i_axis.x) + i_halfSize.y * fabsf(i_axis.y) + i_halfSize.z * fabsf(i_axis.z);
+	const f32 minP = floral::min(p0, floral::min(p1, p2));
+	const f32 maxP = floral::max(p0, floral::max(p1, p2));
+	return (minP > r || maxP < -r);
+}
+
+// Akenine-Moller, "Fast 3D Triangle-Box Overlap Testing"
+const bool TriangleAABBOverlap(const floral::vec3f& i_v0, const floral::vec3f& i_v1, const floral::vec3f& i_v2,
+		const floral::vec3f& i_boxCenter, const floral::vec3f& i_boxHalfSize)
+{
+	const floral::vec3f v0 = i_v0 - i_boxCenter;
+	const floral::vec3f v1 = i_v1 - i_boxCenter;
+	const floral::vec3f v2 = i_v2 - i_boxCenter;
+
+	// 3 box face normals
+	if (floral::min(v0.x, floral::min(v1.x, v2.x)) > i_boxHalfSize.x || floral::max(v0.x, floral::max(v1.x, v2.x)) < -i_boxHalfSize.x) return false;
+	if (floral::min(v0.y, floral::min(v1.y, v2.y)) > i_boxHalfSize.y || floral::max(v0.y, floral::max(v1.y, v2.y)) < -i_boxHalfSize.y) return false;
+	if (floral::min(v0.z, floral::min(v1.z, v2.z)) > i_boxHalfSize.z || floral::max(v0.z, floral::max(v1.z, v2.z)) < -i_boxHalfSize.z) return false;
+
+	// 9 cross products of the triangle edges and the box axes
+	const floral::vec3f e[3] = { v1 - v0, v2 - v1, v0 - v2 };
+	for (u32 i = 0; i < 3; i++)
+	{
+		const floral::vec3f ax(0.0f, -e[i].z, e[i].y);
+		const floral::vec3f ay(e[i].z, 0.0f, -e[i].x);
+		const floral::vec3f az(-e[i].y, e[i].x, 0.0f);
+		if (AxisSeparates(ax, v0, v1, v2, i_boxHalfSize)) return false;
+		if (AxisSeparates(ay, v0, v1, v2, i_boxHalfSize)) return false;
+		if (AxisSeparates(az, v0, v1, v2, i_boxHalfSize)) return false;
+	}
+
+	// triangle plane
+	const floral::vec3f n = floral::cross(e[0], e[1]);
+	const f32 d = floral::dot(n, v0);
+	const f32 r = i_boxHalfSize.x * fabsf(n.x) + i_boxHalfSize.y * fabsf(n.y) + i_boxHalfSize.z * fabsf(n.z);
+	if (d > r || d < -r) return false;
+
+	return true;
+}
+
+// ------------------------------------------------------------------
+
+static inline const u8 ComputeChildMask(const PackedTriangle& i_tri, const floral::vec3f& i_nodeMin, const floral::vec3f& i_nodeMax)
+{
+	const floral::vec3f center = (i_nodeMin + i_nodeMax) * 0.5f;
+	const floral::vec3f childHalfSize = (i_nodeMax - i_nodeMin) * 0.25f;
+
+	// the triangle already overlaps the parent, so its AABB tells us which halves it can touch
+	const u32 lowX = i_tri.minCorner.x <= center.x ? 1 : 0;
+	const u32 highX = i_tri.maxCorner.x >= center.x ? 1 : 0;
+	const u32 lowY = i_tri.minCorner.y <= center.y ? 1 : 0;
+	const u32 highY = i_tri.maxCorner.y >= center.y ? 1 : 0;
+	const u32 lowZ = i_tri.minCorner.z <= center.z ? 1 : 0;
+	const u32 highZ = i_tri.maxCorner.z >= center.z ? 1 : 0;
+
+	u8 candidates = 0;
+	for (u32 c = 0; c < 8; c++)
+	{
+		const u32 inX = (c & 1) ? highX : lowX;
+		const u32 inY = (c & 2) ? highY : lowY;
+		const u32 inZ = (c & 4) ? highZ : lowZ;
+		if (inX & inY & inZ)
+		{
+			candidates |= u8(1u << c);
+		}
+	}
+
+	// a single candidate: the part of the triangle inside the parent lies entirely in that child
+	if ((candidates & (candidates - 1)) == 0)
+	{
+		return candidates;
+	}
+
+	u8 mask = 0;
+	for (u32 c = 0; c < 8; c++)
+	{
+		if ((candidates & (1u << c)) == 0)
+		{
+			continue;
+		}
+
+		const floral::vec3f childCenter(
+				(c & 1) ? center.x + childHalfSize.x : center.x - childHalfSize.x,
+				(c & 2) ? center.y + childHalfSize.y : center.y - childHalfSize.y,
+				(c & 4) ? center.z + childHalfSize.z : center.z - childHalfSize.z);
+		if (TriangleAABBOverlap(i_tri.v0, i_tri.v1, i_tri.v2, childCenter, childHalfSize))
+		{
+			mask |= u8(1u << c);
+		}
+	}
+	return mask;
+}
+
+static refrain2::Task CountChildrenTask(voidptr i_data)
+{
+	BinningTaskData* input = (BinningTaskData*)i_data;
+	const PackedTriangle* triangles = input->triangles;
+
+	for (u32 i = input->itemsBegin; i < input->itemsEnd; i++)
+	{
+		BinningItem& item = input->items[i];
+		memset(item.childCounts, 0, sizeof(item.childCounts));
+		for (u32 t = 0; t < item.count; t++)
+		{
+			const u8 mask = ComputeChildMask(triangles[item.triangleIds[t]], item.nodeMinCorner, item.nodeMaxCorner);
+			item.childMasks[t] = mask;
+			for (u32 c = 0; c < 8; c++)
+			{
+				item.childCounts[c] += (mask >> c) & 1;
+			}
+		}
+	}
+
+	return refrain2::Task();
+}
+
+static refrain2::Task ScatterChildrenTask(voidptr i_data)
+{
+	BinningTaskData* input = (BinningTaskData*)i_data;
+	u32* nextTriangleIds = input->nextTriangleIds;
+
+	for (u32 i = input->itemsBegin; i < input->itemsEnd; i++)
+	{
+		BinningItem& item = input->items[i];
+		for (u32 t = 0; t < item.count; t++)
+		{
+			const u8 mask = item.childMasks[t];
+			for (u32 c = 0; c < 8; c++)
+			{
+				if (mask & (1u << c))
+				{
+					nextTriangleIds[item.childCursors[c]++] = item.triangleIds[t];
+				}
+			}
+		}
+	}
+
+	return refrain2::Task();
+}
+
+struct ThreadedTasks
+{
+	refrain2::Task								(*instruction)(voidptr);
+	BinningTaskData*							taskData;
+	u32											tasksCount;
+	std::atomic<u32>							nextTask;
+};
+
+static void RunTasksWorker(ThreadedTasks* io_tasks)
+{
+	while (true)
+	{
+		const u32 taskIdx = io_tasks->nextTask.fetch_add(1);
+		if (taskIdx >= io_tasks->tasksCount)
+		{
+			break;
+		}
+		io_tasks->instruction(&io_tasks->taskData[taskIdx]);
+	}
+}
+
+static void RunTasks(refrain2::Task (*i_instruction)(voidptr), BinningTaskData* i_taskData, const u32 i_tasksCount,
+		const u32 i_threadsCount)
+{
+	// offline tools (probebaker) do not start the refrain2 workers, they ask for plain threads instead
+	if (i_tasksCount == 1 || refrain2::g_TaskManager == nullptr)
+	{
+		const u32 threadsCount = floral::min(floral::min(i_threadsCount, i_tasksCount), k_MaxBuildThreads);
+		if (threadsCount <= 1)
+		{
+			for (u32 i = 0; i < i_tasksCount; i++)
+			{
+				i_instruction(&i_taskData[i]);
+			}
+			return;
+		}
+
+		ThreadedTasks tasks;
+		tasks.instruction = i_instruction;
+		tasks.taskData = i_taskData;
+		tasks.tasksCount = i_tasksCount;
+		tasks.nextTask = 0;
+
+		std::thread threads[k_MaxBuildThreads];
+		for (u32 i = 1; i < threadsCount; i++)
+		{
+			threads[i] = std::thread(&RunTasksWorker, &tasks);
+		}
+		RunTasksWorker(&tasks);
+		for (u32 i = 1; i < threadsCount; i++)
+		{
+			threads[i].join();
+		}
+		return;
+	}
+
+	std::atomic<u32> counter(i_tasksCount);
+	for (u32 i = 0; i < i_tasksCount; i++)
+	{
+		refrain2::Task newTask;
+		newTask.pm_Instruction = i_instruction;
+		newTask.pm_Data = &i_taskData[i];
+		newTask.pm_Counter = &counter;
+		refrain2::g_TaskManager->PushTask(newTask);
+	}
+	refrain2::BusyWaitForCounter(counter, 0);
+}
+
+template <class T>
+static T* GrowArray(T* i_array, const u32 i_count, u32& io_capacity, const u32 i_requiredCapacity, const u32 i_maxCapacity,
+		stone::FreelistArena* i_arena)
+{
+	if (i_requiredCapacity <= io_capacity)
+	{
+		return i_array;
+	}
+
+	FLORAL_ASSERT(i_requiredCapacity <= i_maxCapacity);
+	u32 newCapacity = floral::min(floral::max(io_capacity * 2, i_requiredCapacity), i_maxCapacity);
+	T* newArray = i_arena->allocate_array<T>(newCapacity);
+	if (i_array)
+	{
+		memcpy(newArray, i_array, sizeof(T) * i_count);
+		i_arena->free(i_array);
+	}
+	io_capacity = newCapacity;
+	return newArray;
+}
+
+static inline const bool CanSplit(const OctreeNode& i_node, const u32 i_depth, const OctreeBuildOptions& i_options)
+{
+	return i_depth < i_options.maxDepth
+		&& i_node.trianglesCount > 0
+		&& (i_node.maxCorner.x - i_node.minCorner.x) >= i_options.minOctantSize;
+}
+
+static inline const u64 GetMaxReferencesCount(const u32 i_trianglesCount, const OctreeBuildOptions& i_options)
+{
+	return floral::max((u64)i_trianglesCount * i_options.maxReferencesPerTriangle, (u64)i_options.minReferencesCount);
+}
+
+static const u32 CountLeaves(const Octree& i_octree)
+{
+	u32 leavesCount = 0;
+	for (u32 i = 0; i < i_octree.nodesCount; i++)
+	{
+		const OctreeNode& node = i_octree.nodes[i];
+		if (node.firstChild == 0 && node.trianglesCount > 0)
+		{
+			leavesCount++;
+		}
+	}
+	return leavesCount;
+}
+
+// ------------------------------------------------------------------
+
+const OctreeBuildOptions GetDefaultOctreeBuildOptions()
+{
+	OctreeBuildOptions options;
+	options.minOctantSize = 0.8f;
+	options.rootPadding = 0.1f;
+	options.maxDepth = 16;
+	options.trianglesPerTask = 16384;
+	options.maxReferencesPerTriangle = 4;
+	options.minReferencesCount = 1u << 20;
+	options.maxNodesCount = 1u << 16;
+	options.threadsCount = 1;
+	return options;
+}
+
+const size GetOctreeScratchSize(const u32 i_trianglesCount, const OctreeBuildOptions& i_options)
+{
+	const size trianglesCount = floral::max(i_trianglesCount, 1u);
+	const size maxRefs = floral::max((size)GetMaxReferencesCount(i_trianglesCount, i_options), trianglesCount);
+	const size maxNodes = i_options.maxNodesCount;
+	const size maxItems = maxRefs / i_options.trianglesPerTask + maxNodes / 8 + 1;
+
+	size scratchSize = sizeof(PackedTriangle) * trianglesCount;
+	scratchSize += sizeof(OctreeNode) * maxNodes * 2;			// the node array and its grown copy
+	scratchSize += sizeof(u32) * maxRefs * 2;					// triangle references of this level and the next
+	scratchSize += sizeof(u8) * maxRefs;						// child masks
+	scratchSize += sizeof(u32) * maxNodes * 2;					// reference offsets of this level and the next
+	scratchSize += sizeof(BinningItem) * maxItems;
+	scratchSize += sizeof(BinningTaskData) * k_MaxTasksPerLevel;
+	// the freelist reuses the holes of the previous levels, leave room for fragmentation and the block headers
+	return scratchSize + scratchSize / 2 + SIZE_KB(64);
+}
+
+const Octree BuildOctree(const floral::vec3f* i_positions, const size i_posStride, const u32 i_verticesCount,
+		const u32* i_indices, const u32 i_indicesCount,
+		const OctreeBuildOptions& i_options,
+		stone::LinearArena* i_dataArena, stone::FreelistArena* i_scratchArena)
+{
+	FLORAL_ASSERT(i_indicesCount % 3 == 0);
+	FLORAL_ASSERT(i_options.trianglesPerTask > 0);
+	FLORAL_ASSERT(i_options.maxDepth <= 20);	// probe corners are packed as 3 x 21 bits keys
+	FLORAL_ASSERT(i_options.maxReferencesPerTriangle > 0);
+	FLORAL_ASSERT(i_options.maxNodesCount > 0);
+
+	Octree octree;
+	octree.nodes = nullptr;
+	octree.nodesCount = 0;
+	octree.depth = 0;
+
+	// scene AABB
+	floral::vec3f minCorner(9999.9f, 9999.9f, 9999.9f);
+	floral::vec3f maxCorner(-9999.9f, -9999.9f, -9999.9f);
+	for (u32 i = 0; i < i_verticesCount; i++)
+	{
+		const floral::vec3f& v = *(const floral::vec3f*)((aptr)i_positions + i * i_posStride);
+		minCorner.x = floral::min(minCorner.x, v.x);
+		minCorner.y = floral::min(minCorner.y, v.y);
+		minCorner.z = floral::min(minCorner.z, v.z);
+		maxCorner.x = floral::max(maxCorner.x, v.x);
+		maxCorner.y = floral::max(maxCorner.y, v.y);
+		maxCorner.z = floral::max(maxCorner.z, v.z);
+	}
+	octree.sceneAABB.min_corner = minCorner;
+	octree.sceneAABB.max_corner = maxCorner;
+
+	// gather the triangles once so the binning passes do not chase indices
+	const u32 trianglesCount = i_indicesCount / 3;
+	PackedTriangle* triangles = i_scratchArena->allocate_array<PackedTriangle>(trianglesCount);
+	for (u32 i = 0; i < trianglesCount; i++)
+	{
+		PackedTriangle& tri = triangles[i];
+		tri.v0 = *(const floral::vec3f*)((aptr)i_positions + i_indices[i * 3] * i_posStride);
+		tri.v1 = *(const floral::vec3f*)((aptr)i_positions + i_indices[i * 3 + 1] * i_posStride);
+		tri.v2 = *(const floral::vec3f*)((aptr)i_positions + i_indices[i * 3 + 2] * i_posStride);
+		tri.minCorner = floral::vec3f(
+				floral::min(tri.v0.x, floral::min(tri.v1.x, tri.v2.x)),
+				floral::min(tri.v0.y, floral::min(tri.v1.y, tri.v2.y)),
+				floral::min(tri.v0.z, floral::min(tri.v1.z, tri.v2.z)));
+		tri.maxCorner = floral::vec3f(
+				floral::max(tri.v0.x, floral::max(tri.v1.x, tri.v2.x)),
+				floral::max(tri.v0.y, floral::max(tri.v1.y, tri.v2.y)),
+				floral::max(tri.v0.z, floral::max(tri.v1.z, tri.v2.z)));
+	}
+
+	u32 nodesCapacity = 0;
+	OctreeNode* nodes = GrowArray<OctreeNode>(nullptr, 0, nodesCapacity, floral::min(64u, i_options.maxNodesCount),
+			i_options.maxNodesCount, i_scratchArena);
+	u32 nodesCount = 1;
+	nodes[0].minCorner = minCorner - floral::vec3f(i_options.rootPadding);
+	nodes[0].maxCorner = maxCorner + floral::vec3f(i_options.rootPadding);
+	nodes[0].firstChild = 0;
+	nodes[0].trianglesCount = trianglesCount;
+
+	// triangle references of the current level, grouped by octant, and the range of each octant
+	u32* levelTriangleIds = i_scratchArena->allocate_array<u32>(floral::max(trianglesCount, 1u));
+	for (u32 i = 0; i < trianglesCount; i++)
+	{
+		levelTriangleIds[i] = i;
+	}
+	u32* levelOffsets = i_scratchArena->allocate_array<u32>(1);
+	levelOffsets[0] = 0;
+
+	// the budgets of the options, they keep the scratch usage under GetOctreeScratchSize()
+	const u64 maxRefsCount = GetMaxReferencesCount(trianglesCount, i_options);
+
+	u32 levelBegin = 0;
+	u32 levelEnd = 1;
+	u32 depth = 0;
+	while (levelBegin < levelEnd)
+	{
+		// find the splitting octants of this level and chop their triangle ranges into work items
+		u32 splitsCount = 0;
+		u32 itemsCount = 0;
+		u32 refsCount = 0;
+		for (u32 i = levelBegin; i < levelEnd; i++)
+		{
+			const OctreeNode& node = nodes[i];
+			const bool canSplit = CanSplit(node, depth, i_options);
+			if (canSplit)
+			{
+				splitsCount++;
+				itemsCount += (node.trianglesCount + i_options.trianglesPerTask - 1) / i_options.trianglesPerTask;
+				refsCount += node.trianglesCount;
+			}
+		}
+
+		if (itemsCount == 0 || nodesCount + splitsCount * 8 > i_options.maxNodesCount)
+		{
+			break;
+		}
+
+		BinningItem* items = i_scratchArena->allocate_array<BinningItem>(itemsCount);
+		u8* childMasks = i_scratchArena->allocate_array<u8>(refsCount);
+		u32 itemIdx = 0;
+		u32 maskOffset = 0;
+		for (u32 i = levelBegin; i < levelEnd; i++)
+		{
+			const OctreeNode& node = nodes[i];
+			const bool canSplit = CanSplit(node, depth, i_options);
+			if (!canSplit)
+			{
+				continue;
+			}
+
+			const u32* nodeTriangleIds = &levelTriangleIds[levelOffsets[i - levelBegin]];
+			for (u32 t = 0; t < node.trianglesCount; t += i_options.trianglesPerTask)
+			{
+				BinningItem& item = items[itemIdx++];
+				item.triangleIds = nodeTriangleIds + t;
+				item.childMasks = childMasks + maskOffset;
+				item.count = floral::min(i_options.trianglesPerTask, node.trianglesCount - t);
+				item.nodeMinCorner = node.minCorner;
+				item.nodeMaxCorner = node.maxCorner;
+				maskOffset += item.count;
+			}
+		}
+
+		// pack the work items into a bounded number of tasks of similar size
+		BinningTaskData* taskData = i_scratchArena->allocate_array<BinningTaskData>(floral::min(itemsCount, k_MaxTasksPerLevel));
+		u32 tasksCount = 0;
+		{
+			const u32 refsPerTask = floral::max(i_options.trianglesPerTask, (refsCount + k_MaxTasksPerLevel - 1) / k_MaxTasksPerLevel);
+			u32 taskBegin = 0;
+			u32 taskRefs = 0;
+			for (u32 i = 0; i < itemsCount; i++)
+			{
+				taskRefs += items[i].count;
+				if (taskRefs >= refsPerTask || i == itemsCount - 1)
+				{
+					BinningTaskData& task = taskData[tasksCount++];
+					task.triangles = triangles;
+					task.items = items;
+					task.itemsBegin = taskBegin;
+					task.itemsEnd = i + 1;
+					task.nextTriangleIds = nullptr;
+					taskBegin = i + 1;
+					taskRefs = 0;
+				}
+			}
+			FLORAL_ASSERT(tasksCount <= k_MaxTasksPerLevel);
+		}
+
+		RunTasks(&CountChildrenTask, taskData, tasksCount, i_options.threadsCount);
+
+		// triangles straddling many octants multiply the references, the level is dropped if it goes over budget
+		u64 nextRefsTotal = 0;
+		for (u32 i = 0; i < itemsCount; i++)
+		{
+			for (u32 c = 0; c < 8; c++)
+			{
+				nextRefsTotal += items[i].childCounts[c];
+			}
+		}
+		if (nextRefsTotal > maxRefsCount)
+		{
+			i_scratchArena->free(taskData);
+			i_scratchArena->free(childMasks);
+			i_scratchArena->free(items);
+			break;
+		}
+
+		// create the children and reserve their ranges in the next level
+		nodes = GrowArray<OctreeNode>(nodes, nodesCount, nodesCapacity, nodesCount + splitsCount * 8,
+				i_options.maxNodesCount, i_scratchArena);
+		u32 nextLevelBegin = nodesCount;
+		u32 nextRefsCount = 0;
+		itemIdx = 0;
+		u32* nextLevelOffsets = i_scratchArena->allocate_array<u32>(splitsCount * 8);
+		for (u32 i = levelBegin; i < levelEnd; i++)
+		{
+			OctreeNode& node = nodes[i];
+			const bool canSplit = CanSplit(node, depth, i_options);
+			if (!canSplit)
+			{
+				continue;
+			}
+
+			const u32 nodeItemsCount = (node.trianglesCount + i_options.trianglesPerTask - 1) / i_options.trianglesPerTask;
+			const floral::vec3f center = (node.minCorner + node.maxCorner) * 0.5f;
+			node.firstChild = nodesCount;
+			for (u32 c = 0; c < 8; c++)
+			{
+				OctreeNode& child = nodes[nodesCount];
+				child.minCorner = floral::vec3f(
+						(c & 1) ? center.x : node.minCorner.x,
+						(c & 2) ? center.y : node.minCorner.y,
+						(c & 4) ? center.z : node.minCorner.z);
+				child.maxCorner = floral::vec3f(
+						(c & 1) ? node.maxCorner.x : center.x,
+						(c & 2) ? node.maxCorner.y : center.y,
+						(c & 4) ? node.maxCorner.z : center.z);
+				child.firstChild = 0;
+				child.trianglesCount = 0;
+				nextLevelOffsets[nodesCount - nextLevelBegin] = nextRefsCount;
+
+				// items of the same octant write their references in order, so the output is deterministic
+				for (u32 k = itemIdx; k < itemIdx + nodeItemsCount; k++)
+				{
+					items[k].childCursors[c] = nextRefsCount;
+					nextRefsCount += items[k].childCounts[c];
+					child.trianglesCount += items[k].childCounts[c];
+				}
+				nodesCount++;
+			}
+			itemIdx += nodeItemsCount;
+		}
+
+		u32* nextTriangleIds = i_scratchArena->allocate_array<u32>(floral::max(nextRefsCount, 1u));
+		for (u32 i = 0; i < tasksCount; i++)
+		{
+			taskData[i].nextTriangleIds = nextTriangleIds;
+		}
+		RunTasks(&ScatterChildrenTask, taskData, tasksCount, i_options.threadsCount);
+
+		i_scratchArena->free(taskData);
+		i_scratchArena->free(childMasks);
+		i_scratchArena->free(items);
+		i_scratchArena->free(levelOffsets);
+		i_scratchArena->free(levelTriangleIds);
+		levelTriangleIds = nextTriangleIds;
+		levelOffsets = nextLevelOffsets;
+
+		levelBegin = nextLevelBegin;
+		levelEnd = nodesCount;
+		depth++;
+	}
+
+	i_scratchArena->free(levelOffsets);
+	i_scratchArena->free(levelTriangleIds);
+	i_scratchArena->free(triangles);
+
+	octree.nodes = i_dataArena->allocate_array<OctreeNode>(nodesCount);
+	memcpy(octree.nodes, nodes, sizeof(OctreeNode) * nodesCount);
+	octree.nodesCount = nodesCount;
+	octree.depth = depth;
+	i_scratchArena->free(nodes);
+
+	return octree;
+}
+
+// ------------------------------------------------------------------
+
+const u32 GetMaxProbeLocationsCount(const Octree& i_octree)
+{
+	return CountLeaves(i_octree) * 8;
+}
+
+const size GetProbeExtractionScratchSize(const Octree& i_octree)
+{
+	return sizeof(u64) * GetMaxProbeLocationsCount(i_octree) + SIZE_KB(4);
+}
+
+const u32 ExtractProbeLocations(const Octree& i_octree, floral::vec3f* o_locations, const u32 i_maxLocations,
+		stone::FreelistArena* i_scratchArena)
+{
+	if (i_octree.nodesCount == 0)
+	{
+		return 0;
+	}
+
+	// every corner lies on the lattice of the deepest level, so we can dedup with integer keys
+	const OctreeNode& root = i_octree.nodes[0];
+	const f32 cellsPerAxis = (f32)(1u << i_octree.depth);
+	const floral::vec3f cellSize = (root.maxCorner - root.minCorner) / cellsPerAxis;
+	const floral::aabb3f& sceneAABB = i_octree.sceneAABB;
+
+	const u32 leavesCount = CountLeaves(i_octree);
+	if (leavesCount == 0)
+	{
+		return 0;
+	}
+
+	u64* keys = i_scratchArena->allocate_array<u64>(leavesCount * 8);
+	u32 keysCount = 0;
+	for (u32 i = 0; i < i_octree.nodesCount; i++)
+	{
+		const OctreeNode& node = i_octree.nodes[i];
+		if (node.firstChild != 0 || node.trianglesCount == 0)
+		{
+			continue;
+		}
+
+		for (u32 c = 0; c < 8; c++)
+		{
+			const floral::vec3f corner(
+					(c & 1) ? node.maxCorner.x : node.minCorner.x,
+					(c & 2) ? node.maxCorner.y : node.minCorner.y,
+					(c & 4) ? node.maxCorner.z : node.minCorner.z);
+			if (corner.x < sceneAABB.min_corner.x || corner.x > sceneAABB.max_corner.x
+					|| corner.y < sceneAABB.min_corner.y || corner.y > sceneAABB.max_corner.y
+					|| corner.z < sceneAABB.min_corner.z || corner.z > sceneAABB.max_corner.z)
+			{
+				continue;
+			}
+
+			const u64 kx = (u64)floorf((corner.x - root.minCorner.x) / cellSize.x + 0.5f);
+			const u64 ky = (u64)floorf((corner.y - root.minCorner.y) / cellSize.y + 0.5f);
+			const u64 kz = (u64)floorf((corner.z - root.minCorner.z) / cellSize.z + 0.5f);
+			keys[keysCount++] = kx | (ky << 21) | (kz << 42);
+		}
+	}
+
+	std::sort(keys, keys + keysCount);
+
+	u32 locationsCount = 0;
+	for (u32 i = 0; i < keysCount && locationsCount < i_maxLocations; i++)
+	{
+		if (i > 0 && keys[i] == keys[i - 1])
+		{
+			continue;
+		}
+
+		const u64 mask = (1ull << 21) - 1;
+		const f32 x = (f32)(keys[i] & mask);
+		const f32 y = (f32)((keys[i] >> 21) & mask);
+		const f32 z = (f32)((keys[i] >> 42) & mask);
+		o_locations[locationsCount++] = floral::vec3f(
+				root.minCorner.x + x * cellSize.x,
+				root.minCorner.y + y * cellSize.y,
+				root.minCorner.z + z * cellSize.z);
+	}
+
+	i_scratchArena->free(keys);
+	return locationsCount;
+}
+
+// ------------------------------------------------------------------
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+#include <floral/gpds/vec.h>
+#include <floral/gpds/rect.h>
+
+#include "Memory/MemorySystem.h"
+
+namespace lightprobe
+{
+// ------------------------------------------------------------------
+
+/*
+ * Flat octree used for light probe placement.
+ * - nodes are stored level by level (breadth first), the 8 children of a node are contiguous
+ *   and start at 'firstChild'
+ * - a leaf has firstChild == 0 (the root is always at index 0 so it cannot be anyone's child)
+ * - children order follows the bits of the child index: bit 0 = x, bit 1 = y, bit 2 = z
+ *   (bit set means the upper half of the parent along that axis)
+ */
+struct OctreeNode
+{
+	floral::vec3f								minCorner;
+	u32											firstChild;
+	floral::vec3f								maxCorner;
+	u32											trianglesCount;		// number of triangles overlapping this node
+};
+
+struct OctreeBuildOptions
+{
+	f32											minOctantSize;		// an octant smaller than this will not be split anymore
+	f32											rootPadding;		// extrapolate the scene AABB by this amount
+	u32											maxDepth;
+	u32											trianglesPerTask;	// granularity of the binning tasks
+	u32											maxReferencesPerTriangle;	// a level references at most max(this * trianglesCount, minReferencesCount)
+	u32											minReferencesCount;	// triangles, splitting stops before a level goes over that
+	u32											maxNodesCount;		// splitting stops before the octree grows past this
+	u32											threadsCount;		// std::thread workers for the binning when refrain2 is not running
+};
+
+struct Octree
+{
+	OctreeNode*									nodes;
+	u32											nodesCount;
+	u32											depth;
+	floral::aabb3f								sceneAABB;
+};
+
+const OctreeBuildOptions						GetDefaultOctreeBuildOptions();
+
+/*
+ * Upper bound of the scratch memory BuildOctree needs for i_trianglesCount triangles, the budgets
+ * of i_options (references and nodes) are what keep it bounded.
+ */
+const size										GetOctreeScratchSize(const u32 i_trianglesCount, const OctreeBuildOptions& i_options);
+
+/*
+ * Build the octree of a triangle soup.
+ * - i_positions: first position, vertices are i_posStride bytes apart
+ * - triangles are binned into the children of each splitting octant once per level
+ *   (SAT triangle - box test), the binning of a level runs on refrain2 workers when they are running,
+ *   on i_options.threadsCount std::threads otherwise
+ * - i_dataArena: the final node array will be allocated from here
+ * - i_scratchArena: temporary buffers, everything allocated from here is freed before returning,
+ *   at least GetOctreeScratchSize() bytes
+ */
+const Octree									BuildOctree(const floral::vec3f* i_positions, const size i_posStride, const u32 i_verticesCount,
+													const u32* i_indices, const u32 i_indicesCount,
+													const OctreeBuildOptions& i_options,
+													stone::LinearArena* i_dataArena, stone::FreelistArena* i_scratchArena);
+
+/*
+ * Probes are placed at the corners of the smallest octants that contain triangles,
+ * corners outside the scene AABB are rejected and shared corners are only reported once.
+ * Returns the number of probe locations written to o_locations.
+ * - o_locations: room for GetMaxProbeLocationsCount() locations will never be exceeded
+ * - i_scratchArena: at least GetProbeExtractionScratchSize() bytes
+ */
+const u32										GetMaxProbeLocationsCount(const Octree& i_octree);
+const size										GetProbeExtractionScratchSize(const Octree& i_octree);
+const u32										ExtractProbeLocations(const Octree& i_octree, floral::vec3f* o_locations, const u32 i_maxLocations,
+													stone::FreelistArena* i_scratchArena);
+
+const bool										TriangleAABBOverlap(const floral::vec3f& i_v0, const floral::vec3f& i_v1, const floral::vec3f& i_v2,
+													const floral::vec3f& i_boxCenter, const floral::vec3f& i_boxHalfSize);
+
+// ------------------------------------------------------------------
+}
@@ -0,0 +1,598 @@
+#include "LightProbeVolume.h"
+
+#include <string.h>
+#include <math.h>
+
+#include <floral/assert/assert.h>
+
+namespace lightprobe
+{
+// ------------------------------------------------------------------
+
+static inline void ClearSH(SH9& o_sh)
+{
+	for (u32 i = 0; i < 9; i++)
+	{
+		o_sh.coeffs[i] = floral::vec3f(0.0f);
+	}
+}
+
+static inline void AccumulateSH(SH9& io_sh, const SH9& i_sh, const f32 i_weight)
+{
+	for (u32 i = 0; i < 9; i++)
+	{
+		io_sh.coeffs[i] += i_sh.coeffs[i] * i_weight;
+	}
+}
+
+// ------------------------------------------------------------------
+
+const ProbeGrid CreateProbeGrid(const floral::vec3f& i_minCorner, const floral::vec3f& i_cellSize,
+		const u32 i_resX, const u32 i_resY, const u32 i_resZ, stone::LinearArena* i_dataArena)
+{
+	FLORAL_ASSERT(i_resX > 0 && i_resY > 0 && i_resZ > 0);
+	FLORAL_ASSERT(i_cellSize.x > 0.0f && i_cellSize.y > 0.0f && i_cellSize.z > 0.0f);
+
+	ProbeGrid grid;
+	grid.minCorner = i_minCorner;
+	grid.cellSize = i_cellSize;
+	grid.invCellSize = floral::vec3f(1.0f / i_cellSize.x, 1.0f / i_cellSize.y, 1.0f / i_cellSize.z);
+	grid.resolutionX = i_resX;
+	grid.resolutionY = i_resY;
+	grid.resolutionZ = i_resZ;
+	grid.probes = i_dataArena->allocate_array<SH9>(i_resX * i_resY * i_resZ);
+	return grid;
+}
+
+// returns the lower cell index and the interpolation factor along one axis
+static inline const u32 LocateGridAxis(const f32 i_coord, const u32 i_resolution, f32& o_t)
+{
+	if (i_resolution < 2)
+	{
+		o_t = 0.0f;
+		return 0;
+	}
+
+	const f32 maxCoord = (f32)(i_resolution - 1);
+	const f32 c = floral::clamp(i_coord, 0.0f, maxCoord);
+	u32 i0 = (u32)c;
+	if (i0 > i_resolution - 2)
+	{
+		i0 = i_resolution - 2;
+	}
+	o_t = c - (f32)i0;
+	return i0;
+}
+
+void SampleProbeGrid(const ProbeGrid& i_grid, const floral::vec3f* i_points, const u32 i_pointsCount, SH9* o_sh)
+{
+	const u32 strideY = i_grid.resolutionX;
+	const u32 strideZ = i_grid.resolutionX * i_grid.resolutionY;
+	const u32 stepX = i_grid.resolutionX > 1 ? 1 : 0;
+	const u32 stepY = i_grid.resolutionY > 1 ? strideY : 0;
+	const u32 stepZ = i_grid.resolutionZ > 1 ? strideZ : 0;
+
+	for (u32 i = 0; i < i_pointsCount; i++)
+	{
+		const floral::vec3f f = (i_points[i] - i_grid.minCorner) * i_grid.invCellSize;
+		f32 tx, ty, tz;
+		const u32 x = LocateGridAxis(f.x, i_grid.resolutionX, tx);
+		const u32 y = LocateGridAxis(f.y, i_grid.resolutionY, ty);
+		const u32 z = LocateGridAxis(f.z, i_grid.resolutionZ, tz);
+
+		const SH9* p = &i_grid.probes[z * strideZ + y * strideY + x];
+		const f32 wx[2] = { 1.0f - tx, tx };
+		const f32 wy[2] = { 1.0f - ty, ty };
+		const f32 wz[2] = { 1.0f - tz, tz };
+
+		SH9& out = o_sh[i];
+		ClearSH(out);
+		for (u32 c = 0; c < 8; c++)
+		{
+			const u32 ix = c & 1;
+			const u32 iy = (c >> 1) & 1;
+			const u32 iz = (c >> 2) & 1;
+			const f32 w = wx[ix] * wy[iy] * wz[iz];
+			if (w > 0.0f)
+			{
+				AccumulateSH(out, p[ix * stepX + iy * stepY + iz * stepZ], w);
+			}
+		}
+	}
+}
+
+// ------------------------------------------------------------------
+// tetrahedral mesh construction
+// ------------------------------------------------------------------
+
+typedef floral::vec3<f64> dvec3;
+
+struct BuildTetrahedron
+{
+	u32											vertices[4];
+	s32											neighbors[4];
+	dvec3										circumCenter;
+	f64											circumRadiusSq;
+	u32											stamp;
+	bool										alive;
+};
+
+struct CavityFace
+{
+	s32											badTet;
+	u32											slot;			// slot of the bad tetrahedron opposite to this face
+	s32											outerTet;
+};
+
+struct NewFace
+{
+	u32											v0, v1;			// the 2 vertices other than the inserted point, sorted
+	s32											tet;
+	u32											slot;
+};
+
+template <class T>
+static T* GrowArray(T* i_array, const u32 i_count, u32& io_capacity, const u32 i_requiredCapacity, stone::FreelistArena* i_arena)
+{
+	if (i_requiredCapacity <= io_capacity)
+	{
+		return i_array;
+	}
+
+	u32 newCapacity = floral::max(io_capacity * 2, i_requiredCapacity);
+	T* newArray = i_arena->allocate_array<T>(newCapacity);
+	if (i_array)
+	{
+		memcpy(newArray, i_array, sizeof(T) * i_count);
+		i_arena->free(i_array);
+	}
+	io_capacity = newCapacity;
+	return newArray;
+}
+
+static inline const f64 Orient3D(const dvec3& a, const dvec3& b, const dvec3& c, const dvec3& d)
+{
+	return floral::dot(b - a, floral::cross(c - a, d - a));
+}
+
+static void ComputeCircumSphere(BuildTetrahedron& io_tet, const dvec3* i_points)
+{
+	const dvec3& a = i_points[io_tet.vertices[0]];
+	const dvec3 u = i_points[io_tet.vertices[1]] - a;
+	const dvec3 v = i_points[io_tet.vertices[2]] - a;
+	const dvec3 w = i_points[io_tet.vertices[3]] - a;
+	const dvec3 vw = floral::cross(v, w);
+	const dvec3 wu = floral::cross(w, u);
+	const dvec3 uv = floral::cross(u, v);
+	const f64 denom = 2.0 * floral::dot(u, vw);
+
+	if (fabs(denom) < 1e-30)
+	{
+		// flat tetrahedron: treat its circumsphere as the whole space so it always gets replaced
+		io_tet.circumCenter = a;
+		io_tet.circumRadiusSq = 1e300;
+		return;
+	}
+
+	const dvec3 offset = (vw * floral::dot(u, u) + wu * floral::dot(v, v) + uv * floral::dot(w, w)) / denom;
+	io_tet.circumCenter = a + offset;
+	io_tet.circumRadiusSq = floral::dot(offset, offset);
+}
+
+static inline const bool InCircumSphere(const BuildTetrahedron& i_tet, const dvec3& i_p)
+{
+	const dvec3 d = i_p - i_tet.circumCenter;
+	return floral::dot(d, d) < i_tet.circumRadiusSq;
+}
+
+// walks towards i_p, returns a tetrahedron whose circumsphere contains it
+static const s32 LocateBadTetrahedron(const BuildTetrahedron* i_tets, const u32 i_tetsCount, const dvec3* i_points,
+		const s32 i_start, const dvec3& i_p)
+{
+	s32 current = i_start;
+	for (u32 step = 0; step < i_tetsCount && current >= 0; step++)
+	{
+		const BuildTetrahedron& tet = i_tets[current];
+
+		// step through the first face that separates i_p from the opposite vertex
+		s32 next = -1;
+		for (u32 i = 0; i < 4; i++)
+		{
+			const dvec3& f0 = i_points[tet.vertices[(i + 1) & 3]];
+			const dvec3& f1 = i_points[tet.vertices[(i + 2) & 3]];
+			const dvec3& f2 = i_points[tet.vertices[(i + 3) & 3]];
+			const f64 sideP = Orient3D(f0, f1, f2, i_p);
+			const f64 sideV = Orient3D(f0, f1, f2, i_points[tet.vertices[i]]);
+			if (sideP * sideV < 0.0 && tet.neighbors[i] >= 0)
+			{
+				next = tet.neighbors[i];
+				break;
+			}
+		}
+
+		if (next < 0)
+		{
+			if (InCircumSphere(tet, i_p))
+			{
+				return current;
+			}
+			break;
+		}
+		current = next;
+	}
+
+	// numerical trouble during the walk, fall back to brute force
+	for (u32 i = 0; i < i_tetsCount; i++)
+	{
+		if (i_tets[i].alive && InCircumSphere(i_tets[i], i_p))
+		{
+			return (s32)i;
+		}
+	}
+	return -1;
+}
+
+// uses the jittered construction points: lattice probes produce flat tetrahedra otherwise
+static void ComputeBarycentricMatrix(ProbeTetrahedron& io_tet, const dvec3* i_points)
+{
+	const dvec3& p3 = i_points[io_tet.vertices[3]];
+	const dvec3 c0 = i_points[io_tet.vertices[0]] - p3;
+	const dvec3 c1 = i_points[io_tet.vertices[1]] - p3;
+	const dvec3 c2 = i_points[io_tet.vertices[2]] - p3;
+
+	// inverse of the matrix whose columns are c0, c1, c2: rows are the cross products over the determinant
+	const dvec3 r0 = floral::cross(c1, c2);
+	const dvec3 r1 = floral::cross(c2, c0);
+	const dvec3 r2 = floral::cross(c0, c1);
+	const f64 det = floral::dot(c0, r0);
+	const f64 invDet = fabs(det) > 1e-30 ? 1.0 / det : 0.0;
+
+	io_tet.baryMatrix[0] = floral::vec3f((f32)(r0.x * invDet), (f32)(r0.y * invDet), (f32)(r0.z * invDet));
+	io_tet.baryMatrix[1] = floral::vec3f((f32)(r1.x * invDet), (f32)(r1.y * invDet), (f32)(r1.z * invDet));
+	io_tet.baryMatrix[2] = floral::vec3f((f32)(r2.x * invDet), (f32)(r2.y * invDet), (f32)(r2.z * invDet));
+	io_tet.baryOrigin = floral::vec3f((f32)p3.x, (f32)p3.y, (f32)p3.z);
+}
+
+const ProbeTetMesh BuildProbeTetMesh(const floral::vec3f* i_positions, const SH9* i_probes, const u32 i_probesCount,
+		stone::LinearArena* i_dataArena, stone::FreelistArena* i_scratchArena)
+{
+	ProbeTetMesh mesh;
+	mesh.positions = i_dataArena->allocate_array<floral::vec3f>(floral::max(i_probesCount, 1u));
+	mesh.probes = i_dataArena->allocate_array<SH9>(floral::max(i_probesCount, 1u));
+	mesh.probesCount = i_probesCount;
+	mesh.tetrahedra = nullptr;
+	mesh.tetrahedraCount = 0;
+	memcpy(mesh.positions, i_positions, sizeof(floral::vec3f) * i_probesCount);
+	memcpy(mesh.probes, i_probes, sizeof(SH9) * i_probesCount);
+
+	if (i_probesCount < 4)
+	{
+		return mesh;
+	}
+
+	// bounds
+	dvec3 minCorner((f64)i_positions[0].x, (f64)i_positions[0].y, (f64)i_positions[0].z);
+	dvec3 maxCorner = minCorner;
+	for (u32 i = 1; i < i_probesCount; i++)
+	{
+		minCorner.x = floral::min(minCorner.x, (f64)i_positions[i].x);
+		minCorner.y = floral::min(minCorner.y, (f64)i_positions[i].y);
+		minCorner.z = floral::min(minCorner.z, (f64)i_positions[i].z);
+		maxCorner.x = floral::max(maxCorner.x, (f64)i_positions[i].x);
+		maxCorner.y = floral::max(maxCorner.y, (f64)i_positions[i].y);
+		maxCorner.z = floral::max(maxCorner.z, (f64)i_positions[i].z);
+	}
+	const dvec3 extent = maxCorner - minCorner;
+	const f64 maxExtent = floral::max(extent.x, floral::max(extent.y, floral::max(extent.z, 1e-3)));
+	const dvec3 center = (minCorner + maxCorner) * 0.5;
+
+	// probes usually come from a lattice (octree corners), which is full of co-spherical points.
+	// A tiny deterministic jitter keeps the construction away from those degenerate cases,
+	// the stored positions are left untouched, only the barycentric matrices see the jitter.
+	const u32 pointsCount = i_probesCount + 4;
+	dvec3* points = i_scratchArena->allocate_array<dvec3>(pointsCount);
+	const f64 jitter = maxExtent * 1e-4;
+	for (u32 i = 0; i < i_probesCount; i++)
+	{
+		u32 h = i * 2654435761u;
+		const f64 jx = (f64)((h >> 8) & 0xff) / 255.0 - 0.5;
+		h = h * 2654435761u + 0x9e3779b9u;
+		const f64 jy = (f64)((h >> 8) & 0xff) / 255.0 - 0.5;
+		h = h * 2654435761u + 0x9e3779b9u;
+		const f64 jz = (f64)((h >> 8) & 0xff) / 255.0 - 0.5;
+		points[i] = dvec3((f64)i_positions[i].x + jx * jitter,
+				(f64)i_positions[i].y + jy * jitter,
+				(f64)i_positions[i].z + jz * jitter);
+	}
+
+	// super tetrahedron enclosing everything
+	const f64 s = maxExtent * 100.0;
+	const u32 superBase = i_probesCount;
+	points[superBase + 0] = center + dvec3(-s, -s, -s);
+	points[superBase + 1] = center + dvec3(s * 3.0, -s, -s);
+	points[superBase + 2] = center + dvec3(-s, s * 3.0, -s);
+	points[superBase + 3] = center + dvec3(-s, -s, s * 3.0);
+
+	u32 tetsCapacity = 0;
+	BuildTetrahedron* tets = GrowArray<BuildTetrahedron>(nullptr, 0, tetsCapacity, i_probesCount * 8, i_scratchArena);
+	u32 tetsCount = 1;
+	{
+		BuildTetrahedron& t = tets[0];
+		for (u32 i = 0; i < 4; i++)
+		{
+			t.vertices[i] = superBase + i;
+			t.neighbors[i] = -1;
+		}
+		t.stamp = 0;
+		t.alive = true;
+		ComputeCircumSphere(t, points);
+	}
+
+	u32 freeCapacity = 0, freeCount = 0;
+	s32* freeTets = GrowArray<s32>(nullptr, 0, freeCapacity, 64, i_scratchArena);
+	u32 badCapacity = 0;
+	s32* badTets = GrowArray<s32>(nullptr, 0, badCapacity, 64, i_scratchArena);
+	u32 cavityCapacity = 0;
+	CavityFace* cavity = GrowArray<CavityFace>(nullptr, 0, cavityCapacity, 64, i_scratchArena);
+	u32 newFacesCapacity = 0;
+	NewFace* newFaces = GrowArray<NewFace>(nullptr, 0, newFacesCapacity, 192, i_scratchArena);
+
+	s32 lastTet = 0;
+	u32 stamp = 0;
+	for (u32 pi = 0; pi < i_probesCount; pi++)
+	{
+		const dvec3& p = points[pi];
+		const s32 seed = LocateBadTetrahedron(tets, tetsCount, points, lastTet, p);
+		if (seed < 0)
+		{
+			continue;
+		}
+
+		// grow the cavity of tetrahedra whose circumsphere contains p (badTets doubles as the flood fill stack)
+		stamp++;
+		u32 badCount = 0, cavityCount = 0;
+		badTets[badCount++] = seed;
+		tets[seed].stamp = stamp;
+		tets[seed].alive = false;
+		for (u32 b = 0; b < badCount; b++)
+		{
+			const s32 t = badTets[b];
+			for (u32 i = 0; i < 4; i++)
+			{
+				const s32 n = tets[t].neighbors[i];
+				if (n >= 0)
+				{
+					BuildTetrahedron& neighbor = tets[n];
+					if (neighbor.stamp != stamp)
+					{
+						neighbor.stamp = stamp;
+						if (InCircumSphere(neighbor, p))
+						{
+							neighbor.alive = false;
+							badTets = GrowArray<s32>(badTets, badCount, badCapacity, badCount + 1, i_scratchArena);
+							badTets[badCount++] = n;
+							continue;
+						}
+					}
+					else if (!neighbor.alive)
+					{
+						continue;	// shared by 2 bad tetrahedra: inside the cavity
+					}
+				}
+
+				cavity = GrowArray<CavityFace>(cavity, cavityCount, cavityCapacity, cavityCount + 1, i_scratchArena);
+				cavity[cavityCount].badTet = t;
+				cavity[cavityCount].slot = i;
+				cavity[cavityCount].outerTet = n;
+				cavityCount++;
+			}
+		}
+
+		// re-triangulate: one new tetrahedron per boundary face, p takes the slot of the removed vertex.
+		// Bad tetrahedra are only recycled after this loop, so they can still be read here.
+		newFaces = GrowArray<NewFace>(newFaces, 0, newFacesCapacity, cavityCount * 3, i_scratchArena);
+		u32 newFacesCount = 0;
+		for (u32 i = 0; i < cavityCount; i++)
+		{
+			const CavityFace& cf = cavity[i];
+			s32 newTet;
+			if (freeCount > 0)
+			{
+				newTet = freeTets[--freeCount];
+			}
+			else
+			{
+				tets = GrowArray<BuildTetrahedron>(tets, tetsCount, tetsCapacity, tetsCount + 1, i_scratchArena);
+				newTet = (s32)tetsCount++;
+			}
+
+			BuildTetrahedron& nt = tets[newTet];
+			const BuildTetrahedron& bad = tets[cf.badTet];
+			for (u32 k = 0; k < 4; k++)
+			{
+				nt.vertices[k] = bad.vertices[k];
+				nt.neighbors[k] = -1;
+			}
+			nt.vertices[cf.slot] = pi;
+			nt.neighbors[cf.slot] = cf.outerTet;
+			nt.stamp = 0;
+			nt.alive = true;
+			ComputeCircumSphere(nt, points);
+
+			if (cf.outerTet >= 0)
+			{
+				BuildTetrahedron& outer = tets[cf.outerTet];
+				for (u32 k = 0; k < 4; k++)
+				{
+					if (outer.neighbors[k] == cf.badTet)
+					{
+						outer.neighbors[k] = newTet;
+						break;
+					}
+				}
+			}
+
+			// the 3 faces containing p, keyed by their 2 other vertices
+			for (u32 k = 0; k < 4; k++)
+			{
+				if (k == cf.slot)
+				{
+					continue;
+				}
+
+				u32 edge[2];
+				u32 edgeCount = 0;
+				for (u32 m = 0; m < 4; m++)
+				{
+					if (m != k && m != cf.slot)
+					{
+						edge[edgeCount++] = nt.vertices[m];
+					}
+				}
+				NewFace& nf = newFaces[newFacesCount++];
+				nf.v0 = floral::min(edge[0], edge[1]);
+				nf.v1 = floral::max(edge[0], edge[1]);
+				nf.tet = newTet;
+				nf.slot = k;
+			}
+			lastTet = newTet;
+		}
+
+		// link the new tetrahedra together through the faces that contain p
+		for (u32 i = 0; i < newFacesCount; i++)
+		{
+			for (u32 j = i + 1; j < newFacesCount; j++)
+			{
+				if (newFaces[i].v0 == newFaces[j].v0 && newFaces[i].v1 == newFaces[j].v1)
+				{
+					tets[newFaces[i].tet].neighbors[newFaces[i].slot] = newFaces[j].tet;
+					tets[newFaces[j].tet].neighbors[newFaces[j].slot] = newFaces[i].tet;
+					break;
+				}
+			}
+		}
+
+		// recycle the removed tetrahedra
+		freeTets = GrowArray<s32>(freeTets, freeCount, freeCapacity, freeCount + badCount, i_scratchArena);
+		for (u32 i = 0; i < badCount; i++)
+		{
+			freeTets[freeCount++] = badTets[i];
+		}
+	}
+
+	// drop everything attached to the super tetrahedron and compact
+	s32* remap = i_scratchArena->allocate_array<s32>(tetsCount);
+	u32 finalCount = 0;
+	for (u32 i = 0; i < tetsCount; i++)
+	{
+		const BuildTetrahedron& t = tets[i];
+		const bool keep = t.alive
+			&& t.vertices[0] < superBase && t.vertices[1] < superBase
+			&& t.vertices[2] < superBase && t.vertices[3] < superBase;
+		remap[i] = keep ? (s32)finalCount++ : -1;
+	}
+
+	mesh.tetrahedra = i_dataArena->allocate_array<ProbeTetrahedron>(floral::max(finalCount, 1u));
+	mesh.tetrahedraCount = finalCount;
+	for (u32 i = 0; i < tetsCount; i++)
+	{
+		if (remap[i] < 0)
+		{
+			continue;
+		}
+
+		const BuildTetrahedron& t = tets[i];
+		ProbeTetrahedron& out = mesh.tetrahedra[remap[i]];
+		for (u32 k = 0; k < 4; k++)
+		{
+			out.vertices[k] = t.vertices[k];
+			out.neighbors[k] = t.neighbors[k] >= 0 ? remap[t.neighbors[k]] : -1;
+		}
+		ComputeBarycentricMatrix(out, points);
+	}
+
+	i_scratchArena->free(remap);
+	i_scratchArena->free(newFaces);
+	i_scratchArena->free(cavity);
+	i_scratchArena->free(badTets);
+	i_scratchArena->free(freeTets);
+	i_scratchArena->free(tets);
+	i_scratchArena->free(points);
+
+	return mesh;
+}
+
+// ------------------------------------------------------------------
+
+void SampleProbeTetMesh(const ProbeTetMesh& i_mesh, const floral::vec3f* i_points, const u32 i_pointsCount,
+		SH9* o_sh, s32* io_hint /* = nullptr */)
+{
+	if (i_mesh.tetrahedraCount == 0)
+	{
+		for (u32 i = 0; i < i_pointsCount; i++)
+		{
+			ClearSH(o_sh[i]);
+		}
+		return;
+	}
+
+	s32 current = (io_hint && *io_hint >= 0 && (u32)*io_hint < i_mesh.tetrahedraCount) ? *io_hint : 0;
+	for (u32 i = 0; i < i_pointsCount; i++)
+	{
+		const floral::vec3f& p = i_points[i];
+		f32 b[4];
+		for (u32 step = 0; step <= i_mesh.tetrahedraCount; step++)
+		{
+			const ProbeTetrahedron& tet = i_mesh.tetrahedra[current];
+			const floral::vec3f d = p - tet.baryOrigin;
+			b[0] = floral::dot(tet.baryMatrix[0], d);
+			b[1] = floral::dot(tet.baryMatrix[1], d);
+			b[2] = floral::dot(tet.baryMatrix[2], d);
+			b[3] = 1.0f - b[0] - b[1] - b[2];
+
+			u32 minSlot = 0;
+			for (u32 k = 1; k < 4; k++)
+			{
+				if (b[k] < b[minSlot]) minSlot = k;
+			}
+
+			if (b[minSlot] >= -1e-5f || tet.neighbors[minSlot] < 0)
+			{
+				break;
+			}
+			current = tet.neighbors[minSlot];
+		}
+
+		// outside of the hull (or numerical trouble): project the weights back onto the tetrahedron
+		f32 sum = 0.0f;
+		for (u32 k = 0; k < 4; k++)
+		{
+			b[k] = floral::max(b[k], 0.0f);
+			sum += b[k];
+		}
+		const f32 invSum = sum > 0.0f ? 1.0f / sum : 0.25f;
+		if (sum <= 0.0f)
+		{
+			b[0] = b[1] = b[2] = b[3] = 1.0f;
+		}
+
+		const ProbeTetrahedron& tet = i_mesh.tetrahedra[current];
+		SH9& out = o_sh[i];
+		ClearSH(out);
+		for (u32 k = 0; k < 4; k++)
+		{
+			if (b[k] > 0.0f)
+			{
+				AccumulateSH(out, i_mesh.probes[tet.vertices[k]], b[k] * invSum);
+			}
+		}
+	}
+
+	if (io_hint)
+	{
+		*io_hint = current;
+	}
+}
+
+// ------------------------------------------------------------------
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+#include <floral/gpds/vec.h>
+
+#include "Memory/MemorySystem.h"
+
+namespace lightprobe
+{
+// ------------------------------------------------------------------
+
+// 3 bands, rgb
+struct SH9
+{
+	floral::vec3f								coeffs[9];
+};
+
+// ------------------------------------------------------------------
+
+/*
+ * Regular grid of probes, probe (x, y, z) is at minCorner + (x, y, z) * cellSize.
+ * Probes are stored x first, then y, then z.
+ */
+struct ProbeGrid
+{
+	floral::vec3f								minCorner;
+	floral::vec3f								cellSize;
+	floral::vec3f								invCellSize;
+	u32											resolutionX;
+	u32											resolutionY;
+	u32											resolutionZ;
+	SH9*										probes;
+};
+
+// probes are left uninitialized, fill them with GetGridProbe()
+const ProbeGrid									CreateProbeGrid(const floral::vec3f& i_minCorner, const floral::vec3f& i_cellSize,
+													const u32 i_resX, const u32 i_resY, const u32 i_resZ, stone::LinearArena* i_dataArena);
+
+inline SH9&										GetGridProbe(const ProbeGrid& i_grid, const u32 i_x, const u32 i_y, const u32 i_z)
+{
+	return i_grid.probes[(i_z * i_grid.resolutionY + i_y) * i_grid.resolutionX + i_x];
+}
+
+// trilinear interpolation, points outside the grid are clamped to its border
+void											SampleProbeGrid(const ProbeGrid& i_grid, const floral::vec3f* i_points, const u32 i_pointsCount, SH9* o_sh);
+
+// ------------------------------------------------------------------
+
+/*
+ * Delaunay tetrahedralization of irregularly placed probes.
+ * - neighbors[i] is the tetrahedron across the face opposite to vertices[i], -1 on the hull
+ * - baryMatrix / baryOrigin turn a position into the first 3 barycentric coordinates
+ */
+struct ProbeTetrahedron
+{
+	u32											vertices[4];
+	s32											neighbors[4];
+	floral::vec3f								baryMatrix[3];		// rows
+	floral::vec3f								baryOrigin;			// position of vertices[3]
+};
+
+struct ProbeTetMesh
+{
+	floral::vec3f*								positions;
+	SH9*										probes;
+	u32											probesCount;
+
+	ProbeTetrahedron*							tetrahedra;
+	u32											tetrahedraCount;
+};
+
+/*
+ * Probes are copied into i_dataArena, i_scratchArena only holds the data of the incremental
+ * (Bowyer-Watson) construction and is cleaned up before returning.
+ * Needs at least 4 non-coplanar probes, otherwise the mesh will be empty.
+ */
+const ProbeTetMesh								BuildProbeTetMesh(const floral::vec3f* i_positions, const SH9* i_probes, const u32 i_probesCount,
+													stone::LinearArena* i_dataArena, stone::FreelistArena* i_scratchArena);
+
+/*
+ * Barycentric interpolation inside the enclosing tetrahedron, located by walking from the tetrahedron
+ * of the previous query, so spatially coherent batches are cheap.
+ * - io_hint (optional): tetrahedron to start the first walk from, receives the last visited one
+ * - points outside the hull use the closest hull tetrahedron reached by the walk with clamped weights
+ */
+void											SampleProbeTetMesh(const ProbeTetMesh& i_mesh, const floral::vec3f* i_points, const u32 i_pointsCount,
+													SH9* o_sh, s32* io_hint = nullptr);
+
+// ------------------------------------------------------------------
+}
@@ -0,0 +1,278 @@
+#include "MaterialBinary.h"
+
+#include <string.h>
+
+namespace mat_parser
+{
+// ----------------------------------------------------------------------------
+
+namespace internal
+{
+// ----------------------------------------------------------------------------
+
+// in bytes, indexed by UBParamType
+static const size k_UBParamSizes[] = { 0, sizeof(s32), sizeof(f32), 2 * sizeof(f32), 3 * sizeof(f32), 4 * sizeof(f32), 9 * sizeof(f32), 16 * sizeof(f32) };
+static_assert(sizeof(k_UBParamSizes) / sizeof(size) == (size)UBParamType::Count, "A UBParamType has no size");
+
+static inline const size Align(const size i_value)
+{
+	return (i_value + 7) & ~(size)7;
+}
+
+static inline const size GetStringSize(const_cstr i_str)
+{
+	return i_str ? strlen(i_str) + 1 : 0;
+}
+
+struct ImageLayout
+{
+	size										featuresOffset;
+	size										buffersOffset;
+	size										membersOffset;
+	size										valuesOffset;
+	size										texturesOffset;
+	size										fixupsOffset;
+	size										stringTableOffset;
+	size										dataSize;
+	u32											fixupsCount;
+};
+
+static const ImageLayout ComputeImageLayout(const MaterialDescription& i_matDesc)
+{
+	size membersSize = 0;
+	size valuesSize = 0;
+	size stringsSize = GetStringSize(i_matDesc.vertexShaderPath) + GetStringSize(i_matDesc.fragmentShaderPath);
+	u32 pointersCount = (i_matDesc.vertexShaderPath ? 1 : 0) + (i_matDesc.fragmentShaderPath ? 1 : 0);
+
+	pointersCount += (i_matDesc.featuresCount > 0 ? 1 : 0) + (u32)i_matDesc.featuresCount;
+	for (size i = 0; i < i_matDesc.featuresCount; i++)
+	{
+		stringsSize += GetStringSize(i_matDesc.featureList[i]);
+	}
+
+	pointersCount += i_matDesc.buffersCount > 0 ? 1 : 0;
+	for (size i = 0; i < i_matDesc.buffersCount; i++)
+	{
+		const UBDescription& ubDesc = i_matDesc.bufferDescriptions[i];
+		stringsSize += GetStringSize(ubDesc.identifier);
+		pointersCount += (ubDesc.identifier ? 1 : 0) + (ubDesc.membersCount > 0 ? 1 : 0) + 2 * (u32)ubDesc.membersCount;
+		membersSize += sizeof(UBParam) * ubDesc.membersCount;
+		for (size j = 0; j < ubDesc.membersCount; j++)
+		{
+			stringsSize += GetStringSize(ubDesc.members[j].identifier);
+			valuesSize += Align(k_UBParamSizes[(s32)ubDesc.members[j].dataType]);
+		}
+	}
+
+	pointersCount += i_matDesc.texturesCount > 0 ? 1 : 0;
+	for (size i = 0; i < i_matDesc.texturesCount; i++)
+	{
+		const TextureDescription& texDesc = i_matDesc.textureDescriptions[i];
+		stringsSize += GetStringSize(texDesc.identifier) + GetStringSize(texDesc.texturePath);
+		pointersCount += (texDesc.identifier ? 1 : 0) + (texDesc.texturePath ? 1 : 0);
+	}
+
+	ImageLayout layout;
+	layout.featuresOffset = Align(sizeof(CompiledMaterialHeader)) + Align(sizeof(MaterialDescription));
+	layout.buffersOffset = layout.featuresOffset + Align(sizeof(const_cstr) * i_matDesc.featuresCount);
+	layout.membersOffset = layout.buffersOffset + Align(sizeof(UBDescription) * i_matDesc.buffersCount);
+	layout.valuesOffset = layout.membersOffset + Align(membersSize);
+	layout.texturesOffset = layout.valuesOffset + valuesSize;
+	layout.fixupsOffset = layout.texturesOffset + Align(sizeof(TextureDescription) * i_matDesc.texturesCount);
+	layout.stringTableOffset = layout.fixupsOffset + sizeof(u64) * pointersCount;
+	layout.dataSize = layout.stringTableOffset + stringsSize;
+	layout.fixupsCount = pointersCount;
+	return layout;
+}
+
+struct ImageWriter
+{
+	p8											data;
+	u64*										fixups;
+	u32											fixupsCount;
+	size										stringsEnd;
+};
+
+// io_pointer is in the image, it gets the offset of its target and a fixup
+template <class T>
+static void SetPointer(ImageWriter* io_writer, T*& io_pointer, const size i_offset)
+{
+	io_pointer = (T*)(aptr)i_offset;
+	io_writer->fixups[io_writer->fixupsCount] = (u64)((p8)&io_pointer - io_writer->data);
+	io_writer->fixupsCount++;
+}
+
+static void SetString(ImageWriter* io_writer, const_cstr& io_pointer, const_cstr i_str)
+{
+	if (i_str == nullptr)
+	{
+		io_pointer = nullptr;
+		return;
+	}
+
+	const size strSize = strlen(i_str) + 1;
+	memcpy(io_writer->data + io_writer->stringsEnd, i_str, strSize);
+	SetPointer(io_writer, io_pointer, io_writer->stringsEnd);
+	io_writer->stringsEnd += strSize;
+}
+
+// ----------------------------------------------------------------------------
+}
+
+const size GetCompiledMaterialSize(const MaterialDescription& i_matDesc)
+{
+	return internal::ComputeImageLayout(i_matDesc).dataSize;
+}
+
+const size CompileMaterial(const MaterialDescription& i_matDesc, voidptr o_data, const size i_capacity)
+{
+	using namespace internal;
+	const ImageLayout layout = ComputeImageLayout(i_matDesc);
+	FLORAL_ASSERT(((aptr)o_data & 7) == 0);
+	if (layout.dataSize > i_capacity)
+	{
+		FLORAL_ASSERT_MSG(false, "Not enough space for the compiled material");
+		return 0;
+	}
+
+	p8 data = (p8)o_data;
+	memset(data, 0, layout.dataSize);
+
+	CompiledMaterialHeader* header = (CompiledMaterialHeader*)data;
+	header->magicCharacters[0] = 'C';
+	header->magicCharacters[1] = 'B';
+	header->magicCharacters[2] = 'M';
+	header->magicCharacters[3] = 'T';
+	header->version = k_CompiledMaterialVersion;
+	header->pointerSize = (u32)sizeof(voidptr);
+	header->fixupsCount = layout.fixupsCount;
+	header->dataSize = layout.dataSize;
+	header->descriptionOffset = Align(sizeof(CompiledMaterialHeader));
+	header->fixupsOffset = layout.fixupsOffset;
+	header->stringTableOffset = layout.stringTableOffset;
+
+	ImageWriter writer;
+	writer.data = data;
+	writer.fixups = (u64*)(data + layout.fixupsOffset);
+	writer.fixupsCount = 0;
+	writer.stringsEnd = layout.stringTableOffset;
+
+	MaterialDescription* matDesc = (MaterialDescription*)(data + header->descriptionOffset);
+	*matDesc = i_matDesc;
+	SetString(&writer, matDesc->vertexShaderPath, i_matDesc.vertexShaderPath);
+	SetString(&writer, matDesc->fragmentShaderPath, i_matDesc.fragmentShaderPath);
+
+	matDesc->featureList = nullptr;
+	if (i_matDesc.featuresCount > 0)
+	{
+		SetPointer(&writer, matDesc->featureList, layout.featuresOffset);
+		const_cstr* featureList = (const_cstr*)(data + layout.featuresOffset);
+		for (size i = 0; i < i_matDesc.featuresCount; i++)
+		{
+			SetString(&writer, featureList[i], i_matDesc.featureList[i]);
+		}
+	}
+
+	matDesc->bufferDescriptions = nullptr;
+	if (i_matDesc.buffersCount > 0)
+	{
+		SetPointer(&writer, matDesc->bufferDescriptions, layout.buffersOffset);
+		UBDescription* ubDescs = (UBDescription*)(data + layout.buffersOffset);
+		size membersEnd = layout.membersOffset;
+		size valuesEnd = layout.valuesOffset;
+		for (size i = 0; i < i_matDesc.buffersCount; i++)
+		{
+			const UBDescription& srcUBDesc = i_matDesc.bufferDescriptions[i];
+			UBDescription& ubDesc = ubDescs[i];
+			ubDesc = srcUBDesc;
+			SetString(&writer, ubDesc.identifier, srcUBDesc.identifier);
+			ubDesc.members = nullptr;
+			if (srcUBDesc.membersCount == 0)
+			{
+				continue;
+			}
+
+			SetPointer(&writer, ubDesc.members, membersEnd);
+			UBParam* members = (UBParam*)(data + membersEnd);
+			membersEnd += sizeof(UBParam) * srcUBDesc.membersCount;
+			for (size j = 0; j < srcUBDesc.membersCount; j++)
+			{
+				const UBParam& srcParam = srcUBDesc.members[j];
+				const size valueSize = k_UBParamSizes[(s32)srcParam.dataType];
+				members[j].dataType = srcParam.dataType;
+				SetString(&writer, members[j].identifier, srcParam.identifier);
+				memcpy(data + valuesEnd, srcParam.data, valueSize);
+				SetPointer(&writer, members[j].data, valuesEnd);
+				valuesEnd += Align(valueSize);
+			}
+		}
+	}
+
+	matDesc->textureDescriptions = nullptr;
+	if (i_matDesc.texturesCount > 0)
+	{
+		SetPointer(&writer, matDesc->textureDescriptions, layout.texturesOffset);
+		TextureDescription* texDescs = (TextureDescription*)(data + layout.texturesOffset);
+		for (size i = 0; i < i_matDesc.texturesCount; i++)
+		{
+			texDescs[i] = i_matDesc.textureDescriptions[i];
+			SetString(&writer, texDescs[i].identifier, i_matDesc.textureDescriptions[i].identifier);
+			SetString(&writer, texDescs[i].texturePath, i_matDesc.textureDescriptions[i].texturePath);
+		}
+	}
+
+	FLORAL_ASSERT(writer.fixupsCount == layout.fixupsCount);
+	FLORAL_ASSERT(writer.stringsEnd == layout.dataSize);
+	return layout.dataSize;
+}
+
+const bool IsCompiledMaterial(const voidptr i_data, const size i_dataSize)
+{
+	const c8* magic = (const c8*)i_data;
+	return i_dataSize >= sizeof(CompiledMaterialHeader)
+		&& magic[0] == 'C' && magic[1] == 'B' && magic[2] == 'M' && magic[3] == 'T';
+}
+
+const MaterialDescription* FixupCompiledMaterial(voidptr io_data, const size i_dataSize)
+{
+	if (!IsCompiledMaterial(io_data, i_dataSize) || ((aptr)io_data & 7) != 0)
+	{
+		return nullptr;
+	}
+
+	p8 data = (p8)io_data;
+	const CompiledMaterialHeader* header = (const CompiledMaterialHeader*)data;
+	if (header->version != k_CompiledMaterialVersion || header->pointerSize != sizeof(voidptr)
+		|| header->dataSize != i_dataSize
+		|| header->descriptionOffset % sizeof(voidptr) != 0
+		|| header->descriptionOffset + sizeof(MaterialDescription) > i_dataSize
+		|| header->fixupsOffset % sizeof(u64) != 0
+		|| header->fixupsOffset + sizeof(u64) * header->fixupsCount > i_dataSize
+		|| header->stringTableOffset > i_dataSize
+		|| (header->stringTableOffset < i_dataSize && data[i_dataSize - 1] != 0))
+	{
+		return nullptr;
+	}
+
+	// all checked before any is applied, the data is left untouched when it is not valid
+	const u64* fixups = (const u64*)(data + header->fixupsOffset);
+	for (u32 i = 0; i < header->fixupsCount; i++)
+	{
+		const u64 pointerOffset = fixups[i];
+		if (pointerOffset % sizeof(voidptr) != 0 || pointerOffset + sizeof(voidptr) > i_dataSize
+			|| *(const aptr*)(data + pointerOffset) >= i_dataSize)
+		{
+			return nullptr;
+		}
+	}
+
+	for (u32 i = 0; i < header->fixupsCount; i++)
+	{
+		*(aptr*)(data + fixups[i]) += (aptr)data;
+	}
+
+	return (const MaterialDescription*)(data + header->descriptionOffset);
+}
+
+// ----------------------------------------------------------------------------
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+#include <floral/cmds/path.h>
+#include <floral/io/filesystem.h>
+
+#include "MaterialParser.h"
+
+// shared with materialbaker
+namespace mat_parser
+{
+// ----------------------------------------------------------------------------
+
+/*
+ * A compiled material (.cbmat) is the memory image of a MaterialDescription and everything it points to,
+ * written by materialbaker:
+ * - CompiledMaterialHeader
+ * - the MaterialDescription, then the arrays: features, uniform buffers, their members and their values, textures
+ * - the fixups: the offsets of every non null pointer of the image
+ * - the string table
+ * The pointers are stored as offsets from the start of the file, loading is adding the address of the file to
+ * them; nothing is lexed, parsed or copied. The image depends on the pointer size, so does the file.
+ */
+#pragma pack(push)
+#pragma pack(1)
+struct CompiledMaterialHeader
+{
+	c8											magicCharacters[4];		// "CBMT"
+	u32											version;
+	u32											pointerSize;
+	u32											fixupsCount;
+	u64											dataSize;				// the whole file
+	u64											descriptionOffset;
+	u64											fixupsOffset;
+	u64											stringTableOffset;
+};
+#pragma pack(pop)
+
+static const u32								k_CompiledMaterialVersion = 1;
+
+// the size of the compiled material, i_matDesc must be a complete description: ParseMaterial() output
+const size										GetCompiledMaterialSize(const MaterialDescription& i_matDesc);
+// o_data must be 8 bytes aligned and hold GetCompiledMaterialSize() bytes; returns the written size
+const size										CompileMaterial(const MaterialDescription& i_matDesc, voidptr o_data, const size i_capacity);
+
+const bool										IsCompiledMaterial(const voidptr i_data, const size i_dataSize);
+/*
+ * Fixes the pointers of the compiled material in place, only once. io_data must be 8 bytes aligned and outlive
+ * the description. nullptr when the data is not a valid compiled material.
+ */
+const MaterialDescription*						FixupCompiledMaterial(voidptr io_data, const size i_dataSize);
+
+// a compiled material or a text one, depending on the content of the file
+template <class TMemoryArena>
+const MaterialDescription						LoadMaterial(const floral::path i_path, TMemoryArena* i_memoryArena);
+
+template <class TFileSystem, class TMemoryArena>
+const MaterialDescription						LoadMaterial(TFileSystem* i_fs, const floral::relative_path& i_path, TMemoryArena* i_memoryArena);
+
+namespace internal
+{
+// ----------------------------------------------------------------------------
+
+template <class TMemoryArena>
+const MaterialDescription						LoadMaterial(floral::file_info& io_inp, TMemoryArena* i_memoryArena);
+
+// ----------------------------------------------------------------------------
+}
+
+// ----------------------------------------------------------------------------
+}
+
+#include "MaterialBinary.inl"
@@ -0,0 +1,61 @@
+#include <floral/assert/assert.h>
+#include <floral/io/nativeio.h>
+
+namespace mat_parser
+{
+// ----------------------------------------------------------------------------
+
+template <class TMemoryArena>
+const MaterialDescription LoadMaterial(const floral::path i_path, TMemoryArena* i_memoryArena)
+{
+	floral::file_info inp = floral::open_file(i_path);
+	return internal::LoadMaterial(inp, i_memoryArena);
+}
+
+template <class TFileSystem, class TMemoryArena>
+const MaterialDescription LoadMaterial(TFileSystem* i_fs, const floral::relative_path& i_path, TMemoryArena* i_memoryArena)
+{
+	floral::file_info inp = floral::open_file_read(i_fs, i_path);
+	return internal::LoadMaterial(inp, i_memoryArena);
+}
+
+namespace internal
+{
+// ----------------------------------------------------------------------------
+
+template <class TMemoryArena>
+const MaterialDescription LoadMaterial(floral::file_info& io_inp, TMemoryArena* i_memoryArena)
+{
+	MaterialDescription emptyMatDesc;
+	emptyMatDesc.vertexShaderPath = nullptr;
+	emptyMatDesc.fragmentShaderPath = nullptr;
+	// also a missing file, the callers fall back to another path on an empty description
+	if (io_inp.file_size <= 0)
+	{
+		floral::close_file(io_inp);
+		return emptyMatDesc;
+	}
+	const size fileSize = io_inp.file_size;
+
+	// the compiled material is used in place, this is its only allocation
+	floral::file_stream inpStream;
+	inpStream.buffer = (p8)i_memoryArena->allocate(fileSize + 1);
+	floral::read_all_file(io_inp, inpStream);
+	floral::close_file(io_inp);
+
+	if (IsCompiledMaterial(inpStream.buffer, fileSize))
+	{
+		const MaterialDescription* matDesc = FixupCompiledMaterial(inpStream.buffer, fileSize);
+		FLORAL_ASSERT_MSG(matDesc != nullptr, "Invalid compiled material");
+		return matDesc ? *matDesc : emptyMatDesc;
+	}
+
+	inpStream.buffer[fileSize] = 0;
+	return ParseMaterial((const_cstr)inpStream.buffer, i_memoryArena);
+}
+
+// ----------------------------------------------------------------------------
+}
+
+// ----------------------------------------------------------------------------
+}
@@ -0,0 +1,94 @@
+#include "MaterialLoader.h"
+
+#include <string.h>
+
+#include <insigne/ut_shading.h>
+
+namespace mat_loader
+{
+// ----------------------------------------------------------------------------
+
+namespace internal
+{
+// ----------------------------------------------------------------------------
+
+static const u64 k_HashOffsetBasis = 14695981039346656037ull;
+static const u64 k_HashPrime = 1099511628211ull;
+
+const u64 HashBytes(const voidptr i_data, const size i_size, const u64 i_hash)
+{
+	const u8* data = (const u8*)i_data;
+	u64 hash = i_hash;
+	for (size i = 0; i < i_size; i++)
+	{
+		hash = (hash ^ data[i]) * k_HashPrime;
+	}
+	return hash;
+}
+
+// the terminator is hashed too, "ab" + "c" and "a" + "bc" differ
+const u64 HashString(const_cstr i_str, const u64 i_hash)
+{
+	if (i_str == nullptr)
+	{
+		return HashBytes((const voidptr)"", 1, i_hash);
+	}
+	return HashBytes((const voidptr)i_str, strlen(i_str) + 1, i_hash);
+}
+
+const u64 ComputeReflectionHash(const mat_parser::MaterialDescription& i_matDesc)
+{
+	u64 hash = HashBytes((const voidptr)&i_matDesc.buffersCount, sizeof(i_matDesc.buffersCount), k_HashOffsetBasis);
+	for (size i = 0; i < i_matDesc.buffersCount; i++)
+	{
+		hash = HashString(i_matDesc.bufferDescriptions[i].identifier, hash);
+	}
+
+	hash = HashBytes((const voidptr)&i_matDesc.texturesCount, sizeof(i_matDesc.texturesCount), hash);
+	for (size i = 0; i < i_matDesc.texturesCount; i++)
+	{
+		const mat_parser::TextureDescription& texDesc = i_matDesc.textureDescriptions[i];
+		const s32 dimension = (s32)texDesc.dimension;
+		hash = HashBytes((const voidptr)&dimension, sizeof(dimension), hash);
+		hash = HashString(texDesc.identifier, hash);
+	}
+	return hash;
+}
+
+const insigne::shader_handle_t CreateShader(const insigne::shader_desc_t& i_shaderDesc, const mat_parser::MaterialDescription& i_matDesc, ShaderCache* io_shaderCache)
+{
+	if (io_shaderCache == nullptr)
+	{
+		return insigne::create_shader(i_shaderDesc);
+	}
+
+	// the contents, not the paths: copies of a shader under another name are the same program
+	const u64 sourcesHash = HashString(i_shaderDesc.fs, HashString(i_shaderDesc.vs, k_HashOffsetBasis));
+	const u64 reflectionHash = ComputeReflectionHash(i_matDesc);
+	for (u32 i = 0; i < io_shaderCache->entriesCount; i++)
+	{
+		const ShaderCacheEntry& entry = io_shaderCache->entries[i];
+		if (entry.sourcesHash == sourcesHash && entry.reflectionHash == reflectionHash)
+		{
+			io_shaderCache->hitsCount++;
+			return entry.shader;
+		}
+	}
+
+	const insigne::shader_handle_t shader = insigne::create_shader(i_shaderDesc);
+	if (io_shaderCache->entriesCount < io_shaderCache->capacity)
+	{
+		ShaderCacheEntry& entry = io_shaderCache->entries[io_shaderCache->entriesCount];
+		entry.sourcesHash = sourcesHash;
+		entry.reflectionHash = reflectionHash;
+		entry.shader = shader;
+		io_shaderCache->entriesCount++;
+	}
+	return shader;
+}
+
+// ----------------------------------------------------------------------------
+}
+
+// ----------------------------------------------------------------------------
+}
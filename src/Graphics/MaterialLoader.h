@@ -16,12 +16,35 @@ struct MaterialShaderPair
 	insigne::material_desc_t					material;
 };
 
+/*
+ * The shaders created by CreateMaterial(), keyed by the content of their sources and their reflection. The
+ * materials of a scene share a few programs: with a cache, each program is compiled once and the other materials
+ * only infuse their own parameters from it. The cache lives as long as the shaders it holds.
+ */
+struct ShaderCacheEntry
+{
+	u64											sourcesHash;
+	u64											reflectionHash;
+	insigne::shader_handle_t					shader;
+};
+
+struct ShaderCache
+{
+	ShaderCacheEntry*							entries;
+	u32											entriesCount;
+	u32											capacity;			// when full, the new shaders are created but not cached
+	u32											hitsCount;
+};
+
+template <class TMemoryAllocator>
+void											InitializeShaderCache(ShaderCache* o_cache, const u32 i_capacity, TMemoryAllocator* i_allocator);
+
 template <class TIOAllocator, class TMemoryAllocator>
-const bool										CreateMaterial(MaterialShaderPair* o_mat, const mat_parser::MaterialDescription& i_matDesc, TMemoryAllocator* i_ioAllocator, TMemoryAllocator* i_dataAllocator);
+const bool										CreateMaterial(MaterialShaderPair* o_mat, const mat_parser::MaterialDescription& i_matDesc, TIOAllocator* i_ioAllocator, TMemoryAllocator* i_dataAllocator, ShaderCache* io_shaderCache = nullptr);
 template <class TMemoryAllocator>
 const bool										CreateMaterial(MaterialShaderPair* o_mat, const mat_parser::MaterialDescription& i_matDesc, TMemoryAllocator* i_dataAllocator);
 template <class TFileSystem, class TIOAllocator, class TMemoryAllocator>
-const bool										CreateMaterial(MaterialShaderPair* o_mat, TFileSystem* i_fs, const mat_parser::MaterialDescription& i_matDesc, TIOAllocator* i_ioAllocator, TMemoryAllocator* i_dataAllocator);
+const bool										CreateMaterial(MaterialShaderPair* o_mat, TFileSystem* i_fs, const mat_parser::MaterialDescription& i_matDesc, TIOAllocator* i_ioAllocator, TMemoryAllocator* i_dataAllocator, ShaderCache* io_shaderCache = nullptr);
 template <class TFileSystem, class TMemoryAllocator>
 const bool										CreateMaterial(MaterialShaderPair* o_mat, TFileSystem* i_fs, const mat_parser::MaterialDescription& i_matDesc, TMemoryAllocator* i_dataAllocator);
 
@@ -29,6 +52,14 @@ namespace internal
 {
 // ----------------------------------------------------------------------------
 
+// fnv-1a, chained through i_hash
+const u64										HashBytes(const voidptr i_data, const size i_size, const u64 i_hash);
+const u64										HashString(const_cstr i_str, const u64 i_hash);
+// the uniform buffers and the textures the shader is reflected with, in order
+const u64										ComputeReflectionHash(const mat_parser::MaterialDescription& i_matDesc);
+// i_shaderDesc has its sources loaded
+const insigne::shader_handle_t					CreateShader(const insigne::shader_desc_t& i_shaderDesc, const mat_parser::MaterialDescription& i_matDesc, ShaderCache* io_shaderCache);
+
 template <class TMemoryAllocator>
 const insigne::ub_handle_t						BuildUniformBuffer(const mat_parser::UBDescription& i_ubDesc, TMemoryAllocator* i_dataAllocator);
 
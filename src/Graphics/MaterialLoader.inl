@@ -28,8 +28,17 @@ inline insigne::wrap_e ToInsigneWrap(const mat_parser::TextureWrap i_value)
 	return insigne::wrap_e::clamp_to_edge;
 }
 
+template <class TMemoryAllocator>
+void InitializeShaderCache(ShaderCache* o_cache, const u32 i_capacity, TMemoryAllocator* i_allocator)
+{
+	o_cache->entries = i_allocator->template allocate_array<ShaderCacheEntry>(i_capacity);
+	o_cache->entriesCount = 0;
+	o_cache->capacity = i_capacity;
+	o_cache->hitsCount = 0;
+}
+
 template <class TIOAllocator, class TMemoryAllocator>
-const bool CreateMaterial(MaterialShaderPair* o_mat, const mat_parser::MaterialDescription& i_matDesc, TIOAllocator* i_ioAllocator, TMemoryAllocator* i_dataAllocator)
+const bool CreateMaterial(MaterialShaderPair* o_mat, const mat_parser::MaterialDescription& i_matDesc, TIOAllocator* i_ioAllocator, TMemoryAllocator* i_dataAllocator, ShaderCache* io_shaderCache)
 {
 	if (i_matDesc.vertexShaderPath == nullptr || i_matDesc.fragmentShaderPath == nullptr)
 	{
@@ -78,7 +87,7 @@ const bool CreateMaterial(MaterialShaderPair* o_mat, const mat_parser::MaterialD
 	shaderDesc.fs[inp.file_size] = 0;
 	floral::close_file(inp);
 
-	o_mat->shader = insigne::create_shader(shaderDesc);
+	o_mat->shader = internal::CreateShader(shaderDesc, i_matDesc, io_shaderCache);
 	insigne::infuse_material(o_mat->shader, o_mat->material);
 
 	// render state
@@ -239,7 +248,7 @@ const bool CreateMaterial(MaterialShaderPair* o_mat, const mat_parser::MaterialD
 }
 
 template <class TFileSystem, class TIOAllocator, class TMemoryAllocator>
-const bool CreateMaterial(MaterialShaderPair* o_mat, TFileSystem* i_fs, const mat_parser::MaterialDescription& i_matDesc, TIOAllocator* i_ioAllocator, TMemoryAllocator* i_dataAllocator)
+const bool CreateMaterial(MaterialShaderPair* o_mat, TFileSystem* i_fs, const mat_parser::MaterialDescription& i_matDesc, TIOAllocator* i_ioAllocator, TMemoryAllocator* i_dataAllocator, ShaderCache* io_shaderCache)
 {
 	if (i_matDesc.vertexShaderPath == nullptr || i_matDesc.fragmentShaderPath == nullptr)
 	{
@@ -290,7 +299,7 @@ const bool CreateMaterial(MaterialShaderPair* o_mat, TFileSystem* i_fs, const ma
 	shaderDesc.fs[inp.file_size] = 0;
 	floral::close_file(inp);
 
-	o_mat->shader = insigne::create_shader(shaderDesc);
+	o_mat->shader = internal::CreateShader(shaderDesc, i_matDesc, io_shaderCache);
 	insigne::infuse_material(o_mat->shader, o_mat->material);
 
 	// render state
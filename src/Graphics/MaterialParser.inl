@@ -45,7 +45,16 @@ const MaterialDescription ParseMaterial(TFileSystem* i_fs, const floral::relativ
 template <class TMemoryArena>
 const MaterialDescription ParseMaterial(const_cstr i_descBuffer, TMemoryArena* i_memoryArena)
 {
+	// the sections may be missing
 	MaterialDescription material;
+	material.vertexShaderPath = nullptr;
+	material.fragmentShaderPath = nullptr;
+	material.featuresCount = 0;
+	material.featureList = nullptr;
+	material.buffersCount = 0;
+	material.bufferDescriptions = nullptr;
+	material.texturesCount = 0;
+	material.textureDescriptions = nullptr;
 
 	internal::TokenArray<TMemoryArena> tokenArray(i_memoryArena);
 
@@ -61,10 +70,11 @@ namespace internal
 {
 // ----------------------------------------------------------------------------
 
+// per thread, materials can be parsed from several refrain2 tasks at once
 template <class TMemoryArena>
 struct StringAllocatorRegistry
 {
-	static TMemoryArena* allocator;
+	static thread_local TMemoryArena* allocator;
 	static voidptr allocate(const size i_size)
 	{
 		return allocator->allocate(i_size);
@@ -72,7 +82,7 @@ struct StringAllocatorRegistry
 };
 
 template <class TMemoryArena>
-TMemoryArena* StringAllocatorRegistry<TMemoryArena>::allocator = nullptr;
+thread_local TMemoryArena* StringAllocatorRegistry<TMemoryArena>::allocator = nullptr;
 
 template <class TMemoryArena>
 const_cstr MaterialLexer(const_cstr i_descBuffer, TokenArray<TMemoryArena>* o_tokenArray, TMemoryArena* i_memoryArena)
@@ -0,0 +1,349 @@
+#include "PlyLoading.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <floral/io/nativeio.h>
+#include <floral/math/utils.h>
+#include <clover/Logger.h>
+#include <insigne/ut_render.h>
+
+#include "InsigneImGui.h"
+#include "Graphics/PlyLoader.h"
+
+namespace stone
+{
+namespace perf
+{
+//-------------------------------------------------------------------
+
+static const_cstr k_AsciiFilePath = "ply_loading_ascii.ply";
+static const_cstr k_BinaryFilePath = "ply_loading_binary.ply";
+static const s32 k_GridColumns = 2048;
+static const s32 k_MaxGridRows = 1024;
+static const size k_WriteChunkSize = SIZE_KB(64);
+
+// the layout of the demo's cornell box files
+static const size WriteHeader(c8* o_buffer, const size i_capacity, const_cstr i_format, const s32 i_gridRows)
+{
+	const s32 verticesCount = i_gridRows * k_GridColumns;
+	const s32 facesCount = (i_gridRows - 1) * (k_GridColumns - 1);
+	return (size)snprintf(o_buffer, i_capacity,
+			"ply\nformat %s 1.0\ncomment ply loading benchmark\n"
+			"element vertex %d\n"
+			"property float x\nproperty float y\nproperty float z\n"
+			"property float nx\nproperty float ny\nproperty float nz\n"
+			"property float s\nproperty float t\n"
+			"property uchar red\nproperty uchar green\nproperty uchar blue\n"
+			"element face %d\nproperty list uchar uint vertex_indices\nend_header\n",
+			i_format, verticesCount, facesCount);
+}
+
+static inline const floral::vec3f GetGridPosition(const s32 i_row, const s32 i_column)
+{
+	return floral::vec3f(i_column * 0.01f, 0.5f * sinf(i_column * 0.05f) * cosf(i_row * 0.05f), i_row * 0.01f);
+}
+
+static const f64 GetDurationMs(const std::chrono::high_resolution_clock::time_point& i_start)
+{
+	const std::chrono::duration<f64, std::milli> duration = std::chrono::high_resolution_clock::now() - i_start;
+	return duration.count();
+}
+
+//-------------------------------------------------------------------
+
+PlyLoading::PlyLoading()
+	: m_GridRows(k_MaxGridRows)
+	, m_FilesGenerated(false)
+	, m_MaxPositionDifference(0.0f)
+	, m_Positions(nullptr)
+	, m_ReferencePositions(nullptr)
+	, m_Indices(nullptr)
+	, m_WriteChunk(nullptr)
+	, m_MemoryArena(nullptr)
+{
+	memset(m_Results, 0, sizeof(m_Results));
+}
+
+PlyLoading::~PlyLoading()
+{
+}
+
+ICameraMotion* PlyLoading::GetCameraMotion()
+{
+	return nullptr;
+}
+
+const_cstr PlyLoading::GetName() const
+{
+	return k_name;
+}
+
+void PlyLoading::_OnInitialize()
+{
+	// only the positions and the indices are read so that 2M vertices fit in the stream region
+	const size verticesCount = k_MaxGridRows * k_GridColumns;
+	const size indicesCount = (k_MaxGridRows - 1) * (k_GridColumns - 1) * 4;
+	m_MemoryArena = g_StreammingAllocator.allocate_arena<LinearArena>(
+			verticesCount * sizeof(floral::vec3f) * 2 + indicesCount * sizeof(s32) + k_WriteChunkSize + SIZE_KB(64));
+
+	m_Positions = m_MemoryArena->allocate_array<floral::vec3f>(verticesCount);
+	m_ReferencePositions = m_MemoryArena->allocate_array<floral::vec3f>(verticesCount);
+	m_Indices = m_MemoryArena->allocate_array<s32>(indicesCount);
+	m_WriteChunk = m_MemoryArena->allocate_array<c8>(k_WriteChunkSize);
+}
+
+void PlyLoading::_OnUpdate(const f32 i_deltaMs)
+{
+	static const_cstr k_LoaderNames[] = { "sscanf (previous loader)", "ascii", "binary" };
+
+	ImGui::Begin("Controller##PlyLoading");
+	ImGui::SliderInt("Grid rows", &m_GridRows, 2, k_MaxGridRows);
+	ImGui::Text("%d x %d vertices", m_GridRows, k_GridColumns);
+	if (ImGui::Button("Generate files"))
+	{
+		_GenerateFiles();
+	}
+
+	if (m_FilesGenerated)
+	{
+		for (s32 i = 0; i < (s32)Loader::Count; i++)
+		{
+			c8 buttonLabel[64];
+			snprintf(buttonLabel, sizeof(buttonLabel), "Load: %s", k_LoaderNames[i]);
+			if (ImGui::Button(buttonLabel))
+			{
+				_Load((Loader)i);
+			}
+		}
+	}
+
+	for (s32 i = 0; i < (s32)Loader::Count; i++)
+	{
+		const LoadingResult& result = m_Results[i];
+		if (result.durationMs <= 0.0)
+		{
+			continue;
+		}
+
+		ImGui::Separator();
+		ImGui::Text("%s: %s", k_LoaderNames[i], result.succeeded ? "succeeded" : "failed");
+		ImGui::Text("%u vertices, %u faces, %4.2f MB", result.verticesCount, result.facesCount, result.fileSize / (1024.0f * 1024.0f));
+		ImGui::Text("Time: %4.2f ms", result.durationMs);
+		ImGui::Text("%4.2f M vertices/s, %4.2f MB/s", result.verticesCount / (result.durationMs * 1000.0),
+				result.fileSize / (1024.0 * 1024.0) / (result.durationMs / 1000.0));
+	}
+
+	if (m_Results[(s32)Loader::Ascii].succeeded && m_Results[(s32)Loader::Binary].succeeded)
+	{
+		ImGui::Separator();
+		ImGui::Text("Max position difference (ascii - binary): %g", m_MaxPositionDifference);
+	}
+	ImGui::End();
+}
+
+void PlyLoading::_OnRender(const f32 i_deltaMs)
+{
+	insigne::begin_render_pass(DEFAULT_FRAMEBUFFER_HANDLE);
+
+	RenderImGui();
+
+	insigne::end_render_pass(DEFAULT_FRAMEBUFFER_HANDLE);
+	insigne::mark_present_render();
+	insigne::dispatch_render_pass();
+}
+
+void PlyLoading::_OnCleanUp()
+{
+	g_StreammingAllocator.free(m_MemoryArena);
+}
+
+//-------------------------------------------------------------------
+
+void PlyLoading::_GenerateFiles()
+{
+	c8* chunk = m_WriteChunk;
+	const size flushSize = k_WriteChunkSize - 256;
+
+	{
+		floral::file_info oFile = floral::open_output_file(k_AsciiFilePath);
+		floral::output_file_stream oStream;
+		floral::map_output_file(oFile, &oStream);
+
+		size chunkSize = WriteHeader(chunk, k_WriteChunkSize, "ascii", m_GridRows);
+		for (s32 r = 0; r < m_GridRows; r++)
+		{
+			for (s32 c = 0; c < k_GridColumns; c++)
+			{
+				const floral::vec3f p = GetGridPosition(r, c);
+				chunkSize += snprintf(chunk + chunkSize, k_WriteChunkSize - chunkSize,
+						"%f %f %f 0.000000 1.000000 0.000000 %f %f %d %d 255\n",
+						p.x, p.y, p.z, (f32)c / k_GridColumns, (f32)r / m_GridRows, c & 0xff, r & 0xff);
+				if (chunkSize >= flushSize)
+				{
+					oStream.write_bytes(chunk, chunkSize);
+					chunkSize = 0;
+				}
+			}
+		}
+
+		for (s32 r = 0; r < m_GridRows - 1; r++)
+		{
+			for (s32 c = 0; c < k_GridColumns - 1; c++)
+			{
+				const s32 v = r * k_GridColumns + c;
+				chunkSize += snprintf(chunk + chunkSize, k_WriteChunkSize - chunkSize,
+						"4 %d %d %d %d\n", v, v + 1, v + k_GridColumns + 1, v + k_GridColumns);
+				if (chunkSize >= flushSize)
+				{
+					oStream.write_bytes(chunk, chunkSize);
+					chunkSize = 0;
+				}
+			}
+		}
+
+		oStream.write_bytes(chunk, chunkSize);
+		floral::close_file(oFile);
+	}
+
+	{
+		floral::file_info oFile = floral::open_output_file(k_BinaryFilePath);
+		floral::output_file_stream oStream;
+		floral::map_output_file(oFile, &oStream);
+
+		// the hosts are little endian
+		size chunkSize = WriteHeader(chunk, k_WriteChunkSize, "binary_little_endian", m_GridRows);
+		for (s32 r = 0; r < m_GridRows; r++)
+		{
+			for (s32 c = 0; c < k_GridColumns; c++)
+			{
+				const floral::vec3f p = GetGridPosition(r, c);
+				const f32 attributes[8] = { p.x, p.y, p.z, 0.0f, 1.0f, 0.0f, (f32)c / k_GridColumns, (f32)r / m_GridRows };
+				const u8 color[3] = { (u8)(c & 0xff), (u8)(r & 0xff), 255 };
+				memcpy(chunk + chunkSize, attributes, sizeof(attributes));
+				memcpy(chunk + chunkSize + sizeof(attributes), color, sizeof(color));
+				chunkSize += sizeof(attributes) + sizeof(color);
+				if (chunkSize >= flushSize)
+				{
+					oStream.write_bytes(chunk, chunkSize);
+					chunkSize = 0;
+				}
+			}
+		}
+
+		for (s32 r = 0; r < m_GridRows - 1; r++)
+		{
+			for (s32 c = 0; c < k_GridColumns - 1; c++)
+			{
+				const u32 v = (u32)(r * k_GridColumns + c);
+				const u32 face[4] = { v, v + 1, v + k_GridColumns + 1, v + k_GridColumns };
+				chunk[chunkSize] = 4;
+				memcpy(chunk + chunkSize + 1, face, sizeof(face));
+				chunkSize += 1 + sizeof(face);
+				if (chunkSize >= flushSize)
+				{
+					oStream.write_bytes(chunk, chunkSize);
+					chunkSize = 0;
+				}
+			}
+		}
+
+		oStream.write_bytes(chunk, chunkSize);
+		floral::close_file(oFile);
+	}
+
+	m_FilesGenerated = true;
+	memset(m_Results, 0, sizeof(m_Results));
+	CLOVER_VERBOSE("Generated the %d x %d vertices ply files", m_GridRows, k_GridColumns);
+}
+
+void PlyLoading::_Load(const Loader i_loader)
+{
+	using namespace std::chrono;
+
+	LoadingResult& result = m_Results[(s32)i_loader];
+	const high_resolution_clock::time_point start = high_resolution_clock::now();
+
+	ply::File plyFile;
+	const_cstr filePath = i_loader == Loader::Binary ? k_BinaryFilePath : k_AsciiFilePath;
+	result.succeeded = ply::OpenFile(floral::path(filePath), &plyFile);
+	if (!result.succeeded)
+	{
+		result.durationMs = GetDurationMs(start);
+		return;
+	}
+
+	const u32 verticesCount = ply::GetVerticesCount(plyFile.header);
+	const u32 facesCount = ply::GetFacesCount(plyFile.header);
+	// both ascii loaders give the same floats
+	floral::vec3f* positions = i_loader == Loader::Binary ? m_Positions : m_ReferencePositions;
+
+	if (i_loader == Loader::Sscanf)
+	{
+		// what the loader did before: a line at a time through sscanf
+		const c8* cursor = (const c8*)plyFile.data + plyFile.header.bodyOffset;
+		const c8* end = (const c8*)plyFile.data + plyFile.dataSize;
+		c8 line[256];
+		u32 linesCount = 0;
+		while (cursor < end && linesCount < verticesCount + facesCount)
+		{
+			size length = 0;
+			while (cursor < end && *cursor != '\n' && length < sizeof(line) - 1)
+			{
+				line[length++] = *cursor++;
+			}
+			line[length] = 0;
+			cursor++;
+
+			if (linesCount < verticesCount)
+			{
+				floral::vec3f normal;
+				floral::vec2f texCoord;
+				u32 red, green, blue;
+				sscanf(line, "%f %f %f %f %f %f %f %f %u %u %u",
+						&positions[linesCount].x, &positions[linesCount].y, &positions[linesCount].z,
+						&normal.x, &normal.y, &normal.z, &texCoord.x, &texCoord.y,
+						&red, &green, &blue);
+			}
+			else
+			{
+				s32* face = &m_Indices[(linesCount - verticesCount) * 4];
+				s32 faceSize = 0;
+				sscanf(line, "%d %d %d %d %d", &faceSize, &face[0], &face[1], &face[2], &face[3]);
+			}
+			linesCount++;
+		}
+		result.succeeded = (linesCount == verticesCount + facesCount);
+	}
+	else
+	{
+		ply::Output output;
+		memset(&output, 0, sizeof(output));
+		output.positions = positions;
+		output.indices = m_Indices;
+		output.indicesPerFace = 4;
+		result.succeeded = ply::ReadBody(plyFile, output);
+	}
+
+	result.fileSize = plyFile.dataSize;
+	ply::CloseFile(&plyFile);
+	result.durationMs = GetDurationMs(start);
+	result.verticesCount = verticesCount;
+	result.facesCount = facesCount;
+
+	if (m_Results[(s32)Loader::Ascii].succeeded && m_Results[(s32)Loader::Binary].succeeded)
+	{
+		m_MaxPositionDifference = 0.0f;
+		for (u32 i = 0; i < verticesCount; i++)
+		{
+			const floral::vec3f d = m_ReferencePositions[i] - m_Positions[i];
+			m_MaxPositionDifference = floral::max(m_MaxPositionDifference, floral::max(fabsf(d.x), floral::max(fabsf(d.y), fabsf(d.z))));
+		}
+	}
+}
+
+//-------------------------------------------------------------------
+}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+#include <floral/gpds/vec.h>
+
+#include <insigne/commons.h>
+
+#include "Graphics/TestSuite.h"
+#include "Memory/MemorySystem.h"
+
+namespace stone
+{
+namespace perf
+{
+// ------------------------------------------------------------------
+
+class PlyLoading : public TestSuite
+{
+public:
+	static constexpr const_cstr k_name			= "ply loading";
+
+public:
+	PlyLoading();
+	~PlyLoading();
+
+	ICameraMotion*								GetCameraMotion() override;
+	const_cstr									GetName() const override;
+
+private:
+	void										_OnInitialize() override;
+	void										_OnUpdate(const f32 i_deltaMs) override;
+	void										_OnRender(const f32 i_deltaMs) override;
+	void										_OnCleanUp() override;
+
+private:
+	enum class Loader : u8
+	{
+		Sscanf = 0,
+		Ascii,
+		Binary,
+		Count
+	};
+
+	struct LoadingResult
+	{
+		bool									succeeded;
+		f64										durationMs;
+		u32										verticesCount;
+		u32										facesCount;
+		size									fileSize;
+	};
+
+	void										_GenerateFiles();
+	void										_Load(const Loader i_loader);
+
+private:
+	s32											m_GridRows;
+	bool										m_FilesGenerated;
+	LoadingResult								m_Results[(s32)Loader::Count];
+	f32											m_MaxPositionDifference;	// between the ascii and the binary files
+
+	floral::vec3f*								m_Positions;
+	floral::vec3f*								m_ReferencePositions;
+	s32*										m_Indices;
+	c8*											m_WriteChunk;
+
+private:
+	LinearArena*								m_MemoryArena;
+};
+
+// ------------------------------------------------------------------
+}
+}
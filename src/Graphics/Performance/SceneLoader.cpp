@@ -1,9 +1,13 @@
 #include "SceneLoader.h"
 
+#include <chrono>
+#include <math.h>
+
 #include <floral/io/nativeio.h>
 #include <floral/gpds/camera.h>
 #include <floral/gpds/vec.h>
 #include <floral/math/transform.h>
+#include <floral/math/utils.h>
 
 #include <calyx/context.h>
 
@@ -17,7 +21,6 @@
 
 #include "InsigneImGui.h"
 
-#include "Graphics/CbSceneLoader.h"
 #include "Graphics/DebugDrawer.h"
 
 namespace stone
@@ -26,7 +29,24 @@ namespace perf
 {
 //-------------------------------------------------------------------
 
+static const cbmodel::VertexAttribute			k_MeshAttributes = cbmodel::VertexAttribute::Position | cbmodel::VertexAttribute::Normal
+													| cbmodel::VertexAttribute::Tangent | cbmodel::VertexAttribute::TexCoord;
+// the 4 allocations of a converted mesh are aligned
+static const size								k_MeshAllocationsSlack = 256;
+
+//-------------------------------------------------------------------
+
 SceneLoader::SceneLoader()
+	: m_LoadMs(0.0f)
+	, m_ProjectionScale(1.0f)
+	, m_LodPixelsError(1.0f)
+	, m_DrawnTrianglesCount(0)
+	, m_ClusterCulling(true)
+	, m_BackfaceCulling(true)
+	, m_CullingBufferIdx(0)
+	, m_CullingRanges(nullptr)
+	, m_ShadowInstanceSlot(-1)
+	, m_CullingArena(nullptr)
 {
 }
 
@@ -62,11 +82,15 @@ void SceneLoader::_OnInitialize()
 	m_SceneDataArena = g_StreammingAllocator.allocate_arena<LinearArena>(SIZE_MB(16));
 	m_MaterialDataArena = g_StreammingAllocator.allocate_arena<LinearArena>(SIZE_MB(1));
 	m_PostFXArena = g_StreammingAllocator.allocate_arena<LinearArena>(SIZE_MB(4));
+	// the sponza materials share a handful of programs
+	mat_loader::InitializeShaderCache(&m_ShaderCache, 32, m_SceneDataArena);
 
 	calyx::context_attribs* commonCtx = calyx::get_context_attribs();
 	f32 aspectRatio = (f32)commonCtx->window_width / (f32)commonCtx->window_height;
 
 	insigne::register_surface_type<geo3d::SurfacePNTT>();
+	insigne::register_surface_type<geo3d::SurfacePNTTQ16>();
+	insigne::register_surface_type<geo3d::SurfacePNTTQ8>();
 	insigne::register_surface_type<geo2d::SurfacePT>();
 
 	// prebake splitsum
@@ -123,6 +147,8 @@ void SceneLoader::_OnInitialize()
 	m_projection = floral::construct_perspective(1.0f, 200.0f, 45.0f, aspectRatio);
 	m_SceneData.viewProjectionMatrix = m_projection * m_view;
 	m_SceneData.cameraPosition = floral::vec4f(k_cameraPosition, 1.0f);
+	m_CameraPosition = k_cameraPosition;
+	m_ProjectionScale = (f32)commonCtx->window_height / (2.0f * tanf(floral::to_radians(45.0f) * 0.5f));
 	{
 		m_MemoryArena->free_all();
 		// loading SH
@@ -177,38 +203,274 @@ void SceneLoader::_OnInitialize()
 		insigne::dispatch_render_pass();
 	}
 
+	using namespace std::chrono;
+	high_resolution_clock::time_point loadStart = high_resolution_clock::now();
+
+	// the package is mapped and the workers do not share m_FileSystem, so both get absolute paths: m_FileSystem
+	// is rooted at the application directory and wdir is its working directory
+	floral::relative_path sceneRelDir = floral::build_relative_path("sponza");
+	floral::absolute_path sceneDir = floral::get_application_directory();
+	floral::concat_path(&sceneDir, wdir);
+	floral::concat_path(&sceneDir, sceneRelDir);
+	c8 sceneDirStr[1024];
+	floral::get_as_cstr(sceneDirStr, sceneDir);
+
+	// one mapping for the whole scene, the meshes are used in place
+	c8 packagePath[1024];
+	snprintf(packagePath, sizeof(packagePath), "%s/sponza.cbpkg", sceneDirStr);
+	const bool packageResult = cbscene::OpenScenePackage(&m_ScenePackage, floral::path(packagePath));
+	FLORAL_ASSERT(packageResult);
+	const u32 nodesCount = m_ScenePackage.header->nodesCount;
+	const u32 meshesCount = m_ScenePackage.header->meshesCount;
+	const u32 materialsCount = m_ScenePackage.header->materialsCount;
+
+	MeshData* meshes = m_SceneDataArena->allocate_array<MeshData>(meshesCount);
+	helpers::SurfaceGPU* modelsGPU = m_SceneDataArena->allocate_array<helpers::SurfaceGPU>(meshesCount);
+	insigne::ib_handle_t* lodIBs = m_SceneDataArena->allocate_array<insigne::ib_handle_t>(meshesCount * cbmodel::k_MaxLodsCount);
+	mat_parser::MaterialDescription* materialDescs = m_SceneDataArena->allocate_array<mat_parser::MaterialDescription>(materialsCount);
+	mat_loader::MaterialShaderPair* materials = m_SceneDataArena->allocate_array<mat_loader::MaterialShaderPair>(materialsCount);
+
+	// at most a registry per node, the materials are bound to it as they are created
+	{
+		insigne::ubdesc_t ubDesc;
+		ubDesc.region_size = floral::next_pow2(size(k_InstanceDataStride * floral::max(nodesCount, 1u)));
+		ubDesc.data = nullptr;
+		ubDesc.data_size = 0;
+		ubDesc.usage = insigne::buffer_usage_e::dynamic_draw;
+		m_InstanceUB = insigne::create_ub(ubDesc);
+	}
+
+	// the meshes that cannot be used in place are converted by the tasks, their memory outlives the loading
+	// so it is allocated first, before the arenas of the tasks
+	LoadTaskData taskData[k_LoadTasksCount];
+	size meshScratchSizes[k_LoadTasksCount];
+	for (u32 i = 0; i < k_LoadTasksCount; i++)
+	{
+		LoadTaskData& task = taskData[i];
+		task.meshesBegin = meshesCount * i / k_LoadTasksCount;
+		task.meshesEnd = meshesCount * (i + 1) / k_LoadTasksCount;
+
+		size meshDataSize = 0;
+		meshScratchSizes[i] = 0;
+		for (u32 j = task.meshesBegin; j < task.meshesEnd; j++)
+		{
+			if (CanUseMeshInPlace(cbscene::GetPackageMeshHeader(m_ScenePackage, j)))
+			{
+				continue;
+			}
+
+			size ioSize = 0;
+			size dataSize = 0;
+			switch (GetDrawnVertexFormat(cbscene::GetPackageMeshHeader(m_ScenePackage, j)))
+			{
+			case cbmodel::VertexFormat::Quantized16:
+				cbscene::GetPackageMeshLoadSizes<geo3d::VertexPNTTQ16>(m_ScenePackage, j, k_MeshAttributes, &ioSize, &dataSize);
+				break;
+			case cbmodel::VertexFormat::Quantized8:
+				cbscene::GetPackageMeshLoadSizes<geo3d::VertexPNTTQ8>(m_ScenePackage, j, k_MeshAttributes, &ioSize, &dataSize);
+				break;
+			default:
+				cbscene::GetPackageMeshLoadSizes<geo3d::VertexPNTT>(m_ScenePackage, j, k_MeshAttributes, &ioSize, &dataSize);
+				break;
+			}
+			meshDataSize += dataSize + k_MeshAllocationsSlack;
+			if (ioSize > meshScratchSizes[i])
+			{
+				meshScratchSizes[i] = ioSize;
+			}
+		}
+
+		m_MeshDataArenas[i] = nullptr;
+		if (meshDataSize > 0)
+		{
+			m_MeshDataArenas[i] = g_StreammingAllocator.allocate_arena<LinearArena>(meshDataSize);
+		}
+		task.meshDataArena = m_MeshDataArenas[i];
+	}
+
+	for (u32 i = 0; i < k_LoadTasksCount; i++)
+	{
+		LoadTaskData& task = taskData[i];
+		task.package = &m_ScenePackage;
+		task.sceneDir = sceneDirStr;
+		task.arena = g_StreammingAllocator.allocate_arena<LinearArena>(SIZE_KB(256));
+		task.meshScratchArena = nullptr;
+		if (meshScratchSizes[i] > 0)
+		{
+			task.meshScratchArena = g_StreammingAllocator.allocate_arena<LinearArena>(meshScratchSizes[i] + k_MeshAllocationsSlack);
+		}
+		task.materialsBegin = materialsCount * i / k_LoadTasksCount;
+		task.materialsEnd = materialsCount * (i + 1) / k_LoadTasksCount;
+		task.meshes = meshes;
+		task.materialDescs = materialDescs;
+		task.consumed = false;
+		task.counter.store(1);
+
+		refrain2::Task newTask;
+		newTask.pm_Instruction = &SceneLoader::LoadSceneRange;
+		newTask.pm_Data = &task;
+		newTask.pm_Counter = &task.counter;
+		refrain2::g_TaskManager->PushTask(newTask);
+	}
+
+	// the gpu resources are created in batches, one per finished task
+	floral::push_directory(m_FileSystem, sceneRelDir);
+	u32 tasksLeft = k_LoadTasksCount;
+	while (tasksLeft > 0)
+	{
+		for (u32 i = 0; i < k_LoadTasksCount; i++)
+		{
+			LoadTaskData& task = taskData[i];
+			if (task.consumed || !refrain2::CheckForCounter(task.counter, 0))
+			{
+				continue;
+			}
+
+			for (u32 j = task.materialsBegin; j < task.materialsEnd; j++)
+			{
+				materials[j] = _CreateMaterial(materialDescs[j]);
+			}
+			for (u32 j = task.meshesBegin; j < task.meshesEnd; j++)
+			{
+				// the lods share the vertex buffer, each one is an index buffer over its range of the indices
+				const cbmodel::Model<geo3d::VertexPNTT>& model = meshes[j].model;
+				modelsGPU[j] = helpers::CreateSurfaceGPU(meshes[j].vertices, model.verticesCount, meshes[j].vertexStride,
+						model.indicesData + model.lods[0].firstIndex, model.lods[0].indicesCount, insigne::buffer_usage_e::static_draw, false);
+				lodIBs[j * cbmodel::k_MaxLodsCount] = modelsGPU[j].ib;
+				for (u32 k = 1; k < model.lodsCount; k++)
+				{
+					lodIBs[j * cbmodel::k_MaxLodsCount + k] = helpers::CreateIndexBufferGPU(model.indicesData + model.lods[k].firstIndex,
+							model.lods[k].indicesCount, insigne::buffer_usage_e::static_draw, false);
+				}
+			}
+			insigne::dispatch_render_pass();
+			task.consumed = true;
+			tasksLeft--;
+		}
+	}
+
+	for (s32 i = k_LoadTasksCount - 1; i >= 0; i--)
+	{
+		if (taskData[i].meshScratchArena)
+		{
+			g_StreammingAllocator.free(taskData[i].meshScratchArena);
+		}
+		g_StreammingAllocator.free(taskData[i].arena);
+	}
+
+	// the bounds of the scene are the ones of the meshes where their nodes place them, the shadow frustum is fit to it
 	m_MemoryArena->free_all();
-	const cbscene::Scene scene = cbscene::LoadSceneData(m_FileSystem, floral::build_relative_path("sponza/sponza.gltf.cbscene"),
-			m_MemoryArena, m_SceneDataArena);
+	const cbscene::Scene scene = cbscene::GetPackageScene(m_ScenePackage, m_MemoryArena);
+	floral::mat4x4f* worldMatrices = m_MemoryArena->allocate_array<floral::mat4x4f>(nodesCount);
+	cbscene::ComputeWorldMatrices(scene, worldMatrices);
 
-	floral::push_directory(m_FileSystem, floral::build_relative_path("sponza"));
-	m_MaterialArray.reserve(scene.nodesCount, m_SceneDataArena);
-	m_ModelDataArray.reserve(scene.nodesCount, m_SceneDataArena);
+	m_ModelDataArray.reserve(nodesCount, m_SceneDataArena);
+	// read by insigne when the update is dispatched
+	p8 instancesData = (p8)m_SceneDataArena->allocate(k_InstanceDataStride * floral::max(nodesCount, 1u));
 	floral::vec3f minCorner(9999.0f, 9999.0f, 9999.0f);
 	floral::vec3f maxCorner(-9999.0f, -9999.0f, -9999.0f);
-	for (size i = 0; i < scene.nodesCount; i++)
+	for (u32 i = 0; i < nodesCount; i++)
 	{
-		m_MemoryArena->free_all();
-		cbmodel::Model<geo3d::VertexPNTT> model = cbmodel::LoadModelData<geo3d::VertexPNTT>(m_FileSystem,
-				floral::build_relative_path(scene.nodeFileNames[i]),
-				cbmodel::VertexAttribute::Position | cbmodel::VertexAttribute::Normal | cbmodel::VertexAttribute::Tangent | cbmodel::VertexAttribute::TexCoord,
-				m_MemoryArena, m_SceneDataArena);
-
-		if (model.aabb.min_corner.x < minCorner.x) minCorner.x = model.aabb.min_corner.x;
-		if (model.aabb.min_corner.y < minCorner.y) minCorner.y = model.aabb.min_corner.y;
-		if (model.aabb.min_corner.z < minCorner.z) minCorner.z = model.aabb.min_corner.z;
-
-		if (model.aabb.max_corner.x > maxCorner.x) maxCorner.x = model.aabb.max_corner.x;
-		if (model.aabb.max_corner.y > maxCorner.y) maxCorner.y = model.aabb.max_corner.y;
-		if (model.aabb.max_corner.z > maxCorner.z) maxCorner.z = model.aabb.max_corner.z;
-
-		c8 materialPath[128];
-		sprintf(materialPath, "materials/%s.mat", model.materialName);
-		mat_loader::MaterialShaderPair msPair = _LoadMaterial(materialPath);
-		helpers::SurfaceGPU modelGPU = helpers::CreateSurfaceGPU(model.verticesData, model.verticesCount, sizeof(geo3d::VertexPNTT),
-				model.indicesData, model.indicesCount, insigne::buffer_usage_e::static_draw, false);
-		m_ModelDataArray.push_back(ModelRegistry{ model, msPair, modelGPU });
+		const s32 meshIdx = scene.meshIndices[i];
+		if (meshIdx < 0)
+		{
+			continue;
+		}
+		const cbmodel::Model<geo3d::VertexPNTT>& model = meshes[meshIdx].model;
+
+		for (u32 j = 0; j < 8; j++)
+		{
+			const floral::vec3f corner(
+					(j & 1) ? model.aabb.max_corner.x : model.aabb.min_corner.x,
+					(j & 2) ? model.aabb.max_corner.y : model.aabb.min_corner.y,
+					(j & 4) ? model.aabb.max_corner.z : model.aabb.min_corner.z);
+			const floral::vec3f worldCorner = floral::apply_point_transform(corner, worldMatrices[i]);
+
+			if (worldCorner.x < minCorner.x) minCorner.x = worldCorner.x;
+			if (worldCorner.y < minCorner.y) minCorner.y = worldCorner.y;
+			if (worldCorner.z < minCorner.z) minCorner.z = worldCorner.z;
+
+			if (worldCorner.x > maxCorner.x) maxCorner.x = worldCorner.x;
+			if (worldCorner.y > maxCorner.y) maxCorner.y = worldCorner.y;
+			if (worldCorner.z > maxCorner.z) maxCorner.z = worldCorner.z;
+		}
+
+		ModelRegistry registry;
+		registry.model = model;
+		registry.msPair = materials[m_ScenePackage.meshes[meshIdx].materialIdx];
+		registry.modelGPU = modelsGPU[meshIdx];
+		memcpy(registry.lodIBs, &lodIBs[meshIdx * cbmodel::k_MaxLodsCount], sizeof(registry.lodIBs));
+		registry.instanceSlot = insigne::get_material_uniform_block_slot(registry.msPair.material, "ub_Instance");
+		FLORAL_ASSERT_MSG(registry.instanceSlot >= 0, "The scene materials must hold ub_Instance");
+		registry.instanceOffset = k_InstanceDataStride * m_ModelDataArray.get_size();
+		registry.worldMatrix = worldMatrices[i];
+		registry.invWorldMatrix = worldMatrices[i].get_inverse();
+		registry.lod = 0;
+		registry.culledIndices[0] = nullptr;
+		registry.culledIndices[1] = nullptr;
+		registry.culledIndicesCount = 0;
+		registry.drawCulled = false;
+
+		InstanceData instance;
+		instance.worldMatrix = registry.worldMatrix;
+		instance.invWorldMatrix = registry.invWorldMatrix;
+		if (model.vertexFormat != cbmodel::VertexFormat::Float)
+		{
+			const cbmodel::Quantization& quantization = model.quantization;
+			instance.positionOffset = floral::vec4f(quantization.positionOffset, 1.0f);
+			instance.positionScale = floral::vec4f(quantization.positionScale, 0.0f);
+			instance.texcoordOffsetScale = floral::vec4f(quantization.texcoordOffset.x, quantization.texcoordOffset.y,
+					quantization.texcoordScale.x, quantization.texcoordScale.y);
+		}
+		else
+		{
+			instance.positionOffset = floral::vec4f(0.0f, 0.0f, 0.0f, 0.0f);
+			instance.positionScale = floral::vec4f(1.0f, 1.0f, 1.0f, 0.0f);
+			instance.texcoordOffsetScale = floral::vec4f(0.0f, 0.0f, 1.0f, 1.0f);
+		}
+		memcpy(instancesData + registry.instanceOffset, &instance, sizeof(InstanceData));
+		m_ModelDataArray.push_back(registry);
+	}
+	if (m_ModelDataArray.get_size() > 0)
+	{
+		insigne::copy_update_ub(m_InstanceUB, instancesData, k_InstanceDataStride * m_ModelDataArray.get_size(), 0);
 	}
+
+	// the culled index buffers start as the whole lod 0
+	size cullingArenaSize = 0;
+	u32 maxClustersCount = 0;
+	for (size i = 0; i < m_ModelDataArray.get_size(); i++)
+	{
+		const cbmodel::Model<geo3d::VertexPNTT>& model = m_ModelDataArray[i].model;
+		if (model.clustersCount > 0)
+		{
+			cullingArenaSize += 2 * sizeof(s32) * model.lods[0].indicesCount;
+			maxClustersCount = floral::max(maxClustersCount, model.clustersCount);
+		}
+	}
+	cullingArenaSize += sizeof(cluster_culling::IndexRange) * maxClustersCount;
+	m_CullingArena = g_StreammingAllocator.allocate_arena<LinearArena>(cullingArenaSize + SIZE_KB(64));
+	m_CullingRanges = m_CullingArena->allocate_array<cluster_culling::IndexRange>(maxClustersCount);
+	for (size i = 0; i < m_ModelDataArray.get_size(); i++)
+	{
+		ModelRegistry& registry = m_ModelDataArray[i];
+		const cbmodel::Model<geo3d::VertexPNTT>& model = registry.model;
+		if (model.clustersCount == 0)
+		{
+			continue;
+		}
+
+		registry.culledIndices[0] = m_CullingArena->allocate_array<s32>(model.lods[0].indicesCount);
+		registry.culledIndices[1] = m_CullingArena->allocate_array<s32>(model.lods[0].indicesCount);
+		registry.culledIB = helpers::CreateIndexBufferGPU(model.indicesData + model.lods[0].firstIndex, model.lods[0].indicesCount,
+				insigne::buffer_usage_e::dynamic_draw, false);
+	}
+	insigne::dispatch_render_pass();
+	high_resolution_clock::time_point loadEnd = high_resolution_clock::now();
+	duration<f64, std::milli> loadDuration = loadEnd - loadStart;
+	m_LoadMs = (f32)loadDuration.count();
+	CLOVER_VERBOSE("Scene loaded in %4.2f ms: %d nodes, %d meshes, %d materials", m_LoadMs, nodesCount, meshesCount, materialsCount);
+	CLOVER_VERBOSE("%d shaders compiled, %d reused", m_ShaderCache.entriesCount, m_ShaderCache.hitsCount);
 	m_SceneAABB.min_corner = minCorner;
 	m_SceneAABB.max_corner = maxCorner;
 	floral::pop_directory(m_FileSystem);
@@ -294,6 +556,9 @@ void SceneLoader::_OnInitialize()
 		bool matLoadResult = mat_loader::CreateMaterial(&m_ShadowMapMaterial, m_FileSystem, matDesc, m_MemoryArena, m_MaterialDataArena);
 		FLORAL_ASSERT(matLoadResult);
 		insigne::helpers::assign_uniform_block(m_ShadowMapMaterial.material, "ub_Scene", 0, 0, m_ShadowSceneUB);
+		insigne::helpers::assign_uniform_block(m_ShadowMapMaterial.material, "ub_Instance", 0, k_InstanceDataStride, m_InstanceUB);
+		m_ShadowInstanceSlot = insigne::get_material_uniform_block_slot(m_ShadowMapMaterial.material, "ub_Instance");
+		FLORAL_ASSERT(m_ShadowInstanceSlot >= 0);
 	}
 
 	m_MemoryArena->free_all();
@@ -317,6 +582,64 @@ void SceneLoader::_OnUpdate(const f32 i_deltaMs)
 		insigne::copy_update_ub(m_SceneUB, &m_SceneData, sizeof(SceneData), 0);
 	}
 
+	ImGui::Begin("Controller##SceneLoader");
+	ImGui::Text("Load time: %4.2f ms (%d loading tasks)", m_LoadMs, k_LoadTasksCount);
+	ImGui::Text("Nodes: %d, meshes: %d, materials: %d", m_ScenePackage.header->nodesCount,
+			m_ScenePackage.header->meshesCount, m_ScenePackage.header->materialsCount);
+	ImGui::SliderFloat("LOD error (pixels)", &m_LodPixelsError, 0.0f, 16.0f, "%.1f");
+	ImGui::Checkbox("Cluster culling", &m_ClusterCulling);
+	ImGui::Checkbox("Cluster backface culling", &m_BackfaceCulling);
+	ImGui::Text("Triangles: %d", m_DrawnTrianglesCount);
+	ImGui::Text("Clusters: %d, frustum culled: %d, backface culled: %d", m_CullingStats.clustersCount,
+			m_CullingStats.frustumCulledCount, m_CullingStats.backfaceCulledCount);
+	ImGui::End();
+
+	// lods by the projected size of their error, from the distance to the bounding sphere: both are in model units,
+	// so the camera is brought in model space
+	m_DrawnTrianglesCount = 0;
+	for (size i = 0; i < m_ModelDataArray.get_size(); i++)
+	{
+		ModelRegistry& registry = m_ModelDataArray[i];
+		const cbmodel::Model<geo3d::VertexPNTT>& model = registry.model;
+		const floral::vec3f center = (model.aabb.min_corner + model.aabb.max_corner) * 0.5f;
+		const f32 radius = floral::length(model.aabb.max_corner - center);
+		const floral::vec3f cameraPosition = floral::apply_point_transform(m_CameraPosition, registry.invWorldMatrix);
+		const f32 distance = floral::length(cameraPosition - center) - radius;
+		registry.lod = cbmodel::SelectLod(model.lods, model.lodsCount, distance, m_ProjectionScale, m_LodPixelsError);
+		registry.drawCulled = m_ClusterCulling && registry.lod == 0 && model.clustersCount > 0;
+		if (!registry.drawCulled)
+		{
+			m_DrawnTrianglesCount += model.lods[registry.lod].indicesCount / 3;
+		}
+	}
+
+	// lod 0 of the clustered models, the shadow pass still draws them whole; the clusters are in model space
+	const floral::mat4x4f viewProjection = m_projection * m_view;
+	m_CullingBufferIdx = (m_CullingBufferIdx + 1) % 2;
+	memset(&m_CullingStats, 0, sizeof(cluster_culling::CullingStats));
+	for (size i = 0; i < m_ModelDataArray.get_size(); i++)
+	{
+		ModelRegistry& registry = m_ModelDataArray[i];
+		if (!registry.drawCulled)
+		{
+			continue;
+		}
+
+		const cbmodel::Model<geo3d::VertexPNTT>& model = registry.model;
+		const cluster_culling::Frustum frustum = cluster_culling::ExtractFrustum(viewProjection * registry.worldMatrix);
+		const floral::vec3f cameraPosition = floral::apply_point_transform(m_CameraPosition, registry.invWorldMatrix);
+		const u32 rangesCount = cluster_culling::CullClusters(model.clusters, model.clustersCount, frustum, cameraPosition,
+				m_BackfaceCulling, m_CullingRanges, &m_CullingStats);
+		s32* culledIndices = registry.culledIndices[m_CullingBufferIdx];
+		registry.culledIndicesCount = cluster_culling::CompactIndices(model.indicesData + model.lods[0].firstIndex,
+				m_CullingRanges, rangesCount, culledIndices);
+		if (registry.culledIndicesCount > 0)
+		{
+			insigne::update_ib(registry.culledIB, culledIndices, registry.culledIndicesCount, 0);
+		}
+		m_DrawnTrianglesCount += registry.culledIndicesCount / 3;
+	}
+
 	debugdraw::DrawAABB3D(m_SceneAABB, floral::vec4f(0.0f, 1.0f, 0.0f, 1.0f));
 
 	// bottom
@@ -353,8 +676,9 @@ void SceneLoader::_OnRender(const f32 i_deltaMs)
 	insigne::begin_render_pass(m_ShadowMapFb);
 	for (size i = 0; i < m_ModelDataArray.get_size(); i++)
 	{
-		const ModelRegistry& model = m_ModelDataArray[i];
-		insigne::draw_surface<geo3d::SurfacePNTT>(model.modelGPU.vb, model.modelGPU.ib, m_ShadowMapMaterial.material);
+		const ModelRegistry& registry = m_ModelDataArray[i];
+		m_ShadowMapMaterial.material.uniform_blocks[m_ShadowInstanceSlot].value.offset = registry.instanceOffset;
+		DrawModel(registry, registry.lodIBs[registry.lod], m_ShadowMapMaterial.material);
 	}
 	insigne::end_render_pass(m_ShadowMapFb);
 	insigne::dispatch_render_pass();
@@ -362,8 +686,17 @@ void SceneLoader::_OnRender(const f32 i_deltaMs)
 	m_PostFXChain.BeginMainOutput();
 	for (size i = 0; i < m_ModelDataArray.get_size(); i++)
 	{
-		const ModelRegistry& model = m_ModelDataArray[i];
-		insigne::draw_surface<geo3d::SurfacePNTT>(model.modelGPU.vb, model.modelGPU.ib, model.msPair.material);
+		ModelRegistry& registry = m_ModelDataArray[i];
+		// the materials are shared by the registries, theirs is only picked at draw time
+		registry.msPair.material.uniform_blocks[registry.instanceSlot].value.offset = registry.instanceOffset;
+		if (!registry.drawCulled)
+		{
+			DrawModel(registry, registry.lodIBs[registry.lod], registry.msPair.material);
+		}
+		else if (registry.culledIndicesCount > 0)
+		{
+			DrawModel(registry, registry.culledIB, registry.msPair.material);
+		}
 	}
 	debugdraw::Render(m_SceneData.viewProjectionMatrix);
 	m_PostFXChain.EndMainOutput();
@@ -386,8 +719,20 @@ void SceneLoader::_OnCleanUp()
 	CLOVER_VERBOSE("Cleaning up '%s' TestSuite", k_name);
 
 	insigne::unregister_surface_type<geo2d::SurfacePT>();
+	insigne::unregister_surface_type<geo3d::SurfacePNTTQ8>();
+	insigne::unregister_surface_type<geo3d::SurfacePNTTQ16>();
 	insigne::unregister_surface_type<geo3d::SurfacePNTT>();
 
+	cbscene::CloseScenePackage(&m_ScenePackage);
+
+	g_StreammingAllocator.free(m_CullingArena);
+	for (s32 i = k_LoadTasksCount - 1; i >= 0; i--)
+	{
+		if (m_MeshDataArenas[i])
+		{
+			g_StreammingAllocator.free(m_MeshDataArenas[i]);
+		}
+	}
 	g_StreammingAllocator.free(m_PostFXArena);
 	g_StreammingAllocator.free(m_MaterialDataArena);
 	g_StreammingAllocator.free(m_SceneDataArena);
@@ -398,32 +743,151 @@ void SceneLoader::_OnCleanUp()
 
 //-------------------------------------------------------------------
 
-mat_loader::MaterialShaderPair SceneLoader::_LoadMaterial(const_cstr i_path)
+mat_loader::MaterialShaderPair SceneLoader::_CreateMaterial(const mat_parser::MaterialDescription& i_matDesc)
+{
+	m_MemoryArena->free_all();
+
+	mat_loader::MaterialShaderPair msPair;
+	bool matLoadResult = mat_loader::CreateMaterial(&msPair, m_FileSystem, i_matDesc, m_MemoryArena, m_MaterialDataArena, &m_ShaderCache);
+	FLORAL_ASSERT(matLoadResult == true);
+	insigne::helpers::assign_uniform_block(msPair.material, "ub_Scene", 0, 0, m_SceneUB);
+	insigne::helpers::assign_uniform_block(msPair.material, "ub_Lighting", 0, 0, m_LightingUB);
+	insigne::helpers::assign_uniform_block(msPair.material, "ub_Instance", 0, k_InstanceDataStride, m_InstanceUB);
+	insigne::helpers::assign_texture(msPair.material, "u_SplitSumTex", m_SplitSumTexture);
+	insigne::helpers::assign_texture(msPair.material, "u_ShadowMap", insigne::extract_depth_stencil_attachment(m_ShadowMapFb));
+
+	return msPair;
+}
+
+//-------------------------------------------------------------------
+
+template <class TVertex>
+void SceneLoader::LoadMesh(LoadTaskData* io_task, const u32 i_meshIdx)
 {
-	floral::crc_string key(i_path);
-	for (size i = 0; i < m_MaterialArray.get_size(); i++)
+	// the uncompressed vertices are used in place, bounding them reads their pages in; the others are decoded
+	cbmodel::Model<TVertex> mesh;
+	if (CanUseMeshInPlace(cbscene::GetPackageMeshHeader(*io_task->package, i_meshIdx)))
 	{
-		if (m_MaterialArray[i].key == key)
+		mesh = cbscene::GetPackageMesh<TVertex>(*io_task->package, i_meshIdx, k_MeshAttributes);
+	}
+	else
+	{
+		mesh = cbscene::LoadPackageMesh<TVertex>(*io_task->package, i_meshIdx, k_MeshAttributes,
+				io_task->meshScratchArena, io_task->meshDataArena);
+		if (io_task->meshScratchArena)
 		{
-			return m_MaterialArray[i].msPair;
+			io_task->meshScratchArena->free_all();
 		}
 	}
 
-	m_MemoryArena->free_all();
+	MeshData& meshData = io_task->meshes[i_meshIdx];
+	meshData.vertices = mesh.verticesData;
+	meshData.vertexStride = sizeof(TVertex);
+
+	cbmodel::Model<geo3d::VertexPNTT>& model = meshData.model;
+	model.indicesCount = mesh.indicesCount;
+	model.verticesCount = mesh.verticesCount;
+	model.indicesData = mesh.indicesData;
+	model.verticesData = nullptr;
+	model.materialName = mesh.materialName;
+	model.aabb = mesh.aabb;
+	model.vertexFormat = mesh.vertexFormat;
+	model.quantization = mesh.quantization;
+	model.lodsCount = mesh.lodsCount;
+	memcpy(model.lods, mesh.lods, sizeof(model.lods));
+	model.clustersCount = mesh.clustersCount;
+	model.clusters = mesh.clusters;
+}
 
-	MaterialKeyPair materialKeyPair;
-	materialKeyPair.key = key;
-	floral::relative_path matPath = floral::build_relative_path(i_path);
-	mat_parser::MaterialDescription matDesc = mat_parser::ParseMaterial(m_FileSystem, matPath, m_MemoryArena);
-	bool matLoadResult = mat_loader::CreateMaterial(&materialKeyPair.msPair, m_FileSystem, matDesc, m_MemoryArena, m_MaterialDataArena);
-	FLORAL_ASSERT(matLoadResult == true);
-	insigne::helpers::assign_uniform_block(materialKeyPair.msPair.material, "ub_Scene", 0, 0, m_SceneUB);
-	insigne::helpers::assign_uniform_block(materialKeyPair.msPair.material, "ub_Lighting", 0, 0, m_LightingUB);
-	insigne::helpers::assign_texture(materialKeyPair.msPair.material, "u_SplitSumTex", m_SplitSumTexture);
-	insigne::helpers::assign_texture(materialKeyPair.msPair.material, "u_ShadowMap", insigne::extract_depth_stencil_attachment(m_ShadowMapFb));
-	m_MaterialArray.push_back(materialKeyPair);
+//-------------------------------------------------------------------
+
+refrain2::Task SceneLoader::LoadSceneRange(voidptr i_data)
+{
+	LoadTaskData* task = (LoadTaskData*)i_data;
 
-	return m_MaterialArray[m_MaterialArray.get_size() - 1].msPair;
+	for (u32 i = task->meshesBegin; i < task->meshesEnd; i++)
+	{
+		switch (GetDrawnVertexFormat(cbscene::GetPackageMeshHeader(*task->package, i)))
+		{
+		case cbmodel::VertexFormat::Quantized16:
+			LoadMesh<geo3d::VertexPNTTQ16>(task, i);
+			break;
+		case cbmodel::VertexFormat::Quantized8:
+			LoadMesh<geo3d::VertexPNTTQ8>(task, i);
+			break;
+		default:
+			LoadMesh<geo3d::VertexPNTT>(task, i);
+			break;
+		}
+	}
+
+	// the file system of the suite is not shared with the workers, the materials are opened by their absolute path;
+	// the ones compiled by materialbaker are read and have their pointers fixed up, the others are parsed
+	for (u32 i = task->materialsBegin; i < task->materialsEnd; i++)
+	{
+		const_cstr materialName = cbscene::GetMaterialName(*task->package, i);
+		c8 materialPath[1024];
+		snprintf(materialPath, sizeof(materialPath), "%s/materials/%s.cbmat", task->sceneDir, materialName);
+		task->materialDescs[i] = mat_parser::LoadMaterial(floral::path(materialPath), task->arena);
+		if (task->materialDescs[i].vertexShaderPath == nullptr)
+		{
+			snprintf(materialPath, sizeof(materialPath), "%s/materials/%s.mat", task->sceneDir, materialName);
+			task->materialDescs[i] = mat_parser::LoadMaterial(floral::path(materialPath), task->arena);
+		}
+	}
+
+	return refrain2::Task();
+}
+
+//-------------------------------------------------------------------
+
+const cbmodel::VertexFormat SceneLoader::GetDrawnVertexFormat(const cbmodel::ModelFileHeader* i_header)
+{
+	if (i_header->vertexLayout.attributes != (u32)k_MeshAttributes)
+	{
+		return cbmodel::VertexFormat::Float;
+	}
+
+	switch (i_header->vertexFormat)
+	{
+	case cbmodel::VertexFormat::Quantized16:
+		return i_header->vertexLayout.stride == sizeof(geo3d::VertexPNTTQ16) ? cbmodel::VertexFormat::Quantized16 : cbmodel::VertexFormat::Float;
+	case cbmodel::VertexFormat::Quantized8:
+		return i_header->vertexLayout.stride == sizeof(geo3d::VertexPNTTQ8) ? cbmodel::VertexFormat::Quantized8 : cbmodel::VertexFormat::Float;
+	default:
+		return cbmodel::VertexFormat::Float;
+	}
+}
+
+//-------------------------------------------------------------------
+
+const bool SceneLoader::CanUseMeshInPlace(const cbmodel::ModelFileHeader* i_header)
+{
+	if (i_header->compression != cbmodel::Compression::None || GetDrawnVertexFormat(i_header) != i_header->vertexFormat)
+	{
+		return false;
+	}
+	// the f32 meshes of another layout are drawn as f32 PNTT too
+	return i_header->vertexFormat != cbmodel::VertexFormat::Float
+		|| (i_header->vertexLayout.attributes == (u32)k_MeshAttributes && i_header->vertexLayout.stride == sizeof(geo3d::VertexPNTT));
+}
+
+//-------------------------------------------------------------------
+
+void SceneLoader::DrawModel(const ModelRegistry& i_registry, const insigne::ib_handle_t i_ib, const insigne::material_desc_t& i_material)
+{
+	switch (i_registry.model.vertexFormat)
+	{
+	case cbmodel::VertexFormat::Quantized16:
+		insigne::draw_surface<geo3d::SurfacePNTTQ16>(i_registry.modelGPU.vb, i_ib, i_material);
+		break;
+	case cbmodel::VertexFormat::Quantized8:
+		insigne::draw_surface<geo3d::SurfacePNTTQ8>(i_registry.modelGPU.vb, i_ib, i_material);
+		break;
+	default:
+		insigne::draw_surface<geo3d::SurfacePNTT>(i_registry.modelGPU.vb, i_ib, i_material);
+		break;
+	}
 }
 
 //-------------------------------------------------------------------
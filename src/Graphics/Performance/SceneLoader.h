@@ -3,14 +3,21 @@
 #include <floral/stdaliases.h>
 #include <floral/containers/fast_array.h>
 
+#include <refrain2.h>
+
+#include <atomic>
+
 #include <insigne/commons.h>
 
 #include "Graphics/TestSuite.h"
 #include "Graphics/CbModelLoader.h"
+#include "Graphics/CbScenePackage.h"
 #include "Graphics/SurfaceDefinitions.h"
 #include "Graphics/MaterialLoader.h"
+#include "Graphics/MaterialBinary.h"
 #include "Graphics/InsigneHelpers.h"
 #include "Graphics/PostFXChain.h"
+#include "Graphics/ClusterCulling.h"
 
 #include "Memory/MemorySystem.h"
 
@@ -33,7 +40,7 @@ public:
 	const_cstr									GetName() const override;
 
 private:
-	mat_loader::MaterialShaderPair				_LoadMaterial(const_cstr i_path);
+	mat_loader::MaterialShaderPair				_CreateMaterial(const mat_parser::MaterialDescription& i_matDesc);
 
 private:
 	void										_OnInitialize() override;
@@ -44,17 +51,64 @@ private:
 private:
 	struct ModelRegistry
 	{
-		cbmodel::Model<geo3d::VertexPNTT>		model;
+		cbmodel::Model<geo3d::VertexPNTT>		model;					// no verticesData, model.vertexFormat is the one of modelGPU
 		mat_loader::MaterialShaderPair			msPair;
-		helpers::SurfaceGPU						modelGPU;
+		helpers::SurfaceGPU						modelGPU;				// ib is lod 0
+		insigne::ib_handle_t					lodIBs[cbmodel::k_MaxLodsCount];
+		floral::mat4x4f							worldMatrix;			// of its node, the registries of a mesh share modelGPU
+		floral::mat4x4f							invWorldMatrix;			// the camera and the frustum in model space, for the lods and the culling
+		s32										instanceSlot;			// of ub_Instance in msPair.material
+		size									instanceOffset;			// of its InstanceData in m_InstanceUB
+		u32										lod;					// drawn this frame
+
+		// lod 0 of the clustered models, down to its visible clusters every frame
+		insigne::ib_handle_t					culledIB;
+		s32*									culledIndices[2];		// double buffered, the render thread reads the previous one
+		u32										culledIndicesCount;
+		bool									drawCulled;
 	};
 
-	struct MaterialKeyPair
+	/*
+	 * A package mesh as the tasks load it: the quantized PNTT meshes stay quantized and are decoded by the
+	 * vertex shader, the others are f32 PNTT.
+	 */
+	struct MeshData
 	{
-		floral::crc_string						key;
-		mat_loader::MaterialShaderPair			msPair;
+		cbmodel::Model<geo3d::VertexPNTT>		model;					// without verticesData
+		voidptr									vertices;				// of model.vertexFormat
+		size									vertexStride;
+	};
+
+	/*
+	 * Scene loading is staged: the refrain2 tasks fault in and bound a range of the package's meshes and
+	 * parse a range of its materials into their own arena, the main thread creates the gpu resources of
+	 * every task as soon as it is done.
+	 */
+	struct LoadTaskData
+	{
+		const cbscene::ScenePackage*			package;
+		const_cstr								sceneDir;				// absolute, the materials are under it
+		LinearArena*							arena;
+		LinearArena*							meshScratchArena;		// the io of the converted meshes, nullptr when there is none
+		LinearArena*							meshDataArena;			// the converted meshes, nullptr when there is none
+		u32										meshesBegin, meshesEnd;
+		u32										materialsBegin, materialsEnd;
+		MeshData*								meshes;					// by package mesh
+		mat_parser::MaterialDescription*		materialDescs;			// by package material
+		bool									consumed;
+		std::atomic<u32>						counter;
 	};
 
+	static const u32							k_LoadTasksCount = 8;
+	static refrain2::Task						LoadSceneRange(voidptr i_data);
+	template <class TVertex>
+	static void									LoadMesh(LoadTaskData* io_task, const u32 i_meshIdx);
+
+	// PNTT meshes keep their vertex format (f32 or quantized), the rest (another layout) is decoded to f32 PNTT
+	static const cbmodel::VertexFormat			GetDrawnVertexFormat(const cbmodel::ModelFileHeader* i_header);
+	// the uncompressed meshes that keep their vertex format
+	static const bool							CanUseMeshInPlace(const cbmodel::ModelFileHeader* i_header);
+
 	struct SceneData
 	{
 		floral::mat4x4f							viewProjectionMatrix;
@@ -74,18 +128,46 @@ private:
 		floral::vec4f							lightIntensity;
 	};
 
+	// ub_Instance, the quantization is the identity for the f32 meshes, see cbmodel::Quantization
+	struct InstanceData
+	{
+		floral::mat4x4f							worldMatrix;
+		floral::mat4x4f							invWorldMatrix;			// n * mat3(invWorldMatrix) is the inverse transpose for the normals
+		floral::vec4f							positionOffset;			// w is 1 when the normals and tangents are octahedral
+		floral::vec4f							positionScale;
+		floral::vec4f							texcoordOffsetScale;	// xy offset, zw scale
+	};
+
+	// the uniform buffer offset alignment
+	static const size							k_InstanceDataStride = 256;
+
+	static void									DrawModel(const ModelRegistry& i_registry, const insigne::ib_handle_t i_ib,
+													const insigne::material_desc_t& i_material);
+
 private:
 	using ModelDataArray = floral::fast_fixed_array<ModelRegistry, LinearArena>;
-	using MaterialArray = floral::fast_fixed_array<MaterialKeyPair, LinearArena>;
 	ModelDataArray								m_ModelDataArray;
-	MaterialArray								m_MaterialArray;
+	cbscene::ScenePackage						m_ScenePackage;			// the models point into it
 	floral::aabb3f								m_SceneAABB;
+	f32											m_LoadMs;
+
+	floral::vec3f								m_CameraPosition;
+	f32											m_ProjectionScale;		// viewport height / (2 * tan(fovy / 2))
+	f32											m_LodPixelsError;
+	u32											m_DrawnTrianglesCount;
+
+	bool										m_ClusterCulling;
+	bool										m_BackfaceCulling;
+	u32											m_CullingBufferIdx;
+	cluster_culling::IndexRange*				m_CullingRanges;		// of the model being culled
+	cluster_culling::CullingStats				m_CullingStats;
 
 	floral::mat4x4f								m_projection, m_view;
 	SceneData									m_SceneData;
 	LightingData								m_LightingData;
 	insigne::ub_handle_t						m_SceneUB;
 	insigne::ub_handle_t						m_LightingUB;
+	insigne::ub_handle_t						m_InstanceUB;			// an InstanceData every k_InstanceDataStride bytes, by registry
 	insigne::texture_handle_t					m_SplitSumTexture;
 
 	floral::vec3f								m_ShadowSceneAABB[8];
@@ -93,7 +175,9 @@ private:
 	ShadowSceneData								m_ShadowSceneData;
 	insigne::ub_handle_t						m_ShadowSceneUB;
 	mat_loader::MaterialShaderPair				m_ShadowMapMaterial;
+	s32											m_ShadowInstanceSlot;
 	insigne::framebuffer_handle_t				m_ShadowMapFb;
+	mat_loader::ShaderCache						m_ShaderCache;
 
 	pfx_chain::PostFXChain<LinearArena, FreelistArena>	m_PostFXChain;
 	u64											m_frameIndex;
@@ -103,6 +187,8 @@ private:
 	LinearArena*								m_SceneDataArena;
 	LinearArena*								m_MaterialDataArena;
 	LinearArena*								m_PostFXArena;
+	LinearArena*								m_CullingArena;
+	LinearArena*								m_MeshDataArenas[k_LoadTasksCount];
 };
 
 // ------------------------------------------------------------------
@@ -1,7 +1,13 @@
 #include "TextureStreaming.h"
 
+#include <math.h>
+#include <stdio.h>
+
+#include <chrono>
+
+#include <calyx/context.h>
+
 #include <floral/containers/array.h>
-#include <floral/assert/assert.h>
 
 #include <clover/Logger.h>
 
@@ -13,134 +19,233 @@
 
 #include "InsigneImGui.h"
 #include "Graphics/SurfaceDefinitions.h"
+#include "Graphics/MaterialParser.h"
 
 namespace stone
 {
 namespace perf
 {
+//-------------------------------------------------------------------
+
+// v2 cbtex files in the suite's directory
+static const_cstr k_TextureNames[] = {
+	"ldrtex2d_albedo_dxt_rgb.cbtex",
+	"ldrtex2d_normal_dxt_rgb.cbtex",
+	"ldrtex2d_uvchecker_dxt_rgb.cbtex",
+	"ldrtex2d_uvchecker_nc_srgb.cbtex"
+};
 
-static const_cstr k_SuiteName = "texture streaming";
+// mapped as a whole, it is also streamed as the first texture
+static const_cstr k_MappedTextureName = "ldrtex2d_albedo_dxt_rgb.cbtex";
+
+// half height of the quads, in ndc
+static const f32 k_QuadSizes[] = { 0.45f, 0.225f, 0.1125f, 0.05625f };
+
+//-------------------------------------------------------------------
 
 TextureStreaming::TextureStreaming()
+	: m_RegisterMs(0.0f)
+	, m_BudgetMB(16)
+	, m_MipBias(0)
+	, m_MapMs(0.0f)
+	, m_ShowMapped(false)
 {
 }
 
+//-------------------------------------------------------------------
+
 TextureStreaming::~TextureStreaming()
 {
 }
 
+//-------------------------------------------------------------------
+
+ICameraMotion* TextureStreaming::GetCameraMotion()
+{
+	return nullptr;
+}
+
+//-------------------------------------------------------------------
+
 const_cstr TextureStreaming::GetName() const
 {
-	return k_SuiteName;
+	return k_name;
 }
 
-void TextureStreaming::OnInitialize(floral::filesystem<FreelistArena>* i_fs)
+//-------------------------------------------------------------------
+
+void TextureStreaming::_OnInitialize()
 {
-	CLOVER_VERBOSE("Initializing '%s' TestSuite", k_SuiteName);
-	// snapshot begin state
-	m_BuffersBeginStateId = insigne::get_buffers_resource_state();
-	m_ShadingBeginStateId = insigne::get_shading_resource_state();
-	m_TextureBeginStateId = insigne::get_textures_resource_state();
-	m_RenderBeginStateId = insigne::get_render_resource_state();
-	// register surfaces
-	insigne::register_surface_type<SurfacePT>();
+	CLOVER_VERBOSE("Initializing '%s' TestSuite", k_name);
+	floral::relative_path wdir = floral::build_relative_path("tests/perf/texture_streaming");
+	floral::push_directory(m_FileSystem, wdir);
+
 	m_MemoryArena = g_StreammingAllocator.allocate_arena<FreelistArena>(SIZE_MB(1));
+	m_StreamingArena = g_StreammingAllocator.allocate_arena<FreelistArena>(SIZE_MB(32));
 	m_MaterialDataArena = g_StreammingAllocator.allocate_arena<LinearArena>(SIZE_KB(256));
-	m_TextureDataArena = g_StreammingAllocator.allocate_arena<LinearArena>(SIZE_MB(2));
-
-	const f32 aspectRatio = 16.0f / 9.0f;
-	const f32 w = 0.5;
-	const f32 h = w * aspectRatio;
-	floral::inplace_array<VertexPT, 4> vertices;
-	vertices.push_back(VertexPT { { -w, -h }, { 0.0f, 0.0f } });
-	vertices.push_back(VertexPT { { w, -h }, { 1.0f, 0.0f } });
-	vertices.push_back(VertexPT { { w, h }, { 1.0f, 1.0f } });
-	vertices.push_back(VertexPT { { -w, h }, { 0.0f, 1.0f } });
-
-	floral::inplace_array<s32, 6> indices;
-	indices.push_back(0);
-	indices.push_back(1);
-	indices.push_back(2);
-
-	indices.push_back(2);
-	indices.push_back(3);
-	indices.push_back(0);
 
+	calyx::context_attribs* commonCtx = calyx::get_context_attribs();
+	const f32 aspectRatio = (f32)commonCtx->window_height / (f32)commonCtx->window_width;
+
+	// register surfaces
+	insigne::register_surface_type<geo2d::SurfacePT>();
+
+	// quads of decreasing size from left to right, each one needs less mips than the previous one
+	f32 left = -0.95f;
+	for (u32 i = 0; i < k_QuadsCount; i++)
 	{
-		insigne::vbdesc_t desc;
-		desc.region_size = SIZE_KB(2);
-		desc.stride = sizeof(VertexPT);
-		desc.data = nullptr;
-		desc.count = 0;
-		desc.usage = insigne::buffer_usage_e::static_draw;
-		
-		m_VB = insigne::create_vb(desc);
-		insigne::copy_update_vb(m_VB, &vertices[0], vertices.get_size(), sizeof(VertexPT), 0);
+		const f32 h = k_QuadSizes[i];
+		const f32 w = h * aspectRatio;
+		floral::inplace_array<geo2d::VertexPT, 4> vertices;
+		vertices.push_back({ { left, h }, { 0.0f, 1.0f } });
+		vertices.push_back({ { left, -h }, { 0.0f, 0.0f } });
+		vertices.push_back({ { left + 2.0f * w, -h }, { 1.0f, 0.0f } });
+		vertices.push_back({ { left + 2.0f * w, h }, { 1.0f, 1.0f } });
+		left += 2.0f * w + 0.05f;
+
+		floral::inplace_array<s32, 6> indices;
+		indices.push_back(0);
+		indices.push_back(1);
+		indices.push_back(2);
+		indices.push_back(2);
+		indices.push_back(3);
+		indices.push_back(0);
+
+		m_Quads[i] = helpers::CreateSurfaceGPU(&vertices[0], 4, sizeof(geo2d::VertexPT),
+				&indices[0], 6, insigne::buffer_usage_e::static_draw, true);
+		m_QuadPixels[i] = h * (f32)commonCtx->window_height;
 	}
 
+	m_MemoryArena->free_all();
+	floral::relative_path matPath = floral::build_relative_path("streamed_quad.mat");
+	mat_parser::MaterialDescription matDesc = mat_parser::ParseMaterial(m_FileSystem, matPath, m_MemoryArena);
+	for (u32 i = 0; i < k_QuadsCount; i++)
 	{
-		insigne::ibdesc_t desc;
-		desc.region_size = SIZE_KB(1);
-		desc.data = nullptr;
-		desc.count = 0;
-		desc.usage = insigne::buffer_usage_e::static_draw;
-
-		m_IB = insigne::create_ib(desc);
-		insigne::copy_update_ib(m_IB, &indices[0], indices.get_size(), 0);
+		const bool createResult = mat_loader::CreateMaterial(&m_MSPair[i], m_FileSystem, matDesc, m_MemoryArena, m_MaterialDataArena);
+		FLORAL_ASSERT(createResult == true);
 	}
 
-	{
-		m_TexData = m_TextureDataArena->allocate_array<floral::vec3f>(128 * 128);
+	tex_loader::InitializeTextureStreamer(&m_Streamer, m_StreamingArena, k_QuadsCount, SIZE_MB(m_BudgetMB));
 
-		for (size i = 0; i < 128; i++)
-		{
-			m_TexData[i] = floral::vec3f(1.0f, 0.0, 0.0);
-		}
+	// the streamer and MapCBTexture open the files by their paths, m_FileSystem is rooted at the application
+	// directory and wdir is its working directory
+	floral::absolute_path textureDir = floral::get_application_directory();
+	floral::concat_path(&textureDir, wdir);
+	c8 textureDirStr[1024];
+	floral::get_as_cstr(textureDirStr, textureDir);
 
+	// only the mip tails are read here
+	using namespace std::chrono;
+	high_resolution_clock::time_point start = high_resolution_clock::now();
+	for (u32 i = 0; i < k_QuadsCount; i++)
+	{
 		insigne::texture_desc_t texDesc;
-		texDesc.width = 128;
-		texDesc.height = 128;
-		texDesc.format = insigne::texture_format_e::hdr_rgb;
-		texDesc.min_filter = insigne::filtering_e::nearest;
-		texDesc.mag_filter = insigne::filtering_e::nearest;
-		texDesc.dimension = insigne::texture_dimension_e::tex_2d;
-		texDesc.has_mipmap = false;
-		texDesc.data = nullptr;
-
-		m_Texture = insigne::create_texture(texDesc);
-
-		const size dataSize = insigne::prepare_texture_desc(texDesc);
-		insigne::copy_update_texture(m_Texture, m_TexData, dataSize);
+		texDesc.min_filter = insigne::filtering_e::linear_mipmap_linear;
+		texDesc.mag_filter = insigne::filtering_e::linear;
+		texDesc.wrap_s = insigne::wrap_e::clamp_to_edge;
+		texDesc.wrap_t = insigne::wrap_e::clamp_to_edge;
+		c8 texturePath[1024];
+		snprintf(texturePath, sizeof(texturePath), "%s/%s", textureDirStr, k_TextureNames[i]);
+		m_Textures[i] = tex_loader::RegisterStreamedTexture(&m_Streamer, floral::path(texturePath), texDesc);
+		if (m_Textures[i] < 0)
+		{
+			// the quad is not drawn
+			CLOVER_ERROR("Cannot register the streamed texture '%s'", texturePath);
+			continue;
+		}
+		insigne::helpers::assign_texture(m_MSPair[i].material, "u_MainTex", tex_loader::GetStreamedTexture(m_Streamer, m_Textures[i]));
 	}
+	high_resolution_clock::time_point end = high_resolution_clock::now();
+	duration<f64, std::milli> registerDuration = end - start;
+	m_RegisterMs = (f32)registerDuration.count();
+
+	// the whole first texture, mapped and handed to insigne without a copy
+	c8 mappedPath[1024];
+	snprintf(mappedPath, sizeof(mappedPath), "%s/%s", textureDirStr, k_MappedTextureName);
+
+	start = high_resolution_clock::now();
+	insigne::texture_desc_t mappedDesc;
+	mappedDesc.min_filter = insigne::filtering_e::linear_mipmap_linear;
+	mappedDesc.mag_filter = insigne::filtering_e::linear;
+	mappedDesc.wrap_s = insigne::wrap_e::clamp_to_edge;
+	mappedDesc.wrap_t = insigne::wrap_e::clamp_to_edge;
+	m_MappedTexture = tex_loader::MapCBTexture(floral::path(mappedPath), mappedDesc, &m_Mapping, true);
+	end = high_resolution_clock::now();
+	duration<f64, std::milli> mapDuration = end - start;
+	m_MapMs = (f32)mapDuration.count();
+	insigne::dispatch_render_pass();
+}
 
-	mat_parser::MaterialDescription matDesc = mat_parser::ParseMaterial(
-			floral::path("gfx/mat/texture_streaming.mat"), m_MemoryArena);
-	const bool result = mat_loader::CreateMaterial(&m_MSPair, matDesc, m_MaterialDataArena);
+//-------------------------------------------------------------------
 
-	insigne::helpers::assign_texture(m_MSPair.material, "u_Tex", m_Texture);
+void TextureStreaming::_OnUpdate(const f32 i_deltaMs)
+{
+	// the mip that gives about one texel per pixel
+	for (u32 i = 0; i < k_QuadsCount; i++)
+	{
+		if (m_Textures[i] < 0)
+		{
+			continue;
+		}
+		const f32 resolution = (f32)m_Streamer.textures[m_Textures[i]].header.resolution;
+		const s32 mip = (s32)floorf(log2f(resolution / m_QuadPixels[i])) + m_MipBias;
+		tex_loader::RequestStreamedMip(&m_Streamer, m_Textures[i], (u32)floral::max(mip, 0));
+	}
+	tex_loader::UpdateTextureStreamer(&m_Streamer);
 
-	FLORAL_ASSERT(result == true);
-}
+	// insigne has read the mapped payload once it got uploaded, the file is not needed anymore
+	if (m_Mapping.mappedData && tex_loader::IsCBTextureUploaded(m_Mapping))
+	{
+		tex_loader::UnmapCBTexture(&m_Mapping);
+	}
 
-void TextureStreaming::OnUpdate(const f32 i_deltaMs)
-{
-	static size frameIdx = 0;
-	frameIdx++;
-	if (frameIdx % 30 == 0)
+	ImGui::Begin("Controller##TextureStreaming");
+	if (ImGui::SliderInt("Budget (MB)", &m_BudgetMB, 0, 32))
+	{
+		tex_loader::SetTextureStreamerBudget(&m_Streamer, SIZE_MB(m_BudgetMB));
+	}
+	ImGui::SliderInt("Mip bias", &m_MipBias, -2, 8);
+	if (m_Textures[0] >= 0 && ImGui::Checkbox("Texture 0: mapped with all mips", &m_ShowMapped))
 	{
-		for (size i = 0; i < 128; i++)
+		insigne::helpers::assign_texture(m_MSPair[0].material, "u_MainTex",
+				m_ShowMapped ? m_MappedTexture : tex_loader::GetStreamedTexture(m_Streamer, m_Textures[0]));
+	}
+
+	const tex_loader::TextureStreamerStats stats = tex_loader::GetTextureStreamerStats(m_Streamer);
+	ImGui::Text("Register (mip tails): %4.2f ms", m_RegisterMs);
+	ImGui::Text("Map (all mips): %4.2f ms, %s", m_MapMs, m_Mapping.mappedData ? "waiting for the upload" : "unmapped");
+	ImGui::Text("Mip tails: %4.2f KB", (f32)stats.tailsSize / 1024.0f);
+	ImGui::Text("Streamed: %4.2f / %4.2f MB", (f32)stats.residentSize / (1024.0f * 1024.0f), (f32)stats.budget / (1024.0f * 1024.0f));
+	ImGui::Text("Requests in flight: %d", stats.requestsInFlight);
+	ImGui::Text("Textures below their request: %d", stats.texturesBelowRequest);
+	ImGui::Text("Textures failed to stream: %d", stats.texturesFailed);
+	for (u32 i = 0; i < k_QuadsCount; i++)
+	{
+		if (m_Textures[i] < 0)
 		{
-			m_TexData[i + 128 * (frameIdx / 30)] = floral::vec3f(1.0f, 0.0, 0.0);
+			ImGui::Text("Texture %d: not registered", i);
+			continue;
 		}
-		insigne::copy_update_texture(m_Texture, m_TexData, 128 * 128 * sizeof(floral::vec3f));
+		const tex_loader::StreamedTexture& texture = m_Streamer.textures[m_Textures[i]];
+		ImGui::Text("Texture %d: resident mip %d, requested mip %d", i, texture.residentMip, texture.requestedMip);
 	}
+	ImGui::End();
 }
 
-void TextureStreaming::OnRender(const f32 i_deltaMs)
+//-------------------------------------------------------------------
+
+void TextureStreaming::_OnRender(const f32 i_deltaMs)
 {
 	insigne::begin_render_pass(DEFAULT_FRAMEBUFFER_HANDLE);
 
-	insigne::draw_surface<SurfacePT>(m_VB, m_IB, m_MSPair.material);
+	for (u32 i = 0; i < k_QuadsCount; i++)
+	{
+		if (m_Textures[i] < 0)
+		{
+			continue;
+		}
+		insigne::draw_surface<geo2d::SurfacePT>(m_Quads[i].vb, m_Quads[i].ib, m_MSPair[i].material);
+	}
 
 	RenderImGui();
 
@@ -149,21 +254,28 @@ void TextureStreaming::OnRender(const f32 i_deltaMs)
 	insigne::dispatch_render_pass();
 }
 
-void TextureStreaming::OnCleanUp()
+//-------------------------------------------------------------------
+
+void TextureStreaming::_OnCleanUp()
 {
-	CLOVER_VERBOSE("Cleaning up '%s' TestSuite", k_SuiteName);
+	CLOVER_VERBOSE("Cleaning up '%s' TestSuite", k_name);
+	tex_loader::CleanUpTextureStreamer(&m_Streamer);
+	if (m_Mapping.mappedData)
+	{
+		// the upload may still be queued, let insigne consume it before the pages go away
+		insigne::dispatch_render_pass();
+		insigne::wait_finish_dispatching();
+		tex_loader::UnmapCBTexture(&m_Mapping);
+	}
+	insigne::unregister_surface_type<geo2d::SurfacePT>();
+
 	g_StreammingAllocator.free(m_MaterialDataArena);
+	g_StreammingAllocator.free(m_StreamingArena);
 	g_StreammingAllocator.free(m_MemoryArena);
-	insigne::unregister_surface_type<SurfacePT>();
-
-	insigne::cleanup_render_resource(m_RenderBeginStateId);
-	insigne::cleanup_textures_resource(m_TextureBeginStateId);
-	insigne::cleanup_shading_resource(m_ShadingBeginStateId);
-	insigne::cleanup_buffers_resource(m_BuffersBeginStateId);
 
-	insigne::dispatch_render_pass();
-	insigne::wait_finish_dispatching();
+	floral::pop_directory(m_FileSystem);
 }
 
+//-------------------------------------------------------------------
 }
 }
@@ -4,8 +4,10 @@
 
 #include <insigne/commons.h>
 
-#include "Graphics/Tests/ITestSuite.h"
+#include "Graphics/TestSuite.h"
+#include "Graphics/InsigneHelpers.h"
 #include "Graphics/MaterialLoader.h"
+#include "Graphics/TextureStreamer.h"
 
 #include "Memory/MemorySystem.h"
 
@@ -13,41 +15,50 @@ namespace stone
 {
 namespace perf
 {
+// ------------------------------------------------------------------
 
-class TextureStreaming : public ITestSuite
+class TextureStreaming : public TestSuite
 {
+public:
+	static constexpr const_cstr k_name			= "texture streaming";
+	static const u32							k_QuadsCount = 4;
+
 public:
 	TextureStreaming();
 	~TextureStreaming();
 
+	ICameraMotion*								GetCameraMotion() override;
 	const_cstr									GetName() const override;
 
-	void										OnInitialize(floral::filesystem<FreelistArena>* i_fs) override;
-	void										OnUpdate(const f32 i_deltaMs) override;
-	void										OnRender(const f32 i_deltaMs) override;
-	void										OnCleanUp() override;
-
-	ICameraMotion*								GetCameraMotion() override { return nullptr; }
+private:
+	void										_OnInitialize() override;
+	void										_OnUpdate(const f32 i_deltaMs) override;
+	void										_OnRender(const f32 i_deltaMs) override;
+	void										_OnCleanUp() override;
 
 private:
-	insigne::vb_handle_t						m_VB;
-	insigne::ib_handle_t						m_IB;
-	insigne::texture_handle_t					m_Texture;
-	mat_loader::MaterialShaderPair				m_MSPair;
+	helpers::SurfaceGPU							m_Quads[k_QuadsCount];
+	f32											m_QuadPixels[k_QuadsCount];			// height on screen
+	mat_loader::MaterialShaderPair				m_MSPair[k_QuadsCount];
+
+	tex_loader::TextureStreamer					m_Streamer;
+	tex_loader::streamed_texture_handle_t		m_Textures[k_QuadsCount];
+	f32											m_RegisterMs;
+	s32											m_BudgetMB;
+	s32											m_MipBias;
 
-	floral::vec3f*								m_TexData;
+	// the first texture mapped with all its mips, drawn on the first quad instead of the streamed one
+	tex_loader::MappedCBTexture					m_Mapping;
+	insigne::texture_handle_t					m_MappedTexture;
+	f32											m_MapMs;
+	bool										m_ShowMapped;
 
 private:
 	FreelistArena*								m_MemoryArena;
+	FreelistArena*								m_StreamingArena;
 	LinearArena*								m_MaterialDataArena;
-	LinearArena*								m_TextureDataArena;
-	
-private:
-	ssize										m_BuffersBeginStateId;
-	ssize										m_ShadingBeginStateId;
-	ssize										m_TextureBeginStateId;
-	ssize										m_RenderBeginStateId;
 };
 
+// ------------------------------------------------------------------
 }
 }
@@ -1 +1,806 @@
 #include "PlyLoader.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Graphics/FileMapping.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PLY_SIMD_SSE
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define PLY_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace stone
+{
+namespace ply
+{
+
+//----------------------------------------------
+
+struct TypeName
+{
+	const_cstr									name;
+	Type										type;
+};
+
+static const TypeName							k_TypeNames[] = {
+	{ "char", Type::Int8 }, { "int8", Type::Int8 },
+	{ "uchar", Type::UInt8 }, { "uint8", Type::UInt8 },
+	{ "short", Type::Int16 }, { "int16", Type::Int16 },
+	{ "ushort", Type::UInt16 }, { "uint16", Type::UInt16 },
+	{ "int", Type::Int32 }, { "int32", Type::Int32 },
+	{ "uint", Type::UInt32 }, { "uint32", Type::UInt32 },
+	{ "float", Type::Float32 }, { "float32", Type::Float32 },
+	{ "double", Type::Float64 }, { "float64", Type::Float64 }
+};
+
+struct AttributeName
+{
+	const_cstr									name;
+	Attribute									attribute;
+};
+
+// the names Blender, MeshLab and the scanners' exporters use
+static const AttributeName						k_VertexAttributeNames[] = {
+	{ "x", Attribute::PositionX }, { "y", Attribute::PositionY }, { "z", Attribute::PositionZ },
+	{ "nx", Attribute::NormalX }, { "ny", Attribute::NormalY }, { "nz", Attribute::NormalZ },
+	{ "s", Attribute::TexCoordS }, { "t", Attribute::TexCoordT },
+	{ "u", Attribute::TexCoordS }, { "v", Attribute::TexCoordT },
+	{ "texture_u", Attribute::TexCoordS }, { "texture_v", Attribute::TexCoordT },
+	{ "texture_s", Attribute::TexCoordS }, { "texture_t", Attribute::TexCoordT },
+	{ "red", Attribute::ColorR }, { "green", Attribute::ColorG }, { "blue", Attribute::ColorB }
+};
+
+static const Type ParseType(const_cstr i_name)
+{
+	for (size i = 0; i < sizeof(k_TypeNames) / sizeof(TypeName); i++)
+	{
+		if (strcmp(i_name, k_TypeNames[i].name) == 0)
+		{
+			return k_TypeNames[i].type;
+		}
+	}
+	return Type::Invalid;
+}
+
+static const Attribute ParseVertexAttribute(const_cstr i_name)
+{
+	for (size i = 0; i < sizeof(k_VertexAttributeNames) / sizeof(AttributeName); i++)
+	{
+		if (strcmp(i_name, k_VertexAttributeNames[i].name) == 0)
+		{
+			return k_VertexAttributeNames[i].attribute;
+		}
+	}
+	return Attribute::None;
+}
+
+static const size GetTypeSize(const Type i_type)
+{
+	switch (i_type)
+	{
+	case Type::Int8:
+	case Type::UInt8:
+		return 1;
+	case Type::Int16:
+	case Type::UInt16:
+		return 2;
+	case Type::Int32:
+	case Type::UInt32:
+	case Type::Float32:
+		return 4;
+	case Type::Float64:
+		return 8;
+	default:
+		return 0;
+	}
+}
+
+static inline const bool IsFloatType(const Type i_type)
+{
+	return i_type == Type::Float32 || i_type == Type::Float64;
+}
+
+// integer colors are normalized by it
+static const f32 GetColorRange(const Type i_type)
+{
+	switch (i_type)
+	{
+	case Type::Int8:
+	case Type::UInt8:
+		return 255.0f;
+	case Type::Int16:
+	case Type::UInt16:
+		return 65535.0f;
+	case Type::Int32:
+	case Type::UInt32:
+		return 4294967295.0f;
+	default:
+		return 1.0f;
+	}
+}
+
+// the header is tiny, it is read line by line
+static const bool ReadHeaderLine(const c8*& io_cursor, const c8* i_end, c8* o_line, const size i_capacity)
+{
+	if (io_cursor >= i_end)
+	{
+		return false;
+	}
+
+	size length = 0;
+	while (io_cursor < i_end && *io_cursor != '\n')
+	{
+		if (*io_cursor != '\r' && length + 1 < i_capacity)
+		{
+			o_line[length++] = *io_cursor;
+		}
+		io_cursor++;
+	}
+	o_line[length] = 0;
+	if (io_cursor < i_end)
+	{
+		io_cursor++;
+	}
+	return true;
+}
+
+//----------------------------------------------
+
+namespace details
+{
+
+static inline const u32 CountTrailingZeros(const u64 i_value)
+{
+#if defined(_MSC_VER)
+	unsigned long index = 0;
+	_BitScanForward64(&index, i_value);
+	return (u32)index;
+#else
+	return (u32)__builtin_ctzll(i_value);
+#endif
+}
+
+static inline const bool IsDigit(const c8 i_c)
+{
+	return (u8)(i_c - '0') <= 9;
+}
+
+static inline const bool IsSpace(const c8 i_c)
+{
+	return i_c == ' ' || i_c == '\n' || i_c == '\r' || i_c == '\t';
+}
+
+// how many digits from i_cursor, 16 characters at once
+static inline const size GetDigitsRunLength(const c8* i_cursor, const c8* i_end)
+{
+	const c8* p = i_cursor;
+#if defined(PLY_SIMD_SSE)
+	const __m128i zero = _mm_set1_epi8('0');
+	// unsigned c - '0' > 9 as a signed compare
+	const __m128i bias = _mm_set1_epi8((c8)0x80);
+	const __m128i nine = _mm_set1_epi8((c8)(9 ^ 0x80));
+	while (i_end - p >= 16)
+	{
+		const __m128i chars = _mm_loadu_si128((const __m128i*)p);
+		const __m128i nonDigits = _mm_cmpgt_epi8(_mm_xor_si128(_mm_sub_epi8(chars, zero), bias), nine);
+		const u32 mask = (u32)_mm_movemask_epi8(nonDigits);
+		if (mask != 0)
+		{
+			return (size)(p - i_cursor) + CountTrailingZeros(mask);
+		}
+		p += 16;
+	}
+#elif defined(PLY_SIMD_NEON)
+	const uint8x16_t zero = vdupq_n_u8('0');
+	const uint8x16_t nine = vdupq_n_u8(9);
+	while (i_end - p >= 16)
+	{
+		const uint8x16_t chars = vld1q_u8((const u8*)p);
+		const uint8x16_t nonDigits = vcgtq_u8(vsubq_u8(chars, zero), nine);
+		// no movemask: a nibble per character
+		const u64 mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(nonDigits), 4)), 0);
+		if (mask != 0)
+		{
+			return (size)(p - i_cursor) + (CountTrailingZeros(mask) >> 2);
+		}
+		p += 16;
+	}
+#endif
+	while (p < i_end && IsDigit(*p))
+	{
+		p++;
+	}
+	return (size)(p - i_cursor);
+}
+
+// 8 ascii digits to their value in 3 multiplications, little endian only
+static inline const u32 Parse8Digits(const c8* i_digits)
+{
+	u64 value;
+	memcpy(&value, i_digits, sizeof(u64));
+	value = ((value & 0x0F0F0F0F0F0F0F0Full) * 2561) >> 8;
+	value = ((value & 0x00FF00FF00FF00FFull) * 6553601) >> 16;
+	return (u32)(((value & 0x0000FFFF0000FFFFull) * 42949672960001ull) >> 32);
+}
+
+// a u64 holds any 19 digits
+static const u32								k_MaxMantissaDigits = 19;
+
+/*
+ * Accumulates the run of digits from i_cursor into io_mantissa, leading zeros and the digits past
+ * k_MaxMantissaDigits go to io_exponent instead.
+ */
+static inline const c8* ParseDigits(const c8* i_cursor, const c8* i_end, const bool i_isFraction,
+		u64* io_mantissa, u32* io_digitsCount, s32* io_exponent)
+{
+	const c8* p = i_cursor;
+	const c8* runEnd = p + GetDigitsRunLength(p, i_end);
+	u64 mantissa = *io_mantissa;
+	u32 digitsCount = *io_digitsCount;
+	s32 exponent = *io_exponent;
+
+	if (mantissa == 0)
+	{
+		while (p < runEnd && *p == '0')
+		{
+			p++;
+			exponent -= i_isFraction ? 1 : 0;
+		}
+	}
+
+	while (runEnd - p >= 8 && digitsCount + 8 <= k_MaxMantissaDigits)
+	{
+		mantissa = mantissa * 100000000ull + Parse8Digits(p);
+		p += 8;
+		digitsCount += 8;
+		exponent -= i_isFraction ? 8 : 0;
+	}
+
+	while (p < runEnd && digitsCount < k_MaxMantissaDigits)
+	{
+		mantissa = mantissa * 10 + (u64)(*p - '0');
+		p++;
+		digitsCount++;
+		exponent -= i_isFraction ? 1 : 0;
+	}
+
+	// past the precision: integer digits scale the mantissa, fraction digits are dropped
+	if (!i_isFraction)
+	{
+		exponent += (s32)(runEnd - p);
+	}
+
+	*io_mantissa = mantissa;
+	*io_digitsCount = digitsCount;
+	*io_exponent = exponent;
+	return runEnd;
+}
+
+static const f64								k_ExactPowersOf10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+const c8* ParseFloat(const c8* i_cursor, const c8* i_end, f32* o_value)
+{
+	const c8* p = i_cursor;
+	bool negative = false;
+	if (p < i_end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		p++;
+	}
+
+	u64 mantissa = 0;
+	u32 digitsCount = 0;
+	s32 exponent = 0;
+	const c8* integerStart = p;
+	p = ParseDigits(p, i_end, false, &mantissa, &digitsCount, &exponent);
+	bool hasDigits = (p != integerStart);
+	if (p < i_end && *p == '.')
+	{
+		p++;
+		const c8* fractionStart = p;
+		p = ParseDigits(p, i_end, true, &mantissa, &digitsCount, &exponent);
+		hasDigits = hasDigits || (p != fractionStart);
+	}
+
+	if (!hasDigits)
+	{
+		return nullptr;
+	}
+
+	if (p < i_end && (*p == 'e' || *p == 'E'))
+	{
+		const c8* e = p + 1;
+		bool negativeExponent = false;
+		if (e < i_end && (*e == '-' || *e == '+'))
+		{
+			negativeExponent = (*e == '-');
+			e++;
+		}
+
+		if (e < i_end && IsDigit(*e))
+		{
+			s32 exponentValue = 0;
+			while (e < i_end && IsDigit(*e))
+			{
+				exponentValue = exponentValue < 10000 ? exponentValue * 10 + (*e - '0') : exponentValue;
+				e++;
+			}
+			exponent += negativeExponent ? -exponentValue : exponentValue;
+			p = e;
+		}
+	}
+
+	f64 value = (f64)mantissa;
+	if (mantissa != 0)
+	{
+		if (exponent >= 0 && exponent <= 22)
+		{
+			value *= k_ExactPowersOf10[exponent];
+		}
+		else if (exponent < 0 && exponent >= -22)
+		{
+			value /= k_ExactPowersOf10[-exponent];
+		}
+		else
+		{
+			value *= pow(10.0, (f64)exponent);
+		}
+	}
+	*o_value = (f32)(negative ? -value : value);
+	return p;
+}
+
+const c8* ParseInt(const c8* i_cursor, const c8* i_end, s64* o_value)
+{
+	const c8* p = i_cursor;
+	bool negative = false;
+	if (p < i_end && (*p == '-' || *p == '+'))
+	{
+		negative = (*p == '-');
+		p++;
+	}
+
+	u64 mantissa = 0;
+	u32 digitsCount = 0;
+	s32 exponent = 0;
+	const c8* digitsStart = p;
+	p = ParseDigits(p, i_end, false, &mantissa, &digitsCount, &exponent);
+	if (p == digitsStart || exponent != 0)
+	{
+		// no digits or too many
+		return nullptr;
+	}
+
+	*o_value = negative ? -(s64)mantissa : (s64)mantissa;
+	return p;
+}
+
+}
+
+//----------------------------------------------
+
+// values of the properties of an element's row, read from the ascii or the binary body
+class AsciiReader
+{
+public:
+	AsciiReader(const c8* i_begin, const c8* i_end)
+		: m_Cursor(i_begin)
+		, m_End(i_end)
+	{
+	}
+
+	inline const bool Read(const Type i_type, f64* o_value)
+	{
+		while (m_Cursor < m_End && details::IsSpace(*m_Cursor))
+		{
+			m_Cursor++;
+		}
+
+		const c8* tokenEnd = nullptr;
+		if (IsFloatType(i_type))
+		{
+			f32 value = 0.0f;
+			tokenEnd = details::ParseFloat(m_Cursor, m_End, &value);
+			*o_value = value;
+		}
+		else
+		{
+			s64 value = 0;
+			tokenEnd = details::ParseInt(m_Cursor, m_End, &value);
+			*o_value = (f64)value;
+		}
+
+		if (tokenEnd == nullptr || (tokenEnd < m_End && !details::IsSpace(*tokenEnd)))
+		{
+			return false;
+		}
+		m_Cursor = tokenEnd;
+		return true;
+	}
+
+	inline const bool Skip(const Type i_type, const u32 i_count)
+	{
+		f64 value = 0.0;
+		for (u32 i = 0; i < i_count; i++)
+		{
+			if (!Read(i_type, &value))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	const c8*									m_Cursor;
+	const c8*									m_End;
+};
+
+class BinaryReader
+{
+public:
+	BinaryReader(const u8* i_begin, const u8* i_end, const bool i_swapBytes)
+		: m_Cursor(i_begin)
+		, m_End(i_end)
+		, m_SwapBytes(i_swapBytes)
+	{
+	}
+
+	inline const bool Read(const Type i_type, f64* o_value)
+	{
+		const size typeSize = GetTypeSize(i_type);
+		if ((size)(m_End - m_Cursor) < typeSize)
+		{
+			return false;
+		}
+
+		switch (i_type)
+		{
+		case Type::Int8: *o_value = _Load<s8>(); break;
+		case Type::UInt8: *o_value = _Load<u8>(); break;
+		case Type::Int16: *o_value = _Load<s16>(); break;
+		case Type::UInt16: *o_value = _Load<u16>(); break;
+		case Type::Int32: *o_value = _Load<s32>(); break;
+		case Type::UInt32: *o_value = _Load<u32>(); break;
+		case Type::Float32: *o_value = _Load<f32>(); break;
+		case Type::Float64: *o_value = _Load<f64>(); break;
+		default: return false;
+		}
+		return true;
+	}
+
+	inline const bool Skip(const Type i_type, const u32 i_count)
+	{
+		const size skipSize = GetTypeSize(i_type) * i_count;
+		if ((size)(m_End - m_Cursor) < skipSize)
+		{
+			return false;
+		}
+		m_Cursor += skipSize;
+		return true;
+	}
+
+private:
+	// fixed size copies, they compile to plain loads
+	template <class TValue>
+	inline const TValue _Load()
+	{
+		u8 bytes[sizeof(TValue)];
+		memcpy(bytes, m_Cursor, sizeof(TValue));
+		if (m_SwapBytes)
+		{
+			for (size i = 0; i < sizeof(TValue) / 2; i++)
+			{
+				const u8 tmp = bytes[i];
+				bytes[i] = bytes[sizeof(TValue) - 1 - i];
+				bytes[sizeof(TValue) - 1 - i] = tmp;
+			}
+		}
+		m_Cursor += sizeof(TValue);
+
+		TValue value;
+		memcpy(&value, bytes, sizeof(TValue));
+		return value;
+	}
+
+private:
+	const u8*									m_Cursor;
+	const u8*									m_End;
+	bool										m_SwapBytes;
+};
+
+//----------------------------------------------
+
+template <class TReader>
+static const bool ReadElements(const Header& i_header, const Output& i_output, TReader& io_reader)
+{
+	for (u32 e = 0; e < i_header.elementsCount; e++)
+	{
+		const Element& element = i_header.elements[e];
+		const bool isVertex = ((s32)e == i_header.vertexElementIdx);
+		const bool isFace = ((s32)e == i_header.faceElementIdx);
+		u32 indicesCount = 0;
+
+		for (u32 row = 0; row < element.count; row++)
+		{
+			f32 values[(s32)Attribute::Count];
+			memset(values, 0, sizeof(values));
+
+			for (u32 p = 0; p < element.propertiesCount; p++)
+			{
+				const Property& property = element.properties[p];
+				f64 value = 0.0;
+				if (property.countType != Type::Invalid)
+				{
+					if (!io_reader.Read(property.countType, &value))
+					{
+						return false;
+					}
+
+					const u32 count = (u32)value;
+					if (!isFace || property.attribute != Attribute::VertexIndices)
+					{
+						if (!io_reader.Skip(property.type, count))
+						{
+							return false;
+						}
+						continue;
+					}
+
+					if (count != i_output.indicesPerFace)
+					{
+						return false;
+					}
+
+					for (u32 i = 0; i < count; i++)
+					{
+						if (!io_reader.Read(property.type, &value))
+						{
+							return false;
+						}
+						if (i_output.indices)
+						{
+							i_output.indices[indicesCount] = (s32)value;
+						}
+						indicesCount++;
+					}
+					continue;
+				}
+
+				if (!io_reader.Read(property.type, &value))
+				{
+					return false;
+				}
+
+				if (isVertex && property.attribute != Attribute::None)
+				{
+					const bool isColor = property.attribute >= Attribute::ColorR && property.attribute <= Attribute::ColorB;
+					values[(s32)property.attribute] = isColor ? (f32)value / GetColorRange(property.type) : (f32)value;
+				}
+			}
+
+			if (isVertex)
+			{
+				if (i_output.positions)
+				{
+					i_output.positions[row] = floral::vec3f(values[(s32)Attribute::PositionX],
+							values[(s32)Attribute::PositionY], values[(s32)Attribute::PositionZ]);
+				}
+				if (i_output.normals)
+				{
+					i_output.normals[row] = floral::vec3f(values[(s32)Attribute::NormalX],
+							values[(s32)Attribute::NormalY], values[(s32)Attribute::NormalZ]);
+				}
+				if (i_output.texcoords)
+				{
+					i_output.texcoords[row] = floral::vec2f(values[(s32)Attribute::TexCoordS], values[(s32)Attribute::TexCoordT]);
+				}
+				if (i_output.colors)
+				{
+					i_output.colors[row] = floral::vec3f(values[(s32)Attribute::ColorR],
+							values[(s32)Attribute::ColorG], values[(s32)Attribute::ColorB]);
+				}
+			}
+		}
+	}
+	return true;
+}
+
+//----------------------------------------------
+
+const bool OpenFile(const floral::path& i_path, File* o_file)
+{
+	o_file->dataSize = 0;
+	// read once, front to back
+	o_file->data = (p8)file_mapping::MapFile(i_path.pm_PathStr, &o_file->dataSize, true);
+	if (o_file->data == nullptr)
+	{
+		return false;
+	}
+
+	if (!ParseHeader((const c8*)o_file->data, o_file->dataSize, &o_file->header))
+	{
+		CloseFile(o_file);
+		return false;
+	}
+	return true;
+}
+
+void CloseFile(File* io_file)
+{
+	if (io_file->data)
+	{
+		file_mapping::UnmapFile(io_file->data, io_file->dataSize);
+	}
+	io_file->data = nullptr;
+	io_file->dataSize = 0;
+}
+
+const bool ParseHeader(const c8* i_data, const size i_size, Header* o_header)
+{
+	memset(o_header, 0, sizeof(Header));
+	o_header->vertexElementIdx = -1;
+	o_header->faceElementIdx = -1;
+
+	const c8* cursor = i_data;
+	const c8* end = i_data + i_size;
+	c8 line[1024];
+	if (!ReadHeaderLine(cursor, end, line, sizeof(line)) || strcmp(line, "ply") != 0)
+	{
+		return false;
+	}
+
+	bool hasFormat = false;
+	while (ReadHeaderLine(cursor, end, line, sizeof(line)))
+	{
+		c8 word0[64], word1[64], word2[64], word3[64];
+		const s32 wordsCount = sscanf(line, "%63s %63s %63s %63s", word0, word1, word2, word3);
+		if (wordsCount <= 0 || strcmp(word0, "comment") == 0 || strcmp(word0, "obj_info") == 0)
+		{
+			continue;
+		}
+
+		if (strcmp(word0, "end_header") == 0)
+		{
+			o_header->bodyOffset = (size)(cursor - i_data);
+			return hasFormat;
+		}
+
+		if (strcmp(word0, "format") == 0 && wordsCount >= 2)
+		{
+			if (strcmp(word1, "ascii") == 0)
+			{
+				o_header->format = Format::Ascii;
+			}
+			else if (strcmp(word1, "binary_little_endian") == 0)
+			{
+				o_header->format = Format::BinaryLittleEndian;
+			}
+			else if (strcmp(word1, "binary_big_endian") == 0)
+			{
+				o_header->format = Format::BinaryBigEndian;
+			}
+			else
+			{
+				return false;
+			}
+			hasFormat = true;
+		}
+		else if (strcmp(word0, "element") == 0 && wordsCount >= 3)
+		{
+			if (o_header->elementsCount >= k_MaxElements)
+			{
+				return false;
+			}
+
+			const s32 elementIdx = (s32)o_header->elementsCount++;
+			Element& element = o_header->elements[elementIdx];
+			element.count = (u32)strtoul(word2, nullptr, 10);
+			element.propertiesCount = 0;
+			if (strcmp(word1, "vertex") == 0)
+			{
+				o_header->vertexElementIdx = elementIdx;
+			}
+			else if (strcmp(word1, "face") == 0)
+			{
+				o_header->faceElementIdx = elementIdx;
+			}
+		}
+		else if (strcmp(word0, "property") == 0 && wordsCount >= 3)
+		{
+			if (o_header->elementsCount == 0)
+			{
+				return false;
+			}
+
+			const s32 elementIdx = (s32)o_header->elementsCount - 1;
+			Element& element = o_header->elements[elementIdx];
+			if (element.propertiesCount >= k_MaxProperties)
+			{
+				return false;
+			}
+
+			Property& property = element.properties[element.propertiesCount++];
+			if (strcmp(word1, "list") == 0)
+			{
+				if (wordsCount < 4)
+				{
+					return false;
+				}
+
+				c8 name[64];
+				if (sscanf(line, "%*s %*s %*s %*s %63s", name) != 1)
+				{
+					return false;
+				}
+				property.countType = ParseType(word2);
+				property.type = ParseType(word3);
+				property.attribute = Attribute::None;
+				if (property.countType == Type::Invalid || IsFloatType(property.countType) || property.type == Type::Invalid)
+				{
+					return false;
+				}
+
+				if (elementIdx == o_header->faceElementIdx
+					&& (strcmp(name, "vertex_indices") == 0 || strcmp(name, "vertex_index") == 0))
+				{
+					property.attribute = Attribute::VertexIndices;
+				}
+			}
+			else
+			{
+				property.countType = Type::Invalid;
+				property.type = ParseType(word1);
+				property.attribute = elementIdx == o_header->vertexElementIdx ? ParseVertexAttribute(word2) : Attribute::None;
+				if (property.type == Type::Invalid)
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	// no end_header
+	return false;
+}
+
+const bool ReadBody(const File& i_file, const Output& i_output)
+{
+	const Header& header = i_file.header;
+	if (header.format == Format::Ascii)
+	{
+		AsciiReader reader((const c8*)i_file.data + header.bodyOffset, (const c8*)i_file.data + i_file.dataSize);
+		return ReadElements(header, i_output, reader);
+	}
+
+	// the hosts are little endian
+	BinaryReader reader(i_file.data + header.bodyOffset, i_file.data + i_file.dataSize, header.format == Format::BinaryBigEndian);
+	return ReadElements(header, i_output, reader);
+}
+
+const u32 GetVerticesCount(const Header& i_header)
+{
+	return i_header.vertexElementIdx >= 0 ? i_header.elements[i_header.vertexElementIdx].count : 0;
+}
+
+const u32 GetFacesCount(const Header& i_header)
+{
+	return i_header.faceElementIdx >= 0 ? i_header.elements[i_header.faceElementIdx].count : 0;
+}
+
+//----------------------------------------------
+
+}
+}
@@ -20,12 +20,134 @@ struct PlyData
 
 };
 
+/*
+ * ascii, binary_little_endian and binary_big_endian files. The vertex properties PlyData has are read
+ * whatever their order and type (the missing ones are zeros, integer colors are normalized), the others
+ * and the other elements are skipped. Every face must have 3 (LoadFromPly) or 4 (LoadFFPatchesFromPly)
+ * vertices.
+ */
 template <class TAllocator>
 PlyData<TAllocator> LoadFromPly(const floral::path& i_path, TAllocator* i_allocator);
 
 template <class TAllocator>
 PlyData<TAllocator> LoadFFPatchesFromPly(const floral::path& i_path, TAllocator* i_allocator);
 
+//----------------------------------------------
+
+namespace ply
+{
+
+enum class Format : u8
+{
+	Ascii = 0,
+	BinaryLittleEndian,
+	BinaryBigEndian
+};
+
+enum class Type : u8
+{
+	Invalid = 0,
+	Int8,
+	UInt8,
+	Int16,
+	UInt16,
+	Int32,
+	UInt32,
+	Float32,
+	Float64
+};
+
+// the properties PlyData takes
+enum class Attribute : s8
+{
+	None = -1,
+	PositionX = 0,
+	PositionY,
+	PositionZ,
+	NormalX,
+	NormalY,
+	NormalZ,
+	TexCoordS,
+	TexCoordT,
+	ColorR,
+	ColorG,
+	ColorB,
+	VertexIndices,										// the list of the face element
+	Count
+};
+
+struct Property
+{
+	Type										type;
+	Type										countType;			// of a list, Invalid for a scalar
+	Attribute									attribute;
+};
+
+static const u32								k_MaxProperties = 32;
+static const u32								k_MaxElements = 8;
+
+struct Element
+{
+	u32											count;
+	u32											propertiesCount;
+	Property									properties[k_MaxProperties];
+};
+
+struct Header
+{
+	Format										format;
+	u32											elementsCount;
+	Element										elements[k_MaxElements];
+	s32											vertexElementIdx;	// -1 when absent
+	s32											faceElementIdx;
+	size										bodyOffset;
+};
+
+/*
+ * The file is parsed straight from a read only mapping, front to back: nothing is copied and the memory
+ * used does not depend on the file's size.
+ */
+struct File
+{
+	p8											data;
+	size										dataSize;
+	Header										header;
+};
+
+// false when the file cannot be mapped or its header is not supported
+const bool										OpenFile(const floral::path& i_path, File* o_file);
+void											CloseFile(File* io_file);
+
+const bool										ParseHeader(const c8* i_data, const size i_size, Header* o_header);
+
+// any of the arrays may be nullptr, the others are sized for the vertex and face elements
+struct Output
+{
+	floral::vec3f*								positions;
+	floral::vec3f*								normals;
+	floral::vec2f*								texcoords;
+	floral::vec3f*								colors;
+	s32*										indices;
+	u32											indicesPerFace;
+};
+
+// false when the body is truncated or a face does not have i_output.indicesPerFace vertices
+const bool										ReadBody(const File& i_file, const Output& i_output);
+
+const u32										GetVerticesCount(const Header& i_header);
+const u32										GetFacesCount(const Header& i_header);
+
+namespace details
+{
+
+// hand written parsers of ascii numbers, they return the end of the number or nullptr when there is none
+const c8*										ParseFloat(const c8* i_cursor, const c8* i_end, f32* o_value);
+const c8*										ParseInt(const c8* i_cursor, const c8* i_end, s64* o_value);
+
+}
+
+}
+
 }
 
 #include "PlyLoader.inl"
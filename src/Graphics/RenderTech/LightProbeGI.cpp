@@ -17,6 +17,7 @@
 #include "InsigneImGui.h"
 #include "Graphics/DebugDrawer.h"
 #include "Graphics/PlyLoader.h"
+#include "Graphics/LightProbeBaker.h"
 
 //----------------------------------------------
 #include "LightProbeGIShaders.inl"
@@ -44,6 +45,7 @@ LightProbeGI::LightProbeGI()
 	, m_ResourceArena(nullptr)
 	, m_TemporalArena(nullptr)
 	, m_SHBakingStarted(false)
+	, m_SHUploadPending(false)
 	, m_SHReady(false)
 	, m_DrawSHProbes(false)
 {
@@ -411,6 +413,13 @@ void LightProbeGI::OnUpdate(const f32 i_deltaMs)
 			m_SHBaker.StartSHBaking(m_SHPositions, m_SHData, renderCb);
 		}
 	}
+	if (ImGui::Button("Bake SH (CPU)"))
+	{
+		if (!m_SHBakingStarted)
+		{
+			_BakeSHCPU();
+		}
+	}
 	ImGui::Checkbox("Draw SH", &m_DrawSHProbes);
 	ImGui::End();
 
@@ -426,25 +435,31 @@ void LightProbeGI::OnRender(const f32 i_deltaMs)
 		if (m_SHBaker.FrameUpdate())
 		{
 			CLOVER_VERBOSE("SH Baking finished");
-			m_SHReady = true;
 			m_SHBakingStarted = false;
+			m_SHUploadPending = true;
+		}
+	}
 
-			p8* shProbeData = (p8*)m_TemporalArena->allocate(SIZE_KB(32));
-			p8* shData = shProbeData;
-			memset(shProbeData, 0, SIZE_KB(32));
-			for (size i = 0; i < m_SHPositions.get_size(); i++)
-			{
-				ProbeData d;
-				d.XForm = floral::construct_translation3d(m_SHPositions[i]) * floral::construct_scaling3d(floral::vec3f(0.05f));
-				SHCoeffs& coeffs = m_SHData->Probes[i];
-				memcpy(d.CoEffs, coeffs.CoEffs, sizeof(SHCoeffs));
-				memcpy(shData, &d, sizeof(ProbeData));
-				shData = (p8*)((aptr)shData + 256);
-			}
-			insigne::copy_update_ub(m_ProbeUB, &shProbeData[0], 64 * 256, 0);
-			insigne::copy_update_ub(m_SHUB, m_SHData, sizeof(SHData), 0);
-			m_TemporalArena->free_all();
+	if (m_SHUploadPending)
+	{
+		m_SHUploadPending = false;
+		m_SHReady = true;
+
+		p8* shProbeData = (p8*)m_TemporalArena->allocate(SIZE_KB(32));
+		p8* shData = shProbeData;
+		memset(shProbeData, 0, SIZE_KB(32));
+		for (size i = 0; i < m_SHPositions.get_size(); i++)
+		{
+			ProbeData d;
+			d.XForm = floral::construct_translation3d(m_SHPositions[i]) * floral::construct_scaling3d(floral::vec3f(0.05f));
+			SHCoeffs& coeffs = m_SHData->Probes[i];
+			memcpy(d.CoEffs, coeffs.CoEffs, sizeof(SHCoeffs));
+			memcpy(shData, &d, sizeof(ProbeData));
+			shData = (p8*)((aptr)shData + 256);
 		}
+		insigne::copy_update_ub(m_ProbeUB, &shProbeData[0], 64 * 256, 0);
+		insigne::copy_update_ub(m_SHUB, m_SHData, sizeof(SHData), 0);
+		m_TemporalArena->free_all();
 	}
 
 	insigne::begin_render_pass(m_PostFXBuffer);
@@ -498,6 +513,50 @@ void LightProbeGI::OnCleanUp()
 
 //----------------------------------------------
 
+void LightProbeGI::_BakeSHCPU()
+{
+	// the albedo pass of the GPU baker renders the vertex colors unlit, trace the same radiance
+	lightprobe::BakeScene scene;
+	scene.positions = &m_VerticesData[0].Position;
+	scene.positionStride = sizeof(VertexPNC);
+	scene.colors = &m_VerticesData[0].Color;
+	scene.colorStride = sizeof(VertexPNC);
+	scene.emissions = nullptr;
+	scene.emissionStride = 0;
+	scene.verticesCount = (u32)m_VerticesData.get_size();
+	scene.indices = (const u32*)&m_IndicesData[0];
+	scene.indicesCount = (u32)m_IndicesData.get_size();
+
+	// m_TemporalArena is too small for the BVH of a real scene, both arenas are sized from the triangles
+	const u32 trianglesCount = scene.indicesCount / 3;
+	const u32 probesCount = (u32)m_SHPositions.get_size();
+	lightprobe::BakeOptions options = lightprobe::GetDefaultBakeOptions();
+	const size bakeArenaSize = lightprobe::GetBakeAccelDataSize(trianglesCount) + sizeof(lightprobe::SH9) * probesCount;
+	const size scratchArenaSize = floral::max(lightprobe::GetBakeAccelScratchSize(trianglesCount),
+			lightprobe::GetBakeProbesScratchSize(probesCount, options));
+	LinearArena* bakeArena = g_StreammingAllocator.allocate_arena<LinearArena>(bakeArenaSize);
+	FreelistArena* scratchArena = g_StreammingAllocator.allocate_arena<FreelistArena>(scratchArenaSize);
+
+	const lightprobe::BakeAccel accel = lightprobe::BuildBakeAccel(scene, bakeArena, scratchArena);
+	lightprobe::SH9* sh = bakeArena->allocate_array<lightprobe::SH9>(probesCount);
+	lightprobe::BakeProbes(scene, accel, options, &m_SHPositions[0], sh, probesCount, scratchArena);
+
+	for (u32 i = 0; i < probesCount; i++)
+	{
+		for (u32 j = 0; j < 9; j++)
+		{
+			const floral::vec3f& c = sh[i].coeffs[j];
+			m_SHData->Probes[i].CoEffs[j] = floral::vec4f(c.x, c.y, c.z, 0.0f);
+		}
+	}
+
+	g_StreammingAllocator.free(scratchArena);
+	g_StreammingAllocator.free(bakeArena);
+	CLOVER_VERBOSE("SH CPU baking finished, %d probes", probesCount);
+	m_SHReady = false;
+	m_SHUploadPending = true;
+}
+
 void LightProbeGI::_RenderSceneAlbedo(const floral::mat4x4f& i_wvp)
 {
 	insigne::copy_update_ub(m_AlbedoUB, (const voidptr)&i_wvp, sizeof(floral::mat4x4f), 0);
@@ -34,6 +34,7 @@ private:
 	void										_RenderSceneAlbedo(const floral::mat4x4f& i_wvp);
 	void										_InitializeSHBaker(const floral::simple_callback<void>& i_renderCb);
 	void										_UpdateSHBaker();
+	void										_BakeSHCPU();
 
 private:
 	struct SceneData
@@ -65,6 +66,7 @@ private:
 
 private:
 	bool										m_SHBakingStarted;
+	bool										m_SHUploadPending;
 	bool										m_SHReady;
 	bool										m_DrawSHProbes;
 
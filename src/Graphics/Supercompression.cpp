@@ -0,0 +1,304 @@
+#include "Supercompression.h"
+
+#include <string.h>
+
+#include <atomic>
+
+#include <floral/math/utils.h>
+
+#include <refrain2.h>
+
+namespace supercomp
+{
+// ------------------------------------------------------------------
+
+static const u32								k_ProbabilityBits = 12;
+static const u32								k_ProbabilityScale = 1u << k_ProbabilityBits;
+static const u32								k_RansLowerBound = 1u << 23;
+static const u32								k_TableMaskSize = 32;			// 1 bit per used symbol, then an u16 frequency per used symbol
+static const s32								k_RansStatesCount = 4;			// interleaved, symbol j of a plane uses state j % 4
+static const u32								k_MinChunksPerTask = 2;
+static const u32								k_MaxTasks = 64;
+
+struct PlaneDecoder
+{
+	u8											symbols[k_ProbabilityScale];
+	u16											frequencies[256];
+	u16											starts[256];
+};
+
+struct SurfaceData
+{
+	const SupercompressionHeader*				header;
+	const u8*									tables[k_MaxSupercompressionStride];
+	const u8*									chunkSizes;						// u32, unaligned
+	p8											output;
+	size										outputSize;
+};
+
+struct DecompressTaskData
+{
+	const SurfaceData*							surface;
+	const u8*									input;							// first chunk of the task
+	u32											firstChunk;
+	u32											lastChunk;
+	bool										result;
+};
+
+// ------------------------------------------------------------------
+
+static const size GetTableSize(const u8* i_table)
+{
+	u32 usedSymbols = 0;
+	for (s32 s = 0; s < 256; s++)
+	{
+		usedSymbols += (i_table[s >> 3] >> (s & 7)) & 1;
+	}
+	return k_TableMaskSize + usedSymbols * sizeof(u16);
+}
+
+// false when the frequencies do not add up to k_ProbabilityScale, the slots would not cover the range
+static const bool BuildPlaneDecoder(const u8* i_table, PlaneDecoder* o_decoder)
+{
+	const u8* frequencies = i_table + k_TableMaskSize;
+	u32 start = 0;
+	for (s32 s = 0; s < 256; s++)
+	{
+		u16 frequency = 0;
+		if (i_table[s >> 3] & (1 << (s & 7)))
+		{
+			memcpy(&frequency, frequencies, sizeof(u16));
+			frequencies += sizeof(u16);
+			if (start + frequency > k_ProbabilityScale)
+			{
+				return false;
+			}
+			memset(&o_decoder->symbols[start], s, frequency);
+		}
+		o_decoder->frequencies[s] = frequency;
+		o_decoder->starts[s] = (u16)start;
+		start += frequency;
+	}
+	return start == k_ProbabilityScale;
+}
+
+// a corrupted chunk could ask for more bytes than it has, it gets zeros and fails the size check of the chunk
+static inline const u8 DecodeSymbol(u32& io_state, const u8*& io_input, const u8* i_inputEnd, const PlaneDecoder& i_decoder)
+{
+	const u32 slot = io_state & (k_ProbabilityScale - 1);
+	const u8 symbol = i_decoder.symbols[slot];
+	u32 state = i_decoder.frequencies[symbol] * (io_state >> k_ProbabilityBits) + slot - i_decoder.starts[symbol];
+	while (state < k_RansLowerBound)
+	{
+		state = (state << 8) | (io_input < i_inputEnd ? *io_input : 0);
+		io_input++;
+	}
+	io_state = state;
+	return symbol;
+}
+
+// elements of one plane, the states take turns
+template <bool TDelta>
+static void DecodePlane(u32* io_states, const u8*& io_input, const u8* i_inputEnd, const PlaneDecoder& i_decoder,
+		const size i_elementsCount, const u32 i_stride, p8 o_output)
+{
+	u32 state0 = io_states[0];
+	u32 state1 = io_states[1];
+	u32 state2 = io_states[2];
+	u32 state3 = io_states[3];
+	const u8* input = io_input;
+	u8 previous = 0;
+	size j = 0;
+	for (; j + 3 < i_elementsCount; j += 4)
+	{
+		u8 symbols[4];
+		symbols[0] = DecodeSymbol(state0, input, i_inputEnd, i_decoder);
+		symbols[1] = DecodeSymbol(state1, input, i_inputEnd, i_decoder);
+		symbols[2] = DecodeSymbol(state2, input, i_inputEnd, i_decoder);
+		symbols[3] = DecodeSymbol(state3, input, i_inputEnd, i_decoder);
+		for (s32 k = 0; k < 4; k++)
+		{
+			previous = TDelta ? (u8)(previous + symbols[k]) : symbols[k];
+			o_output[(j + k) * i_stride] = previous;
+		}
+	}
+	u32* states[] = { &state0, &state1, &state2 };
+	for (; j < i_elementsCount; j++)
+	{
+		const u8 symbol = DecodeSymbol(*states[j & 3], input, i_inputEnd, i_decoder);
+		previous = TDelta ? (u8)(previous + symbol) : symbol;
+		o_output[j * i_stride] = previous;
+	}
+	io_states[0] = state0;
+	io_states[1] = state1;
+	io_states[2] = state2;
+	io_states[3] = state3;
+	io_input = input;
+}
+
+// the chunk sizes and the tables were validated by DecompressSurface, the coded data is checked here
+static const bool DecompressChunks(const SurfaceData& i_surface, const u8* i_input, const u32 i_firstChunk, const u32 i_lastChunk)
+{
+	const u32 stride = i_surface.header->stride;
+	const u32 chunkSize = i_surface.header->chunkSize;
+	const bool isDelta = (i_surface.header->filter == (u8)SupercompressionFilter::Delta);
+
+	// 5KB, rebuilt for each plane of each chunk: cheap next to the thousands of symbols of a chunk plane
+	PlaneDecoder decoder;
+	const u8* chunkInput = i_input;
+	for (u32 c = i_firstChunk; c < i_lastChunk; c++)
+	{
+		u32 codedSize = 0;
+		memcpy(&codedSize, i_surface.chunkSizes + c * sizeof(u32), sizeof(u32));
+		const u8* input = chunkInput;
+		const u8* inputEnd = chunkInput + codedSize;
+		p8 output = i_surface.output + (size)c * chunkSize;
+		const size elementsCount = floral::min((size)chunkSize, i_surface.outputSize - (size)c * chunkSize) / stride;
+
+		u32 states[k_RansStatesCount];
+		memcpy(states, input, sizeof(states));
+		input += sizeof(states);
+		for (u32 plane = 0; plane < stride; plane++)
+		{
+			BuildPlaneDecoder(i_surface.tables[plane], &decoder);
+			if (isDelta)
+			{
+				DecodePlane<true>(states, input, inputEnd, decoder, elementsCount, stride, output + plane);
+			}
+			else
+			{
+				DecodePlane<false>(states, input, inputEnd, decoder, elementsCount, stride, output + plane);
+			}
+		}
+		if (input != inputEnd)
+		{
+			return false;
+		}
+		chunkInput += codedSize;
+	}
+	return true;
+}
+
+static refrain2::Task DecompressChunksTask(voidptr i_data)
+{
+	DecompressTaskData* data = (DecompressTaskData*)i_data;
+	data->result = DecompressChunks(*data->surface, data->input, data->firstChunk, data->lastChunk);
+	return refrain2::Task();
+}
+
+// ------------------------------------------------------------------
+
+const bool DecompressSurface(const u8* i_input, const size i_inputSize, p8 o_output, const size i_outputSize,
+		const bool i_useTasks)
+{
+	// the header, the tables and the chunk sizes come from the file, they are checked before anything is decoded
+	if (i_inputSize < sizeof(SupercompressionHeader))
+	{
+		return false;
+	}
+
+	const SupercompressionHeader* header = (const SupercompressionHeader*)i_input;
+	const u32 stride = header->stride;
+	const u32 chunkSize = header->chunkSize;
+	const u32 chunksCount = header->chunksCount;
+	if (stride == 0 || stride > k_MaxSupercompressionStride
+		|| chunkSize == 0 || chunkSize % stride != 0
+		|| chunksCount == 0
+		|| (size)chunkSize * chunksCount < i_outputSize
+		|| (size)chunkSize * (chunksCount - 1) >= i_outputSize
+		|| i_outputSize % stride != 0
+		|| header->tablesSize > i_inputSize - sizeof(SupercompressionHeader))
+	{
+		return false;
+	}
+
+	SurfaceData surface;
+	surface.header = header;
+	const u8* table = i_input + sizeof(SupercompressionHeader);
+	const u8* tablesEnd = table + header->tablesSize;
+	PlaneDecoder decoder;
+	for (u32 plane = 0; plane < stride; plane++)
+	{
+		if ((size)(tablesEnd - table) < k_TableMaskSize || (size)(tablesEnd - table) < GetTableSize(table))
+		{
+			return false;
+		}
+		if (!BuildPlaneDecoder(table, &decoder))
+		{
+			return false;
+		}
+		surface.tables[plane] = table;
+		table += GetTableSize(table);
+	}
+
+	surface.chunkSizes = tablesEnd;
+	surface.output = o_output;
+	surface.outputSize = i_outputSize;
+	const size chunksOffset = sizeof(SupercompressionHeader) + header->tablesSize + (size)chunksCount * sizeof(u32);
+	if (chunksOffset > i_inputSize)
+	{
+		return false;
+	}
+
+	// every chunk holds at least its rANS states
+	size chunksSize = 0;
+	for (u32 c = 0; c < chunksCount; c++)
+	{
+		u32 codedSize = 0;
+		memcpy(&codedSize, surface.chunkSizes + c * sizeof(u32), sizeof(u32));
+		if (codedSize < sizeof(u32) * k_RansStatesCount)
+		{
+			return false;
+		}
+		chunksSize += codedSize;
+	}
+	if (chunksSize > i_inputSize - chunksOffset)
+	{
+		return false;
+	}
+	const u8* chunks = i_input + chunksOffset;
+
+	const u32 chunksPerTask = floral::max(k_MinChunksPerTask, (chunksCount + k_MaxTasks - 1) / k_MaxTasks);
+	const u32 tasksCount = (chunksCount + chunksPerTask - 1) / chunksPerTask;
+	// offline tools and tests may not run the refrain2 workers
+	if (tasksCount <= 1 || !i_useTasks || refrain2::g_TaskManager == nullptr)
+	{
+		return DecompressChunks(surface, chunks, 0, chunksCount);
+	}
+
+	DecompressTaskData taskData[k_MaxTasks];
+	std::atomic<u32> counter(tasksCount);
+	const u8* input = chunks;
+	for (u32 i = 0; i < tasksCount; i++)
+	{
+		DecompressTaskData& data = taskData[i];
+		data.surface = &surface;
+		data.input = input;
+		data.firstChunk = i * chunksPerTask;
+		data.lastChunk = floral::min(data.firstChunk + chunksPerTask, chunksCount);
+		data.result = false;
+		for (u32 c = data.firstChunk; c < data.lastChunk; c++)
+		{
+			u32 codedSize = 0;
+			memcpy(&codedSize, surface.chunkSizes + c * sizeof(u32), sizeof(u32));
+			input += codedSize;
+		}
+
+		refrain2::Task newTask;
+		newTask.pm_Instruction = &DecompressChunksTask;
+		newTask.pm_Data = &data;
+		newTask.pm_Counter = &counter;
+		refrain2::g_TaskManager->PushTask(newTask);
+	}
+	refrain2::BusyWaitForCounter(counter, 0);
+
+	bool result = true;
+	for (u32 i = 0; i < tasksCount; i++)
+	{
+		result &= taskData[i].result;
+	}
+	return result;
+}
+
+// ------------------------------------------------------------------
+}
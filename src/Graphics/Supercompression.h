@@ -0,0 +1,48 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+
+namespace supercomp
+{
+// ------------------------------------------------------------------
+
+/*
+ * Decoder of the lossless layer texturebaker puts over the surfaces of a cbtex (--supercompression on),
+ * see texturebaker's Supercompression.h for the encoder. The output is the surface the way the gpu
+ * takes it, nothing is transcoded.
+ * - the surface is split in planes: byte k of every element (a compressed block, a pixel)
+ * - each plane is order 0 rANS coded, optionally delta filtered
+ * - the surface is cut in chunks that decode on their own
+ */
+#pragma pack(push)
+#pragma pack(1)
+struct SupercompressionHeader
+{
+	u8											stride;				// 1..16
+	u8											filter;				// SupercompressionFilter
+	u16											reserved;
+	u32											chunkSize;			// decoded bytes, a multiple of stride
+	u32											chunksCount;
+	u32											tablesSize;
+};
+#pragma pack(pop)
+
+enum class SupercompressionFilter : u8
+{
+	None = 0,
+	Delta										// byte - the same byte of the previous element in the chunk
+};
+
+static const u32								k_MaxSupercompressionStride = 16;
+
+/*
+ * Every few chunks is a refrain2 task, blocks until all of them are done. i_useTasks false decodes on
+ * the calling thread, for callers that already run in a refrain2 task, so does a missing task manager.
+ * Returns false for a corrupted surface (header, tables or chunk sizes not matching i_inputSize and
+ * i_outputSize, frequencies not adding up to the probability scale), o_output is then partly written.
+ */
+const bool										DecompressSurface(const u8* i_input, const size i_inputSize, p8 o_output, const size i_outputSize,
+													const bool i_useTasks);
+
+// ------------------------------------------------------------------
+}
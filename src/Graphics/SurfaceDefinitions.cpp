@@ -20,6 +20,8 @@ ssize GlyphSurface::index                       = -1;
 ssize SurfacePC::index							= -1;
 ssize SurfacePNC::index							= -1;
 ssize SurfacePNTT::index						= -1;
+ssize SurfacePNTTQ16::index						= -1;
+ssize SurfacePNTTQ8::index						= -1;
 ssize SurfacePNT::index							= -1;
 ssize SurfaceP::index							= -1;
 
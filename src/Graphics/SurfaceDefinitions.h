@@ -253,6 +253,93 @@ struct SurfacePNTT
 	}
 };
 
+/*
+ * VertexPNTT quantized by modelbaker (cbmodel::VertexFormat), all attributes are normalized integers:
+ * - position: offset + a_Position.xyz * scale, with the model's cbmodel::Quantization
+ * - normal, tangent: octahedral, n = vec3(e, 1 - |e.x| - |e.y|); when n.z < 0, n.xy = (1 - |n.yx|) * sign(n.xy)
+ * - texcoord: offset + a_TexCoord * scale
+ */
+struct VertexPNTTQ16
+{
+	u16											position[4];			// w is padding
+	s16											normal[2];
+	s16											tangent[2];
+	u16											texcoord[2];
+};
+
+struct SurfacePNTTQ16
+{
+	static ssize index;
+	static const u32 draw_calls_budget = 64u;
+	static const insigne::geometry_mode_e geometry_mode = insigne::geometry_mode_e::triangles;
+
+	static void setup_states()
+	{
+		using namespace insigne;
+		detail::set_blending<false_type>(blend_equation_e::func_add, factor_e::fact_src_alpha, factor_e::fact_one_minus_src_alpha);
+		detail::set_cull_face<true_type>(face_side_e::back_side, front_face_e::face_ccw);
+		detail::set_depth_test<true_type>(compare_func_e::func_less_or_equal);
+		detail::set_depth_write<true_type>();
+		detail::set_scissor_test<false_type>(0, 0, 0, 0);
+	}
+
+	static void describe_vertex_data()
+	{
+		using namespace insigne;
+
+		// vertex attributes
+		detail::enable_vertex_attrib(0);
+		detail::enable_vertex_attrib(1);
+		detail::enable_vertex_attrib(2);
+		detail::enable_vertex_attrib(3);
+		detail::describe_vertex_data(0, 3, data_type_e::elem_unsigned_short, true, sizeof(VertexPNTTQ16), (const voidptr)0);
+		detail::describe_vertex_data(1, 2, data_type_e::elem_signed_short, true, sizeof(VertexPNTTQ16), (const voidptr)8);
+		detail::describe_vertex_data(2, 2, data_type_e::elem_signed_short, true, sizeof(VertexPNTTQ16), (const voidptr)12);
+		detail::describe_vertex_data(3, 2, data_type_e::elem_unsigned_short, true, sizeof(VertexPNTTQ16), (const voidptr)16);
+	}
+};
+
+// same as VertexPNTTQ16 with 8 bits octahedral normals and tangents
+struct VertexPNTTQ8
+{
+	u16											position[4];			// w is padding
+	s8											normal[2];
+	s8											tangent[2];
+	u16											texcoord[2];
+};
+
+struct SurfacePNTTQ8
+{
+	static ssize index;
+	static const u32 draw_calls_budget = 64u;
+	static const insigne::geometry_mode_e geometry_mode = insigne::geometry_mode_e::triangles;
+
+	static void setup_states()
+	{
+		using namespace insigne;
+		detail::set_blending<false_type>(blend_equation_e::func_add, factor_e::fact_src_alpha, factor_e::fact_one_minus_src_alpha);
+		detail::set_cull_face<true_type>(face_side_e::back_side, front_face_e::face_ccw);
+		detail::set_depth_test<true_type>(compare_func_e::func_less_or_equal);
+		detail::set_depth_write<true_type>();
+		detail::set_scissor_test<false_type>(0, 0, 0, 0);
+	}
+
+	static void describe_vertex_data()
+	{
+		using namespace insigne;
+
+		// vertex attributes
+		detail::enable_vertex_attrib(0);
+		detail::enable_vertex_attrib(1);
+		detail::enable_vertex_attrib(2);
+		detail::enable_vertex_attrib(3);
+		detail::describe_vertex_data(0, 3, data_type_e::elem_unsigned_short, true, sizeof(VertexPNTTQ8), (const voidptr)0);
+		detail::describe_vertex_data(1, 2, data_type_e::elem_signed_byte, true, sizeof(VertexPNTTQ8), (const voidptr)8);
+		detail::describe_vertex_data(2, 2, data_type_e::elem_signed_byte, true, sizeof(VertexPNTTQ8), (const voidptr)10);
+		detail::describe_vertex_data(3, 2, data_type_e::elem_unsigned_short, true, sizeof(VertexPNTTQ8), (const voidptr)12);
+	}
+};
+
 struct VertexPNT
 {
 	floral::vec3f								position;
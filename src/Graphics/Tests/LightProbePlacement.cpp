@@ -135,7 +135,6 @@ void LightProbePlacement::OnInitialize()
 	m_Vertices.init(2048u, &g_StreammingAllocator);
 	m_Indices.init(8192u, &g_StreammingAllocator);
 	m_Patches.init(1024u, &g_StreammingAllocator);
-	m_ProbeLocations.init(2048u, &g_StreammingAllocator);
 
 	m_ProbeVertices.init(1024u, &g_StreammingAllocator);
 	m_ProbeIndices.init(4096u, &g_StreammingAllocator);
@@ -353,146 +352,31 @@ void LightProbePlacement::OnInitialize()
 
 void LightProbePlacement::DoScenePartition()
 {
-	m_Octants.init(8192u, &g_StreammingAllocator);
-	// find scene AABB
-	{
-		floral::vec3f minCorner(9999.9f, 9999.9f, 9999.9f);
-		floral::vec3f maxCorner(-9999.9f, -9999.9f, -9999.9f);
-
-		for (u32 i = 0; i < m_Vertices.get_size(); i++)
-		{
-			floral::vec3f v = m_Vertices[i].Position;
-			if (v.x < minCorner.x) minCorner.x = v.x;
-			if (v.y < minCorner.y) minCorner.y = v.y;
-			if (v.z < minCorner.z) minCorner.z = v.z;
-			if (v.x > maxCorner.x) maxCorner.x = v.x;
-			if (v.y > maxCorner.y) maxCorner.y = v.y;
-			if (v.z > maxCorner.z) maxCorner.z = v.z;
-		}
-		m_SceneAABB.min_corner = minCorner;
-		m_SceneAABB.max_corner = maxCorner;
-
-		floral::aabb3f extrapolateSceneAABB = m_SceneAABB;
-		extrapolateSceneAABB.min_corner = minCorner - floral::vec3f(0.1f);
-		extrapolateSceneAABB.max_corner = maxCorner + floral::vec3f(0.1f);
-
-		Partition(extrapolateSceneAABB);
-	}
+	lightprobe::OctreeBuildOptions options = lightprobe::GetDefaultOctreeBuildOptions();
+	options.minOctantSize = 0.8f;
+	options.rootPadding = 0.1f;
 
-	for (u32 i = 0; i < m_Octants.get_size(); i++)
 	{
-		floral::vec3f v[8];
-		v[0] = m_Octants[i].Geometry.min_corner;
-		v[6] = m_Octants[i].Geometry.max_corner;
-		v[1] = floral::vec3f(v[0].x, v[0].y, v[6].z);
-		v[2] = floral::vec3f(v[6].x, v[0].y, v[6].z);
-		v[3] = floral::vec3f(v[6].x, v[0].y, v[0].z);
-
-		v[4] = floral::vec3f(v[0].x, v[6].y, v[0].z);
-		v[5] = floral::vec3f(v[0].x, v[6].y, v[6].z);
-		v[7] = floral::vec3f(v[6].x, v[6].y, v[0].z);
-
-		for (u32 j = 0; j < 8; j++)
-		{
-			if (floral::point_inside_aabb(v[j], m_SceneAABB))
-			{
-				if (m_ProbeLocations.find(v[j]) == m_ProbeLocations.get_terminated_index())
-					m_ProbeLocations.push_back(v[j]);
-			}
-		}
+		const size scratchSize = lightprobe::GetOctreeScratchSize(m_Indices.get_size() / 3, options);
+		FreelistArena* scratchArena = g_StreammingAllocator.allocate_arena<FreelistArena>(scratchSize);
+		m_Octree = lightprobe::BuildOctree(&m_Vertices[0].Position, sizeof(VertexPNC), m_Vertices.get_size(),
+				&m_Indices[0], m_Indices.get_size(), options, m_MemoryArena, scratchArena);
+		g_StreammingAllocator.free(scratchArena);
 	}
-}
 
-const bool LightProbePlacement::CanStopPartition(floral::aabb3f& i_rootOctant)
-{
-	if (IsOctantTooSmall(i_rootOctant))
-		return true;
-
-	if (IsOctantHasTriangles(i_rootOctant, 0))
-		return false;
-	return true;
-}
-
-const bool LightProbePlacement::IsOctantTooSmall(floral::aabb3f& i_rootOctant)
-{
-	if (i_rootOctant.max_corner.x - i_rootOctant.min_corner.x < 0.8f)
-		return true;
-	return false;
-}
-
-const bool LightProbePlacement::IsOctantHasTriangles(floral::aabb3f& i_rootOctant, const u32 i_threshold)
-{
-	u32 triangleInside = 0;
-	for (u32 i = 0; i < m_Indices.get_size(); i += 3)
+	// every leaf can contribute its 8 corners, both the result and its staging buffer are sized for that
+	const u32 maxLocations = lightprobe::GetMaxProbeLocationsCount(m_Octree);
+	m_ProbeLocations.init(floral::max(maxLocations, 1u), &g_StreammingAllocator);
 	{
-		floral::vec3f v0 = m_Vertices[m_Indices[i]].Position;
-		floral::vec3f v1 = m_Vertices[m_Indices[i + 1]].Position;
-		floral::vec3f v2 = m_Vertices[m_Indices[i + 2]].Position;
-
-		if (triangle_aabb_intersect(v0, v1, v2, i_rootOctant))
+		const size scratchSize = lightprobe::GetProbeExtractionScratchSize(m_Octree) + sizeof(floral::vec3f) * maxLocations;
+		FreelistArena* scratchArena = g_StreammingAllocator.allocate_arena<FreelistArena>(scratchSize);
+		floral::vec3f* locations = scratchArena->allocate_array<floral::vec3f>(floral::max(maxLocations, 1u));
+		const u32 locationsCount = lightprobe::ExtractProbeLocations(m_Octree, locations, maxLocations, scratchArena);
+		for (u32 i = 0; i < locationsCount; i++)
 		{
-			triangleInside++;
+			m_ProbeLocations.push_back(locations[i]);
 		}
-
-		if (triangleInside > i_threshold)
-		{
-			return true;
-		}
-	}
-	return false;
-}
-
-void LightProbePlacement::Partition(floral::aabb3f& i_rootOctant)
-{
-	if (CanStopPartition(i_rootOctant))
-		return;
-
-	floral::vec3f v[8];
-	v[0] = i_rootOctant.min_corner;
-	v[6] = i_rootOctant.max_corner;
-	v[1] = floral::vec3f(v[0].x, v[0].y, v[6].z);
-	v[2] = floral::vec3f(v[6].x, v[0].y, v[6].z);
-	v[3] = floral::vec3f(v[6].x, v[0].y, v[0].z);
-
-	v[4] = floral::vec3f(v[0].x, v[6].y, v[0].z);
-	v[5] = floral::vec3f(v[0].x, v[6].y, v[6].z);
-	v[7] = floral::vec3f(v[6].x, v[6].y, v[0].z);
-
-	floral::aabb3f octants[8];
-
-	octants[0].min_corner = v[0];
-	octants[0].max_corner = (v[0] + v[6]) / 2.0f;
-
-	octants[1].min_corner = (v[0] + v[1]) / 2.0f;
-	octants[1].max_corner = (v[1] + v[6]) / 2.0f;
-
-	octants[2].min_corner = (v[0] + v[3]) / 2.0f;
-	octants[2].max_corner = (v[3] + v[6]) / 2.0f;
-
-	octants[3].min_corner = (v[0] + v[2]) / 2.0f;
-	octants[3].max_corner = (v[2] + v[6]) / 2.0f;
-
-	octants[4].min_corner = (v[0] + v[4]) / 2.0f;
-	octants[4].max_corner = (v[4] + v[6]) / 2.0f;
-
-	octants[5].min_corner = (v[0] + v[5]) / 2.0f;
-	octants[5].max_corner = (v[5] + v[6]) / 2.0f;
-
-	octants[6].min_corner = (v[0] + v[6]) / 2.0f;
-	octants[6].max_corner = v[6];
-
-	octants[7].min_corner = (v[0] + v[7]) / 2.0f;
-	octants[7].max_corner = (v[6] + v[7]) / 2.0f;
-
-	for (u32 i = 0; i < 8; i++)
-	{
-		if (IsOctantTooSmall(octants[i]))
-		{
-			const bool hasTri = IsOctantHasTriangles(octants[i], 0);
-			if (hasTri)
-				m_Octants.push_back({octants[i], true, true});
-		}
-		Partition(octants[i]);
+		g_StreammingAllocator.free(scratchArena);
 	}
 }
 
@@ -510,9 +394,16 @@ void LightProbePlacement::OnUpdate(const f32 i_deltaMs)
 
 	if (m_DrawOctree)
 	{
-		for (u32 i = 0; i < m_Octants.get_size(); i++)
+		for (u32 i = 0; i < m_Octree.nodesCount; i++)
 		{
-			m_DebugDrawer.DrawAABB3D(m_Octants[i].Geometry, floral::vec4f(1.0f, 0.0f, 0.0f, 1.0f));
+			const lightprobe::OctreeNode& node = m_Octree.nodes[i];
+			if (node.firstChild == 0 && node.trianglesCount > 0)
+			{
+				floral::aabb3f octant;
+				octant.min_corner = node.minCorner;
+				octant.max_corner = node.maxCorner;
+				m_DebugDrawer.DrawAABB3D(octant, floral::vec4f(1.0f, 0.0f, 0.0f, 1.0f));
+			}
 		}
 	}
 
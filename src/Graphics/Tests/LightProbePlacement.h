@@ -10,6 +10,7 @@
 #include "Graphics/SurfaceDefinitions.h"
 #include "Graphics/DebugDrawer.h"
 #include "Graphics/FreeCamera.h"
+#include "Graphics/LightProbeOctree.h"
 
 namespace stone
 {
@@ -32,10 +33,6 @@ public:
 
 private:
 	void										DoScenePartition();
-	const bool									CanStopPartition(floral::aabb3f& i_rootOctant);
-	const bool									IsOctantTooSmall(floral::aabb3f& i_rootOctant);
-	const bool									IsOctantHasTriangles(floral::aabb3f& i_rootOctant, const u32 i_threshold);
-	void										Partition(floral::aabb3f& i_rootOctant);
 
 	void										ExportSHData();
 
@@ -54,14 +51,7 @@ private:
 	floral::fixed_array<u32, LinearAllocator>		m_ProbeIndices;
 	floral::fixed_array<SHProbeData, LinearAllocator>		m_SHData;
 
-	floral::aabb3f								m_SceneAABB;
-	struct Octant
-	{
-		floral::aabb3f							Geometry;
-		bool									IsLeaf;
-		bool									HasTriangle;
-	};
-	floral::fixed_array<Octant, LinearAllocator>	m_Octants;
+	lightprobe::Octree							m_Octree;
 	floral::fixed_array<floral::vec3f, LinearAllocator>	m_ProbeLocations;
 
 	struct SceneData {
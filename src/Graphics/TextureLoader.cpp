@@ -1,11 +1,15 @@
 #include "TextureLoader.h"
 
+#include <string.h>
+
 #include <floral/assert/assert.h>
 
 #include <insigne/ut_textures.h>
 
 #include "Graphics/stb_image.h"
 #include "Graphics/stb_image_resize.h"
+#include "Graphics/Supercompression.h"
+#include "Graphics/FileMapping.h"
 
 namespace tex_loader
 {
@@ -70,5 +74,341 @@ const insigne::texture_handle_t LoadLDRTexture2D(const floral::path& i_path, ins
 	return insigne::create_texture(io_desc);
 }
 
+// ----------------------------------------------------------------------------
+
+const insigne::texture_handle_t MapCBTexture(const floral::path& i_path, insigne::texture_desc_t& io_desc, MappedCBTexture* o_mapping, const bool i_loadMipmaps /* = false */)
+{
+	o_mapping->mappedData = nullptr;
+	o_mapping->mappedSize = 0;
+	o_mapping->uploadFrameIdx = 0;
+
+	size fileSize = 0;
+	p8 fileData = (p8)file_mapping::MapFile(i_path.pm_PathStr, &fileSize);
+	if (fileData == nullptr)
+	{
+		FLORAL_ASSERT_MSG(false, "Cannot map the texture file");
+		return insigne::texture_handle_t();
+	}
+
+	if (internal::GetTextureFileVersion(fileData, fileSize) != internal::TextureFileVersion::V2)
+	{
+		file_mapping::UnmapFile(fileData, fileSize);
+		FLORAL_ASSERT_MSG(false, "Only valid v2 cbtex files can be mapped");
+		return insigne::texture_handle_t();
+	}
+
+	const TextureFileHeader* fileHeader = (const TextureFileHeader*)fileData;
+	const SurfaceEntry* surfaces = (const SurfaceEntry*)(fileData + sizeof(TextureFileHeader));
+	internal::FillTextureDesc(fileHeader->header, io_desc);
+	io_desc.has_mipmap = i_loadMipmaps;
+
+	// the surfaces insigne wants are one block of the payload most of the time
+	const u32 mipsCount = i_loadMipmaps ? fileHeader->header.mipsCount : 1;
+	bool contiguous = true;
+	u64 nextOffset = surfaces[0].offset;
+	for (u32 face = 0; face < fileHeader->facesCount && contiguous; face++)
+	{
+		for (u32 mip = 0; mip < mipsCount; mip++)
+		{
+			const SurfaceEntry& surface = surfaces[face * fileHeader->header.mipsCount + mip];
+			if (surface.offset != nextOffset || surface.compressedSize != surface.size)
+			{
+				contiguous = false;
+				break;
+			}
+			nextOffset += surface.size;
+		}
+	}
+
+	if (!contiguous)
+	{
+		insigne::prepare_texture_desc(io_desc);
+		internal::CopySurfacesV2(fileData, io_desc, io_desc.data);
+		file_mapping::UnmapFile(fileData, fileSize);
+		return insigne::create_texture(io_desc);
+	}
+
+	io_desc.data = fileData + fileHeader->payloadOffset + surfaces[0].offset;
+	o_mapping->mappedData = fileData;
+	o_mapping->mappedSize = fileSize;
+	o_mapping->uploadFrameIdx = insigne::get_current_frame_idx();
+	return insigne::create_texture(io_desc);
+}
+
+const bool IsCBTextureUploaded(const MappedCBTexture& i_mapping)
+{
+	return insigne::get_current_frame_idx() > i_mapping.uploadFrameIdx + internal::k_UploadFramesLatency;
+}
+
+void UnmapCBTexture(MappedCBTexture* io_mapping)
+{
+	if (io_mapping->mappedData)
+	{
+		file_mapping::UnmapFile(io_mapping->mappedData, io_mapping->mappedSize);
+	}
+	io_mapping->mappedData = nullptr;
+	io_mapping->mappedSize = 0;
+}
+
+namespace internal
+{
+// ----------------------------------------------------------------------------
+
+void FillTextureDesc(const TextureHeader& i_header, insigne::texture_desc_t& io_desc)
+{
+	io_desc.width = i_header.resolution;
+	io_desc.height = i_header.resolution;
+
+	if (i_header.colorRange == ColorRange::LDR)
+	{
+		switch (i_header.compression)
+		{
+		case Compression::DXT:
+		{
+			io_desc.compression = insigne::texture_compression_e::dxt;
+			FLORAL_ASSERT(i_header.colorSpace == ColorSpace::Linear);
+			FLORAL_ASSERT(i_header.encodedGamma == 1.0f);
+			switch (i_header.colorChannel)
+			{
+				case ColorChannel::RGB:
+					io_desc.format = insigne::texture_format_e::rgb;
+					break;
+				case ColorChannel::RGBA:
+					io_desc.format = insigne::texture_format_e::rgba;
+					break;
+				default:
+					FLORAL_ASSERT(false);
+					break;
+			}
+			break;
+		}
+
+		case Compression::ETC:
+		{
+			io_desc.compression = insigne::texture_compression_e::etc;
+			switch (i_header.colorChannel)
+			{
+				case ColorChannel::RGB:
+					io_desc.format = insigne::texture_format_e::rgb;
+					break;
+				case ColorChannel::RGBA:
+					io_desc.format = insigne::texture_format_e::rgba;
+					break;
+				default:
+					FLORAL_ASSERT(false);
+					break;
+			}
+			break;
+		}
+
+		case Compression::NoCompress:
+		{
+			io_desc.compression = insigne::texture_compression_e::no_compression;
+			if (i_header.colorSpace == ColorSpace::Linear)
+			{
+				FLORAL_ASSERT(i_header.encodedGamma == 1.0f);
+				switch (i_header.colorChannel)
+				{
+					case ColorChannel::RG:
+						io_desc.format = insigne::texture_format_e::rg;
+						break;
+					case ColorChannel::RGB:
+						io_desc.format = insigne::texture_format_e::rgb;
+						break;
+					case ColorChannel::RGBA:
+						io_desc.format = insigne::texture_format_e::rgba;
+						break;
+					default:
+						FLORAL_ASSERT(false);
+						break;
+				}
+			}
+			else if (i_header.colorSpace == ColorSpace::GammaCorrected)
+			{
+				FLORAL_ASSERT(i_header.encodedGamma < 1.0f);
+				switch (i_header.colorChannel)
+				{
+					case ColorChannel::RGB:
+						io_desc.format = insigne::texture_format_e::srgb;
+						break;
+					case ColorChannel::RGBA:
+						io_desc.format = insigne::texture_format_e::srgba;
+						break;
+					default:
+						FLORAL_ASSERT(false);
+						break;
+				}
+			}
+			else
+			{
+				FLORAL_ASSERT(false);
+			}
+			break;
+		}
+
+		case Compression::BC6H:
+		case Compression::BC7:
+		case Compression::ASTC:
+			// baked by texturebaker, insigne cannot upload them yet
+			FLORAL_ASSERT_MSG(false, "BPTC and ASTC textures are not supported by the renderer");
+			break;
+
+		default:
+			FLORAL_ASSERT(false);
+			break;
+		}
+
+	}
+	else // hdr
+	{
+		FLORAL_ASSERT(i_header.colorSpace == ColorSpace::Linear);
+		FLORAL_ASSERT(i_header.colorSpace == ColorSpace::Linear);
+		FLORAL_ASSERT(i_header.colorChannel == ColorChannel::RGB);
+		switch (i_header.compression)
+		{
+		case Compression::DXT:
+		{
+			io_desc.compression = insigne::texture_compression_e::dxt;
+			io_desc.format = insigne::texture_format_e::rgba;
+			break;
+		}
+
+		case Compression::ETC:
+		{
+			io_desc.compression = insigne::texture_compression_e::etc;
+			io_desc.format = insigne::texture_format_e::rgba;
+			break;
+		}
+
+		case Compression::NoCompress:
+		{
+			FLORAL_ASSERT(i_header.encodedGamma == 1.0f);
+			io_desc.compression = insigne::texture_compression_e::no_compression;
+			switch (i_header.colorChannel)
+			{
+				case ColorChannel::RGB:
+					io_desc.format = insigne::texture_format_e::hdr_rgb;
+					break;
+				case ColorChannel::RGBA:
+					io_desc.format = insigne::texture_format_e::hdr_rgba;
+					break;
+				default:
+					FLORAL_ASSERT(false);
+					break;
+			}
+			break;
+		}
+
+		case Compression::BC6H:
+		case Compression::BC7:
+		case Compression::ASTC:
+			// baked by texturebaker, insigne cannot upload them yet
+			FLORAL_ASSERT_MSG(false, "BPTC and ASTC textures are not supported by the renderer");
+			break;
+
+		default:
+			FLORAL_ASSERT(false);
+			break;
+		}
+	}
+
+	switch (i_header.textureType)
+	{
+	case Type::Texture2D:
+		io_desc.dimension = insigne::texture_dimension_e::tex_2d;
+		break;
+	case Type::CubeMap:
+	case Type::PMREM:
+		io_desc.dimension = insigne::texture_dimension_e::tex_cube;
+		break;
+	default:
+		FLORAL_ASSERT(false);
+		break;
+	}
+}
+
+const TextureFileVersion GetTextureFileVersion(const voidptr i_fileData, const size i_fileSize)
+{
+	if (i_fileSize < 4 || memcmp(i_fileData, "CBTX", 4) != 0)
+	{
+		return i_fileSize < sizeof(TextureHeader) ? TextureFileVersion::Invalid : TextureFileVersion::V1;
+	}
+
+	if (i_fileSize < sizeof(TextureFileHeader))
+	{
+		return TextureFileVersion::Invalid;
+	}
+
+	const TextureFileHeader* fileHeader = (const TextureFileHeader*)i_fileData;
+	if (fileHeader->version != k_TextureFileVersion)
+	{
+		return TextureFileVersion::Invalid;
+	}
+
+	// 6 faces and 32 mips at most, the product cannot overflow
+	if (fileHeader->facesCount == 0 || fileHeader->facesCount > 6
+		|| fileHeader->header.mipsCount == 0 || fileHeader->header.mipsCount > 32
+		|| fileHeader->surfacesCount != fileHeader->facesCount * fileHeader->header.mipsCount)
+	{
+		return TextureFileVersion::Invalid;
+	}
+
+	const size directoryEnd = sizeof(TextureFileHeader) + (size)fileHeader->surfacesCount * sizeof(SurfaceEntry);
+	if (directoryEnd > fileHeader->payloadOffset
+		|| fileHeader->payloadOffset > i_fileSize
+		|| fileHeader->payloadSize > i_fileSize - fileHeader->payloadOffset)
+	{
+		return TextureFileVersion::Invalid;
+	}
+
+	const SurfaceEntry* surfaces = (const SurfaceEntry*)((p8)i_fileData + sizeof(TextureFileHeader));
+	for (u32 i = 0; i < fileHeader->surfacesCount; i++)
+	{
+		const SurfaceEntry& surface = surfaces[i];
+		if (surface.offset > fileHeader->payloadSize
+			|| surface.compressedSize > fileHeader->payloadSize - surface.offset)
+		{
+			return TextureFileVersion::Invalid;
+		}
+	}
+
+	return TextureFileVersion::V2;
+}
+
+const size CopySurfacesV2(const p8 i_fileData, const insigne::texture_desc_t& i_desc, voidptr o_data)
+{
+	const TextureFileHeader* fileHeader = (const TextureFileHeader*)i_fileData;
+	const SurfaceEntry* surfaces = (const SurfaceEntry*)(i_fileData + sizeof(TextureFileHeader));
+	const p8 payload = i_fileData + fileHeader->payloadOffset;
+	const u32 mipsCount = i_desc.has_mipmap ? fileHeader->header.mipsCount : 1;
+
+	p8 output = (p8)o_data;
+	for (u32 face = 0; face < fileHeader->facesCount; face++)
+	{
+		for (u32 mip = 0; mip < mipsCount; mip++)
+		{
+			const SurfaceEntry& surface = surfaces[face * fileHeader->header.mipsCount + mip];
+			if (surface.compressedSize != surface.size)
+			{
+				if (!supercomp::DecompressSurface(payload + surface.offset, (size)surface.compressedSize, output, (size)surface.size, true))
+				{
+					// a black surface rather than garbage
+					FLORAL_ASSERT_MSG(false, "Corrupted supercompressed surface");
+					memset(output, 0, surface.size);
+				}
+			}
+			else
+			{
+				memcpy(output, payload + surface.offset, surface.size);
+			}
+			output += surface.size;
+		}
+	}
+	return (size)(output - (p8)o_data);
+}
+
+// ----------------------------------------------------------------------------
+}
+
 // ----------------------------------------------------------------------------
 }
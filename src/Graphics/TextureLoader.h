@@ -45,7 +45,10 @@ enum class Compression
 {
 	NoCompress = 0,
 	DXT,										// auto choose dxt1 for rgb / dxt5 for rgba
-	ETC
+	ETC,
+	BC6H,
+	BC7,
+	ASTC										// 4x4 blocks
 };
 
 // -------------------------------------------------------------------
@@ -63,8 +66,42 @@ struct TextureHeader
 	u32											resolution;
 	Compression									compression;
 };
+
+/*
+ * v2 container:
+ * - TextureFileHeader
+ * - SurfaceEntry x surfacesCount, surface index = face * mipsCount + mip
+ * - padding up to payloadOffset, a multiple of payloadAlignment (16, or 4096 for mapping)
+ * - the payload: every surface packed in surface index order, which is the layout insigne uploads
+ *   from, so a mapped payload can be handed to insigne as is
+ * v1 files are a TextureHeader followed by the surfaces, they don't start with the magic.
+ */
+struct TextureFileHeader
+{
+	c8											magicCharacters[4];		// "CBTX"
+	u32											version;
+	TextureHeader								header;
+	u32											facesCount;
+	u32											surfacesCount;
+	u32											payloadAlignment;
+	u64											payloadOffset;			// from the start of the file
+	u64											payloadSize;			// stored bytes
+};
+
+struct SurfaceEntry
+{
+	u32											face;
+	u32											mip;
+	u32											width;
+	u32											height;
+	u64											offset;					// from payloadOffset
+	u64											size;					// bytes uploaded to the gpu
+	u64											compressedSize;			// bytes stored in the file, == size when stored as is, see Supercompression.h
+};
 #pragma pack(pop)
 
+static const u32								k_TextureFileVersion = 2;
+
 // ----------------------------------------------------------------------------
 
 template <class TIOAllocator>
@@ -73,6 +110,23 @@ const insigne::texture_handle_t					LoadCBTexture(const floral::path& i_path, in
 template <class TFileSystem, class TIOAllocator>
 const insigne::texture_handle_t					LoadCBTexture(TFileSystem* i_fs, const floral::relative_path& i_path, insigne::texture_desc_t& io_desc, TIOAllocator* i_ioAllocator, const bool i_loadMipmaps = false);
 
+/*
+ * v2 files only: maps the file and hands the payload straight to insigne, nothing is read nor copied.
+ * insigne uploads the texture a few frames later so the mapping has to stay alive until then,
+ * see IsCBTextureUploaded. Falls back to a copy (and unmaps right away) when the surfaces to upload
+ * are not contiguous in the file, e.g. a cubemap loaded without its mipmaps, or supercompressed.
+ */
+struct MappedCBTexture
+{
+	voidptr										mappedData;
+	size										mappedSize;
+	u64											uploadFrameIdx;
+};
+
+const insigne::texture_handle_t					MapCBTexture(const floral::path& i_path, insigne::texture_desc_t& io_desc, MappedCBTexture* o_mapping, const bool i_loadMipmaps = false);
+const bool										IsCBTextureUploaded(const MappedCBTexture& i_mapping);
+void											UnmapCBTexture(MappedCBTexture* io_mapping);
+
 // LDR TGA texture only, use stb_image and stb_image_resize, slow
 const insigne::texture_handle_t					LoadLDRTexture2D(const floral::path& i_path, insigne::texture_desc_t& io_desc, const bool i_createMipmaps = false);
 const insigne::texture_handle_t					LoadLDRTextureCube(const floral::path& i_path, insigne::texture_desc_t& io_desc, const bool i_createMipmaps = false);
@@ -93,6 +147,29 @@ namespace internal
 {
 // ----------------------------------------------------------------------------
 
+// size, format, compression and dimension of io_desc from a cbtex header, the data is left alone
+void											FillTextureDesc(const TextureHeader& i_header, insigne::texture_desc_t& io_desc);
+
+enum class TextureFileVersion
+{
+	V1 = 0,										// no magic, a TextureHeader followed by the surfaces
+	V2,
+	Invalid										// too small for a header, or a "CBTX" file with an unknown version or a broken directory
+};
+
+// v2 files are validated up to every surface entry lying inside the payload, nothing is checked for v1
+const TextureFileVersion						GetTextureFileVersion(const voidptr i_fileData, const size i_fileSize);
+
+/*
+ * Copies the surfaces of a v2 file that insigne expects (mip 0 of each face when io_desc has no mipmap)
+ * into o_data, in upload order, supercompressed ones are decoded on the refrain2 workers. Returns the
+ * bytes written.
+ */
+const size										CopySurfacesV2(const p8 i_fileData, const insigne::texture_desc_t& i_desc, voidptr o_data);
+
+// insigne keeps this many frames of commands in flight before the upload of a new texture is done
+static const u64								k_UploadFramesLatency = 2;
+
 // ----------------------------------------------------------------------------
 }
 
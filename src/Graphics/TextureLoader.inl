@@ -2,6 +2,7 @@
 
 #include <insigne/ut_textures.h>
 
+#include <floral/assert/assert.h>
 #include <floral/io/nativeio.h>
 
 namespace tex_loader
@@ -18,146 +19,34 @@ const insigne::texture_handle_t LoadCBTexture(const floral::path& i_path, insign
 	floral::read_all_file(inp, dataStream);
 	floral::close_file(inp);
 
-	TextureHeader header;
-	dataStream.read(&header);
-
-	io_desc.width = header.resolution;
-	io_desc.height = header.resolution;
-
-	if (header.colorRange == ColorRange::LDR)
+	const internal::TextureFileVersion fileVersion = internal::GetTextureFileVersion(dataStream.buffer, inp.file_size);
+	if (fileVersion == internal::TextureFileVersion::Invalid)
 	{
-		switch (header.compression)
-		{
-		case Compression::DXT:
-		{
-			io_desc.compression = insigne::texture_compression_e::dxt;
-			FLORAL_ASSERT(header.colorSpace == ColorSpace::Linear);
-			FLORAL_ASSERT(header.encodedGamma == 1.0f);
-			switch (header.colorChannel)
-			{
-				case ColorChannel::RGB:
-					io_desc.format = insigne::texture_format_e::rgb;
-					break;
-				case ColorChannel::RGBA:
-					io_desc.format = insigne::texture_format_e::rgba;
-					break;
-				default:
-					FLORAL_ASSERT(false);
-					break;
-			}
-			break;
-		}
-
-		case Compression::NoCompress:
-		{
-			io_desc.compression = insigne::texture_compression_e::no_compression;
-			if (header.colorSpace == ColorSpace::Linear)
-			{
-				FLORAL_ASSERT(header.encodedGamma == 1.0f);
-				switch (header.colorChannel)
-				{
-					case ColorChannel::RG:
-						io_desc.format = insigne::texture_format_e::rg;
-						break;
-					case ColorChannel::RGB:
-						io_desc.format = insigne::texture_format_e::rgb;
-						break;
-					case ColorChannel::RGBA:
-						io_desc.format = insigne::texture_format_e::rgba;
-						break;
-					default:
-						FLORAL_ASSERT(false);
-						break;
-				}
-			}
-			else if (header.colorSpace == ColorSpace::GammaCorrected)
-			{
-				FLORAL_ASSERT(header.encodedGamma < 1.0f);
-				switch (header.colorChannel)
-				{
-					case ColorChannel::RGB:
-						io_desc.format = insigne::texture_format_e::srgb;
-						break;
-					case ColorChannel::RGBA:
-						io_desc.format = insigne::texture_format_e::srgba;
-						break;
-					default:
-						FLORAL_ASSERT(false);
-						break;
-				}
-			}
-			else
-			{
-				FLORAL_ASSERT(false);
-			}
-			break;
-		}
-
-		default:
-			FLORAL_ASSERT(false);
-			break;
-		}
-
+		// a broken v2 file must not be read as a v1 one
+		FLORAL_ASSERT_MSG(false, "Unknown cbtex version or corrupted cbtex file");
+		i_ioAllocator->free(dataStream.buffer);
+		return insigne::texture_handle_t();
 	}
-	else // hdr
-	{
-		FLORAL_ASSERT(header.colorSpace == ColorSpace::Linear);
-		FLORAL_ASSERT(header.colorSpace == ColorSpace::Linear);
-		FLORAL_ASSERT(header.colorChannel == ColorChannel::RGB);
-		switch (header.compression)
-		{
-		case Compression::DXT:
-		{
-			io_desc.compression = insigne::texture_compression_e::dxt;
-			io_desc.format = insigne::texture_format_e::rgba;
-			break;
-		}
-
-		case Compression::NoCompress:
-		{
-			FLORAL_ASSERT(header.encodedGamma == 1.0f);
-			io_desc.compression = insigne::texture_compression_e::no_compression;
-			switch (header.colorChannel)
-			{
-				case ColorChannel::RGB:
-					io_desc.format = insigne::texture_format_e::hdr_rgb;
-					break;
-				case ColorChannel::RGBA:
-					io_desc.format = insigne::texture_format_e::hdr_rgba;
-					break;
-				default:
-					FLORAL_ASSERT(false);
-					break;
-			}
-			break;
-		}
 
-		default:
-			FLORAL_ASSERT(false);
-			break;
-		}
+	if (fileVersion == internal::TextureFileVersion::V2)
+	{
+		// the directory gives every surface, no need to walk the file
+		const TextureFileHeader* fileHeader = (const TextureFileHeader*)dataStream.buffer;
+		internal::FillTextureDesc(fileHeader->header, io_desc);
+		io_desc.has_mipmap = i_loadMipmaps;
+		insigne::prepare_texture_desc(io_desc);
+		internal::CopySurfacesV2(dataStream.buffer, io_desc, io_desc.data);
 	}
-
-	switch (header.textureType)
+	else
 	{
-	case Type::Texture2D:
-		io_desc.dimension = insigne::texture_dimension_e::tex_2d;
-		break;
-	case Type::CubeMap:
-	case Type::PMREM:
-		io_desc.dimension = insigne::texture_dimension_e::tex_cube;
-		break;
-	default:
-		FLORAL_ASSERT(false);
-		break;
+		TextureHeader header;
+		dataStream.read(&header);
+		internal::FillTextureDesc(header, io_desc);
+		io_desc.has_mipmap = i_loadMipmaps;
+		const size dataSize = insigne::prepare_texture_desc(io_desc);
+		dataStream.read_bytes(io_desc.data, dataSize);
 	}
 
-	io_desc.has_mipmap = i_loadMipmaps;
-
-	const size dataSize = insigne::prepare_texture_desc(io_desc);
-
-	dataStream.read_bytes(io_desc.data, dataSize);
-
 	i_ioAllocator->free(dataStream.buffer);
 
 	return insigne::create_texture(io_desc);
@@ -173,171 +62,34 @@ const insigne::texture_handle_t LoadCBTexture(TFileSystem* i_fs, const floral::r
 	floral::read_all_file(inp, dataStream);
 	floral::close_file(inp);
 
-	TextureHeader header;
-	dataStream.read(&header);
-
-	io_desc.width = header.resolution;
-	io_desc.height = header.resolution;
-
-	if (header.colorRange == ColorRange::LDR)
+	const internal::TextureFileVersion fileVersion = internal::GetTextureFileVersion(dataStream.buffer, inp.file_size);
+	if (fileVersion == internal::TextureFileVersion::Invalid)
 	{
-		switch (header.compression)
-		{
-		case Compression::DXT:
-		{
-			io_desc.compression = insigne::texture_compression_e::dxt;
-			FLORAL_ASSERT(header.colorSpace == ColorSpace::Linear);
-			FLORAL_ASSERT(header.encodedGamma == 1.0f);
-			switch (header.colorChannel)
-			{
-				case ColorChannel::RGB:
-					io_desc.format = insigne::texture_format_e::rgb;
-					break;
-				case ColorChannel::RGBA:
-					io_desc.format = insigne::texture_format_e::rgba;
-					break;
-				default:
-					FLORAL_ASSERT(false);
-					break;
-			}
-			break;
-		}
-
-		case Compression::ETC:
-		{
-			io_desc.compression = insigne::texture_compression_e::etc;
-			switch (header.colorChannel)
-			{
-				case ColorChannel::RGB:
-					io_desc.format = insigne::texture_format_e::rgb;
-					break;
-				case ColorChannel::RGBA:
-					io_desc.format = insigne::texture_format_e::rgba;
-					break;
-				default:
-					FLORAL_ASSERT(false);
-					break;
-			}
-			break;
-		}
-
-		case Compression::NoCompress:
-		{
-			io_desc.compression = insigne::texture_compression_e::no_compression;
-			if (header.colorSpace == ColorSpace::Linear)
-			{
-				FLORAL_ASSERT(header.encodedGamma == 1.0f);
-				switch (header.colorChannel)
-				{
-					case ColorChannel::RG:
-						io_desc.format = insigne::texture_format_e::rg;
-						break;
-					case ColorChannel::RGB:
-						io_desc.format = insigne::texture_format_e::rgb;
-						break;
-					case ColorChannel::RGBA:
-						io_desc.format = insigne::texture_format_e::rgba;
-						break;
-					default:
-						FLORAL_ASSERT(false);
-						break;
-				}
-			}
-			else if (header.colorSpace == ColorSpace::GammaCorrected)
-			{
-				FLORAL_ASSERT(header.encodedGamma < 1.0f);
-				switch (header.colorChannel)
-				{
-					case ColorChannel::RGB:
-						io_desc.format = insigne::texture_format_e::srgb;
-						break;
-					case ColorChannel::RGBA:
-						io_desc.format = insigne::texture_format_e::srgba;
-						break;
-					default:
-						FLORAL_ASSERT(false);
-						break;
-				}
-			}
-			else
-			{
-				FLORAL_ASSERT(false);
-			}
-			break;
-		}
-
-		default:
-			FLORAL_ASSERT(false);
-			break;
-		}
-
+		// a broken v2 file must not be read as a v1 one
+		FLORAL_ASSERT_MSG(false, "Unknown cbtex version or corrupted cbtex file");
+		i_ioAllocator->free(dataStream.buffer);
+		return insigne::texture_handle_t();
 	}
-	else // hdr
-	{
-		FLORAL_ASSERT(header.colorSpace == ColorSpace::Linear);
-		FLORAL_ASSERT(header.colorSpace == ColorSpace::Linear);
-		FLORAL_ASSERT(header.colorChannel == ColorChannel::RGB);
-		switch (header.compression)
-		{
-		case Compression::DXT:
-		{
-			io_desc.compression = insigne::texture_compression_e::dxt;
-			io_desc.format = insigne::texture_format_e::rgba;
-			break;
-		}
-
-		case Compression::ETC:
-		{
-			io_desc.compression = insigne::texture_compression_e::etc;
-			io_desc.format = insigne::texture_format_e::rgba;
-			break;
-		}
 
-		case Compression::NoCompress:
-		{
-			FLORAL_ASSERT(header.encodedGamma == 1.0f);
-			io_desc.compression = insigne::texture_compression_e::no_compression;
-			switch (header.colorChannel)
-			{
-				case ColorChannel::RGB:
-					io_desc.format = insigne::texture_format_e::hdr_rgb;
-					break;
-				case ColorChannel::RGBA:
-					io_desc.format = insigne::texture_format_e::hdr_rgba;
-					break;
-				default:
-					FLORAL_ASSERT(false);
-					break;
-			}
-			break;
-		}
-
-		default:
-			FLORAL_ASSERT(false);
-			break;
-		}
+	if (fileVersion == internal::TextureFileVersion::V2)
+	{
+		// the directory gives every surface, no need to walk the file
+		const TextureFileHeader* fileHeader = (const TextureFileHeader*)dataStream.buffer;
+		internal::FillTextureDesc(fileHeader->header, io_desc);
+		io_desc.has_mipmap = i_loadMipmaps;
+		insigne::prepare_texture_desc(io_desc);
+		internal::CopySurfacesV2(dataStream.buffer, io_desc, io_desc.data);
 	}
-
-	switch (header.textureType)
+	else
 	{
-	case Type::Texture2D:
-		io_desc.dimension = insigne::texture_dimension_e::tex_2d;
-		break;
-	case Type::CubeMap:
-	case Type::PMREM:
-		io_desc.dimension = insigne::texture_dimension_e::tex_cube;
-		break;
-	default:
-		FLORAL_ASSERT(false);
-		break;
+		TextureHeader header;
+		dataStream.read(&header);
+		internal::FillTextureDesc(header, io_desc);
+		io_desc.has_mipmap = i_loadMipmaps;
+		const size dataSize = insigne::prepare_texture_desc(io_desc);
+		dataStream.read_bytes(io_desc.data, dataSize);
 	}
 
-	io_desc.has_mipmap = i_loadMipmaps;
-
-	const size dataSize = insigne::prepare_texture_desc(io_desc);
-
-	dataStream.read_bytes(io_desc.data, dataSize);
-
 	i_ioAllocator->free(dataStream.buffer);
 
 	return insigne::create_texture(io_desc);
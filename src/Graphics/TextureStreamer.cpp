@@ -0,0 +1,582 @@
+#include "TextureStreamer.h"
+
+#include <string.h>
+
+#include <floral/assert/assert.h>
+#include <floral/math/utils.h>
+
+#include <insigne/system.h>
+#include <insigne/ut_render.h>
+#include <insigne/ut_textures.h>
+
+#include <refrain2.h>
+
+#include "Graphics/Supercompression.h"
+#include "Graphics/FileMapping.h"
+
+namespace tex_loader
+{
+// ----------------------------------------------------------------------------
+
+static const bool IsBlockCompressed(const TextureHeader& i_header)
+{
+	return i_header.compression != Compression::NoCompress;
+}
+
+// bytes per block of compressed surfaces, per pixel otherwise
+static const u32 GetElementSize(const TextureHeader& i_header)
+{
+	if (IsBlockCompressed(i_header))
+	{
+		if (i_header.colorRange == ColorRange::HDR || i_header.colorChannel == ColorChannel::RGBA)
+		{
+			return 16;
+		}
+		return 8;
+	}
+
+	u32 channelsCount = 0;
+	switch (i_header.colorChannel)
+	{
+	case ColorChannel::R:
+		channelsCount = 1;
+		break;
+	case ColorChannel::RG:
+		channelsCount = 2;
+		break;
+	case ColorChannel::RGB:
+		channelsCount = 3;
+		break;
+	case ColorChannel::RGBA:
+		channelsCount = 4;
+		break;
+	default:
+		FLORAL_ASSERT(false);
+		break;
+	}
+	// hdr pixels are half floats
+	return i_header.colorRange == ColorRange::HDR ? channelsCount * 2 : channelsCount;
+}
+
+// target pixel (x, y) of a 4x4 block takes the index of source pixel (i_sx[x], i_sy[y])
+static const u32 ExpandColorIndices(const u32 i_indices, const u32* i_sx, const u32* i_sy)
+{
+	u32 indices = 0;
+	for (u32 y = 0; y < 4; y++)
+	{
+		for (u32 x = 0; x < 4; x++)
+		{
+			const u32 index = (i_indices >> (2 * (i_sy[y] * 4 + i_sx[x]))) & 0x3;
+			indices |= index << (2 * (y * 4 + x));
+		}
+	}
+	return indices;
+}
+
+static void ExpandAlphaIndices(const u8* i_indices, const u32* i_sx, const u32* i_sy, u8* o_indices)
+{
+	u64 input = 0;
+	for (u32 i = 0; i < 6; i++)
+	{
+		input |= (u64)i_indices[i] << (8 * i);
+	}
+	u64 output = 0;
+	for (u32 y = 0; y < 4; y++)
+	{
+		for (u32 x = 0; x < 4; x++)
+		{
+			const u64 index = (input >> (3 * (i_sy[y] * 4 + i_sx[x]))) & 0x7;
+			output |= index << (3 * (y * 4 + x));
+		}
+	}
+	for (u32 i = 0; i < 6; i++)
+	{
+		o_indices[i] = (u8)(output >> (8 * i));
+	}
+}
+
+/*
+ * Nearest upsampling of the surface of mip i_srcMip into mip i_srcMip - i_levels. Works on the blocks for
+ * compressed surfaces: a target block always falls in a single source block, dxt keeps its endpoints and
+ * gets its indices from the covered source pixels, other formats repeat the source block.
+ */
+static void ExpandSurface(const TextureHeader& i_header, const u8* i_src, const u32 i_srcWidth,
+		p8 o_dst, const u32 i_dstWidth, const u32 i_levels)
+{
+	const u32 elementSize = GetElementSize(i_header);
+	const u32 blockSize = IsBlockCompressed(i_header) ? 4 : 1;
+	const u32 srcElements = (i_srcWidth + blockSize - 1) / blockSize;
+	const u32 dstElements = (i_dstWidth + blockSize - 1) / blockSize;
+	const bool isDXT = (i_header.compression == Compression::DXT);
+
+	for (u32 ey = 0; ey < dstElements; ey++)
+	{
+		const u32 sey = floral::min(ey >> i_levels, srcElements - 1);
+		u32 sy[4];
+		for (u32 y = 0; y < 4; y++)
+		{
+			sy[y] = ((ey * 4 + y) >> i_levels) & 0x3;
+		}
+
+		for (u32 ex = 0; ex < dstElements; ex++)
+		{
+			const u32 sex = floral::min(ex >> i_levels, srcElements - 1);
+			const u8* srcElement = i_src + (sey * srcElements + sex) * elementSize;
+			p8 dstElement = o_dst + (ey * dstElements + ex) * elementSize;
+			memcpy(dstElement, srcElement, elementSize);
+
+			if (isDXT)
+			{
+				u32 sx[4];
+				for (u32 x = 0; x < 4; x++)
+				{
+					sx[x] = ((ex * 4 + x) >> i_levels) & 0x3;
+				}
+
+				// dxt5: 8 bytes of alpha (2 endpoints, 16 x 3 bits indices) before the color block
+				p8 colorBlock = dstElement;
+				if (elementSize == 16)
+				{
+					ExpandAlphaIndices(srcElement + 2, sx, sy, dstElement + 2);
+					colorBlock += 8;
+				}
+				u32 indices = 0;
+				memcpy(&indices, colorBlock + 4, sizeof(u32));
+				indices = ExpandColorIndices(indices, sx, sy);
+				memcpy(colorBlock + 4, &indices, sizeof(u32));
+			}
+		}
+	}
+}
+
+// the surfaces of mips [i_firstMip, mipsCount) come from the file, the ones above are upsampled from i_firstMip
+static void FillChain(const StreamedTexture& i_texture, const p8 i_fileData, const u32 i_firstMip, p8 o_data,
+		const bool i_useTasks)
+{
+	const u32 mipsCount = i_texture.header.mipsCount;
+	const p8 payload = i_fileData + i_texture.payloadOffset;
+
+	p8 faceData = o_data;
+	for (u32 face = 0; face < i_texture.facesCount; face++)
+	{
+		const SurfaceEntry* surfaces = &i_texture.surfaces[face * mipsCount];
+		p8 firstMipData = faceData;
+		for (u32 mip = 0; mip < i_firstMip; mip++)
+		{
+			firstMipData += surfaces[mip].size;
+		}
+
+		p8 output = firstMipData;
+		for (u32 mip = i_firstMip; mip < mipsCount; mip++)
+		{
+			const SurfaceEntry& surface = surfaces[mip];
+			if (surface.compressedSize != surface.size)
+			{
+				if (!supercomp::DecompressSurface(payload + surface.offset, (size)surface.compressedSize, output, (size)surface.size, i_useTasks))
+				{
+					// a black surface rather than garbage
+					FLORAL_ASSERT_MSG(false, "Corrupted supercompressed surface");
+					memset(output, 0, surface.size);
+				}
+			}
+			else
+			{
+				memcpy(output, payload + surface.offset, surface.size);
+			}
+			output += surface.size;
+		}
+
+		output = faceData;
+		for (u32 mip = 0; mip < i_firstMip; mip++)
+		{
+			ExpandSurface(i_texture.header, firstMipData, surfaces[i_firstMip].width, output, surfaces[mip].width, i_firstMip - mip);
+			output += surfaces[mip].size;
+		}
+
+		faceData += i_texture.chainSize / i_texture.facesCount;
+	}
+}
+
+// bytes of the mips above the tail when the texture is resident from i_mip
+static const size GetStreamedSize(const StreamedTexture& i_texture, const u32 i_mip)
+{
+	size streamedSize = 0;
+	for (u32 face = 0; face < i_texture.facesCount; face++)
+	{
+		for (u32 mip = i_mip; mip < i_texture.tailMip; mip++)
+		{
+			streamedSize += (size)i_texture.surfaces[face * i_texture.header.mipsCount + mip].size;
+		}
+	}
+	return streamedSize;
+}
+
+static refrain2::Task StreamTexture(voidptr i_data)
+{
+	StreamRequest* request = (StreamRequest*)i_data;
+	const StreamedTexture& texture = *request->texture;
+
+	size fileSize = 0;
+	p8 fileData = (p8)file_mapping::MapFile(texture.path.pm_PathStr, &fileSize, false);
+	if (fileData == nullptr)
+	{
+		request->failed = true;
+		return refrain2::Task();
+	}
+
+	FillChain(texture, fileData, request->mip, request->data, false);
+	file_mapping::UnmapFile(fileData, fileSize);
+	return refrain2::Task();
+}
+
+static void IssueRequest(TextureStreamer* io_streamer, StreamedTexture* io_texture, const u32 i_mip)
+{
+	for (u32 i = 0; i < k_MaxStreamRequests; i++)
+	{
+		StreamRequest& request = io_streamer->requests[i];
+		if (request.texture != nullptr)
+		{
+			continue;
+		}
+
+		request.texture = io_texture;
+		request.mip = i_mip;
+		request.data = (p8)io_streamer->arena->allocate(io_texture->chainSize);
+		request.failed = false;
+		request.uploading = false;
+		request.uploadFrameIdx = 0;
+		request.counter.store(1);
+		io_texture->requestIdx = (s32)i;
+
+		refrain2::Task newTask;
+		newTask.pm_Instruction = &StreamTexture;
+		newTask.pm_Data = &request;
+		newTask.pm_Counter = &request.counter;
+		refrain2::g_TaskManager->PushTask(newTask);
+		return;
+	}
+	FLORAL_ASSERT_MSG(false, "No free stream request");
+}
+
+// insigne reads the chain a few frames after copy_update_texture
+static const bool IsUploadDone(const StreamRequest& i_request)
+{
+	return insigne::get_current_frame_idx() > i_request.uploadFrameIdx + internal::k_UploadFramesLatency;
+}
+
+static const u32 GetFreeRequestsCount(const TextureStreamer& i_streamer)
+{
+	u32 freeRequestsCount = 0;
+	for (u32 i = 0; i < k_MaxStreamRequests; i++)
+	{
+		if (i_streamer.requests[i].texture == nullptr)
+		{
+			freeRequestsCount++;
+		}
+	}
+	return freeRequestsCount;
+}
+
+// ----------------------------------------------------------------------------
+
+void InitializeTextureStreamer(TextureStreamer* o_streamer, stone::FreelistArena* i_arena,
+		const u32 i_maxTexturesCount, const size i_budget, const u32 i_tailResolution /* = 64 */)
+{
+	o_streamer->arena = i_arena;
+	o_streamer->textures = i_arena->allocate_array<StreamedTexture>(i_maxTexturesCount);
+	o_streamer->texturesCount = 0;
+	o_streamer->maxTexturesCount = i_maxTexturesCount;
+	o_streamer->tailResolution = i_tailResolution;
+	o_streamer->order = i_arena->allocate_array<u32>(i_maxTexturesCount);
+	for (u32 i = 0; i < k_MaxStreamRequests; i++)
+	{
+		StreamRequest& request = o_streamer->requests[i];
+		request.texture = nullptr;
+		request.data = nullptr;
+		request.counter.store(0);
+	}
+	o_streamer->budget = i_budget;
+	o_streamer->residentSize = 0;
+}
+
+void CleanUpTextureStreamer(TextureStreamer* io_streamer)
+{
+	// the frames will not move on from here, flush insigne's commands once if an upload may still read its chain
+	bool uploadsInFlight = false;
+	for (u32 i = 0; i < k_MaxStreamRequests; i++)
+	{
+		const StreamRequest& request = io_streamer->requests[i];
+		if (request.texture != nullptr && request.uploading && !IsUploadDone(request))
+		{
+			uploadsInFlight = true;
+		}
+	}
+
+	if (uploadsInFlight)
+	{
+		insigne::dispatch_render_pass();
+		insigne::wait_finish_dispatching();
+	}
+
+	for (u32 i = 0; i < k_MaxStreamRequests; i++)
+	{
+		StreamRequest& request = io_streamer->requests[i];
+		if (request.texture != nullptr)
+		{
+			refrain2::BusyWaitForCounter(request.counter, 0);
+			io_streamer->arena->free(request.data);
+			request.texture = nullptr;
+			request.data = nullptr;
+		}
+	}
+
+	for (u32 i = 0; i < io_streamer->texturesCount; i++)
+	{
+		io_streamer->arena->free(io_streamer->textures[i].surfaces);
+	}
+	io_streamer->arena->free(io_streamer->order);
+	io_streamer->arena->free(io_streamer->textures);
+	io_streamer->textures = nullptr;
+	io_streamer->order = nullptr;
+	io_streamer->texturesCount = 0;
+	io_streamer->residentSize = 0;
+}
+
+const streamed_texture_handle_t RegisterStreamedTexture(TextureStreamer* io_streamer, const floral::path& i_path,
+		insigne::texture_desc_t& io_desc)
+{
+	FLORAL_ASSERT(io_streamer->texturesCount < io_streamer->maxTexturesCount);
+
+	size fileSize = 0;
+	p8 fileData = (p8)file_mapping::MapFile(i_path.pm_PathStr, &fileSize, false);
+	if (fileData == nullptr)
+	{
+		FLORAL_ASSERT_MSG(false, "Cannot map the texture file");
+		return -1;
+	}
+
+	if (internal::GetTextureFileVersion(fileData, fileSize) != internal::TextureFileVersion::V2)
+	{
+		file_mapping::UnmapFile(fileData, fileSize);
+		FLORAL_ASSERT_MSG(false, "Only valid v2 cbtex files can be streamed");
+		return -1;
+	}
+
+	const TextureFileHeader* fileHeader = (const TextureFileHeader*)fileData;
+	StreamedTexture& texture = io_streamer->textures[io_streamer->texturesCount];
+	texture.path = i_path;
+	texture.header = fileHeader->header;
+	texture.facesCount = fileHeader->facesCount;
+	texture.payloadOffset = fileHeader->payloadOffset;
+	texture.surfaces = io_streamer->arena->allocate_array<SurfaceEntry>(fileHeader->surfacesCount);
+	memcpy(texture.surfaces, fileData + sizeof(TextureFileHeader), fileHeader->surfacesCount * sizeof(SurfaceEntry));
+
+	const u32 mipsCount = texture.header.mipsCount;
+	u32 tailMip = 0;
+	while (tailMip + 1 < mipsCount && texture.surfaces[tailMip].width > io_streamer->tailResolution)
+	{
+		tailMip++;
+	}
+	texture.tailMip = tailMip;
+	texture.residentMip = tailMip;
+	texture.requestedMip = tailMip;
+	texture.targetMip = tailMip;
+	texture.requestIdx = -1;
+	texture.failed = false;
+
+	internal::FillTextureDesc(texture.header, io_desc);
+	io_desc.has_mipmap = (mipsCount > 1);
+	texture.chainSize = insigne::prepare_texture_desc(io_desc);
+	size surfacesSize = 0;
+	for (u32 i = 0; i < fileHeader->surfacesCount; i++)
+	{
+		surfacesSize += (size)texture.surfaces[i].size;
+	}
+	FLORAL_ASSERT(surfacesSize == texture.chainSize);
+	FillChain(texture, fileData, tailMip, (p8)io_desc.data, true);
+	file_mapping::UnmapFile(fileData, fileSize);
+
+	texture.desc = io_desc;
+	texture.desc.data = nullptr;
+	texture.texture = insigne::create_texture(io_desc);
+	return (streamed_texture_handle_t)io_streamer->texturesCount++;
+}
+
+const insigne::texture_handle_t GetStreamedTexture(const TextureStreamer& i_streamer, const streamed_texture_handle_t i_handle)
+{
+	FLORAL_ASSERT(i_handle >= 0 && (u32)i_handle < i_streamer.texturesCount);
+	return i_streamer.textures[i_handle].texture;
+}
+
+const u32 GetResidentMip(const TextureStreamer& i_streamer, const streamed_texture_handle_t i_handle)
+{
+	FLORAL_ASSERT(i_handle >= 0 && (u32)i_handle < i_streamer.texturesCount);
+	return i_streamer.textures[i_handle].residentMip;
+}
+
+void RequestStreamedMip(TextureStreamer* io_streamer, const streamed_texture_handle_t i_handle, const u32 i_mip)
+{
+	FLORAL_ASSERT(i_handle >= 0 && (u32)i_handle < io_streamer->texturesCount);
+	StreamedTexture& texture = io_streamer->textures[i_handle];
+	texture.requestedMip = floral::min(i_mip, texture.tailMip);
+}
+
+void SetTextureStreamerBudget(TextureStreamer* io_streamer, const size i_budget)
+{
+	io_streamer->budget = i_budget;
+}
+
+void UpdateTextureStreamer(TextureStreamer* io_streamer)
+{
+	// 1- finished requests
+	for (u32 i = 0; i < k_MaxStreamRequests; i++)
+	{
+		StreamRequest& request = io_streamer->requests[i];
+		if (request.texture == nullptr)
+		{
+			continue;
+		}
+
+		if (request.uploading)
+		{
+			if (IsUploadDone(request))
+			{
+				io_streamer->arena->free(request.data);
+				request.data = nullptr;
+				request.texture = nullptr;
+			}
+			continue;
+		}
+
+		if (!refrain2::CheckForCounter(request.counter, 0))
+		{
+			continue;
+		}
+
+		StreamedTexture& texture = *request.texture;
+		texture.requestIdx = -1;
+		if (request.failed)
+		{
+			// no more requests for it, the file would fail again every frame
+			FLORAL_ASSERT_MSG(false, "Cannot stream the texture file");
+			texture.failed = true;
+			io_streamer->arena->free(request.data);
+			request.data = nullptr;
+			request.texture = nullptr;
+			continue;
+		}
+
+		io_streamer->residentSize -= GetStreamedSize(texture, texture.residentMip);
+		io_streamer->residentSize += GetStreamedSize(texture, request.mip);
+		texture.residentMip = request.mip;
+		insigne::copy_update_texture(texture.texture, request.data, texture.chainSize);
+		request.uploading = true;
+		request.uploadFrameIdx = insigne::get_current_frame_idx();
+	}
+
+	// 2- priorities: the most detailed requests first, insertion sort as there are few textures
+	u32* order = io_streamer->order;
+	for (u32 i = 0; i < io_streamer->texturesCount; i++)
+	{
+		u32 j = i;
+		while (j > 0 && io_streamer->textures[order[j - 1]].requestedMip > io_streamer->textures[i].requestedMip)
+		{
+			order[j] = order[j - 1];
+			j--;
+		}
+		order[j] = i;
+	}
+
+	// 3- residency that fits in the budget, in priority order
+	size budgetLeft = io_streamer->budget;
+	for (u32 i = 0; i < io_streamer->texturesCount; i++)
+	{
+		StreamedTexture& texture = io_streamer->textures[order[i]];
+		if (texture.failed)
+		{
+			const size pinnedSize = GetStreamedSize(texture, texture.residentMip);
+			budgetLeft -= floral::min(pinnedSize, budgetLeft);
+			texture.targetMip = texture.residentMip;
+			continue;
+		}
+
+		u32 targetMip = texture.requestedMip;
+		while (targetMip < texture.tailMip && GetStreamedSize(texture, targetMip) > budgetLeft)
+		{
+			targetMip++;
+		}
+		budgetLeft -= GetStreamedSize(texture, targetMip);
+		texture.targetMip = targetMip;
+	}
+
+	// 4- evictions first, they make room for the next frames
+	u32 freeRequestsCount = GetFreeRequestsCount(*io_streamer);
+	for (u32 i = io_streamer->texturesCount; i > 0 && freeRequestsCount > 0; i--)
+	{
+		StreamedTexture& texture = io_streamer->textures[order[i - 1]];
+		if (texture.requestIdx < 0 && texture.targetMip > texture.residentMip)
+		{
+			IssueRequest(io_streamer, &texture, texture.targetMip);
+			freeRequestsCount--;
+		}
+	}
+
+	// bytes held once every request in flight lands, evictions only count when they are done
+	size committedSize = io_streamer->residentSize;
+	for (u32 i = 0; i < k_MaxStreamRequests; i++)
+	{
+		const StreamRequest& request = io_streamer->requests[i];
+		if (request.texture != nullptr && !request.uploading && request.mip < request.texture->residentMip)
+		{
+			committedSize += GetStreamedSize(*request.texture, request.mip) - GetStreamedSize(*request.texture, request.texture->residentMip);
+		}
+	}
+
+	for (u32 i = 0; i < io_streamer->texturesCount && freeRequestsCount > 0; i++)
+	{
+		StreamedTexture& texture = io_streamer->textures[order[i]];
+		if (texture.requestIdx >= 0 || texture.targetMip >= texture.residentMip)
+		{
+			continue;
+		}
+
+		const size extraSize = GetStreamedSize(texture, texture.targetMip) - GetStreamedSize(texture, texture.residentMip);
+		if (committedSize + extraSize > io_streamer->budget)
+		{
+			// wait for the evictions, less detailed requests must not pass this one
+			break;
+		}
+		IssueRequest(io_streamer, &texture, texture.targetMip);
+		committedSize += extraSize;
+		freeRequestsCount--;
+	}
+}
+
+const TextureStreamerStats GetTextureStreamerStats(const TextureStreamer& i_streamer)
+{
+	TextureStreamerStats stats;
+	stats.budget = i_streamer.budget;
+	stats.residentSize = i_streamer.residentSize;
+	stats.tailsSize = 0;
+	stats.texturesCount = i_streamer.texturesCount;
+	stats.requestsInFlight = k_MaxStreamRequests - GetFreeRequestsCount(i_streamer);
+	stats.texturesBelowRequest = 0;
+	stats.texturesFailed = 0;
+	for (u32 i = 0; i < i_streamer.texturesCount; i++)
+	{
+		const StreamedTexture& texture = i_streamer.textures[i];
+		stats.tailsSize += texture.chainSize - GetStreamedSize(texture, 0);
+		if (texture.residentMip > texture.requestedMip)
+		{
+			stats.texturesBelowRequest++;
+		}
+		if (texture.failed)
+		{
+			stats.texturesFailed++;
+		}
+	}
+	return stats;
+}
+
+// ----------------------------------------------------------------------------
+}
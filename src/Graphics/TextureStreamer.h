@@ -0,0 +1,116 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+#include <floral/io/filesystem.h>
+
+#include <insigne/commons.h>
+
+#include <atomic>
+
+#include "Memory/MemorySystem.h"
+#include "Graphics/TextureLoader.h"
+
+namespace tex_loader
+{
+// ----------------------------------------------------------------------------
+
+/*
+ * Mip streaming of v2 cbtex files.
+ * - registering a texture only reads its mip tail (the mips up to i_tailResolution), the mips above are
+ *   filled from the tail so the texture can be used right away: load time is bounded by the smallest mips
+ * - every frame the textures tell which mip they need (RequestStreamedMip, e.g. from their size on screen),
+ *   the most detailed requests are served first and the streamed bytes are kept under the budget by
+ *   dropping the mips of the least detailed ones
+ * - the file is read (and the surfaces decoded) on a refrain2 task, the main thread only uploads
+ *
+ * insigne can neither upload a single mip nor free a texture, so the gpu texture is created with the
+ * full chain once and every change of residency uploads the whole chain: mips that are not resident are
+ * nearest upsampled from the top resident one.
+ */
+struct StreamedTexture
+{
+	floral::path								path;
+	TextureHeader								header;
+	u32											facesCount;
+	u64											payloadOffset;
+	SurfaceEntry*								surfaces;				// face * mipsCount + mip
+	insigne::texture_desc_t						desc;
+	insigne::texture_handle_t					texture;
+	size										chainSize;				// bytes of one upload
+
+	u32											tailMip;				// [tailMip, mipsCount) are always resident
+	u32											residentMip;
+	u32											requestedMip;
+	u32											targetMip;				// what fits in the budget
+	s32											requestIdx;				// -1 when no request is in flight
+	bool										failed;					// the file could not be read, pinned to residentMip
+};
+
+struct StreamRequest
+{
+	StreamedTexture*							texture;
+	u32											mip;					// the texture is resident from this mip once done
+	p8											data;					// the whole chain, chainSize bytes
+	bool										failed;
+	bool										uploading;
+	u64											uploadFrameIdx;
+	std::atomic<u32>							counter;				// 0 once the refrain2 task is done
+};
+
+static const u32								k_MaxStreamRequests = 4;
+
+struct TextureStreamer
+{
+	stone::FreelistArena*						arena;
+	StreamedTexture*							textures;
+	u32											texturesCount;
+	u32											maxTexturesCount;
+	u32											tailResolution;
+	u32*										order;					// textures by priority, scratch of UpdateTextureStreamer
+
+	StreamRequest								requests[k_MaxStreamRequests];
+	size										budget;					// streamed bytes above the tails
+	size										residentSize;
+};
+
+struct TextureStreamerStats
+{
+	size										budget;
+	size										residentSize;
+	size										tailsSize;
+	u32											texturesCount;
+	u32											requestsInFlight;
+	u32											texturesBelowRequest;	// resident mip is less detailed than requested
+	u32											texturesFailed;
+};
+
+typedef s32										streamed_texture_handle_t;
+
+// ----------------------------------------------------------------------------
+
+// the staging chains are allocated from i_arena, up to k_MaxStreamRequests of them at once
+void											InitializeTextureStreamer(TextureStreamer* o_streamer, stone::FreelistArena* i_arena,
+													const u32 i_maxTexturesCount, const size i_budget, const u32 i_tailResolution = 64);
+// waits for the requests in flight and for insigne to consume the recent uploads (their chains are freed here),
+// the insigne textures are left to the caller's resource cleanup
+void											CleanUpTextureStreamer(TextureStreamer* io_streamer);
+
+/*
+ * Reads the header and the mip tail of the file then creates the texture with the full mip chain.
+ * io_desc gives the filtering and wrapping, the rest is filled from the file.
+ */
+const streamed_texture_handle_t					RegisterStreamedTexture(TextureStreamer* io_streamer, const floral::path& i_path,
+													insigne::texture_desc_t& io_desc);
+const insigne::texture_handle_t					GetStreamedTexture(const TextureStreamer& i_streamer, const streamed_texture_handle_t i_handle);
+const u32										GetResidentMip(const TextureStreamer& i_streamer, const streamed_texture_handle_t i_handle);
+
+// the most detailed mip the texture needs, 0 is the full resolution
+void											RequestStreamedMip(TextureStreamer* io_streamer, const streamed_texture_handle_t i_handle, const u32 i_mip);
+void											SetTextureStreamerBudget(TextureStreamer* io_streamer, const size i_budget);
+
+// once per frame on the main thread: uploads the finished requests and issues new ones
+void											UpdateTextureStreamer(TextureStreamer* io_streamer);
+const TextureStreamerStats						GetTextureStreamerStats(const TextureStreamer& i_streamer);
+
+// ----------------------------------------------------------------------------
+}
@@ -2,6 +2,8 @@
 
 #include <math.h>
 
+#include <thread>
+
 #include <floral/containers/fast_array.h>
 #include <floral/comgeo/shapegen.h>
 #include <floral/math/transform.h>
@@ -22,7 +24,7 @@
 #include "Graphics/stb_image.h"
 #include "Graphics/stb_image_resize.h"
 #include "Graphics/stb_image_write.h"
-#include "Graphics/stb_dxt.h"
+#include "Graphics/DXTCompressor.h"
 #include "Graphics/etc2comp/Etc/Etc.h"
 #include "Graphics/prt.h"
 #include "Graphics/SurfaceDefinitions.h"
@@ -205,19 +207,33 @@ void convert_to_rgbm(f32* i_inpData, p8 o_rgbmData, const s32 i_width, const s32
 }
 
 //--------------------------------------------------------------------
+// etc2comp effort presets: fast, normal (etc2comp's default) and best
+enum class ETCEffort
+{
+	Fast = 0,
+	Normal,
+	Best
+};
+
+static const f32 k_ETCEffortLevels[] = { 10.0f, 40.0f, 90.0f };
+
+// source pixels fed to etc2comp at once, 8 MB of f32 rgba
+static const s32 k_ETCMaxStripPixels = 512 * 1024;
+
 template <class TAllocator>
-p8 compress_etc2(p8 i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels, size* o_compressedSize, TAllocator* i_allocator)
+p8 compress_etc2(p8 i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels, const ETCEffort i_effort,
+		size* o_compressedSize, TAllocator* i_allocator)
 {
 	Etc::Image::Format dstFormat;
-	u32 expectedSize = 0;
+	size bytesPerBlock = 0;
 	if (i_numChannels == 3)
 	{
-		expectedSize = ceil((f32)i_width / 4.0f) * ceil((f32)i_height / 4.0f) * 8;
+		bytesPerBlock = 8;
 		dstFormat = Etc::Image::Format::RGB8;
 	}
 	else if (i_numChannels == 4)
 	{
-		expectedSize = ceil((f32)i_width / 4.0f) * ceil((f32)i_height / 4.0f) * 16;
+		bytesPerBlock = 16;
 		dstFormat = Etc::Image::Format::RGBA8;
 	}
 	else
@@ -225,102 +241,61 @@ p8 compress_etc2(p8 i_input, const s32 i_width, const s32 i_height, const s32 i_
 		FLORAL_ASSERT(false);
 	}
 
-	f32 effort = 90.0f;
-	Etc::ErrorMetric errorMetric = Etc::ErrorMetric::RGBX;
+	const f32 effort = k_ETCEffortLevels[(s32)i_effort];
+	const Etc::ErrorMetric errorMetric = Etc::ErrorMetric::RGBX;
+	const u32 jobsCount = floral::max((u32)std::thread::hardware_concurrency(), 1u);
+
+	const size compressedSize = (size)((i_width + 3) / 4) * ((i_height + 3) / 4) * bytesPerBlock;
+	p8 output = (p8)i_allocator->allocate(compressedSize);
+
+	// etc2comp keeps a f32 copy and a few hundred bytes of state per block, feed it strips of block rows
+	const s32 extendedWidth = (i_width + 3) & ~3;
+	const s32 stripRows = floral::min(floral::max((k_ETCMaxStripPixels / extendedWidth) & ~3, 4), (i_height + 3) & ~3);
 
-	size pixelsCount = i_width * i_height;
 	// etc2comp always expect alpha channel
-	f32* floatImgData = (f32*)i_allocator->allocate(pixelsCount * 4 * sizeof(f32));
-	for (size p = 0; p < pixelsCount; p++)
+	f32* floatImgData = (f32*)i_allocator->allocate((size)i_width * stripRows * 4 * sizeof(f32));
+	p8 targetData = output;
+	for (s32 y = 0; y < i_height; y += stripRows)
 	{
-		floatImgData[p * 4 + 3] = 1.0f; // fill default alpha = 1.0f
-		for (s32 comp = 0; comp < i_numChannels; comp++)
+		const s32 rowsCount = floral::min(stripRows, i_height - y);
+		const size pixelsCount = (size)i_width * rowsCount;
+		const p8 sourceData = &i_input[(size)y * i_width * i_numChannels];
+		for (size p = 0; p < pixelsCount; p++)
 		{
-			floatImgData[p * 4 + comp] = (f32)i_input[p * i_numChannels + comp] / 255.0f;
+			floatImgData[p * 4 + 3] = 1.0f; // fill default alpha = 1.0f
+			for (s32 comp = 0; comp < i_numChannels; comp++)
+			{
+				floatImgData[p * 4 + comp] = (f32)sourceData[p * i_numChannels + comp] / 255.0f;
+			}
 		}
+
+		p8 dstImage = nullptr;
+		u32 encodedBitBytes = 0;
+		u32 encodedWidth = 0;
+		u32 encodedHeight = 0;
+		s32 encodingTime = 0;
+		Etc::Encode(floatImgData, i_width, rowsCount, dstFormat, errorMetric, effort, jobsCount, jobsCount, &dstImage,
+				&encodedBitBytes, &encodedWidth, &encodedHeight, &encodingTime, false);
+		FLORAL_ASSERT(encodedBitBytes == (size)((i_width + 3) / 4) * ((rowsCount + 3) / 4) * bytesPerBlock);
+
+		// blocks are stored row by row, so strips are simply appended
+		memcpy(targetData, dstImage, encodedBitBytes);
+		targetData += encodedBitBytes;
+		delete[] dstImage;
 	}
 
-	p8 dstImage = nullptr;
-	u32 encodedBitBytes = 0;
-	u32 extendedWidth = 0;
-	u32 extendedHeight = 0;
-	s32 encodingTime = 0;
-	Etc::Encode(floatImgData, i_width, i_height, dstFormat, errorMetric, effort, 4, 4, &dstImage,
-			&encodedBitBytes, &extendedWidth, &extendedHeight, &encodingTime, true);
-	FLORAL_ASSERT(encodedBitBytes == expectedSize);
-	*o_compressedSize = encodedBitBytes;
 	i_allocator->free(floatImgData);
-	return dstImage;
+	*o_compressedSize = compressedSize;
+	return output;
 }
 
 template <class TAllocator>
 p8 compress_dxt(p8 i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels, size* o_compressedSize, TAllocator* i_allocator)
 {
-	// 1 block = 4x4 pixels (with uncompressed size of 64 bytes for rgba textures)
-	size bytesPerBlock = 0;
-	size compressedSize = 0;
-	const size pixelsCount = i_width * i_height;
-
-	if (i_numChannels == 4)
-	{
-		// dxt5
-		bytesPerBlock = 16;
-		compressedSize = floral::max(pixelsCount, 16ull);
-	}
-	else
-	{
-		// dxt1 (only 1 bit for alpha)
-		bytesPerBlock = 8;
-		compressedSize = floral::max(pixelsCount / 2, 8ull);
-	}
-
+	// 4 channels: dxt5, otherwise dxt1 (only 1 bit for alpha)
+	const size compressedSize = dxt::GetDXTCompressedSize(i_width, i_height, i_numChannels);
 	p8 output = (p8)i_allocator->allocate(compressedSize);
-	p8 targetBlock = output;
-
-	for (s32 y = 0; y < i_height; y += 4)
-	{
-		for (s32 x = 0; x < i_width; x += 4)
-		{
-			u8 rawRGBA[4 * 4 * 4];
-			memset(rawRGBA, 0, sizeof(rawRGBA));
-			p8 targetPixel = rawRGBA;
-			for (s32 py = 0; py < 4; py++)
-			{
-				for (s32 px = 0; px < 4; px++)
-				{
-					size ix = x + px;
-					size iy = y + py;
-
-					if (ix < i_width && iy < i_height)
-					{
-						p8 sourcePixel = &i_input[(iy * i_width + ix) * i_numChannels];
-						// initialize the alpha channel for this pixel
-						targetPixel[3] = 255;
-						for (s32 i = 0; i < i_numChannels; i++)
-						{
-							targetPixel[i] = sourcePixel[i];
-						}
-						targetPixel += 4;
-					}
-					else
-					{
-						targetPixel += 4;
-					}
-				}
-			}
-
-			if (i_numChannels == 4)
-			{
-				stb_compress_dxt_block(targetBlock, rawRGBA, 1, STB_DXT_HIGHQUAL);
-			}
-			else
-			{
-				stb_compress_dxt_block(targetBlock, rawRGBA, 0, STB_DXT_HIGHQUAL);
-			}
-
-			targetBlock += bytesPerBlock;
-		}
-	}
+	dxt::CompressDXTImage(i_input, i_width, i_height, i_numChannels, dxt::DXTQuality::High, output);
 
 	*(o_compressedSize) = compressedSize;
 	return output;
@@ -747,9 +722,9 @@ void SHCalculator::_OnUpdate(const f32 i_deltaMs)
 				oStream.write_bytes(compressedData, compressedSize);
 				m_TemporalArena->free(compressedData);
 #else
-				p8 compressedData = compress_etc2(rgbaData, mipSize, mipSize, 4, &compressedSize, m_TemporalArena);
+				p8 compressedData = compress_etc2(rgbaData, mipSize, mipSize, 4, ETCEffort::Best, &compressedSize, m_TemporalArena);
 				oStream.write_bytes(compressedData, compressedSize);
-				delete[] compressedData;
+				m_TemporalArena->free(compressedData);
 #endif
 				m_TemporalArena->free(rgbaData);
 
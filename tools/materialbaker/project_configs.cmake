@@ -0,0 +1,2 @@
+set (PROJECT_NAME "materialbaker")
+set (EXECUTABLE_FILE_NAME "materialbaker")
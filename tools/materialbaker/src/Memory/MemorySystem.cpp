@@ -0,0 +1,34 @@
+#include "MemorySystem.h"
+
+#include <clover.h>
+
+helich::memory_manager							g_MemoryManager;
+
+// allocators for clover
+namespace clover
+{
+	LinearAllocator								g_LinearAllocator;
+}
+
+namespace baker
+{
+	FreelistAllocator							g_TemporalAllocator;
+	LinearArena									g_ParserArena;
+}
+
+namespace helich
+{
+// ------------------------------------------------------------------
+
+void init_memory_system()
+{
+	using namespace helich;
+	g_MemoryManager.initialize(
+			memory_region<clover::LinearAllocator>		{ "clover/allocator",			SIZE_MB(16),	&clover::g_LinearAllocator },
+			memory_region<baker::FreelistAllocator>		{ "baker/tmpallocator",			SIZE_MB(16),	&baker::g_TemporalAllocator },
+			memory_region<baker::LinearArena>			{ "baker/parser",				SIZE_MB(16),	&baker::g_ParserArena }
+			);
+}
+
+// ------------------------------------------------------------------
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <floral.h>
+#include <helich.h>
+
+namespace baker
+{
+// ------------------------------------------------------------------
+
+typedef helich::allocator<helich::stack_scheme, helich::no_tracking_policy>		LinearAllocator;
+typedef helich::allocator<helich::freelist_scheme, helich::no_tracking_policy>	FreelistAllocator;
+typedef helich::allocator<helich::stack_scheme, helich::no_tracking_policy>		LinearArena;
+
+extern FreelistAllocator						g_TemporalAllocator;
+extern LinearArena								g_ParserArena;
+
+// ------------------------------------------------------------------
+}
@@ -0,0 +1,80 @@
+#include <floral/stdaliases.h>
+#include <floral/io/nativeio.h>
+
+#include <helich.h>
+#include <clover.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Memory/MemorySystem.h"
+
+#include "MaterialParser.h"
+#include "MaterialBinary.h"
+
+// <name>.mat -> <name>.cbmat, in the same directory
+const bool BakeMaterial(const_cstr i_matFile)
+{
+	using namespace baker;
+	CLOVER_INFO("Baking: %s", i_matFile);
+
+	const mat_parser::MaterialDescription matDesc = mat_parser::ParseMaterial(floral::path(i_matFile), &g_ParserArena);
+	if (matDesc.vertexShaderPath == nullptr || matDesc.fragmentShaderPath == nullptr)
+	{
+		CLOVER_ERROR("Invalid material: %s", i_matFile);
+		g_ParserArena.free_all();
+		return false;
+	}
+	CLOVER_INFO("- shaders: %s, %s", matDesc.vertexShaderPath, matDesc.fragmentShaderPath);
+	CLOVER_INFO("- %d features, %d uniform buffers, %d textures", matDesc.featuresCount, matDesc.buffersCount, matDesc.texturesCount);
+
+	const size compiledSize = mat_parser::GetCompiledMaterialSize(matDesc);
+	p8 compiledData = (p8)g_TemporalAllocator.allocate(compiledSize);
+	mat_parser::CompileMaterial(matDesc, compiledData, compiledSize);
+
+	c8 outputFileName[512];
+	const_cstr extension = strrchr(i_matFile, '.');
+	const s32 nameLength = extension ? (s32)(extension - i_matFile) : (s32)strlen(i_matFile);
+	snprintf(outputFileName, sizeof(outputFileName), "%.*s.cbmat", nameLength, i_matFile);
+	CLOVER_INFO("- output filename: %s, %d bytes", outputFileName, compiledSize);
+
+	floral::file_info output = floral::open_output_file(outputFileName);
+	floral::output_file_stream os;
+	floral::map_output_file(output, os);
+	os.write_bytes(compiledData, compiledSize);
+	floral::close_file(output);
+
+	g_TemporalAllocator.free(compiledData);
+	g_ParserArena.free_all();
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	// we have to call it ourself as we do not have calyx here
+	helich::init_memory_system();
+
+	clover::Initialize("main", clover::LogLevel::Verbose);
+	clover::InitializeVSOutput("vs", clover::LogLevel::Verbose);
+	clover::InitializeConsoleOutput("console", clover::LogLevel::Verbose);
+
+	CLOVER_INFO("Material Baker v1");
+
+	// materialbaker <mat file> [<mat file> ...]
+	if (argc < 2)
+	{
+		CLOVER_ERROR("Usage: materialbaker <mat file> [<mat file> ...]");
+		return 1;
+	}
+
+	s32 failedCount = 0;
+	for (s32 i = 1; i < argc; i++)
+	{
+		if (!BakeMaterial(argv[i]))
+		{
+			failedCount++;
+		}
+	}
+
+	CLOVER_INFO("%d materials baked, %d failed", argc - 1 - failedCount, failedCount);
+	return failedCount > 0 ? 1 : 0;
+}
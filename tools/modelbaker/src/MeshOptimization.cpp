@@ -0,0 +1,179 @@
+#include "MeshOptimization.h"
+
+#include <floral/assert/assert.h>
+
+#include <math.h>
+#include <string.h>
+
+#include "Memory/MemorySystem.h"
+#include "meshoptimizer/meshoptimizer.h"
+
+namespace baker
+{
+// ------------------------------------------------------------------
+
+// the post-transform cache of our mobile GPUs is in the 16 - 32 entries range
+static const u32								k_CacheSize = 16;
+// how much the overdraw pass may degrade the cache efficiency
+static const f32								k_OverdrawThreshold = 1.05f;
+// a lod that keeps more than this of the previous one's triangles is not worth it
+static const f32								k_MinLodReduction = 0.9f;
+// small enough for the culling to matter, meshoptimizer recommends triangles counts multiple of 4
+static const size								k_MaxClusterVertices = 64;
+static const size								k_MaxClusterTriangles = 124;
+
+static void AnalyzeMesh(const u32* i_indices, const s32 i_indicesCount, const p8 i_vertices, const s32 i_verticesCount,
+		const size i_stride, f32* o_acmr, f32* o_overdraw, f32* o_overfetch)
+{
+	const meshopt_VertexCacheStatistics cacheStats = meshopt_analyzeVertexCache(i_indices, i_indicesCount, i_verticesCount, k_CacheSize, 0, 0);
+	const meshopt_OverdrawStatistics overdrawStats = meshopt_analyzeOverdraw(i_indices, i_indicesCount, (const f32*)i_vertices,
+			i_verticesCount, i_stride);
+	const meshopt_VertexFetchStatistics fetchStats = meshopt_analyzeVertexFetch(i_indices, i_indicesCount, i_verticesCount, i_stride);
+	*o_acmr = cacheStats.acmr;
+	*o_overdraw = overdrawStats.overdraw;
+	*o_overfetch = fetchStats.overfetch;
+}
+
+// the largest side of the bounding box, what meshopt_simplify's errors are relative to
+static const f32 GetMeshExtent(const p8 i_vertices, const s32 i_verticesCount, const size i_stride)
+{
+	f32 minCorner[3] = { 0.0f, 0.0f, 0.0f };
+	f32 maxCorner[3] = { 0.0f, 0.0f, 0.0f };
+	for (s32 i = 0; i < i_verticesCount; i++)
+	{
+		const f32* p = (const f32*)(i_vertices + i * i_stride);
+		for (u32 k = 0; k < 3; k++)
+		{
+			minCorner[k] = (i == 0 || p[k] < minCorner[k]) ? p[k] : minCorner[k];
+			maxCorner[k] = (i == 0 || p[k] > maxCorner[k]) ? p[k] : maxCorner[k];
+		}
+	}
+	return fmaxf(maxCorner[0] - minCorner[0], fmaxf(maxCorner[1] - minCorner[1], maxCorner[2] - minCorner[2]));
+}
+
+// ------------------------------------------------------------------
+
+const s32 OptimizeMesh(u32* io_indices, const s32 i_indicesCount, p8 io_vertices, const s32 i_verticesCount,
+		const size i_stride, const u32 i_lodsCount, const f32 i_lodError,
+		MeshLod* o_lods, u32* o_lodsCount, MeshOptimizationStats* o_stats)
+{
+	FLORAL_ASSERT(i_lodsCount >= 1 && i_lodsCount <= k_MaxLodsCount);
+	FLORAL_ASSERT(i_indicesCount % 3 == 0);
+	o_stats->verticesCountBefore = i_verticesCount;
+	AnalyzeMesh(io_indices, i_indicesCount, io_vertices, i_verticesCount, i_stride,
+			&o_stats->acmrBefore, &o_stats->overdrawBefore, &o_stats->overfetchBefore);
+
+	u32* remap = (u32*)g_TemporalArena.allocate(sizeof(u32) * i_verticesCount);
+	const s32 verticesCount = (s32)meshopt_generateVertexRemap(remap, io_indices, i_indicesCount, io_vertices, i_verticesCount, i_stride);
+	meshopt_remapIndexBuffer(io_indices, io_indices, i_indicesCount, remap);
+	meshopt_remapVertexBuffer(io_vertices, io_vertices, i_verticesCount, i_stride, remap);
+	g_TemporalArena.free(remap);
+
+	meshopt_optimizeVertexCache(io_indices, io_indices, i_indicesCount, verticesCount);
+	meshopt_optimizeOverdraw(io_indices, io_indices, i_indicesCount, (const f32*)io_vertices, verticesCount, i_stride, k_OverdrawThreshold);
+
+	o_lods[0].firstIndex = 0;
+	o_lods[0].indicesCount = (u32)i_indicesCount;
+	o_lods[0].error = 0.0f;
+	u32 lodsCount = 1;
+	const f32 extent = GetMeshExtent(io_vertices, verticesCount, i_stride);
+	f32 lodError = i_lodError;
+	while (lodsCount < i_lodsCount)
+	{
+		const MeshLod& prevLod = o_lods[lodsCount - 1];
+		const u32 firstIndex = prevLod.firstIndex + prevLod.indicesCount;
+		const size targetIndicesCount = (prevLod.indicesCount / 6) * 3;
+		u32* lodIndices = io_indices + firstIndex;
+		const u32 indicesCount = (u32)meshopt_simplify(lodIndices, io_indices, i_indicesCount, (const f32*)io_vertices,
+				verticesCount, i_stride, targetIndicesCount, lodError);
+		if (indicesCount == 0 || indicesCount > (u32)(prevLod.indicesCount * k_MinLodReduction))
+		{
+			break;
+		}
+
+		meshopt_optimizeVertexCache(lodIndices, lodIndices, indicesCount, verticesCount);
+		o_lods[lodsCount].firstIndex = firstIndex;
+		o_lods[lodsCount].indicesCount = indicesCount;
+		// an upper bound, the simplifier stops at the target count before reaching it
+		o_lods[lodsCount].error = lodError * extent;
+		lodsCount++;
+		lodError *= 2.0f;
+	}
+	*o_lodsCount = lodsCount;
+
+	// over all the lods, so that they all fetch the vertices in order
+	const MeshLod& lastLod = o_lods[lodsCount - 1];
+	meshopt_optimizeVertexFetch(io_vertices, io_indices, lastLod.firstIndex + lastLod.indicesCount, io_vertices, verticesCount, i_stride);
+
+	o_stats->verticesCountAfter = verticesCount;
+	AnalyzeMesh(io_indices, i_indicesCount, io_vertices, verticesCount, i_stride,
+			&o_stats->acmrAfter, &o_stats->overdrawAfter, &o_stats->overfetchAfter);
+	return verticesCount;
+}
+
+const size GetLodsIndicesBound(const s32 i_indicesCount, const u32 i_lodsCount)
+{
+	// each lod has at most k_MinLodReduction of the triangles of the previous one
+	return (size)i_indicesCount * i_lodsCount;
+}
+
+MeshCluster* BuildClusters(u32* io_indices, const s32 i_indicesCount, const p8 i_vertices,
+		const s32 i_verticesCount, const size i_stride, u32* o_clustersCount)
+{
+	const size maxMeshletsCount = meshopt_buildMeshletsBound(i_indicesCount, k_MaxClusterVertices, k_MaxClusterTriangles);
+	meshopt_Meshlet* meshlets = (meshopt_Meshlet*)g_TemporalArena.allocate(sizeof(meshopt_Meshlet) * maxMeshletsCount);
+	const size meshletsCount = meshopt_buildMeshlets(meshlets, io_indices, i_indicesCount, i_verticesCount,
+			k_MaxClusterVertices, k_MaxClusterTriangles);
+
+	MeshCluster* clusters = (MeshCluster*)g_TemporalArena.allocate(sizeof(MeshCluster) * meshletsCount);
+	u32* indices = (u32*)g_TemporalArena.allocate(sizeof(u32) * i_indicesCount);
+	u32 indicesCount = 0;
+	for (size i = 0; i < meshletsCount; i++)
+	{
+		const meshopt_Meshlet& meshlet = meshlets[i];
+		const meshopt_Bounds bounds = meshopt_computeMeshletBounds(&meshlet, (const f32*)i_vertices, i_verticesCount, i_stride);
+		MeshCluster& cluster = clusters[i];
+		cluster.firstIndex = indicesCount;
+		cluster.indicesCount = (u32)meshlet.triangle_count * 3;
+		cluster.center = floral::vec3f(bounds.center[0], bounds.center[1], bounds.center[2]);
+		cluster.radius = bounds.radius;
+		cluster.coneAxis = floral::vec3f(bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2]);
+		cluster.coneCutoff = bounds.cone_cutoff;
+
+		// back to the mesh's vertices, in the meshlet's order
+		for (u32 t = 0; t < meshlet.triangle_count; t++)
+		{
+			indices[indicesCount++] = meshlet.vertices[meshlet.indices[t][0]];
+			indices[indicesCount++] = meshlet.vertices[meshlet.indices[t][1]];
+			indices[indicesCount++] = meshlet.vertices[meshlet.indices[t][2]];
+		}
+	}
+	FLORAL_ASSERT(indicesCount == (u32)i_indicesCount);
+	memcpy(io_indices, indices, sizeof(u32) * i_indicesCount);
+
+	g_TemporalArena.free(indices);
+	g_TemporalArena.free(meshlets);
+	*o_clustersCount = (u32)meshletsCount;
+	return clusters;
+}
+
+p8 EncodeIndices(const u32* i_indices, const s32 i_indicesCount, const s32 i_verticesCount, size* o_size)
+{
+	const size bound = meshopt_encodeIndexBufferBound(i_indicesCount, i_verticesCount);
+	p8 data = (p8)g_TemporalArena.allocate(bound);
+	*o_size = meshopt_encodeIndexBuffer(data, bound, i_indices, i_indicesCount);
+	FLORAL_ASSERT(*o_size > 0);
+	return data;
+}
+
+p8 EncodeVertices(const p8 i_vertices, const s32 i_verticesCount, const size i_stride, size* o_size)
+{
+	const size bound = meshopt_encodeVertexBufferBound(i_verticesCount, i_stride);
+	p8 data = (p8)g_TemporalArena.allocate(bound);
+	*o_size = meshopt_encodeVertexBuffer(data, bound, i_vertices, i_verticesCount, i_stride);
+	FLORAL_ASSERT(*o_size > 0);
+	return data;
+}
+
+// ------------------------------------------------------------------
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+#include <floral/gpds/vec.h>
+
+namespace baker
+{
+// ------------------------------------------------------------------
+
+// mirrors cbmodel::LodInfo
+struct MeshLod
+{
+	u32											firstIndex;
+	u32											indicesCount;
+	f32											error;
+};
+
+static const u32								k_MaxLodsCount = 4;
+
+// mirrors cbmodel::ClusterInfo
+struct MeshCluster
+{
+	u32											firstIndex;
+	u32											indicesCount;
+	floral::vec3f								center;
+	f32											radius;
+	floral::vec3f								coneAxis;
+	f32											coneCutoff;
+};
+
+struct MeshOptimizationStats
+{
+	s32											verticesCountBefore;
+	s32											verticesCountAfter;
+	f32											acmrBefore;				// average cache miss ratio, per triangle
+	f32											acmrAfter;
+	f32											overdrawBefore;
+	f32											overdrawAfter;
+	f32											overfetchBefore;		// bytes fetched / vertex data size
+	f32											overfetchAfter;
+};
+
+/*
+ * The meshoptimizer pipeline on f32 interleaved vertices, positions first:
+ * - the duplicated vertices are merged
+ * - the triangles are reordered for the post-transform cache, then for overdraw
+ * - up to i_lodsCount - 1 lods are simplified from lod 0 and appended to io_indices, each one with about
+ *   half the triangles of the previous one and at most i_lodError * 2^(lod - 1) of error (relative to the
+ *   mesh extent), the chain stops early when the simplifier cannot reduce it enough
+ * - the vertices are reordered in the order the triangles use them, for fetch
+ * Everything is done in place: io_indices must have room for GetLodsIndicesBound indices. Returns the new
+ * vertices count, the indices count is the end of the last lod.
+ */
+const s32										OptimizeMesh(u32* io_indices, const s32 i_indicesCount, p8 io_vertices, const s32 i_verticesCount,
+													const size i_stride, const u32 i_lodsCount, const f32 i_lodError,
+													MeshLod* o_lods, u32* o_lodsCount, MeshOptimizationStats* o_stats);
+
+const size										GetLodsIndicesBound(const s32 i_indicesCount, const u32 i_lodsCount);
+
+/*
+ * Splits the triangles of io_indices (one lod, already optimized for the vertex cache) into meshlets and
+ * reorders them meshlet by meshlet, so that each cluster is a range of io_indices, with its bounding
+ * sphere and normal cone. The clusters are to be freed from g_TemporalArena.
+ */
+MeshCluster*									BuildClusters(u32* io_indices, const s32 i_indicesCount, const p8 i_vertices,
+													const s32 i_verticesCount, const size i_stride, u32* o_clustersCount);
+
+// meshopt_encodeIndexBuffer / meshopt_encodeVertexBuffer, the result is to be freed from g_TemporalArena
+p8												EncodeIndices(const u32* i_indices, const s32 i_indicesCount, const s32 i_verticesCount, size* o_size);
+p8												EncodeVertices(const p8 i_vertices, const s32 i_verticesCount, const size i_stride, size* o_size);
+
+// ------------------------------------------------------------------
+}
@@ -0,0 +1,287 @@
+#include "VertexQuantization.h"
+
+#include <floral/assert/assert.h>
+
+#include <math.h>
+#include <string.h>
+
+namespace baker
+{
+// ------------------------------------------------------------------
+
+static inline const f32 Clamp(const f32 i_v, const f32 i_min, const f32 i_max)
+{
+	return i_v < i_min ? i_min : (i_v > i_max ? i_max : i_v);
+}
+
+// i_v in [0, 1] of the range
+static inline const u16 QuantizeUnorm16(const f32 i_v, const f32 i_offset, const f32 i_scale)
+{
+	if (i_scale <= 0.0f)
+	{
+		return 0;
+	}
+	return (u16)(Clamp((i_v - i_offset) / i_scale, 0.0f, 1.0f) * 65535.0f + 0.5f);
+}
+
+static inline const f32 Sign(const f32 i_v)
+{
+	return i_v >= 0.0f ? 1.0f : -1.0f;
+}
+
+// ------------------------------------------------------------------
+
+const size GetQuantizedAttributeSize(const VertexFormat i_format, const u32 i_attributeIdx)
+{
+	FLORAL_ASSERT(i_format != VertexFormat::Float);
+	switch (i_attributeIdx)
+	{
+	case 0:
+		return sizeof(u16) * 4;
+	case 1:
+	case 2:
+		return i_format == VertexFormat::Quantized16 ? sizeof(s16) * 2 : sizeof(s8) * 2;
+	case 3:
+		return sizeof(u16) * 2;
+	default:
+		FLORAL_ASSERT(false);
+		return 0;
+	}
+}
+
+const Quantization ComputeQuantization(const u8* i_positions, const u8* i_texcoords, const size i_stride, const s32 i_count)
+{
+	Quantization quantization;
+	memset(&quantization, 0, sizeof(Quantization));
+	if (i_count <= 0)
+	{
+		return quantization;
+	}
+
+	floral::vec3f minPos, maxPos;
+	memcpy(&minPos, i_positions, sizeof(floral::vec3f));
+	maxPos = minPos;
+	floral::vec2f minUV(0.0f, 0.0f), maxUV(0.0f, 0.0f);
+	if (i_texcoords)
+	{
+		memcpy(&minUV, i_texcoords, sizeof(floral::vec2f));
+		maxUV = minUV;
+	}
+
+	for (s32 i = 1; i < i_count; i++)
+	{
+		floral::vec3f p;
+		memcpy(&p, i_positions + i * i_stride, sizeof(floral::vec3f));
+		minPos.x = fminf(minPos.x, p.x); maxPos.x = fmaxf(maxPos.x, p.x);
+		minPos.y = fminf(minPos.y, p.y); maxPos.y = fmaxf(maxPos.y, p.y);
+		minPos.z = fminf(minPos.z, p.z); maxPos.z = fmaxf(maxPos.z, p.z);
+		if (i_texcoords)
+		{
+			floral::vec2f uv;
+			memcpy(&uv, i_texcoords + i * i_stride, sizeof(floral::vec2f));
+			minUV.x = fminf(minUV.x, uv.x); maxUV.x = fmaxf(maxUV.x, uv.x);
+			minUV.y = fminf(minUV.y, uv.y); maxUV.y = fmaxf(maxUV.y, uv.y);
+		}
+	}
+
+	quantization.positionOffset = minPos;
+	quantization.positionScale = floral::vec3f(maxPos.x - minPos.x, maxPos.y - minPos.y, maxPos.z - minPos.z);
+	quantization.texcoordOffset = minUV;
+	quantization.texcoordScale = floral::vec2f(maxUV.x - minUV.x, maxUV.y - minUV.y);
+	return quantization;
+}
+
+void QuantizeAttribute(const u8* i_src, const size i_srcStride, const VertexFormat i_format,
+		const Quantization& i_quantization, const u32 i_attributeIdx,
+		p8 o_dst, const size i_dstStride, const s32 i_count)
+{
+	FLORAL_ASSERT(i_format != VertexFormat::Float);
+	switch (i_attributeIdx)
+	{
+	case 0:
+	{
+		const floral::vec3f& offset = i_quantization.positionOffset;
+		const floral::vec3f& scale = i_quantization.positionScale;
+		for (s32 i = 0; i < i_count; i++)
+		{
+			floral::vec3f v;
+			memcpy(&v, i_src + i * i_srcStride, sizeof(floral::vec3f));
+			const u16 q[4] = {
+				QuantizeUnorm16(v.x, offset.x, scale.x),
+				QuantizeUnorm16(v.y, offset.y, scale.y),
+				QuantizeUnorm16(v.z, offset.z, scale.z),
+				0 };
+			memcpy(o_dst + i * i_dstStride, q, sizeof(q));
+		}
+		break;
+	}
+
+	case 1:
+	case 2:
+	{
+		const u32 bits = i_format == VertexFormat::Quantized16 ? 16 : 8;
+		for (s32 i = 0; i < i_count; i++)
+		{
+			floral::vec3f v;
+			memcpy(&v, i_src + i * i_srcStride, sizeof(floral::vec3f));
+			s32 x = 0, y = 0;
+			EncodeOctahedral(v, bits, &x, &y);
+			if (bits == 16)
+			{
+				const s16 q[2] = { (s16)x, (s16)y };
+				memcpy(o_dst + i * i_dstStride, q, sizeof(q));
+			}
+			else
+			{
+				const s8 q[2] = { (s8)x, (s8)y };
+				memcpy(o_dst + i * i_dstStride, q, sizeof(q));
+			}
+		}
+		break;
+	}
+
+	case 3:
+	{
+		const floral::vec2f& offset = i_quantization.texcoordOffset;
+		const floral::vec2f& scale = i_quantization.texcoordScale;
+		for (s32 i = 0; i < i_count; i++)
+		{
+			floral::vec2f v;
+			memcpy(&v, i_src + i * i_srcStride, sizeof(floral::vec2f));
+			const u16 q[2] = { QuantizeUnorm16(v.x, offset.x, scale.x), QuantizeUnorm16(v.y, offset.y, scale.y) };
+			memcpy(o_dst + i * i_dstStride, q, sizeof(q));
+		}
+		break;
+	}
+
+	default:
+		FLORAL_ASSERT(false);
+		break;
+	}
+}
+
+void DecodeAttribute(const u8* i_src, const size i_srcStride, const VertexFormat i_format,
+		const Quantization& i_quantization, const u32 i_attributeIdx,
+		p8 o_dst, const size i_dstStride, const s32 i_count)
+{
+	FLORAL_ASSERT(i_format != VertexFormat::Float);
+	switch (i_attributeIdx)
+	{
+	case 0:
+	{
+		const floral::vec3f& offset = i_quantization.positionOffset;
+		const floral::vec3f& scale = i_quantization.positionScale;
+		for (s32 i = 0; i < i_count; i++)
+		{
+			u16 q[3];
+			memcpy(q, i_src + i * i_srcStride, sizeof(q));
+			const floral::vec3f v(
+					offset.x + (f32)q[0] / 65535.0f * scale.x,
+					offset.y + (f32)q[1] / 65535.0f * scale.y,
+					offset.z + (f32)q[2] / 65535.0f * scale.z);
+			memcpy(o_dst + i * i_dstStride, &v, sizeof(floral::vec3f));
+		}
+		break;
+	}
+
+	case 1:
+	case 2:
+	{
+		for (s32 i = 0; i < i_count; i++)
+		{
+			f32 x = 0.0f, y = 0.0f;
+			if (i_format == VertexFormat::Quantized16)
+			{
+				s16 q[2];
+				memcpy(q, i_src + i * i_srcStride, sizeof(q));
+				x = fmaxf((f32)q[0] / 32767.0f, -1.0f);
+				y = fmaxf((f32)q[1] / 32767.0f, -1.0f);
+			}
+			else
+			{
+				const s8* q = (const s8*)(i_src + i * i_srcStride);
+				x = fmaxf((f32)q[0] / 127.0f, -1.0f);
+				y = fmaxf((f32)q[1] / 127.0f, -1.0f);
+			}
+			const floral::vec3f v = DecodeOctahedral(x, y);
+			memcpy(o_dst + i * i_dstStride, &v, sizeof(floral::vec3f));
+		}
+		break;
+	}
+
+	case 3:
+	{
+		const floral::vec2f& offset = i_quantization.texcoordOffset;
+		const floral::vec2f& scale = i_quantization.texcoordScale;
+		for (s32 i = 0; i < i_count; i++)
+		{
+			u16 q[2];
+			memcpy(q, i_src + i * i_srcStride, sizeof(q));
+			const floral::vec2f v(
+					offset.x + (f32)q[0] / 65535.0f * scale.x,
+					offset.y + (f32)q[1] / 65535.0f * scale.y);
+			memcpy(o_dst + i * i_dstStride, &v, sizeof(floral::vec2f));
+		}
+		break;
+	}
+
+	default:
+		FLORAL_ASSERT(false);
+		break;
+	}
+}
+
+void EncodeOctahedral(const floral::vec3f& i_v, const u32 i_bits, s32* o_x, s32* o_y)
+{
+	const f32 l1 = fabsf(i_v.x) + fabsf(i_v.y) + fabsf(i_v.z);
+	if (l1 <= 0.0f)
+	{
+		// missing attribute, any direction will do
+		*o_x = 0;
+		*o_y = 0;
+		return;
+	}
+
+	f32 x = i_v.x / l1;
+	f32 y = i_v.y / l1;
+	if (i_v.z < 0.0f)
+	{
+		const f32 foldedX = (1.0f - fabsf(y)) * Sign(x);
+		const f32 foldedY = (1.0f - fabsf(x)) * Sign(y);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	// rounding to the nearest is not always the closest direction once decoded: try the 4 neighbours
+	const f32 maxValue = (f32)((1 << (i_bits - 1)) - 1);
+	const f32 fx = floorf(x * maxValue);
+	const f32 fy = floorf(y * maxValue);
+	const f32 lengthSq = i_v.x * i_v.x + i_v.y * i_v.y + i_v.z * i_v.z;
+	f32 bestCos = -2.0f;
+	for (s32 i = 0; i < 4; i++)
+	{
+		const f32 cx = Clamp(fx + (f32)(i & 1), -maxValue, maxValue);
+		const f32 cy = Clamp(fy + (f32)(i >> 1), -maxValue, maxValue);
+		const floral::vec3f d = DecodeOctahedral(cx / maxValue, cy / maxValue);
+		const f32 cosAngle = (d.x * i_v.x + d.y * i_v.y + d.z * i_v.z) / sqrtf(lengthSq);
+		if (cosAngle > bestCos)
+		{
+			bestCos = cosAngle;
+			*o_x = (s32)cx;
+			*o_y = (s32)cy;
+		}
+	}
+}
+
+const floral::vec3f DecodeOctahedral(const f32 i_x, const f32 i_y)
+{
+	floral::vec3f v(i_x, i_y, 1.0f - fabsf(i_x) - fabsf(i_y));
+	const f32 t = fmaxf(-v.z, 0.0f);
+	v.x += v.x >= 0.0f ? -t : t;
+	v.y += v.y >= 0.0f ? -t : t;
+	const f32 length = sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+	return floral::vec3f(v.x / length, v.y / length, v.z / length);
+}
+
+// ------------------------------------------------------------------
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <floral/stdaliases.h>
+#include <floral/gpds/vec.h>
+
+namespace baker
+{
+// ------------------------------------------------------------------
+
+// mirrors cbmodel::VertexFormat and cbmodel::Quantization of the engine
+enum class VertexFormat : u32
+{
+	Float										= 0,
+	Quantized16,
+	Quantized8
+};
+
+#pragma pack(push)
+#pragma pack(1)
+struct Quantization
+{
+	floral::vec3f								positionOffset;
+	floral::vec3f								positionScale;
+	floral::vec2f								texcoordOffset;
+	floral::vec2f								texcoordScale;
+};
+#pragma pack(pop)
+
+/*
+ * The quantized attributes, as geo3d::VertexPNTTQ16 / VertexPNTTQ8 read them:
+ * - position: 3 x u16 normalized over the bounding box of the mesh, padded to 8 bytes
+ * - normal, tangent: octahedral, 2 x s16 (Quantized16) or 2 x s8 (Quantized8) normalized
+ * - texcoord: 2 x u16 normalized over the texcoord bounds of the mesh
+ */
+const size										GetQuantizedAttributeSize(const VertexFormat i_format, const u32 i_attributeIdx);
+
+// the ranges of the f32 positions and texcoords (nullptr when absent) of i_count vertices i_stride bytes apart
+const Quantization								ComputeQuantization(const u8* i_positions, const u8* i_texcoords, const size i_stride, const s32 i_count);
+
+// strided encode of one f32 attribute of i_count vertices
+void											QuantizeAttribute(const u8* i_src, const size i_srcStride, const VertexFormat i_format,
+													const Quantization& i_quantization, const u32 i_attributeIdx,
+													p8 o_dst, const size i_dstStride, const s32 i_count);
+
+// and back, same as cbmodel::details::DecodeAttribute
+void											DecodeAttribute(const u8* i_src, const size i_srcStride, const VertexFormat i_format,
+													const Quantization& i_quantization, const u32 i_attributeIdx,
+													p8 o_dst, const size i_dstStride, const s32 i_count);
+
+// i_v must be normalized; o_x, o_y are snorm of i_bits bits
+void											EncodeOctahedral(const floral::vec3f& i_v, const u32 i_bits, s32* o_x, s32* o_y);
+const floral::vec3f								DecodeOctahedral(const f32 i_x, const f32 i_y);
+
+// ------------------------------------------------------------------
+}
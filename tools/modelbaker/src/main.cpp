@@ -6,13 +6,19 @@
 #include <helich.h>
 #include <clover.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
 
 #include "Memory/MemorySystem.h"
+#include "VertexQuantization.h"
+#include "MeshOptimization.h"
 
 #include "cJSON.h"
+#include "GLTFDocument.h"
 
 #pragma pack(push)
 #pragma pack(1)
+// v1 cbmodel, every attribute in its own stream
 struct CbModelHeader
 {
 	s32											indicesCount;
@@ -25,6 +31,36 @@ struct CbModelHeader
 	size										texcoordOffset;
 };
 
+// mirrors cbmodel::VertexLayout and cbmodel::ModelFileHeader of the engine
+struct CbVertexLayout
+{
+	u32											attributes;
+	u32											stride;
+	u32											offsets[4];
+};
+
+struct CbModelFileHeader
+{
+	c8											magicCharacters[4];
+	u32											version;
+	s32											indicesCount;
+	s32											verticesCount;
+	CbVertexLayout								vertexLayout;
+	baker::VertexFormat							vertexFormat;
+	baker::Quantization							quantization;
+	u32											compression;
+	u32											lodsCount;
+	u32											clustersCount;
+	u32											materialNameLength;
+	u64											materialNameOffset;
+	u64											lodsOffset;
+	u64											clustersOffset;
+	u64											indicesOffset;
+	u64											indicesSize;
+	u64											verticesOffset;
+	u64											verticesSize;
+};
+
 struct CbNode
 {
 	floral::vec3f								translation;
@@ -32,12 +68,145 @@ struct CbNode
 	floral::vec3f								scale;
 };
 
+// mirrors cbscene::SceneHeader
 struct CbSceneHeader
 {
-	size										nodesCount;
+	c8											magicCharacters[4];
+	u32											version;
+	u32											nodesCount;
+	u32											meshesCount;
+};
+
+// mirrors the scene package of the engine (cbscene::PackageFileHeader and the tables)
+struct CbPackageFileHeader
+{
+	c8											magicCharacters[4];
+	u32											version;
+	u32											nodesCount;
+	u32											meshesCount;
+	u32											materialsCount;
+	u32											stringTableSize;
+	u64											nodesOffset;
+	u64											meshesOffset;
+	u64											materialsOffset;
+	u64											stringTableOffset;
+};
+
+struct CbPackageNode
+{
+	u32											nameOffset;
+	s32											parentIdx;
+	s32											meshIdx;
+	CbNode										transform;
+};
+
+struct CbPackageMesh
+{
+	u32											nameOffset;
+	u32											materialIdx;
+	u64											offset;
+	u64											size;
+};
+
+struct CbPackageMaterial
+{
+	u32											nameOffset;
 };
 #pragma pack(pop)
 
+static const u32								k_CbModelFileVersion = 2;
+static const u32								k_CbPackageFileVersion = 2;
+static const u32								k_CbSceneFileVersion = 2;
+
+// same bits as cbmodel::VertexAttribute
+enum class VertexAttribute : u32
+{
+	Invalid										= 0,
+	Position									= 1,
+	Normal										= Position << 1,
+	Tangent										= Normal << 1,
+	TexCoord									= Tangent << 1
+};
+
+static const u32								k_VertexAttributesCount = 4;
+
+// same values as cbmodel::Compression
+enum class Compression : u32
+{
+	None										= 0,
+	MeshOptimizer
+};
+
+struct MeshExportOptions
+{
+	u32											vertexAttributes;
+	baker::VertexFormat							vertexFormat;
+	Compression									compression;
+	u32											lodsCount;
+	f32											lodError;				// of lod 1, relative to the mesh extent
+	bool										buildClusters;
+};
+
+inline const size GetAttributeSize(const u32 i_attributeIdx)
+{
+	return i_attributeIdx == 3 ? sizeof(floral::vec2f) : sizeof(floral::vec3f);
+}
+
+// the layouts of geo3d's vertices
+inline const u32 GetVertexLayoutFromName(const_cstr i_name)
+{
+	const u32 p = (u32)VertexAttribute::Position;
+	const u32 n = (u32)VertexAttribute::Normal;
+	const u32 t = (u32)VertexAttribute::Tangent;
+	const u32 tc = (u32)VertexAttribute::TexCoord;
+	if (strcmp(i_name, "pntt") == 0)
+	{
+		return p | n | t | tc;
+	}
+	else if (strcmp(i_name, "pnt") == 0)
+	{
+		return p | n | tc;
+	}
+	else if (strcmp(i_name, "pn") == 0)
+	{
+		return p | n;
+	}
+	else if (strcmp(i_name, "p") == 0)
+	{
+		return p;
+	}
+	return (u32)VertexAttribute::Invalid;
+}
+
+// f32 or quantized interleaved attributes, in the order of VertexAttribute
+inline const CbVertexLayout GetVertexLayout(const u32 i_vertexAttributes, const baker::VertexFormat i_format)
+{
+	CbVertexLayout layout;
+	memset(&layout, 0, sizeof(CbVertexLayout));
+	layout.attributes = i_vertexAttributes;
+	for (u32 i = 0; i < k_VertexAttributesCount; i++)
+	{
+		if (i_vertexAttributes & (1u << i))
+		{
+			layout.offsets[i] = layout.stride;
+			layout.stride += (u32)(i_format == baker::VertexFormat::Float ?
+					GetAttributeSize(i) : baker::GetQuantizedAttributeSize(i_format, i));
+		}
+	}
+	// vertex fetch wants 4 bytes aligned strides
+	layout.stride = (layout.stride + 3) & ~3u;
+	return layout;
+}
+
+inline void WritePadding(floral::output_file_stream& io_os, const size i_alignment)
+{
+	const u8 zero = 0;
+	while (io_os.get_pointer_position() % i_alignment != 0)
+	{
+		io_os.write(zero);
+	}
+}
+
 template <class TMemoryArena>
 struct AllocatorRegistry
 {
@@ -69,134 +238,117 @@ void InitializeJSONParser(TMemoryArena* i_memoryArena)
 	cJSON_InitHooks(&hooks);
 }
 
-enum class ComponentType : s32
-{
-	Invalid = 0,
-	Byte = 5120,
-	UnsignedByte = 5121,
-	Short = 5122,
-	UnsignedShort = 5123,
-	UnsignedInt = 5125,
-	Float = 5126
-};
-
-enum class ElementType : s32
-{
-	Invalid = 0,
-	Scalar,
-	Vec2,
-	Vec3,
-	Vec4,
-	Mat2,
-	Mat3,
-	Mat4
-};
-
-struct BufferViewDescription
+// the gltf or the glb being exported: the scene graph through cJSON, the accessors straight from the buffer
+struct GLTFInput
 {
-	ComponentType								componentType;
-	ElementType									elementType;
-	s32											elementCount;
-
-	size										byteOffset;
-	size										byteLength;
+	cJSON*										json;
+	gltf_loader::Document						document;
+	size										fileSize;
 };
 
-inline const ComponentType GetComponentTypeFromValue(const s32 i_componentTypeValue)
-{
-	return ComponentType(i_componentTypeValue);
-}
-
-inline const ElementType GetElementTypeFromValue(const_cstr i_elementTypeValue)
+const bool OpenGLTF(const_cstr i_gltfFile, GLTFInput* o_input)
 {
-	if (strcmp(i_elementTypeValue, "SCALAR") == 0)
-	{
-		return ElementType::Scalar;
-	}
-	else if (strcmp(i_elementTypeValue, "VEC2") == 0)
-	{
-		return ElementType::Vec2;
-	}
-	else if (strcmp(i_elementTypeValue, "VEC3") == 0)
-	{
-		return ElementType::Vec3;
-	}
-	else if (strcmp(i_elementTypeValue, "VEC4") == 0)
-	{
-		return ElementType::Vec4;
-	}
-	else if (strcmp(i_elementTypeValue, "MAT2") == 0)
+	using namespace baker;
+	floral::file_info inp = floral::open_file(i_gltfFile);
+	floral::file_stream inpStream;
+	inpStream.buffer = (p8)g_TemporalAllocator.allocate(inp.file_size + 1);
+	floral::read_all_file(inp, inpStream);
+	floral::close_file(inp);
+	inpStream.buffer[inp.file_size] = 0;
+	o_input->fileSize = inp.file_size;
+
+	// a glb is the json and the buffer in one file, nothing else is read
+	const c8* jsonText = (const c8*)inpStream.buffer;
+	size jsonSize = inp.file_size;
+	const u8* bin = nullptr;
+	size binSize = 0;
+	if (gltf_loader::IsGLB(inpStream.buffer, inp.file_size))
 	{
-		return ElementType::Mat2;
+		if (!gltf_loader::ParseGLB(inpStream.buffer, inp.file_size, &jsonText, &jsonSize, &bin, &binSize))
+		{
+			CLOVER_ERROR("Invalid glb file: %s", i_gltfFile);
+			return false;
+		}
+		CLOVER_INFO("GLB: %d bytes of json, %d bytes of buffer", jsonSize, binSize);
 	}
-	else if (strcmp(i_elementTypeValue, "MAT3") == 0)
+
+	InitializeJSONParser(&g_ParserAllocator);
+	o_input->json = cJSON_ParseWithLength(jsonText, jsonSize);
+	if (o_input->json == nullptr || !gltf_loader::ParseDocument(jsonText, jsonSize, &o_input->document))
 	{
-		return ElementType::Mat3;
+		CLOVER_ERROR("Invalid gltf json: %s", i_gltfFile);
+		return false;
 	}
-	else if (strcmp(i_elementTypeValue, "MAT4") == 0)
+
+	if (bin == nullptr)
 	{
-		return ElementType::Mat4;
+		c8 binFilename[512];
+		if (!gltf_loader::GetBufferUri(o_input->document, 0, binFilename, sizeof(binFilename)))
+		{
+			CLOVER_ERROR("Only external buffers are supported");
+			return false;
+		}
+		CLOVER_INFO("Buffer file name: %s", binFilename);
+		floral::file_info binInp = floral::open_file(binFilename);
+		p8 binData = (p8)g_TemporalAllocator.allocate(binInp.file_size);
+		floral::file_stream binInpStream;
+		binInpStream.buffer = binData;
+		floral::read_all_file(binInp, binInpStream);
+		floral::close_file(binInp);
+		bin = binData;
+		binSize = binInp.file_size;
 	}
-
-	return ElementType::Invalid;
+	CLOVER_INFO("Buffer file size: %d", binSize);
+
+	o_input->document.bin = bin;
+	o_input->document.binSize = binSize;
+	gltf_loader::JsonValue* accessorsTable = (gltf_loader::JsonValue*)g_ParserAllocator.allocate(
+			sizeof(gltf_loader::JsonValue) * (gltf_loader::GetAccessorsCount(o_input->document) + 1));
+	gltf_loader::JsonValue* bufferViewsTable = (gltf_loader::JsonValue*)g_ParserAllocator.allocate(
+			sizeof(gltf_loader::JsonValue) * (gltf_loader::GetBufferViewsCount(o_input->document) + 1));
+	gltf_loader::IndexDocument(&o_input->document, accessorsTable, bufferViewsTable);
+	return true;
 }
 
-BufferViewDescription GetBufferViewDescription(cJSON* i_accessors, cJSON* i_bufferViews, const size i_accessorIdx)
+const gltf_loader::AccessorView GetAccessorView(const gltf_loader::Document& i_document, const size i_accessorIdx)
 {
-	BufferViewDescription desc;
-
-	cJSON* accessor = cJSON_GetArrayItem(i_accessors, i_accessorIdx);
-	size bufferViewIdx = cJSON_GetObjectItemCaseSensitive(accessor, "bufferView")->valueint;
-	desc.componentType = GetComponentTypeFromValue(cJSON_GetObjectItemCaseSensitive(accessor, "componentType")->valueint);
-	desc.elementType = GetElementTypeFromValue(cJSON_GetObjectItemCaseSensitive(accessor, "type")->valuestring);
-	desc.elementCount = cJSON_GetObjectItemCaseSensitive(accessor, "count")->valueint;
-
-	cJSON* bufferView = cJSON_GetArrayItem(i_bufferViews, bufferViewIdx);
-	desc.byteOffset = cJSON_GetObjectItemCaseSensitive(bufferView, "byteOffset")->valueint;
-	desc.byteLength = cJSON_GetObjectItemCaseSensitive(bufferView, "byteLength")->valueint;
+	gltf_loader::AccessorView view;
+	const bool viewResult = gltf_loader::GetAccessorView(i_document, (u32)i_accessorIdx, &view);
+	FLORAL_ASSERT_MSG(viewResult, "Unsupported accessor");
+	return view;
+}
 
-	return desc;
+// the first i_elementSize bytes of every element of the accessor, back to back
+void WriteAccessor(const gltf_loader::AccessorView& i_view, const size i_elementSize, floral::output_file_stream& io_os)
+{
+	using namespace baker;
+	FLORAL_ASSERT(i_view.componentType == gltf_loader::ComponentType::Float);
+	p8 elements = (p8)g_TemporalArena.allocate(i_elementSize * i_view.count);
+	gltf_loader::CopyAccessor(i_view, i_elementSize, elements, i_elementSize);
+	io_os.write_bytes(elements, i_elementSize * i_view.count);
+	g_TemporalArena.free(elements);
 }
 
 void ExportFirstNodeAsModel(const_cstr i_gltfFile, const_cstr i_outputFile)
 {
 	using namespace baker;
-	floral::file_info inp = floral::open_file(i_gltfFile);
-	floral::file_stream inpStream;
-	inpStream.buffer = (p8)g_ParserAllocator.allocate(inp.file_size + 1);
-	floral::read_all_file(inp, inpStream);
-	floral::close_file(inp);
+	GLTFInput input;
+	if (!OpenGLTF(i_gltfFile, &input))
+	{
+		return;
+	}
 
 	size selectedNode = 0;
-
-	InitializeJSONParser(&g_ParserAllocator);
-	cJSON* json = cJSON_Parse((const_cstr)inpStream.buffer);
+	cJSON* json = input.json;
+	const gltf_loader::Document& document = input.document;
 
 	cJSON* nodes = cJSON_GetObjectItemCaseSensitive(json, "nodes");
 	CLOVER_INFO("Nodes count: %d", cJSON_GetArraySize(nodes));
 
 	cJSON* meshes = cJSON_GetObjectItemCaseSensitive(json, "meshes");
 	CLOVER_INFO("Meshes count: %d", cJSON_GetArraySize(meshes));
-
-	cJSON* accessors = cJSON_GetObjectItemCaseSensitive(json, "accessors");
-	CLOVER_INFO("Accessors count: %d", cJSON_GetArraySize(accessors));
-
-	cJSON* bufferViews = cJSON_GetObjectItemCaseSensitive(json, "bufferViews");
-	CLOVER_INFO("BufferViews count: %d", cJSON_GetArraySize(bufferViews));
-
-	cJSON* buffers = cJSON_GetObjectItemCaseSensitive(json, "buffers");
-	CLOVER_INFO("Buffers count: %d", cJSON_GetArraySize(buffers));
-
-	// read buffer into memory here
-	cJSON* buffer = cJSON_GetArrayItem(buffers, 0);
-	const_cstr binFilename = cJSON_GetObjectItemCaseSensitive(buffer, "uri")->valuestring;
-	CLOVER_INFO("Buffer file name: %s", binFilename);
-	CLOVER_INFO("Buffer file size: %d", cJSON_GetObjectItemCaseSensitive(buffer, "byteLength")->valueint);
-	floral::file_info binInp = floral::open_file(binFilename);
-	floral::file_stream binInpStream;
-	binInpStream.buffer = (p8)g_TemporalAllocator.allocate(binInp.file_size);
-	floral::read_all_file(binInp, binInpStream);
-	floral::close_file(binInp);
+	CLOVER_INFO("Accessors count: %d", gltf_loader::GetAccessorsCount(document));
+	CLOVER_INFO("BufferViews count: %d", gltf_loader::GetBufferViewsCount(document));
 
 	CLOVER_INFO(">>> Begin exporting");
 	CLOVER_INFO("Exporting node #%d", selectedNode);
@@ -225,27 +377,13 @@ void ExportFirstNodeAsModel(const_cstr i_gltfFile, const_cstr i_outputFile)
 			size accessorIdx = cJSON_GetObjectItemCaseSensitive(primitive, "indices")->valueint;
 			CLOVER_INFO("---- indices accessor index: %d", accessorIdx);
 
-			BufferViewDescription desc = GetBufferViewDescription(accessors, bufferViews, accessorIdx);
-			binInpStream.seek_begin(desc.byteOffset);
-			header.indicesCount = desc.elementCount;
+			const gltf_loader::AccessorView view = GetAccessorView(document, accessorIdx);
+			header.indicesCount = view.count;
 			header.indicesOffset = os.get_pointer_position();
-			for (size i = 0; i < desc.elementCount; i++)
-			{
-				s32 cbIndex = -1;
-				if (desc.componentType == ComponentType::UnsignedShort)
-				{
-					u16 gltfIndex = 0;
-					binInpStream.read(&gltfIndex);
-					cbIndex = (s32)gltfIndex;
-				}
-				else if (desc.componentType == ComponentType::UnsignedInt)
-				{
-					u32 gltfIndex = 0;
-					binInpStream.read(&gltfIndex);
-					cbIndex = (s32)gltfIndex;
-				}
-				os.write(cbIndex);
-			}
+			s32* indices = (s32*)g_TemporalArena.allocate(sizeof(s32) * view.count);
+			gltf_loader::CopyIndices(view, indices);
+			os.write_bytes(indices, sizeof(s32) * view.count);
+			g_TemporalArena.free(indices);
 		}
 
 		cJSON* attributes = cJSON_GetObjectItemCaseSensitive(primitive, "attributes");
@@ -253,62 +391,37 @@ void ExportFirstNodeAsModel(const_cstr i_gltfFile, const_cstr i_outputFile)
 		if (position)
 		{
 			CLOVER_INFO("---- POSITION accessor index: %d", position->valueint);
-			BufferViewDescription desc = GetBufferViewDescription(accessors, bufferViews, position->valueint);
-			header.verticesCount = desc.elementCount;
+			const gltf_loader::AccessorView view = GetAccessorView(document, position->valueint);
+			header.verticesCount = view.count;
 			header.positionOffset = os.get_pointer_position();
-			binInpStream.seek_begin(desc.byteOffset);
-			for (size i = 0; i < desc.elementCount; i++)
-			{
-				floral::vec3f v(0.0f, 0.0f, 0.0f);
-				binInpStream.read(&v);
-				os.write(v);
-			}
+			WriteAccessor(view, sizeof(floral::vec3f), os);
 		}
 
 		cJSON* normal = cJSON_GetObjectItemCaseSensitive(attributes, "NORMAL");
 		if (normal)
 		{
 			CLOVER_INFO("---- NORMAL accessor index: %d", normal->valueint);
-			BufferViewDescription desc = GetBufferViewDescription(accessors, bufferViews, normal->valueint);
+			const gltf_loader::AccessorView view = GetAccessorView(document, normal->valueint);
 			header.normalOffset = os.get_pointer_position();
-			binInpStream.seek_begin(desc.byteOffset);
-			for (size i = 0; i < desc.elementCount; i++)
-			{
-				floral::vec3f v(0.0f, 0.0f, 0.0f);
-				binInpStream.read(&v);
-				os.write(v);
-			}
+			WriteAccessor(view, sizeof(floral::vec3f), os);
 		}
 
 		cJSON* tangent = cJSON_GetObjectItemCaseSensitive(attributes, "TANGENT");
 		if (tangent)
 		{
 			CLOVER_INFO("---- TANGENT accessor index: %d", tangent->valueint);
-			BufferViewDescription desc = GetBufferViewDescription(accessors, bufferViews, tangent->valueint);
+			const gltf_loader::AccessorView view = GetAccessorView(document, tangent->valueint);
 			header.tangentOffset = os.get_pointer_position();
-			binInpStream.seek_begin(desc.byteOffset);
-			for (size i = 0; i < desc.elementCount; i++)
-			{
-				floral::vec4f v(0.0f, 0.0f, 0.0f, 0.0f);
-				binInpStream.read(&v);
-				floral::vec3f cbVec(v.x, v.y, v.z);
-				os.write(cbVec);
-			}
+			WriteAccessor(view, sizeof(floral::vec3f), os);
 		}
 
 		cJSON* texcoord = cJSON_GetObjectItemCaseSensitive(attributes, "TEXCOORD_0");
 		if (texcoord)
 		{
 			CLOVER_INFO("---- TEXCOORD_0 accessor index: %d", texcoord->valueint);
-			BufferViewDescription desc = GetBufferViewDescription(accessors, bufferViews, texcoord->valueint);
+			const gltf_loader::AccessorView view = GetAccessorView(document, texcoord->valueint);
 			header.texcoordOffset = os.get_pointer_position();
-			binInpStream.seek_begin(desc.byteOffset);
-			for (size i = 0; i < desc.elementCount; i++)
-			{
-				floral::vec2f v(0.0f, 0.0f);
-				binInpStream.read(&v);
-				os.write(v);
-			}
+			WriteAccessor(view, sizeof(floral::vec2f), os);
 		}
 	}
 
@@ -320,141 +433,436 @@ void ExportFirstNodeAsModel(const_cstr i_gltfFile, const_cstr i_outputFile)
 	CLOVER_INFO("<<< End exporting");
 }
 
-void ExportMeshNoOverwrite(cJSON* i_mesh, cJSON* i_materials, cJSON* i_accessors, cJSON* i_bufferViews, floral::file_stream& i_binStream, const_cstr i_outputFileName)
+// reads one attribute of the accessor into every vertex of the interleaved buffer
+void GatherAttribute(const gltf_loader::AccessorView& i_view, const size i_attributeSize, p8 o_vertices, const size i_stride,
+		const s32 i_verticesCount)
 {
-	floral::file_info output = floral::open_output_file(i_outputFileName);
-	floral::output_file_stream os;
-	floral::map_output_file(output, os);
-
-	CbModelHeader header;
-	os.write(header);
+	FLORAL_ASSERT(i_view.count == (u32)i_verticesCount);
+	FLORAL_ASSERT(i_view.componentType == gltf_loader::ComponentType::Float);
+	gltf_loader::CopyAccessor(i_view, i_attributeSize, o_vertices, i_stride);
+}
 
+// a cbmodel holds a single surface: the last primitive of the mesh
+cJSON* GetExportedPrimitive(cJSON* i_mesh)
+{
 	cJSON* primitives = cJSON_GetObjectItemCaseSensitive(i_mesh, "primitives");
-	size primitivesCount = cJSON_GetArraySize(primitives);
-	CLOVER_INFO("-- primitives count: %d", primitivesCount);
-	for (size i = 0; i < primitivesCount; i++)
-	{
-		cJSON* primitive = cJSON_GetArrayItem(primitives, i);
-		CLOVER_INFO("--- primitive #%d", i);
+	return cJSON_GetArrayItem(primitives, cJSON_GetArraySize(primitives) - 1);
+}
+
+const_cstr GetExportedMaterialName(cJSON* i_mesh, cJSON* i_materials)
+{
+	size materialIdx = cJSON_GetObjectItemCaseSensitive(GetExportedPrimitive(i_mesh), "material")->valueint;
+	cJSON* material = cJSON_GetArrayItem(i_materials, materialIdx);
+	return cJSON_GetObjectItemCaseSensitive(material, "name")->valuestring;
+}
 
-		// material
+// reads the f32 vertices of the primitive, interleaved as i_layout; the attributes it does not have are left to zero
+p8 GatherVertices(cJSON* i_primitive, const gltf_loader::Document& i_document, const CbVertexLayout& i_layout,
+		s32* o_verticesCount)
+{
+	using namespace baker;
+	cJSON* attributes = cJSON_GetObjectItemCaseSensitive(i_primitive, "attributes");
+	cJSON* position = cJSON_GetObjectItemCaseSensitive(attributes, "POSITION");
+	FLORAL_ASSERT(position != nullptr);
+	const s32 verticesCount = (s32)GetAccessorView(i_document, position->valueint).count;
+	const size verticesSize = (size)i_layout.stride * verticesCount;
+	p8 vertices = (p8)g_TemporalArena.allocate(verticesSize);
+	memset(vertices, 0, verticesSize);
+
+	// tangents are vec4f in the gltf, the handedness is dropped
+	static const_cstr k_AttributeNames[] = { "POSITION", "NORMAL", "TANGENT", "TEXCOORD_0" };
+	for (u32 i = 0; i < k_VertexAttributesCount; i++)
+	{
+		if ((i_layout.attributes & (1u << i)) == 0)
 		{
-			size materialIdx = cJSON_GetObjectItemCaseSensitive(primitive, "material")->valueint;
-			cJSON* material = cJSON_GetArrayItem(i_materials, materialIdx);
-			const_cstr materialName = cJSON_GetObjectItemCaseSensitive(material, "name")->valuestring;
-			CLOVER_INFO("---- material name: %s", materialName);
-			s32 materialNameLen = strlen(materialName);
-			os.write(materialNameLen);
-			os.write_bytes((voidptr)materialName, materialNameLen);
+			continue;
 		}
 
+		cJSON* attribute = cJSON_GetObjectItemCaseSensitive(attributes, k_AttributeNames[i]);
+		if (attribute)
 		{
-			size accessorIdx = cJSON_GetObjectItemCaseSensitive(primitive, "indices")->valueint;
-			CLOVER_INFO("---- indices accessor index: %d", accessorIdx);
-
-			BufferViewDescription desc = GetBufferViewDescription(i_accessors, i_bufferViews, accessorIdx);
-			i_binStream.seek_begin(desc.byteOffset);
-			header.indicesCount = desc.elementCount;
-			header.indicesOffset = os.get_pointer_position();
-			for (size i = 0; i < desc.elementCount; i++)
-			{
-				s32 cbIndex = -1;
-				if (desc.componentType == ComponentType::UnsignedShort)
-				{
-					u16 gltfIndex = 0;
-					i_binStream.read(&gltfIndex);
-					cbIndex = (s32)gltfIndex;
-				}
-				else if (desc.componentType == ComponentType::UnsignedInt)
-				{
-					u32 gltfIndex = 0;
-					i_binStream.read(&gltfIndex);
-					cbIndex = (s32)gltfIndex;
-				}
-				os.write(cbIndex);
-			}
+			CLOVER_INFO("---- %s accessor index: %d", k_AttributeNames[i], attribute->valueint);
+			GatherAttribute(GetAccessorView(i_document, attribute->valueint), GetAttributeSize(i),
+					vertices + i_layout.offsets[i], i_layout.stride, verticesCount);
 		}
+		else
+		{
+			CLOVER_WARNING("---- no %s, filled with zeros", k_AttributeNames[i]);
+		}
+	}
 
-		cJSON* attributes = cJSON_GetObjectItemCaseSensitive(primitive, "attributes");
-		cJSON* position = cJSON_GetObjectItemCaseSensitive(attributes, "POSITION");
-		if (position)
+	*o_verticesCount = verticesCount;
+	return vertices;
+}
+
+// quantizes the f32 vertices of i_srcLayout to i_dstLayout, the result is to be freed from g_TemporalArena
+p8 QuantizeVertices(const p8 i_vertices, const CbVertexLayout& i_srcLayout, const CbVertexLayout& i_dstLayout,
+		const baker::VertexFormat i_format, const s32 i_verticesCount, baker::Quantization* o_quantization)
+{
+	using namespace baker;
+	const u32 texcoordBit = (u32)VertexAttribute::TexCoord;
+	*o_quantization = ComputeQuantization(i_vertices + i_srcLayout.offsets[0],
+			(i_srcLayout.attributes & texcoordBit) ? i_vertices + i_srcLayout.offsets[3] : nullptr,
+			i_srcLayout.stride, i_verticesCount);
+
+	const size verticesSize = (size)i_dstLayout.stride * i_verticesCount;
+	p8 vertices = (p8)g_TemporalArena.allocate(verticesSize);
+	memset(vertices, 0, verticesSize);
+	for (u32 i = 0; i < k_VertexAttributesCount; i++)
+	{
+		if (i_srcLayout.attributes & (1u << i))
 		{
-			CLOVER_INFO("---- POSITION accessor index: %d", position->valueint);
-			BufferViewDescription desc = GetBufferViewDescription(i_accessors, i_bufferViews, position->valueint);
-			header.verticesCount = desc.elementCount;
-			header.positionOffset = os.get_pointer_position();
-			i_binStream.seek_begin(desc.byteOffset);
-			for (size i = 0; i < desc.elementCount; i++)
-			{
-				floral::vec3f v(0.0f, 0.0f, 0.0f);
-				i_binStream.read(&v);
-				os.write(v);
-			}
+			QuantizeAttribute(i_vertices + i_srcLayout.offsets[i], i_srcLayout.stride, i_format, *o_quantization, i,
+					vertices + i_dstLayout.offsets[i], i_dstLayout.stride, i_verticesCount);
 		}
+	}
+	return vertices;
+}
 
-		cJSON* normal = cJSON_GetObjectItemCaseSensitive(attributes, "NORMAL");
-		if (normal)
+// writes a v2 cbmodel at the position of io_os, which must be 16 bytes aligned; the offsets are from there
+void WriteMesh(cJSON* i_mesh, cJSON* i_materials, const gltf_loader::Document& i_document, const MeshExportOptions& i_options,
+		floral::output_file_stream& io_os)
+{
+	using namespace baker;
+	cJSON* primitives = cJSON_GetObjectItemCaseSensitive(i_mesh, "primitives");
+	size primitivesCount = cJSON_GetArraySize(primitives);
+	CLOVER_INFO("-- primitives count: %d", primitivesCount);
+	if (primitivesCount > 1)
+	{
+		CLOVER_WARNING("-- only the last primitive will be exported");
+	}
+
+	cJSON* primitive = GetExportedPrimitive(i_mesh);
+	CLOVER_INFO("--- primitive #%d", primitivesCount - 1);
+
+	CbModelFileHeader header;
+	memset(&header, 0, sizeof(CbModelFileHeader));
+	header.magicCharacters[0] = 'C';
+	header.magicCharacters[1] = 'B';
+	header.magicCharacters[2] = 'M';
+	header.magicCharacters[3] = 'D';
+	header.version = k_CbModelFileVersion;
+	header.vertexFormat = i_options.vertexFormat;
+	header.vertexLayout = GetVertexLayout(i_options.vertexAttributes, i_options.vertexFormat);
+	header.compression = (u32)i_options.compression;
+
+	// material
+	const_cstr materialName = GetExportedMaterialName(i_mesh, i_materials);
+	CLOVER_INFO("---- material name: %s", materialName);
+	header.materialNameLength = (u32)strlen(materialName);
+
+	// indices
+	size accessorIdx = cJSON_GetObjectItemCaseSensitive(primitive, "indices")->valueint;
+	CLOVER_INFO("---- indices accessor index: %d", accessorIdx);
+	const gltf_loader::AccessorView indicesView = GetAccessorView(i_document, accessorIdx);
+	header.indicesCount = (s32)indicesView.count;
+	// with room for the lods
+	s32* indices = (s32*)g_TemporalArena.allocate(sizeof(s32) * GetLodsIndicesBound(header.indicesCount, i_options.lodsCount));
+	gltf_loader::CopyIndices(indicesView, indices);
+
+	// vertices, interleaved
+	const CbVertexLayout floatLayout = GetVertexLayout(i_options.vertexAttributes, VertexFormat::Float);
+	p8 vertices = GatherVertices(primitive, i_document, floatLayout, &header.verticesCount);
+
+	// on the f32 vertices, so that quantization does not merge vertices
+	MeshOptimizationStats stats;
+	MeshLod lods[k_MaxLodsCount];
+	header.verticesCount = OptimizeMesh((u32*)indices, header.indicesCount, vertices, header.verticesCount, floatLayout.stride,
+			i_options.lodsCount, i_options.lodError, lods, &header.lodsCount, &stats);
+	CLOVER_INFO("---- vertices: %d -> %d", stats.verticesCountBefore, stats.verticesCountAfter);
+	CLOVER_INFO("---- acmr: %4.3f -> %4.3f, overdraw: %4.3f -> %4.3f, overfetch: %4.3f -> %4.3f",
+			stats.acmrBefore, stats.acmrAfter, stats.overdrawBefore, stats.overdrawAfter, stats.overfetchBefore, stats.overfetchAfter);
+	for (u32 i = 0; i < header.lodsCount; i++)
+	{
+		CLOVER_INFO("---- lod %d: %d triangles, error: %f", i, lods[i].indicesCount / 3, lods[i].error);
+	}
+	if (header.lodsCount < i_options.lodsCount)
+	{
+		CLOVER_WARNING("---- the mesh cannot be simplified further, %d lods", header.lodsCount);
+	}
+
+	// lod 0 only, the simplified lods are for the meshes that are small on screen anyway
+	MeshCluster* clusters = nullptr;
+	if (i_options.buildClusters)
+	{
+		clusters = BuildClusters((u32*)indices, lods[0].indicesCount, vertices, header.verticesCount, floatLayout.stride,
+				&header.clustersCount);
+		CLOVER_INFO("---- clusters: %d", header.clustersCount);
+	}
+
+	// all the lods, back to back
+	header.indicesCount = (s32)(lods[header.lodsCount - 1].firstIndex + lods[header.lodsCount - 1].indicesCount);
+
+	if (i_options.vertexFormat != VertexFormat::Float)
+	{
+		p8 quantizedVertices = QuantizeVertices(vertices, floatLayout, header.vertexLayout, i_options.vertexFormat,
+				header.verticesCount, &header.quantization);
+		g_TemporalArena.free(vertices);
+		vertices = quantizedVertices;
+	}
+
+	p8 indicesData = (p8)indices;
+	p8 verticesData = vertices;
+	header.indicesSize = sizeof(s32) * header.indicesCount;
+	header.verticesSize = (size)header.vertexLayout.stride * header.verticesCount;
+	if (i_options.compression == Compression::MeshOptimizer)
+	{
+		size indicesSize = 0;
+		size verticesSize = 0;
+		indicesData = EncodeIndices((const u32*)indices, header.indicesCount, header.verticesCount, &indicesSize);
+		verticesData = EncodeVertices(vertices, header.verticesCount, header.vertexLayout.stride, &verticesSize);
+		CLOVER_INFO("---- compressed indices: %d -> %d bytes, vertices: %d -> %d bytes",
+				header.indicesSize, indicesSize, header.verticesSize, verticesSize);
+		header.indicesSize = indicesSize;
+		header.verticesSize = verticesSize;
+	}
+
+	const size start = io_os.get_pointer_position();
+	FLORAL_ASSERT(start % 16 == 0);
+	io_os.write(header);
+	header.materialNameOffset = io_os.get_pointer_position() - start;
+	io_os.write_bytes((voidptr)materialName, header.materialNameLength);
+	WritePadding(io_os, 4);
+	header.lodsOffset = io_os.get_pointer_position() - start;
+	io_os.write_bytes((voidptr)lods, sizeof(MeshLod) * header.lodsCount);
+	header.clustersOffset = io_os.get_pointer_position() - start;
+	if (clusters)
+	{
+		io_os.write_bytes((voidptr)clusters, sizeof(MeshCluster) * header.clustersCount);
+	}
+	WritePadding(io_os, 16);
+	header.indicesOffset = io_os.get_pointer_position() - start;
+	io_os.write_bytes(indicesData, header.indicesSize);
+	WritePadding(io_os, 16);
+	header.verticesOffset = io_os.get_pointer_position() - start;
+	io_os.write_bytes(verticesData, header.verticesSize);
+
+	const size end = io_os.get_pointer_position();
+	io_os.seek_begin(start);
+	io_os.write(header);
+	io_os.seek_begin(end);
+
+	if (i_options.compression != Compression::None)
+	{
+		g_TemporalArena.free(verticesData);
+		g_TemporalArena.free(indicesData);
+	}
+	if (clusters)
+	{
+		g_TemporalArena.free(clusters);
+	}
+	g_TemporalArena.free(vertices);
+	g_TemporalArena.free(indices);
+}
+
+void ExportMeshNoOverwrite(cJSON* i_mesh, cJSON* i_materials, const gltf_loader::Document& i_document,
+		const MeshExportOptions& i_options, const_cstr i_outputFileName)
+{
+	floral::file_info output = floral::open_output_file(i_outputFileName);
+	floral::output_file_stream os;
+	floral::map_output_file(output, os);
+	WriteMesh(i_mesh, i_materials, i_document, i_options, os);
+	floral::close_file(output);
+}
+
+// the translation, rotation and scale of a column major 4x4 matrix without shear
+CbNode DecomposeNodeMatrix(cJSON* i_matrix)
+{
+	f32 m[16];
+	for (s32 i = 0; i < 16; i++)
+	{
+		m[i] = (f32)(cJSON_GetArrayItem(i_matrix, i)->valuedouble);
+	}
+
+	CbNode nodeInfo;
+	nodeInfo.translation = floral::vec3f(m[12], m[13], m[14]);
+	nodeInfo.scale.x = sqrtf(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+	nodeInfo.scale.y = sqrtf(m[4] * m[4] + m[5] * m[5] + m[6] * m[6]);
+	nodeInfo.scale.z = sqrtf(m[8] * m[8] + m[9] * m[9] + m[10] * m[10]);
+
+	// a mirroring matrix has a negative determinant, the flip goes to the scale
+	const f32 det = m[0] * (m[5] * m[10] - m[9] * m[6]) - m[4] * (m[1] * m[10] - m[9] * m[2]) + m[8] * (m[1] * m[6] - m[5] * m[2]);
+	if (det < 0.0f)
+	{
+		nodeInfo.scale.x = -nodeInfo.scale.x;
+	}
+
+	// r[row][column] of the rotation
+	f32 r[3][3];
+	const f32 scale[3] = { nodeInfo.scale.x, nodeInfo.scale.y, nodeInfo.scale.z };
+	for (s32 c = 0; c < 3; c++)
+	{
+		const f32 invScale = scale[c] != 0.0f ? 1.0f / scale[c] : 0.0f;
+		for (s32 row = 0; row < 3; row++)
 		{
-			CLOVER_INFO("---- NORMAL accessor index: %d", normal->valueint);
-			BufferViewDescription desc = GetBufferViewDescription(i_accessors, i_bufferViews, normal->valueint);
-			header.normalOffset = os.get_pointer_position();
-			i_binStream.seek_begin(desc.byteOffset);
-			for (size i = 0; i < desc.elementCount; i++)
-			{
-				floral::vec3f v(0.0f, 0.0f, 0.0f);
-				i_binStream.read(&v);
-				os.write(v);
-			}
+			r[row][c] = m[c * 4 + row] * invScale;
 		}
+	}
 
-		cJSON* tangent = cJSON_GetObjectItemCaseSensitive(attributes, "TANGENT");
-		if (tangent)
+	const f32 trace = r[0][0] + r[1][1] + r[2][2];
+	floral::quaternionf& q = nodeInfo.rotation;
+	if (trace > 0.0f)
+	{
+		const f32 k = sqrtf(trace + 1.0f) * 2.0f;
+		q.w = 0.25f * k;
+		q.v.x = (r[2][1] - r[1][2]) / k;
+		q.v.y = (r[0][2] - r[2][0]) / k;
+		q.v.z = (r[1][0] - r[0][1]) / k;
+	}
+	else if (r[0][0] > r[1][1] && r[0][0] > r[2][2])
+	{
+		const f32 k = sqrtf(1.0f + r[0][0] - r[1][1] - r[2][2]) * 2.0f;
+		q.w = (r[2][1] - r[1][2]) / k;
+		q.v.x = 0.25f * k;
+		q.v.y = (r[0][1] + r[1][0]) / k;
+		q.v.z = (r[0][2] + r[2][0]) / k;
+	}
+	else if (r[1][1] > r[2][2])
+	{
+		const f32 k = sqrtf(1.0f + r[1][1] - r[0][0] - r[2][2]) * 2.0f;
+		q.w = (r[0][2] - r[2][0]) / k;
+		q.v.x = (r[0][1] + r[1][0]) / k;
+		q.v.y = 0.25f * k;
+		q.v.z = (r[1][2] + r[2][1]) / k;
+	}
+	else
+	{
+		const f32 k = sqrtf(1.0f + r[2][2] - r[0][0] - r[1][1]) * 2.0f;
+		q.w = (r[1][0] - r[0][1]) / k;
+		q.v.x = (r[0][2] + r[2][0]) / k;
+		q.v.y = (r[1][2] + r[2][1]) / k;
+		q.v.z = 0.25f * k;
+	}
+	return nodeInfo;
+}
+
+CbNode ReadNodeInfo(cJSON* i_node)
+{
+	// a node has either a matrix or any of translation, rotation and scale
+	if (cJSON_HasObjectItem(i_node, "matrix"))
+	{
+		return DecomposeNodeMatrix(cJSON_GetObjectItemCaseSensitive(i_node, "matrix"));
+	}
+
+	CbNode nodeInfo;
+	nodeInfo.translation = floral::vec3f(0.0f, 0.0f, 0.0f);
+	nodeInfo.rotation = floral::quaternionf();
+	nodeInfo.scale = floral::vec3f(1.0f, 1.0f, 1.0f);
+
+	if (cJSON_HasObjectItem(i_node, "translation"))
+	{
+		cJSON* translation = cJSON_GetObjectItemCaseSensitive(i_node, "translation");
+		nodeInfo.translation.x = (f32)(cJSON_GetArrayItem(translation, 0)->valuedouble);
+		nodeInfo.translation.y = (f32)(cJSON_GetArrayItem(translation, 1)->valuedouble);
+		nodeInfo.translation.z = (f32)(cJSON_GetArrayItem(translation, 2)->valuedouble);
+	}
+
+	if (cJSON_HasObjectItem(i_node, "rotation"))
+	{
+		cJSON* rotation = cJSON_GetObjectItemCaseSensitive(i_node, "rotation");
+		nodeInfo.rotation.v.x = (f32)(cJSON_GetArrayItem(rotation, 0)->valuedouble);
+		nodeInfo.rotation.v.y = (f32)(cJSON_GetArrayItem(rotation, 1)->valuedouble);
+		nodeInfo.rotation.v.z = (f32)(cJSON_GetArrayItem(rotation, 2)->valuedouble);
+		nodeInfo.rotation.w = (f32)(cJSON_GetArrayItem(rotation, 3)->valuedouble);
+	}
+
+	if (cJSON_HasObjectItem(i_node, "scale"))
+	{
+		cJSON* scale = cJSON_GetObjectItemCaseSensitive(i_node, "scale");
+		nodeInfo.scale.x = (f32)(cJSON_GetArrayItem(scale, 0)->valuedouble);
+		nodeInfo.scale.y = (f32)(cJSON_GetArrayItem(scale, 1)->valuedouble);
+		nodeInfo.scale.z = (f32)(cJSON_GetArrayItem(scale, 2)->valuedouble);
+	}
+
+	return nodeInfo;
+}
+
+// the gltf mesh of the node, -1 when it has none or when its index is out of the meshes
+const s32 GetNodeMeshIdx(cJSON* i_node, const u32 i_meshesCount)
+{
+	if (!cJSON_HasObjectItem(i_node, "mesh"))
+	{
+		return -1;
+	}
+
+	const s32 meshIdx = cJSON_GetObjectItemCaseSensitive(i_node, "mesh")->valueint;
+	if (meshIdx < 0 || meshIdx >= (s32)i_meshesCount)
+	{
+		CLOVER_ERROR("Mesh #%d of the node is out of the %d meshes, skipped", meshIdx, i_meshesCount);
+		return -1;
+	}
+	return meshIdx;
+}
+
+// the node and the index of its parent in the exported order
+struct SceneNode
+{
+	s32											gltfNodeIdx;
+	s32											parentIdx;
+};
+
+// the nodes of the scene and all their descendants, depth first so that the parents come before their children
+u32 GatherSceneNodes(cJSON* i_scene, cJSON* i_nodes, SceneNode* o_sceneNodes)
+{
+	using namespace baker;
+	const u32 gltfNodesCount = (u32)cJSON_GetArraySize(i_nodes);
+	SceneNode* stack = (SceneNode*)g_TemporalArena.allocate(sizeof(SceneNode) * gltfNodesCount);
+	bool* visited = (bool*)g_TemporalArena.allocate(sizeof(bool) * gltfNodesCount);
+	memset(visited, 0, sizeof(bool) * gltfNodesCount);
+	u32 stackSize = 0;
+	u32 nodesCount = 0;
+
+	// pushed in reverse to be exported in the order of the gltf
+	cJSON* rootNodes = cJSON_GetObjectItemCaseSensitive(i_scene, "nodes");
+	for (s32 i = cJSON_GetArraySize(rootNodes) - 1; i >= 0 && stackSize < gltfNodesCount; i--)
+	{
+		stack[stackSize].gltfNodeIdx = cJSON_GetArrayItem(rootNodes, i)->valueint;
+		stack[stackSize].parentIdx = -1;
+		stackSize++;
+	}
+
+	while (stackSize > 0)
+	{
+		const SceneNode sceneNode = stack[--stackSize];
+		if (sceneNode.gltfNodeIdx < 0 || sceneNode.gltfNodeIdx >= (s32)gltfNodesCount || visited[sceneNode.gltfNodeIdx])
 		{
-			CLOVER_INFO("---- TANGENT accessor index: %d", tangent->valueint);
-			BufferViewDescription desc = GetBufferViewDescription(i_accessors, i_bufferViews, tangent->valueint);
-			header.tangentOffset = os.get_pointer_position();
-			i_binStream.seek_begin(desc.byteOffset);
-			for (size i = 0; i < desc.elementCount; i++)
-			{
-				floral::vec4f v(0.0f, 0.0f, 0.0f, 0.0f);
-				i_binStream.read(&v);
-				floral::vec3f cbVec(v.x, v.y, v.z);
-				os.write(cbVec);
-			}
+			CLOVER_ERROR("Node #%d is invalid or has several parents, skipped", sceneNode.gltfNodeIdx);
+			continue;
 		}
+		visited[sceneNode.gltfNodeIdx] = true;
 
-		cJSON* texcoord = cJSON_GetObjectItemCaseSensitive(attributes, "TEXCOORD_0");
-		if (texcoord)
+		const s32 nodeIdx = (s32)nodesCount;
+		o_sceneNodes[nodesCount++] = sceneNode;
+		cJSON* children = cJSON_GetObjectItemCaseSensitive(cJSON_GetArrayItem(i_nodes, sceneNode.gltfNodeIdx), "children");
+		for (s32 i = cJSON_GetArraySize(children) - 1; i >= 0 && stackSize < gltfNodesCount; i--)
 		{
-			CLOVER_INFO("---- TEXCOORD_0 accessor index: %d", texcoord->valueint);
-			BufferViewDescription desc = GetBufferViewDescription(i_accessors, i_bufferViews, texcoord->valueint);
-			header.texcoordOffset = os.get_pointer_position();
-			i_binStream.seek_begin(desc.byteOffset);
-			for (size i = 0; i < desc.elementCount; i++)
-			{
-				floral::vec2f v(0.0f, 0.0f);
-				i_binStream.read(&v);
-				os.write(v);
-			}
+			stack[stackSize].gltfNodeIdx = cJSON_GetArrayItem(children, i)->valueint;
+			stack[stackSize].parentIdx = nodeIdx;
+			stackSize++;
 		}
 	}
 
-	os.seek_begin(0);
-	os.write(header);
-	floral::close_file(output);
+	g_TemporalArena.free(visited);
+	g_TemporalArena.free(stack);
+	return nodesCount;
 }
 
-void ExportScene(const_cstr i_gltfFile, const_cstr i_outputDir)
+void WriteSceneString(floral::output_file_stream& io_os, const_cstr i_str)
 {
-	using namespace baker;
-	floral::file_info inp = floral::open_file(i_gltfFile);
-	floral::file_stream inpStream;
-	inpStream.buffer = (p8)g_ParserAllocator.allocate(inp.file_size + 1);
-	floral::read_all_file(inp, inpStream);
-	floral::close_file(inp);
+	s32 len = (s32)strlen(i_str);
+	io_os.write(len);
+	io_os.write_bytes((voidptr)i_str, len);
+}
 
-	InitializeJSONParser(&g_ParserAllocator);
-	cJSON* json = cJSON_Parse((const_cstr)inpStream.buffer);
+void ExportScene(const_cstr i_gltfFile, const_cstr i_outputDir, const MeshExportOptions& i_options)
+{
+	using namespace baker;
+	GLTFInput input;
+	if (!OpenGLTF(i_gltfFile, &input))
+	{
+		return;
+	}
+	cJSON* json = input.json;
 
 	cJSON* scenes = cJSON_GetObjectItemCaseSensitive(json, "scenes");
 	CLOVER_INFO("Scenes count: %d", cJSON_GetArraySize(scenes));
@@ -465,28 +873,55 @@ void ExportScene(const_cstr i_gltfFile, const_cstr i_outputDir)
 	cJSON* meshes = cJSON_GetObjectItemCaseSensitive(json, "meshes");
 	CLOVER_INFO("Meshes count: %d", cJSON_GetArraySize(meshes));
 
-	cJSON* accessors = cJSON_GetObjectItemCaseSensitive(json, "accessors");
-	CLOVER_INFO("Accessors count: %d", cJSON_GetArraySize(accessors));
-
-	cJSON* bufferViews = cJSON_GetObjectItemCaseSensitive(json, "bufferViews");
-	CLOVER_INFO("BufferViews count: %d", cJSON_GetArraySize(bufferViews));
-
-	cJSON* buffers = cJSON_GetObjectItemCaseSensitive(json, "buffers");
-	CLOVER_INFO("Buffers count: %d", cJSON_GetArraySize(buffers));
+	CLOVER_INFO("Accessors count: %d", gltf_loader::GetAccessorsCount(input.document));
+	CLOVER_INFO("BufferViews count: %d", gltf_loader::GetBufferViewsCount(input.document));
 
 	cJSON* materials = cJSON_GetObjectItemCaseSensitive(json, "materials");
 	CLOVER_INFO("Materials count: %d", cJSON_GetArraySize(materials));
 
-	// read buffer into memory here
-	cJSON* buffer = cJSON_GetArrayItem(buffers, 0);
-	const_cstr binFilename = cJSON_GetObjectItemCaseSensitive(buffer, "uri")->valuestring;
-	CLOVER_INFO("Buffer file name: %s", binFilename);
-	CLOVER_INFO("Buffer file size: %d", cJSON_GetObjectItemCaseSensitive(buffer, "byteLength")->valueint);
-	floral::file_info binInp = floral::open_file(binFilename);
-	floral::file_stream binInpStream;
-	binInpStream.buffer = (p8)g_TemporalAllocator.allocate(binInp.file_size);
-	floral::read_all_file(binInp, binInpStream);
-	floral::close_file(binInp);
+	CLOVER_INFO(">>> Begin exporting");
+	s32 selectedScene = cJSON_GetObjectItemCaseSensitive(json, "scene")->valueint;
+	CLOVER_INFO("Exporting scene #%d", selectedScene);
+	cJSON* scene = cJSON_GetArrayItem(scenes, selectedScene);
+
+	const u32 gltfMeshesCount = (u32)cJSON_GetArraySize(meshes);
+	SceneNode* sceneNodes = (SceneNode*)g_TemporalArena.allocate(sizeof(SceneNode) * cJSON_GetArraySize(nodes));
+	c8* meshFileNames = (c8*)g_TemporalArena.allocate(512 * gltfMeshesCount);
+	s32* sceneMeshIndices = (s32*)g_TemporalArena.allocate(sizeof(s32) * gltfMeshesCount);	// gltf mesh -> scene mesh
+	for (u32 i = 0; i < gltfMeshesCount; i++)
+	{
+		sceneMeshIndices[i] = -1;
+	}
+	const u32 nodesCount = GatherSceneNodes(scene, nodes, sceneNodes);
+
+	// every mesh once, however many nodes instance it
+	CbSceneHeader sceneHeader;
+	sceneHeader.magicCharacters[0] = 'C';
+	sceneHeader.magicCharacters[1] = 'B';
+	sceneHeader.magicCharacters[2] = 'S';
+	sceneHeader.magicCharacters[3] = 'C';
+	sceneHeader.version = k_CbSceneFileVersion;
+	sceneHeader.nodesCount = nodesCount;
+	sceneHeader.meshesCount = 0;
+	for (u32 i = 0; i < nodesCount; i++)
+	{
+		cJSON* node = cJSON_GetArrayItem(nodes, sceneNodes[i].gltfNodeIdx);
+		const s32 meshIdx = GetNodeMeshIdx(node, gltfMeshesCount);
+		if (meshIdx < 0 || sceneMeshIndices[meshIdx] >= 0)
+		{
+			continue;
+		}
+
+		cJSON* mesh = cJSON_GetArrayItem(meshes, meshIdx);
+		const_cstr meshName = cJSON_GetObjectItemCaseSensitive(mesh, "name")->valuestring;
+		CLOVER_INFO("Exporting mesh #%d: %s", meshIdx, meshName);
+		cstr outputModelFileName = meshFileNames + 512 * sceneHeader.meshesCount;
+		sprintf(outputModelFileName, "%s_%s_%d.cbmodel", i_gltfFile, meshName, meshIdx);
+		CLOVER_INFO("-- output filename: %s", outputModelFileName);
+		ExportMeshNoOverwrite(mesh, materials, input.document, i_options, outputModelFileName);
+		sceneMeshIndices[meshIdx] = (s32)sceneHeader.meshesCount;
+		sceneHeader.meshesCount++;
+	}
 
 	c8 outputSceneFileName[512];
 	sprintf(outputSceneFileName, "%s.cbscene", i_gltfFile);
@@ -494,87 +929,326 @@ void ExportScene(const_cstr i_gltfFile, const_cstr i_outputDir)
 	floral::output_file_stream os;
 	floral::map_output_file(output, os);
 
-	CLOVER_INFO(">>> Begin exporting");
+	os.write(sceneHeader);
+	for (u32 i = 0; i < sceneHeader.meshesCount; i++)
+	{
+		WriteSceneString(os, meshFileNames + 512 * i);
+	}
+
+	CLOVER_INFO("Exporting %d nodes", nodesCount);
+	for (u32 i = 0; i < nodesCount; i++)
+	{
+		cJSON* node = cJSON_GetArrayItem(nodes, sceneNodes[i].gltfNodeIdx);
+		cJSON* name = cJSON_GetObjectItemCaseSensitive(node, "name");
+		const_cstr nodeName = cJSON_IsString(name) ? name->valuestring : "";
+		const s32 gltfMeshIdx = GetNodeMeshIdx(node, gltfMeshesCount);
+		const s32 meshIdx = gltfMeshIdx >= 0 ? sceneMeshIndices[gltfMeshIdx] : -1;
+		CLOVER_INFO("- #%d: %s, parent: %d, mesh: %d", sceneNodes[i].gltfNodeIdx, nodeName, sceneNodes[i].parentIdx, meshIdx);
+
+		WriteSceneString(os, nodeName);
+		os.write(sceneNodes[i].parentIdx);
+		os.write(meshIdx);
+		CbNode nodeInfo = ReadNodeInfo(node);
+		os.write(nodeInfo);
+	}
+	floral::close_file(output);
+
+	g_TemporalArena.free(sceneMeshIndices);
+	g_TemporalArena.free(meshFileNames);
+	g_TemporalArena.free(sceneNodes);
+
+	CLOVER_INFO("<<< End exporting");
+}
+
+// appends i_str to the string table, returns its offset
+u32 AddString(p8 io_strings, u32* io_stringsSize, const_cstr i_str)
+{
+	const u32 offset = *io_stringsSize;
+	const u32 len = (u32)strlen(i_str);
+	memcpy(io_strings + offset, i_str, len + 1);
+	*io_stringsSize += len + 1;
+	return offset;
+}
+
+void ExportScenePackage(const_cstr i_gltfFile, const MeshExportOptions& i_options)
+{
+	using namespace baker;
+	GLTFInput input;
+	if (!OpenGLTF(i_gltfFile, &input))
+	{
+		return;
+	}
+	cJSON* json = input.json;
+
+	cJSON* scenes = cJSON_GetObjectItemCaseSensitive(json, "scenes");
+	cJSON* nodes = cJSON_GetObjectItemCaseSensitive(json, "nodes");
+	cJSON* meshes = cJSON_GetObjectItemCaseSensitive(json, "meshes");
+	cJSON* materials = cJSON_GetObjectItemCaseSensitive(json, "materials");
+
+	CLOVER_INFO(">>> Begin exporting package");
 	s32 selectedScene = cJSON_GetObjectItemCaseSensitive(json, "scene")->valueint;
-	CLOVER_INFO("Exporting scene #%d", selectedScene);
 	cJSON* scene = cJSON_GetArrayItem(scenes, selectedScene);
-	cJSON* selectedNodes = cJSON_GetObjectItemCaseSensitive(scene, "nodes");
-	size selectedNodesCount = cJSON_GetArraySize(selectedNodes);
-
-	CbSceneHeader sceneHeader;
-	sceneHeader.nodesCount = 0;
-	os.write(sceneHeader);
+	const u32 gltfMeshesCount = (u32)cJSON_GetArraySize(meshes);
+	SceneNode* sceneNodes = (SceneNode*)g_TemporalArena.allocate(sizeof(SceneNode) * cJSON_GetArraySize(nodes));
+	const u32 nodesCount = GatherSceneNodes(scene, nodes, sceneNodes);
+
+	// every name is in the gltf, so is the string table
+	p8 strings = (p8)g_TemporalArena.allocate(input.fileSize + 1);
+	u32 stringsSize = 0;
+	CbPackageNode* packageNodes = (CbPackageNode*)g_TemporalArena.allocate(sizeof(CbPackageNode) * nodesCount);
+	CbPackageMesh* packageMeshes = (CbPackageMesh*)g_TemporalArena.allocate(sizeof(CbPackageMesh) * gltfMeshesCount);
+	CbPackageMaterial* packageMaterials = (CbPackageMaterial*)g_TemporalArena.allocate(sizeof(CbPackageMaterial) * gltfMeshesCount);
+	s32* gltfMeshes = (s32*)g_TemporalArena.allocate(sizeof(s32) * gltfMeshesCount);	// package mesh -> gltf mesh
+	s32* packageMeshIndices = (s32*)g_TemporalArena.allocate(sizeof(s32) * gltfMeshesCount);	// gltf mesh -> package mesh
+	for (u32 i = 0; i < gltfMeshesCount; i++)
+	{
+		packageMeshIndices[i] = -1;
+	}
+	u32 meshesCount = 0;
+	u32 materialsCount = 0;
 
-	CLOVER_INFO("Exporting %d nodes", selectedNodesCount);
-	for (size i = 0; i < selectedNodesCount; i++)
+	// the tables first, the meshes are shared by the nodes using them; the nodes without geometry are kept
+	// for the transforms of their children
+	for (u32 i = 0; i < nodesCount; i++)
 	{
-		size selectedNodeIdx = cJSON_GetArrayItem(selectedNodes, i)->valueint;
-		CLOVER_INFO("Exporting node: #%d", selectedNodeIdx);
-		cJSON* node = cJSON_GetArrayItem(nodes, selectedNodeIdx);
-		const_cstr nodeName = cJSON_GetObjectItemCaseSensitive(node, "name")->valuestring;
-		CLOVER_INFO("- name: %s", nodeName);
-		if (cJSON_HasObjectItem(node, "mesh"))
+		cJSON* node = cJSON_GetArrayItem(nodes, sceneNodes[i].gltfNodeIdx);
+		cJSON* name = cJSON_GetObjectItemCaseSensitive(node, "name");
+		const_cstr nodeName = cJSON_IsString(name) ? name->valuestring : "";
+		const s32 meshIdx = GetNodeMeshIdx(node, gltfMeshesCount);
+		if (meshIdx >= 0 && packageMeshIndices[meshIdx] < 0)
 		{
-			size meshIdx = cJSON_GetObjectItemCaseSensitive(node, "mesh")->valueint;
-			CLOVER_INFO("- mesh: %d", meshIdx);
 			cJSON* mesh = cJSON_GetArrayItem(meshes, meshIdx);
-			const_cstr meshName = cJSON_GetObjectItemCaseSensitive(mesh, "name")->valuestring;
-			CLOVER_INFO("-- name: %s", meshName);
-			c8 outputModelFileName[512];
-			sprintf(outputModelFileName, "%s_%s_%llu.cbmodel", i_gltfFile, meshName, meshIdx);
-			CLOVER_INFO("-- output filename: %s", outputModelFileName);
-			ExportMeshNoOverwrite(mesh, materials, accessors, bufferViews, binInpStream, outputModelFileName);
-
-			CbNode nodeInfo;
-			nodeInfo.translation = floral::vec3f(0.0f, 0.0f, 0.0f);
-			nodeInfo.rotation = floral::quaternionf();
-			nodeInfo.scale = floral::vec3f(1.0f, 1.0f, 1.0f);
-
-			if (cJSON_HasObjectItem(node, "translation"))
+			const_cstr materialName = GetExportedMaterialName(mesh, materials);
+			u32 materialIdx = 0;
+			while (materialIdx < materialsCount && strcmp((const_cstr)strings + packageMaterials[materialIdx].nameOffset, materialName) != 0)
 			{
-				cJSON* translation = cJSON_GetObjectItemCaseSensitive(node, "translation");
-				nodeInfo.translation.x = (f32)(cJSON_GetArrayItem(translation, 0)->valuedouble);
-				nodeInfo.translation.y = (f32)(cJSON_GetArrayItem(translation, 1)->valuedouble);
-				nodeInfo.translation.z = (f32)(cJSON_GetArrayItem(translation, 2)->valuedouble);
+				materialIdx++;
 			}
-
-			if (cJSON_HasObjectItem(node, "rotation"))
+			if (materialIdx == materialsCount)
 			{
-				cJSON* rotation = cJSON_GetObjectItemCaseSensitive(node, "rotation");
-				nodeInfo.rotation.v.x = (f32)(cJSON_GetArrayItem(rotation, 0)->valuedouble);
-				nodeInfo.rotation.v.y = (f32)(cJSON_GetArrayItem(rotation, 1)->valuedouble);
-				nodeInfo.rotation.v.z = (f32)(cJSON_GetArrayItem(rotation, 2)->valuedouble);
-				nodeInfo.rotation.w = (f32)(cJSON_GetArrayItem(rotation, 2)->valuedouble);
+				packageMaterials[materialsCount].nameOffset = AddString(strings, &stringsSize, materialName);
+				materialsCount++;
 			}
 
-			if (cJSON_HasObjectItem(node, "scale"))
-			{
-				cJSON* scale = cJSON_GetObjectItemCaseSensitive(node, "scale");
-				nodeInfo.scale.x = (f32)(cJSON_GetArrayItem(scale, 0)->valuedouble);
-				nodeInfo.scale.y = (f32)(cJSON_GetArrayItem(scale, 1)->valuedouble);
-				nodeInfo.scale.z = (f32)(cJSON_GetArrayItem(scale, 2)->valuedouble);
-			}
+			CbPackageMesh& packageMesh = packageMeshes[meshesCount];
+			packageMesh.nameOffset = AddString(strings, &stringsSize, cJSON_GetObjectItemCaseSensitive(mesh, "name")->valuestring);
+			packageMesh.materialIdx = materialIdx;
+			packageMesh.offset = 0;
+			packageMesh.size = 0;
+			gltfMeshes[meshesCount] = meshIdx;
+			packageMeshIndices[meshIdx] = (s32)meshesCount;
+			meshesCount++;
+		}
+
+		CbPackageNode& packageNode = packageNodes[i];
+		packageNode.nameOffset = AddString(strings, &stringsSize, nodeName);
+		packageNode.parentIdx = sceneNodes[i].parentIdx;
+		packageNode.meshIdx = meshIdx >= 0 ? packageMeshIndices[meshIdx] : -1;
+		packageNode.transform = ReadNodeInfo(node);
+	}
+	CLOVER_INFO("%d nodes, %d meshes, %d materials", nodesCount, meshesCount, materialsCount);
+
+	c8 outputPackageFileName[512];
+	sprintf(outputPackageFileName, "%s.cbpkg", i_gltfFile);
+	floral::file_info output = floral::open_output_file(outputPackageFileName);
+	floral::output_file_stream os;
+	floral::map_output_file(output, os);
+
+	CbPackageFileHeader header;
+	memset(&header, 0, sizeof(CbPackageFileHeader));
+	header.magicCharacters[0] = 'C';
+	header.magicCharacters[1] = 'B';
+	header.magicCharacters[2] = 'P';
+	header.magicCharacters[3] = 'K';
+	header.version = k_CbPackageFileVersion;
+	header.nodesCount = nodesCount;
+	header.meshesCount = meshesCount;
+	header.materialsCount = materialsCount;
+	header.stringTableSize = stringsSize;
+	os.write(header);
+
+	header.nodesOffset = os.get_pointer_position();
+	os.write_bytes(packageNodes, sizeof(CbPackageNode) * nodesCount);
+	header.meshesOffset = os.get_pointer_position();
+	os.write_bytes(packageMeshes, sizeof(CbPackageMesh) * meshesCount);	// the blobs' offsets are patched below
+	header.materialsOffset = os.get_pointer_position();
+	os.write_bytes(packageMaterials, sizeof(CbPackageMaterial) * materialsCount);
+	header.stringTableOffset = os.get_pointer_position();
+	os.write_bytes(strings, stringsSize);
+
+	for (u32 i = 0; i < meshesCount; i++)
+	{
+		cJSON* mesh = cJSON_GetArrayItem(meshes, gltfMeshes[i]);
+		CLOVER_INFO("Exporting mesh: %s", (const_cstr)strings + packageMeshes[i].nameOffset);
+		WritePadding(os, 16);
+		packageMeshes[i].offset = os.get_pointer_position();
+		WriteMesh(mesh, materials, input.document, i_options, os);
+		packageMeshes[i].size = os.get_pointer_position() - packageMeshes[i].offset;
+	}
+
+	os.seek_begin(0);
+	os.write(header);
+	os.seek_begin(header.meshesOffset);
+	os.write_bytes(packageMeshes, sizeof(CbPackageMesh) * meshesCount);
+	floral::close_file(output);
+
+	g_TemporalArena.free(packageMeshIndices);
+	g_TemporalArena.free(gltfMeshes);
+	g_TemporalArena.free(packageMaterials);
+	g_TemporalArena.free(packageMeshes);
+	g_TemporalArena.free(packageNodes);
+	g_TemporalArena.free(strings);
+	g_TemporalArena.free(sceneNodes);
+
+	CLOVER_INFO("<<< End exporting package");
+}
+
+struct QuantizationErrors
+{
+	size										verticesCount;
+	f32											maxPositionError;
+	f64											sumPositionError;
+	f32											maxRelativePositionError;	// to the bounding box diagonal
+	f32											maxNormalDegrees;
+	f64											sumNormalDegrees;
+	f32											maxTangentDegrees;
+	f64											sumTangentDegrees;
+	f32											maxTexcoordError;
+	f64											sumTexcoordError;
+};
+
+inline const f32 GetAngleDegrees(const floral::vec3f& i_a, const floral::vec3f& i_b)
+{
+	// atan2 rather than acos, which has no precision for the small angles we measure
+	const floral::vec3f c(i_a.y * i_b.z - i_a.z * i_b.y, i_a.z * i_b.x - i_a.x * i_b.z, i_a.x * i_b.y - i_a.y * i_b.x);
+	const f32 sinAngle = sqrtf(c.x * c.x + c.y * c.y + c.z * c.z);
+	const f32 cosAngle = i_a.x * i_b.x + i_a.y * i_b.y + i_a.z * i_b.z;
+	return atan2f(sinAngle, cosAngle) * 180.0f / 3.14159265f;
+}
 
-			s32 nodeNameLen = strlen(nodeName);
-			os.write(nodeNameLen);
-			os.write_bytes((voidptr)nodeName, nodeNameLen);
-			s32 fileNamelen = strlen(outputModelFileName);
-			os.write(fileNamelen);
-			os.write_bytes((voidptr)outputModelFileName, fileNamelen);
-			os.write(nodeInfo);
-			sceneHeader.nodesCount++;
+// quantizes then decodes the vertices, accumulates the differences to the f32 ones in io_errors
+void MeasureQuantizationErrors(const p8 i_vertices, const CbVertexLayout& i_layout, const baker::VertexFormat i_format,
+		const s32 i_verticesCount, QuantizationErrors* io_errors)
+{
+	using namespace baker;
+	const CbVertexLayout quantizedLayout = GetVertexLayout(i_layout.attributes, i_format);
+	Quantization quantization;
+	p8 quantizedVertices = QuantizeVertices(i_vertices, i_layout, quantizedLayout, i_format, i_verticesCount, &quantization);
+
+	const size verticesSize = (size)i_layout.stride * i_verticesCount;
+	p8 decodedVertices = (p8)g_TemporalArena.allocate(verticesSize);
+	memset(decodedVertices, 0, verticesSize);
+	for (u32 i = 0; i < k_VertexAttributesCount; i++)
+	{
+		if (i_layout.attributes & (1u << i))
+		{
+			DecodeAttribute(quantizedVertices + quantizedLayout.offsets[i], quantizedLayout.stride, i_format, quantization, i,
+					decodedVertices + i_layout.offsets[i], i_layout.stride, i_verticesCount);
 		}
-		else
+	}
+
+	const floral::vec3f& extent = quantization.positionScale;
+	const f32 diagonal = sqrtf(extent.x * extent.x + extent.y * extent.y + extent.z * extent.z);
+	for (s32 v = 0; v < i_verticesCount; v++)
+	{
+		const p8 src = i_vertices + v * i_layout.stride;
+		const p8 dst = decodedVertices + v * i_layout.stride;
+		floral::vec3f a, b;
+		memcpy(&a, src + i_layout.offsets[0], sizeof(floral::vec3f));
+		memcpy(&b, dst + i_layout.offsets[0], sizeof(floral::vec3f));
+		const floral::vec3f d(a.x - b.x, a.y - b.y, a.z - b.z);
+		const f32 positionError = sqrtf(d.x * d.x + d.y * d.y + d.z * d.z);
+		io_errors->maxPositionError = fmaxf(io_errors->maxPositionError, positionError);
+		io_errors->sumPositionError += positionError;
+		if (diagonal > 0.0f)
+		{
+			io_errors->maxRelativePositionError = fmaxf(io_errors->maxRelativePositionError, positionError / diagonal);
+		}
+
+		if (i_layout.attributes & (u32)VertexAttribute::Normal)
+		{
+			memcpy(&a, src + i_layout.offsets[1], sizeof(floral::vec3f));
+			memcpy(&b, dst + i_layout.offsets[1], sizeof(floral::vec3f));
+			const f32 degrees = GetAngleDegrees(a, b);
+			io_errors->maxNormalDegrees = fmaxf(io_errors->maxNormalDegrees, degrees);
+			io_errors->sumNormalDegrees += degrees;
+		}
+
+		if (i_layout.attributes & (u32)VertexAttribute::Tangent)
 		{
-			CLOVER_INFO("non-geometry node...skipping...");
+			memcpy(&a, src + i_layout.offsets[2], sizeof(floral::vec3f));
+			memcpy(&b, dst + i_layout.offsets[2], sizeof(floral::vec3f));
+			const f32 degrees = GetAngleDegrees(a, b);
+			io_errors->maxTangentDegrees = fmaxf(io_errors->maxTangentDegrees, degrees);
+			io_errors->sumTangentDegrees += degrees;
+		}
+
+		if (i_layout.attributes & (u32)VertexAttribute::TexCoord)
+		{
+			floral::vec2f uvA, uvB;
+			memcpy(&uvA, src + i_layout.offsets[3], sizeof(floral::vec2f));
+			memcpy(&uvB, dst + i_layout.offsets[3], sizeof(floral::vec2f));
+			const f32 texcoordError = fmaxf(fabsf(uvA.x - uvB.x), fabsf(uvA.y - uvB.y));
+			io_errors->maxTexcoordError = fmaxf(io_errors->maxTexcoordError, texcoordError);
+			io_errors->sumTexcoordError += texcoordError;
 		}
 	}
-	
-	os.seek_begin(0);
-	os.write(sceneHeader);
-	floral::close_file(output);
+	io_errors->verticesCount += i_verticesCount;
 
-	CLOVER_INFO("<<< End exporting");
+	g_TemporalArena.free(decodedVertices);
+	g_TemporalArena.free(quantizedVertices);
+}
+
+// the size and the error of every quantized format on all the meshes of the gltf, nothing is written
+void BenchmarkQuantization(const_cstr i_gltfFile, const u32 i_vertexAttributes)
+{
+	using namespace baker;
+	GLTFInput input;
+	if (!OpenGLTF(i_gltfFile, &input))
+	{
+		return;
+	}
+	cJSON* json = input.json;
+
+	cJSON* meshes = cJSON_GetObjectItemCaseSensitive(json, "meshes");
+
+	static const VertexFormat k_Formats[] = { VertexFormat::Quantized16, VertexFormat::Quantized8 };
+	static const_cstr k_FormatNames[] = { "quantized16", "quantized8" };
+	static const u32 k_FormatsCount = 2;
+	QuantizationErrors errors[k_FormatsCount];
+	memset(errors, 0, sizeof(errors));
+
+	const CbVertexLayout floatLayout = GetVertexLayout(i_vertexAttributes, VertexFormat::Float);
+	const u32 meshesCount = (u32)cJSON_GetArraySize(meshes);
+	for (u32 i = 0; i < meshesCount; i++)
+	{
+		cJSON* mesh = cJSON_GetArrayItem(meshes, i);
+		CLOVER_INFO("Measuring mesh: %s", cJSON_GetObjectItemCaseSensitive(mesh, "name")->valuestring);
+		s32 verticesCount = 0;
+		p8 vertices = GatherVertices(GetExportedPrimitive(mesh), input.document, floatLayout, &verticesCount);
+		for (u32 f = 0; f < k_FormatsCount; f++)
+		{
+			MeasureQuantizationErrors(vertices, floatLayout, k_Formats[f], verticesCount, &errors[f]);
+		}
+		g_TemporalArena.free(vertices);
+	}
+
+	const size verticesCount = errors[0].verticesCount;
+	CLOVER_INFO("%d meshes, %d vertices", meshesCount, verticesCount);
+	CLOVER_INFO("float: %d bytes / vertex, %4.2f MB", floatLayout.stride, (f32)(floatLayout.stride * verticesCount) / (1024.0f * 1024.0f));
+	for (u32 f = 0; f < k_FormatsCount; f++)
+	{
+		const QuantizationErrors& e = errors[f];
+		const u32 stride = GetVertexLayout(i_vertexAttributes, k_Formats[f]).stride;
+		const f64 count = verticesCount > 0 ? (f64)verticesCount : 1.0;
+		CLOVER_INFO("%s: %d bytes / vertex, %4.2f MB (%3.1f%% of float)", k_FormatNames[f], stride,
+				(f32)(stride * verticesCount) / (1024.0f * 1024.0f), 100.0f * (f32)stride / (f32)floatLayout.stride);
+		CLOVER_INFO("- position error: max %f, mean %f, max %f%% of the bounding box diagonal",
+				e.maxPositionError, (f32)(e.sumPositionError / count), 100.0f * e.maxRelativePositionError);
+		CLOVER_INFO("- normal error: max %5.4f deg, mean %5.4f deg", e.maxNormalDegrees, (f32)(e.sumNormalDegrees / count));
+		CLOVER_INFO("- tangent error: max %5.4f deg, mean %5.4f deg", e.maxTangentDegrees, (f32)(e.sumTangentDegrees / count));
+		CLOVER_INFO("- texcoord error: max %f, mean %f", e.maxTexcoordError, (f32)(e.sumTexcoordError / count));
+	}
 }
 
 int main(int argc, char** argv)
@@ -588,8 +1262,111 @@ int main(int argc, char** argv)
 
 	CLOVER_INFO("Model Baker v3");
 
+	// modelbaker <gltf> <output dir> [--layout pntt|pnt|pn|p] [--quantize 16|8] [--compress] [--lods 1..4] [--lod-error e]
+	//		[--clusters] [--package] [--benchmark-quantization]
+	MeshExportOptions options;
+	options.vertexAttributes = GetVertexLayoutFromName("pntt");
+	options.vertexFormat = baker::VertexFormat::Float;
+	options.compression = Compression::None;
+	options.lodsCount = 1;
+	options.lodError = 0.01f;
+	options.buildClusters = false;
+	bool exportPackage = false;
+	bool benchmarkQuantization = false;
+	for (s32 i = 3; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--package") == 0)
+		{
+			exportPackage = true;
+			continue;
+		}
+
+		if (strcmp(argv[i], "--benchmark-quantization") == 0)
+		{
+			benchmarkQuantization = true;
+			continue;
+		}
+
+		if (strcmp(argv[i], "--compress") == 0)
+		{
+			options.compression = Compression::MeshOptimizer;
+			continue;
+		}
+
+		if (strcmp(argv[i], "--clusters") == 0)
+		{
+			options.buildClusters = true;
+			continue;
+		}
+
+		if (i + 1 >= argc)
+		{
+			break;
+		}
+
+		if (strcmp(argv[i], "--layout") == 0)
+		{
+			i++;
+			options.vertexAttributes = GetVertexLayoutFromName(argv[i]);
+			if (options.vertexAttributes == (u32)VertexAttribute::Invalid)
+			{
+				CLOVER_ERROR("Unknown vertex layout: %s", argv[i]);
+				return -1;
+			}
+		}
+		else if (strcmp(argv[i], "--quantize") == 0)
+		{
+			i++;
+			if (strcmp(argv[i], "16") == 0)
+			{
+				options.vertexFormat = baker::VertexFormat::Quantized16;
+			}
+			else if (strcmp(argv[i], "8") == 0)
+			{
+				options.vertexFormat = baker::VertexFormat::Quantized8;
+			}
+			else
+			{
+				CLOVER_ERROR("Unknown quantization: %s", argv[i]);
+				return -1;
+			}
+		}
+		else if (strcmp(argv[i], "--lods") == 0)
+		{
+			i++;
+			const s32 lodsCount = atoi(argv[i]);
+			if (lodsCount < 1 || lodsCount > (s32)baker::k_MaxLodsCount)
+			{
+				CLOVER_ERROR("Lods count must be between 1 and %d: %s", baker::k_MaxLodsCount, argv[i]);
+				return -1;
+			}
+			options.lodsCount = (u32)lodsCount;
+		}
+		else if (strcmp(argv[i], "--lod-error") == 0)
+		{
+			i++;
+			options.lodError = (f32)atof(argv[i]);
+			if (options.lodError <= 0.0f)
+			{
+				CLOVER_ERROR("Invalid lod error: %s", argv[i]);
+				return -1;
+			}
+		}
+	}
+
 	//ExportFirstNodeAsModel(argv[1], argv[2]);
-	ExportScene(argv[1], argv[2]);
+	if (benchmarkQuantization)
+	{
+		BenchmarkQuantization(argv[1], options.vertexAttributes);
+	}
+	else if (exportPackage)
+	{
+		ExportScenePackage(argv[1], options);
+	}
+	else
+	{
+		ExportScene(argv[1], argv[2], options);
+	}
 
 	return 0;
 }
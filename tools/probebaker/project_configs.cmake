@@ -0,0 +1,2 @@
+set (PROJECT_NAME "probebaker")
+set (EXECUTABLE_FILE_NAME "probebaker")
@@ -0,0 +1,44 @@
+#include "MemorySystem.h"
+
+#include <clover.h>
+#include <refrain2.h>
+
+helich::memory_manager							g_MemoryManager;
+
+// allocators for clover
+namespace clover
+{
+	LinearAllocator								g_LinearAllocator;
+}
+
+// allocators for refrain2, we never start its workers but the library still wants them
+namespace refrain2
+{
+	FreelistAllocator							g_TaskAllocator;
+	FreelistAllocator							g_TaskDataAllocator;
+}
+
+namespace stone
+{
+	LinearAllocator								g_PersistanceAllocator;
+	LinearAllocator								g_ScratchAllocator;
+}
+
+namespace helich
+{
+// ------------------------------------------------------------------
+
+void init_memory_system()
+{
+	using namespace helich;
+	g_MemoryManager.initialize(
+			memory_region<clover::LinearAllocator>		{ "clover/allocator",			SIZE_MB(16),	&clover::g_LinearAllocator },
+			memory_region<refrain2::FreelistAllocator>	{ "refrain2/task",				SIZE_MB(1),		&refrain2::g_TaskAllocator },
+			memory_region<refrain2::FreelistAllocator>	{ "refrain2/taskdata",			SIZE_MB(1),		&refrain2::g_TaskDataAllocator },
+			memory_region<stone::LinearAllocator>		{ "probebaker/persist",			SIZE_MB(512),	&stone::g_PersistanceAllocator },
+			memory_region<stone::LinearAllocator>		{ "probebaker/scratch",			SIZE_MB(1024),	&stone::g_ScratchAllocator }
+			);
+}
+
+// ------------------------------------------------------------------
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <floral.h>
+#include <helich.h>
+
+// the light probe sources are shared with the engine, they take stone's arenas
+namespace stone
+{
+// ------------------------------------------------------------------
+
+typedef helich::allocator<helich::stack_scheme, helich::no_tracking_policy>		LinearAllocator;
+typedef helich::allocator<helich::stack_scheme, helich::no_tracking_policy>		LinearArena;
+typedef helich::allocator<helich::freelist_scheme, helich::no_tracking_policy>	FreelistArena;
+
+extern LinearAllocator							g_PersistanceAllocator;
+extern LinearAllocator							g_ScratchAllocator;
+
+// ------------------------------------------------------------------
+}
@@ -0,0 +1,346 @@
+#include <floral/stdaliases.h>
+#include <floral/io/nativeio.h>
+#include <floral/gpds/vec.h>
+
+#include <helich.h>
+#include <clover.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <chrono>
+#include <thread>
+
+#include "Memory/MemorySystem.h"
+#include "Graphics/PlyLoader.h"
+#include "Graphics/LightProbeOctree.h"
+#include "Graphics/LightProbeBaker.h"
+
+typedef std::chrono::high_resolution_clock		BakeClock;
+
+/*
+ * Offline counterpart of the LightProbePlacement suite and LightProbeGI's CPU baker: the probes are
+ * placed at the corners of the octree leaves of a triangle soup (a ply file with triangle faces, the
+ * vertex colors are the albedo) and their SH are baked by lightprobe::BakeProbes.
+ *
+ * Output file:
+ *	u32					probesCount
+ *	floral::vec3f		positions[probesCount]
+ *	lightprobe::SH9		sh[probesCount]
+ */
+
+struct SceneData
+{
+	floral::vec3f*								positions;
+	floral::vec4f*								colors;
+	u32											verticesCount;
+	u32*										indices;
+	u32											indicesCount;
+};
+
+const bool LoadScene(const_cstr i_plyPath, SceneData* o_scene)
+{
+	stone::ply::File plyFile;
+	if (!stone::ply::OpenFile(floral::path(i_plyPath), &plyFile))
+	{
+		CLOVER_ERROR("Cannot open the ply file: %s", i_plyPath);
+		return false;
+	}
+
+	const u32 verticesCount = stone::ply::GetVerticesCount(plyFile.header);
+	const u32 facesCount = stone::ply::GetFacesCount(plyFile.header);
+	if (verticesCount == 0 || facesCount == 0)
+	{
+		CLOVER_ERROR("No triangles in: %s", i_plyPath);
+		stone::ply::CloseFile(&plyFile);
+		return false;
+	}
+
+	o_scene->positions = stone::g_PersistanceAllocator.allocate_array<floral::vec3f>(verticesCount);
+	o_scene->colors = stone::g_PersistanceAllocator.allocate_array<floral::vec4f>(verticesCount);
+	o_scene->verticesCount = verticesCount;
+	o_scene->indices = stone::g_PersistanceAllocator.allocate_array<u32>(facesCount * 3);
+	o_scene->indicesCount = facesCount * 3;
+
+	// ply colors are rgb and the baker reads vec4, they are widened through a temporary buffer
+	floral::vec3f* colors = stone::g_ScratchAllocator.allocate_array<floral::vec3f>(verticesCount);
+	stone::ply::Output output;
+	output.positions = o_scene->positions;
+	output.normals = nullptr;
+	output.texcoords = nullptr;
+	output.colors = colors;
+	output.indices = (s32*)o_scene->indices;
+	output.indicesPerFace = 3;
+	const bool readResult = stone::ply::ReadBody(plyFile, output);
+	stone::ply::CloseFile(&plyFile);
+	for (u32 i = 0; i < verticesCount; i++)
+	{
+		o_scene->colors[i] = floral::vec4f(colors[i].x, colors[i].y, colors[i].z, 1.0f);
+	}
+	stone::g_ScratchAllocator.free(colors);
+
+	if (!readResult)
+	{
+		CLOVER_ERROR("Corrupted ply file or non triangle faces: %s", i_plyPath);
+		return false;
+	}
+
+	// a negative index wraps around and is caught here as well
+	for (u32 i = 0; i < o_scene->indicesCount; i++)
+	{
+		if (o_scene->indices[i] >= verticesCount)
+		{
+			CLOVER_ERROR("Vertex index %u out of range (%u vertices)", o_scene->indices[i], verticesCount);
+			return false;
+		}
+	}
+
+	CLOVER_INFO("Scene: %u vertices, %u triangles", verticesCount, facesCount);
+	return true;
+}
+
+// returns the number of probes, they are allocated from the persistance allocator
+const u32 PlaceProbes(const SceneData& i_scene, const lightprobe::OctreeBuildOptions& i_options, floral::vec3f** o_locations)
+{
+	const size octreeScratchSize = lightprobe::GetOctreeScratchSize(i_scene.indicesCount / 3, i_options);
+	stone::FreelistArena* octreeScratch = stone::g_ScratchAllocator.allocate_arena<stone::FreelistArena>(octreeScratchSize);
+	const lightprobe::Octree octree = lightprobe::BuildOctree(i_scene.positions, sizeof(floral::vec3f), i_scene.verticesCount,
+			i_scene.indices, i_scene.indicesCount, i_options, &stone::g_PersistanceAllocator, octreeScratch);
+	stone::g_ScratchAllocator.free(octreeScratch);
+	CLOVER_INFO("Octree: %u nodes, depth %u (scratch: %u KB)", octree.nodesCount, octree.depth, (u32)(octreeScratchSize / 1024));
+
+	const u32 maxLocations = lightprobe::GetMaxProbeLocationsCount(octree);
+	floral::vec3f* locations = stone::g_PersistanceAllocator.allocate_array<floral::vec3f>(floral::max(maxLocations, 1u));
+	stone::FreelistArena* extractionScratch = stone::g_ScratchAllocator.allocate_arena<stone::FreelistArena>(
+			lightprobe::GetProbeExtractionScratchSize(octree));
+	const u32 locationsCount = lightprobe::ExtractProbeLocations(octree, locations, maxLocations, extractionScratch);
+	stone::g_ScratchAllocator.free(extractionScratch);
+
+	*o_locations = locations;
+	return locationsCount;
+}
+
+// returns the SH of the probes, allocated from the persistance allocator
+lightprobe::SH9* BakeProbes(const SceneData& i_scene, const lightprobe::BakeOptions& i_options,
+		const floral::vec3f* i_locations, const u32 i_probesCount)
+{
+	lightprobe::BakeScene bakeScene;
+	bakeScene.positions = i_scene.positions;
+	bakeScene.positionStride = sizeof(floral::vec3f);
+	bakeScene.colors = i_scene.colors;
+	bakeScene.colorStride = sizeof(floral::vec4f);
+	bakeScene.emissions = nullptr;
+	bakeScene.emissionStride = 0;
+	bakeScene.verticesCount = i_scene.verticesCount;
+	bakeScene.indices = i_scene.indices;
+	bakeScene.indicesCount = i_scene.indicesCount;
+
+	const u32 trianglesCount = i_scene.indicesCount / 3;
+	const size scratchSize = floral::max(lightprobe::GetBakeAccelScratchSize(trianglesCount),
+			lightprobe::GetBakeProbesScratchSize(i_probesCount, i_options));
+	stone::FreelistArena* scratchArena = stone::g_ScratchAllocator.allocate_arena<stone::FreelistArena>(scratchSize);
+	const lightprobe::BakeAccel accel = lightprobe::BuildBakeAccel(bakeScene, &stone::g_PersistanceAllocator, scratchArena);
+	CLOVER_INFO("BVH: %u nodes", accel.nodesCount);
+
+	lightprobe::SH9* sh = stone::g_PersistanceAllocator.allocate_array<lightprobe::SH9>(floral::max(i_probesCount, 1u));
+	lightprobe::BakeProbes(bakeScene, accel, i_options, i_locations, sh, i_probesCount, scratchArena);
+	stone::g_ScratchAllocator.free(scratchArena);
+	return sh;
+}
+
+// builds the octree i_runsCount times, the scratch and the nodes are released after each run
+void BenchmarkOctree(const SceneData& i_scene, const lightprobe::OctreeBuildOptions& i_options, const u32 i_runsCount)
+{
+	const u32 trianglesCount = i_scene.indicesCount / 3;
+	const size scratchSize = lightprobe::GetOctreeScratchSize(trianglesCount, i_options);
+	const size dataSize = sizeof(lightprobe::OctreeNode) * i_options.maxNodesCount + SIZE_KB(4);
+	f64 minMs = 0.0;
+	f64 totalMs = 0.0;
+	for (u32 i = 0; i < i_runsCount; i++)
+	{
+		stone::LinearArena* dataArena = stone::g_ScratchAllocator.allocate_arena<stone::LinearArena>(dataSize);
+		stone::FreelistArena* scratchArena = stone::g_ScratchAllocator.allocate_arena<stone::FreelistArena>(scratchSize);
+		const BakeClock::time_point startTime = BakeClock::now();
+		lightprobe::BuildOctree(i_scene.positions, sizeof(floral::vec3f), i_scene.verticesCount,
+				i_scene.indices, i_scene.indicesCount, i_options, dataArena, scratchArena);
+		const f64 ms = std::chrono::duration<f64, std::milli>(BakeClock::now() - startTime).count();
+		stone::g_ScratchAllocator.free(scratchArena);
+		stone::g_ScratchAllocator.free(dataArena);
+
+		minMs = (i == 0 || ms < minMs) ? ms : minMs;
+		totalMs += ms;
+	}
+
+	CLOVER_INFO("Octree benchmark: %u triangles, %u threads, %u runs, min %4.2f ms, avg %4.2f ms (%4.2f Mtris/s)",
+			trianglesCount, i_options.threadsCount, i_runsCount, minMs, totalMs / i_runsCount, (f64)trianglesCount / (minMs * 1000.0));
+}
+
+void WriteProbes(const_cstr i_outputPath, const floral::vec3f* i_locations, const lightprobe::SH9* i_sh, const u32 i_probesCount)
+{
+	floral::file_info output = floral::open_output_file(i_outputPath);
+	floral::output_file_stream os;
+	floral::map_output_file(output, os);
+
+	os.write(i_probesCount);
+	os.write_bytes((voidptr)i_locations, sizeof(floral::vec3f) * i_probesCount);
+	os.write_bytes((voidptr)i_sh, sizeof(lightprobe::SH9) * i_probesCount);
+
+	floral::close_file(output);
+}
+
+int main(int argc, char** argv)
+{
+	// we have to call it ourself as we do not have calyx here
+	helich::init_memory_system();
+
+	clover::Initialize("main", clover::LogLevel::Verbose);
+	clover::InitializeVSOutput("vs", clover::LogLevel::Verbose);
+	clover::InitializeConsoleOutput("console", clover::LogLevel::Verbose);
+
+	CLOVER_INFO("Probe Baker v1");
+
+	// probebaker <ply> <output file> [--min-octant-size s] [--max-depth d] [--path-traced] [--sky r] [--samples n] [--bounces n]
+	//		[--jobs n] [--benchmark-octree runs]
+	if (argc < 3)
+	{
+		CLOVER_ERROR("Usage: probebaker <ply> <output file> [--min-octant-size s] [--max-depth d] [--path-traced] [--sky r] [--samples n] [--bounces n] [--jobs n] [--benchmark-octree runs]");
+		return -1;
+	}
+
+	lightprobe::OctreeBuildOptions octreeOptions = lightprobe::GetDefaultOctreeBuildOptions();
+	lightprobe::BakeOptions bakeOptions = lightprobe::GetDefaultBakeOptions();
+	// the tool does not start the refrain2 workers, the octree binning and the bake run on std::threads
+	const u32 threadsCount = floral::max((u32)std::thread::hardware_concurrency(), 1u);
+	octreeOptions.threadsCount = threadsCount;
+	bakeOptions.threadsCount = threadsCount;
+	u32 benchmarkRunsCount = 0;
+	for (s32 i = 3; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--path-traced") == 0)
+		{
+			bakeOptions.mode = lightprobe::BakeMode::PathTraced;
+			continue;
+		}
+
+		const bool takesValue = strcmp(argv[i], "--min-octant-size") == 0
+			|| strcmp(argv[i], "--max-depth") == 0
+			|| strcmp(argv[i], "--samples") == 0
+			|| strcmp(argv[i], "--sky") == 0
+			|| strcmp(argv[i], "--bounces") == 0
+			|| strcmp(argv[i], "--jobs") == 0
+			|| strcmp(argv[i], "--benchmark-octree") == 0;
+		if (!takesValue)
+		{
+			CLOVER_ERROR("Unknown option: %s", argv[i]);
+			return -1;
+		}
+
+		if (i + 1 >= argc)
+		{
+			CLOVER_ERROR("%s has no value", argv[i]);
+			return -1;
+		}
+
+		if (strcmp(argv[i], "--min-octant-size") == 0)
+		{
+			i++;
+			octreeOptions.minOctantSize = (f32)atof(argv[i]);
+			if (octreeOptions.minOctantSize <= 0.0f)
+			{
+				CLOVER_ERROR("Invalid min octant size: %s", argv[i]);
+				return -1;
+			}
+		}
+		else if (strcmp(argv[i], "--max-depth") == 0)
+		{
+			i++;
+			const s32 maxDepth = atoi(argv[i]);
+			if (maxDepth < 1 || maxDepth > 20)
+			{
+				CLOVER_ERROR("Max depth must be between 1 and 20: %s", argv[i]);
+				return -1;
+			}
+			octreeOptions.maxDepth = (u32)maxDepth;
+		}
+		else if (strcmp(argv[i], "--samples") == 0)
+		{
+			// stratified, rounded down to a square
+			i++;
+			const s32 samplesCount = atoi(argv[i]);
+			if (samplesCount < 1)
+			{
+				CLOVER_ERROR("Invalid samples count: %s", argv[i]);
+				return -1;
+			}
+			bakeOptions.sqrtSamplesPerProbe = floral::max((u32)sqrtf((f32)samplesCount), 1u);
+		}
+		else if (strcmp(argv[i], "--sky") == 0)
+		{
+			// uniform radiance of the rays escaping the scene, the only light of --path-traced as the ply has no emission
+			i++;
+			bakeOptions.skyRadiance = floral::vec3f((f32)atof(argv[i]));
+		}
+		else if (strcmp(argv[i], "--bounces") == 0)
+		{
+			i++;
+			const s32 bouncesCount = atoi(argv[i]);
+			if (bouncesCount < 0)
+			{
+				CLOVER_ERROR("Invalid bounces count: %s", argv[i]);
+				return -1;
+			}
+			bakeOptions.maxBounces = (u32)bouncesCount;
+		}
+		else if (strcmp(argv[i], "--jobs") == 0)
+		{
+			i++;
+			const s32 jobsCount = atoi(argv[i]);
+			if (jobsCount < 1)
+			{
+				CLOVER_ERROR("Invalid jobs count: %s", argv[i]);
+				return -1;
+			}
+			octreeOptions.threadsCount = (u32)jobsCount;
+			bakeOptions.threadsCount = (u32)jobsCount;
+		}
+		else if (strcmp(argv[i], "--benchmark-octree") == 0)
+		{
+			i++;
+			const s32 runsCount = atoi(argv[i]);
+			if (runsCount < 1)
+			{
+				CLOVER_ERROR("Invalid runs count: %s", argv[i]);
+				return -1;
+			}
+			benchmarkRunsCount = (u32)runsCount;
+		}
+	}
+
+	SceneData scene;
+	if (!LoadScene(argv[1], &scene))
+	{
+		return -1;
+	}
+
+	if (benchmarkRunsCount > 0)
+	{
+		// nothing is written
+		BenchmarkOctree(scene, octreeOptions, benchmarkRunsCount);
+		return 0;
+	}
+
+	BakeClock::time_point startTime = BakeClock::now();
+	floral::vec3f* locations = nullptr;
+	const u32 probesCount = PlaceProbes(scene, octreeOptions, &locations);
+	const f64 placementMs = std::chrono::duration<f64, std::milli>(BakeClock::now() - startTime).count();
+	CLOVER_INFO("Probes: %u (placement: %4.2f ms)", probesCount, placementMs);
+
+	startTime = BakeClock::now();
+	const lightprobe::SH9* sh = BakeProbes(scene, bakeOptions, locations, probesCount);
+	const f64 bakeMs = std::chrono::duration<f64, std::milli>(BakeClock::now() - startTime).count();
+	CLOVER_INFO("SH baked in %4.2f ms", bakeMs);
+
+	WriteProbes(argv[2], locations, sh, probesCount);
+	return 0;
+}
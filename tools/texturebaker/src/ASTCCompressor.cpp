@@ -0,0 +1,361 @@
+#include "ASTCCompressor.h"
+
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#include <chrono>
+
+#include <clover/logger.h>
+#include <floral/math/utils.h>
+
+#include "stb_image.h"
+
+namespace texbaker
+{
+// -------------------------------------------------------------------
+
+// 4x4 weights grid, QUANT_8 (rgb) and QUANT_4 (rgba) weights, no dual plane
+static const u32								k_ASTCBlockModeRGB = 0x53;
+static const u32								k_ASTCBlockModeRGBA = 0x42;
+static const u32								k_ASTCEndpointModeRGB = 8;
+static const u32								k_ASTCEndpointModeRGBA = 12;
+static const s32								k_ASTCEndpointsOffset = 17;		// block mode (11), partitions (2), endpoint mode (4)
+
+static const s32								k_ASTCWeights8[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static const s32								k_ASTCWeights4[4] = { 0, 21, 43, 64 };
+static const s32								k_RefineIterations[] = { 0, 1, 3 };	// per BlockQuality
+
+struct ASTCFormat
+{
+	u32											blockMode;
+	u32											endpointMode;
+	s32											channelsCount;
+	s32											weightBits;
+	const s32*									weights;
+};
+
+static const ASTCFormat							k_ASTCFormats[2] = {
+	{ k_ASTCBlockModeRGB, k_ASTCEndpointModeRGB, 3, 3, k_ASTCWeights8 },
+	{ k_ASTCBlockModeRGBA, k_ASTCEndpointModeRGBA, 4, 2, k_ASTCWeights4 }
+};
+
+struct ASTCBlock
+{
+	s32											endpoints[2][4];	// 8 bits
+	u8											weights[16];
+};
+
+struct ASTCJob
+{
+	const u8*									input;
+	s32											width;
+	s32											height;
+	s32											numChannels;
+	BlockQuality								quality;
+	p8											output;
+};
+
+// -------------------------------------------------------------------
+
+const size GetASTCCompressedSize(const s32 i_width, const s32 i_height)
+{
+	return (size)((i_width + 3) / 4) * ((i_height + 3) / 4) * 16;
+}
+
+// -------------------------------------------------------------------
+
+// unorm8 decoding: endpoints are expanded to 16 bits before the interpolation
+static inline const s32 InterpolateASTC(const s32 i_endpoint0, const s32 i_endpoint1, const s32 i_weight)
+{
+	return ((i_endpoint0 * 257 * (64 - i_weight) + i_endpoint1 * 257 * i_weight + 32) >> 6) >> 8;
+}
+
+static const f32 EncodeASTCEndpoints(const f32 i_block[16][4], const ASTCFormat& i_format,
+		const f32 i_endpoint0[4], const f32 i_endpoint1[4], ASTCBlock* o_block)
+{
+	const s32 n = i_format.channelsCount;
+	const s32 weightsCount = 1 << i_format.weightBits;
+	for (s32 c = 0; c < 4; c++)
+	{
+		o_block->endpoints[0][c] = 255;
+		o_block->endpoints[1][c] = 255;
+	}
+	for (s32 c = 0; c < n; c++)
+	{
+		o_block->endpoints[0][c] = floral::clamp((s32)floorf(i_endpoint0[c] + 0.5f), 0, 255);
+		o_block->endpoints[1][c] = floral::clamp((s32)floorf(i_endpoint1[c] + 0.5f), 0, 255);
+	}
+
+	s32 palette[8][4];
+	for (s32 k = 0; k < weightsCount; k++)
+	{
+		for (s32 c = 0; c < n; c++)
+		{
+			palette[k][c] = InterpolateASTC(o_block->endpoints[0][c], o_block->endpoints[1][c], i_format.weights[k]);
+		}
+	}
+
+	f32 totalError = 0.0f;
+	for (s32 i = 0; i < 16; i++)
+	{
+		f32 bestError = FLT_MAX;
+		for (s32 k = 0; k < weightsCount; k++)
+		{
+			f32 error = 0.0f;
+			for (s32 c = 0; c < n; c++)
+			{
+				const f32 d = i_block[i][c] - (f32)palette[k][c];
+				error += d * d;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				o_block->weights[i] = (u8)k;
+			}
+		}
+		totalError += bestError;
+	}
+	return totalError;
+}
+
+static void WriteASTCBlock(const ASTCBlock& i_block, const ASTCFormat& i_format, p8 o_output)
+{
+	// the decoder blue contracts when sum(endpoint 1) < sum(endpoint 0): swap the endpoints then
+	ASTCBlock block = i_block;
+	const s32 sum0 = i_block.endpoints[0][0] + i_block.endpoints[0][1] + i_block.endpoints[0][2];
+	const s32 sum1 = i_block.endpoints[1][0] + i_block.endpoints[1][1] + i_block.endpoints[1][2];
+	if (sum1 < sum0)
+	{
+		const s32 maxWeight = (1 << i_format.weightBits) - 1;
+		for (s32 c = 0; c < 4; c++)
+		{
+			block.endpoints[0][c] = i_block.endpoints[1][c];
+			block.endpoints[1][c] = i_block.endpoints[0][c];
+		}
+		for (s32 i = 0; i < 16; i++)
+		{
+			block.weights[i] = (u8)(maxWeight - i_block.weights[i]);
+		}
+	}
+
+	BlockBits bits;
+	InitBlockBits(&bits);
+	WriteBlockBits(&bits, i_format.blockMode, 11);
+	WriteBlockBits(&bits, 0, 2);
+	WriteBlockBits(&bits, i_format.endpointMode, 4);
+	for (s32 c = 0; c < i_format.channelsCount; c++)
+	{
+		WriteBlockBits(&bits, block.endpoints[0][c], 8);
+		WriteBlockBits(&bits, block.endpoints[1][c], 8);
+	}
+
+	// weights are stored backwards from the last bit of the block
+	for (s32 i = 0; i < 16; i++)
+	{
+		for (s32 b = 0; b < i_format.weightBits; b++)
+		{
+			const s32 position = 127 - (i * i_format.weightBits + b);
+			bits.bytes[position >> 3] |= (u8)(((block.weights[i] >> b) & 1) << (position & 7));
+		}
+	}
+	memcpy(o_output, bits.bytes, 16);
+}
+
+static void EncodeASTCBlock(const f32 i_block[16][4], const ASTCFormat& i_format, const BlockQuality i_quality, p8 o_output)
+{
+	const s32 n = i_format.channelsCount;
+	f32 endpoint0[4], endpoint1[4];
+	FitBlockEndpoints(i_block, n, i_quality != BlockQuality::Fast, 255.0f, endpoint0, endpoint1);
+
+	ASTCBlock bestBlock;
+	f32 bestError = EncodeASTCEndpoints(i_block, i_format, endpoint0, endpoint1, &bestBlock);
+	for (s32 k = 0; k < k_RefineIterations[(s32)i_quality] && bestError > 0.0f; k++)
+	{
+		f32 weights[16];
+		for (s32 i = 0; i < 16; i++)
+		{
+			weights[i] = (f32)i_format.weights[bestBlock.weights[i]] / 64.0f;
+		}
+		if (!RefineBlockEndpoints(i_block, weights, n, 255.0f, endpoint0, endpoint1))
+		{
+			break;
+		}
+
+		ASTCBlock block;
+		const f32 error = EncodeASTCEndpoints(i_block, i_format, endpoint0, endpoint1, &block);
+		if (error >= bestError)
+		{
+			break;
+		}
+		bestError = error;
+		bestBlock = block;
+	}
+
+	WriteASTCBlock(bestBlock, i_format, o_output);
+}
+
+static void CompressASTCRows(voidptr i_job, const s32 i_firstRow, const s32 i_lastRow)
+{
+	const ASTCJob* job = (const ASTCJob*)i_job;
+	const ASTCFormat& format = k_ASTCFormats[job->numChannels == 4 ? 1 : 0];
+	const s32 blocksX = (job->width + 3) / 4;
+	f32 block[16][4];
+	for (s32 by = i_firstRow; by < i_lastRow; by++)
+	{
+		for (s32 bx = 0; bx < blocksX; bx++)
+		{
+			GatherBlockU8(job->input, job->width, job->height, job->numChannels, bx * 4, by * 4, block);
+			EncodeASTCBlock(block, format, job->quality, job->output + ((size)by * blocksX + bx) * 16);
+		}
+	}
+}
+
+void CompressASTCImage(const u8* i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+		const BlockQuality i_quality, const u32 i_threadsCount, p8 o_output)
+{
+	ASTCJob job = { i_input, i_width, i_height, i_numChannels, i_quality, o_output };
+	CompressBlockRowsParallel((i_height + 3) / 4, i_threadsCount, &CompressASTCRows, &job);
+}
+
+// -------------------------------------------------------------------
+
+void DecompressASTCImage(const u8* i_input, const s32 i_width, const s32 i_height, p8 o_rgba)
+{
+	const s32 blocksX = (i_width + 3) / 4;
+	const s32 blocksY = (i_height + 3) / 4;
+	for (s32 by = 0; by < blocksY; by++)
+	{
+		for (s32 bx = 0; bx < blocksX; bx++)
+		{
+			const u8* block = &i_input[((size)by * blocksX + bx) * 16];
+			u8 colors[16][4];
+			memset(colors, 0, sizeof(colors));
+
+			s32 position = 0;
+			const u32 blockMode = ReadBlockBits(block, &position, 11);
+			const ASTCFormat* format = nullptr;
+			for (s32 f = 0; f < 2; f++)
+			{
+				if (k_ASTCFormats[f].blockMode == blockMode)
+				{
+					format = &k_ASTCFormats[f];
+				}
+			}
+			const u32 partitionsCount = ReadBlockBits(block, &position, 2) + 1;
+			const u32 endpointMode = ReadBlockBits(block, &position, 4);
+			if (format != nullptr && partitionsCount == 1 && endpointMode == format->endpointMode)
+			{
+				s32 endpoints[2][4] = { { 0, 0, 0, 255 }, { 0, 0, 0, 255 } };
+				for (s32 c = 0; c < format->channelsCount; c++)
+				{
+					endpoints[0][c] = ReadBlockBits(block, &position, 8);
+					endpoints[1][c] = ReadBlockBits(block, &position, 8);
+				}
+				for (s32 i = 0; i < 16; i++)
+				{
+					s32 weight = 0;
+					for (s32 b = 0; b < format->weightBits; b++)
+					{
+						const s32 bitPosition = 127 - (i * format->weightBits + b);
+						weight |= ((block[bitPosition >> 3] >> (bitPosition & 7)) & 1) << b;
+					}
+					for (s32 c = 0; c < 4; c++)
+					{
+						colors[i][c] = (u8)InterpolateASTC(endpoints[0][c], endpoints[1][c], format->weights[weight]);
+					}
+				}
+			}
+
+			for (s32 i = 0; i < 16; i++)
+			{
+				const s32 x = bx * 4 + (i & 3);
+				const s32 y = by * 4 + (i >> 2);
+				if (x < i_width && y < i_height)
+				{
+					memcpy(&o_rgba[(y * i_width + x) * 4], colors[i], 4);
+				}
+			}
+		}
+	}
+}
+
+// -------------------------------------------------------------------
+
+void BenchmarkASTC(floral::filesystem<FreelistArena>* i_fs, const_cstr i_inputFilename, const u32 i_threadsCount)
+{
+	typedef std::chrono::high_resolution_clock BenchmarkClock;
+	static const f64 k_MinSecondsPerRun = 0.5;
+	static const const_cstr k_QualityNames[] = { "fast", "normal", "high" };
+
+	floral::relative_path inputPath = floral::build_relative_path(i_inputFilename);
+	floral::file_info inputFile = floral::open_file_read(i_fs, inputPath);
+	if (inputFile.file_size == 0)
+	{
+		floral::close_file(inputFile);
+		CLOVER_ERROR("cannot read '%s'", i_inputFilename);
+		return;
+	}
+	voidptr inputFileData = g_BakingAllocator.allocate(inputFile.file_size);
+	floral::read_all_file(inputFile, inputFileData);
+	floral::close_file(inputFile);
+
+	s32 x, y, n;
+	p8 data = stbi_load_from_memory((p8)inputFileData, inputFile.file_size, &x, &y, &n, 0);
+	g_BakingAllocator.free(inputFileData);
+	if (data == nullptr)
+	{
+		CLOVER_ERROR("cannot decode '%s': %s", i_inputFilename, stbi_failure_reason());
+		return;
+	}
+
+	const s32 pixelsCount = x * y;
+	p8 compressedData = (p8)g_BakingAllocator.allocate(GetASTCCompressedSize(x, y));
+	p8 decodedData = (p8)g_BakingAllocator.allocate(pixelsCount * 4);
+
+	CLOVER_INFO("ASTC 4x4 benchmark: %s (%dx%d, %d channels)", i_inputFilename, x, y, n);
+	const u32 threadsCounts[] = { 1, floral::max(i_threadsCount, 1u) };
+	for (s32 q = 0; q < 3; q++)
+	{
+		const BlockQuality quality = (BlockQuality)q;
+		for (s32 t = 0; t < 2; t++)
+		{
+			if (t == 1 && threadsCounts[1] == 1)
+			{
+				break;
+			}
+
+			s32 runsCount = 0;
+			const BenchmarkClock::time_point startTime = BenchmarkClock::now();
+			f64 seconds = 0.0;
+			do
+			{
+				CompressASTCImage(data, x, y, n, quality, threadsCounts[t], compressedData);
+				runsCount++;
+				seconds = std::chrono::duration<f64>(BenchmarkClock::now() - startTime).count();
+			}
+			while (seconds < k_MinSecondsPerRun);
+
+			DecompressASTCImage(compressedData, x, y, decodedData);
+			f64 sum = 0.0;
+			for (s32 i = 0; i < pixelsCount; i++)
+			{
+				for (s32 c = 0; c < n; c++)
+				{
+					const f64 d = (f64)data[i * n + c] - (f64)decodedData[i * 4 + c];
+					sum += d * d;
+				}
+			}
+			const f64 rmse = sqrt(sum / ((f64)pixelsCount * n));
+			const f64 mpixelsPerSecond = (f64)pixelsCount * runsCount / seconds / 1000000.0;
+			CLOVER_INFO("  %-6s | %2d threads | %9.2f Mpixels/s | rmse %.3f", k_QualityNames[q], threadsCounts[t], mpixelsPerSecond, rmse);
+		}
+	}
+
+	g_BakingAllocator.free(decodedData);
+	g_BakingAllocator.free(compressedData);
+	stbi_image_free(data);
+}
+
+// -------------------------------------------------------------------
+}
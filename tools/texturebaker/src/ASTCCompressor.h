@@ -0,0 +1,31 @@
+#pragma once
+
+#include <floral.h>
+#include <floral/io/filesystem.h>
+
+#include "Memory/MemorySystem.h"
+#include "BlockCompression.h"
+
+namespace texbaker
+{
+// -------------------------------------------------------------------
+
+/*
+ * ASTC 4x4 LDR (8 bpp), single partition, 8 bits endpoints:
+ * - 1 to 3 channels: CEM 8 (rgb direct), 3 bits weights
+ * - 4 channels: CEM 12 (rgba direct), 2 bits weights
+ * No blue contraction and no dual plane, HDR images go through RGBM.
+ */
+const size										GetASTCCompressedSize(const s32 i_width, const s32 i_height);
+
+void											CompressASTCImage(const u8* i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+													const BlockQuality i_quality, const u32 i_threadsCount, p8 o_output);
+
+// decoder for the blocks above, o_rgba: i_width * i_height * 4 bytes
+void											DecompressASTCImage(const u8* i_input, const s32 i_width, const s32 i_height, p8 o_rgba);
+
+// same as BenchmarkDXT, for LDR images
+void											BenchmarkASTC(floral::filesystem<FreelistArena>* i_fs, const_cstr i_inputFilename, const u32 i_threadsCount);
+
+// -------------------------------------------------------------------
+}
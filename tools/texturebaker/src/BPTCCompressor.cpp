@@ -0,0 +1,649 @@
+#include "BPTCCompressor.h"
+
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#include <chrono>
+
+#include <clover/logger.h>
+#include <floral/math/utils.h>
+
+#include "stb_image.h"
+
+namespace texbaker
+{
+// -------------------------------------------------------------------
+
+// 4 bits index interpolation weights, shared by BC6H and BC7
+static const s32								k_BPTCWeights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+static const s32								k_RefineIterations[] = { 0, 1, 3 };	// per BlockQuality
+static const s32								k_BC6HMode11 = 0x03;
+static const f32								k_MaxHalfBits = (f32)0x7bff;	// 65504.0f
+
+struct BC7Block
+{
+	s32											endpoints[2][4];	// 7 bits
+	s32											pbits[2];
+	u8											indices[16];
+};
+
+struct BC6HBlock
+{
+	s32											endpoints[2][3];	// 10 bits
+	u8											indices[16];
+};
+
+struct BPTCJob
+{
+	const voidptr								input;
+	s32											width;
+	s32											height;
+	s32											numChannels;
+	BlockQuality								quality;
+	p8											output;
+};
+
+// -------------------------------------------------------------------
+
+const size GetBPTCCompressedSize(const s32 i_width, const s32 i_height)
+{
+	return (size)((i_width + 3) / 4) * ((i_height + 3) / 4) * 16;
+}
+
+// -------------------------------------------------------------------
+
+static inline const s32 BC7EndpointValue(const s32 i_quantized, const s32 i_pbit)
+{
+	return (i_quantized << 1) | i_pbit;
+}
+
+static inline const s32 QuantizeBC7Channel(const f32 i_value, const s32 i_pbit)
+{
+	return floral::clamp((s32)floorf((i_value - (f32)i_pbit) * 0.5f + 0.5f), 0, 127);
+}
+
+// the p-bit that rounds i_endpoint the best on its own
+static const s32 FindBC7PBit(const f32 i_endpoint[4])
+{
+	f32 errors[2] = { 0.0f, 0.0f };
+	for (s32 p = 0; p < 2; p++)
+	{
+		for (s32 c = 0; c < 4; c++)
+		{
+			const f32 d = (f32)BC7EndpointValue(QuantizeBC7Channel(i_endpoint[c], p), p) - i_endpoint[c];
+			errors[p] += d * d;
+		}
+	}
+	return errors[1] < errors[0] ? 1 : 0;
+}
+
+static const f32 FindBC7Indices(const f32 i_block[16][4], const s32 i_endpoint0[4], const s32 i_endpoint1[4], u8 o_indices[16])
+{
+	s32 palette[16][4];
+	for (s32 k = 0; k < 16; k++)
+	{
+		const s32 w = k_BPTCWeights4[k];
+		for (s32 c = 0; c < 4; c++)
+		{
+			palette[k][c] = ((64 - w) * i_endpoint0[c] + w * i_endpoint1[c] + 32) >> 6;
+		}
+	}
+
+	f32 totalError = 0.0f;
+	for (s32 i = 0; i < 16; i++)
+	{
+		f32 bestError = FLT_MAX;
+		for (s32 k = 0; k < 16; k++)
+		{
+			f32 error = 0.0f;
+			for (s32 c = 0; c < 4; c++)
+			{
+				const f32 d = i_block[i][c] - (f32)palette[k][c];
+				error += d * d;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				o_indices[i] = (u8)k;
+			}
+		}
+		totalError += bestError;
+	}
+	return totalError;
+}
+
+static const f32 EncodeBC7Endpoints(const f32 i_block[16][4], const f32 i_endpoint0[4], const f32 i_endpoint1[4],
+		const bool i_searchPBits, BC7Block* o_block)
+{
+	const s32 pbit0 = FindBC7PBit(i_endpoint0);
+	const s32 pbit1 = FindBC7PBit(i_endpoint1);
+
+	f32 bestError = FLT_MAX;
+	for (s32 p = 0; p < 4; p++)
+	{
+		BC7Block candidate;
+		candidate.pbits[0] = p & 1;
+		candidate.pbits[1] = p >> 1;
+		if (!i_searchPBits && (candidate.pbits[0] != pbit0 || candidate.pbits[1] != pbit1))
+		{
+			continue;
+		}
+
+		s32 values[2][4];
+		for (s32 c = 0; c < 4; c++)
+		{
+			candidate.endpoints[0][c] = QuantizeBC7Channel(i_endpoint0[c], candidate.pbits[0]);
+			candidate.endpoints[1][c] = QuantizeBC7Channel(i_endpoint1[c], candidate.pbits[1]);
+			values[0][c] = BC7EndpointValue(candidate.endpoints[0][c], candidate.pbits[0]);
+			values[1][c] = BC7EndpointValue(candidate.endpoints[1][c], candidate.pbits[1]);
+		}
+
+		const f32 error = FindBC7Indices(i_block, values[0], values[1], candidate.indices);
+		if (error < bestError)
+		{
+			bestError = error;
+			*o_block = candidate;
+		}
+	}
+	return bestError;
+}
+
+static void WriteBC7Block(const BC7Block& i_block, p8 o_output)
+{
+	// the msb of the first index is implicit 0: swap the endpoints when it would be 1
+	BC7Block block = i_block;
+	if (block.indices[0] >= 8)
+	{
+		for (s32 c = 0; c < 4; c++)
+		{
+			block.endpoints[0][c] = i_block.endpoints[1][c];
+			block.endpoints[1][c] = i_block.endpoints[0][c];
+		}
+		block.pbits[0] = i_block.pbits[1];
+		block.pbits[1] = i_block.pbits[0];
+		for (s32 i = 0; i < 16; i++)
+		{
+			block.indices[i] = 15 - i_block.indices[i];
+		}
+	}
+
+	BlockBits bits;
+	InitBlockBits(&bits);
+	WriteBlockBits(&bits, 1 << 6, 7);
+	for (s32 c = 0; c < 4; c++)
+	{
+		WriteBlockBits(&bits, block.endpoints[0][c], 7);
+		WriteBlockBits(&bits, block.endpoints[1][c], 7);
+	}
+	WriteBlockBits(&bits, block.pbits[0], 1);
+	WriteBlockBits(&bits, block.pbits[1], 1);
+	WriteBlockBits(&bits, block.indices[0], 3);
+	for (s32 i = 1; i < 16; i++)
+	{
+		WriteBlockBits(&bits, block.indices[i], 4);
+	}
+	FLORAL_ASSERT(bits.position == 128);
+	memcpy(o_output, bits.bytes, 16);
+}
+
+static void EncodeBC7Block(const f32 i_block[16][4], const BlockQuality i_quality, p8 o_output)
+{
+	f32 endpoint0[4], endpoint1[4];
+	FitBlockEndpoints(i_block, 4, i_quality != BlockQuality::Fast, 255.0f, endpoint0, endpoint1);
+
+	const bool searchPBits = (i_quality == BlockQuality::High);
+	BC7Block bestBlock;
+	f32 bestError = EncodeBC7Endpoints(i_block, endpoint0, endpoint1, searchPBits, &bestBlock);
+	for (s32 k = 0; k < k_RefineIterations[(s32)i_quality] && bestError > 0.0f; k++)
+	{
+		f32 weights[16];
+		for (s32 i = 0; i < 16; i++)
+		{
+			weights[i] = (f32)k_BPTCWeights4[bestBlock.indices[i]] / 64.0f;
+		}
+		if (!RefineBlockEndpoints(i_block, weights, 4, 255.0f, endpoint0, endpoint1))
+		{
+			break;
+		}
+
+		BC7Block block;
+		const f32 error = EncodeBC7Endpoints(i_block, endpoint0, endpoint1, searchPBits, &block);
+		if (error >= bestError)
+		{
+			break;
+		}
+		bestError = error;
+		bestBlock = block;
+	}
+
+	WriteBC7Block(bestBlock, o_output);
+}
+
+static void CompressBC7Rows(voidptr i_job, const s32 i_firstRow, const s32 i_lastRow)
+{
+	const BPTCJob* job = (const BPTCJob*)i_job;
+	const s32 blocksX = (job->width + 3) / 4;
+	f32 block[16][4];
+	for (s32 by = i_firstRow; by < i_lastRow; by++)
+	{
+		for (s32 bx = 0; bx < blocksX; bx++)
+		{
+			GatherBlockU8((const u8*)job->input, job->width, job->height, job->numChannels, bx * 4, by * 4, block);
+			EncodeBC7Block(block, job->quality, job->output + ((size)by * blocksX + bx) * 16);
+		}
+	}
+}
+
+void CompressBC7Image(const u8* i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+		const BlockQuality i_quality, const u32 i_threadsCount, p8 o_output)
+{
+	BPTCJob job = { (const voidptr)i_input, i_width, i_height, i_numChannels, i_quality, o_output };
+	CompressBlockRowsParallel((i_height + 3) / 4, i_threadsCount, &CompressBC7Rows, &job);
+}
+
+// -------------------------------------------------------------------
+
+static inline const s32 UnquantizeBC6H(const s32 i_value)
+{
+	if (i_value == 0)
+	{
+		return 0;
+	}
+	if (i_value == 1023)
+	{
+		return 0xffff;
+	}
+	return ((i_value << 16) + 0x8000) >> 10;
+}
+
+// unsigned BC6H: the interpolated 16 bits value scaled to the half float bits
+static inline const s32 FinishBC6H(const s32 i_value)
+{
+	return (i_value * 31) >> 6;
+}
+
+static const s32 QuantizeBC6HChannel(const f32 i_halfBits)
+{
+	// FinishBC6H(UnquantizeBC6H(q)) ~ q * 31 + 15.5, then the closest of the neighbors
+	const s32 guess = floral::clamp((s32)floorf((i_halfBits - 15.5f) / 31.0f + 0.5f), 0, 1023);
+	s32 bestValue = guess;
+	f32 bestError = FLT_MAX;
+	for (s32 q = floral::max(guess - 1, 0); q <= floral::min(guess + 1, 1023); q++)
+	{
+		const f32 error = fabsf((f32)FinishBC6H(UnquantizeBC6H(q)) - i_halfBits);
+		if (error < bestError)
+		{
+			bestError = error;
+			bestValue = q;
+		}
+	}
+	return bestValue;
+}
+
+static const f32 EncodeBC6HEndpoints(const f32 i_block[16][4], const f32 i_endpoint0[4], const f32 i_endpoint1[4], BC6HBlock* o_block)
+{
+	s32 palette[16][3];
+	for (s32 c = 0; c < 3; c++)
+	{
+		o_block->endpoints[0][c] = QuantizeBC6HChannel(i_endpoint0[c]);
+		o_block->endpoints[1][c] = QuantizeBC6HChannel(i_endpoint1[c]);
+		const s32 value0 = UnquantizeBC6H(o_block->endpoints[0][c]);
+		const s32 value1 = UnquantizeBC6H(o_block->endpoints[1][c]);
+		for (s32 k = 0; k < 16; k++)
+		{
+			const s32 w = k_BPTCWeights4[k];
+			palette[k][c] = FinishBC6H(((64 - w) * value0 + w * value1 + 32) >> 6);
+		}
+	}
+
+	f32 totalError = 0.0f;
+	for (s32 i = 0; i < 16; i++)
+	{
+		f32 bestError = FLT_MAX;
+		for (s32 k = 0; k < 16; k++)
+		{
+			f32 error = 0.0f;
+			for (s32 c = 0; c < 3; c++)
+			{
+				const f32 d = i_block[i][c] - (f32)palette[k][c];
+				error += d * d;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				o_block->indices[i] = (u8)k;
+			}
+		}
+		totalError += bestError;
+	}
+	return totalError;
+}
+
+static void WriteBC6HBlock(const BC6HBlock& i_block, p8 o_output)
+{
+	BC6HBlock block = i_block;
+	if (block.indices[0] >= 8)
+	{
+		for (s32 c = 0; c < 3; c++)
+		{
+			block.endpoints[0][c] = i_block.endpoints[1][c];
+			block.endpoints[1][c] = i_block.endpoints[0][c];
+		}
+		for (s32 i = 0; i < 16; i++)
+		{
+			block.indices[i] = 15 - i_block.indices[i];
+		}
+	}
+
+	BlockBits bits;
+	InitBlockBits(&bits);
+	WriteBlockBits(&bits, k_BC6HMode11, 5);
+	for (s32 e = 0; e < 2; e++)
+	{
+		for (s32 c = 0; c < 3; c++)
+		{
+			WriteBlockBits(&bits, block.endpoints[e][c], 10);
+		}
+	}
+	WriteBlockBits(&bits, block.indices[0], 3);
+	for (s32 i = 1; i < 16; i++)
+	{
+		WriteBlockBits(&bits, block.indices[i], 4);
+	}
+	FLORAL_ASSERT(bits.position == 128);
+	memcpy(o_output, bits.bytes, 16);
+}
+
+// i_block is in half float bits, which is close to a log scale: errors are relative
+static void EncodeBC6HBlock(const f32 i_block[16][4], const BlockQuality i_quality, p8 o_output)
+{
+	f32 endpoint0[4], endpoint1[4];
+	FitBlockEndpoints(i_block, 3, i_quality != BlockQuality::Fast, k_MaxHalfBits, endpoint0, endpoint1);
+
+	BC6HBlock bestBlock;
+	f32 bestError = EncodeBC6HEndpoints(i_block, endpoint0, endpoint1, &bestBlock);
+	for (s32 k = 0; k < k_RefineIterations[(s32)i_quality] && bestError > 0.0f; k++)
+	{
+		f32 weights[16];
+		for (s32 i = 0; i < 16; i++)
+		{
+			weights[i] = (f32)k_BPTCWeights4[bestBlock.indices[i]] / 64.0f;
+		}
+		if (!RefineBlockEndpoints(i_block, weights, 3, k_MaxHalfBits, endpoint0, endpoint1))
+		{
+			break;
+		}
+
+		BC6HBlock block;
+		const f32 error = EncodeBC6HEndpoints(i_block, endpoint0, endpoint1, &block);
+		if (error >= bestError)
+		{
+			break;
+		}
+		bestError = error;
+		bestBlock = block;
+	}
+
+	WriteBC6HBlock(bestBlock, o_output);
+}
+
+static void CompressBC6HRows(voidptr i_job, const s32 i_firstRow, const s32 i_lastRow)
+{
+	const BPTCJob* job = (const BPTCJob*)i_job;
+	const s32 blocksX = (job->width + 3) / 4;
+	f32 block[16][4];
+	for (s32 by = i_firstRow; by < i_lastRow; by++)
+	{
+		for (s32 bx = 0; bx < blocksX; bx++)
+		{
+			GatherBlockF32((const f32*)job->input, job->width, job->height, job->numChannels, bx * 4, by * 4, block);
+			for (s32 i = 0; i < 16; i++)
+			{
+				for (s32 c = 0; c < 3; c++)
+				{
+					block[i][c] = (f32)floral::float_to_half_full(floral::clamp(block[i][c], 0.0f, 65504.0f));
+				}
+			}
+			EncodeBC6HBlock(block, job->quality, job->output + ((size)by * blocksX + bx) * 16);
+		}
+	}
+}
+
+void CompressBC6HImage(const f32* i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+		const BlockQuality i_quality, const u32 i_threadsCount, p8 o_output)
+{
+	FLORAL_ASSERT(i_numChannels >= 3);
+	BPTCJob job = { (const voidptr)i_input, i_width, i_height, i_numChannels, i_quality, o_output };
+	CompressBlockRowsParallel((i_height + 3) / 4, i_threadsCount, &CompressBC6HRows, &job);
+}
+
+// -------------------------------------------------------------------
+
+static const f32 HalfBitsToFloat(const u32 i_half)
+{
+	const u32 exponent = (i_half >> 10) & 0x1f;
+	const u32 mantissa = i_half & 0x3ff;
+	const f32 sign = (i_half & 0x8000) ? -1.0f : 1.0f;
+	if (exponent == 0)
+	{
+		return sign * ldexpf((f32)mantissa, -24);
+	}
+	if (exponent == 31)
+	{
+		return sign * FLT_MAX;
+	}
+	return sign * ldexpf((f32)(mantissa | 0x400), (s32)exponent - 25);
+}
+
+void DecompressBC7Image(const u8* i_input, const s32 i_width, const s32 i_height, p8 o_rgba)
+{
+	const s32 blocksX = (i_width + 3) / 4;
+	const s32 blocksY = (i_height + 3) / 4;
+	for (s32 by = 0; by < blocksY; by++)
+	{
+		for (s32 bx = 0; bx < blocksX; bx++)
+		{
+			const u8* block = &i_input[((size)by * blocksX + bx) * 16];
+			u8 colors[16][4];
+			memset(colors, 0, sizeof(colors));
+			s32 position = 0;
+			if (ReadBlockBits(block, &position, 7) == (1 << 6))
+			{
+				s32 endpoints[2][4];
+				for (s32 c = 0; c < 4; c++)
+				{
+					endpoints[0][c] = ReadBlockBits(block, &position, 7);
+					endpoints[1][c] = ReadBlockBits(block, &position, 7);
+				}
+				const s32 pbit0 = ReadBlockBits(block, &position, 1);
+				const s32 pbit1 = ReadBlockBits(block, &position, 1);
+				for (s32 i = 0; i < 16; i++)
+				{
+					const s32 w = k_BPTCWeights4[ReadBlockBits(block, &position, i == 0 ? 3 : 4)];
+					for (s32 c = 0; c < 4; c++)
+					{
+						const s32 value0 = BC7EndpointValue(endpoints[0][c], pbit0);
+						const s32 value1 = BC7EndpointValue(endpoints[1][c], pbit1);
+						colors[i][c] = (u8)(((64 - w) * value0 + w * value1 + 32) >> 6);
+					}
+				}
+			}
+
+			for (s32 i = 0; i < 16; i++)
+			{
+				const s32 x = bx * 4 + (i & 3);
+				const s32 y = by * 4 + (i >> 2);
+				if (x < i_width && y < i_height)
+				{
+					memcpy(&o_rgba[(y * i_width + x) * 4], colors[i], 4);
+				}
+			}
+		}
+	}
+}
+
+void DecompressBC6HImage(const u8* i_input, const s32 i_width, const s32 i_height, f32* o_rgb)
+{
+	const s32 blocksX = (i_width + 3) / 4;
+	const s32 blocksY = (i_height + 3) / 4;
+	for (s32 by = 0; by < blocksY; by++)
+	{
+		for (s32 bx = 0; bx < blocksX; bx++)
+		{
+			const u8* block = &i_input[((size)by * blocksX + bx) * 16];
+			f32 colors[16][3];
+			memset(colors, 0, sizeof(colors));
+			s32 position = 0;
+			if (ReadBlockBits(block, &position, 5) == k_BC6HMode11)
+			{
+				s32 endpoints[2][3];
+				for (s32 e = 0; e < 2; e++)
+				{
+					for (s32 c = 0; c < 3; c++)
+					{
+						endpoints[e][c] = UnquantizeBC6H(ReadBlockBits(block, &position, 10));
+					}
+				}
+				for (s32 i = 0; i < 16; i++)
+				{
+					const s32 w = k_BPTCWeights4[ReadBlockBits(block, &position, i == 0 ? 3 : 4)];
+					for (s32 c = 0; c < 3; c++)
+					{
+						colors[i][c] = HalfBitsToFloat(FinishBC6H(((64 - w) * endpoints[0][c] + w * endpoints[1][c] + 32) >> 6));
+					}
+				}
+			}
+
+			for (s32 i = 0; i < 16; i++)
+			{
+				const s32 x = bx * 4 + (i & 3);
+				const s32 y = by * 4 + (i >> 2);
+				if (x < i_width && y < i_height)
+				{
+					memcpy(&o_rgb[(y * i_width + x) * 3], colors[i], 3 * sizeof(f32));
+				}
+			}
+		}
+	}
+}
+
+// -------------------------------------------------------------------
+
+void BenchmarkBPTC(floral::filesystem<FreelistArena>* i_fs, const_cstr i_inputFilename, const u32 i_threadsCount)
+{
+	typedef std::chrono::high_resolution_clock BenchmarkClock;
+	static const f64 k_MinSecondsPerRun = 0.5;
+	static const const_cstr k_QualityNames[] = { "fast", "normal", "high" };
+
+	floral::relative_path inputPath = floral::build_relative_path(i_inputFilename);
+	floral::file_info inputFile = floral::open_file_read(i_fs, inputPath);
+	if (inputFile.file_size == 0)
+	{
+		floral::close_file(inputFile);
+		CLOVER_ERROR("cannot read '%s'", i_inputFilename);
+		return;
+	}
+	voidptr inputFileData = g_BakingAllocator.allocate(inputFile.file_size);
+	floral::read_all_file(inputFile, inputFileData);
+	floral::close_file(inputFile);
+
+	s32 x, y, n;
+	const bool isHDR = stbi_is_hdr_from_memory((p8)inputFileData, inputFile.file_size) != 0;
+	voidptr data = nullptr;
+	if (isHDR)
+	{
+		data = stbi_loadf_from_memory((p8)inputFileData, inputFile.file_size, &x, &y, &n, 0);
+	}
+	else
+	{
+		data = stbi_load_from_memory((p8)inputFileData, inputFile.file_size, &x, &y, &n, 0);
+	}
+	g_BakingAllocator.free(inputFileData);
+	if (data == nullptr)
+	{
+		CLOVER_ERROR("cannot decode '%s': %s", i_inputFilename, stbi_failure_reason());
+		return;
+	}
+	if (isHDR && n < 3)
+	{
+		CLOVER_ERROR("'%s': BC6H needs rgb", i_inputFilename);
+		stbi_image_free(data);
+		return;
+	}
+
+	const s32 pixelsCount = x * y;
+	p8 compressedData = (p8)g_BakingAllocator.allocate(GetBPTCCompressedSize(x, y));
+	voidptr decodedData = g_BakingAllocator.allocate(pixelsCount * (isHDR ? 3 * sizeof(f32) : 4));
+
+	CLOVER_INFO("%s benchmark: %s (%dx%d, %d channels)", isHDR ? "BC6H" : "BC7", i_inputFilename, x, y, n);
+	const u32 threadsCounts[] = { 1, floral::max(i_threadsCount, 1u) };
+	for (s32 q = 0; q < 3; q++)
+	{
+		const BlockQuality quality = (BlockQuality)q;
+		for (s32 t = 0; t < 2; t++)
+		{
+			if (t == 1 && threadsCounts[1] == 1)
+			{
+				break;
+			}
+
+			s32 runsCount = 0;
+			const BenchmarkClock::time_point startTime = BenchmarkClock::now();
+			f64 seconds = 0.0;
+			do
+			{
+				if (isHDR)
+				{
+					CompressBC6HImage((const f32*)data, x, y, n, quality, threadsCounts[t], compressedData);
+				}
+				else
+				{
+					CompressBC7Image((const u8*)data, x, y, n, quality, threadsCounts[t], compressedData);
+				}
+				runsCount++;
+				seconds = std::chrono::duration<f64>(BenchmarkClock::now() - startTime).count();
+			}
+			while (seconds < k_MinSecondsPerRun);
+
+			// hdr: relative error, ldr: 0..255
+			f64 sum = 0.0;
+			if (isHDR)
+			{
+				DecompressBC6HImage(compressedData, x, y, (f32*)decodedData);
+				for (s32 i = 0; i < pixelsCount; i++)
+				{
+					for (s32 c = 0; c < 3; c++)
+					{
+						const f64 source = floral::max(((const f32*)data)[i * n + c], 0.0f);
+						const f64 d = (((const f32*)decodedData)[i * 3 + c] - source) / (source + 0.01);
+						sum += d * d;
+					}
+				}
+			}
+			else
+			{
+				DecompressBC7Image(compressedData, x, y, (p8)decodedData);
+				for (s32 i = 0; i < pixelsCount; i++)
+				{
+					for (s32 c = 0; c < n; c++)
+					{
+						const f64 d = (f64)((const u8*)data)[i * n + c] - (f64)((const u8*)decodedData)[i * 4 + c];
+						sum += d * d;
+					}
+				}
+			}
+			const f64 rmse = sqrt(sum / ((f64)pixelsCount * (isHDR ? 3 : n)));
+			const f64 mpixelsPerSecond = (f64)pixelsCount * runsCount / seconds / 1000000.0;
+			CLOVER_INFO("  %-6s | %2d threads | %9.2f Mpixels/s | %s %.4f", k_QualityNames[q], threadsCounts[t], mpixelsPerSecond,
+					isHDR ? "relative rmse" : "rmse", rmse);
+		}
+	}
+
+	g_BakingAllocator.free(decodedData);
+	g_BakingAllocator.free(compressedData);
+	stbi_image_free(data);
+}
+
+// -------------------------------------------------------------------
+}
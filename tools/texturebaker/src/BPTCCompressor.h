@@ -0,0 +1,38 @@
+#pragma once
+
+#include <floral.h>
+#include <floral/io/filesystem.h>
+
+#include "Memory/MemorySystem.h"
+#include "BlockCompression.h"
+
+namespace texbaker
+{
+// -------------------------------------------------------------------
+
+/*
+ * BPTC (BC6H / BC7), 16 bytes per 4x4 block, single subset modes only:
+ * - BC7 mode 6: rgba 7.7.7.7 endpoints + p-bit, 4 bits indices. 1 to 3 channels are encoded as
+ *   opaque rgb, 4 channels as rgba
+ * - BC6H mode 11 (unsigned float): 10 bits endpoints, 4 bits indices. Negative values are clamped to 0
+ */
+const size										GetBPTCCompressedSize(const s32 i_width, const s32 i_height);
+
+void											CompressBC7Image(const u8* i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+													const BlockQuality i_quality, const u32 i_threadsCount, p8 o_output);
+// i_numChannels: 3 or 4, alpha is ignored
+void											CompressBC6HImage(const f32* i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+													const BlockQuality i_quality, const u32 i_threadsCount, p8 o_output);
+
+// decoders for the modes above, o_rgba: i_width * i_height * 4 bytes, o_rgb: i_width * i_height * 3 floats
+void											DecompressBC7Image(const u8* i_input, const s32 i_width, const s32 i_height, p8 o_rgba);
+void											DecompressBC6HImage(const u8* i_input, const s32 i_width, const s32 i_height, f32* o_rgb);
+
+/*
+ * Compresses an image with every quality level on 1 and i_threadsCount threads and reports
+ * Mpixels/s and rmse against the source. LDR inputs go through BC7, HDR ones through BC6H.
+ */
+void											BenchmarkBPTC(floral::filesystem<FreelistArena>* i_fs, const_cstr i_inputFilename, const u32 i_threadsCount);
+
+// -------------------------------------------------------------------
+}
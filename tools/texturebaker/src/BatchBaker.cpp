@@ -0,0 +1,440 @@
+#include "BatchBaker.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include <clover/logger.h>
+
+namespace texbaker
+{
+// -------------------------------------------------------------------
+
+static const u32								k_MaxWorkers = 64;
+static const s32								k_MaxManifestTokens = 32;
+
+typedef std::chrono::high_resolution_clock		BakeClock;
+
+enum class FileState
+{
+	Pending = 0,
+	Loading,
+	Loaded,
+	Done,
+	Failed
+};
+
+// everything below is guarded by the scheduler's mutex, except the data of the surfaces being baked
+struct FileTask
+{
+	const BakeJob*								job;
+	FileState									state;
+	SourceImage									source;
+	BakedSurface*								surfaces;
+	s32											surfacesCount;
+	s32											nextSurface;		// next surface to hand out
+	s32											pendingSurfaces;	// surfaces not baked yet
+	size										footprint;
+
+	BakeClock::time_point						startTime;
+	f64											loadMs;
+	f64											bakeMs;				// sum over all workers
+	f64											writeMs;
+	f64											totalMs;
+};
+
+struct WorkItem
+{
+	FileTask*									file;
+	s32											surfaceIdx;			// -1: load the file
+};
+
+struct BatchScheduler
+{
+	floral::filesystem<FreelistArena>*			fileSystem;
+	FileTask*									files;
+	u32											filesCount;
+
+	u32											nextFile;
+	u32											firstActiveFile;
+	u32											finishedFiles;
+	u32											loadingFiles;
+
+	size										memoryBudget;
+	size										bytesInFlight;
+	size										peakBytesInFlight;
+	size										largestFootprint;
+	u32											compressionThreadsCount;
+
+	std::mutex									mutex;
+	std::condition_variable						workAvailable;
+};
+
+// -------------------------------------------------------------------
+
+static inline const f64 ElapsedMs(const BakeClock::time_point& i_from)
+{
+	return std::chrono::duration<f64, std::milli>(BakeClock::now() - i_from).count();
+}
+
+// must be called with the scheduler locked
+static const bool PickWork(BatchScheduler& io_scheduler, WorkItem* o_item)
+{
+	while (io_scheduler.firstActiveFile < io_scheduler.nextFile)
+	{
+		const FileTask& file = io_scheduler.files[io_scheduler.firstActiveFile];
+		const bool dispatched = file.state == FileState::Done || file.state == FileState::Failed
+			|| (file.state == FileState::Loaded && file.nextSurface == file.surfacesCount);
+		if (!dispatched)
+		{
+			break;
+		}
+		io_scheduler.firstActiveFile++;
+	}
+
+	// surfaces of the files in flight come first, so they are written and freed as soon as possible
+	for (u32 i = io_scheduler.firstActiveFile; i < io_scheduler.nextFile; i++)
+	{
+		FileTask& file = io_scheduler.files[i];
+		if (file.state == FileState::Loaded && file.nextSurface < file.surfacesCount)
+		{
+			o_item->file = &file;
+			o_item->surfaceIdx = file.nextSurface;
+			file.nextSurface++;
+			return true;
+		}
+	}
+
+	if (io_scheduler.nextFile < io_scheduler.filesCount)
+	{
+		// we do not know the size of the files being loaded yet, assume the worst we have seen
+		const size expectedBytes = io_scheduler.bytesInFlight + io_scheduler.loadingFiles * io_scheduler.largestFootprint;
+		const bool nothingInFlight = io_scheduler.nextFile == io_scheduler.finishedFiles;
+		if (nothingInFlight || expectedBytes < io_scheduler.memoryBudget)
+		{
+			FileTask& file = io_scheduler.files[io_scheduler.nextFile];
+			io_scheduler.nextFile++;
+			io_scheduler.loadingFiles++;
+			file.state = FileState::Loading;
+			o_item->file = &file;
+			o_item->surfaceIdx = -1;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void LoadFile(BatchScheduler& io_scheduler, FileTask* io_file)
+{
+	io_file->startTime = BakeClock::now();
+	bool loaded = LoadSource(io_scheduler.fileSystem, *io_file->job, &io_file->source);
+	if (loaded && GetSurfacesCount(io_file->source) <= 0)
+	{
+		// no surface would ever finish it
+		CLOVER_ERROR("%s: nothing to bake", io_file->job->inputFilePath);
+		FreeSource(&io_file->source);
+		loaded = false;
+	}
+
+	if (loaded)
+	{
+		io_file->surfacesCount = GetSurfacesCount(io_file->source);
+		io_file->surfaces = g_BakingAllocator.allocate_array<BakedSurface>(io_file->surfacesCount);
+		memset(io_file->surfaces, 0, sizeof(BakedSurface) * io_file->surfacesCount);
+		io_file->footprint = GetBakingFootprint(io_file->source);
+		io_file->source.compressionThreadsCount = io_scheduler.compressionThreadsCount;
+	}
+	io_file->loadMs = ElapsedMs(io_file->startTime);
+
+	std::lock_guard<std::mutex> lock(io_scheduler.mutex);
+	io_scheduler.loadingFiles--;
+	if (loaded)
+	{
+		io_file->state = FileState::Loaded;
+		io_file->nextSurface = 0;
+		io_file->pendingSurfaces = io_file->surfacesCount;
+		io_scheduler.bytesInFlight += io_file->footprint;
+		io_scheduler.peakBytesInFlight = floral::max(io_scheduler.peakBytesInFlight, io_scheduler.bytesInFlight);
+		io_scheduler.largestFootprint = floral::max(io_scheduler.largestFootprint, io_file->footprint);
+	}
+	else
+	{
+		io_file->state = FileState::Failed;
+		io_file->totalMs = io_file->loadMs;
+		io_scheduler.finishedFiles++;
+	}
+	io_scheduler.workAvailable.notify_all();
+}
+
+static void BakeFileSurface(BatchScheduler& io_scheduler, FileTask* io_file, const s32 i_surfaceIdx)
+{
+	const BakeClock::time_point bakeStart = BakeClock::now();
+	BakeSurface(io_file->source, i_surfaceIdx, &io_file->surfaces[i_surfaceIdx]);
+	const f64 bakeMs = ElapsedMs(bakeStart);
+
+	{
+		std::lock_guard<std::mutex> lock(io_scheduler.mutex);
+		io_file->bakeMs += bakeMs;
+		io_file->pendingSurfaces--;
+		if (io_file->pendingSurfaces > 0)
+		{
+			return;
+		}
+	}
+
+	// last surface of this file, nobody else is touching it anymore
+	const BakeClock::time_point writeStart = BakeClock::now();
+	WriteTexture(io_scheduler.fileSystem, *io_file->job, io_file->source, io_file->surfaces);
+	io_file->writeMs = ElapsedMs(writeStart);
+
+	for (s32 i = 0; i < io_file->surfacesCount; i++)
+	{
+		FreeSurface(&io_file->surfaces[i]);
+	}
+	g_BakingAllocator.free(io_file->surfaces);
+	io_file->surfaces = nullptr;
+	FreeSource(&io_file->source);
+	io_file->totalMs = ElapsedMs(io_file->startTime);
+
+	std::lock_guard<std::mutex> lock(io_scheduler.mutex);
+	io_file->state = FileState::Done;
+	io_scheduler.bytesInFlight -= io_file->footprint;
+	io_scheduler.finishedFiles++;
+	io_scheduler.workAvailable.notify_all();
+}
+
+static void WorkerLoop(BatchScheduler* io_scheduler)
+{
+	std::unique_lock<std::mutex> lock(io_scheduler->mutex);
+	while (io_scheduler->finishedFiles < io_scheduler->filesCount)
+	{
+		WorkItem item;
+		if (!PickWork(*io_scheduler, &item))
+		{
+			io_scheduler->workAvailable.wait(lock);
+			continue;
+		}
+
+		lock.unlock();
+		if (item.surfaceIdx < 0)
+		{
+			LoadFile(*io_scheduler, item.file);
+		}
+		else
+		{
+			BakeFileSurface(*io_scheduler, item.file, item.surfaceIdx);
+		}
+		lock.lock();
+	}
+}
+
+static void WorkerThread(BatchScheduler* io_scheduler, const_cstr i_threadName)
+{
+	clover::Initialize(i_threadName, clover::LogLevel::Verbose);
+	WorkerLoop(io_scheduler);
+}
+
+// -------------------------------------------------------------------
+
+const BatchOptions GetDefaultBatchOptions()
+{
+	BatchOptions options;
+	options.workersCount = 0;
+	options.memoryBudget = SIZE_MB(512);
+	return options;
+}
+
+// splits a manifest line in place, returns the number of tokens
+static const s32 TokenizeLine(cstr io_line, const_cstr* o_tokens, const s32 i_maxTokens)
+{
+	s32 tokensCount = 0;
+	cstr c = io_line;
+	while (*c != 0 && tokensCount < i_maxTokens)
+	{
+		if (*c == ' ' || *c == '\t' || *c == '\r')
+		{
+			c++;
+			continue;
+		}
+
+		const char terminator = (*c == '"') ? '"' : 0;
+		if (terminator)
+		{
+			c++;
+		}
+
+		o_tokens[tokensCount] = c;
+		tokensCount++;
+		while (*c != 0)
+		{
+			if (terminator ? (*c == terminator) : (*c == ' ' || *c == '\t' || *c == '\r'))
+			{
+				break;
+			}
+			c++;
+		}
+
+		if (*c != 0)
+		{
+			*c = 0;
+			c++;
+		}
+	}
+	return tokensCount;
+}
+
+const u32 LoadManifest(floral::filesystem<FreelistArena>* i_fs, const_cstr i_manifestPath, const BakeJob& i_defaults, BakeJob** o_jobs,
+		u32* o_invalidCount)
+{
+	*o_jobs = nullptr;
+	*o_invalidCount = 0;
+
+	floral::relative_path manifestPath = floral::build_relative_path(i_manifestPath);
+	floral::file_info manifestFile = floral::open_file_read(i_fs, manifestPath);
+	if (manifestFile.file_size == 0)
+	{
+		floral::close_file(manifestFile);
+		CLOVER_ERROR("cannot read manifest '%s'", i_manifestPath);
+		*o_invalidCount = 1;
+		return 0;
+	}
+
+	// job paths point into this buffer, it has to stay alive until the batch is done
+	cstr manifestText = (cstr)g_PersistanceAllocator.allocate(manifestFile.file_size + 1);
+	floral::read_all_file(manifestFile, manifestText);
+	floral::close_file(manifestFile);
+	manifestText[manifestFile.file_size] = 0;
+
+	u32 linesCount = 1;
+	for (size i = 0; i < manifestFile.file_size; i++)
+	{
+		if (manifestText[i] == '\n')
+		{
+			linesCount++;
+		}
+	}
+
+	BakeJob* jobs = g_PersistanceAllocator.allocate_array<BakeJob>(linesCount);
+	u32 jobsCount = 0;
+	u32 invalidCount = 0;
+	u32 lineIdx = 0;
+	cstr line = manifestText;
+	while (line)
+	{
+		lineIdx++;
+		cstr nextLine = strchr(line, '\n');
+		if (nextLine)
+		{
+			*nextLine = 0;
+			nextLine++;
+		}
+
+		const_cstr tokens[k_MaxManifestTokens];
+		const s32 tokensCount = TokenizeLine(line, tokens, k_MaxManifestTokens);
+		if (tokensCount > 0 && tokens[0][0] != '#')
+		{
+			BakeJob job = i_defaults;
+			if (ParseBakeJob(tokensCount, tokens, &job) && IsBakeJobValid(job))
+			{
+				jobs[jobsCount] = job;
+				jobsCount++;
+			}
+			else
+			{
+				CLOVER_ERROR("%s(%d): invalid entry, skipped", i_manifestPath, lineIdx);
+				invalidCount++;
+			}
+		}
+
+		line = nextLine;
+	}
+
+	CLOVER_INFO("Manifest '%s': %d textures, %d invalid entries", i_manifestPath, jobsCount, invalidCount);
+	*o_jobs = jobs;
+	*o_invalidCount = invalidCount;
+	return jobsCount;
+}
+
+const u32 RunBatch(floral::filesystem<FreelistArena>* i_fs, const BakeJob* i_jobs, const u32 i_jobsCount, const BatchOptions& i_options)
+{
+	if (i_jobsCount == 0)
+	{
+		return 0;
+	}
+
+	u32 workersCount = i_options.workersCount;
+	if (workersCount == 0)
+	{
+		workersCount = floral::max((u32)std::thread::hardware_concurrency(), 1u);
+	}
+	workersCount = floral::min(workersCount, k_MaxWorkers);
+
+	BatchScheduler scheduler;
+	scheduler.fileSystem = i_fs;
+	scheduler.files = g_PersistanceAllocator.allocate_array<FileTask>(i_jobsCount);
+	memset(scheduler.files, 0, sizeof(FileTask) * i_jobsCount);
+	for (u32 i = 0; i < i_jobsCount; i++)
+	{
+		scheduler.files[i].job = &i_jobs[i];
+		scheduler.files[i].state = FileState::Pending;
+	}
+	scheduler.filesCount = i_jobsCount;
+	scheduler.nextFile = 0;
+	scheduler.firstActiveFile = 0;
+	scheduler.finishedFiles = 0;
+	scheduler.loadingFiles = 0;
+	scheduler.memoryBudget = i_options.memoryBudget;
+	scheduler.bytesInFlight = 0;
+	scheduler.peakBytesInFlight = 0;
+	scheduler.largestFootprint = 0;
+	// the top mip of a file dominates its baking time, with fewer files than workers
+	// the spare workers help compressing the block rows of each surface
+	scheduler.compressionThreadsCount = floral::max(workersCount / floral::min(workersCount, i_jobsCount), 1u);
+
+	CLOVER_INFO("Baking %d textures on %d workers, memory budget: %d MB", i_jobsCount, workersCount, (s32)(i_options.memoryBudget >> 20));
+	const BakeClock::time_point batchStart = BakeClock::now();
+
+	char threadNames[k_MaxWorkers][32];
+	std::thread workers[k_MaxWorkers];
+	for (u32 i = 1; i < workersCount; i++)
+	{
+		snprintf(threadNames[i], 32, "baker_worker_%d", i);
+		workers[i] = std::thread(&WorkerThread, &scheduler, threadNames[i]);
+	}
+	WorkerLoop(&scheduler);
+	for (u32 i = 1; i < workersCount; i++)
+	{
+		workers[i].join();
+	}
+
+	const f64 batchMs = ElapsedMs(batchStart);
+
+	u32 failedCount = 0;
+	f64 bakeMs = 0.0;
+	for (u32 i = 0; i < i_jobsCount; i++)
+	{
+		const FileTask& file = scheduler.files[i];
+		if (file.state == FileState::Failed)
+		{
+			CLOVER_INFO("[failed] %s", file.job->inputFilePath);
+			failedCount++;
+			continue;
+		}
+
+		CLOVER_INFO("[done] %s: load %.1f ms, bake %.1f ms (cpu), write %.1f ms, total %.1f ms",
+				file.job->inputFilePath, file.loadMs, file.bakeMs, file.writeMs, file.totalMs);
+		bakeMs += file.bakeMs;
+	}
+
+	CLOVER_INFO("Batch done: %d textures, %d failed, %.2f s (%.2f s of baking), peak memory in flight: %.1f MB",
+			i_jobsCount, failedCount, batchMs / 1000.0, bakeMs / 1000.0, (f64)scheduler.peakBytesInFlight / (1024.0 * 1024.0));
+	return failedCount;
+}
+
+// -------------------------------------------------------------------
+}
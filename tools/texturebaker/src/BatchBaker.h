@@ -0,0 +1,43 @@
+#pragma once
+
+#include <floral.h>
+#include <floral/io/filesystem.h>
+
+#include "Memory/MemorySystem.h"
+#include "TextureBaker.h"
+
+namespace texbaker
+{
+// -------------------------------------------------------------------
+
+struct BatchOptions
+{
+	u32											workersCount;		// 0: one per hardware thread
+	size										memoryBudget;		// no new file is loaded while the files in flight use more than this
+};
+
+const BatchOptions								GetDefaultBatchOptions();
+
+/*
+ * Manifest: one texture per line, using the same options as the command line, e.g.
+ *     --input gfx/a.tga --output gfx/a.cbtex --dim 2d --color-range ldr --compression dxt
+ * - empty lines and lines starting with '#' are skipped, paths with spaces can be quoted
+ * - i_defaults is the base of every entry (options given on the command line)
+ * - jobs and their strings are allocated from g_PersistanceAllocator
+ * - o_invalidCount: entries that did not parse or are incomplete, an unreadable manifest counts as 1
+ * Returns the number of valid entries written to o_jobs.
+ */
+const u32										LoadManifest(floral::filesystem<FreelistArena>* i_fs, const_cstr i_manifestPath,
+													const BakeJob& i_defaults, BakeJob** o_jobs, u32* o_invalidCount);
+
+/*
+ * Bakes all the jobs on a pool of workers (the calling thread is one of them). Files are loaded
+ * in order, every face / mip of a loaded file is a separate work item and the file is written
+ * by whoever finishes its last surface. Timings are reported per file when all jobs are done.
+ * Returns the number of jobs that failed.
+ */
+const u32										RunBatch(floral::filesystem<FreelistArena>* i_fs, const BakeJob* i_jobs, const u32 i_jobsCount,
+													const BatchOptions& i_options);
+
+// -------------------------------------------------------------------
+}
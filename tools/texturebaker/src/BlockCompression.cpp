@@ -0,0 +1,300 @@
+#include "BlockCompression.h"
+
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#include <atomic>
+#include <thread>
+
+namespace texbaker
+{
+// -------------------------------------------------------------------
+
+static const u32								k_MaxBlockThreads = 64;
+static const s32								k_BlockRowsPerTask = 4;
+static const s32								k_PowerIterations = 8;
+
+struct BlockRowsJob
+{
+	CompressBlockRowsFunc						compressRows;
+	voidptr										job;
+	s32											rowsCount;
+	std::atomic<s32>							nextRow;
+};
+
+// -------------------------------------------------------------------
+
+static void CompressBlockRowsWorker(BlockRowsJob* io_job)
+{
+	while (true)
+	{
+		const s32 firstRow = io_job->nextRow.fetch_add(k_BlockRowsPerTask);
+		if (firstRow >= io_job->rowsCount)
+		{
+			break;
+		}
+		const s32 lastRow = floral::min(firstRow + k_BlockRowsPerTask, io_job->rowsCount);
+		io_job->compressRows(io_job->job, firstRow, lastRow);
+	}
+}
+
+void CompressBlockRowsParallel(const s32 i_rowsCount, const u32 i_threadsCount, CompressBlockRowsFunc i_compressRows, voidptr i_job)
+{
+	const u32 tasksCount = (i_rowsCount + k_BlockRowsPerTask - 1) / k_BlockRowsPerTask;
+	const u32 threadsCount = floral::min(floral::min(i_threadsCount, tasksCount), k_MaxBlockThreads);
+	if (threadsCount <= 1)
+	{
+		i_compressRows(i_job, 0, i_rowsCount);
+		return;
+	}
+
+	BlockRowsJob job;
+	job.compressRows = i_compressRows;
+	job.job = i_job;
+	job.rowsCount = i_rowsCount;
+	job.nextRow = 0;
+
+	std::thread threads[k_MaxBlockThreads];
+	for (u32 i = 1; i < threadsCount; i++)
+	{
+		threads[i] = std::thread(&CompressBlockRowsWorker, &job);
+	}
+	CompressBlockRowsWorker(&job);
+	for (u32 i = 1; i < threadsCount; i++)
+	{
+		threads[i].join();
+	}
+}
+
+// -------------------------------------------------------------------
+
+void GatherBlockU8(const u8* i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+		const s32 i_x, const s32 i_y, f32 o_block[16][4])
+{
+	for (s32 i = 0; i < 16; i++)
+	{
+		const s32 x = floral::min(i_x + (i & 3), i_width - 1);
+		const s32 y = floral::min(i_y + (i >> 2), i_height - 1);
+		const u8* pixel = &i_input[(y * i_width + x) * i_numChannels];
+		o_block[i][0] = 0.0f;
+		o_block[i][1] = 0.0f;
+		o_block[i][2] = 0.0f;
+		o_block[i][3] = 255.0f;
+		for (s32 c = 0; c < i_numChannels; c++)
+		{
+			o_block[i][c] = (f32)pixel[c];
+		}
+	}
+}
+
+void GatherBlockF32(const f32* i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+		const s32 i_x, const s32 i_y, f32 o_block[16][4])
+{
+	for (s32 i = 0; i < 16; i++)
+	{
+		const s32 x = floral::min(i_x + (i & 3), i_width - 1);
+		const s32 y = floral::min(i_y + (i >> 2), i_height - 1);
+		const f32* pixel = &i_input[(y * i_width + x) * i_numChannels];
+		o_block[i][0] = 0.0f;
+		o_block[i][1] = 0.0f;
+		o_block[i][2] = 0.0f;
+		o_block[i][3] = 1.0f;
+		for (s32 c = 0; c < i_numChannels; c++)
+		{
+			o_block[i][c] = pixel[c];
+		}
+	}
+}
+
+// -------------------------------------------------------------------
+
+void FitBlockEndpoints(const f32 i_block[16][4], const s32 i_channelsCount, const bool i_usePCA,
+		const f32 i_maxValue, f32 o_endpoint0[4], f32 o_endpoint1[4])
+{
+	const s32 n = i_channelsCount;
+	f32 minValue[4], maxValue[4], mean[4];
+	for (s32 c = 0; c < n; c++)
+	{
+		minValue[c] = i_block[0][c];
+		maxValue[c] = i_block[0][c];
+		mean[c] = 0.0f;
+	}
+	for (s32 i = 0; i < 16; i++)
+	{
+		for (s32 c = 0; c < n; c++)
+		{
+			minValue[c] = floral::min(minValue[c], i_block[i][c]);
+			maxValue[c] = floral::max(maxValue[c], i_block[i][c]);
+			mean[c] += i_block[i][c];
+		}
+	}
+
+	if (!i_usePCA)
+	{
+		for (s32 c = 0; c < n; c++)
+		{
+			o_endpoint0[c] = minValue[c];
+			o_endpoint1[c] = maxValue[c];
+		}
+		return;
+	}
+
+	f32 covariance[4][4];
+	memset(covariance, 0, sizeof(covariance));
+	for (s32 c = 0; c < n; c++)
+	{
+		mean[c] /= 16.0f;
+	}
+	for (s32 i = 0; i < 16; i++)
+	{
+		for (s32 c0 = 0; c0 < n; c0++)
+		{
+			const f32 d0 = i_block[i][c0] - mean[c0];
+			for (s32 c1 = c0; c1 < n; c1++)
+			{
+				covariance[c0][c1] += d0 * (i_block[i][c1] - mean[c1]);
+			}
+		}
+	}
+	for (s32 c0 = 0; c0 < n; c0++)
+	{
+		for (s32 c1 = 0; c1 < c0; c1++)
+		{
+			covariance[c0][c1] = covariance[c1][c0];
+		}
+	}
+
+	// power iteration, starting from the bounding box diagonal
+	f32 axis[4];
+	for (s32 c = 0; c < n; c++)
+	{
+		axis[c] = maxValue[c] - minValue[c];
+	}
+	for (s32 k = 0; k < k_PowerIterations; k++)
+	{
+		f32 next[4];
+		f32 length = 0.0f;
+		for (s32 c0 = 0; c0 < n; c0++)
+		{
+			next[c0] = 0.0f;
+			for (s32 c1 = 0; c1 < n; c1++)
+			{
+				next[c0] += covariance[c0][c1] * axis[c1];
+			}
+			length = floral::max(length, fabsf(next[c0]));
+		}
+		if (length < 1e-12f)
+		{
+			break;
+		}
+		for (s32 c = 0; c < n; c++)
+		{
+			axis[c] = next[c] / length;
+		}
+	}
+
+	f32 axisLength2 = 0.0f;
+	for (s32 c = 0; c < n; c++)
+	{
+		axisLength2 += axis[c] * axis[c];
+	}
+	if (axisLength2 < 1e-12f)
+	{
+		// flat block
+		for (s32 c = 0; c < n; c++)
+		{
+			o_endpoint0[c] = mean[c];
+			o_endpoint1[c] = mean[c];
+		}
+		return;
+	}
+
+	f32 minT = FLT_MAX, maxT = -FLT_MAX;
+	for (s32 i = 0; i < 16; i++)
+	{
+		f32 t = 0.0f;
+		for (s32 c = 0; c < n; c++)
+		{
+			t += (i_block[i][c] - mean[c]) * axis[c];
+		}
+		minT = floral::min(minT, t);
+		maxT = floral::max(maxT, t);
+	}
+	minT /= axisLength2;
+	maxT /= axisLength2;
+	for (s32 c = 0; c < n; c++)
+	{
+		o_endpoint0[c] = floral::clamp(mean[c] + axis[c] * minT, 0.0f, i_maxValue);
+		o_endpoint1[c] = floral::clamp(mean[c] + axis[c] * maxT, 0.0f, i_maxValue);
+	}
+}
+
+const bool RefineBlockEndpoints(const f32 i_block[16][4], const f32 i_weights[16], const s32 i_channelsCount,
+		const f32 i_maxValue, f32 io_endpoint0[4], f32 io_endpoint1[4])
+{
+	// minimizes sum(|(1 - w) * e0 + w * e1 - p|^2), one 2x2 system shared by every channel
+	f32 aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	f32 ap[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	f32 bp[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for (s32 i = 0; i < 16; i++)
+	{
+		const f32 b = i_weights[i];
+		const f32 a = 1.0f - b;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for (s32 c = 0; c < i_channelsCount; c++)
+		{
+			ap[c] += a * i_block[i][c];
+			bp[c] += b * i_block[i][c];
+		}
+	}
+
+	const f32 determinant = aa * bb - ab * ab;
+	if (fabsf(determinant) < 1e-6f)
+	{
+		return false;
+	}
+
+	const f32 invDeterminant = 1.0f / determinant;
+	for (s32 c = 0; c < i_channelsCount; c++)
+	{
+		io_endpoint0[c] = floral::clamp((ap[c] * bb - bp[c] * ab) * invDeterminant, 0.0f, i_maxValue);
+		io_endpoint1[c] = floral::clamp((bp[c] * aa - ap[c] * ab) * invDeterminant, 0.0f, i_maxValue);
+	}
+	return true;
+}
+
+// -------------------------------------------------------------------
+
+void InitBlockBits(BlockBits* o_bits)
+{
+	memset(o_bits->bytes, 0, sizeof(o_bits->bytes));
+	o_bits->position = 0;
+}
+
+void WriteBlockBits(BlockBits* io_bits, const u32 i_value, const s32 i_bitsCount)
+{
+	for (s32 i = 0; i < i_bitsCount; i++)
+	{
+		const s32 position = io_bits->position + i;
+		io_bits->bytes[position >> 3] |= (u8)(((i_value >> i) & 1) << (position & 7));
+	}
+	io_bits->position += i_bitsCount;
+}
+
+const u32 ReadBlockBits(const u8* i_block, s32* io_position, const s32 i_bitsCount)
+{
+	u32 value = 0;
+	for (s32 i = 0; i < i_bitsCount; i++)
+	{
+		const s32 position = *io_position + i;
+		value |= (u32)((i_block[position >> 3] >> (position & 7)) & 1) << i;
+	}
+	*io_position += i_bitsCount;
+	return value;
+}
+
+// -------------------------------------------------------------------
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <floral.h>
+
+#include "Memory/MemorySystem.h"
+
+namespace texbaker
+{
+// -------------------------------------------------------------------
+
+/*
+ * Presets of the single subset 4x4 block encoders (BC6H, BC7, ASTC):
+ * - Fast: bounding box endpoints, no refinement
+ * - Normal: principal axis endpoints + 1 least squares refinement
+ * - High: principal axis endpoints + 3 refinements, exhaustive p-bits search (BC7)
+ */
+enum class BlockQuality
+{
+	Fast = 0,
+	Normal,
+	High
+};
+
+typedef void (*CompressBlockRowsFunc)(voidptr i_job, const s32 i_firstRow, const s32 i_lastRow);
+
+// block rows [0, i_rowsCount) over i_threadsCount threads, the calling thread is one of them
+void											CompressBlockRowsParallel(const s32 i_rowsCount, const u32 i_threadsCount,
+													CompressBlockRowsFunc i_compressRows, voidptr i_job);
+
+/*
+ * 4x4 block at (i_x, i_y) in f32, pixels outside of the image repeat the edge. Missing channels
+ * are 0, missing alpha is 255 (1.0f).
+ */
+void											GatherBlockU8(const u8* i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+													const s32 i_x, const s32 i_y, f32 o_block[16][4]);
+void											GatherBlockF32(const f32* i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+													const s32 i_x, const s32 i_y, f32 o_block[16][4]);
+
+/*
+ * Endpoints of the segment fitting the first i_channelsCount channels of the block: along the
+ * principal axis with i_usePCA, the bounding box diagonal otherwise. Clamped to [0, i_maxValue].
+ */
+void											FitBlockEndpoints(const f32 i_block[16][4], const s32 i_channelsCount, const bool i_usePCA,
+													const f32 i_maxValue, f32 o_endpoint0[4], f32 o_endpoint1[4]);
+
+/*
+ * Least squares endpoints for the interpolation weights of each pixel (0: endpoint 0, 1: endpoint 1).
+ * Returns false when the weights are all the same, the endpoints are left alone then.
+ */
+const bool										RefineBlockEndpoints(const f32 i_block[16][4], const f32 i_weights[16], const s32 i_channelsCount,
+													const f32 i_maxValue, f32 io_endpoint0[4], f32 io_endpoint1[4]);
+
+// 128 bits blocks, fields are packed from the lowest bit
+struct BlockBits
+{
+	u8											bytes[16];
+	s32											position;
+};
+
+void											InitBlockBits(BlockBits* o_bits);
+void											WriteBlockBits(BlockBits* io_bits, const u32 i_value, const s32 i_bitsCount);
+const u32										ReadBlockBits(const u8* i_block, s32* io_position, const s32 i_bitsCount);
+
+// -------------------------------------------------------------------
+}
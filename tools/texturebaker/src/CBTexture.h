@@ -41,7 +41,10 @@ enum class Compression
 {
 	NoCompress = 0,
 	DXT,										// auto choose dxt1 for rgb / dxt5 for rgba
-	ETC
+	ETC,
+	BC6H,										// hdr only, unsigned float
+	BC7,										// hdr inputs are encoded as rgbm
+	ASTC										// 4x4 blocks, hdr inputs are encoded as rgbm
 };
 
 // -------------------------------------------------------------------
@@ -59,7 +62,41 @@ struct TextureHeader
 	u32											resolution;
 	Compression									compression;
 };
+
+/*
+ * v2 container, see tex_loader::TextureFileHeader:
+ * - TextureFileHeader
+ * - SurfaceEntry x surfacesCount, surface index = face * mipsCount + mip
+ * - padding up to payloadOffset, a multiple of payloadAlignment
+ * - the payload: every surface packed in surface index order
+ */
+struct TextureFileHeader
+{
+	c8											magicCharacters[4];		// "CBTX"
+	u32											version;
+	TextureHeader								header;
+	u32											facesCount;
+	u32											surfacesCount;
+	u32											payloadAlignment;
+	u64											payloadOffset;			// from the start of the file
+	u64											payloadSize;			// stored bytes
+};
+
+struct SurfaceEntry
+{
+	u32											face;
+	u32											mip;
+	u32											width;
+	u32											height;
+	u64											offset;					// from payloadOffset
+	u64											size;					// bytes uploaded to the gpu
+	u64											compressedSize;			// bytes stored in the file, == size when stored as is
+};
 #pragma pack(pop)
 
+static const u32								k_TextureFileVersion = 2;
+static const u32								k_MinPayloadAlignment = 16;
+static const u32								k_PagePayloadAlignment = 4096;	// the payload can be mapped and uploaded as is
+
 // -------------------------------------------------------------------
 }
@@ -0,0 +1,396 @@
+#include "CubeMap.h"
+
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#include "Memory/MemorySystem.h"
+
+namespace texbaker
+{
+// -------------------------------------------------------------------
+
+const floral::vec3f GetCubeMapDirection(const s32 i_face, const f32 i_u, const f32 i_v)
+{
+	floral::vec3f direction;
+	switch (i_face)
+	{
+	case 0:
+		direction = floral::vec3f(1.0f, -i_v, -i_u);
+		break;
+	case 1:
+		direction = floral::vec3f(-1.0f, -i_v, i_u);
+		break;
+	case 2:
+		direction = floral::vec3f(i_u, 1.0f, i_v);
+		break;
+	case 3:
+		direction = floral::vec3f(i_u, -1.0f, -i_v);
+		break;
+	case 4:
+		direction = floral::vec3f(i_u, -i_v, 1.0f);
+		break;
+	default:
+		direction = floral::vec3f(-i_u, -i_v, -1.0f);
+		break;
+	}
+	return floral::normalize(direction);
+}
+
+const floral::vec3f GetCubeMapTexelDirection(const s32 i_face, const s32 i_x, const s32 i_y, const s32 i_faceSize)
+{
+	const f32 u = 2.0f * ((f32)i_x + 0.5f) / (f32)i_faceSize - 1.0f;
+	const f32 v = 2.0f * ((f32)i_y + 0.5f) / (f32)i_faceSize - 1.0f;
+	return GetCubeMapDirection(i_face, u, v);
+}
+
+void GetCubeMapFaceUV(const floral::vec3f& i_direction, s32* o_face, f32* o_u, f32* o_v)
+{
+	const f32 ax = fabsf(i_direction.x);
+	const f32 ay = fabsf(i_direction.y);
+	const f32 az = fabsf(i_direction.z);
+
+	f32 sc, tc, ma;
+	if (ax >= ay && ax >= az)
+	{
+		ma = ax;
+		tc = -i_direction.y;
+		if (i_direction.x > 0.0f)
+		{
+			*o_face = 0;
+			sc = -i_direction.z;
+		}
+		else
+		{
+			*o_face = 1;
+			sc = i_direction.z;
+		}
+	}
+	else if (ay >= az)
+	{
+		ma = ay;
+		sc = i_direction.x;
+		if (i_direction.y > 0.0f)
+		{
+			*o_face = 2;
+			tc = i_direction.z;
+		}
+		else
+		{
+			*o_face = 3;
+			tc = -i_direction.z;
+		}
+	}
+	else
+	{
+		ma = az;
+		tc = -i_direction.y;
+		if (i_direction.z > 0.0f)
+		{
+			*o_face = 4;
+			sc = i_direction.x;
+		}
+		else
+		{
+			*o_face = 5;
+			sc = -i_direction.x;
+		}
+	}
+
+	*o_u = sc / ma;
+	*o_v = tc / ma;
+}
+
+// -------------------------------------------------------------------
+
+void ResolveCubeMapTexel(const s32 i_face, const s32 i_x, const s32 i_y, const s32 i_faceSize,
+		s32* o_face, s32* o_x, s32* o_y)
+{
+	if (i_x >= 0 && i_x < i_faceSize && i_y >= 0 && i_y < i_faceSize)
+	{
+		*o_face = i_face;
+		*o_x = i_x;
+		*o_y = i_y;
+		return;
+	}
+
+	f32 u = 0.0f, v = 0.0f;
+	GetCubeMapFaceUV(GetCubeMapTexelDirection(i_face, i_x, i_y, i_faceSize), o_face, &u, &v);
+	*o_x = floral::clamp((s32)floorf((u + 1.0f) * 0.5f * (f32)i_faceSize), 0, i_faceSize - 1);
+	*o_y = floral::clamp((s32)floorf((v + 1.0f) * 0.5f * (f32)i_faceSize), 0, i_faceSize - 1);
+}
+
+// solid angle of the face area between (0, 0) and (i_x, i_y), on the z = 1 plane
+static inline const f32 AreaElement(const f32 i_x, const f32 i_y)
+{
+	return atan2f(i_x * i_y, sqrtf(i_x * i_x + i_y * i_y + 1.0f));
+}
+
+const f32 GetCubeMapTexelSolidAngle(const s32 i_x, const s32 i_y, const s32 i_faceSize)
+{
+	const f32 texelSize = 2.0f / (f32)i_faceSize;
+	const f32 x0 = (f32)i_x * texelSize - 1.0f;
+	const f32 y0 = (f32)i_y * texelSize - 1.0f;
+	const f32 x1 = x0 + texelSize;
+	const f32 y1 = y0 + texelSize;
+	return AreaElement(x0, y0) - AreaElement(x0, y1) - AreaElement(x1, y0) + AreaElement(x1, y1);
+}
+
+const s32 GetCubeMapSharedTexels(const s32 i_face, const s32 i_x, const s32 i_y, const s32 i_faceSize,
+		s32* o_faces, s32* o_xs, s32* o_ys)
+{
+	if (i_faceSize == 1)
+	{
+		for (s32 i = 0; i < 6; i++)
+		{
+			o_faces[i] = (i_face + i) % 6;
+			o_xs[i] = 0;
+			o_ys[i] = 0;
+		}
+		return 6;
+	}
+
+	o_faces[0] = i_face;
+	o_xs[0] = i_x;
+	o_ys[0] = i_y;
+	s32 count = 1;
+
+	// the texel right across each edge is the border texel of the neighbor face
+	const s32 last = i_faceSize - 1;
+	if (i_x == 0 || i_x == last)
+	{
+		const s32 dx = (i_x == 0) ? -1 : 1;
+		ResolveCubeMapTexel(i_face, i_x + dx, i_y, i_faceSize, &o_faces[count], &o_xs[count], &o_ys[count]);
+		count++;
+	}
+	if (i_y == 0 || i_y == last)
+	{
+		const s32 dy = (i_y == 0) ? -1 : 1;
+		ResolveCubeMapTexel(i_face, i_x, i_y + dy, i_faceSize, &o_faces[count], &o_xs[count], &o_ys[count]);
+		count++;
+	}
+	return count;
+}
+
+// -------------------------------------------------------------------
+
+static inline const f32* FetchTexel(const f32* const* i_levels, const s32 i_size, const s32 i_numChannels,
+		const s32 i_face, const s32 i_x, const s32 i_y)
+{
+	s32 face = 0, x = 0, y = 0;
+	ResolveCubeMapTexel(i_face, i_x, i_y, i_size, &face, &x, &y);
+	return &i_levels[face][(y * i_size + x) * i_numChannels];
+}
+
+static void SampleLevelBilinear(const f32* const* i_levels, const s32 i_size, const s32 i_numChannels,
+		const s32 i_face, const f32 i_u, const f32 i_v, f32* o_color)
+{
+	const f32 fx = (i_u + 1.0f) * 0.5f * (f32)i_size - 0.5f;
+	const f32 fy = (i_v + 1.0f) * 0.5f * (f32)i_size - 0.5f;
+	const f32 flx = floorf(fx);
+	const f32 fly = floorf(fy);
+	const f32 tx = fx - flx;
+	const f32 ty = fy - fly;
+	const s32 x0 = (s32)flx;
+	const s32 y0 = (s32)fly;
+
+	const f32* p00 = FetchTexel(i_levels, i_size, i_numChannels, i_face, x0, y0);
+	const f32* p10 = FetchTexel(i_levels, i_size, i_numChannels, i_face, x0 + 1, y0);
+	const f32* p01 = FetchTexel(i_levels, i_size, i_numChannels, i_face, x0, y0 + 1);
+	const f32* p11 = FetchTexel(i_levels, i_size, i_numChannels, i_face, x0 + 1, y0 + 1);
+	for (s32 c = 0; c < i_numChannels; c++)
+	{
+		const f32 top = p00[c] + (p10[c] - p00[c]) * tx;
+		const f32 bottom = p01[c] + (p11[c] - p01[c]) * tx;
+		o_color[c] = top + (bottom - top) * ty;
+	}
+}
+
+static void SampleMipBilinear(const CubeMapChains& i_cubeMap, const s32 i_mip, const s32 i_face, const f32 i_u, const f32 i_v,
+		f32* o_color)
+{
+	const s32 n = i_cubeMap.numChannels;
+	const size offset = GetMipOffset(i_cubeMap.faceSize, i_cubeMap.faceSize, n, i_mip);
+	const f32* levels[6];
+	for (s32 i = 0; i < 6; i++)
+	{
+		levels[i] = &i_cubeMap.faces[i][offset];
+	}
+	SampleLevelBilinear(levels, floral::max(i_cubeMap.faceSize >> i_mip, 1), n, i_face, i_u, i_v, o_color);
+}
+
+void SampleCubeMap(const CubeMapChains& i_cubeMap, const floral::vec3f& i_direction, const f32 i_lod, f32* o_color)
+{
+	s32 face = 0;
+	f32 u = 0.0f, v = 0.0f;
+	GetCubeMapFaceUV(i_direction, &face, &u, &v);
+
+	const s32 n = i_cubeMap.numChannels;
+	const f32 lod = floral::clamp(i_lod, 0.0f, (f32)(i_cubeMap.mipsCount - 1));
+	const s32 mip0 = (s32)lod;
+	const s32 mip1 = floral::min(mip0 + 1, i_cubeMap.mipsCount - 1);
+	const f32 t = lod - (f32)mip0;
+
+	SampleMipBilinear(i_cubeMap, mip0, face, u, v, o_color);
+	if (mip1 == mip0 || t <= 0.0f)
+	{
+		return;
+	}
+
+	f32 color1[4];
+	SampleMipBilinear(i_cubeMap, mip1, face, u, v, color1);
+	for (s32 c = 0; c < n; c++)
+	{
+		o_color[c] += (color1[c] - o_color[c]) * t;
+	}
+}
+
+// -------------------------------------------------------------------
+
+static void DownsampleCubeMapLevel(const f32* const* i_src, const s32 i_srcSize, const s32 i_numChannels,
+		const FilterKernel& i_kernel, const f32* i_solidAngles, f32* const* o_dst)
+{
+	const s32 n = i_numChannels;
+	const s32 dstSize = floral::max(i_srcSize >> 1, 1);
+	for (s32 face = 0; face < 6; face++)
+	{
+		for (s32 y = 0; y < dstSize; y++)
+		{
+			const s32 firstY = 2 * y + i_kernel.firstTap;
+			for (s32 x = 0; x < dstSize; x++)
+			{
+				const s32 firstX = 2 * x + i_kernel.firstTap;
+				// most footprints are inside of the face and don't need the cross-face addressing
+				const bool inside = firstX >= 0 && firstY >= 0
+					&& firstX + i_kernel.tapsCount <= i_srcSize && firstY + i_kernel.tapsCount <= i_srcSize;
+
+				f32 sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				f32 totalWeight = 0.0f;
+				for (s32 ky = 0; ky < i_kernel.tapsCount; ky++)
+				{
+					for (s32 kx = 0; kx < i_kernel.tapsCount; kx++)
+					{
+						s32 srcFace = face, sx = firstX + kx, sy = firstY + ky;
+						if (!inside)
+						{
+							ResolveCubeMapTexel(face, firstX + kx, firstY + ky, i_srcSize, &srcFace, &sx, &sy);
+						}
+
+						const s32 srcIndex = sy * i_srcSize + sx;
+						const f32 weight = i_kernel.weights[kx] * i_kernel.weights[ky] * i_solidAngles[srcIndex];
+						const f32* texel = &i_src[srcFace][srcIndex * n];
+						for (s32 c = 0; c < n; c++)
+						{
+							sum[c] += texel[c] * weight;
+						}
+						totalWeight += weight;
+					}
+				}
+
+				f32* texel = &o_dst[face][(y * dstSize + x) * n];
+				for (s32 c = 0; c < n; c++)
+				{
+					texel[c] = sum[c] / totalWeight;
+				}
+			}
+		}
+	}
+}
+
+void BuildCubeMapMipChains(f32* const* io_faces, const s32 i_faceSize, const s32 i_numChannels,
+		const s32 i_mipsCount, const MipChainOptions& i_options)
+{
+	FLORAL_ASSERT(i_numChannels <= 4);
+
+	FilterKernel kernel;
+	BuildFilterKernel(i_options.filter, &kernel);
+
+	const s32 n = i_numChannels;
+	f32* solidAngles = g_BakingAllocator.allocate_array<f32>((size)i_faceSize * i_faceSize);
+	for (s32 mip = 1; mip < i_mipsCount; mip++)
+	{
+		const s32 srcSize = floral::max(i_faceSize >> (mip - 1), 1);
+		const s32 dstSize = floral::max(srcSize >> 1, 1);
+		for (s32 y = 0; y < srcSize; y++)
+		{
+			for (s32 x = 0; x < srcSize; x++)
+			{
+				solidAngles[y * srcSize + x] = GetCubeMapTexelSolidAngle(x, y, srcSize);
+			}
+		}
+
+		const f32* src[6];
+		f32* dst[6];
+		const size srcOffset = GetMipOffset(i_faceSize, i_faceSize, n, mip - 1);
+		const size dstOffset = GetMipOffset(i_faceSize, i_faceSize, n, mip);
+		for (s32 i = 0; i < 6; i++)
+		{
+			src[i] = &io_faces[i][srcOffset];
+			dst[i] = &io_faces[i][dstOffset];
+		}
+
+		DownsampleCubeMapLevel(src, srcSize, n, kernel, solidAngles, dst);
+		for (s32 i = 0; i < 6; i++)
+		{
+			ClampLevel(dst[i], (size)dstSize * dstSize * n, 0.0f, FLT_MAX);
+		}
+	}
+	g_BakingAllocator.free(solidAngles);
+}
+
+void FixupCubeMapEdges(f32* const* io_levels, const s32 i_size, const s32 i_numChannels)
+{
+	FLORAL_ASSERT(i_numChannels <= 4);
+
+	const s32 n = i_numChannels;
+	const s32 borderCount = (i_size == 1) ? 1 : 4 * (i_size - 1);
+	f32* averages = g_BakingAllocator.allocate_array<f32>((size)6 * borderCount * n);
+
+	// averages first, from the untouched texels, the shared texels of every face get the same value
+	for (s32 pass = 0; pass < 2; pass++)
+	{
+		s32 index = 0;
+		for (s32 face = 0; face < 6; face++)
+		{
+			for (s32 y = 0; y < i_size; y++)
+			{
+				const bool borderRow = (y == 0 || y == i_size - 1);
+				for (s32 x = 0; x < i_size; x += (borderRow ? 1 : i_size - 1))
+				{
+					f32* average = &averages[index * n];
+					index++;
+					if (pass == 1)
+					{
+						memcpy(&io_levels[face][(y * i_size + x) * n], average, n * sizeof(f32));
+						continue;
+					}
+
+					s32 faces[k_MaxSharedTexels], xs[k_MaxSharedTexels], ys[k_MaxSharedTexels];
+					const s32 count = GetCubeMapSharedTexels(face, x, y, i_size, faces, xs, ys);
+					for (s32 c = 0; c < n; c++)
+					{
+						average[c] = 0.0f;
+					}
+					for (s32 i = 0; i < count; i++)
+					{
+						const f32* texel = &io_levels[faces[i]][(ys[i] * i_size + xs[i]) * n];
+						for (s32 c = 0; c < n; c++)
+						{
+							average[c] += texel[c];
+						}
+					}
+					for (s32 c = 0; c < n; c++)
+					{
+						average[c] /= (f32)count;
+					}
+				}
+			}
+		}
+		FLORAL_ASSERT(index == 6 * borderCount);
+	}
+
+	g_BakingAllocator.free(averages);
+}
+
+// -------------------------------------------------------------------
+}
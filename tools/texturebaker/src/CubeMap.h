@@ -0,0 +1,76 @@
+#pragma once
+
+#include <floral.h>
+#include <floral/gpds/vec.h>
+
+#include "MipBuilder.h"
+
+namespace texbaker
+{
+// -------------------------------------------------------------------
+
+/*
+ * Faces are in GL order (+x, -x, +y, -y, +z, -z) with the first row of each face at the top, which
+ * is how the h-strips are laid out and how TextureLoader uploads them.
+ * u, v are in [-1, 1], u goes right and v goes down on the face.
+ */
+const floral::vec3f								GetCubeMapDirection(const s32 i_face, const f32 i_u, const f32 i_v);
+const floral::vec3f								GetCubeMapTexelDirection(const s32 i_face, const s32 i_x, const s32 i_y, const s32 i_faceSize);
+void											GetCubeMapFaceUV(const floral::vec3f& i_direction, s32* o_face, f32* o_u, f32* o_v);
+
+/*
+ * Cross-face addressing: a texel outside of i_face (x or y in [-faceSize, 2 * faceSize)) is wrapped
+ * onto the neighbor face that covers its direction, the way seamless cubemap filtering sees the cube.
+ * Texels inside of i_face are returned as is.
+ */
+void											ResolveCubeMapTexel(const s32 i_face, const s32 i_x, const s32 i_y, const s32 i_faceSize,
+													s32* o_face, s32* o_x, s32* o_y);
+
+// solid angle of texel (i_x, i_y), the same on every face
+const f32										GetCubeMapTexelSolidAngle(const s32 i_x, const s32 i_y, const s32 i_faceSize);
+
+static const s32								k_MaxSharedTexels = 6;
+
+/*
+ * The texels at the same place on the cube as border texel (i_x, i_y) of i_face, itself included:
+ * 1 inside of the face, 2 on an edge, 3 on a corner and all 6 faces when the faces are 1x1.
+ * Returns the count.
+ */
+const s32										GetCubeMapSharedTexels(const s32 i_face, const s32 i_x, const s32 i_y, const s32 i_faceSize,
+													s32* o_faces, s32* o_xs, s32* o_ys);
+
+/*
+ * A cubemap with a full mip chain per face (see MipBuilder's GetMipOffset), linear f32.
+ */
+struct CubeMapChains
+{
+	const f32*									faces[6];
+	s32											faceSize;
+	s32											mipsCount;
+	s32											numChannels;
+};
+
+// seamless trilinear fetch: bilinear footprints on a face edge read the neighbor face. i_lod is clamped to the chain
+void											SampleCubeMap(const CubeMapChains& i_cubeMap, const floral::vec3f& i_direction, const f32 i_lod,
+													f32* o_color);
+
+/*
+ * Builds the mips of the 6 face chains together, one level at a time over all of the faces. Filter taps
+ * falling outside of a face are fetched from the neighbor face and every tap is weighted by the solid
+ * angle of its texel, so the lower mips have no seams and the texels near the corners don't weight
+ * as much as the ones in the middle of the faces. Mip 0 must already be at the start of each chain.
+ * i_options.alphaCutoff is ignored, negative lobes are clamped to 0.
+ */
+void											BuildCubeMapMipChains(f32* const* io_faces, const s32 i_faceSize, const s32 i_numChannels,
+													const s32 i_mipsCount, const MipChainOptions& i_options);
+
+/*
+ * Edge fixup for targets without seamless cubemap filtering (GLES 2, GL without
+ * GL_TEXTURE_CUBE_MAP_SEAMLESS): the texels shared by 2 faces (an edge) or 3 faces (a corner) are
+ * replaced by their average, so bilinear fetches on both sides of a seam give the same color.
+ * io_levels: the same level of the 6 faces.
+ */
+void											FixupCubeMapEdges(f32* const* io_levels, const s32 i_size, const s32 i_numChannels);
+
+// -------------------------------------------------------------------
+}
@@ -0,0 +1,179 @@
+#include "DXTCompressor.h"
+
+#include <string.h>
+#include <math.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+
+#include <clover/logger.h>
+
+#include "stb_image.h"
+#include "stb_dxt.h"
+
+namespace texbaker
+{
+// -------------------------------------------------------------------
+
+static const u32								k_MaxDXTThreads = 64;
+static const s32								k_BlockRowsPerTask = 4;
+
+static std::once_flag							s_STBDXTInitFlag;
+
+// -------------------------------------------------------------------
+
+struct DXTRowsJob
+{
+	const u8*									input;
+	s32											width;
+	s32											height;
+	s32											numChannels;
+	DXTQuality									quality;
+	s32											rowsCount;
+	p8											output;
+	std::atomic<s32>							nextRow;
+};
+
+static void CompressDXTRowsWorker(DXTRowsJob* io_job)
+{
+	while (true)
+	{
+		const s32 firstRow = io_job->nextRow.fetch_add(k_BlockRowsPerTask);
+		if (firstRow >= io_job->rowsCount)
+		{
+			break;
+		}
+		const s32 lastRow = floral::min(firstRow + k_BlockRowsPerTask, io_job->rowsCount);
+		dxt::CompressDXTBlockRows(io_job->input, io_job->width, io_job->height, io_job->numChannels, io_job->quality,
+				firstRow, lastRow, io_job->output);
+	}
+}
+
+void CompressDXTImage(const u8* i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+		const DXTQuality i_quality, const u32 i_threadsCount, p8 o_output)
+{
+	// stb_dxt builds its lookup tables on the first call, which is not thread safe
+	std::call_once(s_STBDXTInitFlag, []() {
+		u8 block[64];
+		u8 compressedBlock[16];
+		memset(block, 0, sizeof(block));
+		stb_compress_dxt_block(compressedBlock, block, 1, STB_DXT_HIGHQUAL);
+	});
+
+	const s32 rowsCount = (i_height + 3) / 4;
+	const u32 tasksCount = (rowsCount + k_BlockRowsPerTask - 1) / k_BlockRowsPerTask;
+	const u32 threadsCount = floral::min(floral::min(i_threadsCount, tasksCount), k_MaxDXTThreads);
+	if (threadsCount <= 1)
+	{
+		dxt::CompressDXTBlockRows(i_input, i_width, i_height, i_numChannels, i_quality, 0, rowsCount, o_output);
+		return;
+	}
+
+	DXTRowsJob job;
+	job.input = i_input;
+	job.width = i_width;
+	job.height = i_height;
+	job.numChannels = i_numChannels;
+	job.quality = i_quality;
+	job.rowsCount = rowsCount;
+	job.output = o_output;
+	job.nextRow = 0;
+
+	std::thread threads[k_MaxDXTThreads];
+	for (u32 i = 1; i < threadsCount; i++)
+	{
+		threads[i] = std::thread(&CompressDXTRowsWorker, &job);
+	}
+	CompressDXTRowsWorker(&job);
+	for (u32 i = 1; i < threadsCount; i++)
+	{
+		threads[i].join();
+	}
+}
+
+// -------------------------------------------------------------------
+
+static const f64 ComputeRMSE(const u8* i_source, const u8* i_decodedRGBA, const s32 i_pixelsCount, const s32 i_numChannels)
+{
+	f64 sum = 0.0;
+	for (s32 i = 0; i < i_pixelsCount; i++)
+	{
+		for (s32 c = 0; c < i_numChannels; c++)
+		{
+			const f64 d = (f64)i_source[i * i_numChannels + c] - (f64)i_decodedRGBA[i * 4 + c];
+			sum += d * d;
+		}
+	}
+	return sqrt(sum / ((f64)i_pixelsCount * i_numChannels));
+}
+
+void BenchmarkDXT(floral::filesystem<FreelistArena>* i_fs, const_cstr i_inputFilename, const u32 i_threadsCount)
+{
+	typedef std::chrono::high_resolution_clock BenchmarkClock;
+	static const f64 k_MinSecondsPerRun = 0.5;
+	static const const_cstr k_QualityNames[] = { "fast", "normal", "high" };
+
+	floral::relative_path inputPath = floral::build_relative_path(i_inputFilename);
+	floral::file_info inputFile = floral::open_file_read(i_fs, inputPath);
+	if (inputFile.file_size == 0)
+	{
+		floral::close_file(inputFile);
+		CLOVER_ERROR("cannot read '%s'", i_inputFilename);
+		return;
+	}
+	voidptr inputFileData = g_BakingAllocator.allocate(inputFile.file_size);
+	floral::read_all_file(inputFile, inputFileData);
+	floral::close_file(inputFile);
+
+	s32 x, y, n;
+	p8 data = stbi_load_from_memory((p8)inputFileData, inputFile.file_size, &x, &y, &n, 0);
+	g_BakingAllocator.free(inputFileData);
+	if (data == nullptr)
+	{
+		CLOVER_ERROR("cannot decode '%s': %s", i_inputFilename, stbi_failure_reason());
+		return;
+	}
+
+	const s32 pixelsCount = x * y;
+	p8 compressedData = (p8)g_BakingAllocator.allocate(dxt::GetDXTCompressedSize(x, y, n));
+	p8 decodedData = (p8)g_BakingAllocator.allocate(pixelsCount * 4);
+
+	CLOVER_INFO("DXT%d benchmark: %s (%dx%d, %d channels)", n == 4 ? 5 : 1, i_inputFilename, x, y, n);
+	const u32 threadsCounts[] = { 1, floral::max(i_threadsCount, 1u) };
+	for (s32 q = 0; q < 3; q++)
+	{
+		const DXTQuality quality = (DXTQuality)q;
+		for (s32 t = 0; t < 2; t++)
+		{
+			if (t == 1 && threadsCounts[1] == 1)
+			{
+				break;
+			}
+
+			s32 runsCount = 0;
+			const BenchmarkClock::time_point startTime = BenchmarkClock::now();
+			f64 seconds = 0.0;
+			do
+			{
+				CompressDXTImage(data, x, y, n, quality, threadsCounts[t], compressedData);
+				runsCount++;
+				seconds = std::chrono::duration<f64>(BenchmarkClock::now() - startTime).count();
+			}
+			while (seconds < k_MinSecondsPerRun);
+
+			dxt::DecompressDXTImage(compressedData, x, y, n, decodedData);
+			const f64 rmse = ComputeRMSE(data, decodedData, pixelsCount, n);
+			const f64 mpixelsPerSecond = (f64)pixelsCount * runsCount / seconds / 1000000.0;
+			CLOVER_INFO("  %-6s | %2d threads | %9.2f Mpixels/s | rmse %.3f", k_QualityNames[q], threadsCounts[t], mpixelsPerSecond, rmse);
+		}
+	}
+
+	g_BakingAllocator.free(decodedData);
+	g_BakingAllocator.free(compressedData);
+	stbi_image_free(data);
+}
+
+// -------------------------------------------------------------------
+}
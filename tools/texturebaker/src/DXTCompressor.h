@@ -0,0 +1,27 @@
+#pragma once
+
+#include <floral.h>
+#include <floral/io/filesystem.h>
+
+#include "Memory/MemorySystem.h"
+#include "Graphics/DXTBlockCompressor.h"
+
+namespace texbaker
+{
+// -------------------------------------------------------------------
+
+// the block encoder / decoder is the engine's (src/Graphics/DXTBlockCompressor.cpp), High is what we always used
+typedef dxt::DXTQuality							DXTQuality;
+
+// splits the block rows over i_threadsCount threads, the calling thread is one of them
+void											CompressDXTImage(const u8* i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+													const DXTQuality i_quality, const u32 i_threadsCount, p8 o_output);
+
+/*
+ * Compresses an image with every quality level on 1 and i_threadsCount threads and reports
+ * Mpixels/s and rmse against the source.
+ */
+void											BenchmarkDXT(floral::filesystem<FreelistArena>* i_fs, const_cstr i_inputFilename, const u32 i_threadsCount);
+
+// -------------------------------------------------------------------
+}
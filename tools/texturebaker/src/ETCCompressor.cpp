@@ -0,0 +1,90 @@
+#include "ETCCompressor.h"
+
+#include <string.h>
+
+#include "etc2comp/Etc/Etc.h"
+
+namespace texbaker
+{
+// -------------------------------------------------------------------
+
+// source pixels fed to etc2comp at once, 8 MB of f32 rgba
+static const s32								k_MaxStripPixels = 512 * 1024;
+
+static const f32								k_ETCEffortLevels[] = { 10.0f, 40.0f, 90.0f };
+
+// -------------------------------------------------------------------
+
+const f32 GetETCEffortLevel(const ETCEffort i_effort)
+{
+	return k_ETCEffortLevels[(s32)i_effort];
+}
+
+const size GetETCCompressedSize(const s32 i_width, const s32 i_height, const s32 i_numChannels)
+{
+	const size blocksCount = (size)((i_width + 3) / 4) * ((i_height + 3) / 4);
+	return blocksCount * (i_numChannels == 4 ? 16 : 8);
+}
+
+void CompressETCImage(const u8* i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+		const ETCEffort i_effort, const u32 i_jobsCount, p8 o_output)
+{
+	Etc::Image::Format dstFormat;
+	if (i_numChannels == 3)
+	{
+		dstFormat = Etc::Image::Format::RGB8;
+	}
+	else if (i_numChannels == 4)
+	{
+		dstFormat = Etc::Image::Format::RGBA8;
+	}
+	else
+	{
+		FLORAL_ASSERT(false);
+	}
+
+	const f32 effort = GetETCEffortLevel(i_effort);
+	const Etc::ErrorMetric errorMetric = Etc::ErrorMetric::RGBX;
+	const u32 jobsCount = floral::max(i_jobsCount, 1u);
+
+	// whole block rows per strip, the last one may be shorter
+	const s32 extendedWidth = (i_width + 3) & ~3;
+	const s32 stripRows = floral::min(floral::max((k_MaxStripPixels / extendedWidth) & ~3, 4), (i_height + 3) & ~3);
+
+	// etc2comp always expect alpha channel
+	f32* floatImgData = g_BakingAllocator.allocate_array<f32>((size)i_width * stripRows * 4);
+	p8 targetData = o_output;
+	for (s32 y = 0; y < i_height; y += stripRows)
+	{
+		const s32 rowsCount = floral::min(stripRows, i_height - y);
+		const size pixelsCount = (size)i_width * rowsCount;
+		const u8* sourceData = &i_input[(size)y * i_width * i_numChannels];
+		for (size p = 0; p < pixelsCount; p++)
+		{
+			floatImgData[p * 4 + 3] = 1.0f; // fill default alpha = 1.0f
+			for (s32 comp = 0; comp < i_numChannels; comp++)
+			{
+				floatImgData[p * 4 + comp] = (f32)sourceData[p * i_numChannels + comp] / 255.0f;
+			}
+		}
+
+		p8 dstImage = nullptr;
+		u32 encodedBitBytes = 0;
+		u32 encodedWidth = 0;
+		u32 encodedHeight = 0;
+		s32 encodingTime = 0;
+		Etc::Encode(floatImgData, i_width, rowsCount, dstFormat, errorMetric, effort, jobsCount, jobsCount, &dstImage,
+				&encodedBitBytes, &encodedWidth, &encodedHeight, &encodingTime, false);
+		FLORAL_ASSERT(encodedBitBytes == GetETCCompressedSize(i_width, rowsCount, i_numChannels));
+
+		// blocks are stored row by row, so strips are simply appended
+		memcpy(targetData, dstImage, encodedBitBytes);
+		targetData += encodedBitBytes;
+		delete[] dstImage;
+	}
+
+	g_BakingAllocator.free(floatImgData);
+}
+
+// -------------------------------------------------------------------
+}
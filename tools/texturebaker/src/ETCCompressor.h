@@ -0,0 +1,37 @@
+#pragma once
+
+#include <floral.h>
+
+#include "Memory/MemorySystem.h"
+
+namespace texbaker
+{
+// -------------------------------------------------------------------
+
+/*
+ * etc2comp effort presets:
+ * - Fast: 10
+ * - Normal: 40, etc2comp's default
+ * - Best: 90, what we always used
+ */
+enum class ETCEffort
+{
+	Fast = 0,
+	Normal,
+	Best
+};
+
+const f32										GetETCEffortLevel(const ETCEffort i_effort);
+const size										GetETCCompressedSize(const s32 i_width, const s32 i_height, const s32 i_numChannels);
+
+/*
+ * 3 channels input is encoded as RGB8, 4 channels as RGBA8.
+ * etc2comp wants a f32 rgba image and allocates a few hundred bytes of state per block, so the
+ * image is fed to it in strips of block rows: memory stays bounded whatever the input size.
+ * Every strip is encoded by i_jobsCount threads (etc2comp's own jobs).
+ */
+void											CompressETCImage(const u8* i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+													const ETCEffort i_effort, const u32 i_jobsCount, p8 o_output);
+
+// -------------------------------------------------------------------
+}
@@ -9,6 +9,9 @@ namespace texbaker
 	LinearAllocator								g_PersistanceAllocator;
 	LinearArena									g_TemporalArena;
 	FreelistArena								g_FilesystemArena;
+	FreelistArena								g_BakingArena;
+
+	SharedArena									g_BakingAllocator(&g_BakingArena);
 }
 
 namespace clover
@@ -26,7 +29,8 @@ void init_memory_system()
 			memory_region<clover::LinearAllocator>		{ "clover/allocator",			SIZE_MB(16),		&clover::g_LinearAllocator },
 			memory_region<texbaker::LinearAllocator>	{ "texbaker/persist",			SIZE_MB(32),		&texbaker::g_PersistanceAllocator },
 			memory_region<texbaker::LinearArena>		{ "texbaker/arena",				SIZE_MB(16),		&texbaker::g_TemporalArena },
-			memory_region<texbaker::FreelistArena>		{ "texbaker/filesystem",		SIZE_MB(4),			&texbaker::g_FilesystemArena }
+			memory_region<texbaker::FreelistArena>		{ "texbaker/filesystem",		SIZE_MB(4),			&texbaker::g_FilesystemArena },
+			memory_region<texbaker::FreelistArena>		{ "texbaker/baking",			SIZE_MB(768),		&texbaker::g_BakingArena }
 			);
 }
 // -------------------------------------------------------------------
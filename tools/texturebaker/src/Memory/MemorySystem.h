@@ -3,6 +3,8 @@
 #include <floral.h>
 #include <helich.h>
 
+#include <mutex>
+
 namespace texbaker
 {
 // -------------------------------------------------------------------
@@ -14,6 +16,42 @@ typedef helich::allocator<helich::freelist_scheme, helich::no_tracking_policy>	F
 extern LinearAllocator							g_PersistanceAllocator;
 extern LinearArena								g_TemporalArena;
 extern FreelistArena							g_FilesystemArena;
+extern FreelistArena							g_BakingArena;
+
+// -------------------------------------------------------------------
+
+// serializes the access to a freelist arena, the batch workers share g_BakingAllocator
+class SharedArena
+{
+public:
+	SharedArena(FreelistArena* i_arena)
+		: m_Arena(i_arena)
+	{ }
+
+	voidptr										allocate(const size i_bytes)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Arena->allocate(i_bytes);
+	}
+
+	template <class T>
+	T*											allocate_array(const size i_count)
+	{
+		return (T*)allocate(sizeof(T) * i_count);
+	}
+
+	void										free(voidptr i_data)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Arena->free(i_data);
+	}
+
+private:
+	FreelistArena*								m_Arena;
+	std::mutex									m_Mutex;
+};
+
+extern SharedArena								g_BakingAllocator;
 
 // -------------------------------------------------------------------
 }
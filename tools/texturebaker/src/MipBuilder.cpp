@@ -0,0 +1,452 @@
+#include "MipBuilder.h"
+
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_SIMD_SSE
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define MIP_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+namespace texbaker
+{
+// -------------------------------------------------------------------
+
+static const f32								k_Pi = 3.14159265358979f;
+static const f32								k_KaiserAlpha = 4.0f;
+static const f32								k_MaxAlphaScale = 4.0f;
+static const s32								k_AlphaScaleSteps = 16;
+
+// -------------------------------------------------------------------
+
+const MipChainOptions GetDefaultMipChainOptions()
+{
+	MipChainOptions options;
+	options.filter = MipFilter::Kaiser;
+	options.alphaCutoff = 0.0f;
+	return options;
+}
+
+const size GetMipOffset(const s32 i_width, const s32 i_height, const s32 i_numChannels, const s32 i_mip)
+{
+	size offset = 0;
+	s32 w = i_width;
+	s32 h = i_height;
+	for (s32 i = 0; i < i_mip; i++)
+	{
+		offset += (size)w * h * i_numChannels;
+		w = floral::max(w >> 1, 1);
+		h = floral::max(h >> 1, 1);
+	}
+	return offset;
+}
+
+const size GetMipChainSize(const s32 i_width, const s32 i_height, const s32 i_numChannels, const s32 i_mipsCount)
+{
+	return GetMipOffset(i_width, i_height, i_numChannels, i_mipsCount);
+}
+
+// -------------------------------------------------------------------
+
+static inline const f32 Sinc(const f32 i_x)
+{
+	if (fabsf(i_x) < 1e-5f)
+	{
+		return 1.0f;
+	}
+	const f32 x = i_x * k_Pi;
+	return sinf(x) / x;
+}
+
+// modified bessel function of the first kind, order 0
+static const f32 BesselI0(const f32 i_x)
+{
+	const f64 halfX2 = (f64)i_x * i_x * 0.25;
+	f64 sum = 1.0;
+	f64 term = 1.0;
+	for (s32 k = 1; k < 64; k++)
+	{
+		term *= halfX2 / ((f64)k * k);
+		sum += term;
+		if (term < sum * 1e-12)
+		{
+			break;
+		}
+	}
+	return (f32)sum;
+}
+
+static const f32 EvalFilter(const MipFilter i_filter, const f32 i_x)
+{
+	const f32 radius = (f32)k_FilterRadius;
+	if (fabsf(i_x) >= radius)
+	{
+		return 0.0f;
+	}
+
+	if (i_filter == MipFilter::Kaiser)
+	{
+		const f32 t = i_x / radius;
+		return Sinc(i_x) * BesselI0(k_KaiserAlpha * sqrtf(1.0f - t * t)) / BesselI0(k_KaiserAlpha);
+	}
+
+	return Sinc(i_x) * Sinc(i_x / radius);
+}
+
+void BuildFilterKernel(const MipFilter i_filter, FilterKernel* o_kernel)
+{
+	if (i_filter == MipFilter::Box)
+	{
+		o_kernel->tapsCount = 2;
+		o_kernel->firstTap = 0;
+		o_kernel->weights[0] = 0.5f;
+		o_kernel->weights[1] = 0.5f;
+		return;
+	}
+
+	// destination pixel j is centered between source pixels 2j and 2j + 1
+	o_kernel->tapsCount = k_MaxFilterTaps;
+	o_kernel->firstTap = 1 - 2 * k_FilterRadius;
+	f32 sum = 0.0f;
+	for (s32 k = 0; k < o_kernel->tapsCount; k++)
+	{
+		const f32 x = ((f32)(o_kernel->firstTap + k) - 0.5f) * 0.5f;
+		o_kernel->weights[k] = EvalFilter(i_filter, x);
+		sum += o_kernel->weights[k];
+	}
+	for (s32 k = 0; k < o_kernel->tapsCount; k++)
+	{
+		o_kernel->weights[k] /= sum;
+	}
+}
+
+// -------------------------------------------------------------------
+
+// o_dst[i] = sum(i_weights[k] * i_rows[k][i])
+static void FilterRows(const f32* const* i_rows, const f32* i_weights, const s32 i_tapsCount, const s32 i_count, f32* o_dst)
+{
+	s32 i = 0;
+#if defined(MIP_SIMD_SSE)
+	for (; i + 4 <= i_count; i += 4)
+	{
+		__m128 acc = _mm_setzero_ps();
+		for (s32 k = 0; k < i_tapsCount; k++)
+		{
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(i_weights[k]), _mm_loadu_ps(&i_rows[k][i])));
+		}
+		_mm_storeu_ps(&o_dst[i], acc);
+	}
+#elif defined(MIP_SIMD_NEON)
+	for (; i + 4 <= i_count; i += 4)
+	{
+		float32x4_t acc = vdupq_n_f32(0.0f);
+		for (s32 k = 0; k < i_tapsCount; k++)
+		{
+			acc = vmlaq_n_f32(acc, vld1q_f32(&i_rows[k][i]), i_weights[k]);
+		}
+		vst1q_f32(&o_dst[i], acc);
+	}
+#endif
+	for (; i < i_count; i++)
+	{
+		f32 acc = 0.0f;
+		for (s32 k = 0; k < i_tapsCount; k++)
+		{
+			acc += i_weights[k] * i_rows[k][i];
+		}
+		o_dst[i] = acc;
+	}
+}
+
+static void FilterColumns(const f32* i_src, const s32 i_width, const s32 i_numChannels, const FilterKernel& i_kernel,
+		const s32 i_dstWidth, f32* o_dst)
+{
+	for (s32 x = 0; x < i_dstWidth; x++)
+	{
+		const s32 firstX = 2 * x + i_kernel.firstTap;
+#if defined(MIP_SIMD_SSE) || defined(MIP_SIMD_NEON)
+		if (i_numChannels == 4)
+		{
+#if defined(MIP_SIMD_SSE)
+			__m128 acc = _mm_setzero_ps();
+			for (s32 k = 0; k < i_kernel.tapsCount; k++)
+			{
+				const s32 sx = floral::clamp(firstX + k, 0, i_width - 1);
+				acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(i_kernel.weights[k]), _mm_loadu_ps(&i_src[sx * 4])));
+			}
+			_mm_storeu_ps(&o_dst[x * 4], acc);
+#else
+			float32x4_t acc = vdupq_n_f32(0.0f);
+			for (s32 k = 0; k < i_kernel.tapsCount; k++)
+			{
+				const s32 sx = floral::clamp(firstX + k, 0, i_width - 1);
+				acc = vmlaq_n_f32(acc, vld1q_f32(&i_src[sx * 4]), i_kernel.weights[k]);
+			}
+			vst1q_f32(&o_dst[x * 4], acc);
+#endif
+			continue;
+		}
+#endif
+		for (s32 c = 0; c < i_numChannels; c++)
+		{
+			f32 acc = 0.0f;
+			for (s32 k = 0; k < i_kernel.tapsCount; k++)
+			{
+				const s32 sx = floral::clamp(firstX + k, 0, i_width - 1);
+				acc += i_kernel.weights[k] * i_src[sx * i_numChannels + c];
+			}
+			o_dst[x * i_numChannels + c] = acc;
+		}
+	}
+}
+
+void DownsampleLevel(const f32* i_src, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+		const MipFilter i_filter, f32* io_scratch, f32* o_dst)
+{
+	FilterKernel kernel;
+	BuildFilterKernel(i_filter, &kernel);
+
+	const s32 dstWidth = floral::max(i_width >> 1, 1);
+	const s32 dstHeight = floral::max(i_height >> 1, 1);
+	const s32 rowSize = i_width * i_numChannels;
+
+	// vertical pass first: the rows are contiguous so every tap is a vector load
+	if (i_height == 1)
+	{
+		memcpy(io_scratch, i_src, rowSize * sizeof(f32));
+	}
+	else
+	{
+		const f32* rows[k_MaxFilterTaps];
+		for (s32 y = 0; y < dstHeight; y++)
+		{
+			for (s32 k = 0; k < kernel.tapsCount; k++)
+			{
+				const s32 sy = floral::clamp(2 * y + kernel.firstTap + k, 0, i_height - 1);
+				rows[k] = &i_src[sy * rowSize];
+			}
+			FilterRows(rows, kernel.weights, kernel.tapsCount, rowSize, &io_scratch[y * rowSize]);
+		}
+	}
+
+	if (i_width == 1)
+	{
+		memcpy(o_dst, io_scratch, dstHeight * rowSize * sizeof(f32));
+		return;
+	}
+
+	for (s32 y = 0; y < dstHeight; y++)
+	{
+		FilterColumns(&io_scratch[y * rowSize], i_width, i_numChannels, kernel, dstWidth, &o_dst[y * dstWidth * i_numChannels]);
+	}
+}
+
+// -------------------------------------------------------------------
+
+void ClampLevel(f32* io_data, const size i_count, const f32 i_min, const f32 i_max)
+{
+	for (size i = 0; i < i_count; i++)
+	{
+		io_data[i] = floral::clamp(io_data[i], i_min, i_max);
+	}
+}
+
+static const f32 ComputeAlphaCoverage(const f32* i_data, const size i_pixelsCount, const s32 i_numChannels,
+		const f32 i_alphaCutoff, const f32 i_alphaScale)
+{
+	size coveredCount = 0;
+	for (size i = 0; i < i_pixelsCount; i++)
+	{
+		if (i_data[i * i_numChannels + 3] * i_alphaScale > i_alphaCutoff)
+		{
+			coveredCount++;
+		}
+	}
+	return (f32)coveredCount / (f32)i_pixelsCount;
+}
+
+// the coverage only grows with the scale, so a bisection is enough
+static const f32 FindAlphaScale(const f32* i_data, const size i_pixelsCount, const s32 i_numChannels,
+		const f32 i_alphaCutoff, const f32 i_targetCoverage)
+{
+	f32 minScale = 0.0f;
+	f32 maxScale = k_MaxAlphaScale;
+	f32 bestScale = 1.0f;
+	f32 bestError = fabsf(ComputeAlphaCoverage(i_data, i_pixelsCount, i_numChannels, i_alphaCutoff, 1.0f) - i_targetCoverage);
+	for (s32 i = 0; i < k_AlphaScaleSteps; i++)
+	{
+		const f32 scale = (minScale + maxScale) * 0.5f;
+		const f32 coverage = ComputeAlphaCoverage(i_data, i_pixelsCount, i_numChannels, i_alphaCutoff, scale);
+		const f32 error = fabsf(coverage - i_targetCoverage);
+		if (error < bestError)
+		{
+			bestError = error;
+			bestScale = scale;
+		}
+
+		if (coverage < i_targetCoverage)
+		{
+			minScale = scale;
+		}
+		else if (coverage > i_targetCoverage)
+		{
+			maxScale = scale;
+		}
+		else
+		{
+			break;
+		}
+	}
+	return bestScale;
+}
+
+static void EncodeLevel(const f32* i_data, const size i_pixelsCount, const s32 i_numChannels, const f32 i_outputGamma,
+		const f32 i_alphaScale, p8 o_data)
+{
+	const s32 colorChannels = (i_numChannels == 4) ? 3 : i_numChannels;
+	for (size i = 0; i < i_pixelsCount; i++)
+	{
+		const f32* pixel = &i_data[i * i_numChannels];
+		p8 outPixel = &o_data[i * i_numChannels];
+		for (s32 c = 0; c < colorChannels; c++)
+		{
+			f32 value = floral::clamp(pixel[c], 0.0f, 1.0f);
+			if (i_outputGamma != 1.0f)
+			{
+				value = powf(value, i_outputGamma);
+			}
+			outPixel[c] = (u8)(value * 255.0f + 0.5f);
+		}
+		if (i_numChannels == 4)
+		{
+			outPixel[3] = (u8)(floral::clamp(pixel[3] * i_alphaScale, 0.0f, 1.0f) * 255.0f + 0.5f);
+		}
+	}
+}
+
+// -------------------------------------------------------------------
+
+void BuildMipChainF32(f32* io_chain, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+		const s32 i_mipsCount, const MipChainOptions& i_options)
+{
+	if (i_mipsCount <= 1)
+	{
+		return;
+	}
+
+	f32* scratch = g_BakingAllocator.allocate_array<f32>((size)i_width * floral::max(i_height >> 1, 1) * i_numChannels);
+	s32 w = i_width;
+	s32 h = i_height;
+	for (s32 mip = 1; mip < i_mipsCount; mip++)
+	{
+		const f32* src = &io_chain[GetMipOffset(i_width, i_height, i_numChannels, mip - 1)];
+		f32* dst = &io_chain[GetMipOffset(i_width, i_height, i_numChannels, mip)];
+		DownsampleLevel(src, w, h, i_numChannels, i_options.filter, scratch, dst);
+		w = floral::max(w >> 1, 1);
+		h = floral::max(h >> 1, 1);
+		ClampLevel(dst, (size)w * h * i_numChannels, 0.0f, FLT_MAX);
+	}
+	g_BakingAllocator.free(scratch);
+
+	if (i_numChannels == 4 && i_options.alphaCutoff > 0.0f)
+	{
+		// every mip is filtered from the unscaled previous one, scale them afterwards
+		const f32 targetCoverage = ComputeAlphaCoverage(io_chain, (size)i_width * i_height, 4, i_options.alphaCutoff, 1.0f);
+		w = i_width;
+		h = i_height;
+		for (s32 mip = 1; mip < i_mipsCount; mip++)
+		{
+			w = floral::max(w >> 1, 1);
+			h = floral::max(h >> 1, 1);
+			f32* data = &io_chain[GetMipOffset(i_width, i_height, 4, mip)];
+			const size pixelsCount = (size)w * h;
+			const f32 alphaScale = FindAlphaScale(data, pixelsCount, 4, i_options.alphaCutoff, targetCoverage);
+			for (size i = 0; i < pixelsCount; i++)
+			{
+				data[i * 4 + 3] *= alphaScale;
+			}
+		}
+	}
+}
+
+void BuildMipChainLDR(const u8* i_source, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+		const f32 i_inputGamma, const f32 i_outputGamma, const s32 i_mipsCount, const MipChainOptions& i_options, p8 o_chain)
+{
+	const bool hasAlpha = (i_numChannels == 4);
+	const s32 colorChannels = hasAlpha ? 3 : i_numChannels;
+	const size topPixelsCount = (size)i_width * i_height;
+
+	f32 toLinear[256];
+	for (s32 i = 0; i < 256; i++)
+	{
+		toLinear[i] = powf((f32)i / 255.0f, 1.0f / i_inputGamma);
+	}
+
+	// 2 levels are alive at a time, the next one is always smaller than the current one
+	const s32 halfHeight = floral::max(i_height >> 1, 1);
+	f32* currLevel = g_BakingAllocator.allocate_array<f32>(topPixelsCount * i_numChannels);
+	f32* nextLevel = g_BakingAllocator.allocate_array<f32>((size)floral::max(i_width >> 1, 1) * halfHeight * i_numChannels);
+	f32* scratch = g_BakingAllocator.allocate_array<f32>((size)i_width * halfHeight * i_numChannels);
+
+	for (size i = 0; i < topPixelsCount; i++)
+	{
+		for (s32 c = 0; c < colorChannels; c++)
+		{
+			currLevel[i * i_numChannels + c] = toLinear[i_source[i * i_numChannels + c]];
+		}
+		if (hasAlpha)
+		{
+			currLevel[i * 4 + 3] = (f32)i_source[i * 4 + 3] / 255.0f;
+		}
+	}
+
+	if (i_inputGamma == i_outputGamma)
+	{
+		memcpy(o_chain, i_source, topPixelsCount * i_numChannels);
+	}
+	else
+	{
+		EncodeLevel(currLevel, topPixelsCount, i_numChannels, i_outputGamma, 1.0f, o_chain);
+	}
+
+	const bool keepCoverage = hasAlpha && i_options.alphaCutoff > 0.0f;
+	f32 targetCoverage = 0.0f;
+	if (keepCoverage)
+	{
+		targetCoverage = ComputeAlphaCoverage(currLevel, topPixelsCount, 4, i_options.alphaCutoff, 1.0f);
+	}
+
+	s32 w = i_width;
+	s32 h = i_height;
+	for (s32 mip = 1; mip < i_mipsCount; mip++)
+	{
+		DownsampleLevel(currLevel, w, h, i_numChannels, i_options.filter, scratch, nextLevel);
+		w = floral::max(w >> 1, 1);
+		h = floral::max(h >> 1, 1);
+		const size pixelsCount = (size)w * h;
+		ClampLevel(nextLevel, pixelsCount * i_numChannels, 0.0f, 1.0f);
+
+		f32 alphaScale = 1.0f;
+		if (keepCoverage)
+		{
+			alphaScale = FindAlphaScale(nextLevel, pixelsCount, 4, i_options.alphaCutoff, targetCoverage);
+		}
+		EncodeLevel(nextLevel, pixelsCount, i_numChannels, i_outputGamma, alphaScale,
+				&o_chain[GetMipOffset(i_width, i_height, i_numChannels, mip)]);
+
+		f32* tmp = currLevel;
+		currLevel = nextLevel;
+		nextLevel = tmp;
+	}
+
+	g_BakingAllocator.free(scratch);
+	g_BakingAllocator.free(nextLevel);
+	g_BakingAllocator.free(currLevel);
+}
+
+// -------------------------------------------------------------------
+}
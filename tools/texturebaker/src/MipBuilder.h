@@ -0,0 +1,76 @@
+#pragma once
+
+#include <floral.h>
+
+#include "Memory/MemorySystem.h"
+
+namespace texbaker
+{
+// -------------------------------------------------------------------
+
+/*
+ * 2:1 downsampling filters, in destination pixels:
+ * - Box: 2x2 average
+ * - Kaiser: windowed sinc, width 3, alpha 4 (nvtt's defaults)
+ * - Lanczos: lanczos 3
+ */
+enum class MipFilter
+{
+	Box = 0,
+	Kaiser,
+	Lanczos
+};
+
+static const s32								k_FilterRadius = 3;			// kaiser and lanczos, in destination pixels
+static const s32								k_MaxFilterTaps = 4 * k_FilterRadius;
+
+// dst[j] = sum(weights[k] * src[2 * j + firstTap + k]), weights sum to 1
+struct FilterKernel
+{
+	s32											tapsCount;
+	s32											firstTap;
+	f32											weights[k_MaxFilterTaps];
+};
+
+void											BuildFilterKernel(const MipFilter i_filter, FilterKernel* o_kernel);
+
+struct MipChainOptions
+{
+	MipFilter									filter;
+	f32											alphaCutoff;		// > 0: keep the alpha test coverage of the top mip in every mip
+};
+
+const MipChainOptions							GetDefaultMipChainOptions();
+
+// offset (in channels) of i_mip in a chain where every mip is stored after the previous one
+const size										GetMipOffset(const s32 i_width, const s32 i_height, const s32 i_numChannels, const s32 i_mip);
+const size										GetMipChainSize(const s32 i_width, const s32 i_height, const s32 i_numChannels, const s32 i_mipsCount);
+
+/*
+ * o_dst is max(i_width / 2, 1) x max(i_height / 2, 1), edges are clamped.
+ * io_scratch: max(i_width, 1) * max(i_height / 2, 1) * i_numChannels floats
+ */
+void											DownsampleLevel(const f32* i_src, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+													const MipFilter i_filter, f32* io_scratch, f32* o_dst);
+
+void											ClampLevel(f32* io_data, const size i_count, const f32 i_min, const f32 i_max);
+
+/*
+ * Builds the mips of a linear f32 chain in place, each mip from the previous one. Mip 0 must already
+ * be at the start of io_chain. Negative lobes of the filters are clamped to 0.
+ */
+void											BuildMipChainF32(f32* io_chain, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+													const s32 i_mipsCount, const MipChainOptions& i_options);
+
+/*
+ * Builds a full 8 bits chain from an 8 bits image encoded with i_inputGamma:
+ * - color channels are filtered in linear space, level to level in f32
+ * - every mip is written to o_chain encoded with i_outputGamma (1.0f: linear)
+ * - the 4th channel is alpha and is never gamma encoded
+ */
+void											BuildMipChainLDR(const u8* i_source, const s32 i_width, const s32 i_height, const s32 i_numChannels,
+													const f32 i_inputGamma, const f32 i_outputGamma, const s32 i_mipsCount,
+													const MipChainOptions& i_options, p8 o_chain);
+
+// -------------------------------------------------------------------
+}
@@ -0,0 +1,223 @@
+#include "PMREMBaker.h"
+
+#include <string.h>
+#include <math.h>
+
+#include <atomic>
+#include <thread>
+
+#include "Memory/MemorySystem.h"
+#include "MipBuilder.h"
+
+namespace texbaker
+{
+// -------------------------------------------------------------------
+
+static const f32								k_Pi = 3.14159265358979f;
+static const u32								k_MaxPrefilterThreads = 64;
+// one lod up blurs the fetches a bit more, hides the sampling pattern (Colbert & Krivanek)
+static const f32								k_LodBias = 1.0f;
+
+// GGX sample around the normal (0, 0, 1), the view direction is the normal
+struct PMREMSample
+{
+	floral::vec3f								direction;
+	f32											weight;				// NdotL
+	f32											lod;
+};
+
+struct PrefilterJob
+{
+	const CubeMapChains*						radiance;
+	const PMREMSample*							samples;
+	u32											samplesCount;
+	s32											face;
+	s32											mipSize;
+	f32*										output;
+	std::atomic<s32>							nextRow;
+};
+
+// -------------------------------------------------------------------
+
+const f32 GetPMREMRoughness(const s32 i_mip)
+{
+	return floral::min((f32)i_mip / (f32)k_PMREMRoughnessMips, 1.0f);
+}
+
+static inline const f32 RadicalInverse(u32 i_bits)
+{
+	i_bits = (i_bits << 16u) | (i_bits >> 16u);
+	i_bits = ((i_bits & 0x55555555u) << 1u) | ((i_bits & 0xAAAAAAAAu) >> 1u);
+	i_bits = ((i_bits & 0x33333333u) << 2u) | ((i_bits & 0xCCCCCCCCu) >> 2u);
+	i_bits = ((i_bits & 0x0F0F0F0Fu) << 4u) | ((i_bits & 0xF0F0F0F0u) >> 4u);
+	i_bits = ((i_bits & 0x00FF00FFu) << 8u) | ((i_bits & 0xFF00FF00u) >> 8u);
+	return (f32)i_bits * 2.3283064365386963e-10f;
+}
+
+// same importance sampling as tests/tech/sh_calculator/pmrem_bake.fs
+static const u32 BuildSamples(const f32 i_roughness, const u32 i_samplesCount, const s32 i_faceSize, PMREMSample* o_samples)
+{
+	const f32 a = i_roughness * i_roughness;
+	const f32 a2 = a * a;
+	const f32 texelSolidAngle = 4.0f * k_Pi / (6.0f * (f32)i_faceSize * (f32)i_faceSize);
+
+	u32 samplesCount = 0;
+	for (u32 i = 0; i < i_samplesCount; i++)
+	{
+		const f32 xi0 = (f32)i / (f32)i_samplesCount;
+		const f32 xi1 = RadicalInverse(i);
+		const f32 phi = 2.0f * k_Pi * xi0;
+		const f32 cosTheta = sqrtf((1.0f - xi1) / (1.0f + (a2 - 1.0f) * xi1));
+		const f32 sinTheta = sqrtf(floral::max(1.0f - cosTheta * cosTheta, 0.0f));
+
+		// N = V = (0, 0, 1): L = 2 * dot(V, H) * H - V
+		const floral::vec3f h(cosf(phi) * sinTheta, sinf(phi) * sinTheta, cosTheta);
+		const floral::vec3f l(2.0f * cosTheta * h.x, 2.0f * cosTheta * h.y, 2.0f * cosTheta * cosTheta - 1.0f);
+		if (l.z <= 0.0f)
+		{
+			continue;
+		}
+
+		// pdf = D * NdotH / (4 * VdotH) = D / 4 with V = N
+		const f32 d = cosTheta * cosTheta * (a2 - 1.0f) + 1.0f;
+		const f32 ggx = a2 / (k_Pi * d * d);
+		const f32 pdf = ggx * 0.25f + 0.0001f;
+		const f32 sampleSolidAngle = 1.0f / ((f32)i_samplesCount * pdf + 0.0001f);
+
+		PMREMSample& sample = o_samples[samplesCount];
+		sample.direction = l;
+		sample.weight = l.z;
+		sample.lod = floral::max(0.5f * log2f(sampleSolidAngle / texelSolidAngle) + k_LodBias, 0.0f);
+		samplesCount++;
+	}
+
+	return samplesCount;
+}
+
+static void PrefilterTexel(const PrefilterJob& i_job, const s32 i_face, const s32 i_x, const s32 i_y, f32* o_color)
+{
+	const CubeMapChains& radiance = *i_job.radiance;
+	const s32 n = radiance.numChannels;
+	const floral::vec3f normal = GetCubeMapTexelDirection(i_face, i_x, i_y, i_job.mipSize);
+	const floral::vec3f up = fabsf(normal.z) < 0.999f ? floral::vec3f(0.0f, 0.0f, 1.0f) : floral::vec3f(1.0f, 0.0f, 0.0f);
+	const floral::vec3f tangent = floral::normalize(floral::cross(up, normal));
+	const floral::vec3f bitangent = floral::cross(normal, tangent);
+
+	f32 sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	f32 totalWeight = 0.0f;
+	for (u32 i = 0; i < i_job.samplesCount; i++)
+	{
+		const PMREMSample& sample = i_job.samples[i];
+		const floral::vec3f l = tangent * sample.direction.x + bitangent * sample.direction.y + normal * sample.direction.z;
+		f32 color[4];
+		SampleCubeMap(radiance, l, sample.lod, color);
+		for (s32 c = 0; c < n; c++)
+		{
+			sum[c] += color[c] * sample.weight;
+		}
+		totalWeight += sample.weight;
+	}
+
+	for (s32 c = 0; c < n; c++)
+	{
+		o_color[c] = sum[c] / totalWeight;
+	}
+}
+
+static void PrefilterRows(PrefilterJob* io_job)
+{
+	const s32 n = io_job->radiance->numChannels;
+	const s32 mipSize = io_job->mipSize;
+	while (true)
+	{
+		const s32 y = io_job->nextRow.fetch_add(1);
+		if (y >= mipSize)
+		{
+			break;
+		}
+
+		for (s32 x = 0; x < mipSize; x++)
+		{
+			PrefilterTexel(*io_job, io_job->face, x, y, &io_job->output[(y * mipSize + x) * n]);
+		}
+	}
+}
+
+/*
+ * Same result as FixupCubeMapEdges without needing the other faces: the texels shared with the
+ * neighbor faces are prefiltered here too, so every face averages the same values.
+ */
+static void FixupPrefilteredEdges(const PrefilterJob& i_job)
+{
+	const s32 n = i_job.radiance->numChannels;
+	const s32 mipSize = i_job.mipSize;
+	for (s32 y = 0; y < mipSize; y++)
+	{
+		const bool borderRow = (y == 0 || y == mipSize - 1);
+		for (s32 x = 0; x < mipSize; x += (borderRow ? 1 : mipSize - 1))
+		{
+			s32 faces[k_MaxSharedTexels], xs[k_MaxSharedTexels], ys[k_MaxSharedTexels];
+			const s32 count = GetCubeMapSharedTexels(i_job.face, x, y, mipSize, faces, xs, ys);
+			f32* texel = &i_job.output[(y * mipSize + x) * n];
+			for (s32 i = 1; i < count; i++)
+			{
+				f32 color[4];
+				PrefilterTexel(i_job, faces[i], xs[i], ys[i], color);
+				for (s32 c = 0; c < n; c++)
+				{
+					texel[c] += color[c];
+				}
+			}
+			for (s32 c = 0; c < n; c++)
+			{
+				texel[c] /= (f32)count;
+			}
+		}
+	}
+}
+
+void PrefilterPMREMFace(const CubeMapChains& i_radiance, const s32 i_face, const s32 i_mip,
+		const u32 i_samplesCount, const u32 i_threadsCount, const bool i_fixupEdges, f32* o_data)
+{
+	const s32 n = i_radiance.numChannels;
+	const s32 mipSize = floral::max(i_radiance.faceSize >> i_mip, 1);
+	const f32 roughness = GetPMREMRoughness(i_mip);
+	if (i_mip == 0 || roughness == 0.0f)
+	{
+		memcpy(o_data, &i_radiance.faces[i_face][GetMipOffset(i_radiance.faceSize, i_radiance.faceSize, n, i_mip)],
+				mipSize * mipSize * n * sizeof(f32));
+		return;
+	}
+
+	PMREMSample* samples = g_BakingAllocator.allocate_array<PMREMSample>(i_samplesCount);
+	PrefilterJob job;
+	job.radiance = &i_radiance;
+	job.samples = samples;
+	job.samplesCount = BuildSamples(roughness, i_samplesCount, i_radiance.faceSize, samples);
+	job.face = i_face;
+	job.mipSize = mipSize;
+	job.output = o_data;
+	job.nextRow = 0;
+
+	const u32 threadsCount = floral::min(floral::min(i_threadsCount, (u32)mipSize), k_MaxPrefilterThreads);
+	std::thread threads[k_MaxPrefilterThreads];
+	for (u32 i = 1; i < threadsCount; i++)
+	{
+		threads[i] = std::thread(&PrefilterRows, &job);
+	}
+	PrefilterRows(&job);
+	for (u32 i = 1; i < threadsCount; i++)
+	{
+		threads[i].join();
+	}
+
+	if (i_fixupEdges)
+	{
+		FixupPrefilteredEdges(job);
+	}
+
+	g_BakingAllocator.free(samples);
+}
+
+// -------------------------------------------------------------------
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <floral.h>
+
+#include "CubeMap.h"
+
+namespace texbaker
+{
+// -------------------------------------------------------------------
+
+// shaders fetch the PMREM with textureLod(u_PMREM, r, roughness * 8.0)
+static const s32								k_PMREMRoughnessMips = 8;
+
+// min(i_mip / k_PMREMRoughnessMips, 1)
+const f32										GetPMREMRoughness(const s32 i_mip);
+
+/*
+ * GGX prefiltering of one face of one PMREM mip with filtered importance sampling: every GGX sample
+ * fetches the radiance at the lod matching its solid angle, so a few hundred samples per texel
+ * are enough. i_radiance must have its full mip chain. Mip 0 (roughness 0) is the radiance itself.
+ * The rows of the face are split over i_threadsCount threads, the calling thread is one of them.
+ * i_fixupEdges: average the texels shared with the neighbor faces (see FixupCubeMapEdges), mip 0 is
+ * left to the caller.
+ * o_data: (faceSize >> i_mip)^2 texels
+ */
+void											PrefilterPMREMFace(const CubeMapChains& i_radiance, const s32 i_face, const s32 i_mip,
+													const u32 i_samplesCount, const u32 i_threadsCount, const bool i_fixupEdges,
+													f32* o_data);
+
+// -------------------------------------------------------------------
+}
@@ -0,0 +1,535 @@
+#include "Supercompression.h"
+
+#include <string.h>
+
+#include <chrono>
+
+#include <clover/logger.h>
+
+#include "BlockCompression.h"
+
+namespace texbaker
+{
+// -------------------------------------------------------------------
+
+static const u32								k_ProbabilityBits = 12;
+static const u32								k_ProbabilityScale = 1u << k_ProbabilityBits;
+static const u32								k_RansLowerBound = 1u << 23;
+static const s32								k_RansStatesCount = 4;			// interleaved, symbol j of a plane uses state j % 4
+static const u32								k_ChunkSize = 64 * 1024;		// rounded down to a multiple of the stride
+static const size								k_TableMaxSize = 32 + 256 * sizeof(u16);
+
+struct PlaneModel
+{
+	u32											frequencies[256];
+	u32											starts[256];
+};
+
+struct PlaneDecoder
+{
+	u8											symbols[k_ProbabilityScale];
+	u16											frequencies[256];
+	u16											starts[256];
+};
+
+struct DecompressJob
+{
+	const SupercompressionHeader*				header;
+	const u8*									tables[k_MaxSupercompressionStride];
+	const u8*									chunks;
+	const u32*									chunkSizes;
+	size*										chunkOffsets;
+	p8											output;
+	size										outputSize;
+};
+
+// -------------------------------------------------------------------
+
+const u32 GetSupercompressionStride(const cbtex::TextureHeader& i_header)
+{
+	switch (i_header.compression)
+	{
+	case cbtex::Compression::DXT:
+	case cbtex::Compression::ETC:
+		// hdr is always rgbm, so dxt5
+		if (i_header.colorRange == cbtex::ColorRange::HDR || i_header.colorChannel == cbtex::ColorChannel::RGBA)
+		{
+			return 16;
+		}
+		return 8;
+	case cbtex::Compression::BC6H:
+	case cbtex::Compression::BC7:
+	case cbtex::Compression::ASTC:
+		return 16;
+	default:
+		break;
+	}
+
+	u32 channelsCount = 4;
+	switch (i_header.colorChannel)
+	{
+	case cbtex::ColorChannel::R:
+		channelsCount = 1;
+		break;
+	case cbtex::ColorChannel::RG:
+		channelsCount = 2;
+		break;
+	case cbtex::ColorChannel::RGB:
+		channelsCount = 3;
+		break;
+	default:
+		break;
+	}
+	return i_header.colorRange == cbtex::ColorRange::HDR ? channelsCount * sizeof(u16) : channelsCount;	// half floats
+}
+
+const size GetSupercompressionBound(const size i_size)
+{
+	const size chunksCount = (i_size + k_ChunkSize - 1) / k_ChunkSize + 1;
+	return sizeof(SupercompressionHeader) + k_MaxSupercompressionStride * k_TableMaxSize
+		+ chunksCount * (k_RansStatesCount + 1) * sizeof(u32) + i_size * 3 / 2;
+}
+
+// -------------------------------------------------------------------
+
+// scales the counts to k_ProbabilityScale, every used symbol keeps at least 1
+static void NormalizeFrequencies(const u32* i_counts, const u32 i_total, u32* o_frequencies)
+{
+	memset(o_frequencies, 0, 256 * sizeof(u32));
+	if (i_total == 0)
+	{
+		return;
+	}
+
+	s32 sum = 0;
+	for (s32 s = 0; s < 256; s++)
+	{
+		if (i_counts[s] > 0)
+		{
+			o_frequencies[s] = floral::max((u32)((u64)i_counts[s] * k_ProbabilityScale / i_total), 1u);
+			sum += o_frequencies[s];
+		}
+	}
+
+	// the rounding error goes to the most frequent symbols
+	while (sum != (s32)k_ProbabilityScale)
+	{
+		s32 largest = 0;
+		for (s32 s = 1; s < 256; s++)
+		{
+			if (o_frequencies[s] > o_frequencies[largest])
+			{
+				largest = s;
+			}
+		}
+		if (sum < (s32)k_ProbabilityScale)
+		{
+			o_frequencies[largest] += k_ProbabilityScale - sum;
+			sum = k_ProbabilityScale;
+		}
+		else
+		{
+			const s32 delta = floral::min(sum - (s32)k_ProbabilityScale, (s32)o_frequencies[largest] - 1);
+			o_frequencies[largest] -= delta;
+			sum -= delta;
+		}
+	}
+}
+
+static void FilterSurface(const p8 i_input, const size i_size, const u32 i_stride, const u32 i_chunkSize, p8 o_output)
+{
+	for (size chunkStart = 0; chunkStart < i_size; chunkStart += i_chunkSize)
+	{
+		const size chunkEnd = floral::min(chunkStart + i_chunkSize, i_size);
+		memcpy(&o_output[chunkStart], &i_input[chunkStart], floral::min((size)i_stride, chunkEnd - chunkStart));
+		for (size i = chunkStart + i_stride; i < chunkEnd; i++)
+		{
+			o_output[i] = (u8)(i_input[i] - i_input[i - i_stride]);
+		}
+	}
+}
+
+static inline void EncodeSymbol(u32* io_state, p8* io_output, const u32 i_start, const u32 i_frequency)
+{
+	u32 state = *io_state;
+	const u32 maxState = ((k_RansLowerBound >> k_ProbabilityBits) << 8) * i_frequency;
+	while (state >= maxState)
+	{
+		*(--(*io_output)) = (u8)(state & 0xff);
+		state >>= 8;
+	}
+	*io_state = ((state / i_frequency) << k_ProbabilityBits) + (state % i_frequency) + i_start;
+}
+
+static inline void FlushState(const u32 i_state, p8* io_output)
+{
+	*io_output -= 4;
+	memcpy(*io_output, &i_state, 4);
+}
+
+// planes of the chunk from the last symbol to the first, the output grows backwards from io_end
+static const size EncodeChunk(const p8 i_chunk, const size i_chunkSize, const u32 i_stride, const PlaneModel* i_models, p8 io_end)
+{
+	p8 output = io_end;
+	u32 states[k_RansStatesCount] = { k_RansLowerBound, k_RansLowerBound, k_RansLowerBound, k_RansLowerBound };
+	const size elementsCount = i_chunkSize / i_stride;
+	for (s32 plane = (s32)i_stride - 1; plane >= 0; plane--)
+	{
+		const PlaneModel& model = i_models[plane];
+		for (s32 j = (s32)elementsCount - 1; j >= 0; j--)
+		{
+			const u8 symbol = i_chunk[j * i_stride + plane];
+			EncodeSymbol(&states[j & (k_RansStatesCount - 1)], &output, model.starts[symbol], model.frequencies[symbol]);
+		}
+	}
+	for (s32 i = k_RansStatesCount - 1; i >= 0; i--)
+	{
+		FlushState(states[i], &output);
+	}
+	return (size)(io_end - output);
+}
+
+static const size EncodeSurface(const p8 i_input, const size i_size, const u32 i_stride, const SupercompressionFilter i_filter,
+		const u32 i_chunkSize, p8 o_output)
+{
+	SupercompressionHeader* header = (SupercompressionHeader*)o_output;
+	header->stride = (u8)i_stride;
+	header->filter = (u8)i_filter;
+	header->reserved = 0;
+	header->chunkSize = i_chunkSize;
+	header->chunksCount = (u32)((i_size + i_chunkSize - 1) / i_chunkSize);
+
+	// one model per plane for the whole surface
+	PlaneModel models[k_MaxSupercompressionStride];
+	p8 tables = o_output + sizeof(SupercompressionHeader);
+	p8 output = tables;
+	for (u32 plane = 0; plane < i_stride; plane++)
+	{
+		u32 counts[256];
+		memset(counts, 0, sizeof(counts));
+		u32 total = 0;
+		for (size i = plane; i < i_size; i += i_stride)
+		{
+			counts[i_input[i]]++;
+			total++;
+		}
+
+		PlaneModel& model = models[plane];
+		NormalizeFrequencies(counts, total, model.frequencies);
+		p8 usedSymbols = output;
+		memset(usedSymbols, 0, 32);
+		output += 32;
+		u32 start = 0;
+		for (s32 s = 0; s < 256; s++)
+		{
+			model.starts[s] = start;
+			start += model.frequencies[s];
+			if (model.frequencies[s] > 0)
+			{
+				usedSymbols[s >> 3] |= (u8)(1 << (s & 7));
+				const u16 frequency = (u16)model.frequencies[s];
+				memcpy(output, &frequency, sizeof(u16));
+				output += sizeof(u16);
+			}
+		}
+	}
+	header->tablesSize = (u32)(output - tables);
+
+	u32* chunkSizes = (u32*)output;
+	output += header->chunksCount * sizeof(u32);
+
+	p8 scratch = g_BakingAllocator.allocate_array<u8>(i_chunkSize * 3 / 2 + 16);
+	p8 scratchEnd = scratch + i_chunkSize * 3 / 2 + 16;
+	for (u32 c = 0; c < header->chunksCount; c++)
+	{
+		const size chunkStart = (size)c * i_chunkSize;
+		const size chunkSize = floral::min((size)i_chunkSize, i_size - chunkStart);
+		const size codedSize = EncodeChunk(&i_input[chunkStart], chunkSize, i_stride, models, scratchEnd);
+		memcpy(output, scratchEnd - codedSize, codedSize);
+		const u32 chunkCodedSize = (u32)codedSize;
+		memcpy(&chunkSizes[c], &chunkCodedSize, sizeof(u32));
+		output += codedSize;
+	}
+	g_BakingAllocator.free(scratch);
+
+	return (size)(output - o_output);
+}
+
+const size SupercompressSurface(const p8 i_input, const size i_size, const u32 i_stride, p8 o_output)
+{
+	FLORAL_ASSERT(i_stride > 0 && i_stride <= k_MaxSupercompressionStride);
+	if (i_size == 0 || i_size % i_stride != 0)
+	{
+		return 0;
+	}
+
+	const u32 chunkSize = k_ChunkSize / i_stride * i_stride;
+	size codedSize = EncodeSurface(i_input, i_size, i_stride, SupercompressionFilter::None, chunkSize, o_output);
+
+	// delta filtered planes win on smooth endpoints and uncompressed pixels
+	p8 filteredData = g_BakingAllocator.allocate_array<u8>(i_size);
+	p8 filteredOutput = g_BakingAllocator.allocate_array<u8>(GetSupercompressionBound(i_size));
+	FilterSurface(i_input, i_size, i_stride, chunkSize, filteredData);
+	const size filteredSize = EncodeSurface(filteredData, i_size, i_stride, SupercompressionFilter::Delta, chunkSize, filteredOutput);
+	if (filteredSize < codedSize)
+	{
+		memcpy(o_output, filteredOutput, filteredSize);
+		codedSize = filteredSize;
+	}
+	g_BakingAllocator.free(filteredOutput);
+	g_BakingAllocator.free(filteredData);
+
+	return codedSize < i_size ? codedSize : 0;
+}
+
+// -------------------------------------------------------------------
+
+static void BuildPlaneDecoder(const u8* i_table, PlaneDecoder* o_decoder)
+{
+	const u8* frequencies = i_table + 32;
+	u32 start = 0;
+	for (s32 s = 0; s < 256; s++)
+	{
+		u16 frequency = 0;
+		if (i_table[s >> 3] & (1 << (s & 7)))
+		{
+			memcpy(&frequency, frequencies, sizeof(u16));
+			frequencies += sizeof(u16);
+			memset(&o_decoder->symbols[start], s, frequency);
+		}
+		o_decoder->frequencies[s] = frequency;
+		o_decoder->starts[s] = (u16)start;
+		start += frequency;
+	}
+}
+
+static inline const u8 DecodeSymbol(u32& io_state, const u8*& io_input, const PlaneDecoder& i_decoder)
+{
+	const u32 slot = io_state & (k_ProbabilityScale - 1);
+	const u8 symbol = i_decoder.symbols[slot];
+	u32 state = i_decoder.frequencies[symbol] * (io_state >> k_ProbabilityBits) + slot - i_decoder.starts[symbol];
+
+	while (state < k_RansLowerBound)
+	{
+		state = (state << 8) | *io_input++;
+	}
+	io_state = state;
+	return symbol;
+}
+
+// elements of one plane, the states take turns
+template <bool TDelta>
+static void DecodePlane(u32* io_states, const u8*& io_input, const PlaneDecoder& i_decoder,
+		const size i_elementsCount, const u32 i_stride, p8 o_output)
+{
+	u32 state0 = io_states[0];
+	u32 state1 = io_states[1];
+	u32 state2 = io_states[2];
+	u32 state3 = io_states[3];
+	const u8* input = io_input;
+	u8 previous = 0;
+	size j = 0;
+	for (; j + 3 < i_elementsCount; j += 4)
+	{
+		u8 symbols[4];
+		symbols[0] = DecodeSymbol(state0, input, i_decoder);
+		symbols[1] = DecodeSymbol(state1, input, i_decoder);
+		symbols[2] = DecodeSymbol(state2, input, i_decoder);
+		symbols[3] = DecodeSymbol(state3, input, i_decoder);
+		for (s32 k = 0; k < 4; k++)
+		{
+			previous = TDelta ? (u8)(previous + symbols[k]) : symbols[k];
+			o_output[(j + k) * i_stride] = previous;
+		}
+	}
+	u32* states[] = { &state0, &state1, &state2 };
+	for (; j < i_elementsCount; j++)
+	{
+		const u8 symbol = DecodeSymbol(*states[j & 3], input, i_decoder);
+		previous = TDelta ? (u8)(previous + symbol) : symbol;
+		o_output[j * i_stride] = previous;
+	}
+	io_states[0] = state0;
+	io_states[1] = state1;
+	io_states[2] = state2;
+	io_states[3] = state3;
+	io_input = input;
+}
+
+static void DecompressChunks(voidptr i_job, const s32 i_firstChunk, const s32 i_lastChunk)
+{
+	const DecompressJob* job = (const DecompressJob*)i_job;
+	const u32 stride = job->header->stride;
+	const u32 chunkSize = job->header->chunkSize;
+	const bool isDelta = (job->header->filter == (u8)SupercompressionFilter::Delta);
+
+	PlaneDecoder decoder;
+	for (s32 c = i_firstChunk; c < i_lastChunk; c++)
+	{
+		const u8* input = job->chunks + job->chunkOffsets[c];
+		p8 output = job->output + (size)c * chunkSize;
+		const size elementsCount = floral::min((size)chunkSize, job->outputSize - (size)c * chunkSize) / stride;
+
+		u32 states[k_RansStatesCount];
+		memcpy(states, input, sizeof(states));
+		input += sizeof(states);
+		for (u32 plane = 0; plane < stride; plane++)
+		{
+			// rebuilding the tables costs about one symbol per slot, a chunk plane has thousands of symbols
+			BuildPlaneDecoder(job->tables[plane], &decoder);
+			if (isDelta)
+			{
+				DecodePlane<true>(states, input, decoder, elementsCount, stride, output + plane);
+			}
+			else
+			{
+				DecodePlane<false>(states, input, decoder, elementsCount, stride, output + plane);
+			}
+		}
+	}
+}
+
+void DecompressSurface(const p8 i_input, const size i_inputSize, p8 o_output, const size i_outputSize, const u32 i_threadsCount)
+{
+	const SupercompressionHeader* header = (const SupercompressionHeader*)i_input;
+	DecompressJob job;
+	job.header = header;
+	const u8* tables = i_input + sizeof(SupercompressionHeader);
+	for (u32 plane = 0; plane < header->stride; plane++)
+	{
+		job.tables[plane] = tables;
+		u32 usedSymbols = 0;
+		for (s32 s = 0; s < 256; s++)
+		{
+			usedSymbols += (tables[s >> 3] >> (s & 7)) & 1;
+		}
+		tables += 32 + usedSymbols * sizeof(u16);
+	}
+	job.chunkSizes = (const u32*)(i_input + sizeof(SupercompressionHeader) + header->tablesSize);
+	job.chunks = (const u8*)(job.chunkSizes + header->chunksCount);
+	job.chunkOffsets = g_BakingAllocator.allocate_array<size>(header->chunksCount);
+	size offset = 0;
+	for (u32 c = 0; c < header->chunksCount; c++)
+	{
+		job.chunkOffsets[c] = offset;
+		u32 chunkSize = 0;
+		memcpy(&chunkSize, &job.chunkSizes[c], sizeof(u32));
+		offset += chunkSize;
+	}
+	FLORAL_ASSERT((size)(job.chunks - i_input) + offset <= i_inputSize);
+	job.output = o_output;
+	job.outputSize = i_outputSize;
+
+	// chunks are independent, they are spread the same way as block rows
+	CompressBlockRowsParallel((s32)header->chunksCount, i_threadsCount, &DecompressChunks, &job);
+	g_BakingAllocator.free(job.chunkOffsets);
+}
+
+// -------------------------------------------------------------------
+
+void BenchmarkSupercompression(floral::filesystem<FreelistArena>* i_fs, const_cstr i_inputFilename, const u32 i_threadsCount)
+{
+	typedef std::chrono::high_resolution_clock BenchmarkClock;
+	static const f64 k_MinSecondsPerRun = 0.5;
+
+	floral::relative_path inputPath = floral::build_relative_path(i_inputFilename);
+	floral::file_info inputFile = floral::open_file_read(i_fs, inputPath);
+	if (inputFile.file_size < sizeof(cbtex::TextureFileHeader))
+	{
+		floral::close_file(inputFile);
+		CLOVER_ERROR("cannot read '%s'", i_inputFilename);
+		return;
+	}
+	p8 fileData = (p8)g_BakingAllocator.allocate(inputFile.file_size);
+	floral::read_all_file(inputFile, fileData);
+	floral::close_file(inputFile);
+
+	const cbtex::TextureFileHeader* fileHeader = (const cbtex::TextureFileHeader*)fileData;
+	if (memcmp(fileHeader->magicCharacters, "CBTX", 4) != 0 || fileHeader->version != cbtex::k_TextureFileVersion)
+	{
+		CLOVER_ERROR("'%s' is not a v%d cbtex file", i_inputFilename, cbtex::k_TextureFileVersion);
+		g_BakingAllocator.free(fileData);
+		return;
+	}
+
+	const cbtex::SurfaceEntry* surfaces = (const cbtex::SurfaceEntry*)(fileData + sizeof(cbtex::TextureFileHeader));
+	const p8 payload = fileData + fileHeader->payloadOffset;
+	const u32 stride = GetSupercompressionStride(fileHeader->header);
+
+	// every surface as is, one after the other, and the same surfaces coded
+	size rawSize = 0;
+	size codedSize = 0;
+	for (u32 i = 0; i < fileHeader->surfacesCount; i++)
+	{
+		if (surfaces[i].compressedSize != surfaces[i].size)
+		{
+			CLOVER_ERROR("'%s' is already supercompressed", i_inputFilename);
+			g_BakingAllocator.free(fileData);
+			return;
+		}
+		rawSize += (size)surfaces[i].size;
+	}
+
+	p8* codedSurfaces = g_BakingAllocator.allocate_array<p8>(fileHeader->surfacesCount);
+	size* codedSizes = g_BakingAllocator.allocate_array<size>(fileHeader->surfacesCount);
+	for (u32 i = 0; i < fileHeader->surfacesCount; i++)
+	{
+		const size surfaceSize = (size)surfaces[i].size;
+		codedSurfaces[i] = g_BakingAllocator.allocate_array<u8>(GetSupercompressionBound(surfaceSize));
+		codedSizes[i] = SupercompressSurface(payload + surfaces[i].offset, surfaceSize, stride, codedSurfaces[i]);
+		codedSize += codedSizes[i] > 0 ? codedSizes[i] : surfaceSize;
+	}
+
+	CLOVER_INFO("supercompression benchmark: %s (%d surfaces, %zu bytes elements)", i_inputFilename, fileHeader->surfacesCount, (size_t)stride);
+	CLOVER_INFO("  %zu -> %zu bytes (%.2f%%)", (size_t)rawSize, (size_t)codedSize, (f64)codedSize * 100.0 / (f64)rawSize);
+
+	p8 decodedData = g_BakingAllocator.allocate_array<u8>(rawSize);
+	const u32 threadsCounts[] = { 1, floral::max(i_threadsCount, 1u) };
+	for (s32 t = 0; t < 2; t++)
+	{
+		if (t == 1 && threadsCounts[1] == 1)
+		{
+			break;
+		}
+
+		s32 runsCount = 0;
+		const BenchmarkClock::time_point startTime = BenchmarkClock::now();
+		f64 seconds = 0.0;
+		do
+		{
+			p8 output = decodedData;
+			for (u32 i = 0; i < fileHeader->surfacesCount; i++)
+			{
+				const size surfaceSize = (size)surfaces[i].size;
+				if (codedSizes[i] > 0)
+				{
+					DecompressSurface(codedSurfaces[i], codedSizes[i], output, surfaceSize, threadsCounts[t]);
+				}
+				else
+				{
+					memcpy(output, payload + surfaces[i].offset, surfaceSize);
+				}
+				output += surfaceSize;
+			}
+			runsCount++;
+			seconds = std::chrono::duration<f64>(BenchmarkClock::now() - startTime).count();
+		}
+		while (seconds < k_MinSecondsPerRun);
+
+		const bool matches = memcmp(decodedData, payload + surfaces[0].offset, rawSize) == 0;
+		const f64 megabytesPerSecond = (f64)rawSize * runsCount / seconds / (1024.0 * 1024.0);
+		CLOVER_INFO("  %2d threads | %9.2f MB/s decoded | %s", threadsCounts[t], megabytesPerSecond, matches ? "lossless" : "MISMATCH");
+	}
+
+	g_BakingAllocator.free(decodedData);
+	for (u32 i = 0; i < fileHeader->surfacesCount; i++)
+	{
+		g_BakingAllocator.free(codedSurfaces[i]);
+	}
+	g_BakingAllocator.free(codedSizes);
+	g_BakingAllocator.free(codedSurfaces);
+	g_BakingAllocator.free(fileData);
+}
+
+// -------------------------------------------------------------------
+}
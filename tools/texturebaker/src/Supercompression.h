@@ -0,0 +1,70 @@
+#pragma once
+
+#include <floral.h>
+#include <floral/io/filesystem.h>
+
+#include "Memory/MemorySystem.h"
+#include "CBTexture.h"
+
+namespace texbaker
+{
+// -------------------------------------------------------------------
+
+/*
+ * Lossless layer over the baked surfaces, the gpu format is left alone. The surface is seen as
+ * elements of i_stride bytes (a compressed block, a pixel) and byte k of every element goes to
+ * plane k: block endpoints and selectors end up in different planes with their own statistics.
+ * Each plane is optionally delta filtered then coded with an order 0 rANS coder (12 bits
+ * probabilities, 4 interleaved states).
+ *
+ * Stream, see tex_loader's decoder:
+ * - SupercompressionHeader
+ * - i_stride frequency tables: 256 bits of used symbols, then a u16 frequency per used symbol
+ * - u32 x chunksCount: coded size of each chunk
+ * - the chunks, each one decodes on its own: 4 u32 rANS states then the coded bytes
+ */
+#pragma pack(push)
+#pragma pack(1)
+struct SupercompressionHeader
+{
+	u8											stride;				// 1..16
+	u8											filter;				// SupercompressionFilter
+	u16											reserved;
+	u32											chunkSize;			// decoded bytes, a multiple of stride
+	u32											chunksCount;
+	u32											tablesSize;
+};
+#pragma pack(pop)
+
+enum class SupercompressionFilter : u8
+{
+	None = 0,
+	Delta										// byte - the same byte of the previous element in the chunk
+};
+
+static const u32								k_MaxSupercompressionStride = 16;
+
+// bytes per element of the surfaces of a texture: block size of compressed formats, pixel size otherwise
+const u32										GetSupercompressionStride(const cbtex::TextureHeader& i_header);
+
+const size										GetSupercompressionBound(const size i_size);
+
+/*
+ * o_output must hold GetSupercompressionBound(i_size) bytes. Returns the coded size, or 0 when coding
+ * does not make the surface smaller, it should be stored as is then.
+ */
+const size										SupercompressSurface(const p8 i_input, const size i_size, const u32 i_stride, p8 o_output);
+
+// chunks are spread over i_threadsCount threads
+void											DecompressSurface(const p8 i_input, const size i_inputSize, p8 o_output, const size i_outputSize,
+													const u32 i_threadsCount);
+
+/*
+ * Supercompresses every surface of a .cbtex file, checks the round trip and reports the ratio and
+ * the decoding speed on 1 and i_threadsCount threads.
+ */
+void											BenchmarkSupercompression(floral::filesystem<FreelistArena>* i_fs, const_cstr i_inputFilename,
+													const u32 i_threadsCount);
+
+// -------------------------------------------------------------------
+}
@@ -0,0 +1,1035 @@
+#include "TextureBaker.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <mutex>
+
+#include <floral/math/utils.h>
+#include <floral/gpds/vec.h>
+
+#include <clover/logger.h>
+
+#include "stb_image.h"
+
+namespace texbaker
+{
+// -------------------------------------------------------------------
+
+// floral's filesystem is not thread safe, all file accesses of the workers go through this
+static std::mutex								s_FileSystemMutex;
+
+// -------------------------------------------------------------------
+
+const BakeJob GetDefaultBakeJob()
+{
+	BakeJob job;
+	job.inputFilePath = nullptr;
+	job.outputFilePath = nullptr;
+	job.texType = cbtex::Type::Undefined;
+	job.colorRange = cbtex::ColorRange::Undefined;
+	job.inputGamma = 1.0f;
+	job.generateMipmaps = true;
+	job.compression = cbtex::Compression::NoCompress;
+	job.dxtQuality = DXTQuality::High;
+	job.etcEffort = ETCEffort::Best;
+	job.blockQuality = BlockQuality::High;
+	job.mipOptions = GetDefaultMipChainOptions();
+	job.pmremSamplesCount = 512;
+	job.fixupCubeEdges = false;
+	job.supercompress = false;
+	job.payloadAlignment = cbtex::k_PagePayloadAlignment;
+	return job;
+}
+
+const bool ParseBakeJob(const s32 i_argc, const_cstr* i_argv, BakeJob* io_job)
+{
+	for (s32 i = 0; i < i_argc; i++)
+	{
+		const bool hasValue = (i + 1) < i_argc;
+		if (strcmp(i_argv[i], "--input") == 0)
+		{
+			if (!hasValue) return false;
+			i++;
+			io_job->inputFilePath = i_argv[i];
+		}
+		else if (strcmp(i_argv[i], "--output") == 0)
+		{
+			if (!hasValue) return false;
+			i++;
+			io_job->outputFilePath = i_argv[i];
+		}
+		else if (strcmp(i_argv[i], "--dim") == 0)
+		{
+			if (!hasValue) return false;
+			i++;
+			if (strcmp(i_argv[i], "2d") == 0)
+			{
+				io_job->texType = cbtex::Type::Texture2D;
+			}
+			else if (strcmp(i_argv[i], "cubemap") == 0)
+			{
+				io_job->texType = cbtex::Type::CubeMap;
+			}
+			else if (strcmp(i_argv[i], "pmrem") == 0)
+			{
+				io_job->texType = cbtex::Type::PMREM;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		else if (strcmp(i_argv[i], "--color-range") == 0)
+		{
+			if (!hasValue) return false;
+			i++;
+			if (strcmp(i_argv[i], "ldr") == 0)
+			{
+				io_job->colorRange = cbtex::ColorRange::LDR;
+			}
+			else if (strcmp(i_argv[i], "hdr") == 0)
+			{
+				io_job->colorRange = cbtex::ColorRange::HDR;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		else if (strcmp(i_argv[i], "--input-gamma") == 0)
+		{
+			if (!hasValue) return false;
+			i++;
+			io_job->inputGamma = atof(i_argv[i]);
+		}
+		else if (strcmp(i_argv[i], "--generate-mipmaps") == 0)
+		{
+			if (!hasValue) return false;
+			i++;
+			if (strcmp(i_argv[i], "on") == 0)
+			{
+				io_job->generateMipmaps = true;
+			}
+			else if (strcmp(i_argv[i], "off") == 0)
+			{
+				io_job->generateMipmaps = false;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		else if (strcmp(i_argv[i], "--compression") == 0)
+		{
+			if (!hasValue) return false;
+			i++;
+			if (strcmp(i_argv[i], "dxt") == 0)
+			{
+				io_job->compression = cbtex::Compression::DXT;
+			}
+			else if (strcmp(i_argv[i], "etc") == 0)
+			{
+				io_job->compression = cbtex::Compression::ETC;
+			}
+			else if (strcmp(i_argv[i], "bc6h") == 0)
+			{
+				io_job->compression = cbtex::Compression::BC6H;
+			}
+			else if (strcmp(i_argv[i], "bc7") == 0)
+			{
+				io_job->compression = cbtex::Compression::BC7;
+			}
+			else if (strcmp(i_argv[i], "astc") == 0)
+			{
+				io_job->compression = cbtex::Compression::ASTC;
+			}
+			else if (strcmp(i_argv[i], "no-compress") == 0)
+			{
+				io_job->compression = cbtex::Compression::NoCompress;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		else if (strcmp(i_argv[i], "--dxt-quality") == 0)
+		{
+			if (!hasValue) return false;
+			i++;
+			if (strcmp(i_argv[i], "fast") == 0)
+			{
+				io_job->dxtQuality = DXTQuality::Fast;
+			}
+			else if (strcmp(i_argv[i], "normal") == 0)
+			{
+				io_job->dxtQuality = DXTQuality::Normal;
+			}
+			else if (strcmp(i_argv[i], "high") == 0)
+			{
+				io_job->dxtQuality = DXTQuality::High;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		else if (strcmp(i_argv[i], "--block-quality") == 0)
+		{
+			if (!hasValue) return false;
+			i++;
+			if (strcmp(i_argv[i], "fast") == 0)
+			{
+				io_job->blockQuality = BlockQuality::Fast;
+			}
+			else if (strcmp(i_argv[i], "normal") == 0)
+			{
+				io_job->blockQuality = BlockQuality::Normal;
+			}
+			else if (strcmp(i_argv[i], "high") == 0)
+			{
+				io_job->blockQuality = BlockQuality::High;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		else if (strcmp(i_argv[i], "--etc-effort") == 0)
+		{
+			if (!hasValue) return false;
+			i++;
+			if (strcmp(i_argv[i], "fast") == 0)
+			{
+				io_job->etcEffort = ETCEffort::Fast;
+			}
+			else if (strcmp(i_argv[i], "normal") == 0)
+			{
+				io_job->etcEffort = ETCEffort::Normal;
+			}
+			else if (strcmp(i_argv[i], "best") == 0)
+			{
+				io_job->etcEffort = ETCEffort::Best;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		else if (strcmp(i_argv[i], "--mip-filter") == 0)
+		{
+			if (!hasValue) return false;
+			i++;
+			if (strcmp(i_argv[i], "box") == 0)
+			{
+				io_job->mipOptions.filter = MipFilter::Box;
+			}
+			else if (strcmp(i_argv[i], "kaiser") == 0)
+			{
+				io_job->mipOptions.filter = MipFilter::Kaiser;
+			}
+			else if (strcmp(i_argv[i], "lanczos") == 0)
+			{
+				io_job->mipOptions.filter = MipFilter::Lanczos;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		else if (strcmp(i_argv[i], "--alpha-cutoff") == 0)
+		{
+			if (!hasValue) return false;
+			i++;
+			io_job->mipOptions.alphaCutoff = (f32)atof(i_argv[i]);
+		}
+		else if (strcmp(i_argv[i], "--pmrem-samples") == 0)
+		{
+			if (!hasValue) return false;
+			i++;
+			const s32 samplesCount = atoi(i_argv[i]);
+			if (samplesCount <= 0) return false;
+			io_job->pmremSamplesCount = (u32)samplesCount;
+		}
+		else if (strcmp(i_argv[i], "--payload-alignment") == 0)
+		{
+			if (!hasValue) return false;
+			i++;
+			const s32 alignment = atoi(i_argv[i]);
+			if (alignment < (s32)cbtex::k_MinPayloadAlignment || alignment > (s32)cbtex::k_PagePayloadAlignment
+					|| (alignment & (alignment - 1)) != 0)
+			{
+				return false;
+			}
+			io_job->payloadAlignment = (u32)alignment;
+		}
+		else if (strcmp(i_argv[i], "--supercompression") == 0)
+		{
+			if (!hasValue) return false;
+			i++;
+			if (strcmp(i_argv[i], "on") == 0)
+			{
+				io_job->supercompress = true;
+			}
+			else if (strcmp(i_argv[i], "off") == 0)
+			{
+				io_job->supercompress = false;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		else if (strcmp(i_argv[i], "--cube-edge-fixup") == 0)
+		{
+			if (!hasValue) return false;
+			i++;
+			if (strcmp(i_argv[i], "on") == 0)
+			{
+				io_job->fixupCubeEdges = true;
+			}
+			else if (strcmp(i_argv[i], "off") == 0)
+			{
+				io_job->fixupCubeEdges = false;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		else
+		{
+			// a typo would bake with the defaults otherwise
+			return false;
+		}
+	}
+
+	return true;
+}
+
+const bool IsBakeJobValid(const BakeJob& i_job)
+{
+	if (i_job.inputFilePath == nullptr || i_job.outputFilePath == nullptr)
+	{
+		return false;
+	}
+
+	if (i_job.texType == cbtex::Type::Texture2D)
+	{
+		if (i_job.colorRange == cbtex::ColorRange::LDR && i_job.compression == cbtex::Compression::BC6H)
+		{
+			CLOVER_ERROR("%s: bc6h is for hdr inputs only", i_job.inputFilePath);
+			return false;
+		}
+		return i_job.colorRange != cbtex::ColorRange::Undefined;
+	}
+
+	return i_job.texType == cbtex::Type::CubeMap || i_job.texType == cbtex::Type::PMREM;
+}
+
+// -------------------------------------------------------------------
+
+p8 CompressETC2(p8 i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels, const ETCEffort i_effort,
+		const u32 i_jobsCount, size* o_compressedSize)
+{
+	const size compressedSize = GetETCCompressedSize(i_width, i_height, i_numChannels);
+	p8 output = (p8)g_BakingAllocator.allocate(compressedSize);
+	CompressETCImage(i_input, i_width, i_height, i_numChannels, i_effort, i_jobsCount, output);
+
+	*o_compressedSize = compressedSize;
+	return output;
+}
+
+p8 CompressDXT(p8 i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels, const DXTQuality i_quality,
+		const u32 i_threadsCount, size* o_compressedSize)
+{
+	// 4 channels: dxt5, otherwise dxt1 (only 1 bit for alpha)
+	const size compressedSize = dxt::GetDXTCompressedSize(i_width, i_height, i_numChannels);
+	p8 output = (p8)g_BakingAllocator.allocate(compressedSize);
+	CompressDXTImage(i_input, i_width, i_height, i_numChannels, i_quality, i_threadsCount, output);
+
+	*(o_compressedSize) = compressedSize;
+	return output;
+}
+
+p8 CompressBC7(p8 i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels, const BlockQuality i_quality,
+		const u32 i_threadsCount, size* o_compressedSize)
+{
+	const size compressedSize = GetBPTCCompressedSize(i_width, i_height);
+	p8 output = (p8)g_BakingAllocator.allocate(compressedSize);
+	CompressBC7Image(i_input, i_width, i_height, i_numChannels, i_quality, i_threadsCount, output);
+
+	*o_compressedSize = compressedSize;
+	return output;
+}
+
+p8 CompressBC6H(const f32* i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels, const BlockQuality i_quality,
+		const u32 i_threadsCount, size* o_compressedSize)
+{
+	const size compressedSize = GetBPTCCompressedSize(i_width, i_height);
+	p8 output = (p8)g_BakingAllocator.allocate(compressedSize);
+	CompressBC6HImage(i_input, i_width, i_height, i_numChannels, i_quality, i_threadsCount, output);
+
+	*o_compressedSize = compressedSize;
+	return output;
+}
+
+p8 CompressASTC(p8 i_input, const s32 i_width, const s32 i_height, const s32 i_numChannels, const BlockQuality i_quality,
+		const u32 i_threadsCount, size* o_compressedSize)
+{
+	const size compressedSize = GetASTCCompressedSize(i_width, i_height);
+	p8 output = (p8)g_BakingAllocator.allocate(compressedSize);
+	CompressASTCImage(i_input, i_width, i_height, i_numChannels, i_quality, i_threadsCount, output);
+
+	*o_compressedSize = compressedSize;
+	return output;
+}
+
+void ConvertToHalfFloat(const f32* i_data, f16* o_data, const s32 i_width, const s32 i_height, const s32 i_numChannels)
+{
+	for (s32 y = 0; y < i_height; y++)
+	{
+		for (s32 x = 0; x < i_width; x++)
+		{
+			for (s32 c = 0; c < i_numChannels; c++)
+			{
+				f32 comp32 = i_data[(y * i_width + x) * i_numChannels + c];
+				f16 comp16 = floral::float_to_half_full(comp32);
+				o_data[(y * i_width + x) * i_numChannels + c] = comp16;
+			}
+		}
+	}
+}
+
+floral::vec4f RGBMEncode(const floral::vec3f& i_hdrColor)
+{
+	floral::vec4f rgbm;
+	floral::vec3f color = i_hdrColor / 6.0f;
+	rgbm.w = floral::clamp(floral::max(floral::max(color.x, color.y), floral::max(color.z, 0.000001f)), 0.0f, 1.0f);
+	rgbm.w = ceil(rgbm.w * 255.0f) / 255.0f;
+	rgbm.x = color.x / rgbm.w;
+	rgbm.y = color.y / rgbm.w;
+	rgbm.z = color.z / rgbm.w;
+	return rgbm;
+}
+
+floral::vec3f RGBMDecode(const floral::vec4f& i_rgbmColor)
+{
+	floral::vec3f color(i_rgbmColor.x, i_rgbmColor.y, i_rgbmColor.z);
+	return 6.0f * color * i_rgbmColor.w;
+}
+
+void ConvertToRGBM(const f32* i_inpData, p8 o_rgbmData, const s32 i_width, const s32 i_height, const f32 i_gamma)
+{
+	f32 invGamma = 1.0f / i_gamma;
+	for (s32 y = 0; y < i_height; y++)
+	{
+		for (s32 x = 0; x < i_width; x++)
+		{
+			s32 pixelIdx = y * i_width + x;
+			floral::vec3f hdrColor(i_inpData[pixelIdx * 3], i_inpData[pixelIdx * 3 + 1], i_inpData[pixelIdx * 3 + 2]);
+
+			if (hdrColor.x < 0.0f || hdrColor.y < 0.0f || hdrColor.z < 0.0f)
+			{
+				CLOVER_WARNING("clamping pixel at (x, y) = (%d, %d) because it has negative component: (%f, %f, %f)", x, y, hdrColor.x, hdrColor.y, hdrColor.z);
+				hdrColor.x = floral::max(hdrColor.x, 0.0f);
+				hdrColor.y = floral::max(hdrColor.y, 0.0f);
+				hdrColor.z = floral::max(hdrColor.z, 0.0f);
+			}
+
+			floral::vec3f gammaCorrectedHDRColor;
+			gammaCorrectedHDRColor.x = powf(hdrColor.x, i_gamma);
+			gammaCorrectedHDRColor.y = powf(hdrColor.y, i_gamma);
+			gammaCorrectedHDRColor.z = powf(hdrColor.z, i_gamma);
+			floral::vec4f rgbmFloatColor = RGBMEncode(gammaCorrectedHDRColor);
+			FLORAL_ASSERT(rgbmFloatColor.x <= 1.0f);
+			FLORAL_ASSERT(rgbmFloatColor.y <= 1.0f);
+			FLORAL_ASSERT(rgbmFloatColor.z <= 1.0f);
+			FLORAL_ASSERT(rgbmFloatColor.w <= 1.0f);
+			o_rgbmData[pixelIdx * 4] = ceil(rgbmFloatColor.x * 255.0f);
+			o_rgbmData[pixelIdx * 4 + 1] = ceil(rgbmFloatColor.y * 255.0f);
+			o_rgbmData[pixelIdx * 4 + 2] = ceil(rgbmFloatColor.z * 255.0f);
+			o_rgbmData[pixelIdx * 4 + 3] = ceil(rgbmFloatColor.w * 255.0f);
+#if 0
+			floral::vec3f constructedHDRGamma = RGBMDecode(rgbmFloatColor);
+			constructedHDRGamma.x = powf(constructedHDRGamma.x, invGamma);
+			constructedHDRGamma.y = powf(constructedHDRGamma.y, invGamma);
+			constructedHDRGamma.z = powf(constructedHDRGamma.z, invGamma);
+#endif
+		}
+	}
+}
+
+void TrimImage(f32* i_imgData, f32* o_outData, const s32 i_x, const s32 i_y, const s32 i_width, const s32 i_height,
+		const s32 i_imgWidth, const s32 i_imgHeight, const s32 i_channelCount)
+{
+	s32 outScanline = 0;
+	for (s32 i = i_y; i < (i_y + i_height); i++)
+	{
+		memcpy(&o_outData[outScanline * i_width * i_channelCount],
+				&i_imgData[(i * i_imgWidth + i_x) * i_channelCount],
+				i_height * i_channelCount * sizeof(f32));
+		outScanline++;
+	}
+}
+
+floral::vec3f HDRToneMap(const f32* i_hdrRGB)
+{
+	floral::vec3f hdrColor(i_hdrRGB[0], i_hdrRGB[1], i_hdrRGB[2]);
+	f32 maxLuma = floral::max(hdrColor.x, floral::max(hdrColor.y, hdrColor.z));
+	hdrColor.x = hdrColor.x / (1.0f + maxLuma / 35.0f);
+	hdrColor.y = hdrColor.y / (1.0f + maxLuma / 35.0f);
+	hdrColor.z = hdrColor.z / (1.0f + maxLuma / 35.0f);
+	return hdrColor;
+}
+
+// -------------------------------------------------------------------
+
+static voidptr ReadWholeFile(floral::filesystem<FreelistArena>* i_fs, const_cstr i_filename, size* o_fileSize)
+{
+	std::lock_guard<std::mutex> lock(s_FileSystemMutex);
+	floral::relative_path inputPath = floral::build_relative_path(i_filename);
+	floral::file_info inputFile = floral::open_file_read(i_fs, inputPath);
+	if (inputFile.file_size == 0)
+	{
+		floral::close_file(inputFile);
+		return nullptr;
+	}
+
+	voidptr inputFileData = g_BakingAllocator.allocate(inputFile.file_size);
+	floral::read_all_file(inputFile, inputFileData);
+	floral::close_file(inputFile);
+	*o_fileSize = inputFile.file_size;
+	return inputFileData;
+}
+
+static void FindMaxRange(const f32* i_data, const s32 i_pixelsCount, const s32 i_numChannels, f32* o_maxRange)
+{
+	for (s32 i = 0; i < i_pixelsCount; i++)
+	{
+		for (s32 c = 0; c < i_numChannels; c++)
+		{
+			FLORAL_ASSERT(i_data[i * i_numChannels + c] >= 0.0f);
+			if (i_data[i * i_numChannels + c] > o_maxRange[c])
+			{
+				o_maxRange[c] = i_data[i * i_numChannels + c];
+			}
+		}
+	}
+}
+
+static const bool LoadSourceLDR(const voidptr i_fileData, const size i_fileSize, const BakeJob& i_job, SourceImage* o_source)
+{
+	FLORAL_ASSERT(i_job.inputGamma <= 1.0f); // noone encode image to save in HDD with gamma > 1.0f
+
+	s32 x, y, n;
+	p8 data = stbi_load_from_memory((p8)i_fileData, i_fileSize, &x, &y, &n, 0);
+	if (data == nullptr)
+	{
+		return false;
+	}
+	FLORAL_ASSERT(x == y);
+
+	cbtex::TextureHeader& header = o_source->header;
+	header.textureType = cbtex::Type::Texture2D;
+	header.colorRange = cbtex::ColorRange::LDR;
+	header.mipsCount = (s32)log2(x) + 1;
+	header.resolution = x;
+	header.compression = i_job.compression;
+
+	switch (header.compression)
+	{
+	case cbtex::Compression::NoCompress:
+	{
+		header.encodedGamma = i_job.inputGamma;
+		if (header.encodedGamma == 1.0f)
+		{
+			header.colorSpace = cbtex::ColorSpace::Linear;
+		}
+		else
+		{
+			header.colorSpace = cbtex::ColorSpace::GammaCorrected;
+		}
+
+		switch (n)
+		{
+			case 1:
+				header.colorChannel = cbtex::ColorChannel::R;
+				break;
+			case 2:
+				header.colorChannel = cbtex::ColorChannel::RG;
+				break;
+			case 3:
+				header.colorChannel = cbtex::ColorChannel::RGB;
+				break;
+			case 4:
+				header.colorChannel = cbtex::ColorChannel::RGBA;
+				break;
+			default:
+				FLORAL_ASSERT(false);
+				break;
+		}
+
+		break;
+	}
+
+	case cbtex::Compression::DXT:
+	case cbtex::Compression::ETC:
+	case cbtex::Compression::BC7:
+	case cbtex::Compression::ASTC:
+	{
+		// when in DXT, ETC, BC7 and ASTC, we will only use Linear color space, R, RG texture is treated as RGB texture
+		// shader must be reponsible to sample the texture correctly
+		header.colorSpace = cbtex::ColorSpace::Linear;
+		header.encodedGamma = 1.0f;
+		switch (n)
+		{
+			case 1:
+			case 2:
+			case 3:
+				header.colorChannel = cbtex::ColorChannel::RGB;
+				break;
+			case 4:
+				header.colorChannel = cbtex::ColorChannel::RGBA;
+				break;
+			default:
+				FLORAL_ASSERT(false);
+				break;
+		}
+		break;
+	}
+	default:
+		FLORAL_ASSERT(false);
+		break;
+	}
+
+	// compressed textures are stored linear, uncompressed ones keep the gamma of the input
+	const f32 outputGamma = (header.compression == cbtex::Compression::NoCompress) ? i_job.inputGamma : 1.0f;
+	o_source->ldrChain = g_BakingAllocator.allocate_array<u8>(GetMipChainSize(x, y, n, header.mipsCount));
+	BuildMipChainLDR(data, x, y, n, i_job.inputGamma, outputGamma, header.mipsCount, i_job.mipOptions, o_source->ldrChain);
+	stbi_image_free(data);
+
+	o_source->channelsCount = n;
+	o_source->facesCount = 1;
+	return true;
+}
+
+static const bool LoadSourceHDR(const voidptr i_fileData, const size i_fileSize, const BakeJob& i_job, SourceImage* o_source)
+{
+	s32 x, y, n;
+	f32* data = stbi_loadf_from_memory((p8)i_fileData, i_fileSize, &x, &y, &n, 0);
+	if (data == nullptr)
+	{
+		return false;
+	}
+	FLORAL_ASSERT(n == 3);
+
+	f32 maxRange[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	s32 pixelsCount = x * y;
+	FindMaxRange(data, pixelsCount, n, maxRange);
+
+	cbtex::TextureHeader& header = o_source->header;
+	header.colorRange = cbtex::ColorRange::HDR;
+	header.encodedGamma = i_job.inputGamma;
+	header.colorSpace = cbtex::ColorSpace::Linear;
+	header.compression = i_job.compression;
+
+	// bc6h stores half floats directly, the other formats are limited by the rgbm / 16 bits float encoding
+	const bool isRangeLimited = (i_job.compression != cbtex::Compression::BC6H);
+	if (i_job.texType == cbtex::Type::Texture2D)
+	{
+		FLORAL_ASSERT(x == y);
+		if (isRangeLimited)
+		{
+			FLORAL_ASSERT(maxRange[0] <= 36.0f); // why? because our rgbm range is 0..6 including 2.0 gamma, and 6^2 = 36
+			FLORAL_ASSERT(maxRange[1] <= 36.0f);
+			FLORAL_ASSERT(maxRange[2] <= 36.0f);
+		}
+
+		header.textureType = cbtex::Type::Texture2D;
+		switch (n)
+		{
+			case 3:
+				header.colorChannel = cbtex::ColorChannel::RGB;
+				break;
+			case 4:
+				header.colorChannel = cbtex::ColorChannel::RGBA;
+				break;
+			default:
+				FLORAL_ASSERT(false);
+				break;
+		}
+		header.mipsCount = (s32)log2(x) + 1;
+		header.resolution = x;
+
+		o_source->facesCount = 1;
+		o_source->hdrChains[0] = g_BakingAllocator.allocate_array<f32>(GetMipChainSize(x, x, n, header.mipsCount));
+		memcpy(o_source->hdrChains[0], data, pixelsCount * n * sizeof(f32));
+	}
+	else
+	{
+		if (isRangeLimited && (maxRange[0] > 36.0f || maxRange[1] > 36.0f || maxRange[2] > 36.0f))
+		{
+			CLOVER_WARNING("tonemapping the hdr input because the hdr range is outside 36.0f");
+			for (s32 i = 0; i < pixelsCount; i++)
+			{
+				floral::vec3f toneMapHDRColor = HDRToneMap(&data[i * 3]);
+				data[i * 3] = toneMapHDRColor.x;
+				data[i * 3 + 1] = toneMapHDRColor.y;
+				data[i * 3 + 2] = toneMapHDRColor.z;
+			}
+		}
+
+		s32 faceSize = y;
+		header.textureType = i_job.texType;
+		header.colorChannel = cbtex::ColorChannel::RGB;
+		header.mipsCount = (s32)log2(faceSize) + 1;
+		header.resolution = faceSize;
+
+		o_source->facesCount = 6;
+		for (s32 i = 0; i < 6; i++)
+		{
+			o_source->hdrChains[i] = g_BakingAllocator.allocate_array<f32>(GetMipChainSize(faceSize, faceSize, n, header.mipsCount));
+			TrimImage(data, o_source->hdrChains[i], i * faceSize, 0, faceSize, faceSize, x, y, n);
+		}
+	}
+
+	if (o_source->facesCount == 1)
+	{
+		BuildMipChainF32(o_source->hdrChains[0], header.resolution, header.resolution, n, header.mipsCount, i_job.mipOptions);
+	}
+	else
+	{
+		BuildCubeMapMipChains(o_source->hdrChains, header.resolution, n, header.mipsCount, i_job.mipOptions);
+		if (i_job.fixupCubeEdges)
+		{
+			// the prefiltered PMREM mips are fixed up when they are baked, the radiance stays seamless
+			const s32 fixupMipsCount = (header.textureType == cbtex::Type::PMREM) ? 1 : header.mipsCount;
+			for (s32 mip = 0; mip < fixupMipsCount; mip++)
+			{
+				f32* levels[6];
+				for (s32 i = 0; i < 6; i++)
+				{
+					levels[i] = &o_source->hdrChains[i][GetMipOffset(header.resolution, header.resolution, n, mip)];
+				}
+				FixupCubeMapEdges(levels, floral::max((s32)header.resolution >> mip, 1), n);
+			}
+		}
+	}
+
+	CLOVER_INFO("%s: %d channels, max (r, g, b, a): (%4.3f, %4.3f, %4.3f, %4.3f)", i_job.inputFilePath, n,
+			maxRange[0], maxRange[1], maxRange[2], maxRange[3]);
+
+	o_source->channelsCount = n;
+	stbi_image_free(data);
+	return true;
+}
+
+const bool LoadSource(floral::filesystem<FreelistArena>* i_fs, const BakeJob& i_job, SourceImage* o_source)
+{
+	memset(o_source, 0, sizeof(SourceImage));
+	o_source->inputGamma = i_job.inputGamma;
+	o_source->dxtQuality = i_job.dxtQuality;
+	o_source->etcEffort = i_job.etcEffort;
+	o_source->blockQuality = i_job.blockQuality;
+	o_source->pmremSamplesCount = i_job.pmremSamplesCount;
+	o_source->fixupCubeEdges = i_job.fixupCubeEdges;
+	o_source->supercompress = i_job.supercompress;
+	o_source->compressionThreadsCount = 1;
+
+	size fileSize = 0;
+	voidptr fileData = ReadWholeFile(i_fs, i_job.inputFilePath, &fileSize);
+	if (fileData == nullptr)
+	{
+		CLOVER_ERROR("cannot read '%s'", i_job.inputFilePath);
+		return false;
+	}
+
+	bool result = false;
+	if (i_job.texType == cbtex::Type::Texture2D && i_job.colorRange == cbtex::ColorRange::LDR)
+	{
+		result = LoadSourceLDR(fileData, fileSize, i_job, o_source);
+	}
+	else
+	{
+		// 2d hdr or hdr cubemap
+		result = LoadSourceHDR(fileData, fileSize, i_job, o_source);
+	}
+	g_BakingAllocator.free(fileData);
+
+	if (!result)
+	{
+		CLOVER_ERROR("cannot decode '%s': %s", i_job.inputFilePath, stbi_failure_reason());
+	}
+	return result;
+}
+
+void FreeSource(SourceImage* io_source)
+{
+	if (io_source->ldrChain)
+	{
+		g_BakingAllocator.free(io_source->ldrChain);
+	}
+
+	for (s32 i = 0; i < 6; i++)
+	{
+		if (io_source->hdrChains[i])
+		{
+			g_BakingAllocator.free(io_source->hdrChains[i]);
+		}
+	}
+
+	memset(io_source, 0, sizeof(SourceImage));
+}
+
+const size GetBakingFootprint(const SourceImage& i_source)
+{
+	const cbtex::TextureHeader& header = i_source.header;
+	const size facePixels = (size)header.resolution * header.resolution;
+	const size pixelsCount = facePixels * i_source.facesCount;
+	const size n = i_source.channelsCount;
+
+	// a full mip chain is 4/3 of the top mip
+	size sourceBytes = 0;
+	size bytesPerPixel = 1;				// dxt5 / etc2 rgba / bptc / astc 4x4
+	if (header.colorRange == cbtex::ColorRange::LDR)
+	{
+		sourceBytes = pixelsCount * n * 4 / 3;
+		if (header.compression == cbtex::Compression::NoCompress)
+		{
+			bytesPerPixel = n;
+		}
+	}
+	else
+	{
+		sourceBytes = pixelsCount * n * sizeof(f32) * 4 / 3;
+		if (header.compression == cbtex::Compression::NoCompress)
+		{
+			bytesPerPixel = n * sizeof(f16);
+		}
+	}
+
+	return sourceBytes + pixelsCount * bytesPerPixel * 4 / 3;
+}
+
+const s32 GetSurfacesCount(const SourceImage& i_source)
+{
+	return i_source.facesCount * i_source.header.mipsCount;
+}
+
+static void BakeSurfaceLDR(const SourceImage& i_source, const s32 i_mip, BakedSurface* o_surface)
+{
+	const cbtex::TextureHeader& header = i_source.header;
+	const s32 x = header.resolution;
+	const s32 y = header.resolution;
+	const s32 n = i_source.channelsCount;
+	const s32 nx = x >> i_mip;
+	const s32 ny = y >> i_mip;
+	p8 mipData = &i_source.ldrChain[GetMipOffset(x, y, n, i_mip)];
+
+	if (header.compression == cbtex::Compression::NoCompress)
+	{
+		o_surface->data = g_BakingAllocator.allocate_array<u8>(nx * ny * n);
+		memcpy(o_surface->data, mipData, nx * ny * n);
+		o_surface->dataSize = nx * ny * n;
+	}
+	else if (header.compression == cbtex::Compression::DXT)
+	{
+		o_surface->data = CompressDXT(mipData, nx, ny, n, i_source.dxtQuality, i_source.compressionThreadsCount, &o_surface->dataSize);
+	}
+	else if (header.compression == cbtex::Compression::ETC)
+	{
+		o_surface->data = CompressETC2(mipData, nx, ny, n, i_source.etcEffort, i_source.compressionThreadsCount, &o_surface->dataSize);
+	}
+	else if (header.compression == cbtex::Compression::BC7)
+	{
+		o_surface->data = CompressBC7(mipData, nx, ny, n, i_source.blockQuality, i_source.compressionThreadsCount, &o_surface->dataSize);
+	}
+	else if (header.compression == cbtex::Compression::ASTC)
+	{
+		o_surface->data = CompressASTC(mipData, nx, ny, n, i_source.blockQuality, i_source.compressionThreadsCount, &o_surface->dataSize);
+	}
+	else
+	{
+		FLORAL_ASSERT(false);
+	}
+}
+
+static void BakeSurfaceHDR(const SourceImage& i_source, const s32 i_face, const s32 i_mip, BakedSurface* o_surface)
+{
+	const cbtex::TextureHeader& header = i_source.header;
+	const s32 faceSize = header.resolution;
+	const s32 mipSize = faceSize >> i_mip;
+	const s32 n = i_source.channelsCount;
+	const f32* mipData = &i_source.hdrChains[i_face][GetMipOffset(faceSize, faceSize, n, i_mip)];
+
+	f32* prefilteredData = nullptr;
+	if (header.textureType == cbtex::Type::PMREM && i_mip > 0)
+	{
+		CubeMapChains radiance;
+		for (s32 i = 0; i < 6; i++)
+		{
+			radiance.faces[i] = i_source.hdrChains[i];
+		}
+		radiance.faceSize = faceSize;
+		radiance.mipsCount = header.mipsCount;
+		radiance.numChannels = n;
+
+		prefilteredData = g_BakingAllocator.allocate_array<f32>(mipSize * mipSize * n);
+		PrefilterPMREMFace(radiance, i_face, i_mip, i_source.pmremSamplesCount, i_source.compressionThreadsCount,
+				i_source.fixupCubeEdges, prefilteredData);
+		mipData = prefilteredData;
+	}
+
+	if (header.compression == cbtex::Compression::NoCompress)
+	{
+		if (header.textureType == cbtex::Type::Texture2D)
+		{
+			FLORAL_ASSERT(header.encodedGamma == 1.0f);
+		}
+		f16* halfFloatData = g_BakingAllocator.allocate_array<f16>(mipSize * mipSize * n);
+		ConvertToHalfFloat(mipData, halfFloatData, mipSize, mipSize, n);
+		o_surface->data = (p8)halfFloatData;
+		o_surface->dataSize = mipSize * mipSize * n * sizeof(f16);
+	}
+	else if (header.compression == cbtex::Compression::DXT)
+	{
+		p8 rgbaData = g_BakingAllocator.allocate_array<u8>(mipSize * mipSize * 4);
+		ConvertToRGBM(mipData, rgbaData, mipSize, mipSize, 0.5f);
+		o_surface->data = CompressDXT(rgbaData, mipSize, mipSize, 4, i_source.dxtQuality, i_source.compressionThreadsCount, &o_surface->dataSize);
+		g_BakingAllocator.free(rgbaData);
+	}
+	else if (header.compression == cbtex::Compression::BC6H)
+	{
+		o_surface->data = CompressBC6H(mipData, mipSize, mipSize, n, i_source.blockQuality, i_source.compressionThreadsCount, &o_surface->dataSize);
+	}
+	else if (header.compression == cbtex::Compression::BC7 || header.compression == cbtex::Compression::ASTC)
+	{
+		p8 rgbaData = g_BakingAllocator.allocate_array<u8>(mipSize * mipSize * 4);
+		ConvertToRGBM(mipData, rgbaData, mipSize, mipSize, 0.5f);
+		if (header.compression == cbtex::Compression::BC7)
+		{
+			o_surface->data = CompressBC7(rgbaData, mipSize, mipSize, 4, i_source.blockQuality, i_source.compressionThreadsCount, &o_surface->dataSize);
+		}
+		else
+		{
+			o_surface->data = CompressASTC(rgbaData, mipSize, mipSize, 4, i_source.blockQuality, i_source.compressionThreadsCount, &o_surface->dataSize);
+		}
+		g_BakingAllocator.free(rgbaData);
+	}
+	else
+	{
+		FLORAL_ASSERT(false);
+	}
+
+	if (prefilteredData)
+	{
+		g_BakingAllocator.free(prefilteredData);
+	}
+}
+
+void BakeSurface(const SourceImage& i_source, const s32 i_surfaceIdx, BakedSurface* o_surface)
+{
+	const s32 mipsCount = i_source.header.mipsCount;
+	const s32 face = i_surfaceIdx / mipsCount;
+	const s32 mip = i_surfaceIdx % mipsCount;
+	CLOVER_DEBUG("Creating face %d mip #%d at size %dx%d...", face, mip + 1,
+			i_source.header.resolution >> mip, i_source.header.resolution >> mip);
+
+	if (i_source.header.colorRange == cbtex::ColorRange::LDR)
+	{
+		BakeSurfaceLDR(i_source, mip, o_surface);
+	}
+	else
+	{
+		BakeSurfaceHDR(i_source, face, mip, o_surface);
+	}
+
+	o_surface->decodedSize = o_surface->dataSize;
+	if (i_source.supercompress)
+	{
+		p8 codedData = g_BakingAllocator.allocate_array<u8>(GetSupercompressionBound(o_surface->dataSize));
+		const size codedSize = SupercompressSurface(o_surface->data, o_surface->dataSize, GetSupercompressionStride(i_source.header), codedData);
+		if (codedSize > 0)
+		{
+			g_BakingAllocator.free(o_surface->data);
+			o_surface->data = codedData;
+			o_surface->dataSize = codedSize;
+		}
+		else
+		{
+			g_BakingAllocator.free(codedData);
+		}
+	}
+}
+
+void FreeSurface(BakedSurface* io_surface)
+{
+	if (io_surface->data)
+	{
+		g_BakingAllocator.free(io_surface->data);
+	}
+	io_surface->data = nullptr;
+	io_surface->dataSize = 0;
+	io_surface->decodedSize = 0;
+}
+
+void WriteTexture(floral::filesystem<FreelistArena>* i_fs, const BakeJob& i_job, const SourceImage& i_source, const BakedSurface* i_surfaces)
+{
+	static const u8 s_padding[cbtex::k_PagePayloadAlignment] = { 0 };
+
+	const s32 surfacesCount = GetSurfacesCount(i_source);
+	const s32 mipsCount = i_source.header.mipsCount;
+	const u32 alignment = i_job.payloadAlignment;
+
+	cbtex::TextureFileHeader fileHeader;
+	memcpy(fileHeader.magicCharacters, "CBTX", 4);
+	fileHeader.version = cbtex::k_TextureFileVersion;
+	fileHeader.header = i_source.header;
+	fileHeader.facesCount = i_source.facesCount;
+	fileHeader.surfacesCount = surfacesCount;
+	fileHeader.payloadAlignment = alignment;
+	const u64 directoryEnd = sizeof(cbtex::TextureFileHeader) + (u64)surfacesCount * sizeof(cbtex::SurfaceEntry);
+	fileHeader.payloadOffset = (directoryEnd + alignment - 1) / alignment * alignment;
+	fileHeader.payloadSize = 0;
+	for (s32 i = 0; i < surfacesCount; i++)
+	{
+		fileHeader.payloadSize += i_surfaces[i].dataSize;
+	}
+
+	std::lock_guard<std::mutex> lock(s_FileSystemMutex);
+	floral::relative_path outputPath = floral::build_relative_path(i_job.outputFilePath);
+	floral::file_info outputFile = floral::open_file_write(i_fs, outputPath);
+	floral::output_file_stream outputStream;
+	floral::map_output_file(outputFile, &outputStream);
+
+	outputStream.write(fileHeader);
+	u64 offset = 0;
+	for (s32 i = 0; i < surfacesCount; i++)
+	{
+		const s32 mip = i % mipsCount;
+		cbtex::SurfaceEntry surface;
+		surface.face = i / mipsCount;
+		surface.mip = mip;
+		surface.width = floral::max(i_source.header.resolution >> mip, 1u);
+		surface.height = surface.width;
+		surface.offset = offset;
+		surface.size = i_surfaces[i].decodedSize;
+		surface.compressedSize = i_surfaces[i].dataSize;
+		outputStream.write(surface);
+		offset += i_surfaces[i].dataSize;
+	}
+
+	outputStream.write_bytes((voidptr)s_padding, (size)(fileHeader.payloadOffset - directoryEnd));
+	for (s32 i = 0; i < surfacesCount; i++)
+	{
+		outputStream.write_bytes(i_surfaces[i].data, i_surfaces[i].dataSize);
+	}
+
+	floral::close_file(outputFile);
+}
+
+// -------------------------------------------------------------------
+}
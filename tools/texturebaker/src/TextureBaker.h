@@ -0,0 +1,95 @@
+#pragma once
+
+#include <floral.h>
+#include <floral/io/filesystem.h>
+
+#include "Memory/MemorySystem.h"
+#include "CBTexture.h"
+#include "DXTCompressor.h"
+#include "BPTCCompressor.h"
+#include "ASTCCompressor.h"
+#include "ETCCompressor.h"
+#include "MipBuilder.h"
+#include "PMREMBaker.h"
+#include "Supercompression.h"
+
+namespace texbaker
+{
+// -------------------------------------------------------------------
+
+// everything needed to bake one texture, same options as the command line
+struct BakeJob
+{
+	const_cstr									inputFilePath;
+	const_cstr									outputFilePath;
+	cbtex::Type									texType;
+	cbtex::ColorRange							colorRange;
+	f32											inputGamma;
+	bool										generateMipmaps;
+	cbtex::Compression							compression;
+	DXTQuality									dxtQuality;
+	ETCEffort									etcEffort;
+	BlockQuality								blockQuality;		// BC6H, BC7 and ASTC
+	MipChainOptions								mipOptions;
+	u32											pmremSamplesCount;	// GGX samples per texel
+	bool										fixupCubeEdges;		// cubemap / PMREM: average the texels shared by the faces
+	bool										supercompress;		// lossless rANS layer over each surface, see Supercompression.h
+	u32											payloadAlignment;	// 16..4096, power of 2
+};
+
+const BakeJob									GetDefaultBakeJob();
+
+/*
+ * Parses '--input a.tga --output a.cbtex --dim 2d ...' style options into io_job, options
+ * that are not given keep their current value. Returns false on a missing or unknown value.
+ */
+const bool										ParseBakeJob(const s32 i_argc, const_cstr* i_argv, BakeJob* io_job);
+const bool										IsBakeJobValid(const BakeJob& i_job);
+
+// -------------------------------------------------------------------
+
+/*
+ * A decoded input, ready to be baked surface by surface. Surfaces are independent from each other
+ * so they can be baked in any order and on any thread.
+ * - surface index = face * mipsCount + mip, which is also the order they are written in
+ */
+struct SourceImage
+{
+	cbtex::TextureHeader						header;
+	f32											inputGamma;
+	s32											channelsCount;
+	s32											facesCount;
+	DXTQuality									dxtQuality;
+	ETCEffort									etcEffort;
+	BlockQuality								blockQuality;
+	u32											pmremSamplesCount;
+	bool										fixupCubeEdges;
+	bool										supercompress;
+	u32											compressionThreadsCount;	// threads used by the compressor of each surface
+
+	p8											ldrChain;		// Texture2D LDR: every mip, already encoded the way they are baked
+	f32*										hdrChains[6];	// HDR: every mip of each face, linear
+};
+
+struct BakedSurface
+{
+	p8											data;
+	size										dataSize;		// bytes in data, what is written to the file
+	size										decodedSize;	// bytes uploaded to the gpu, == dataSize unless supercompressed
+};
+
+const bool										LoadSource(floral::filesystem<FreelistArena>* i_fs, const BakeJob& i_job, SourceImage* o_source);
+void											FreeSource(SourceImage* io_source);
+
+// memory used by the source and all of its baked surfaces
+const size										GetBakingFootprint(const SourceImage& i_source);
+
+const s32										GetSurfacesCount(const SourceImage& i_source);
+void											BakeSurface(const SourceImage& i_source, const s32 i_surfaceIdx, BakedSurface* o_surface);
+void											FreeSurface(BakedSurface* io_surface);
+
+void											WriteTexture(floral::filesystem<FreelistArena>* i_fs, const BakeJob& i_job,
+													const SourceImage& i_source, const BakedSurface* i_surfaces);
+
+// -------------------------------------------------------------------
+}